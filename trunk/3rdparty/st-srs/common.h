@@ -471,5 +471,17 @@ ssize_t st_write(_st_netfd_t *fd, const void *buf, size_t nbyte, st_utime_t time
 int st_poll(struct pollfd *pds, int npds, st_utime_t timeout);
 _st_thread_t *st_thread_create(void *(*start)(void *arg), void *arg, int joinable, int stk_size);
 
+#ifdef MD_HAVE_IO_URING
+/* The socket I/O by io_uring, see _st_uring_io() in event.c */
+#define _ST_URING_OP_RECV       1
+#define _ST_URING_OP_SEND       2
+#define _ST_URING_OP_RECVMSG    3
+#define _ST_URING_OP_SENDMSG    4
+#define _ST_URING_FALLBACK      (-2)
+
+int _st_uring_io_enabled(int osfd);
+ssize_t _st_uring_io(_st_netfd_t *fd, int op, void *addr, size_t len, int flags, st_utime_t timeout);
+#endif
+
 #endif /* !__ST_COMMON_H__ */
 
@@ -48,6 +48,12 @@
 #ifdef MD_HAVE_EPOLL
 #include <sys/epoll.h>
 #endif
+#ifdef MD_HAVE_IO_URING
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
 
 // Global stat.
 #if defined(DEBUG) && defined(DEBUG_STATS)
@@ -61,6 +67,10 @@ __thread unsigned long long _st_stat_epoll_spin = 0;
     #error Only support epoll(for Linux), kqueue(for Darwin) or select(for Cygwin)
 #endif
 
+#if defined(MD_HAVE_IO_URING) && !defined(MD_HAVE_EPOLL)
+    #error The io_uring is only for Linux, which falls back to epoll
+#endif
+
 
 #ifdef MD_HAVE_SELECT
 static struct _st_seldata {
@@ -147,6 +157,87 @@ static __thread struct _st_epolldata {
 
 #endif  /* MD_HAVE_EPOLL */
 
+
+#ifdef MD_HAVE_IO_URING
+typedef struct _uring_fd_data {
+    int rd_ref_cnt;
+    int wr_ref_cnt;
+    int ex_ref_cnt;
+    int revents;
+    int armed;          /* Events of the outstanding POLL_ADD, 0 if none */
+    unsigned int gen;   /* Generation of the outstanding POLL_ADD */
+    int io_ref_cnt;     /* Number of the outstanding read or write requests */
+    int notsock;        /* Whether fd is not a socket, so the I/O falls back to syscalls */
+} _uring_fd_data_t;
+
+/*
+ * The completion-based read or write request, on the stack of the thread
+ * which is parked until the CQE arrives.
+ */
+typedef struct _st_uring_req {
+    _st_thread_t *thread;
+    int res;
+    int done;
+} _st_uring_req_t;
+
+static __thread struct _st_uringdata {
+    _uring_fd_data_t *fd_data;
+    int *fired;
+    int fd_data_size;
+    int ring_fd;
+    /* The SQ ring, SQEs are published to kernel when dispatching. */
+    void *sq_ring;
+    size_t sq_ring_sz;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned sq_entries;
+    unsigned sq_local_tail;
+    struct io_uring_sqe *sqes;
+    size_t sqes_sz;
+    /* The CQ ring, might share the same mmap with SQ ring. */
+    void *cq_ring;
+    size_t cq_ring_sz;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    unsigned cq_entries;
+    struct io_uring_cqe *cqes;
+    /* The timeout for the wait, must be valid until submitted. */
+    struct __kernel_timespec ts;
+    /* The registered buffers, for READ_FIXED and WRITE_FIXED. */
+    struct iovec *bufs;
+    int nr_bufs;
+} *_st_uring_data;
+
+#ifndef ST_URING_ENTRIES
+    /* Not a limit, the SQ is flushed when full */
+    #define ST_URING_ENTRIES 1024
+#endif
+
+/* The user_data of internal SQEs, such as POLL_REMOVE and TIMEOUT, whose CQE is ignored. */
+#define _ST_URING_UD_INTERNAL    (1ULL << 63)
+/* The user_data of read or write requests, with the address of _st_uring_req_t. */
+#define _ST_URING_UD_REQ         (1ULL << 62)
+#define _ST_URING_UD(fd, gen)    ((((unsigned long long)(gen) & 0x3fffffff) << 32) | (unsigned int)(fd))
+
+#define _ST_URING_READ_CNT(fd)   (_st_uring_data->fd_data[fd].rd_ref_cnt)
+#define _ST_URING_WRITE_CNT(fd)  (_st_uring_data->fd_data[fd].wr_ref_cnt)
+#define _ST_URING_EXCEP_CNT(fd)  (_st_uring_data->fd_data[fd].ex_ref_cnt)
+#define _ST_URING_REVENTS(fd)    (_st_uring_data->fd_data[fd].revents)
+#define _ST_URING_ARMED(fd)      (_st_uring_data->fd_data[fd].armed)
+#define _ST_URING_GEN(fd)        (_st_uring_data->fd_data[fd].gen)
+#define _ST_URING_IO_CNT(fd)     (_st_uring_data->fd_data[fd].io_ref_cnt)
+
+#define _ST_URING_READ_BIT(fd)   (_ST_URING_READ_CNT(fd) ? POLLIN : 0)
+#define _ST_URING_WRITE_BIT(fd)  (_ST_URING_WRITE_CNT(fd) ? POLLOUT : 0)
+#define _ST_URING_EXCEP_BIT(fd)  (_ST_URING_EXCEP_CNT(fd) ? POLLPRI : 0)
+#define _ST_URING_EVENTS(fd) \
+    (_ST_URING_READ_BIT(fd)|_ST_URING_WRITE_BIT(fd)|_ST_URING_EXCEP_BIT(fd))
+
+#endif  /* MD_HAVE_IO_URING */
+
 __thread _st_eventsys_t *_st_eventsys = NULL;
 
 
@@ -1230,6 +1321,665 @@ static _st_eventsys_t _st_epoll_eventsys = {
 #endif  /* MD_HAVE_EPOLL */
 
 
+#ifdef MD_HAVE_IO_URING
+/*****************************************
+ * io_uring event system
+ *
+ * Each descriptor has at most one outstanding one-shot IORING_OP_POLL_ADD,
+ * just like the interest set of epoll. The SQEs are queued in the ring and
+ * submitted in batch by the io_uring_enter(2) which also waits for the CQEs,
+ * so there is only one syscall for each scheduler loop.
+ *
+ * The socket I/O, see _st_uring_io(), is also submitted as SQEs such as
+ * IORING_OP_RECV and IORING_OP_SENDMSG, and the thread is parked until the
+ * CQE arrives, so there is no read(2) or write(2) syscall for each call.
+ */
+ST_HIDDEN int _st_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+ST_HIDDEN int _st_uring_enter(unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int) syscall(__NR_io_uring_enter, _st_uring_data->ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+ST_HIDDEN unsigned _st_uring_sq_pending(void)
+{
+    return _st_uring_data->sq_local_tail - __atomic_load_n(_st_uring_data->sq_head, __ATOMIC_ACQUIRE);
+}
+
+ST_HIDDEN void _st_uring_sq_publish(void)
+{
+    __atomic_store_n(_st_uring_data->sq_tail, _st_uring_data->sq_local_tail, __ATOMIC_RELEASE);
+}
+
+ST_HIDDEN int _st_uring_init(void)
+{
+    struct io_uring_params p;
+    int err = 0;
+    int rv = 0;
+    unsigned i;
+
+    _st_uring_data = (struct _st_uringdata *) calloc(1, sizeof(*_st_uring_data));
+    if (!_st_uring_data)
+        return -1;
+
+    memset(&p, 0, sizeof(p));
+    _st_uring_data->sq_ring = _st_uring_data->cq_ring = _st_uring_data->sqes = MAP_FAILED;
+    if ((_st_uring_data->ring_fd = _st_uring_setup(ST_URING_ENTRIES, &p)) < 0) {
+        err = errno;
+        rv = -1;
+        goto cleanup_uring;
+    }
+    fcntl(_st_uring_data->ring_fd, F_SETFD, FD_CLOEXEC);
+
+    /* Map the SQ and CQ rings, which share one mmap for kernel 5.4+ */
+    _st_uring_data->sq_ring_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    _st_uring_data->cq_ring_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if ((p.features & IORING_FEAT_SINGLE_MMAP) && _st_uring_data->cq_ring_sz > _st_uring_data->sq_ring_sz)
+        _st_uring_data->sq_ring_sz = _st_uring_data->cq_ring_sz;
+
+    _st_uring_data->sq_ring = mmap(NULL, _st_uring_data->sq_ring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        _st_uring_data->ring_fd, IORING_OFF_SQ_RING);
+    if (_st_uring_data->sq_ring == MAP_FAILED) {
+        err = errno;
+        rv = -1;
+        goto cleanup_uring;
+    }
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        _st_uring_data->cq_ring = _st_uring_data->sq_ring;
+    } else {
+        _st_uring_data->cq_ring = mmap(NULL, _st_uring_data->cq_ring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            _st_uring_data->ring_fd, IORING_OFF_CQ_RING);
+        if (_st_uring_data->cq_ring == MAP_FAILED) {
+            err = errno;
+            rv = -1;
+            goto cleanup_uring;
+        }
+    }
+
+    _st_uring_data->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+    _st_uring_data->sqes = (struct io_uring_sqe *)mmap(NULL, _st_uring_data->sqes_sz, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, _st_uring_data->ring_fd, IORING_OFF_SQES);
+    if (_st_uring_data->sqes == MAP_FAILED) {
+        err = errno;
+        rv = -1;
+        goto cleanup_uring;
+    }
+
+    _st_uring_data->sq_head = (unsigned *)((char *)_st_uring_data->sq_ring + p.sq_off.head);
+    _st_uring_data->sq_tail = (unsigned *)((char *)_st_uring_data->sq_ring + p.sq_off.tail);
+    _st_uring_data->sq_mask = (unsigned *)((char *)_st_uring_data->sq_ring + p.sq_off.ring_mask);
+    _st_uring_data->sq_array = (unsigned *)((char *)_st_uring_data->sq_ring + p.sq_off.array);
+    _st_uring_data->sq_entries = p.sq_entries;
+    _st_uring_data->sq_local_tail = *_st_uring_data->sq_tail;
+
+    _st_uring_data->cq_head = (unsigned *)((char *)_st_uring_data->cq_ring + p.cq_off.head);
+    _st_uring_data->cq_tail = (unsigned *)((char *)_st_uring_data->cq_ring + p.cq_off.tail);
+    _st_uring_data->cq_mask = (unsigned *)((char *)_st_uring_data->cq_ring + p.cq_off.ring_mask);
+    _st_uring_data->cqes = (struct io_uring_cqe *)((char *)_st_uring_data->cq_ring + p.cq_off.cqes);
+    _st_uring_data->cq_entries = p.cq_entries;
+
+    /* The SQ array is an identity map, we never reorder the SQEs. */
+    for (i = 0; i < p.sq_entries; i++)
+        _st_uring_data->sq_array[i] = i;
+
+    /* Allocate file descriptor data array */
+    _st_uring_data->fd_data_size = st_getfdlimit();
+    if (_st_uring_data->fd_data_size <= 0 || _st_uring_data->fd_data_size > ST_EPOLL_EVTLIST_SIZE)
+        _st_uring_data->fd_data_size = ST_EPOLL_EVTLIST_SIZE;
+    _st_uring_data->fd_data = (_uring_fd_data_t *)calloc(_st_uring_data->fd_data_size, sizeof(_uring_fd_data_t));
+    if (!_st_uring_data->fd_data) {
+        err = errno;
+        rv = -1;
+        goto cleanup_uring;
+    }
+
+    /* At most cq_entries CQEs are reaped for each dispatch. */
+    _st_uring_data->fired = (int *)malloc(_st_uring_data->cq_entries * sizeof(int));
+    if (!_st_uring_data->fired) {
+        err = errno;
+        rv = -1;
+    }
+
+ cleanup_uring:
+    if (rv < 0) {
+        if (_st_uring_data->sqes != MAP_FAILED)
+            munmap(_st_uring_data->sqes, _st_uring_data->sqes_sz);
+        if (_st_uring_data->cq_ring != MAP_FAILED && _st_uring_data->cq_ring != _st_uring_data->sq_ring)
+            munmap(_st_uring_data->cq_ring, _st_uring_data->cq_ring_sz);
+        if (_st_uring_data->sq_ring != MAP_FAILED)
+            munmap(_st_uring_data->sq_ring, _st_uring_data->sq_ring_sz);
+        if (_st_uring_data->ring_fd >= 0)
+            close(_st_uring_data->ring_fd);
+        free(_st_uring_data->fd_data);
+        free(_st_uring_data->fired);
+        free(_st_uring_data);
+        _st_uring_data = NULL;
+        errno = err;
+    }
+
+    return rv;
+}
+
+ST_HIDDEN int _st_uring_fd_data_expand(int maxfd)
+{
+    _uring_fd_data_t *ptr;
+    int n = _st_uring_data->fd_data_size;
+
+    while (maxfd >= n)
+        n <<= 1;
+
+    ptr = (_uring_fd_data_t *)realloc(_st_uring_data->fd_data, n * sizeof(_uring_fd_data_t));
+    if (!ptr)
+        return -1;
+
+    memset(ptr + _st_uring_data->fd_data_size, 0, (n - _st_uring_data->fd_data_size) * sizeof(_uring_fd_data_t));
+
+    _st_uring_data->fd_data = ptr;
+    _st_uring_data->fd_data_size = n;
+
+    return 0;
+}
+
+/*
+ * Get a free SQE, submit the queued SQEs to kernel if the SQ ring is full.
+ */
+ST_HIDDEN struct io_uring_sqe *_st_uring_get_sqe(void)
+{
+    struct io_uring_sqe *sqe;
+
+    if (_st_uring_sq_pending() >= _st_uring_data->sq_entries) {
+        _st_uring_sq_publish();
+        if (_st_uring_enter(_st_uring_sq_pending(), 0, 0) < 0 && _st_uring_sq_pending() >= _st_uring_data->sq_entries)
+            return NULL;
+    }
+
+    sqe = &_st_uring_data->sqes[_st_uring_data->sq_local_tail & *_st_uring_data->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    _st_uring_data->sq_local_tail++;
+
+    return sqe;
+}
+
+/*
+ * Make the outstanding POLL_ADD of fd match its interest set, which is the
+ * equivalent of epoll_ctl(2) with EPOLL_CTL_ADD, EPOLL_CTL_MOD or EPOLL_CTL_DEL.
+ */
+ST_HIDDEN int _st_uring_arm(int fd)
+{
+    struct io_uring_sqe *sqe;
+    int events = _ST_URING_EVENTS(fd);
+
+    if (events == _ST_URING_ARMED(fd))
+        return 0;
+
+    /* The poll holds a reference of the file, so we must cancel it even if fd is closing. */
+    if (_ST_URING_ARMED(fd)) {
+        if ((sqe = _st_uring_get_sqe()) == NULL)
+            return -1;
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = _ST_URING_UD(fd, _ST_URING_GEN(fd));
+        sqe->user_data = _ST_URING_UD_INTERNAL;
+        _ST_URING_ARMED(fd) = 0;
+    }
+
+    if (events) {
+        if ((sqe = _st_uring_get_sqe()) == NULL)
+            return -1;
+        _ST_URING_GEN(fd)++;
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll32_events = events;
+        sqe->user_data = _ST_URING_UD(fd, _ST_URING_GEN(fd));
+        _ST_URING_ARMED(fd) = events;
+    }
+
+    return 0;
+}
+
+ST_HIDDEN void _st_uring_pollset_del(struct pollfd *pds, int npds)
+{
+    struct pollfd *pd;
+    struct pollfd *epd = pds + npds;
+
+    for (pd = pds; pd < epd; pd++) {
+        if (pd->events & POLLIN)
+            _ST_URING_READ_CNT(pd->fd)--;
+        if (pd->events & POLLOUT)
+            _ST_URING_WRITE_CNT(pd->fd)--;
+        if (pd->events & POLLPRI)
+            _ST_URING_EXCEP_CNT(pd->fd)--;
+
+        /*
+         * The fired descriptors are re-armed at the end of dispatch(), see
+         * the comments in _st_epoll_pollset_del().
+         */
+        if (_ST_URING_REVENTS(pd->fd) == 0)
+            _st_uring_arm(pd->fd);
+    }
+}
+
+ST_HIDDEN int _st_uring_pollset_add(struct pollfd *pds, int npds)
+{
+    int i, fd;
+
+    /* Do as many checks as possible up front */
+    for (i = 0; i < npds; i++) {
+        fd = pds[i].fd;
+        if (fd < 0 || !pds[i].events ||
+            (pds[i].events & ~(POLLIN | POLLOUT | POLLPRI))) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (fd >= _st_uring_data->fd_data_size && _st_uring_fd_data_expand(fd) < 0)
+            return -1;
+    }
+
+    for (i = 0; i < npds; i++) {
+        fd = pds[i].fd;
+
+        if (pds[i].events & POLLIN)
+            _ST_URING_READ_CNT(fd)++;
+        if (pds[i].events & POLLOUT)
+            _ST_URING_WRITE_CNT(fd)++;
+        if (pds[i].events & POLLPRI)
+            _ST_URING_EXCEP_CNT(fd)++;
+
+        if (_st_uring_arm(fd) < 0)
+            break;
+    }
+
+    if (i < npds) {
+        /* Error */
+        int err = errno;
+        /* Unroll the state */
+        _st_uring_pollset_del(pds, i + 1);
+        errno = err;
+        return -1;
+    }
+
+    return 0;
+}
+
+ST_HIDDEN void _st_uring_dispatch(void)
+{
+    st_utime_t min_timeout;
+    _st_clist_t *q;
+    _st_pollq_t *pq;
+    struct pollfd *pds, *epds;
+    struct io_uring_sqe *sqe;
+    struct io_uring_cqe *cqe;
+    unsigned head, tail;
+    unsigned long long ud;
+    _st_uring_req_t *req;
+    int timeout, nfd, nreq, i, osfd, notify;
+    int events;
+    short revents;
+
+    #if defined(DEBUG) && defined(DEBUG_STATS)
+    ++_st_stat_epoll;
+    #endif
+
+    if (_ST_SLEEPQ == NULL) {
+        timeout = -1;
+    } else {
+        min_timeout = (_ST_SLEEPQ->due <= _ST_LAST_CLOCK) ? 0 : (_ST_SLEEPQ->due - _ST_LAST_CLOCK);
+        timeout = (int) (min_timeout / 1000);
+
+        // At least wait 1ms when <1ms, to avoid io_uring_enter spin loop.
+        if (timeout == 0) {
+            #if defined(DEBUG) && defined(DEBUG_STATS)
+            ++_st_stat_epoll_zero;
+            #endif
+
+            if (min_timeout > 0) {
+                #if defined(DEBUG) && defined(DEBUG_STATS)
+                ++_st_stat_epoll_shake;
+                #endif
+
+                timeout = 1;
+            }
+        }
+    }
+
+    /*
+     * Submit all queued SQEs and wait for I/O operations in one syscall. The
+     * TIMEOUT completes when any other CQE is posted, so it never lingers.
+     */
+    head = *_st_uring_data->cq_head;
+    tail = __atomic_load_n(_st_uring_data->cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail && timeout != 0) {
+        if (timeout > 0 && (sqe = _st_uring_get_sqe()) != NULL) {
+            _st_uring_data->ts.tv_sec = timeout / 1000;
+            _st_uring_data->ts.tv_nsec = (long long)(timeout % 1000) * 1000000;
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->fd = -1;
+            sqe->addr = (unsigned long long)(uintptr_t)&_st_uring_data->ts;
+            sqe->len = 1;
+            sqe->off = 1;
+            sqe->user_data = _ST_URING_UD_INTERNAL;
+        }
+        _st_uring_sq_publish();
+        _st_uring_enter(_st_uring_sq_pending(), 1, IORING_ENTER_GETEVENTS);
+    } else if (_st_uring_sq_pending() > 0) {
+        _st_uring_sq_publish();
+        _st_uring_enter(_st_uring_sq_pending(), 0, 0);
+    }
+
+    /* Reap the CQEs, ignore the internal and stale ones. */
+    nfd = nreq = 0;
+    head = *_st_uring_data->cq_head;
+    tail = __atomic_load_n(_st_uring_data->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail && nfd < (int)_st_uring_data->cq_entries; head++) {
+        cqe = &_st_uring_data->cqes[head & *_st_uring_data->cq_mask];
+        ud = cqe->user_data;
+        if (ud & _ST_URING_UD_INTERNAL)
+            continue;
+
+        /* The read or write is done, wake up the thread unless it's already interrupted or timeout. */
+        if (ud & _ST_URING_UD_REQ) {
+            req = (_st_uring_req_t *)(uintptr_t)(ud & ~_ST_URING_UD_REQ);
+            req->res = cqe->res;
+            req->done = 1;
+            if (req->thread->state == _ST_ST_IO_WAIT) {
+                if (req->thread->flags & _ST_FL_ON_SLEEPQ)
+                    _ST_DEL_SLEEPQ(req->thread);
+                req->thread->state = _ST_ST_RUNNABLE;
+                _ST_ADD_RUNQ(req->thread);
+            }
+            nreq++;
+            continue;
+        }
+
+        osfd = (int)(ud & 0xffffffff);
+        if (osfd >= _st_uring_data->fd_data_size || !_ST_URING_ARMED(osfd) || ud != _ST_URING_UD(osfd, _ST_URING_GEN(osfd)))
+            continue;
+
+        /* The one-shot poll is done, so it's disarmed, and errors such as EBADF wake up the waiting threads. */
+        _ST_URING_ARMED(osfd) = 0;
+        _ST_URING_REVENTS(osfd) = (cqe->res < 0) ? POLLERR : cqe->res;
+        if (_ST_URING_REVENTS(osfd) & (POLLERR | POLLHUP)) {
+            /* Also set I/O bits on error */
+            _ST_URING_REVENTS(osfd) |= _ST_URING_EVENTS(osfd);
+        }
+        _st_uring_data->fired[nfd++] = osfd;
+    }
+    __atomic_store_n(_st_uring_data->cq_head, head, __ATOMIC_RELEASE);
+
+    #if defined(DEBUG) && defined(DEBUG_STATS)
+    if (nfd <= 0 && nreq <= 0) {
+        ++_st_stat_epoll_spin;
+    }
+    #endif
+
+    if (nfd > 0) {
+        for (q = _ST_IOQ.next; q != &_ST_IOQ; q = q->next) {
+            pq = _ST_POLLQUEUE_PTR(q);
+            notify = 0;
+            epds = pq->pds + pq->npds;
+
+            for (pds = pq->pds; pds < epds; pds++) {
+                if (_ST_URING_REVENTS(pds->fd) == 0) {
+                    pds->revents = 0;
+                    continue;
+                }
+                osfd = pds->fd;
+                events = pds->events;
+                revents = 0;
+                if ((events & POLLIN) && (_ST_URING_REVENTS(osfd) & POLLIN))
+                    revents |= POLLIN;
+                if ((events & POLLOUT) && (_ST_URING_REVENTS(osfd) & POLLOUT))
+                    revents |= POLLOUT;
+                if ((events & POLLPRI) && (_ST_URING_REVENTS(osfd) & POLLPRI))
+                    revents |= POLLPRI;
+                if (_ST_URING_REVENTS(osfd) & POLLERR)
+                    revents |= POLLERR;
+                if (_ST_URING_REVENTS(osfd) & POLLHUP)
+                    revents |= POLLHUP;
+
+                pds->revents = revents;
+                if (revents) {
+                    notify = 1;
+                }
+            }
+            if (notify) {
+                ST_REMOVE_LINK(&pq->links);
+                pq->on_ioq = 0;
+                /*
+                 * Here we will only delete/modify descriptors that
+                 * didn't fire (see comments in _st_epoll_pollset_del()).
+                 */
+                _st_uring_pollset_del(pq->pds, pq->npds);
+
+                if (pq->thread->flags & _ST_FL_ON_SLEEPQ)
+                    _ST_DEL_SLEEPQ(pq->thread);
+                pq->thread->state = _ST_ST_RUNNABLE;
+                _ST_ADD_RUNQ(pq->thread);
+            }
+        }
+
+        for (i = 0; i < nfd; i++) {
+            /* Re-arm descriptors that fired, submitted by next dispatch */
+            osfd = _st_uring_data->fired[i];
+            _ST_URING_REVENTS(osfd) = 0;
+            _st_uring_arm(osfd);
+        }
+    }
+}
+
+ST_HIDDEN int _st_uring_fd_new(int osfd)
+{
+    if (osfd >= _st_uring_data->fd_data_size && _st_uring_fd_data_expand(osfd) < 0)
+        return -1;
+
+    _st_uring_data->fd_data[osfd].notsock = 0;
+
+    return 0;
+}
+
+ST_HIDDEN int _st_uring_fd_close(int osfd)
+{
+    if (_ST_URING_READ_CNT(osfd) || _ST_URING_WRITE_CNT(osfd) || _ST_URING_EXCEP_CNT(osfd) || _ST_URING_IO_CNT(osfd)) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    return 0;
+}
+
+ST_HIDDEN int _st_uring_fd_getlimit(void)
+{
+    /* zero means no specific limit */
+    return 0;
+}
+
+/*
+ * Check if io_uring is available, it might be disabled by kernel.io_uring_disabled
+ * or seccomp, and we require IORING_FEAT_NODROP(kernel 5.5+) to never lose a CQE.
+ */
+ST_HIDDEN int _st_uring_is_supported(void)
+{
+    struct io_uring_params p;
+    int fd;
+
+    memset(&p, 0, sizeof(p));
+    if ((fd = _st_uring_setup(1, &p)) < 0)
+        return 0;
+    close(fd);
+
+    return (p.features & IORING_FEAT_NODROP) != 0;
+}
+
+ST_HIDDEN void _st_uring_destroy(void)
+{
+    munmap(_st_uring_data->sqes, _st_uring_data->sqes_sz);
+    if (_st_uring_data->cq_ring != _st_uring_data->sq_ring)
+        munmap(_st_uring_data->cq_ring, _st_uring_data->cq_ring_sz);
+    munmap(_st_uring_data->sq_ring, _st_uring_data->sq_ring_sz);
+    if (_st_uring_data->ring_fd >= 0) {
+        close(_st_uring_data->ring_fd);
+    }
+    free(_st_uring_data->fd_data);
+    free(_st_uring_data->fired);
+    free(_st_uring_data->bufs);
+    free(_st_uring_data);
+    _st_uring_data = NULL;
+}
+
+static _st_eventsys_t _st_uring_eventsys = {
+    "io_uring",
+    ST_EVENTSYS_ALT,
+    _st_uring_init,
+    _st_uring_dispatch,
+    _st_uring_pollset_add,
+    _st_uring_pollset_del,
+    _st_uring_fd_new,
+    _st_uring_fd_close,
+    _st_uring_fd_getlimit,
+    _st_uring_destroy
+};
+
+int _st_uring_io_enabled(int osfd)
+{
+    if (_st_eventsys != &_st_uring_eventsys)
+        return 0;
+
+    return osfd >= _st_uring_data->fd_data_size || !_st_uring_data->fd_data[osfd].notsock;
+}
+
+/*
+ * Get the index of the registered buffer which contains [addr, addr+len), or -1.
+ */
+ST_HIDDEN int _st_uring_find_buf(void *addr, size_t len)
+{
+    char *p = (char *)addr;
+    char *base;
+    int i;
+
+    for (i = 0; i < _st_uring_data->nr_bufs; i++) {
+        base = (char *)_st_uring_data->bufs[i].iov_base;
+        if (p >= base && p + len <= base + _st_uring_data->bufs[i].iov_len)
+            return i;
+    }
+
+    return -1;
+}
+
+/*
+ * Submit the socket I/O as a SQE and park the thread until its CQE arrives,
+ * which is the completion-based equivalent of the syscall and st_netfd_poll()
+ * loop. The op is one of _ST_URING_OP_RECV, _ST_URING_OP_SEND with addr and
+ * len of the buffer, or _ST_URING_OP_RECVMSG, _ST_URING_OP_SENDMSG with addr
+ * of the msghdr. The buffer in the registered buffers is read or written by
+ * IORING_OP_READ_FIXED or IORING_OP_WRITE_FIXED.
+ *
+ * Return _ST_URING_FALLBACK if fd is not a socket or no SQE, then the caller
+ * should use the syscall instead.
+ */
+ssize_t _st_uring_io(_st_netfd_t *fd, int op, void *addr, size_t len, int flags, st_utime_t timeout)
+{
+    _st_thread_t *me = _ST_CURRENT_THREAD();
+    struct io_uring_sqe *sqe;
+    _st_uring_req_t req;
+    int osfd = fd->osfd;
+    int buf_index;
+
+    if (me->flags & _ST_FL_INTERRUPT) {
+        me->flags &= ~_ST_FL_INTERRUPT;
+        errno = EINTR;
+        return -1;
+    }
+
+    if (osfd >= _st_uring_data->fd_data_size && _st_uring_fd_data_expand(osfd) < 0)
+        return _ST_URING_FALLBACK;
+
+    while (1) {
+        if ((sqe = _st_uring_get_sqe()) == NULL)
+            return _ST_URING_FALLBACK;
+
+        buf_index = (op == _ST_URING_OP_RECV || op == _ST_URING_OP_SEND) ? _st_uring_find_buf(addr, len) : -1;
+        if (buf_index >= 0) {
+            /* The fixed buffer is only for read(2) and write(2), at the current offset. */
+            sqe->opcode = (op == _ST_URING_OP_RECV) ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+            sqe->off = (unsigned long long)-1;
+            sqe->buf_index = buf_index;
+        } else {
+            switch (op) {
+                case _ST_URING_OP_RECV: sqe->opcode = IORING_OP_RECV; break;
+                case _ST_URING_OP_SEND: sqe->opcode = IORING_OP_SEND; break;
+                case _ST_URING_OP_RECVMSG: sqe->opcode = IORING_OP_RECVMSG; len = 1; break;
+                default: sqe->opcode = IORING_OP_SENDMSG; len = 1; break;
+            }
+            sqe->msg_flags = flags;
+        }
+        sqe->fd = osfd;
+        sqe->addr = (unsigned long long)(uintptr_t)addr;
+        sqe->len = (unsigned)len;
+
+        req.thread = me;
+        req.res = 0;
+        req.done = 0;
+        sqe->user_data = _ST_URING_UD_REQ | (unsigned long long)(uintptr_t)&req;
+
+        /* Submitted by next dispatch, in batch with other SQEs. */
+        _ST_URING_IO_CNT(osfd)++;
+        if (timeout != ST_UTIME_NO_TIMEOUT)
+            _ST_ADD_SLEEPQ(me, timeout);
+        me->state = _ST_ST_IO_WAIT;
+        _ST_SWITCH_CONTEXT(me);
+
+        /*
+         * Interrupted or timeout, cancel the request, and we must wait for the
+         * CQE because the kernel writes the req on the stack.
+         */
+        if (!req.done && (sqe = _st_uring_get_sqe()) != NULL) {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = _ST_URING_UD_REQ | (unsigned long long)(uintptr_t)&req;
+            sqe->user_data = _ST_URING_UD_INTERNAL;
+        }
+        while (!req.done) {
+            me->state = _ST_ST_IO_WAIT;
+            _ST_SWITCH_CONTEXT(me);
+        }
+        _ST_URING_IO_CNT(osfd)--;
+
+        /* The data is never lost even if interrupted, and the next call returns EINTR. */
+        if (req.res >= 0)
+            return req.res;
+
+        if (req.res == -ECANCELED || req.res == -EINTR) {
+            if (me->flags & _ST_FL_INTERRUPT) {
+                me->flags &= ~_ST_FL_INTERRUPT;
+                errno = EINTR;
+            } else {
+                errno = ETIME;
+            }
+            return -1;
+        }
+
+        if (req.res == -ENOTSOCK) {
+            _st_uring_data->fd_data[osfd].notsock = 1;
+            return _ST_URING_FALLBACK;
+        }
+
+        if (req.res != -EAGAIN) {
+            errno = -req.res;
+            return -1;
+        }
+
+        /* The fixed buffer of the O_NONBLOCK fd is not ready, wait and retry. */
+        if (st_netfd_poll(fd, (op == _ST_URING_OP_RECV || op == _ST_URING_OP_RECVMSG) ? POLLIN : POLLOUT, timeout) < 0)
+            return -1;
+    }
+}
+#endif  /* MD_HAVE_IO_URING */
+
+
 /*****************************************
  * Public functions
  */
@@ -1253,6 +2003,13 @@ int st_set_eventsys(int eventsys)
         _st_eventsys = &_st_kq_eventsys;
         return 0;
 #elif defined (MD_HAVE_EPOLL)
+    #if defined (MD_HAVE_IO_URING)
+        /* Prefer io_uring if kernel supports it, fallback to epoll. */
+        if (_st_uring_is_supported()) {
+            _st_eventsys = &_st_uring_eventsys;
+            return 0;
+        }
+    #endif
         if (_st_epoll_is_supported()) {
             _st_eventsys = &_st_epoll_eventsys;
             return 0;
@@ -1264,6 +2021,53 @@ int st_set_eventsys(int eventsys)
     return -1;
 }
 
+int st_uring_register_buffers(const struct iovec *iovs, int nr)
+{
+#if defined (MD_HAVE_IO_URING)
+    struct iovec *bufs = NULL;
+
+    if (_st_eventsys != &_st_uring_eventsys || !_st_uring_data) {
+        errno = ENOSYS;
+        return -1;
+    }
+
+    if (nr < 0 || (nr > 0 && !iovs)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* The kernel fails with EBUSY if there are registered buffers. */
+    if (_st_uring_data->nr_bufs > 0) {
+        if (syscall(__NR_io_uring_register, _st_uring_data->ring_fd, IORING_UNREGISTER_BUFFERS, NULL, 0) < 0)
+            return -1;
+        free(_st_uring_data->bufs);
+        _st_uring_data->bufs = NULL;
+        _st_uring_data->nr_bufs = 0;
+    }
+
+    if (nr == 0)
+        return 0;
+
+    if ((bufs = (struct iovec *)malloc(nr * sizeof(struct iovec))) == NULL)
+        return -1;
+    memcpy(bufs, iovs, nr * sizeof(struct iovec));
+
+    if (syscall(__NR_io_uring_register, _st_uring_data->ring_fd, IORING_REGISTER_BUFFERS, bufs, nr) < 0) {
+        int err = errno;
+        free(bufs);
+        errno = err;
+        return -1;
+    }
+
+    _st_uring_data->bufs = bufs;
+    _st_uring_data->nr_bufs = nr;
+    return 0;
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
 int st_get_eventsys(void)
 {
     return _st_eventsys ? _st_eventsys->val : -1;
@@ -52,6 +52,7 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <errno.h>
+#include <string.h>
 #include "common.h"
 
 // Global stat.
@@ -78,6 +79,45 @@ __thread unsigned long long _st_stat_sendmsg_eagain = 0;
     #define _IO_NOT_READY_ERROR  (errno == EAGAIN)
 #endif
 
+#ifdef MD_HAVE_IO_URING
+/*
+ * Receive or send the iov by io_uring, op is _ST_URING_OP_RECV or _ST_URING_OP_SEND.
+ * Return _ST_URING_FALLBACK if the syscall should be used.
+ */
+static ssize_t _st_uring_iov(_st_netfd_t *fd, int op, const struct iovec *iov, int iov_size, st_utime_t timeout)
+{
+    struct msghdr msg;
+
+    if (!_st_uring_io_enabled(fd->osfd))
+        return _ST_URING_FALLBACK;
+
+    if (iov_size == 1)
+        return _st_uring_io(fd, op, iov->iov_base, iov->iov_len, 0, timeout);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (struct iovec *)iov;
+    msg.msg_iovlen = iov_size;
+    op = (op == _ST_URING_OP_RECV) ? _ST_URING_OP_RECVMSG : _ST_URING_OP_SENDMSG;
+    return _st_uring_io(fd, op, &msg, 0, 0, timeout);
+}
+
+/* Skip the n bytes done of the iov. */
+static void _st_iov_advance(struct iovec **iov, int *iov_size, size_t n)
+{
+    while (*iov_size > 0 && n >= (*iov)->iov_len) {
+        n -= (*iov)->iov_len;
+        (*iov)->iov_base = (char *) (*iov)->iov_base + (*iov)->iov_len;
+        (*iov)->iov_len = 0;
+        (*iov)++;
+        (*iov_size)--;
+    }
+    if (*iov_size > 0) {
+        (*iov)->iov_base = (char *) (*iov)->iov_base + n;
+        (*iov)->iov_len -= n;
+    }
+}
+#endif
+
 #define _LOCAL_MAXIOV  16
 
 /* File descriptor object free list */
@@ -353,6 +393,11 @@ ssize_t st_read(_st_netfd_t *fd, void *buf, size_t nbyte, st_utime_t timeout)
     #if defined(DEBUG) && defined(DEBUG_STATS)
     ++_st_stat_read;
     #endif
+
+    #ifdef MD_HAVE_IO_URING
+    if (_st_uring_io_enabled(fd->osfd) && (n = _st_uring_io(fd, _ST_URING_OP_RECV, buf, nbyte, 0, timeout)) != _ST_URING_FALLBACK)
+        return n;
+    #endif
     
     while ((n = read(fd->osfd, buf, nbyte)) < 0) {
         if (errno == EINTR)
@@ -395,6 +440,11 @@ ssize_t st_readv(_st_netfd_t *fd, const struct iovec *iov, int iov_size, st_utim
     #if defined(DEBUG) && defined(DEBUG_STATS)
     ++_st_stat_readv;
     #endif
+
+    #ifdef MD_HAVE_IO_URING
+    if ((n = _st_uring_iov(fd, _ST_URING_OP_RECV, iov, iov_size, timeout)) != _ST_URING_FALLBACK)
+        return n;
+    #endif
     
     while ((n = readv(fd->osfd, iov, iov_size)) < 0) {
         if (errno == EINTR)
@@ -419,6 +469,17 @@ int st_readv_resid(_st_netfd_t *fd, struct iovec **iov, int *iov_size, st_utime_
     ssize_t n;
     
     while (*iov_size > 0) {
+        #ifdef MD_HAVE_IO_URING
+        if ((n = _st_uring_iov(fd, _ST_URING_OP_RECV, *iov, *iov_size, timeout)) != _ST_URING_FALLBACK) {
+            if (n < 0)
+                return -1;
+            if (n == 0)
+                break;
+            _st_iov_advance(iov, iov_size, n);
+            continue;
+        }
+        #endif
+
         if (*iov_size == 1)
             n = read(fd->osfd, (*iov)->iov_base, (*iov)->iov_len);
         else
@@ -492,6 +553,9 @@ ssize_t st_writev(_st_netfd_t *fd, const struct iovec *iov, int iov_size, st_uti
     int index, iov_cnt;
     struct iovec *tmp_iov;
     struct iovec local_iov[_LOCAL_MAXIOV];
+    #ifdef MD_HAVE_IO_URING
+    struct iovec *riov;
+    #endif
     
     /* Calculate the total number of bytes to be sent */
     nbyte = 0;
@@ -503,6 +567,24 @@ ssize_t st_writev(_st_netfd_t *fd, const struct iovec *iov, int iov_size, st_uti
     tmp_iov = (struct iovec *) iov;    /* we promise not to modify iov */
     iov_cnt = iov_size;
 
+    #ifdef MD_HAVE_IO_URING
+    /* Send a copy of iov by st_writev_resid(), which modifies the iov. */
+    if (_st_uring_io_enabled(fd->osfd) && iov_size > 1) {
+        tmp_iov = (iov_size <= _LOCAL_MAXIOV) ? local_iov : calloc(iov_size, sizeof(struct iovec));
+        if (tmp_iov == NULL)
+            return -1;
+        memcpy(tmp_iov, iov, iov_size * sizeof(struct iovec));
+
+        riov = tmp_iov;
+        if (st_writev_resid(fd, &riov, &iov_cnt, timeout) < 0)
+            rv = -1;
+
+        if (tmp_iov != local_iov)
+            free(tmp_iov);
+        return rv;
+    }
+    #endif
+
     #if defined(DEBUG) && defined(DEBUG_STATS)
     ++_st_stat_writev;
     #endif
@@ -578,6 +660,15 @@ int st_writev_resid(_st_netfd_t *fd, struct iovec **iov, int *iov_size, st_utime
     #endif
     
     while (*iov_size > 0) {
+        #ifdef MD_HAVE_IO_URING
+        if ((n = _st_uring_iov(fd, _ST_URING_OP_SEND, *iov, *iov_size, timeout)) != _ST_URING_FALLBACK) {
+            if (n < 0)
+                return -1;
+            _st_iov_advance(iov, iov_size, n);
+            continue;
+        }
+        #endif
+
         if (*iov_size == 1)
             n = write(fd->osfd, (*iov)->iov_base, (*iov)->iov_len);
         else
@@ -627,6 +718,26 @@ int st_recvfrom(_st_netfd_t *fd, void *buf, int len, struct sockaddr *from, int
     ++_st_stat_recvfrom;
     #endif
 
+    #ifdef MD_HAVE_IO_URING
+    if (_st_uring_io_enabled(fd->osfd)) {
+        struct iovec iov;
+        struct msghdr msg;
+
+        iov.iov_base = buf;
+        iov.iov_len = len;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = from;
+        msg.msg_namelen = (from && fromlen) ? *fromlen : 0;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        if ((n = (int)_st_uring_io(fd, _ST_URING_OP_RECVMSG, &msg, 0, 0, timeout)) != _ST_URING_FALLBACK) {
+            if (n >= 0 && from && fromlen)
+                *fromlen = msg.msg_namelen;
+            return n;
+        }
+    }
+    #endif
+
     while ((n = recvfrom(fd->osfd, buf, len, 0, from, (socklen_t *)fromlen)) < 0) {
         if (errno == EINTR)
             continue;
@@ -653,6 +764,23 @@ int st_sendto(_st_netfd_t *fd, const void *msg, int len, const struct sockaddr *
     #if defined(DEBUG) && defined(DEBUG_STATS)
     ++_st_stat_sendto;
     #endif
+
+    #ifdef MD_HAVE_IO_URING
+    if (_st_uring_io_enabled(fd->osfd)) {
+        struct iovec iov;
+        struct msghdr hdr;
+
+        iov.iov_base = (void *)msg;
+        iov.iov_len = len;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_name = (void *)to;
+        hdr.msg_namelen = to ? tolen : 0;
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+        if ((n = (int)_st_uring_io(fd, _ST_URING_OP_SENDMSG, &hdr, 0, 0, timeout)) != _ST_URING_FALLBACK)
+            return n;
+    }
+    #endif
     
     while ((n = sendto(fd->osfd, msg, len, 0, to, tolen)) < 0) {
         if (errno == EINTR)
@@ -680,6 +808,11 @@ int st_recvmsg(_st_netfd_t *fd, struct msghdr *msg, int flags, st_utime_t timeou
     #if defined(DEBUG) && defined(DEBUG_STATS)
     ++_st_stat_recvmsg;
     #endif
+
+    #ifdef MD_HAVE_IO_URING
+    if (_st_uring_io_enabled(fd->osfd) && (n = (int)_st_uring_io(fd, _ST_URING_OP_RECVMSG, msg, 0, flags, timeout)) != _ST_URING_FALLBACK)
+        return n;
+    #endif
     
     while ((n = recvmsg(fd->osfd, msg, flags)) < 0) {
         if (errno == EINTR)
@@ -707,6 +840,11 @@ int st_sendmsg(_st_netfd_t *fd, const struct msghdr *msg, int flags, st_utime_t
     #if defined(DEBUG) && defined(DEBUG_STATS)
     ++_st_stat_sendmsg;
     #endif
+
+    #ifdef MD_HAVE_IO_URING
+    if (_st_uring_io_enabled(fd->osfd) && (n = (int)_st_uring_io(fd, _ST_URING_OP_SENDMSG, (void *)msg, 0, flags, timeout)) != _ST_URING_FALLBACK)
+        return n;
+    #endif
     
     while ((n = sendmsg(fd->osfd, msg, flags)) < 0) {
         if (errno == EINTR)
@@ -89,6 +89,8 @@ extern int st_getfdlimit(void);
 extern int st_set_eventsys(int eventsys);
 extern int st_get_eventsys(void);
 extern const char *st_get_eventsys_name(void);
+/* Register buffers for io_uring, nr is 0 to unregister, fail with ENOSYS if not io_uring. */
+extern int st_uring_register_buffers(const struct iovec *iovs, int nr);
 
 #ifdef ST_SWITCH_CB
 extern st_switch_cb_t st_set_switch_in_cb(st_switch_cb_t cb);
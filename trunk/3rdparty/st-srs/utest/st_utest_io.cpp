@@ -0,0 +1,274 @@
+/* SPDX-License-Identifier: MIT */
+/* Copyright (c) 2013-2024 The SRS Authors */
+
+#include <st_utest.hpp>
+
+#include <st.h>
+#include <string.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define ST_UTEST_IO_TIMEOUT (100 * SRS_UTIME_MILLISECONDS)
+
+// The socket pair for ST, to read or write in coroutines.
+class StSocketPair {
+public:
+    st_netfd_t fds[2];
+public:
+    StSocketPair(int type = SOCK_STREAM) {
+        int v[2] = {-1, -1};
+        fds[0] = fds[1] = NULL;
+        if (socketpair(AF_UNIX, type, 0, v) == 0) {
+            fds[0] = st_netfd_open_socket(v[0]);
+            fds[1] = st_netfd_open_socket(v[1]);
+        }
+    }
+    virtual ~StSocketPair() {
+        if (fds[0]) st_netfd_close(fds[0]);
+        if (fds[1]) st_netfd_close(fds[1]);
+    }
+};
+
+static bool st_utest_is_uring()
+{
+    return strcmp(st_get_eventsys_name(), "io_uring") == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The utest for read and write, by io_uring SQEs if enabled.
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void* io_writer(void* arg)
+{
+    st_netfd_t stfd = (st_netfd_t)arg;
+
+    // Make sure the reader is parked first.
+    st_usleep(10 * SRS_UTIME_MILLISECONDS);
+
+    ssize_t r0 = st_write(stfd, "Hello", 5, ST_UTEST_IO_TIMEOUT);
+    ST_ASSERT_ERROR(r0 != 5, (int)r0, "Write");
+
+    struct iovec iovs[3];
+    iovs[0].iov_base = (void*)"ST";
+    iovs[0].iov_len = 2;
+    iovs[1].iov_base = (void*)"-";
+    iovs[1].iov_len = 1;
+    iovs[2].iov_base = (void*)"SRS";
+    iovs[2].iov_len = 3;
+    r0 = st_writev(stfd, iovs, 3, ST_UTEST_IO_TIMEOUT);
+    ST_ASSERT_ERROR(r0 != 6, (int)r0, "Writev");
+
+    return NULL;
+}
+
+VOID TEST(IoTest, ReadWrite)
+{
+    StSocketPair pair;
+    ASSERT_TRUE(pair.fds[0] && pair.fds[1]);
+
+    st_thread_t trd = st_thread_create(io_writer, pair.fds[1], 1, 0);
+    EXPECT_TRUE(trd != NULL);
+
+    char buf[16];
+    EXPECT_EQ(5, st_read(pair.fds[0], buf, 5, ST_UTEST_IO_TIMEOUT));
+    EXPECT_EQ(0, memcmp(buf, "Hello", 5));
+
+    EXPECT_EQ(6, st_read_fully(pair.fds[0], buf, 6, ST_UTEST_IO_TIMEOUT));
+    EXPECT_EQ(0, memcmp(buf, "ST-SRS", 6));
+
+    ST_COROUTINE_JOIN(trd, r0);
+    ST_EXPECT_SUCCESS(r0);
+}
+
+VOID TEST(IoTest, ReadvAndWriteLarge)
+{
+    StSocketPair pair;
+    ASSERT_TRUE(pair.fds[0] && pair.fds[1]);
+
+    // Larger than the socket buffer, so the write completes in several parts.
+    const int size = 1024 * 1024;
+    char* data = new char[size];
+    SrsAutoFreeA(char, data);
+    for (int i = 0; i < size; i++) {
+        data[i] = (char)i;
+    }
+
+    struct Writer {
+        st_netfd_t stfd;
+        char* data;
+        int size;
+        static void* start(void* arg) {
+            Writer* w = (Writer*)arg;
+            ssize_t r0 = st_write(w->stfd, w->data, w->size, ST_UTIME_NO_TIMEOUT);
+            ST_ASSERT_ERROR(r0 != w->size, (int)r0, "Write large");
+            return NULL;
+        }
+    } w = {pair.fds[1], data, size};
+    st_thread_t trd = st_thread_create(Writer::start, &w, 1, 0);
+    EXPECT_TRUE(trd != NULL);
+
+    char* buf = new char[size];
+    SrsAutoFreeA(char, buf);
+
+    struct iovec iovs[2];
+    iovs[0].iov_base = buf;
+    iovs[0].iov_len = 7;
+    iovs[1].iov_base = buf + 7;
+    iovs[1].iov_len = size - 7;
+    struct iovec* riov = iovs;
+    int riov_size = 2;
+    EXPECT_EQ(0, st_readv_resid(pair.fds[0], &riov, &riov_size, ST_UTIME_NO_TIMEOUT));
+    EXPECT_EQ(0, riov_size);
+    EXPECT_EQ(0, memcmp(buf, data, size));
+
+    ST_COROUTINE_JOIN(trd, r0);
+    ST_EXPECT_SUCCESS(r0);
+}
+
+VOID TEST(IoTest, ReadTimeout)
+{
+    StSocketPair pair;
+    ASSERT_TRUE(pair.fds[0] && pair.fds[1]);
+
+    char buf[16];
+    EXPECT_EQ(-1, st_read(pair.fds[0], buf, sizeof(buf), 10 * SRS_UTIME_MILLISECONDS));
+    EXPECT_EQ(ETIME, errno);
+
+    // The fd is free to close, as the request is canceled.
+    EXPECT_EQ(0, st_netfd_close(pair.fds[0]));
+    pair.fds[0] = NULL;
+}
+
+void* io_reader(void* arg)
+{
+    st_netfd_t stfd = (st_netfd_t)arg;
+
+    char buf[16];
+    ssize_t r0 = st_read(stfd, buf, sizeof(buf), ST_UTIME_NO_TIMEOUT);
+    ST_ASSERT_ERROR(r0 != -1 || errno != EINTR, (int)r0, "Read should be interrupted");
+
+    return NULL;
+}
+
+VOID TEST(IoTest, ReadInterrupt)
+{
+    StSocketPair pair;
+    ASSERT_TRUE(pair.fds[0] && pair.fds[1]);
+
+    st_thread_t trd = st_thread_create(io_reader, pair.fds[0], 1, 0);
+    EXPECT_TRUE(trd != NULL);
+
+    st_usleep(10 * SRS_UTIME_MILLISECONDS);
+    st_thread_interrupt(trd);
+
+    ST_COROUTINE_JOIN(trd, r0);
+    ST_EXPECT_SUCCESS(r0);
+
+    // The data written after interrupted is not lost.
+    char buf[16];
+    EXPECT_EQ(3, st_write(pair.fds[1], "SRS", 3, ST_UTEST_IO_TIMEOUT));
+    EXPECT_EQ(3, st_read(pair.fds[0], buf, sizeof(buf), ST_UTEST_IO_TIMEOUT));
+}
+
+VOID TEST(IoTest, UdpSendtoRecvfrom)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_TRUE(fd > 0);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    addr.sin_port = 0;
+    ASSERT_EQ(0, ::bind(fd, (const sockaddr*)&addr, sizeof(addr)));
+
+    socklen_t addrlen = sizeof(addr);
+    ASSERT_EQ(0, getsockname(fd, (sockaddr*)&addr, &addrlen));
+
+    st_netfd_t stfd = st_netfd_open_socket(fd);
+    StFdCleanup(fd, stfd);
+    ASSERT_TRUE(stfd != NULL);
+
+    EXPECT_EQ(3, st_sendto(stfd, "SRS", 3, (const sockaddr*)&addr, sizeof(addr), ST_UTEST_IO_TIMEOUT));
+
+    char buf[16];
+    struct sockaddr_in from;
+    int fromlen = sizeof(from);
+    EXPECT_EQ(3, st_recvfrom(stfd, buf, sizeof(buf), (sockaddr*)&from, &fromlen, ST_UTEST_IO_TIMEOUT));
+    EXPECT_EQ((int)sizeof(from), fromlen);
+    EXPECT_EQ(addr.sin_port, from.sin_port);
+    EXPECT_EQ(0, memcmp(buf, "SRS", 3));
+
+    struct iovec iov;
+    iov.iov_base = (void*)"ST";
+    iov.iov_len = 2;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &addr;
+    msg.msg_namelen = sizeof(addr);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    EXPECT_EQ(2, st_sendmsg(stfd, &msg, 0, ST_UTEST_IO_TIMEOUT));
+
+    iov.iov_base = buf;
+    iov.iov_len = sizeof(buf);
+    msg.msg_name = NULL;
+    msg.msg_namelen = 0;
+    EXPECT_EQ(2, st_recvmsg(stfd, &msg, 0, ST_UTEST_IO_TIMEOUT));
+    EXPECT_EQ(0, memcmp(buf, "ST", 2));
+}
+
+VOID TEST(IoTest, PipeFallback)
+{
+    int v[2];
+    ASSERT_EQ(0, pipe(v));
+
+    st_netfd_t rfd = st_netfd_open(v[0]);
+    st_netfd_t wfd = st_netfd_open(v[1]);
+    StStfdCleanup(rfd);
+    StStfdCleanup(wfd);
+    ASSERT_TRUE(rfd && wfd);
+
+    // The pipe is not a socket, so it's done by syscalls even for io_uring.
+    char buf[16];
+    EXPECT_EQ(3, st_write(wfd, "SRS", 3, ST_UTEST_IO_TIMEOUT));
+    EXPECT_EQ(3, st_read(rfd, buf, sizeof(buf), ST_UTEST_IO_TIMEOUT));
+    EXPECT_EQ(0, memcmp(buf, "SRS", 3));
+
+    EXPECT_EQ(-1, st_read(rfd, buf, sizeof(buf), 10 * SRS_UTIME_MILLISECONDS));
+    EXPECT_EQ(ETIME, errno);
+}
+
+VOID TEST(IoTest, RegisteredBuffers)
+{
+    char bufs[2][64];
+    struct iovec iovs[2];
+    iovs[0].iov_base = bufs[0];
+    iovs[0].iov_len = sizeof(bufs[0]);
+    iovs[1].iov_base = bufs[1];
+    iovs[1].iov_len = sizeof(bufs[1]);
+
+    if (!st_utest_is_uring()) {
+        EXPECT_EQ(-1, st_uring_register_buffers(iovs, 2));
+        EXPECT_EQ(ENOSYS, errno);
+        return;
+    }
+
+    ASSERT_EQ(0, st_uring_register_buffers(iovs, 2));
+
+    StSocketPair pair;
+    ASSERT_TRUE(pair.fds[0] && pair.fds[1]);
+
+    // Write from the registered buffer, and read into another one.
+    memcpy(bufs[0], "Hello", 5);
+    EXPECT_EQ(5, st_write(pair.fds[1], bufs[0], 5, ST_UTEST_IO_TIMEOUT));
+    EXPECT_EQ(5, st_read(pair.fds[0], bufs[1] + 8, 16, ST_UTEST_IO_TIMEOUT));
+    EXPECT_EQ(0, memcmp(bufs[1] + 8, "Hello", 5));
+
+    // The fixed buffer is not ready, which waits for the data.
+    EXPECT_EQ(-1, st_read(pair.fds[0], bufs[1], 16, 10 * SRS_UTIME_MILLISECONDS));
+    EXPECT_EQ(ETIME, errno);
+
+    EXPECT_EQ(0, st_uring_register_buffers(NULL, 0));
+}
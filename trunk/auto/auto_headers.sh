@@ -80,6 +80,13 @@ else
     srs_undefine_macro "SRS_RTC" $SRS_AUTO_HEADERS_H
 fi
 
+# The bundled libsrtp supports AES-GCM only when built with openssl.
+if [[ $SRS_RTC == YES && $SRS_SRTP_ASM == YES && $SRS_USE_SYS_SRTP == NO ]]; then
+    srs_define_macro "SRS_SRTP_GCM" $SRS_AUTO_HEADERS_H
+else
+    srs_undefine_macro "SRS_SRTP_GCM" $SRS_AUTO_HEADERS_H
+fi
+
 if [[ $SRS_FFMPEG_FIT == YES ]]; then
     srs_define_macro "SRS_FFMPEG_FIT" $SRS_AUTO_HEADERS_H
 else
@@ -126,6 +126,7 @@ SRS_NASM=YES
 SRS_SRTP_ASM=YES
 SRS_DEBUG=NO
 SRS_DEBUG_STATS=NO
+SRS_IO_URING=NO
 
 #####################################################################################
 function apply_system_options() {
@@ -235,6 +236,7 @@ Experts:
   --build-tag=<TAG>         Set the build object directory suffix.
   --debug=on|off            Whether enable the debug code, may hurt performance. Default: $(value2switch $SRS_DEBUG)
   --debug-stats=on|off      Whether enable the debug stats, may hurt performance. Default: $(value2switch $SRS_DEBUG_STATS)
+  --io-uring=on|off         Whether prefer io_uring for ST, fallback to epoll if kernel not support. Default: $(value2switch $SRS_IO_URING)
   --gcov=on|off             Whether enable the GCOV for coverage. Default: $(value2switch $SRS_GCOV)
   --log-verbose=on|off      Whether enable the log verbose level. Default: $(value2switch $SRS_LOG_VERBOSE)
   --log-info=on|off         Whether enable the log info level. Default: $(value2switch $SRS_LOG_INFO)
@@ -376,6 +378,7 @@ function parse_user_option() {
         --log-level_v2)                 SRS_LOG_LEVEL_V2=$(switch2value $value) ;;
         --debug)                        SRS_DEBUG=$(switch2value $value) ;;
         --debug-stats)                  SRS_DEBUG_STATS=$(switch2value $value) ;;
+        --io-uring)                     SRS_IO_URING=$(switch2value $value) ;;
 
         --cross-build)                  SRS_CROSS_BUILD=YES         ;;
         --generic-linux)                SRS_GENERIC_LINUX=$(switch2value $value) ;;
@@ -670,6 +673,7 @@ function regenerate_options() {
     SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --apm=$(value2switch $SRS_APM)"
     SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --debug=$(value2switch $SRS_DEBUG)"
     SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --debug-stats=$(value2switch $SRS_DEBUG_STATS)"
+    SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --io-uring=$(value2switch $SRS_IO_URING)"
     SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --cross-build=$(value2switch $SRS_CROSS_BUILD)"
     SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --sanitizer=$(value2switch $SRS_SANITIZER)"
     SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --sanitizer-static=$(value2switch $SRS_SANITIZER_STATIC)"
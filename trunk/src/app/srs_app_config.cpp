@@ -2328,7 +2328,7 @@ srs_error_t SrsConfig::check_normal_config()
             && n != "ff_log_level" && n != "grace_final_wait" && n != "force_grace_quit"
             && n != "grace_start_wait" && n != "empty_ip_ok" && n != "disable_daemon_for_docker"
             && n != "inotify_auto_reload" && n != "auto_reload_for_docker" && n != "tcmalloc_release_rate"
-            && n != "query_latest_version" && n != "first_wait_for_qlv" && n != "threads"
+            && n != "query_latest_version" && n != "first_wait_for_qlv" && n != "threads" && n != "workers"
             && n != "circuit_breaker" && n != "is_full" && n != "in_docker" && n != "tencentcloud_cls"
             && n != "exporter"
             ) {
@@ -2585,7 +2585,8 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "enabled"  && m != "dvr_apply" && m != "dvr_path" && m != "dvr_plan"
-                        && m != "dvr_duration" && m != "dvr_wait_keyframe" && m != "time_jitter") {
+                        && m != "dvr_duration" && m != "dvr_wait_keyframe" && m != "time_jitter" && m != "dvr_format"
+                        && m != "dvr_fragment" && m != "dvr_finalize") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.dvr.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -2607,7 +2608,7 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "time_jitter" && m != "mix_correct" && m != "atc" && m != "atc_auto" && m != "mw_latency"
-                        && m != "gop_cache" && m != "gop_cache_max_frames" && m != "queue_length" && m != "send_min_interval" && m != "reduce_sequence_header"
+                        && m != "gop_cache" && m != "gop_cache_max_frames" && m != "gop_cache_max_bytes" && m != "gop_cache_fast_start" && m != "queue_length" && m != "send_min_interval" && m != "reduce_sequence_header"
                         && m != "mw_msgs") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.play.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
@@ -2616,7 +2617,7 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "mode" && m != "origin" && m != "token_traverse" && m != "vhost" && m != "debug_srs_upnode" && m != "coworkers"
-                        && m != "origin_cluster" && m != "protocol" && m != "follow_client") {
+                        && m != "origin_cluster" && m != "protocol" && m != "follow_client" && m != "coworkers_ttl") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.cluster.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -2702,7 +2703,7 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     SrsConfDirective* trans = conf->at(j);
                     string m = trans->name.c_str();
-                    if (m != "enabled" && m != "ffmpeg" && m != "engine") {
+                    if (m != "enabled" && m != "ffmpeg" && m != "engine" && m != "abr") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.transcode.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                     if (m == "engine") {
@@ -2726,14 +2727,15 @@ srs_error_t SrsConfig::check_normal_config()
                         && m != "bframe" && m != "aac" && m != "stun_timeout" && m != "stun_strict_check"
                         && m != "dtls_role" && m != "dtls_version" && m != "drop_for_pt" && m != "rtc_to_rtmp"
                         && m != "pli_for_rtmp" && m != "rtmp_to_rtc" && m != "keep_bframe" && m != "opus_bitrate"
-                        && m != "aac_bitrate" && m != "keep_avc_nalu_sei") {
+                        && m != "aac_bitrate" && m != "keep_avc_nalu_sei" && m != "keyframe_cache" && m != "pli_interval"
+                        && m != "jitter_max_delay") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.rtc.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
             } else if (n == "srt") {
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
-                    if (m != "enabled" && m != "srt_to_rtmp") {
+                    if (m != "enabled" && m != "srt_to_rtmp" && m != "rtmp_to_srt" && m != "pacing" && m != "queue_size" && m != "slow_reader") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.srt.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -3302,6 +3304,146 @@ srs_utime_t SrsConfig::get_threads_interval()
     return v * SRS_UTIME_SECONDS;
 }
 
+int SrsConfig::get_threads_audio_workers()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.threads.audio_workers"); // SRS_THREADS_AUDIO_WORKERS
+
+    static int DEFAULT = 0;
+
+    SrsConfDirective* conf = root->get("threads");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("audio_workers");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return srs_max(0, ::atoi(conf->arg0().c_str()));
+}
+
+string SrsConfig::get_threads_cpu_affinity(string label)
+{
+    SRS_OVERWRITE_BY_ENV_STRING("srs.threads.cpu_affinity." + label); // SRS_THREADS_CPU_AFFINITY_HYBRID
+
+    static string DEFAULT = "";
+
+    SrsConfDirective* conf = root->get("threads");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("cpu_affinity");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get(label);
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return conf->arg0();
+}
+
+bool SrsConfig::get_threads_numa_local()
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.threads.numa_local"); // SRS_THREADS_NUMA_LOCAL
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = root->get("threads");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("numa_local");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+bool SrsConfig::get_workers_enabled()
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.workers.enabled"); // SRS_WORKERS_ENABLED
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = root->get("workers");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+int SrsConfig::get_workers_count()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.workers.count"); // SRS_WORKERS_COUNT
+
+    static int DEFAULT = 2;
+
+    SrsConfDirective* conf = root->get("workers");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("count");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    int v = ::atoi(conf->arg0().c_str());
+    if (v <= 0) {
+        return DEFAULT;
+    }
+
+    return v;
+}
+
+int SrsConfig::get_workers_ring_size()
+{
+    static int DEFAULT = 8;
+    // The capacity of ring is 32 bits, and there are N*(N-1) rings in shared memory.
+    static int MAX = 1024;
+    int v = 0;
+
+    if (!srs_getenv("srs.workers.ring_size").empty()) { // SRS_WORKERS_RING_SIZE
+        v = ::atoi(srs_getenv("srs.workers.ring_size").c_str());
+    } else {
+        SrsConfDirective* conf = root->get("workers");
+        if (!conf) {
+            return DEFAULT;
+        }
+
+        conf = conf->get("ring_size");
+        if (!conf || conf->arg0().empty()) {
+            return DEFAULT;
+        }
+
+        v = ::atoi(conf->arg0().c_str());
+    }
+
+    if (v <= 0) {
+        return DEFAULT;
+    }
+
+    if (v > MAX) {
+        srs_warn("Reset workers ring size %dMB to %dMB", v, MAX);
+        return MAX;
+    }
+
+    return v;
+}
+
 bool SrsConfig::get_circuit_breaker()
 {
     SRS_OVERWRITE_BY_ENV_BOOL2("srs.circuit_breaker.enabled"); // SRS_CIRCUIT_BREAKER_ENABLED
@@ -4661,6 +4803,63 @@ srs_utime_t SrsConfig::get_rtc_pli_for_rtmp(string vhost)
     return v;
 }
 
+srs_utime_t SrsConfig::get_rtc_jitter_max_delay(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_MILLISECONDS("srs.vhost.rtc.jitter_max_delay"); // SRS_VHOST_RTC_JITTER_MAX_DELAY
+
+    static srs_utime_t DEFAULT = 300 * SRS_UTIME_MILLISECONDS;
+
+    SrsConfDirective* conf = get_rtc(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("jitter_max_delay");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
+}
+
+bool SrsConfig::get_rtc_keyframe_cache(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.vhost.rtc.keyframe_cache"); // SRS_VHOST_RTC_KEYFRAME_CACHE
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_rtc(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("keyframe_cache");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_rtc_pli_interval(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_FLOAT_SECONDS("srs.vhost.rtc.pli_interval"); // SRS_VHOST_RTC_PLI_INTERVAL
+
+    static srs_utime_t DEFAULT = 500 * SRS_UTIME_MILLISECONDS;
+
+    SrsConfDirective* conf = get_rtc(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("pli_interval");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
 bool SrsConfig::get_rtc_nack_enabled(string vhost)
 {
     SRS_OVERWRITE_BY_ENV_BOOL2("srs.vhost.rtc.nack"); // SRS_VHOST_RTC_NACK
@@ -4896,6 +5095,54 @@ int SrsConfig::get_gop_cache_max_frames(string vhost)
     return ::atoi(conf->arg0().c_str());
 }
 
+int SrsConfig::get_gop_cache_max_bytes(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.vhost.play.gop_cache_max_bytes"); // SRS_VHOST_PLAY_GOP_CACHE_MAX_BYTES
+
+    static int DEFAULT = 64 * 1024 * 1024;
+
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("gop_cache_max_bytes");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
+srs_utime_t SrsConfig::get_gop_cache_fast_start(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_MILLISECONDS("srs.vhost.play.gop_cache_fast_start"); // SRS_VHOST_PLAY_GOP_CACHE_FAST_START
+
+    static srs_utime_t DEFAULT = 0;
+
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("gop_cache_fast_start");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
+}
+
 
 bool SrsConfig::get_debug_srs_upnode(string vhost)
 {
@@ -5941,6 +6188,28 @@ vector<string> SrsConfig::get_vhost_coworkers(string vhost)
     return coworkers;
 }
 
+srs_utime_t SrsConfig::get_vhost_coworkers_ttl(string vhost)
+{
+    static srs_utime_t DEFAULT = 30 * SRS_UTIME_SECONDS;
+
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("coworkers_ttl");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
 bool SrsConfig::get_security_enabled(string vhost)
 {
     static bool DEFAULT = false;
@@ -6027,6 +6296,22 @@ string SrsConfig::get_transcode_ffmpeg(SrsConfDirective* conf)
     return conf->arg0();
 }
 
+bool SrsConfig::get_transcode_abr(SrsConfDirective* conf)
+{
+    static bool DEFAULT = false;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("abr");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
 vector<SrsConfDirective*> SrsConfig::get_transcode_engines(SrsConfDirective* conf)
 {
     vector<SrsConfDirective*> engines;
@@ -7593,6 +7878,63 @@ srs_utime_t SrsConfig::get_dvr_duration(string vhost)
     return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
 }
 
+string SrsConfig::get_dvr_format(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_STRING("srs.vhost.dvr.dvr_format"); // SRS_VHOST_DVR_DVR_FORMAT
+
+    static string DEFAULT = "auto";
+
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("dvr_format");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return conf->arg0();
+}
+
+srs_utime_t SrsConfig::get_dvr_fragment(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_FLOAT_SECONDS("srs.vhost.dvr.dvr_fragment"); // SRS_VHOST_DVR_DVR_FRAGMENT
+
+    static srs_utime_t DEFAULT = 2 * SRS_UTIME_SECONDS;
+
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("dvr_fragment");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+bool SrsConfig::get_dvr_finalize(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_BOOL2("srs.vhost.dvr.dvr_finalize"); // SRS_VHOST_DVR_DVR_FINALIZE
+
+    static bool DEFAULT = true;
+
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("dvr_finalize");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
 bool SrsConfig::get_dvr_wait_keyframe(string vhost)
 {
     SRS_OVERWRITE_BY_ENV_BOOL2("srs.vhost.dvr.dvr_wait_keyframe"); // SRS_VHOST_DVR_DVR_WAIT_KEYFRAME
@@ -8273,6 +8615,84 @@ bool SrsConfig::get_srt_to_rtmp(std::string vhost)
     return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
+bool SrsConfig::get_srt_from_rtmp(std::string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.vhost.srt.rtmp_to_srt"); // SRS_VHOST_SRT_RTMP_TO_SRT
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_srt(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("rtmp_to_srt");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+bool SrsConfig::get_srt_pacing(std::string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_BOOL2("srs.vhost.srt.pacing"); // SRS_VHOST_SRT_PACING
+
+    static bool DEFAULT = true;
+
+    SrsConfDirective* conf = get_srt(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("pacing");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+int SrsConfig::get_srt_queue_size(std::string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.vhost.srt.queue_size"); // SRS_VHOST_SRT_QUEUE_SIZE
+
+    static int DEFAULT = 4096;
+
+    SrsConfDirective* conf = get_srt(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("queue_size");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
+bool SrsConfig::get_srt_slow_reader_disconnect(std::string vhost)
+{
+    if (!srs_getenv("srs.vhost.srt.slow_reader").empty()) { // SRS_VHOST_SRT_SLOW_READER
+        return srs_getenv("srs.vhost.srt.slow_reader") == "disconnect";
+    }
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_srt(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("slow_reader");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return conf->arg0() == "disconnect";
+}
+
 bool SrsConfig::get_http_stream_enabled()
 {
     SrsConfDirective* conf = root->get("http_server");
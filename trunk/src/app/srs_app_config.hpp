@@ -456,6 +456,21 @@ public:
 // Thread pool section.
 public:
     virtual srs_utime_t get_threads_interval();
+    // Get the number of worker threads for audio transcoding, 0 to transcode in hybrid thread.
+    virtual int get_threads_audio_workers();
+    // Get the CPU list to pin the thread of label, such as primordial, hybrid or audio, empty to not pin.
+    virtual std::string get_threads_cpu_affinity(std::string label);
+    // Whether allocate memory from the local NUMA node of each thread.
+    virtual bool get_threads_numa_local();
+// Stream workers section.
+public:
+    // Whether serve RTMP and HTTP-FLV by multiple worker processes.
+    virtual bool get_workers_enabled();
+    // Get the number of workers, including the master worker.
+    virtual int get_workers_count();
+    // Get the size in MB of ring to mirror streams from a worker to another.
+    virtual int get_workers_ring_size();
+public:
     virtual bool get_circuit_breaker();
     virtual int get_high_threshold();
     virtual int get_high_pulse();
@@ -542,6 +557,12 @@ public:
     int get_rtc_drop_for_pt(std::string vhost);
     bool get_rtc_to_rtmp(std::string vhost);
     srs_utime_t get_rtc_pli_for_rtmp(std::string vhost);
+    // The max delay to wait for the lost packet, for RTC to RTMP.
+    srs_utime_t get_rtc_jitter_max_delay(std::string vhost);
+    // Whether cache the RTP packets of last keyframe, for player to start fast.
+    bool get_rtc_keyframe_cache(std::string vhost);
+    // The min interval of PLI to publisher, to merge the PLI of players.
+    srs_utime_t get_rtc_pli_interval(std::string vhost);
     bool get_rtc_nack_enabled(std::string vhost);
     bool get_rtc_nack_no_copy(std::string vhost);
     bool get_rtc_twcc_enabled(std::string vhost);
@@ -571,6 +592,10 @@ public:
     virtual bool get_gop_cache(std::string vhost);
     // Get the limit max frames for gop cache.
     virtual int get_gop_cache_max_frames(std::string vhost);
+    // Get the max bytes of gop cache, 0 to disable the limit.
+    virtual int get_gop_cache_max_bytes(std::string vhost);
+    // Get the max duration of gop cache to dump to player, 0 to always dump.
+    virtual srs_utime_t get_gop_cache_fast_start(std::string vhost);
     // Whether debug_srs_upnode is enabled of vhost.
     // debug_srs_upnode is very important feature for tracable log,
     // but some server, for instance, flussonic donot support it.
@@ -710,6 +735,14 @@ private:
 public:
     bool get_srt_enabled(std::string vhost);
     bool get_srt_to_rtmp(std::string vhost);
+    // Whether mux the RTMP stream to TS and deliver to SRT players.
+    bool get_srt_from_rtmp(std::string vhost);
+    // Whether pace the TS packets bridged from RTMP, by the timestamp of frames.
+    bool get_srt_pacing(std::string vhost);
+    // Get the max number of packets in the queue shared by all SRT players.
+    int get_srt_queue_size(std::string vhost);
+    // Whether disconnect the slow SRT player, or drop the packets it lags behind.
+    bool get_srt_slow_reader_disconnect(std::string vhost);
 
 // http_hooks section
 private:
@@ -778,6 +811,8 @@ public:
     // Get the co-workers of origin cluster.
     // @see https://ossrs.net/lts/zh-cn/docs/v4/doc/origin-cluster
     virtual std::vector<std::string> get_vhost_coworkers(std::string vhost);
+    // Get the TTL of stream pushed to co-workers, which is refreshed every TTL/3 when publishing.
+    virtual srs_utime_t get_vhost_coworkers_ttl(std::string vhost);
 // vhost security section
 public:
     // Whether the secrity of vhost enabled.
@@ -801,6 +836,8 @@ public:
     virtual bool get_transcode_enabled(SrsConfDirective* conf);
     // Get the ffmpeg tool path of transcode.
     virtual std::string get_transcode_ffmpeg(SrsConfDirective* conf);
+    // Whether run all engines in one ffmpeg process as ABR renditions, which decode the input once.
+    virtual bool get_transcode_abr(SrsConfDirective* conf);
     // Get the engines of transcode.
     virtual std::vector<SrsConfDirective*> get_transcode_engines(SrsConfDirective* conf);
     // Whether the engine is enabled.
@@ -1014,6 +1051,12 @@ public:
     virtual std::string get_dvr_plan(std::string vhost);
     // Get the duration of dvr flv.
     virtual srs_utime_t get_dvr_duration(std::string vhost);
+    // Get the format of dvr file, auto, flv, mp4 or fmp4.
+    virtual std::string get_dvr_format(std::string vhost);
+    // Get the duration of fragment for fmp4 dvr.
+    virtual srs_utime_t get_dvr_fragment(std::string vhost);
+    // Whether rewrite the moov with duration when reap the fmp4 dvr file.
+    virtual bool get_dvr_finalize(std::string vhost);
     // Whether wait keyframe to reap segment.
     virtual bool get_dvr_wait_keyframe(std::string vhost);
     // Get the time_jitter algorithm for dvr.
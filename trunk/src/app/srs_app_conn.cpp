@@ -588,6 +588,11 @@ srs_error_t SrsTcpConnection::writev(const iovec *iov, int iov_size, ssize_t* nw
     return skt->writev(iov, iov_size, nwrite);
 }
 
+srs_error_t SrsTcpConnection::sendfile(int fd, int64_t offset, int64_t size, int64_t* nwrite)
+{
+    return skt->sendfile(fd, offset, size, nwrite);
+}
+
 SrsBufferedReadWriter::SrsBufferedReadWriter(ISrsProtocolReadWriter* io)
 {
     io_ = io;
@@ -712,6 +717,15 @@ srs_error_t SrsBufferedReadWriter::writev(const iovec *iov, int iov_size, ssize_
     return io_->writev(iov, iov_size, nwrite);
 }
 
+srs_error_t SrsBufferedReadWriter::sendfile(int fd, int64_t offset, int64_t size, int64_t* nwrite)
+{
+    ISrsSendfileWriter* sw = dynamic_cast<ISrsSendfileWriter*>(io_);
+    if (!sw) {
+        return srs_error_new(ERROR_SOCKET_WRITE, "sendfile not supported");
+    }
+    return sw->sendfile(fd, offset, size, nwrite);
+}
+
 SrsSslConnection::SrsSslConnection(ISrsProtocolReadWriter* c)
 {
     transport = c;
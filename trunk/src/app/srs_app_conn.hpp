@@ -234,7 +234,7 @@ public:
 // The basic connection of SRS, for TCP based protocols,
 // all connections accept from listener must extends from this base class,
 // server will add the connection to manager, and delete it when remove.
-class SrsTcpConnection : public ISrsProtocolReadWriter
+class SrsTcpConnection : public ISrsProtocolReadWriter, public ISrsSendfileWriter
 {
 private:
     // The underlayer st fd handler.
@@ -261,11 +261,14 @@ public:
     virtual srs_utime_t get_send_timeout();
     virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
     virtual srs_error_t writev(const iovec *iov, int iov_size, ssize_t* nwrite);
+// Interface ISrsSendfileWriter
+public:
+    virtual srs_error_t sendfile(int fd, int64_t offset, int64_t size, int64_t* nwrite);
 };
 
 // With a small fast read buffer, to support peek for protocol detecting. Note that directly write to io without any
 // cache or buffer.
-class SrsBufferedReadWriter : public ISrsProtocolReadWriter
+class SrsBufferedReadWriter : public ISrsProtocolReadWriter, public ISrsSendfileWriter
 {
 private:
     // The under-layer transport.
@@ -295,6 +298,9 @@ public:
     virtual srs_utime_t get_send_timeout();
     virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
     virtual srs_error_t writev(const iovec *iov, int iov_size, ssize_t* nwrite);
+// Interface ISrsSendfileWriter
+public:
+    virtual srs_error_t sendfile(int fd, int64_t offset, int64_t size, int64_t* nwrite);
 };
 
 // The SSL connection over TCP transport, in server mode.
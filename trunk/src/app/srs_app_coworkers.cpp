@@ -7,6 +7,7 @@
 #include <srs_app_coworkers.hpp>
 
 #include <stdlib.h>
+#include <vector>
 using namespace std;
 
 #include <srs_protocol_json.hpp>
@@ -14,23 +15,320 @@ using namespace std;
 #include <srs_protocol_rtmp_stack.hpp>
 #include <srs_app_config.hpp>
 #include <srs_protocol_utility.hpp>
-#include <srs_protocol_utility.hpp>
 #include <srs_kernel_utility.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_protocol_http_client.hpp>
+#include <srs_protocol_http_stack.hpp>
+#include <srs_app_http_hooks.hpp>
+#include <srs_app_hybrid.hpp>
+#include <srs_app_statistic.hpp>
+
+// The timeout to push updates to coworker.
+#define SRS_COWORKER_TIMEOUT (3 * SRS_UTIME_SECONDS)
+// The interval to retry when push updates to coworker failed.
+#define SRS_COWORKER_RETRY (3 * SRS_UTIME_SECONDS)
+
+// Parse the service host and port of this server, from the listen port.
+void srs_coworkers_listen(string& listen_host, int& listen_port)
+{
+    listen_port = SRS_CONSTS_RTMP_DEFAULT_PORT;
+
+    vector<string> listen_hostports = _srs_config->get_listens();
+    if (!listen_hostports.empty()) {
+        string list_hostport = listen_hostports.at(0);
+
+        if (list_hostport.find(":") != string::npos) {
+            srs_parse_hostport(list_hostport, listen_host, listen_port);
+        } else {
+            listen_port = ::atoi(list_hostport.c_str());
+        }
+    }
+
+    // Ignore the localhost or loopback, which is not the exposed ip.
+    if (listen_host == SRS_CONSTS_LOCALHOST || listen_host == SRS_CONSTS_LOOPBACK || listen_host == SRS_CONSTS_LOOPBACK6) {
+        listen_host = "";
+    }
+}
+
+// The counter of publish in this server, for the version of stream.
+static int64_t _srs_coworker_version = 0;
+
+// Compare the version of stream from the same server, return negative if a is older than b.
+int64_t srs_coworker_version_compare(int64_t a_epoch, int64_t a_version, int64_t b_epoch, int64_t b_version)
+{
+    if (a_epoch != b_epoch) {
+        return a_epoch - b_epoch;
+    }
+    return a_version - b_version;
+}
+
+SrsCoWorkerStream::SrsCoWorkerStream(SrsRequest* r)
+{
+    req = r->copy();
+    epoch = srs_get_system_startup_time();
+    version = ++_srs_coworker_version;
+    pushed_at = 0;
+}
+
+SrsCoWorkerStream::~SrsCoWorkerStream()
+{
+    srs_freep(req);
+}
+
+SrsCoWorkerOrigin::SrsCoWorkerOrigin()
+{
+    port = 0;
+    epoch = version = 0;
+    prev_epoch = prev_version = 0;
+    expired_at = 0;
+}
+
+SrsCoWorkerOrigin::~SrsCoWorkerOrigin()
+{
+}
+
+SrsCoWorkerPeer::SrsCoWorkerPeer(string coworker)
+{
+    coworker_ = coworker;
+    trd_ = new SrsSTCoroutine("coworker", this);
+    cond_ = srs_cond_new();
+    hc_ = new SrsHttpClient();
+    connected_ = false;
+}
+
+SrsCoWorkerPeer::~SrsCoWorkerPeer()
+{
+    srs_freep(trd_);
+    srs_freep(hc_);
+    srs_cond_destroy(cond_);
+
+    map<string, SrsJsonObject*>::iterator it;
+    for (it = updates_.begin(); it != updates_.end(); ++it) {
+        SrsJsonObject* update = it->second;
+        srs_freep(update);
+    }
+}
+
+srs_error_t SrsCoWorkerPeer::start()
+{
+    srs_error_t err = srs_success;
+
+    if ((err = trd_->start()) != srs_success) {
+        return srs_error_wrap(err, "coworker %s", coworker_.c_str());
+    }
+
+    return err;
+}
+
+void SrsCoWorkerPeer::push(string url, SrsJsonObject* update)
+{
+    map<string, SrsJsonObject*>::iterator it = updates_.find(url);
+    if (it != updates_.end()) {
+        srs_freep(it->second);
+    }
+
+    updates_[url] = update;
+    srs_cond_signal(cond_);
+}
+
+string SrsCoWorkerPeer::server_id()
+{
+    return server_id_;
+}
+
+srs_error_t SrsCoWorkerPeer::cycle()
+{
+    srs_error_t err = do_cycle();
+
+    srs_trace("coworker: push to %s done, err %s", coworker_.c_str(), srs_error_desc(err).c_str());
+    srs_freep(err);
+
+    return srs_success;
+}
+
+srs_error_t SrsCoWorkerPeer::do_cycle()
+{
+    srs_error_t err = srs_success;
+
+    while (true) {
+        if ((err = trd_->pull()) != srs_success) {
+            return srs_error_wrap(err, "pull");
+        }
+
+        if (updates_.empty()) {
+            srs_cond_wait(cond_);
+            continue;
+        }
+
+        // Send all pending updates in a batch.
+        SrsJsonArray* arr = SrsJsonAny::array();
+        map<string, SrsJsonObject*>::iterator it;
+        for (it = updates_.begin(); it != updates_.end(); ++it) {
+            arr->append(it->second);
+        }
+        updates_.clear();
+
+        SrsJsonObject* body = SrsJsonAny::object();
+        SrsAutoFree(SrsJsonObject, body);
+        body->set("server_id", SrsJsonAny::str(SrsStatistic::instance()->server_id().c_str()));
+        body->set("updates", arr);
+
+        // The updates are dropped when failed, and recovered by the refresh of stream, or expired by TTL.
+        if ((err = flush(body)) != srs_success) {
+            srs_warn("coworker: push %d updates to %s, err %s", arr->count(), coworker_.c_str(), srs_error_desc(err).c_str());
+            srs_freep(err);
+
+            connected_ = false;
+            srs_usleep(SRS_COWORKER_RETRY);
+        }
+    }
+
+    return err;
+}
+
+srs_error_t SrsCoWorkerPeer::flush(SrsJsonObject* body)
+{
+    srs_error_t err = srs_success;
+
+    // Reuse the connection, and only reconnect when error.
+    if (!connected_) {
+        string host = coworker_;
+        int port = SRS_CONSTS_HTTP_DEFAULT_PORT;
+        srs_parse_hostport(coworker_, host, port);
+
+        if ((err = hc_->initialize("http", host, port, SRS_COWORKER_TIMEOUT)) != srs_success) {
+            return srs_error_wrap(err, "init client");
+        }
+        connected_ = true;
+    }
+
+    ISrsHttpMessage* msg = NULL;
+    if ((err = hc_->post("/api/v1/clusters?action=update", body->dumps(), &msg)) != srs_success) {
+        return srs_error_wrap(err, "post");
+    }
+    SrsAutoFree(ISrsHttpMessage, msg);
+
+    // Always read the whole body, for the connection to be reused.
+    string res;
+    if ((err = msg->body_read_all(res)) != srs_success) {
+        return srs_error_wrap(err, "read body");
+    }
+
+    if (msg->status_code() != SRS_CONSTS_HTTP_OK) {
+        return srs_error_new(ERROR_HTTP_STATUS_INVALID, "status %d, res %s", msg->status_code(), res.c_str());
+    }
+
+    SrsJsonAny* info = SrsJsonAny::loads(res);
+    SrsAutoFree(SrsJsonAny, info);
+
+    SrsJsonAny* prop = NULL;
+    if (!info || !info->is_object() || (prop = info->to_object()->ensure_property_integer("code")) == NULL) {
+        return srs_error_new(ERROR_OCLUSTER_DISCOVER, "invalid res %s", res.c_str());
+    }
+    if (prop->to_integer() != ERROR_SUCCESS) {
+        return srs_error_new(ERROR_OCLUSTER_DISCOVER, "code %d, res %s", (int)prop->to_integer(), res.c_str());
+    }
+
+    if ((prop = info->to_object()->ensure_property_string("server")) != NULL) {
+        server_id_ = prop->to_str();
+    }
+
+    return err;
+}
+
+// Query a coworker for the origin of stream, to discover by all coworkers in parallel.
+class SrsCoWorkerQuery : public ISrsCoroutineHandler
+{
+public:
+    std::string coworker;
+    std::string url;
+    std::string host;
+    int port;
+    // The server id of coworker, to identify whether it's ourself.
+    std::string server_id;
+    // The version of stream on coworker, which is the origin of stream.
+    int64_t epoch;
+    int64_t version;
+    srs_error_t err;
+    bool done;
+private:
+    srs_cond_t cond_;
+    SrsCoroutine* trd_;
+public:
+    SrsCoWorkerQuery(std::string c, std::string u, srs_cond_t cond) {
+        coworker = c;
+        url = u;
+        port = 0;
+        epoch = version = 0;
+        err = srs_success;
+        done = false;
+        cond_ = cond;
+        trd_ = new SrsSTCoroutine("coworker-query", this, _srs_context->get_id());
+    }
+    virtual ~SrsCoWorkerQuery() {
+        srs_freep(trd_);
+        srs_freep(err);
+    }
+public:
+    srs_error_t start() {
+        return trd_->start();
+    }
+    // Whether the coworker is this server itself.
+    bool self() {
+        return done && !server_id.empty() && server_id == SrsStatistic::instance()->server_id();
+    }
+    // Whether found a valid origin, which is not excluded.
+    bool ok(const std::set<std::string>& excludes) {
+        if (!done || err != srs_success || host.empty() || port <= 0 || self()) {
+            return false;
+        }
+        return excludes.find(host + ":" + srs_int2str(port)) == excludes.end();
+    }
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle() {
+        err = SrsHttpHooks::discover_co_workers(url, host, port, server_id, epoch, version);
+        done = true;
+        srs_cond_signal(cond_);
+        return srs_success;
+    }
+};
 
 SrsCoWorkers* SrsCoWorkers::_instance = NULL;
 
 SrsCoWorkers::SrsCoWorkers()
 {
+    timer_subscribed_ = false;
 }
 
 SrsCoWorkers::~SrsCoWorkers()
 {
-    map<string, SrsRequest*>::iterator it;
-    for (it = streams.begin(); it != streams.end(); ++it) {
-        SrsRequest* r = it->second;
-        srs_freep(r);
+    if (true) {
+        map<string, SrsCoWorkerStream*>::iterator it;
+        for (it = streams.begin(); it != streams.end(); ++it) {
+            SrsCoWorkerStream* s = it->second;
+            srs_freep(s);
+        }
+        streams.clear();
+    }
+
+    if (true) {
+        map<string, SrsCoWorkerOrigin*>::iterator it;
+        for (it = origins_.begin(); it != origins_.end(); ++it) {
+            SrsCoWorkerOrigin* o = it->second;
+            srs_freep(o);
+        }
+        origins_.clear();
+    }
+
+    if (true) {
+        map<string, SrsCoWorkerPeer*>::iterator it;
+        for (it = peers_.begin(); it != peers_.end(); ++it) {
+            SrsCoWorkerPeer* peer = it->second;
+            srs_freep(peer);
+        }
+        peers_.clear();
     }
-    streams.clear();
 }
 
 SrsCoWorkers* SrsCoWorkers::instance()
@@ -43,8 +341,8 @@ SrsCoWorkers* SrsCoWorkers::instance()
 
 SrsJsonAny* SrsCoWorkers::dumps(string vhost, string coworker, string app, string stream)
 {
-    SrsRequest* r = find_stream_info(vhost, app, stream);
-    if (!r) {
+    SrsCoWorkerStream* s = find_stream_info(vhost, app, stream);
+    if (!s) {
         // TODO: FIXME: Find stream from our origin util return to the start point.
         return SrsJsonAny::null();
     }
@@ -52,25 +350,13 @@ SrsJsonAny* SrsCoWorkers::dumps(string vhost, string coworker, string app, strin
     // The service port parsing from listen port.
     string listen_host;
     int listen_port = SRS_CONSTS_RTMP_DEFAULT_PORT;
-    vector<string> listen_hostports = _srs_config->get_listens();
-    if (!listen_hostports.empty()) {
-        string list_hostport = listen_hostports.at(0);
-
-        if (list_hostport.find(":") != string::npos) {
-            srs_parse_hostport(list_hostport, listen_host, listen_port);
-        } else {
-            listen_port = ::atoi(list_hostport.c_str());
-        }
-    }
+    srs_coworkers_listen(listen_host, listen_port);
 
     // The ip of server, we use the request coworker-host as ip, if listen host is localhost or loopback.
     // For example, the server may behind a NAT(192.x.x.x), while its ip is a docker ip(172.x.x.x),
     // we should use the NAT(192.x.x.x) address as it's the exposed ip.
     // @see https://github.com/ossrs/srs/issues/1501
-    string service_ip;
-    if (listen_host != SRS_CONSTS_LOCALHOST && listen_host != SRS_CONSTS_LOOPBACK && listen_host != SRS_CONSTS_LOOPBACK6) {
-        service_ip = listen_host;
-    }
+    string service_ip = listen_host;
     if (service_ip.empty()) {
         int coworker_port;
         string coworker_host = coworker;
@@ -99,12 +385,14 @@ SrsJsonAny* SrsCoWorkers::dumps(string vhost, string coworker, string app, strin
     return SrsJsonAny::object()
         ->set("ip", SrsJsonAny::str(service_ip.c_str()))
         ->set("port", SrsJsonAny::integer(listen_port))
-        ->set("vhost", SrsJsonAny::str(r->vhost.c_str()))
+        ->set("vhost", SrsJsonAny::str(s->req->vhost.c_str()))
         ->set("api", SrsJsonAny::str(backend.c_str()))
+        ->set("epoch", SrsJsonAny::integer(s->epoch))
+        ->set("version", SrsJsonAny::integer(s->version))
         ->set("routers", routers);
 }
 
-SrsRequest* SrsCoWorkers::find_stream_info(string vhost, string app, string stream)
+SrsCoWorkerStream* SrsCoWorkers::find_stream_info(string vhost, string app, string stream)
 {
     // First, we should parse the vhost, if not exists, try default vhost instead.
     SrsConfDirective* conf = _srs_config->get_vhost(vhost, true);
@@ -114,7 +402,7 @@ SrsRequest* SrsCoWorkers::find_stream_info(string vhost, string app, string stre
     
     // Get stream information from local cache.
     string url = srs_generate_stream_url(conf->arg0(), app, stream);
-    map<string, SrsRequest*>::iterator it = streams.find(url);
+    map<string, SrsCoWorkerStream*>::iterator it = streams.find(url);
     if (it == streams.end()) {
         return NULL;
     }
@@ -129,13 +417,24 @@ srs_error_t SrsCoWorkers::on_publish(SrsLiveSource* s, SrsRequest* r)
     string url = r->get_stream_url();
     
     // Delete the previous stream informations.
-    map<string, SrsRequest*>::iterator it = streams.find(url);
+    map<string, SrsCoWorkerStream*>::iterator it = streams.find(url);
     if (it != streams.end()) {
         srs_freep(it->second);
     }
     
     // Always use the latest one.
-    streams[url] = r->copy();
+    SrsCoWorkerStream* stream = new SrsCoWorkerStream(r);
+    streams[url] = stream;
+
+    // Push the stream to coworkers, then refresh it by timer.
+    if (_srs_config->get_vhost_origin_cluster(r->vhost)) {
+        push(stream, true);
+
+        if (!timer_subscribed_) {
+            _srs_hybrid->timer1s()->subscribe(this);
+            timer_subscribed_ = true;
+        }
+    }
     
     return err;
 }
@@ -144,10 +443,387 @@ void SrsCoWorkers::on_unpublish(SrsLiveSource* s, SrsRequest* r)
 {
     string url = r->get_stream_url();
     
-    map<string, SrsRequest*>::iterator it = streams.find(url);
+    map<string, SrsCoWorkerStream*>::iterator it = streams.find(url);
     if (it != streams.end()) {
-        srs_freep(it->second);
+        SrsCoWorkerStream* stream = it->second;
+        if (_srs_config->get_vhost_origin_cluster(r->vhost)) {
+            push(stream, false);
+        }
+
+        srs_freep(stream);
         streams.erase(it);
     }
 }
 
+srs_error_t SrsCoWorkers::on_update(SrsJsonObject* body, string ip)
+{
+    srs_error_t err = srs_success;
+
+    SrsJsonAny* prop = NULL;
+    if ((prop = body->ensure_property_string("server_id")) == NULL) {
+        return srs_error_new(ERROR_OCLUSTER_DISCOVER, "no server_id");
+    }
+    string server_id = prop->to_str();
+
+    if ((prop = body->ensure_property_array("updates")) == NULL) {
+        return srs_error_new(ERROR_OCLUSTER_DISCOVER, "no updates");
+    }
+    SrsJsonArray* updates = prop->to_array();
+
+    // Ignore the updates from ourself, when user config the server itself as coworker.
+    if (server_id == SrsStatistic::instance()->server_id()) {
+        return err;
+    }
+
+    for (int i = 0; i < updates->count(); i++) {
+        SrsJsonAny* update = updates->at(i);
+        if (update->is_object()) {
+            apply(server_id, ip, update->to_object());
+        }
+    }
+
+    return err;
+}
+
+bool SrsCoWorkers::find_origin(string vhost, string app, string stream, string& host, int& port)
+{
+    SrsConfDirective* conf = _srs_config->get_vhost(vhost, true);
+    if (!conf) {
+        return false;
+    }
+
+    string url = srs_generate_stream_url(conf->arg0(), app, stream);
+    map<string, SrsCoWorkerOrigin*>::iterator it = origins_.find(url);
+    if (it == origins_.end()) {
+        return false;
+    }
+
+    SrsCoWorkerOrigin* origin = it->second;
+    if (origin->expired_at < srs_get_system_time()) {
+        srs_freep(origin);
+        origins_.erase(it);
+        return false;
+    }
+
+    host = origin->ip;
+    port = origin->port;
+    return true;
+}
+
+srs_error_t SrsCoWorkers::discover(SrsRequest* r, const set<string>& excludes, string& host, int& port)
+{
+    srs_error_t err = srs_success;
+
+    // Fast path, lookup the directory pushed by coworkers.
+    if (find_origin(r->vhost, r->app, r->stream, host, port)) {
+        if (excludes.find(host + ":" + srs_int2str(port)) == excludes.end()) {
+            return err;
+        }
+    }
+
+    vector<string> coworkers = _srs_config->get_vhost_coworkers(r->vhost);
+    if (coworkers.empty()) {
+        return srs_error_new(ERROR_OCLUSTER_DISCOVER, "no coworkers");
+    }
+
+    // Query all coworkers in parallel, and use the first origin found. Ignore the coworker which is ourself,
+    // identified by the server id in response.
+    srs_cond_t cond = srs_cond_new();
+    vector<SrsCoWorkerQuery*> queries;
+    for (int i = 0; i < (int)coworkers.size(); i++) {
+        string coworker = coworkers.at(i);
+        if (selves_.find(coworker) != selves_.end()) {
+            continue;
+        }
+
+        string url = "http://" + coworker + "/api/v1/clusters?"
+            + "vhost=" + r->vhost + "&ip=" + r->host + "&app=" + r->app + "&stream=" + r->stream
+            + "&coworker=" + coworker;
+
+        SrsCoWorkerQuery* query = new SrsCoWorkerQuery(coworker, url, cond);
+        queries.push_back(query);
+
+        if ((err = query->start()) != srs_success) {
+            err = srs_error_wrap(err, "start query %s", url.c_str());
+            break;
+        }
+    }
+
+    SrsCoWorkerQuery* found = NULL;
+    while (err == srs_success) {
+        int nn_done = 0;
+        for (int i = 0; i < (int)queries.size(); i++) {
+            SrsCoWorkerQuery* query = queries.at(i);
+            if (query->ok(excludes)) {
+                found = query;
+                break;
+            }
+            if (query->done) {
+                nn_done++;
+            }
+        }
+
+        if (found || nn_done == (int)queries.size()) {
+            break;
+        }
+
+        if (srs_cond_wait(cond) != 0) {
+            err = srs_error_new(ERROR_SYSTEM_IO_INVALID, "interrupted");
+        }
+    }
+
+    if (found) {
+        host = found->host;
+        port = found->port;
+
+        // Cache the origin found, which is overwritten by coworker pushing, or expired. The responder is the origin
+        // itself, so we identify the origin by its server id and version, to apply its unpublish.
+        SrsConfDirective* conf = _srs_config->get_vhost(r->vhost, true);
+        if (conf) {
+            string url = srs_generate_stream_url(conf->arg0(), r->app, r->stream);
+            if (origins_.find(url) == origins_.end()) {
+                SrsCoWorkerOrigin* origin = new SrsCoWorkerOrigin();
+                origin->server_id = found->server_id;
+                origin->epoch = found->epoch;
+                origin->version = found->version;
+                origin->vhost = conf->arg0();
+                origin->ip = host;
+                origin->port = port;
+                origin->expired_at = srs_get_system_time() + _srs_config->get_vhost_coworkers_ttl(r->vhost);
+                origins_[url] = origin;
+            }
+        }
+    } else if (err == srs_success && !queries.empty()) {
+        SrsCoWorkerQuery* last = queries.back();
+        err = srs_error_new(ERROR_OCLUSTER_DISCOVER, "no origin in %d coworkers, last %s",
+            (int)queries.size(), srs_error_desc(last->err).c_str());
+    }
+
+    // Stop all queries, before free the cond.
+    for (int i = 0; i < (int)queries.size(); i++) {
+        SrsCoWorkerQuery* query = queries.at(i);
+        if (query->self()) {
+            srs_trace("coworker: ignore %s which is ourself", query->coworker.c_str());
+            selves_.insert(query->coworker);
+        }
+        srs_freep(query);
+    }
+    srs_cond_destroy(cond);
+
+    return err;
+}
+
+void SrsCoWorkers::push(SrsCoWorkerStream* s, bool publish)
+{
+    srs_error_t err = srs_success;
+
+    SrsRequest* r = s->req;
+    s->pushed_at = srs_get_system_time();
+
+    string listen_host;
+    int listen_port = SRS_CONSTS_RTMP_DEFAULT_PORT;
+    srs_coworkers_listen(listen_host, listen_port);
+
+    vector<string> coworkers = _srs_config->get_vhost_coworkers(r->vhost);
+    for (int i = 0; i < (int)coworkers.size(); i++) {
+        string coworker = coworkers.at(i);
+        if (selves_.find(coworker) != selves_.end()) {
+            continue;
+        }
+
+        SrsCoWorkerPeer* peer = NULL;
+        map<string, SrsCoWorkerPeer*>::iterator it = peers_.find(coworker);
+        if (it != peers_.end()) {
+            peer = it->second;
+
+            // Never push to ourself, identified by the server id in response.
+            if (peer->server_id() == SrsStatistic::instance()->server_id()) {
+                srs_trace("coworker: ignore %s which is ourself", coworker.c_str());
+                selves_.insert(coworker);
+                srs_freep(peer);
+                peers_.erase(it);
+                continue;
+            }
+        } else {
+            peer = new SrsCoWorkerPeer(coworker);
+            if ((err = peer->start()) != srs_success) {
+                srs_warn("coworker: ignore start err %s", srs_error_desc(err).c_str());
+                srs_freep(err);
+                srs_freep(peer);
+                continue;
+            }
+            peers_[coworker] = peer;
+        }
+
+        // The ip is empty if listen at any address, the coworker will use the address of connection.
+        SrsJsonObject* update = SrsJsonAny::object();
+        update->set("action", SrsJsonAny::str(publish ? "publish" : "unpublish"));
+        update->set("vhost", SrsJsonAny::str(r->vhost.c_str()));
+        update->set("app", SrsJsonAny::str(r->app.c_str()));
+        update->set("stream", SrsJsonAny::str(r->stream.c_str()));
+        update->set("epoch", SrsJsonAny::integer(s->epoch));
+        update->set("version", SrsJsonAny::integer(s->version));
+        update->set("ttl", SrsJsonAny::integer(srsu2ms(_srs_config->get_vhost_coworkers_ttl(r->vhost))));
+        update->set("ip", SrsJsonAny::str(listen_host.c_str()));
+        update->set("port", SrsJsonAny::integer(listen_port));
+        update->set("api", SrsJsonAny::str(_srs_config->get_http_api_listen().c_str()));
+
+        peer->push(r->get_stream_url(), update);
+    }
+}
+
+void SrsCoWorkers::apply(string server_id, string ip, SrsJsonObject* update)
+{
+    SrsJsonAny* prop = NULL;
+
+    string action, vhost, app, stream;
+    if ((prop = update->ensure_property_string("action")) != NULL) {
+        action = prop->to_str();
+    }
+    if ((prop = update->ensure_property_string("vhost")) != NULL) {
+        vhost = prop->to_str();
+    }
+    if ((prop = update->ensure_property_string("app")) != NULL) {
+        app = prop->to_str();
+    }
+    if ((prop = update->ensure_property_string("stream")) != NULL) {
+        stream = prop->to_str();
+    }
+
+    int64_t epoch = 0, version = 0;
+    if ((prop = update->ensure_property_integer("epoch")) != NULL) {
+        epoch = prop->to_integer();
+    }
+    if ((prop = update->ensure_property_integer("version")) != NULL) {
+        version = prop->to_integer();
+    }
+
+    SrsConfDirective* conf = _srs_config->get_vhost(vhost, true);
+    if (!conf || app.empty() || stream.empty()) {
+        srs_warn("coworker: ignore invalid update from %s, vhost=%s, app=%s, stream=%s",
+            server_id.c_str(), vhost.c_str(), app.c_str(), stream.c_str());
+        return;
+    }
+
+    string url = srs_generate_stream_url(conf->arg0(), app, stream);
+    map<string, SrsCoWorkerOrigin*>::iterator it = origins_.find(url);
+    SrsCoWorkerOrigin* origin = (it != origins_.end()) ? it->second : NULL;
+
+    // The versions are only comparable for the same server, because the clocks of servers are not synchronized.
+    bool same = origin && origin->server_id == server_id;
+    bool stale = same && srs_coworker_version_compare(epoch, version, origin->epoch, origin->version) < 0;
+    if (origin && !same && origin->prev_server_id == server_id) {
+        stale = srs_coworker_version_compare(epoch, version, origin->prev_epoch, origin->prev_version) <= 0;
+    }
+
+    // Remove the origin, only when it's not replaced by a newer publish or another origin. The origin discovered by
+    // querying an old server has no server id, so it's removed by unpublish of any origin.
+    if (action == "unpublish") {
+        if ((same && !stale) || (origin && origin->server_id.empty())) {
+            srs_trace("coworker: remove %s of %s, version=%" PRId64 "/%" PRId64, url.c_str(), server_id.c_str(), epoch, version);
+            srs_freep(origin);
+            origins_.erase(it);
+        }
+        return;
+    }
+
+    // Ignore the stale update, for example, the stream has been republished on another origin.
+    srs_utime_t now = srs_get_system_time();
+    if (stale && origin->expired_at >= now) {
+        return;
+    }
+
+    if (!origin) {
+        origin = new SrsCoWorkerOrigin();
+        origins_[url] = origin;
+    }
+
+    // The stream is republished on another origin, the latest one wins, and remember the previous origin.
+    if (!origin->server_id.empty() && origin->server_id != server_id) {
+        origin->prev_server_id = origin->server_id;
+        origin->prev_epoch = origin->epoch;
+        origin->prev_version = origin->version;
+    }
+
+    srs_utime_t ttl = _srs_config->get_vhost_coworkers_ttl(vhost);
+    if ((prop = update->ensure_property_integer("ttl")) != NULL && prop->to_integer() > 0) {
+        ttl = prop->to_integer() * SRS_UTIME_MILLISECONDS;
+    }
+
+    string origin_ip;
+    if ((prop = update->ensure_property_string("ip")) != NULL) {
+        origin_ip = prop->to_str();
+    }
+    if (origin_ip.empty()) {
+        origin_ip = ip;
+    }
+
+    string api;
+    if ((prop = update->ensure_property_string("api")) != NULL) {
+        api = prop->to_str();
+    }
+    if (api.find(":") == string::npos) {
+        api = origin_ip + ":" + api;
+    }
+
+    bool changed = origin->server_id != server_id || origin->epoch != epoch || origin->version != version;
+
+    origin->server_id = server_id;
+    origin->vhost = conf->arg0();
+    origin->ip = origin_ip;
+    origin->port = 0;
+    if ((prop = update->ensure_property_integer("port")) != NULL) {
+        origin->port = (int)prop->to_integer();
+    }
+    origin->api = api;
+    origin->epoch = epoch;
+    origin->version = version;
+    origin->expired_at = now + ttl;
+
+    if (changed) {
+        srs_trace("coworker: add %s of %s at %s:%d, api=%s, version=%" PRId64 "/%" PRId64 ", ttl=%dms", url.c_str(),
+            server_id.c_str(), origin->ip.c_str(), origin->port, origin->api.c_str(), epoch, version, srsu2msi(ttl));
+    }
+}
+
+srs_error_t SrsCoWorkers::on_timer(srs_utime_t interval)
+{
+    srs_error_t err = srs_success;
+
+    srs_utime_t now = srs_get_system_time();
+
+    // Refresh the streams to coworkers, before expired by TTL.
+    if (true) {
+        map<string, SrsCoWorkerStream*>::iterator it;
+        for (it = streams.begin(); it != streams.end(); ++it) {
+            SrsCoWorkerStream* s = it->second;
+            if (!_srs_config->get_vhost_origin_cluster(s->req->vhost)) {
+                continue;
+            }
+
+            srs_utime_t ttl = _srs_config->get_vhost_coworkers_ttl(s->req->vhost);
+            if (now - s->pushed_at >= ttl / 3) {
+                push(s, true);
+            }
+        }
+    }
+
+    // Remove the expired origins, which are not refreshed by coworkers.
+    if (true) {
+        map<string, SrsCoWorkerOrigin*>::iterator it;
+        for (it = origins_.begin(); it != origins_.end();) {
+            SrsCoWorkerOrigin* origin = it->second;
+            if (origin->expired_at >= now) {
+                ++it;
+                continue;
+            }
+
+            srs_trace("coworker: expire %s of %s, version=%" PRId64, it->first.c_str(), origin->server_id.c_str(), origin->version);
+            srs_freep(origin);
+            origins_.erase(it++);
+        }
+    }
+
+    return err;
+}
+
@@ -11,18 +11,102 @@
 
 #include <string>
 #include <map>
+#include <set>
+
+#include <srs_app_st.hpp>
+#include <srs_app_hourglass.hpp>
 
 class SrsJsonAny;
+class SrsJsonObject;
 class SrsRequest;
 class SrsLiveSource;
+class SrsHttpClient;
+
+// The stream published on this origin.
+class SrsCoWorkerStream
+{
+public:
+    SrsRequest* req;
+    // The version of stream is (server_id, epoch, version), to reject the stale updates by coworkers. The epoch
+    // is the startup time of server, and the version is a counter of publish in this server, so it's only
+    // comparable for the same server, never depends on the wall clock of servers.
+    int64_t epoch;
+    int64_t version;
+    // The last time we pushed the stream to coworkers, to refresh it before TTL.
+    srs_utime_t pushed_at;
+public:
+    SrsCoWorkerStream(SrsRequest* r);
+    virtual ~SrsCoWorkerStream();
+};
+
+// The origin of stream, pushed by a coworker, or discovered by querying coworkers.
+class SrsCoWorkerOrigin
+{
+public:
+    // The server id of origin, by pushing or the response of query, empty if unknown.
+    std::string server_id;
+    std::string vhost;
+    std::string ip;
+    int port;
+    std::string api;
+    int64_t epoch;
+    int64_t version;
+    // The previous origin replaced by this one, to reject its stale updates.
+    std::string prev_server_id;
+    int64_t prev_epoch;
+    int64_t prev_version;
+    // The entry is stale after this time, if not refreshed by coworker.
+    srs_utime_t expired_at;
+public:
+    SrsCoWorkerOrigin();
+    virtual ~SrsCoWorkerOrigin();
+};
+
+// The channel to push updates to a coworker, over a persistent HTTP connection.
+class SrsCoWorkerPeer : public ISrsCoroutineHandler
+{
+private:
+    std::string coworker_;
+    SrsCoroutine* trd_;
+    srs_cond_t cond_;
+    SrsHttpClient* hc_;
+    bool connected_;
+    // The server id of coworker, by the response of update.
+    std::string server_id_;
+    // The pending updates, merged by stream url because the latest update always wins.
+    std::map<std::string, SrsJsonObject*> updates_;
+public:
+    SrsCoWorkerPeer(std::string coworker);
+    virtual ~SrsCoWorkerPeer();
+public:
+    srs_error_t start();
+    // Push update of stream url, the peer takes the ownership of update.
+    void push(std::string url, SrsJsonObject* update);
+    // Get the server id of coworker, empty if unknown.
+    std::string server_id();
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+private:
+    srs_error_t do_cycle();
+    srs_error_t flush(SrsJsonObject* body);
+};
 
 // For origin cluster.
-class SrsCoWorkers
+class SrsCoWorkers : public ISrsFastTimer
 {
 private:
     static SrsCoWorkers* _instance;
 private:
-    std::map<std::string, SrsRequest*> streams;
+    // The streams published on this origin, key is stream url.
+    std::map<std::string, SrsCoWorkerStream*> streams;
+    // The stream directory of cluster, pushed by coworkers, key is stream url.
+    std::map<std::string, SrsCoWorkerOrigin*> origins_;
+    // The push channels to coworkers, key is the coworker API endpoint.
+    std::map<std::string, SrsCoWorkerPeer*> peers_;
+    // The coworkers which is this server itself, because user may config it as coworker.
+    std::set<std::string> selves_;
+    bool timer_subscribed_;
 private:
     SrsCoWorkers();
     virtual ~SrsCoWorkers();
@@ -31,10 +115,25 @@ public:
 public:
     virtual SrsJsonAny* dumps(std::string vhost, std::string coworker, std::string app, std::string stream);
 private:
-    virtual SrsRequest* find_stream_info(std::string vhost, std::string app, std::string stream);
+    virtual SrsCoWorkerStream* find_stream_info(std::string vhost, std::string app, std::string stream);
 public:
     virtual srs_error_t on_publish(SrsLiveSource* s, SrsRequest* r);
     virtual void on_unpublish(SrsLiveSource* s, SrsRequest* r);
+public:
+    // Apply the updates pushed by coworker, the ip is the address of coworker to use if origin has no ip.
+    virtual srs_error_t on_update(SrsJsonObject* body, std::string ip);
+    // Find the origin of stream in directory, return false if not found or expired.
+    virtual bool find_origin(std::string vhost, std::string app, std::string stream, std::string& host, int& port);
+    // Discover the origin of stream, in directory, or query all coworkers in parallel if miss.
+    // @param excludes The origins to ignore in format of host:port, for example, failed to redirect to them.
+    virtual srs_error_t discover(SrsRequest* r, const std::set<std::string>& excludes, std::string& host, int& port);
+private:
+    void push(SrsCoWorkerStream* s, bool publish);
+    void apply(std::string server_id, std::string ip, SrsJsonObject* update);
+// Interface ISrsFastTimer
+private:
+    srs_error_t on_timer(srs_utime_t interval);
 };
 
 #endif
+
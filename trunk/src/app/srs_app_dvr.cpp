@@ -28,6 +28,9 @@ using namespace std;
 
 #define SRS_FWRITE_CACHE_SIZE 65536
 
+// The max duration in ms to wait for sequence header of both tracks before writing the moov of fMP4.
+#define SRS_DVR_FMP4_HEADER_WAIT 3000
+
 SrsDvrSegmenter::SrsDvrSegmenter()
 {
     req = NULL;
@@ -524,6 +527,154 @@ srs_error_t SrsDvrMp4Segmenter::close_encoder()
     return err;
 }
 
+SrsDvrFmp4Segmenter::SrsDvrFmp4Segmenter()
+{
+    enc = new SrsMp4FragmentEncoder();
+    has_header = false;
+    has_keyframe = false;
+    wait_start = -1;
+}
+
+SrsDvrFmp4Segmenter::~SrsDvrFmp4Segmenter()
+{
+    srs_freep(enc);
+}
+
+srs_error_t SrsDvrFmp4Segmenter::refresh_metadata()
+{
+    return srs_success;
+}
+
+srs_error_t SrsDvrFmp4Segmenter::open_encoder()
+{
+    srs_error_t err = srs_success;
+
+    srs_freep(enc);
+    enc = new SrsMp4FragmentEncoder();
+    has_header = false;
+    has_keyframe = false;
+    wait_start = -1;
+
+    srs_utime_t fragment = _srs_config->get_dvr_fragment(req->vhost);
+    if ((err = enc->initialize(fs, srsu2ms(fragment))) != srs_success) {
+        return srs_error_wrap(err, "init encoder");
+    }
+
+    return err;
+}
+
+srs_error_t SrsDvrFmp4Segmenter::encode_metadata(SrsSharedPtrMessage* /*metadata*/)
+{
+    return srs_success;
+}
+
+srs_error_t SrsDvrFmp4Segmenter::encode_audio(SrsSharedPtrMessage* audio, SrsFormat* format)
+{
+    srs_error_t err = srs_success;
+
+    // The sequence header is writen in moov, and only AAC is supported.
+    if (format->acodec->id != SrsAudioCodecIdAAC || format->audio->aac_packet_type == SrsAudioAacFrameTraitSequenceHeader) {
+        return err;
+    }
+
+    if ((err = write_header(format, audio->timestamp)) != srs_success) {
+        return srs_error_wrap(err, "write header");
+    }
+
+    // Drop the audio before the first keyframe, to start the file with keyframe.
+    if (!has_header || (format->vcodec && !has_keyframe)) {
+        return err;
+    }
+
+    uint32_t dts = (uint32_t)audio->timestamp;
+    uint8_t* sample = (uint8_t*)format->raw;
+    uint32_t nb_sample = (uint32_t)format->nb_raw;
+    if ((err = enc->write_sample(SrsMp4HandlerTypeSOUN, 0x00, dts, dts, sample, nb_sample)) != srs_success) {
+        return srs_error_wrap(err, "write sample");
+    }
+
+    return err;
+}
+
+srs_error_t SrsDvrFmp4Segmenter::encode_video(SrsSharedPtrMessage* video, SrsFormat* format)
+{
+    srs_error_t err = srs_success;
+
+    // The sequence header is writen in moov, and only H.264 is supported.
+    if (format->vcodec->id != SrsVideoCodecIdAVC || format->video->avc_packet_type == SrsVideoAvcFrameTraitSequenceHeader) {
+        return err;
+    }
+
+    if ((err = write_header(format, video->timestamp)) != srs_success) {
+        return srs_error_wrap(err, "write header");
+    }
+
+    SrsVideoAvcFrameType frame_type = format->video->frame_type;
+    if (frame_type == SrsVideoAvcFrameTypeKeyFrame) {
+        has_keyframe = true;
+    }
+    if (!has_header || !has_keyframe) {
+        return err;
+    }
+
+    uint32_t dts = (uint32_t)video->timestamp;
+    uint32_t pts = dts + (uint32_t)format->video->cts;
+    uint8_t* sample = (uint8_t*)format->raw;
+    uint32_t nb_sample = (uint32_t)format->nb_raw;
+    if ((err = enc->write_sample(SrsMp4HandlerTypeVIDE, frame_type, dts, pts, sample, nb_sample)) != srs_success) {
+        return srs_error_wrap(err, "write sample");
+    }
+
+    return err;
+}
+
+srs_error_t SrsDvrFmp4Segmenter::close_encoder()
+{
+    srs_error_t err = srs_success;
+
+    if (!has_header) {
+        return err;
+    }
+
+    if ((err = enc->flush(_srs_config->get_dvr_finalize(req->vhost))) != srs_success) {
+        return srs_error_wrap(err, "flush encoder");
+    }
+
+    return err;
+}
+
+srs_error_t SrsDvrFmp4Segmenter::write_header(SrsFormat* format, int64_t timestamp)
+{
+    srs_error_t err = srs_success;
+
+    if (has_header) {
+        return err;
+    }
+
+    // The moov can't be changed after writen, so we wait for the sequence header of both tracks, or the track is
+    // dropped from the file if its sequence header comes later. The wait is bounded for stream with only one track,
+    // and the frames during waiting are dropped.
+    bool video = format->vcodec && format->vcodec->id == SrsVideoCodecIdAVC && !format->vcodec->avc_extra_data.empty();
+    bool audio = format->acodec && format->acodec->id == SrsAudioCodecIdAAC && !format->acodec->aac_extra_data.empty();
+    if (!video && !audio) {
+        return err;
+    }
+
+    if (wait_start < 0) {
+        wait_start = timestamp;
+    }
+    if ((!video || !audio) && timestamp - wait_start < SRS_DVR_FMP4_HEADER_WAIT) {
+        return err;
+    }
+
+    if ((err = enc->write_header(format, video, audio)) != srs_success) {
+        return srs_error_wrap(err, "write header");
+    }
+
+    has_header = true;
+    return err;
+}
+
 SrsDvrAsyncCallOnDvr::SrsDvrAsyncCallOnDvr(SrsContextId c, SrsRequest* r, string p)
 {
     cid = c;
@@ -952,8 +1103,15 @@ srs_error_t SrsDvr::initialize(SrsOriginHub* h, SrsRequest* r)
     }
     
     std::string path = _srs_config->get_dvr_path(r->vhost);
+    std::string format = _srs_config->get_dvr_format(r->vhost);
+    if (format == "auto") {
+        format = srs_string_ends_with(path, ".mp4") ? "mp4" : "flv";
+    }
+
     SrsDvrSegmenter* segmenter = NULL;
-    if (srs_string_ends_with(path, ".mp4")) {
+    if (format == "fmp4") {
+        segmenter = new SrsDvrFmp4Segmenter();
+    } else if (format == "mp4") {
         segmenter = new SrsDvrMp4Segmenter();
     } else {
         segmenter = new SrsDvrFlvSegmenter();
@@ -25,6 +25,7 @@ class SrsJsonAny;
 class SrsJsonObject;
 class SrsThread;
 class SrsMp4Encoder;
+class SrsMp4FragmentEncoder;
 class SrsFragment;
 class SrsFormat;
 
@@ -42,8 +43,8 @@ protected:
     bool wait_keyframe;
     // The FLV/MP4 fragment file.
     SrsFragment* fragment;
-private:
     SrsRequest* req;
+private:
     SrsDvrPlan* plan;
 private:
     SrsRtmpJitter* jitter;
@@ -138,6 +139,33 @@ protected:
     virtual srs_error_t close_encoder();
 };
 
+// The segmenter for DVR, to write to fragmented MP4 file.
+class SrsDvrFmp4Segmenter : public SrsDvrSegmenter
+{
+private:
+    // The fMP4 encoder, for fMP4 target.
+    SrsMp4FragmentEncoder* enc;
+    // Whether the ftyp and moov is writen.
+    bool has_header;
+    // Whether got the first keyframe, the first fragment must start with keyframe.
+    bool has_keyframe;
+    // The timestamp of first frame in ms, to bound the wait for sequence header of both tracks, -1 if none.
+    int64_t wait_start;
+public:
+    SrsDvrFmp4Segmenter();
+    virtual ~SrsDvrFmp4Segmenter();
+public:
+    virtual srs_error_t refresh_metadata();
+protected:
+    virtual srs_error_t open_encoder();
+    virtual srs_error_t encode_metadata(SrsSharedPtrMessage* metadata);
+    virtual srs_error_t encode_audio(SrsSharedPtrMessage* audio, SrsFormat* format);
+    virtual srs_error_t encode_video(SrsSharedPtrMessage* video, SrsFormat* format);
+    virtual srs_error_t close_encoder();
+private:
+    virtual srs_error_t write_header(SrsFormat* format, int64_t timestamp);
+};
+
 // the dvr async call.
 class SrsDvrAsyncCallOnDvr : public ISrsAsyncCallTask
 {
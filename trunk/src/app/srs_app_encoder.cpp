@@ -136,12 +136,19 @@ void SrsEncoder::clear_engines()
     for (it = ffmpegs.begin(); it != ffmpegs.end(); ++it) {
         SrsFFMPEG* ffmpeg = *it;
         
-        std::string output = ffmpeg->output();
+        // The outputs of this ffmpeg, including all ABR renditions.
+        std::vector<std::string> outputs;
+        outputs.push_back(ffmpeg->output());
+        for (int i = 0; i < (int)ffmpeg->renditions().size(); i++) {
+            outputs.push_back(ffmpeg->renditions().at(i)->output());
+        }
         
-        std::vector<std::string>::iterator tu_it;
-        tu_it = std::find(_transcoded_url.begin(), _transcoded_url.end(), output);
-        if (tu_it != _transcoded_url.end()) {
-            _transcoded_url.erase(tu_it);
+        for (int i = 0; i < (int)outputs.size(); i++) {
+            std::vector<std::string>::iterator tu_it;
+            tu_it = std::find(_transcoded_url.begin(), _transcoded_url.end(), outputs.at(i));
+            if (tu_it != _transcoded_url.end()) {
+                _transcoded_url.erase(tu_it);
+            }
         }
         
         srs_freep(ffmpeg);
@@ -214,6 +221,10 @@ srs_error_t SrsEncoder::parse_ffmpeg(SrsRequest* req, SrsConfDirective* conf)
         return err;
     }
     
+    // For ABR, all engines are renditions of the first one, in the same ffmpeg process.
+    bool abr = _srs_config->get_transcode_abr(conf);
+    SrsFFMPEG* primary = NULL;
+    
     // create engine
     for (int i = 0; i < (int)engines.size(); i++) {
         SrsConfDirective* engine = engines[i];
@@ -228,7 +239,13 @@ srs_error_t SrsEncoder::parse_ffmpeg(SrsRequest* req, SrsConfDirective* conf)
             return srs_error_wrap(err, "init ffmpeg");
         }
         
+        if (abr && primary) {
+            primary->append_rendition(ffmpeg);
+            continue;
+        }
+        
         ffmpegs.push_back(ffmpeg);
+        primary = ffmpeg;
     }
     
     return err;
@@ -313,9 +330,18 @@ void SrsEncoder::show_encode_log_message()
     
     // reportable
     if (pprint->can_print()) {
+        // The cpu usage of each ffmpeg process, which is the cost of all renditions for ABR.
+        std::string cpus;
+        std::vector<SrsFFMPEG*>::iterator it;
+        for (it = ffmpegs.begin(); it != ffmpegs.end(); ++it) {
+            SrsFFMPEG* ffmpeg = *it;
+            cpus += srs_fmt("%s%d:%.2f%%/%d", cpus.empty() ? "" : ",", ffmpeg->get_pid(),
+                ffmpeg->cpu_percent() * 100, (int)ffmpeg->renditions().size() + 1);
+        }
+        
         // TODO: FIXME: show more info.
-        srs_trace("-> " SRS_CONSTS_LOG_ENCODER " time=%" PRId64 ", encoders=%d, input=%s",
-                  pprint->age(), (int)ffmpegs.size(), input_stream_name.c_str());
+        srs_trace("-> " SRS_CONSTS_LOG_ENCODER " time=%" PRId64 ", encoders=%d, input=%s, cpu=[%s]",
+                  pprint->age(), (int)ffmpegs.size(), input_stream_name.c_str(), cpus.c_str());
     }
 }
 
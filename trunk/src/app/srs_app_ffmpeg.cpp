@@ -56,6 +56,7 @@ SrsFFMPEG::SrsFFMPEG(std::string ffmpeg_bin)
     achannels = 0;
     
     process = new SrsProcess();
+    stat_ = new SrsProcSelfStat();
 }
 
 SrsFFMPEG::~SrsFFMPEG()
@@ -63,6 +64,14 @@ SrsFFMPEG::~SrsFFMPEG()
     stop();
     
     srs_freep(process);
+    srs_freep(stat_);
+    
+    std::vector<SrsFFMPEG*>::iterator it;
+    for (it = renditions_.begin(); it != renditions_.end(); ++it) {
+        SrsFFMPEG* rendition = *it;
+        srs_freep(rendition);
+    }
+    renditions_.clear();
 }
 
 void SrsFFMPEG::append_iparam(string iparam)
@@ -80,6 +89,30 @@ string SrsFFMPEG::output()
     return _output;
 }
 
+void SrsFFMPEG::append_rendition(SrsFFMPEG* rendition)
+{
+    renditions_.push_back(rendition);
+}
+
+vector<SrsFFMPEG*>& SrsFFMPEG::renditions()
+{
+    return renditions_;
+}
+
+float SrsFFMPEG::cpu_percent()
+{
+    if (!process->started() || !srs_update_process_stat(process->get_pid(), *stat_)) {
+        return 0;
+    }
+    
+    return stat_->percent;
+}
+
+int SrsFFMPEG::get_pid()
+{
+    return process->get_pid();
+}
+
 srs_error_t SrsFFMPEG::initialize(string in, string out, string log)
 {
     srs_error_t err = srs_success;
@@ -240,6 +273,57 @@ srs_error_t SrsFFMPEG::start()
     params.push_back("-i");
     params.push_back(input);
     
+    // output for this engine, then all renditions share the same input.
+    append_output_params(params);
+    
+    std::vector<SrsFFMPEG*>::iterator it;
+    for (it = renditions_.begin(); it != renditions_.end(); ++it) {
+        SrsFFMPEG* rendition = *it;
+        rendition->append_output_params(params);
+    }
+    
+    // when specified the log file.
+    if (!log_file.empty()) {
+        // stdout
+        params.push_back("1");
+        params.push_back(">");
+        params.push_back(log_file);
+        // stderr
+        params.push_back("2");
+        params.push_back(">");
+        params.push_back(log_file);
+    }
+    
+    // initialize the process.
+    if ((err = process->initialize(ffmpeg, params)) != srs_success) {
+        return srs_error_wrap(err, "init process");
+    }
+    
+    return process->start();
+}
+
+srs_error_t SrsFFMPEG::cycle()
+{
+    return process->cycle();
+}
+
+void SrsFFMPEG::stop()
+{
+    process->stop();
+}
+
+void SrsFFMPEG::fast_stop()
+{
+    process->fast_stop();
+}
+
+void SrsFFMPEG::fast_kill()
+{
+    process->fast_kill();
+}
+
+void SrsFFMPEG::append_output_params(vector<string>& params)
+{
     // build the filter
     if (!vfilter.empty()) {
         std::vector<std::string>::iterator it;
@@ -368,45 +452,6 @@ srs_error_t SrsFFMPEG::start()
     
     params.push_back("-y");
     params.push_back(_output);
-    
-    // when specified the log file.
-    if (!log_file.empty()) {
-        // stdout
-        params.push_back("1");
-        params.push_back(">");
-        params.push_back(log_file);
-        // stderr
-        params.push_back("2");
-        params.push_back(">");
-        params.push_back(log_file);
-    }
-    
-    // initialize the process.
-    if ((err = process->initialize(ffmpeg, params)) != srs_success) {
-        return srs_error_wrap(err, "init process");
-    }
-    
-    return process->start();
-}
-
-srs_error_t SrsFFMPEG::cycle()
-{
-    return process->cycle();
-}
-
-void SrsFFMPEG::stop()
-{
-    process->stop();
-}
-
-void SrsFFMPEG::fast_stop()
-{
-    process->fast_stop();
-}
-
-void SrsFFMPEG::fast_kill()
-{
-    process->fast_kill();
 }
 
 #endif
@@ -17,6 +17,7 @@
 class SrsConfDirective;
 class SrsPithyPrint;
 class SrsProcess;
+class SrsProcSelfStat;
 
 // A transcode engine: ffmepg, used to transcode a stream to another.
 class SrsFFMPEG
@@ -49,6 +50,12 @@ private:
     std::vector<std::string>    aparams;
     std::string                 oformat;
     std::string                 _output;
+private:
+    // The renditions share the input of this FFmpeg process, which decodes the input only once,
+    // then encodes for each rendition, see https://trac.ffmpeg.org/wiki/Creating%20multiple%20outputs
+    std::vector<SrsFFMPEG*>     renditions_;
+    // The cpu stat of the FFmpeg process, for all renditions.
+    SrsProcSelfStat*            stat_;
 public:
     SrsFFMPEG(std::string ffmpeg_bin);
     virtual ~SrsFFMPEG();
@@ -56,6 +63,13 @@ public:
     virtual void append_iparam(std::string iparam);
     virtual void set_oformat(std::string format);
     virtual std::string output();
+    // Append a rendition to encode in this process, which is freed by this FFmpeg.
+    // @remark The rendition should be initialized by initialize_transcode, and its input params are ignored.
+    virtual void append_rendition(SrsFFMPEG* rendition);
+    virtual std::vector<SrsFFMPEG*>& renditions();
+    // Sample and get the cpu usage of the process in percent, 0.153 is 15.3%.
+    virtual float cpu_percent();
+    virtual int get_pid();
 public:
     virtual srs_error_t initialize(std::string in, std::string out, std::string log);
     virtual srs_error_t initialize_transcode(SrsConfDirective* engine);
@@ -67,6 +81,9 @@ public:
 public:
     virtual void fast_stop();
     virtual void fast_kill();
+private:
+    // Append the params for output, such as the codec params and output url.
+    virtual void append_output_params(std::vector<std::string>& params);
 };
 
 #endif
@@ -167,6 +167,104 @@ srs_error_t srs_api_response_code(ISrsHttpResponseWriter* w, ISrsHttpMessage* r,
     return err;
 }
 
+// The max number of streams or clients to dump in a batch, then flush to client.
+#define SRS_API_DUMPS_BATCH 100
+
+// Start to response the JSON in chunked encoding, because the size is unknown, for example, dumps all clients.
+static srs_error_t srs_api_chunked_start(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, SrsJsonWriter* jw)
+{
+    SrsHttpHeader* h = w->header();
+
+    if (r->is_jsonp()) {
+        h->set_content_type("text/javascript");
+        jw->buffer().append(r->query_get("callback")).append("(");
+    } else if (h->content_type().empty()) {
+        h->set_content_type("application/json");
+    }
+
+    // Write header without content length, to use chunked encoding.
+    w->write_header(SRS_CONSTS_HTTP_OK);
+
+    return srs_success;
+}
+
+static srs_error_t srs_api_chunked_flush(ISrsHttpResponseWriter* w, SrsJsonWriter* jw)
+{
+    srs_error_t err = srs_success;
+
+    if (!jw->size()) {
+        return err;
+    }
+
+    if ((err = w->write((char*)jw->buffer().data(), jw->size())) != srs_success) {
+        return srs_error_wrap(err, "write json");
+    }
+
+    jw->clear();
+    return err;
+}
+
+static srs_error_t srs_api_chunked_end(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, SrsJsonWriter* jw)
+{
+    srs_error_t err = srs_success;
+
+    if (r->is_jsonp()) {
+        jw->buffer().append(")");
+    }
+
+    if ((err = srs_api_chunked_flush(w, jw)) != srs_success) {
+        return srs_error_wrap(err, "flush");
+    }
+
+    // Write the last chunk.
+    if ((err = w->final_request()) != srs_success) {
+        return srs_error_wrap(err, "final request");
+    }
+
+    return err;
+}
+
+// Dump the common fields of service to JSON object.
+static void srs_api_dumps_service(SrsJsonWriter* jw, SrsStatistic* stat)
+{
+    jw->key("code")->integer(ERROR_SUCCESS);
+    jw->key("server")->str(stat->server_id());
+    jw->key("service")->str(stat->service_id());
+    jw->key("pid")->str(stat->service_pid());
+}
+
+// Dumps the streams or clients in batches, and flush each batch, so that we never build the whole response
+// in memory, for a huge number of clients.
+static srs_error_t srs_api_dumps_batches(ISrsHttpResponseWriter* w, SrsJsonWriter* jw,
+    srs_error_t (SrsStatistic::*dumps)(SrsJsonWriter*, std::string, int, int, std::string&),
+    string cursor, int start, int count, string& next)
+{
+    srs_error_t err = srs_success;
+
+    SrsStatistic* stat = SrsStatistic::instance();
+
+    while (count > 0) {
+        int batch = srs_min(count, SRS_API_DUMPS_BATCH);
+        if ((err = (stat->*dumps)(jw, cursor, start, batch, next)) != srs_success) {
+            return srs_error_wrap(err, "dumps cursor=%s, start=%d, count=%d", cursor.c_str(), start, batch);
+        }
+
+        if ((err = srs_api_chunked_flush(w, jw)) != srs_success) {
+            return srs_error_wrap(err, "flush");
+        }
+
+        count -= batch;
+        if (next.empty()) {
+            break;
+        }
+
+        // Use the cursor for next batch, which ignores the start.
+        cursor = next;
+    }
+
+    return err;
+}
+
 SrsGoApiRoot::SrsGoApiRoot()
 {
 }
@@ -777,43 +875,47 @@ srs_error_t SrsGoApiStreams::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
         return srs_api_response_code(w, r, ERROR_RTMP_STREAM_NOT_FOUND);
     }
     
-    SrsJsonObject* obj = SrsJsonAny::object();
-    SrsAutoFree(SrsJsonObject, obj);
-    
-    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
-    obj->set("server", SrsJsonAny::str(stat->server_id().c_str()));
-    obj->set("service", SrsJsonAny::str(stat->service_id().c_str()));
-    obj->set("pid", SrsJsonAny::str(stat->service_pid().c_str()));
-    
-    if (r->is_http_get()) {
-        if (!stream) {
-            SrsJsonArray* data = SrsJsonAny::array();
-            obj->set("streams", data);
+    if (!r->is_http_get()) {
+        return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
+    }
 
-            std::string rstart = r->query_get("start");
-            std::string rcount = r->query_get("count");
-            int start = srs_max(0, atoi(rstart.c_str()));
-            int count = srs_max(10, atoi(rcount.c_str()));
-            if ((err = stat->dumps_streams(data, start, count)) != srs_success) {
-                int code = srs_error_code(err);
-                srs_error_reset(err);
-                return srs_api_response_code(w, r, code);
-            }
-        } else {
-            SrsJsonObject* data = SrsJsonAny::object();
-            obj->set("stream", data);;
-            
-            if ((err = stream->dumps(data)) != srs_success) {
-                int code = srs_error_code(err);
-                srs_error_reset(err);
-                return srs_api_response_code(w, r, code);
-            }
+    // Serialize the streams to response directly, in chunked encoding.
+    SrsJsonWriter jw;
+    if ((err = srs_api_chunked_start(w, r, &jw)) != srs_success) {
+        return srs_error_wrap(err, "start");
+    }
+
+    jw.object_start();
+    srs_api_dumps_service(&jw, stat);
+
+    if (!stream) {
+        // The cursor is the id of last stream in previous page, see the next field in response.
+        std::string cursor = r->query_get("cursor");
+        std::string rstart = r->query_get("start");
+        std::string rcount = r->query_get("count");
+        int start = srs_max(0, atoi(rstart.c_str()));
+        int count = srs_max(10, atoi(rcount.c_str()));
+
+        std::string next;
+        jw.key("streams")->array_start();
+        if ((err = srs_api_dumps_batches(w, &jw, &SrsStatistic::dumps_streams, cursor, start, count, next)) != srs_success) {
+            return srs_error_wrap(err, "dumps streams");
+        }
+        jw.array_end();
+
+        if (!next.empty()) {
+            jw.key("next")->str(next);
         }
     } else {
-        return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
+        jw.key("stream");
+        if ((err = stream->dumps(&jw)) != srs_success) {
+            return srs_error_wrap(err, "dumps stream");
+        }
     }
+
+    jw.object_end();
     
-    return srs_api_response(w, r, obj->dumps());
+    return srs_api_chunked_end(w, r, &jw);
 }
 
 SrsGoApiClients::SrsGoApiClients()
@@ -839,39 +941,7 @@ srs_error_t SrsGoApiClients::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
         return srs_api_response_code(w, r, ERROR_RTMP_CLIENT_NOT_FOUND);
     }
     
-    SrsJsonObject* obj = SrsJsonAny::object();
-    SrsAutoFree(SrsJsonObject, obj);
-    
-    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
-    obj->set("server", SrsJsonAny::str(stat->server_id().c_str()));
-    obj->set("service", SrsJsonAny::str(stat->service_id().c_str()));
-    obj->set("pid", SrsJsonAny::str(stat->service_pid().c_str()));
-    
-    if (r->is_http_get()) {
-        if (!client) {
-            SrsJsonArray* data = SrsJsonAny::array();
-            obj->set("clients", data);
-            
-            std::string rstart = r->query_get("start");
-            std::string rcount = r->query_get("count");
-            int start = srs_max(0, atoi(rstart.c_str()));
-            int count = srs_max(10, atoi(rcount.c_str()));
-            if ((err = stat->dumps_clients(data, start, count)) != srs_success) {
-                int code = srs_error_code(err);
-                srs_error_reset(err);
-                return srs_api_response_code(w, r, code);
-            }
-        } else {
-            SrsJsonObject* data = SrsJsonAny::object();
-            obj->set("client", data);
-            
-            if ((err = client->dumps(data)) != srs_success) {
-                int code = srs_error_code(err);
-                srs_error_reset(err);
-                return srs_api_response_code(w, r, code);
-            }
-        }
-    } else if (r->is_http_delete()) {
+    if (r->is_http_delete()) {
         if (!client) {
             return srs_api_response_code(w, r, ERROR_RTMP_CLIENT_NOT_FOUND);
         }
@@ -883,11 +953,56 @@ srs_error_t SrsGoApiClients::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
             srs_error("kickoff client id=%s error", client_id.c_str());
             return srs_api_response_code(w, r, SRS_CONSTS_HTTP_BadRequest);
         }
-    } else {
+
+        SrsJsonWriter jw;
+        jw.object_start();
+        srs_api_dumps_service(&jw, stat);
+        jw.object_end();
+
+        return srs_api_response(w, r, jw.buffer());
+    }
+
+    if (!r->is_http_get()) {
         return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
     }
+
+    // Serialize the clients to response directly, in chunked encoding.
+    SrsJsonWriter jw;
+    if ((err = srs_api_chunked_start(w, r, &jw)) != srs_success) {
+        return srs_error_wrap(err, "start");
+    }
+
+    jw.object_start();
+    srs_api_dumps_service(&jw, stat);
+
+    if (!client) {
+        // The cursor is the id of last client in previous page, see the next field in response.
+        std::string cursor = r->query_get("cursor");
+        std::string rstart = r->query_get("start");
+        std::string rcount = r->query_get("count");
+        int start = srs_max(0, atoi(rstart.c_str()));
+        int count = srs_max(10, atoi(rcount.c_str()));
+
+        std::string next;
+        jw.key("clients")->array_start();
+        if ((err = srs_api_dumps_batches(w, &jw, &SrsStatistic::dumps_clients, cursor, start, count, next)) != srs_success) {
+            return srs_error_wrap(err, "dumps clients");
+        }
+        jw.array_end();
+
+        if (!next.empty()) {
+            jw.key("next")->str(next);
+        }
+    } else {
+        jw.key("client");
+        if ((err = client->dumps(&jw)) != srs_success) {
+            return srs_error_wrap(err, "dumps client");
+        }
+    }
+
+    jw.object_end();
     
-    return srs_api_response(w, r, obj->dumps());
+    return srs_api_chunked_end(w, r, &jw);
 }
 
 SrsGoApiRaw::SrsGoApiRaw(SrsServer* svr)
@@ -989,10 +1104,16 @@ SrsGoApiClusters::~SrsGoApiClusters()
 
 srs_error_t SrsGoApiClusters::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
 {
+    // The stream updates pushed by coworker.
+    if (r->is_http_post() && r->query_get("action") == "update") {
+        return serve_update(w, r);
+    }
+
     SrsJsonObject* obj = SrsJsonAny::object();
     SrsAutoFree(SrsJsonObject, obj);
     
     obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+    obj->set("server", SrsJsonAny::str(SrsStatistic::instance()->server_id().c_str()));
     SrsJsonObject* data = SrsJsonAny::object();
     obj->set("data", data);
     
@@ -1013,6 +1134,40 @@ srs_error_t SrsGoApiClusters::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
     return srs_api_response(w, r, obj->dumps());
 }
 
+srs_error_t SrsGoApiClusters::serve_update(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+
+    string body;
+    if ((err = r->body_read_all(body)) != srs_success) {
+        return srs_api_response_code(w, r, srs_error_wrap(err, "read body"));
+    }
+
+    SrsJsonAny* info = SrsJsonAny::loads(body);
+    SrsAutoFree(SrsJsonAny, info);
+    if (!info || !info->is_object()) {
+        return srs_api_response_code(w, r, srs_error_new(ERROR_OCLUSTER_DISCOVER, "invalid body %s", body.c_str()));
+    }
+
+    // Use the address of coworker, if it listens at any address.
+    SrsHttpMessage* hr = dynamic_cast<SrsHttpMessage*>(r);
+    string ip = (hr && hr->connection()) ? hr->connection()->remote_ip() : "";
+
+    SrsCoWorkers* coworkers = SrsCoWorkers::instance();
+    if ((err = coworkers->on_update(info->to_object(), ip)) != srs_success) {
+        return srs_api_response_code(w, r, srs_error_wrap(err, "update"));
+    }
+
+    // Response with server id, for the coworker to identify whether it's pushing to itself.
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+
+    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+    obj->set("server", SrsJsonAny::str(SrsStatistic::instance()->server_id().c_str()));
+
+    return srs_api_response(w, r, obj->dumps());
+}
+
 SrsGoApiError::SrsGoApiError()
 {
 }
@@ -1113,11 +1268,15 @@ srs_error_t SrsGoApiTcmalloc::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
 #endif
 
 
+// The metrics is rebuilt by scrape when older than this.
+#define SRS_METRICS_CACHE_TTL (1 * SRS_UTIME_SECONDS)
+
 SrsGoApiMetrics::SrsGoApiMetrics()
 {
     enabled_ = _srs_config->get_exporter_enabled();
     label_ = _srs_config->get_exporter_label();
     tag_ = _srs_config->get_exporter_tag();
+    updated_at_ = 0;
 }
 
 SrsGoApiMetrics::~SrsGoApiMetrics()
@@ -1131,6 +1290,21 @@ srs_error_t SrsGoApiMetrics::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
         return srs_api_response_code(w, r, ERROR_EXPORTER_DISABLED);
     }
 
+    // Rebuild the metrics only when expired, so the cost is bounded however many scrapers, and nothing to do
+    // when no scraper.
+    srs_utime_t now = srs_get_system_time();
+    if (metrics_.empty() || now - updated_at_ >= SRS_METRICS_CACHE_TTL) {
+        update_metrics();
+        updated_at_ = now;
+    }
+
+    w->header()->set_content_type("text/plain; charset=utf-8");
+
+    return srs_api_response(w, r, metrics_);
+}
+
+void SrsGoApiMetrics::update_metrics()
+{
     /*
      * node_uname gauge
      * build_info gauge
@@ -1142,39 +1316,49 @@ srs_error_t SrsGoApiMetrics::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
      * clients gauge
      * clients_total counter
      * error counter
+     * stream_residence_us summary
     */
 
     SrsStatistic* stat = SrsStatistic::instance();
-    std::stringstream ss;
 
-    #if defined(__linux__) || defined(SRS_OSX)
-        // Get system info
-        utsname* system_info = srs_get_system_uname_info();
-        ss << "# HELP srs_node_uname_info Labeled system information as provided by the uname system call.\n"
-            << "# TYPE srs_node_uname_info gauge\n"
-            << "srs_node_uname_info{"
-                << "sysname=\"" << system_info->sysname << "\","
-                << "nodename=\"" << system_info->nodename << "\","
-                << "release=\"" << system_info->release << "\","
-                << "version=\"" << system_info->version << "\","
-                << "machine=\"" << system_info->machine << "\""
-            << "} 1\n";
-    #endif
-
-    // Build info from Config.
-    ss << "# HELP srs_build_info A metric with a constant '1' value labeled by build_date, version from which SRS was built.\n"
-        << "# TYPE srs_build_info gauge\n"
-        << "srs_build_info{"
-            << "server=\"" << stat->server_id() << "\","
-            << "service=\"" << stat->service_id() << "\","
-            << "pid=\"" << stat->service_pid() << "\","
-            << "build_date=\"" << SRS_BUILD_DATE << "\","
-            << "major=\"" << VERSION_MAJOR << "\","
-            << "version=\"" << RTMP_SIG_SRS_VERSION << "\","
-            << "code=\"" << RTMP_SIG_SRS_CODE<< "\"";
-    if (!label_.empty()) ss << ",label=\"" << label_ << "\"";
-    if (!tag_.empty()) ss << ",tag=\"" << tag_ << "\"";
-    ss << "} 1\n";
+    // The system and build info never change, so build it once.
+    if (constants_.empty()) {
+        std::stringstream ss;
+
+        #if defined(__linux__) || defined(SRS_OSX)
+            // Get system info
+            utsname* system_info = srs_get_system_uname_info();
+            ss << "# HELP srs_node_uname_info Labeled system information as provided by the uname system call.\n"
+                << "# TYPE srs_node_uname_info gauge\n"
+                << "srs_node_uname_info{"
+                    << "sysname=\"" << system_info->sysname << "\","
+                    << "nodename=\"" << system_info->nodename << "\","
+                    << "release=\"" << system_info->release << "\","
+                    << "version=\"" << system_info->version << "\","
+                    << "machine=\"" << system_info->machine << "\""
+                << "} 1\n";
+        #endif
+
+        // Build info from Config.
+        ss << "# HELP srs_build_info A metric with a constant '1' value labeled by build_date, version from which SRS was built.\n"
+            << "# TYPE srs_build_info gauge\n"
+            << "srs_build_info{"
+                << "server=\"" << stat->server_id() << "\","
+                << "service=\"" << stat->service_id() << "\","
+                << "pid=\"" << stat->service_pid() << "\","
+                << "build_date=\"" << SRS_BUILD_DATE << "\","
+                << "major=\"" << VERSION_MAJOR << "\","
+                << "version=\"" << RTMP_SIG_SRS_VERSION << "\","
+                << "code=\"" << RTMP_SIG_SRS_CODE<< "\"";
+        if (!label_.empty()) ss << ",label=\"" << label_ << "\"";
+        if (!tag_.empty()) ss << ",tag=\"" << tag_ << "\"";
+        ss << "} 1\n";
+
+        constants_ = ss.str();
+    }
+
+    std::stringstream ss;
+    ss << constants_;
 
     // Get ProcSelfStat
     SrsProcSelfStat* u = srs_get_self_proc_stat();
@@ -1240,7 +1424,8 @@ srs_error_t SrsGoApiMetrics::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
        << nerrs
        << "\n";
 
-    w->header()->set_content_type("text/plain; charset=utf-8");
+    // The residence time of messages for each stream.
+    stat->dumps_residence_metrics(ss);
 
-    return srs_api_response(w, r, ss.str());
+    metrics_ = ss.str();
 }
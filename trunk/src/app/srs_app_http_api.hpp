@@ -194,6 +194,8 @@ public:
     virtual ~SrsGoApiClusters();
 public:
     virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+private:
+    virtual srs_error_t serve_update(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
 };
 
 class SrsGoApiError : public ISrsHttpHandler
@@ -222,11 +224,19 @@ private:
     bool enabled_;
     std::string label_;
     std::string tag_;
+private:
+    // The metrics which never change, such as build info.
+    std::string constants_;
+    // The cached metrics, rebuilt by scrape when expired, so the scrapes in a short time share it.
+    std::string metrics_;
+    srs_utime_t updated_at_;
 public:
     SrsGoApiMetrics();
     virtual ~SrsGoApiMetrics();
 public:
     virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+private:
+    void update_metrics();
 };
 
 #endif
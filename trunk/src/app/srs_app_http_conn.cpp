@@ -422,8 +422,8 @@ srs_error_t SrsHttpxConn::on_conn_done(srs_error_t r0)
 {
     // Only stat the HTTP streaming clients, ignore all API clients.
     if (enable_stat_) {
+        SrsStatistic::instance()->kbps_add_delta(stat_handle_, get_id(), conn->delta());
         SrsStatistic::instance()->on_disconnect(get_id().c_str(), r0);
-        SrsStatistic::instance()->kbps_add_delta(get_id().c_str(), conn->delta());
     }
 
     // Because we use manager to manage this object,
@@ -480,6 +480,11 @@ ISrsKbpsDelta* SrsHttpxConn::delta()
     return conn->delta();
 }
 
+SrsStatisticHandle& SrsHttpxConn::stat_handle()
+{
+    return stat_handle_;
+}
+
 SrsHttpServer::SrsHttpServer(SrsServer* svr)
 {
     server = svr;
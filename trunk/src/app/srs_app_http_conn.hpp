@@ -19,6 +19,7 @@
 #include <srs_app_st.hpp>
 #include <srs_app_conn.hpp>
 #include <srs_app_source.hpp>
+#include <srs_app_statistic.hpp>
 
 class SrsServer;
 class SrsLiveSource;
@@ -136,6 +137,8 @@ private:
     SrsHttpConn* conn;
     // We should never enable the stat, unless HTTP stream connection requires.
     bool enable_stat_;
+    // The handle of client in statistic.
+    SrsStatisticHandle stat_handle_;
 public:
     SrsHttpxConn(bool https, ISrsResourceManager* cm, ISrsProtocolReadWriter* io, ISrsHttpServeMux* m, std::string cip, int port);
     virtual ~SrsHttpxConn();
@@ -166,6 +169,7 @@ public:
     virtual srs_error_t start();
 public:
     ISrsKbpsDelta* delta();
+    SrsStatisticHandle& stat_handle();
 };
 
 // The http server, use http stream or static server to serve requests.
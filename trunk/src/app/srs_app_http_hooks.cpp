@@ -478,7 +478,8 @@ srs_error_t SrsHttpHooks::on_hls_notify(SrsContextId c, std::string url, SrsRequ
     return srs_success;
 }
 
-srs_error_t SrsHttpHooks::discover_co_workers(string url, string& host, int& port)
+srs_error_t SrsHttpHooks::discover_co_workers(string url, string& host, int& port, string& server_id,
+    int64_t& epoch, int64_t& version)
 {
     srs_error_t err = srs_success;
     
@@ -508,6 +509,10 @@ srs_error_t SrsHttpHooks::discover_co_workers(string url, string& host, int& por
     }
     
     SrsJsonAny* prop = NULL;
+    if ((prop = robj->ensure_property_string("server")) != NULL) {
+        server_id = prop->to_str();
+    }
+
     if ((prop = robj->ensure_property_object("data")) == NULL) {
         return srs_error_new(ERROR_OCLUSTER_DISCOVER, "parse data %s", res.c_str());
     }
@@ -527,6 +532,14 @@ srs_error_t SrsHttpHooks::discover_co_workers(string url, string& host, int& por
         return srs_error_new(ERROR_OCLUSTER_DISCOVER, "parse data %s", res.c_str());
     }
     port = (int)prop->to_integer();
+
+    // The version of stream on origin, to identify the origin when it unpublish.
+    if ((prop = p->ensure_property_integer("epoch")) != NULL) {
+        epoch = prop->to_integer();
+    }
+    if ((prop = p->ensure_property_integer("version")) != NULL) {
+        version = prop->to_integer();
+    }
     
     srs_trace("http: cluster redirect %s:%d ok, url=%s, response=%s", host.c_str(), port, url.c_str(), res.c_str());
     
@@ -79,7 +79,11 @@ public:
     // @param cid the source connection cid, for the on_dvr is async call.
     static srs_error_t on_hls_notify(SrsContextId cid, std::string url, SrsRequest* req, std::string ts_url, int nb_notify);
     // Discover co-workers for origin cluster.
-    static srs_error_t discover_co_workers(std::string url, std::string& host, int& port);
+    // @param server_id the server id of coworker, to identify whether it's ourself.
+    // @param epoch the epoch of stream on origin, 0 if the origin doesn't respond it.
+    // @param version the version of stream on origin, 0 if the origin doesn't respond it.
+    static srs_error_t discover_co_workers(std::string url, std::string& host, int& port, std::string& server_id,
+        int64_t& epoch, int64_t& version);
     // The on_forward_backend hook, when publish stream start to forward
     // @param url the api server url, to valid the client.
     //         ignore if empty.
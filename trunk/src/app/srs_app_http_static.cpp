@@ -127,9 +127,15 @@ srs_error_t SrsHlsStream::serve_m3u8_ctx(ISrsHttpResponseWriter* w, ISrsHttpMess
 void SrsHlsStream::on_serve_ts_ctx(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
 {
     string ctx = r->query_get(SRS_CONTEXT_IN_HLS);
-    if (ctx.empty() || !ctx_is_exist(ctx)) {
+    if (ctx.empty()) {
+        return;
+    }
+
+    std::map<std::string, SrsHlsVirtualConn*>::iterator it = map_ctx_info_.find(ctx);
+    if (it == map_ctx_info_.end()) {
         return;
     }
+    SrsHlsVirtualConn* conn = it->second;
 
     SrsHttpMessage* hr = dynamic_cast<SrsHttpMessage*>(r);
     srs_assert(hr);
@@ -142,8 +148,8 @@ void SrsHlsStream::on_serve_ts_ctx(ISrsHttpResponseWriter* w, ISrsHttpMessage* r
 
     // Only update the delta, because SrsServer will sample it. Note that SrsServer also does the stat for all clients
     // including this one, but it should be ignored because the id is not matched, and instead we use the hls_ctx as
-    // session id to match the client.
-    SrsStatistic::instance()->kbps_add_delta(ctx, delta);
+    // session id to match the client, by the handle of virtual connection.
+    SrsStatistic::instance()->kbps_add_delta(conn->stat_handle, SrsContextId().set_value(ctx), delta);
 }
 
 srs_error_t SrsHlsStream::serve_new_session(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, SrsRequest* req, std::string& ctx)
@@ -390,10 +396,22 @@ bool SrsHlsStream::is_interrupt(std::string id) {
 
 SrsVodStream::SrsVodStream(string root_dir) : SrsHttpFileServer(root_dir)
 {
+    _srs_hybrid->timer5s()->subscribe(this);
 }
 
 SrsVodStream::~SrsVodStream()
 {
+    _srs_hybrid->timer5s()->unsubscribe(this);
+}
+
+srs_error_t SrsVodStream::on_timer(srs_utime_t interval)
+{
+    srs_error_t err = srs_success;
+
+    // Close the fds of the expired HLS segments, which are removed but might never be requested again.
+    cache_->sweep();
+
+    return err;
 }
 
 srs_error_t SrsVodStream::serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, int64_t offset)
@@ -21,6 +21,8 @@ public:
     SrsRequest* req;
     std::string ctx;
     bool interrupt;
+    // The handle of stat client, whose id is the ctx.
+    SrsStatisticHandle stat_handle;
 public:
     SrsHlsVirtualConn();
     virtual ~SrsHlsVirtualConn();
@@ -57,13 +59,16 @@ private:
 };
 
 // The Vod streaming, like FLV, MP4 or HLS streaming.
-class SrsVodStream : public SrsHttpFileServer
+class SrsVodStream : public SrsHttpFileServer, public ISrsFastTimer
 {
 private:
     SrsHlsStream hls_;
 public:
     SrsVodStream(std::string root_dir);
     virtual ~SrsVodStream();
+// interface ISrsFastTimer
+private:
+    srs_error_t on_timer(srs_utime_t interval);
 protected:
     // The flv vod stream supports flv?start=offset-bytes.
     // For example, http://server/file.flv?start=10240
@@ -9,6 +9,22 @@
 #include <srs_kernel_codec.hpp>
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_threads.hpp>
+#include <srs_app_hybrid.hpp>
+
+#include <sys/time.h>
+#include <algorithm>
+
+// The max time for worker to park for audio frames, when all streams are idle.
+#define SRS_AUDIO_TRANSCODE_WAIT (1 * SRS_UTIME_SECONDS)
+// The timeout to dispose the transcoder released by bridge.
+#define SRS_AUDIO_TRANSCODE_IDLE_TIMEOUT (30 * SRS_UTIME_SECONDS)
+// The max number of pending frames for each stream, about 20s for AAC.
+#define SRS_AUDIO_TRANSCODE_QUEUE 1024
+
+SrsAudioTranscodeManager* _srs_audio_transcoders = NULL;
 
 static const AVCodec* srs_find_decoder_by_id(SrsAudioCodecId id)
 {
@@ -51,7 +67,8 @@ public:
 
     static void ffmpeg_log_callback(void*, int level, const char* fmt, va_list vl) 
     {
-        static char buf[4096] = {0};
+        // Note that it's called by audio transcode workers, so the buffer should be thread-local.
+        static __thread char buf[4096] = {0};
         int nbytes = vsnprintf(buf, sizeof(buf), fmt, vl);
         if (nbytes > 0 && nbytes < (int)sizeof(buf)) {
             // Srs log is always start with new line, replcae '\n' to '\0', make log easy to read.
@@ -172,7 +189,8 @@ srs_error_t SrsAudioTranscoder::transcode(SrsAudioFrame *in_pkt, std::vector<Srs
     return err;
 }
 
-void SrsAudioTranscoder::free_frames(std::vector<SrsAudioFrame*>& frames)
+// Free the frames and the bytes of samples.
+static void srs_audio_frames_free(std::vector<SrsAudioFrame*>& frames)
 {
     for (std::vector<SrsAudioFrame*>::iterator it = frames.begin(); it != frames.end(); ++it) {
         SrsAudioFrame* p = *it;
@@ -184,6 +202,22 @@ void SrsAudioTranscoder::free_frames(std::vector<SrsAudioFrame*>& frames)
 
         srs_freep(p);
     }
+    frames.clear();
+}
+
+// Get the realtime, because the cached system time is only updated by hybrid thread.
+static srs_utime_t srs_audio_transcode_now()
+{
+    timeval now;
+    if (::gettimeofday(&now, NULL) < 0) {
+        return 0;
+    }
+    return ((srs_utime_t)now.tv_sec) * SRS_UTIME_SECONDS + (srs_utime_t)now.tv_usec;
+}
+
+void SrsAudioTranscoder::free_frames(std::vector<SrsAudioFrame*>& frames)
+{
+    srs_audio_frames_free(frames);
 }
 
 void SrsAudioTranscoder::aac_codec_header(uint8_t **data, int *len)
@@ -471,3 +505,494 @@ void SrsAudioTranscoder::free_swr_samples()
     }
 }
 
+
+SrsAudioTranscodeTask::SrsAudioTranscodeTask(SrsAudioFrame* in)
+{
+    err = srs_success;
+    starttime = endtime = 0;
+    generation = 0;
+
+    frame = new SrsAudioFrame();
+    frame->dts = in->dts;
+    frame->cts = in->cts;
+
+    for (int i = 0; i < in->nb_samples; i++) {
+        SrsSample* sample = &in->samples[i];
+
+        char* bytes = new char[sample->size];
+        memcpy(bytes, sample->bytes, sample->size);
+
+        if ((err = frame->add_sample(bytes, sample->size)) != srs_success) {
+            srs_freepa(bytes);
+            break;
+        }
+    }
+}
+
+SrsAudioTranscodeTask::~SrsAudioTranscodeTask()
+{
+    std::vector<SrsAudioFrame*> frames;
+    frames.push_back(frame);
+    srs_audio_frames_free(frames);
+
+    srs_audio_frames_free(outs);
+    srs_freep(err);
+}
+
+SrsAsyncAudioTranscoder::SrsAsyncAudioTranscoder(std::string key, SrsAudioTranscodeWorker* worker)
+{
+    key_ = key;
+    idle_at_ = 0;
+    worker_ = worker;
+
+    codec_ = new SrsAudioTranscoder();
+    in_ = new SrsSpscQueue<SrsAudioTranscodeTask>(SRS_AUDIO_TRANSCODE_QUEUE);
+    // The out queue is larger than in queue, so the worker never fails to push, see submit.
+    out_ = new SrsSpscQueue<SrsAudioTranscodeTask>(SRS_AUDIO_TRANSCODE_QUEUE * 2);
+    generation_ = 0;
+
+    nn_frames_ = nn_dropped_ = 0;
+    nn_latency_ = 0;
+    latency_total_ = latency_max_ = 0;
+}
+
+SrsAsyncAudioTranscoder::~SrsAsyncAudioTranscoder()
+{
+    SrsAudioTranscodeTask* task = NULL;
+    while ((task = in_->pop()) != NULL) {
+        srs_freep(task);
+    }
+    while ((task = out_->pop()) != NULL) {
+        srs_freep(task);
+    }
+
+    srs_freep(in_);
+    srs_freep(out_);
+    srs_freep(codec_);
+}
+
+srs_error_t SrsAsyncAudioTranscoder::initialize(SrsAudioCodecId from, SrsAudioCodecId to, int channels, int sample_rate, int bit_rate)
+{
+    return codec_->initialize(from, to, channels, sample_rate, bit_rate);
+}
+
+srs_error_t SrsAsyncAudioTranscoder::submit(SrsAudioFrame* frame)
+{
+    srs_error_t err = srs_success;
+
+    SrsAudioTranscodeTask* task = new SrsAudioTranscodeTask(frame);
+    task->starttime = srs_audio_transcode_now();
+    task->generation = generation_;
+
+    // Transcode in hybrid thread, if no worker.
+    if (!worker_) {
+        if (task->err == srs_success) {
+            task->err = codec_->transcode(task->frame, task->outs);
+        }
+        task->endtime = srs_audio_transcode_now();
+
+        if (!out_->push(task)) {
+            srs_freep(task);
+            nn_dropped_++;
+        }
+        return err;
+    }
+
+    // Drop the frame if worker is overloaded. Note that the task being transcoded is in neither queue, so
+    // the out queue is larger than in queue to hold it.
+    if (in_->size() + out_->size() >= in_->capacity() || !in_->push(task)) {
+        srs_freep(task);
+        if ((nn_dropped_++ % 100) == 0) {
+            srs_warn("Audio: Drop frame for worker overloaded, key=%s, dropped=%" PRId64, key_.c_str(), nn_dropped_);
+        }
+        return err;
+    }
+
+    worker_->notify();
+
+    return err;
+}
+
+void SrsAsyncAudioTranscoder::consume(std::vector<SrsAudioTranscodeTask*>& tasks)
+{
+    SrsAudioTranscodeTask* task = NULL;
+    while ((task = out_->pop()) != NULL) {
+        // Drop the task submitted by the previous bridge, which is transcoded by worker after cleared.
+        if (task->generation != generation_) {
+            srs_freep(task);
+            continue;
+        }
+
+        srs_utime_t latency = srs_audio_transcode_now() - task->starttime;
+        latency_total_ += latency;
+        latency_max_ = srs_max(latency_max_, latency);
+        nn_latency_++;
+        nn_frames_++;
+
+        tasks.push_back(task);
+    }
+}
+
+void SrsAsyncAudioTranscoder::aac_codec_header(uint8_t** data, int* len)
+{
+    codec_->aac_codec_header(data, len);
+}
+
+int64_t SrsAsyncAudioTranscoder::nn_frames()
+{
+    return nn_frames_;
+}
+
+int64_t SrsAsyncAudioTranscoder::nn_dropped()
+{
+    return nn_dropped_;
+}
+
+void SrsAsyncAudioTranscoder::reset_latency(srs_utime_t& avg, srs_utime_t& max)
+{
+    avg = nn_latency_ ? latency_total_ / nn_latency_ : 0;
+    max = latency_max_;
+
+    nn_latency_ = 0;
+    latency_total_ = latency_max_ = 0;
+}
+
+void SrsAsyncAudioTranscoder::clear()
+{
+    SrsAudioTranscodeTask* task = NULL;
+    while ((task = out_->pop()) != NULL) {
+        srs_freep(task);
+    }
+
+    // The in queue is consumed by worker, so we can't drain it, but fence the tasks by generation.
+    generation_++;
+
+    nn_latency_ = 0;
+    latency_total_ = latency_max_ = 0;
+}
+
+bool SrsAsyncAudioTranscoder::transcode_pending()
+{
+    SrsAudioTranscodeTask* task = in_->pop();
+    if (!task) {
+        return false;
+    }
+
+    for (; task; task = in_->pop()) {
+        if (task->err == srs_success) {
+            task->err = codec_->transcode(task->frame, task->outs);
+        }
+        task->endtime = srs_audio_transcode_now();
+
+        if (!out_->push(task)) {
+            srs_freep(task);
+        }
+    }
+
+    return true;
+}
+
+bool SrsAsyncAudioTranscoder::has_pending()
+{
+    return in_->size() > 0;
+}
+
+SrsAudioTranscodeWorker::SrsAudioTranscodeWorker()
+{
+    lock_ = new SrsThreadMutex();
+    dirty_ = false;
+
+    notifier_ = new SrsThreadNotifier();
+    quit_ = false;
+    started_ = false;
+}
+
+SrsAudioTranscodeWorker::~SrsAudioTranscodeWorker()
+{
+    stop();
+
+    // The worker never runs now, so free the zombies left.
+    for (int i = 0; i < (int)zombies_.size(); i++) {
+        SrsAsyncAudioTranscoder* t = zombies_.at(i);
+        srs_freep(t);
+    }
+
+    srs_freep(notifier_);
+    srs_freep(lock_);
+}
+
+srs_error_t SrsAudioTranscodeWorker::start()
+{
+    srs_error_t err = srs_success;
+
+    if ((err = notifier_->initialize()) != srs_success) {
+        return srs_error_wrap(err, "init notifier");
+    }
+
+    if ((err = _srs_thread_pool->execute("audio", SrsAudioTranscodeWorker::start_thread, this, &trd_)) != srs_success) {
+        return srs_error_wrap(err, "start thread");
+    }
+    started_ = true;
+
+    return err;
+}
+
+void SrsAudioTranscodeWorker::stop()
+{
+    if (!started_) {
+        return;
+    }
+    started_ = false;
+
+    __atomic_store_n(&quit_, true, __ATOMIC_RELEASE);
+    notifier_->notify();
+    pthread_join(trd_, NULL);
+
+    // The streams still used by bridges, are transcoded in hybrid thread now.
+    for (int i = 0; i < (int)streams_.size(); i++) {
+        SrsAsyncAudioTranscoder* t = streams_.at(i);
+        t->worker_ = NULL;
+    }
+    streams_.clear();
+}
+
+void SrsAudioTranscodeWorker::notify()
+{
+    notifier_->notify();
+}
+
+void SrsAudioTranscodeWorker::attach(SrsAsyncAudioTranscoder* t)
+{
+    SrsThreadLocker(lock_);
+    streams_.push_back(t);
+    __atomic_store_n(&dirty_, true, __ATOMIC_RELEASE);
+}
+
+void SrsAudioTranscodeWorker::dispose(SrsAsyncAudioTranscoder* t)
+{
+    if (true) {
+        SrsThreadLocker(lock_);
+
+        std::vector<SrsAsyncAudioTranscoder*>::iterator it = std::find(streams_.begin(), streams_.end(), t);
+        if (it != streams_.end()) {
+            streams_.erase(it);
+        }
+
+        zombies_.push_back(t);
+        __atomic_store_n(&dirty_, true, __ATOMIC_RELEASE);
+    }
+
+    // Wakeup the worker to free the zombies.
+    notifier_->notify();
+}
+
+srs_error_t SrsAudioTranscodeWorker::start_thread(void* arg)
+{
+    SrsAudioTranscodeWorker* worker = (SrsAudioTranscodeWorker*)arg;
+    return worker->cycle();
+}
+
+srs_error_t SrsAudioTranscodeWorker::cycle()
+{
+    srs_error_t err = srs_success;
+
+    // The ST fd is thread-local, so open it in worker thread.
+    if ((err = notifier_->open()) != srs_success) {
+        return srs_error_wrap(err, "open notifier");
+    }
+
+    std::vector<SrsAsyncAudioTranscoder*> streams;
+
+    while (!__atomic_load_n(&quit_, __ATOMIC_ACQUIRE)) {
+        refresh(streams);
+
+        bool busy = false;
+        for (int i = 0; i < (int)streams.size(); i++) {
+            SrsAsyncAudioTranscoder* t = streams.at(i);
+            if (t->transcode_pending()) {
+                busy = true;
+            }
+        }
+
+        if (busy) {
+            continue;
+        }
+
+        // Check again after parked, or lost the notify when submitted before parked.
+        notifier_->park();
+
+        bool pending = __atomic_load_n(&quit_, __ATOMIC_ACQUIRE) || __atomic_load_n(&dirty_, __ATOMIC_ACQUIRE);
+        for (int i = 0; !pending && i < (int)streams.size(); i++) {
+            pending = streams.at(i)->has_pending();
+        }
+
+        if (pending) {
+            notifier_->unpark();
+            continue;
+        }
+
+        if ((err = notifier_->wait(SRS_AUDIO_TRANSCODE_WAIT)) != srs_success) {
+            return srs_error_wrap(err, "wait");
+        }
+    }
+
+    refresh(streams);
+
+    return err;
+}
+
+void SrsAudioTranscodeWorker::refresh(std::vector<SrsAsyncAudioTranscoder*>& streams)
+{
+    if (!__atomic_load_n(&dirty_, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    // Refresh the streams, then free the zombies, which never be used by worker now.
+    std::vector<SrsAsyncAudioTranscoder*> zombies;
+
+    if (true) {
+        SrsThreadLocker(lock_);
+        streams = streams_;
+        zombies.swap(zombies_);
+        __atomic_store_n(&dirty_, false, __ATOMIC_RELEASE);
+    }
+
+    for (int i = 0; i < (int)zombies.size(); i++) {
+        SrsAsyncAudioTranscoder* t = zombies.at(i);
+        srs_freep(t);
+    }
+}
+
+SrsAudioTranscodeManager::SrsAudioTranscodeManager()
+{
+    started_ = false;
+    next_worker_ = 0;
+}
+
+SrsAudioTranscodeManager::~SrsAudioTranscodeManager()
+{
+    std::map<std::string, SrsAsyncAudioTranscoder*>::iterator it;
+    for (it = idles_.begin(); it != idles_.end(); ++it) {
+        dispose(it->second);
+    }
+    idles_.clear();
+
+    // Stop and join the workers, which free the disposed transcoders before quit.
+    for (int i = 0; i < (int)workers_.size(); i++) {
+        SrsAudioTranscodeWorker* worker = workers_.at(i);
+        srs_freep(worker);
+    }
+    workers_.clear();
+
+    if (started_) {
+        _srs_hybrid->timer5s()->unsubscribe(this);
+    }
+}
+
+srs_error_t SrsAudioTranscodeManager::acquire(std::string key, SrsAudioCodecId from, SrsAudioCodecId to, int channels,
+    int sample_rate, int bit_rate, SrsAsyncAudioTranscoder** ptranscoder)
+{
+    srs_error_t err = srs_success;
+
+    if (!started_ && (err = start_workers()) != srs_success) {
+        return srs_error_wrap(err, "start workers");
+    }
+
+    // Reuse the decoder and encoder of stream, if the previous bridge is released.
+    std::map<std::string, SrsAsyncAudioTranscoder*>::iterator it = idles_.find(key);
+    if (it != idles_.end()) {
+        SrsAsyncAudioTranscoder* t = it->second;
+        idles_.erase(it);
+
+        t->clear();
+        *ptranscoder = t;
+        return err;
+    }
+
+    SrsAudioTranscodeWorker* worker = NULL;
+    if (!workers_.empty()) {
+        worker = workers_.at(next_worker_++ % workers_.size());
+    }
+
+    SrsAsyncAudioTranscoder* t = new SrsAsyncAudioTranscoder(key, worker);
+    if ((err = t->initialize(from, to, channels, sample_rate, bit_rate)) != srs_success) {
+        srs_freep(t);
+        return srs_error_wrap(err, "init transcoder key=%s", key.c_str());
+    }
+
+    // Attach to worker after initialized, because the worker might transcode it immediately.
+    if (worker) {
+        worker->attach(t);
+    }
+
+    *ptranscoder = t;
+    return err;
+}
+
+void SrsAudioTranscodeManager::release(SrsAsyncAudioTranscoder* t)
+{
+    if (!t) {
+        return;
+    }
+
+    // Only keep the latest released transcoder of stream.
+    std::map<std::string, SrsAsyncAudioTranscoder*>::iterator it = idles_.find(t->key_);
+    if (it != idles_.end()) {
+        dispose(it->second);
+    }
+
+    t->idle_at_ = srs_get_system_time();
+    idles_[t->key_] = t;
+}
+
+srs_error_t SrsAudioTranscodeManager::start_workers()
+{
+    srs_error_t err = srs_success;
+
+    started_ = true;
+
+    int nn_workers = _srs_config->get_threads_audio_workers();
+    for (int i = 0; i < nn_workers; i++) {
+        SrsAudioTranscodeWorker* worker = new SrsAudioTranscodeWorker();
+        workers_.push_back(worker);
+
+        if ((err = worker->start()) != srs_success) {
+            return srs_error_wrap(err, "start worker #%d", i);
+        }
+    }
+
+    _srs_hybrid->timer5s()->subscribe(this);
+    srs_trace("Audio: Start %d transcode workers", nn_workers);
+
+    return err;
+}
+
+void SrsAudioTranscodeManager::dispose(SrsAsyncAudioTranscoder* t)
+{
+    if (t->worker_) {
+        t->worker_->dispose(t);
+    } else {
+        srs_freep(t);
+    }
+}
+
+srs_error_t SrsAudioTranscodeManager::on_timer(srs_utime_t interval)
+{
+    srs_error_t err = srs_success;
+
+    srs_utime_t now = srs_get_system_time();
+
+    std::map<std::string, SrsAsyncAudioTranscoder*>::iterator it;
+    for (it = idles_.begin(); it != idles_.end();) {
+        SrsAsyncAudioTranscoder* t = it->second;
+        if (now - t->idle_at_ < SRS_AUDIO_TRANSCODE_IDLE_TIMEOUT) {
+            ++it;
+            continue;
+        }
+
+        idles_.erase(it++);
+        dispose(t);
+    }
+
+    return err;
+}
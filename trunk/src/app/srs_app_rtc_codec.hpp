@@ -10,8 +10,12 @@
 #include <srs_core.hpp>
 
 #include <srs_kernel_codec.hpp>
+#include <srs_app_hourglass.hpp>
 
 #include <string>
+#include <vector>
+#include <map>
+#include <pthread.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,6 +34,11 @@ extern "C" {
 }
 #endif
 
+class SrsThreadMutex;
+class SrsThreadNotifier;
+template<typename T>
+class SrsSpscQueue;
+
 class SrsAudioTranscoder
 {
 private:
@@ -78,5 +87,147 @@ private:
     void free_swr_samples();
 };
 
+// The task to transcode an audio frame, created by the hybrid thread and executed by a worker thread.
+class SrsAudioTranscodeTask
+{
+public:
+    // The input frame, copied from the source frame, owned by the task.
+    SrsAudioFrame* frame;
+    // The output frames, generated by the transcoder, owned by the task.
+    std::vector<SrsAudioFrame*> outs;
+    // The error when transcoding.
+    srs_error_t err;
+    // The time when submitted and transcoded, in realtime.
+    srs_utime_t starttime;
+    srs_utime_t endtime;
+    // The generation of transcoder when submitted, to drop the stale tasks of the previous bridge.
+    uint32_t generation;
+public:
+    SrsAudioTranscodeTask(SrsAudioFrame* in);
+    virtual ~SrsAudioTranscodeTask();
+};
+
+class SrsAudioTranscodeWorker;
+
+// The audio transcoder of a stream, which transcodes the frames in a worker thread, or in the hybrid
+// thread if no worker. The hybrid thread submits frames to the in queue, the worker transcodes them
+// and pushes to the out queue, then the hybrid thread consumes the out queue.
+class SrsAsyncAudioTranscoder
+{
+    friend class SrsAudioTranscodeWorker;
+    friend class SrsAudioTranscodeManager;
+private:
+    std::string key_;
+    // When released by bridge, for reusing by the next bridge of the same stream.
+    srs_utime_t idle_at_;
+private:
+    SrsAudioTranscoder* codec_;
+    // The worker to transcode the frames, NULL to transcode in hybrid thread.
+    SrsAudioTranscodeWorker* worker_;
+    SrsSpscQueue<SrsAudioTranscodeTask>* in_;
+    SrsSpscQueue<SrsAudioTranscodeTask>* out_;
+    // Increased when reused by another bridge, only accessed by hybrid thread.
+    uint32_t generation_;
+private:
+    // The latency of transcoding, from submitted to consumed, only accessed by hybrid thread.
+    int64_t nn_frames_;
+    int64_t nn_dropped_;
+    int nn_latency_;
+    srs_utime_t latency_total_;
+    srs_utime_t latency_max_;
+public:
+    SrsAsyncAudioTranscoder(std::string key, SrsAudioTranscodeWorker* worker);
+    virtual ~SrsAsyncAudioTranscoder();
+public:
+    srs_error_t initialize(SrsAudioCodecId from, SrsAudioCodecId to, int channels, int sample_rate, int bit_rate);
+    // Submit the audio frame to transcode, the frame is copied so user can free it.
+    // @remark The frame is dropped if the worker is overloaded.
+    srs_error_t submit(SrsAudioFrame* frame);
+    // Consume the transcoded tasks, user should free the tasks.
+    void consume(std::vector<SrsAudioTranscodeTask*>& tasks);
+    // Get the aac codec header, for example, FLV sequence header.
+    // @remark User should never free the data, it's managed by this transcoder.
+    void aac_codec_header(uint8_t** data, int* len);
+public:
+    int64_t nn_frames();
+    int64_t nn_dropped();
+    // Get the average and max latency of tasks consumed since last call, then reset it.
+    void reset_latency(srs_utime_t& avg, srs_utime_t& max);
+private:
+    // Drop the transcoded tasks, for example, when reused by another bridge. The tasks pending in the in
+    // queue, which is consumed by worker, are dropped by consume for stale generation.
+    void clear();
+    // Transcode the pending frames, return false if no frame. Only for worker thread.
+    bool transcode_pending();
+    // Whether there are frames to transcode, for any thread.
+    bool has_pending();
+};
+
+// The worker thread, to transcode audio frames for streams.
+class SrsAudioTranscodeWorker
+{
+private:
+    // Protect the streams, which is updated by hybrid thread, and read by worker thread.
+    SrsThreadMutex* lock_;
+    std::vector<SrsAsyncAudioTranscoder*> streams_;
+    // The streams to dispose, freed by worker thread because it might be transcoding.
+    std::vector<SrsAsyncAudioTranscoder*> zombies_;
+    bool dirty_;
+private:
+    // To wakeup the worker when it's parked for no frame.
+    SrsThreadNotifier* notifier_;
+    // Whether to quit, set by hybrid thread.
+    bool quit_;
+    pthread_t trd_;
+    bool started_;
+public:
+    SrsAudioTranscodeWorker();
+    virtual ~SrsAudioTranscodeWorker();
+public:
+    // Start the worker thread. Only for hybrid thread.
+    srs_error_t start();
+    // Notify the worker to quit and join it, then the attached streams are transcoded in hybrid thread.
+    void stop();
+    // Wakeup the worker if parked, for example, frame submitted. For any thread.
+    void notify();
+public:
+    // Attach the stream to worker, or detach and free it. Only for hybrid thread.
+    void attach(SrsAsyncAudioTranscoder* t);
+    void dispose(SrsAsyncAudioTranscoder* t);
+private:
+    static srs_error_t start_thread(void* arg);
+    srs_error_t cycle();
+    // Refresh the streams and free the zombies, if changed by hybrid thread.
+    void refresh(std::vector<SrsAsyncAudioTranscoder*>& streams);
+};
+
+// The manager of audio transcoders, to reuse the transcoder of the same stream and to dispatch them to workers.
+class SrsAudioTranscodeManager : public ISrsFastTimer
+{
+private:
+    bool started_;
+    std::vector<SrsAudioTranscodeWorker*> workers_;
+    int next_worker_;
+    // The transcoders released by bridges, to reuse when bridge recreated for the same stream.
+    std::map<std::string, SrsAsyncAudioTranscoder*> idles_;
+public:
+    SrsAudioTranscodeManager();
+    virtual ~SrsAudioTranscodeManager();
+public:
+    // Fetch the transcoder by key, reuse the idle one or create a new one.
+    srs_error_t acquire(std::string key, SrsAudioCodecId from, SrsAudioCodecId to, int channels, int sample_rate,
+        int bit_rate, SrsAsyncAudioTranscoder** ptranscoder);
+    // Release the transcoder, which might be reused by the next bridge of the same stream.
+    void release(SrsAsyncAudioTranscoder* t);
+private:
+    srs_error_t start_workers();
+    void dispose(SrsAsyncAudioTranscoder* t);
+// Interface ISrsFastTimer
+private:
+    srs_error_t on_timer(srs_utime_t interval);
+};
+
+extern SrsAudioTranscodeManager* _srs_audio_transcoders;
+
 #endif /* SRS_APP_AUDIO_RECODE_HPP */
 
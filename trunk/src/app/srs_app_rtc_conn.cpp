@@ -68,6 +68,30 @@ extern SrsPps* _srs_pps_rnack2;
 extern SrsPps* _srs_pps_pub;
 extern SrsPps* _srs_pps_conn;
 
+// Allocate the iovecs of a batch, each for a RTP packet.
+iovec* srs_rtc_alloc_iovs()
+{
+    iovec* iovs = new iovec[SRS_RTC_SEND_BATCH];
+    for (int i = 0; i < SRS_RTC_SEND_BATCH; i++) {
+        iovs[i].iov_base = new char[kRtpPacketSize];
+        iovs[i].iov_len = kRtpPacketSize;
+    }
+    return iovs;
+}
+
+void srs_rtc_free_iovs(iovec* iovs)
+{
+    if (!iovs) {
+        return;
+    }
+
+    for (int i = 0; i < SRS_RTC_SEND_BATCH; i++) {
+        char* iov_base = (char*)iovs[i].iov_base;
+        srs_freepa(iov_base);
+    }
+    srs_freepa(iovs);
+}
+
 ISrsRtcTransport::ISrsRtcTransport()
 {
 }
@@ -171,10 +195,13 @@ srs_error_t SrsSecurityTransport::srtp_initialize()
     if ((err = dtls_->get_srtp_key(recv_key, send_key)) != srs_success) {
         return err;
     }
-    
-    if ((err = srtp_->initialize(recv_key, send_key)) != srs_success) {
+
+    SrsSrtpProfile profile = dtls_->get_srtp_profile();
+    if ((err = srtp_->initialize(recv_key, send_key, profile)) != srs_success) {
         return srs_error_wrap(err, "srtp init");
     }
+    srs_trace("RTC: SRTP profile=%s", profile == SrsSrtpProfileAeadAes128Gcm ? "AEAD_AES_128_GCM"
+        : (profile == SrsSrtpProfileAeadAes256Gcm ? "AEAD_AES_256_GCM" : "AES128_CM_SHA1_80"));
 
     return err;
 }
@@ -184,6 +211,11 @@ srs_error_t SrsSecurityTransport::protect_rtp(void* packet, int* nb_cipher)
     return srtp_->protect_rtp(packet, nb_cipher);
 }
 
+srs_error_t SrsSecurityTransport::protect_rtps(iovec* iovs, int nn_iovs)
+{
+    return srtp_->protect_rtps(iovs, nn_iovs);
+}
+
 srs_error_t SrsSecurityTransport::protect_rtcp(void* packet, int* nb_cipher)
 {
     return srtp_->protect_rtcp(packet, nb_cipher);
@@ -212,6 +244,11 @@ srs_error_t SrsSemiSecurityTransport::protect_rtp(void* packet, int* nb_cipher)
     return srs_success;
 }
 
+srs_error_t SrsSemiSecurityTransport::protect_rtps(iovec* iovs, int nn_iovs)
+{
+    return srs_success;
+}
+
 srs_error_t SrsSemiSecurityTransport::protect_rtcp(void* packet, int* nb_cipher)
 {
     return srs_success;
@@ -277,6 +314,11 @@ srs_error_t SrsPlaintextTransport::protect_rtp(void* packet, int* nb_cipher)
     return srs_success;
 }
 
+srs_error_t SrsPlaintextTransport::protect_rtps(iovec* iovs, int nn_iovs)
+{
+    return srs_success;
+}
+
 srs_error_t SrsPlaintextTransport::protect_rtcp(void* packet, int* nb_cipher)
 {
     return srs_success;
@@ -434,6 +476,7 @@ SrsRtcPlayStream::SrsRtcPlayStream(SrsRtcConnection* s, const SrsContextId& cid)
     _srs_config->subscribe(this);
     nack_epp = new SrsErrorPithyPrint();
     pli_worker_ = new SrsRtcPLIWorker(this);
+    residence_ = new SrsHistogram();
 
     cache_ssrc0_ = cache_ssrc1_ = cache_ssrc2_ = 0;
     cache_track0_ = cache_track1_ = cache_track2_ = NULL;
@@ -447,10 +490,16 @@ SrsRtcPlayStream::~SrsRtcPlayStream()
 
     _srs_config->unsubscribe(this);
 
+    // Merge the residence time left to stream.
+    if (req_) {
+        SrsStatistic::instance()->on_rtc_residence(req_, residence_);
+    }
+
     srs_freep(nack_epp);
     srs_freep(pli_worker_);
     srs_freep(trd_);
     srs_freep(req_);
+    srs_freep(residence_);
 
     if (true) {
         std::map<uint32_t, SrsRtcAudioSendTrack*>::iterator it;
@@ -668,17 +717,39 @@ srs_error_t SrsRtcPlayStream::cycle()
     SrsErrorPithyPrint* epp = new SrsErrorPithyPrint();
     SrsAutoFree(SrsErrorPithyPrint, epp);
 
+    SrsPithyPrint* pprint = SrsPithyPrint::create_rtc_play();
+    SrsAutoFree(SrsPithyPrint, pprint);
+
     while (true) {
         if ((err = trd_->pull()) != srs_success) {
             return srs_error_wrap(err, "rtc sender thread");
         }
 
+        // Merge the residence time to stream periodically.
+        pprint->elapse();
+        if (pprint->can_print()) {
+            SrsStatistic::instance()->on_rtc_residence(req_, residence_);
+            residence_->clear();
+        }
+
         // Wait for amount of packets.
         SrsRtpPacket* pkt = NULL;
         consumer->dump_packet(&pkt);
         if (!pkt) {
+            // Send the burst of packets in a batch, before waiting for more packets.
+            if ((err = session_->flush_packets()) != srs_success) {
+                uint32_t nn = 0;
+                if (epp->can_print(err, &nn)) {
+                    srs_warn("play flush packets, nn=%u/%u, err: %s", epp->nn_count, nn, srs_error_desc(err).c_str());
+                }
+                srs_freep(err);
+            }
+
             // TODO: FIXME: We should check the quit event.
             consumer->wait(mw_msgs);
+
+            // Update the clock once for the burst of packets after wakeup, to stat the residence time.
+            srs_update_system_time();
             continue;
         }
 
@@ -753,6 +824,11 @@ srs_error_t SrsRtcPlayStream::send_packet(SrsRtpPacket*& pkt)
         return srs_error_wrap(err, "audio track, SSRC=%u, SEQ=%u", ssrc, pkt->header.get_sequence());
     }
 
+    // Stat the residence time, from packet received to sent.
+    if (pkt->recv_time() > 0) {
+        residence_->record(srs_get_system_time() - pkt->recv_time());
+    }
+
     // For NACK to handle packet.
     // @remark Note that the pkt might be set to NULL.
     if (nack_enabled_) {
@@ -793,30 +869,26 @@ void SrsRtcPlayStream::set_all_tracks_status(bool status)
     srs_trace("RTC: Init tracks %s ok", merged_log.str().c_str());
 }
 
-srs_error_t SrsRtcPlayStream::on_rtcp(SrsRtcpCommon* rtcp)
+srs_error_t SrsRtcPlayStream::on_rtcp(SrsRtcpBlock* rtcp)
 {
-    if(SrsRtcpType_rr == rtcp->type()) {
-        SrsRtcpRR* rr = dynamic_cast<SrsRtcpRR*>(rtcp);
-        return on_rtcp_rr(rr);
-    } else if(SrsRtcpType_rtpfb == rtcp->type()) {
+    if(SrsRtcpType_rr == rtcp->type) {
+        return on_rtcp_rr(rtcp);
+    } else if(SrsRtcpType_rtpfb == rtcp->type) {
         //currently rtpfb of nack will be handle by player. TWCC will be handled by SrsRtcConnection
-        SrsRtcpNack* nack = dynamic_cast<SrsRtcpNack*>(rtcp);
-        return on_rtcp_nack(nack);
-    } else if(SrsRtcpType_psfb == rtcp->type()) {
-        SrsRtcpFbCommon* psfb = dynamic_cast<SrsRtcpFbCommon*>(rtcp);
-        return on_rtcp_ps_feedback(psfb);
-    } else if(SrsRtcpType_xr == rtcp->type()) {
-        SrsRtcpXr* xr = dynamic_cast<SrsRtcpXr*>(rtcp);
-        return on_rtcp_xr(xr);
-    } else if(SrsRtcpType_bye == rtcp->type()) {
+        return on_rtcp_nack(rtcp);
+    } else if(SrsRtcpType_psfb == rtcp->type) {
+        return on_rtcp_ps_feedback(rtcp);
+    } else if(SrsRtcpType_xr == rtcp->type) {
+        return on_rtcp_xr(rtcp);
+    } else if(SrsRtcpType_bye == rtcp->type) {
         // TODO: FIXME: process rtcp bye.
         return srs_success;
     } else {
-        return srs_error_new(ERROR_RTC_RTCP_CHECK, "unknown rtcp type=%u", rtcp->type());
+        return srs_error_new(ERROR_RTC_RTCP_CHECK, "unknown rtcp type=%u", rtcp->type);
     }
 }
 
-srs_error_t SrsRtcPlayStream::on_rtcp_rr(SrsRtcpRR* rtcp)
+srs_error_t SrsRtcPlayStream::on_rtcp_rr(SrsRtcpBlock* rtcp)
 {
     srs_error_t err = srs_success;
 
@@ -825,7 +897,7 @@ srs_error_t SrsRtcPlayStream::on_rtcp_rr(SrsRtcpRR* rtcp)
     return err;
 }
 
-srs_error_t SrsRtcPlayStream::on_rtcp_xr(SrsRtcpXr* rtcp)
+srs_error_t SrsRtcPlayStream::on_rtcp_xr(SrsRtcpBlock* rtcp)
 {
     srs_error_t err = srs_success;
 
@@ -834,7 +906,7 @@ srs_error_t SrsRtcPlayStream::on_rtcp_xr(SrsRtcpXr* rtcp)
     return err;
 }
 
-srs_error_t SrsRtcPlayStream::on_rtcp_nack(SrsRtcpNack* rtcp)
+srs_error_t SrsRtcPlayStream::on_rtcp_nack(SrsRtcpBlock* rtcp)
 {
     srs_error_t err = srs_success;
 
@@ -844,7 +916,11 @@ srs_error_t SrsRtcPlayStream::on_rtcp_nack(SrsRtcpNack* rtcp)
 
     // If NACK disabled, print a log.
     if (!nack_enabled_) {
-        vector<uint16_t> sns = rtcp->get_lost_sns();
+        vector<uint16_t> sns;
+        SrsRtcpNackIterator it(rtcp);
+        for (uint16_t seq = 0; it.next(seq);) {
+            sns.push_back(seq);
+        }
         srs_trace("RTC: NACK ssrc=%u, seq=%s, ignored", ssrc, srs_join_vector_string(sns, ",").c_str());
         return err;
     }
@@ -875,7 +951,7 @@ srs_error_t SrsRtcPlayStream::on_rtcp_nack(SrsRtcpNack* rtcp)
         return srs_error_new(ERROR_RTC_NO_TRACK, "no track for %u ssrc", ssrc);
     }
 
-    vector<uint16_t> seqs = rtcp->get_lost_sns();
+    SrsRtcpNackIterator seqs(rtcp);
     if((err = target->on_recv_nack(seqs)) != srs_success) {
         return srs_error_wrap(err, "track response nack. id:%s, ssrc=%u", target->get_track_id().c_str(), ssrc);
     }
@@ -883,11 +959,11 @@ srs_error_t SrsRtcPlayStream::on_rtcp_nack(SrsRtcpNack* rtcp)
     return err;
 }
 
-srs_error_t SrsRtcPlayStream::on_rtcp_ps_feedback(SrsRtcpFbCommon* rtcp)
+srs_error_t SrsRtcPlayStream::on_rtcp_ps_feedback(SrsRtcpBlock* rtcp)
 {
     srs_error_t err = srs_success;
 
-    uint8_t fmt = rtcp->get_rc();
+    uint8_t fmt = rtcp->rc;
     switch (fmt) {
         case kPLI: {
             uint32_t ssrc = get_video_publish_ssrc(rtcp->get_media_ssrc());
@@ -1082,6 +1158,8 @@ SrsRtcPublishStream::SrsRtcPublishStream(SrsRtcConnection* session, const SrsCon
     session_ = session;
     request_keyframe_ = false;
     pli_epp = new SrsErrorPithyPrint();
+    pli_interval_ = 0;
+    nn_pli_merged_ = 0;
     twcc_epp_ = new SrsErrorPithyPrint(3.0);
 
     req_ = NULL;
@@ -1182,6 +1260,7 @@ srs_error_t SrsRtcPublishStream::initialize(SrsRequest* r, SrsRtcSourceDescripti
     nack_no_copy_ = _srs_config->get_rtc_nack_no_copy(req_->vhost);
     pt_to_drop_ = (uint16_t)_srs_config->get_rtc_drop_for_pt(req_->vhost);
     twcc_enabled_ = _srs_config->get_rtc_twcc_enabled(req_->vhost);
+    pli_interval_ = _srs_config->get_rtc_pli_interval(req_->vhost);
 
     // No TWCC when negotiate, disable it.
     if (twcc_id <= 0) {
@@ -1225,6 +1304,19 @@ srs_error_t SrsRtcPublishStream::initialize(SrsRequest* r, SrsRtcSourceDescripti
         // especially for stream merging.
         rtmp->set_cache(false);
 
+        // rtc->rtmp->srt, never bridge back to RTC which is the publisher.
+        SrsCompositeBridge* bridges = new SrsCompositeBridge();
+        if ((err = bridges->initialize(r, false, true)) != srs_success) {
+            srs_freep(bridges);
+            return srs_error_wrap(err, "bridge init");
+        }
+
+        if (!bridges->empty()) {
+            rtmp->set_bridge(bridges);
+        } else {
+            srs_freep(bridges);
+        }
+
         SrsRtmpFromRtcBridge *bridge = new SrsRtmpFromRtcBridge(rtmp);
         if ((err = bridge->initialize(r)) != srs_success) {
             srs_freep(bridge);
@@ -1397,6 +1489,10 @@ srs_error_t SrsRtcPublishStream::on_rtp_plaintext(char* plaintext, int nb_plaint
     // Copy the packet body.
     char* p = pkt->wrap(plaintext, nb_plaintext);
 
+    // Stamp the packet to stat the residence time in server, by the cached clock, which is updated by the
+    // players for each burst of packets.
+    pkt->set_recv_time(srs_get_system_time());
+
     // Handle the packet.
     SrsBuffer buf(p, nb_plaintext);
 
@@ -1547,22 +1643,28 @@ srs_error_t SrsRtcPublishStream::send_periodic_twcc()
     return err;
 }
 
-srs_error_t SrsRtcPublishStream::on_rtcp(SrsRtcpCommon* rtcp)
+srs_error_t SrsRtcPublishStream::on_rtcp(SrsRtcpBlock* rtcp)
 {
-    if(SrsRtcpType_sr == rtcp->type()) {
-        SrsRtcpSR* sr = dynamic_cast<SrsRtcpSR*>(rtcp);
-        return on_rtcp_sr(sr);
-    } else if(SrsRtcpType_xr == rtcp->type()) {
-        SrsRtcpXr* xr = dynamic_cast<SrsRtcpXr*>(rtcp);
-        return on_rtcp_xr(xr);
-    } else if(SrsRtcpType_sdes == rtcp->type()) {
+    srs_error_t err = srs_success;
+
+    if(SrsRtcpType_sr == rtcp->type) {
+        // The SR is sent by publisher about every second, so it's ok to decode it on stack.
+        SrsRtcpSR sr;
+        SrsBuffer b(rtcp->data, rtcp->nb_data);
+        if ((err = sr.decode(&b)) != srs_success) {
+            return srs_error_wrap(err, "decode sr");
+        }
+        return on_rtcp_sr(&sr);
+    } else if(SrsRtcpType_xr == rtcp->type) {
+        return on_rtcp_xr(rtcp);
+    } else if(SrsRtcpType_sdes == rtcp->type) {
         //ignore RTCP SDES
         return srs_success;
-    } else if(SrsRtcpType_bye == rtcp->type()) {
+    } else if(SrsRtcpType_bye == rtcp->type) {
         // TODO: FIXME: process rtcp bye.
         return srs_success;
     } else {
-        return srs_error_new(ERROR_RTC_RTCP_CHECK, "unknown rtcp type=%u", rtcp->type());
+        return srs_error_new(ERROR_RTC_RTCP_CHECK, "unknown rtcp type=%u", rtcp->type);
     }
 }
 
@@ -1579,7 +1681,7 @@ srs_error_t SrsRtcPublishStream::on_rtcp_sr(SrsRtcpSR* rtcp)
     return err;
 }
 
-srs_error_t SrsRtcPublishStream::on_rtcp_xr(SrsRtcpXr* rtcp)
+srs_error_t SrsRtcPublishStream::on_rtcp_xr(SrsRtcpBlock* rtcp)
 {
     srs_error_t err = srs_success;
 
@@ -1597,15 +1699,19 @@ srs_error_t SrsRtcPublishStream::on_rtcp_xr(SrsRtcpXr* rtcp)
      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
      */
 
-    SrsBuffer stream(rtcp->data(), rtcp->size());
+    if (rtcp->nb_data < 8) {
+        return srs_error_new(ERROR_RTC_RTCP_CHECK, "invalid XR packet, nb_buf=%d", rtcp->nb_data);
+    }
+
+    SrsBuffer stream(rtcp->data, rtcp->nb_data);
     /*uint8_t first = */stream.read_1bytes();
     uint8_t pt = stream.read_1bytes();
     srs_assert(pt == kXR);
     uint16_t length = (stream.read_2bytes() + 1) * 4;
     /*uint32_t ssrc = */stream.read_4bytes();
 
-    if (length > rtcp->size()) {
-        return srs_error_new(ERROR_RTC_RTCP_CHECK, "invalid XR packet, length=%u, nb_buf=%d", length, rtcp->size());
+    if (length > rtcp->nb_data) {
+        return srs_error_new(ERROR_RTC_RTCP_CHECK, "invalid XR packet, length=%u, nb_buf=%d", length, rtcp->nb_data);
     }
 
     while (stream.pos() + 4 < length) {
@@ -1613,8 +1719,8 @@ srs_error_t SrsRtcPublishStream::on_rtcp_xr(SrsRtcpXr* rtcp)
         stream.skip(1);
         uint16_t block_length = (stream.read_2bytes() + 1) * 4;
 
-        if (stream.pos() + block_length - 4 > rtcp->size()) {
-            return srs_error_new(ERROR_RTC_RTCP_CHECK, "invalid XR packet block, block_length=%u, nb_buf=%d", block_length, rtcp->size());
+        if (stream.pos() + block_length - 4 > rtcp->nb_data) {
+            return srs_error_new(ERROR_RTC_RTCP_CHECK, "invalid XR packet block, block_length=%u, nb_buf=%d", block_length, rtcp->nb_data);
         }
 
         if (bt == 5) {
@@ -1641,13 +1747,25 @@ srs_error_t SrsRtcPublishStream::on_rtcp_xr(SrsRtcpXr* rtcp)
 
 void SrsRtcPublishStream::request_keyframe(uint32_t ssrc, SrsContextId cid)
 {
+    // Merge the PLI of players in interval, because the keyframe is delivered to all players, to avoid PLI storm
+    // when many players join.
+    if (pli_interval_ > 0) {
+        srs_utime_t now = srs_get_system_time();
+        std::map<uint32_t, srs_utime_t>::iterator it = pli_last_.find(ssrc);
+        if (it != pli_last_.end() && now - it->second < pli_interval_) {
+            nn_pli_merged_++;
+            return;
+        }
+        pli_last_[ssrc] = now;
+    }
+
     pli_worker_->request_keyframe(ssrc, cid);
 	
     uint32_t nn = 0;
     if (pli_epp->can_print(ssrc, &nn)) {
         // The player(subscriber) cid, which requires PLI.
-        srs_trace("RTC: Need PLI ssrc=%u, play=[%s], publish=[%s], count=%u/%u", ssrc, cid.c_str(),
-            cid_.c_str(), nn, pli_epp->nn_count);
+        srs_trace("RTC: Need PLI ssrc=%u, play=[%s], publish=[%s], count=%u/%u, merged=%u", ssrc, cid.c_str(),
+            cid_.c_str(), nn, pli_epp->nn_count, nn_pli_merged_);
     }
 }
 
@@ -1773,10 +1891,9 @@ SrsRtcConnection::SrsRtcConnection(SrsRtcServer* s, const SrsContextId& cid)
     server_ = s;
     networks_ = new SrsRtcNetworks(this);
 
-    cache_iov_ = new iovec();
-    cache_iov_->iov_base = new char[kRtpPacketSize];
-    cache_iov_->iov_len = kRtpPacketSize;
-    cache_buffer_ = new SrsBuffer((char*)cache_iov_->iov_base, kRtpPacketSize);
+    play_iovs_ = NULL;
+    nn_play_iovs_ = 0;
+    cache_iovs_ = NULL;
 
     last_stun_time = 0;
     session_timeout = 0;
@@ -1817,12 +1934,8 @@ SrsRtcConnection::~SrsRtcConnection()
     // Free network over UDP or TCP.
     srs_freep(networks_);
 
-    if (true) {
-        char* iov_base = (char*)cache_iov_->iov_base;
-        srs_freepa(iov_base);
-        srs_freep(cache_iov_);
-    }
-    srs_freep(cache_buffer_);
+    srs_rtc_free_iovs(play_iovs_);
+    srs_rtc_free_iovs(cache_iovs_);
 
     srs_freep(req_);
     srs_freep(pli_epp);
@@ -1893,6 +2006,11 @@ ISrsKbpsDelta* SrsRtcConnection::delta()
     return networks_->delta();
 }
 
+SrsStatisticHandle& SrsRtcConnection::stat_handle()
+{
+    return stat_handle_;
+}
+
 const SrsContextId& SrsRtcConnection::get_id()
 {
     return cid_;
@@ -2033,52 +2151,43 @@ srs_error_t SrsRtcConnection::on_rtcp(char* unprotected_buf, int nb_unprotected_
 {
     srs_error_t err = srs_success;
 
-    SrsBuffer* buffer = new SrsBuffer(unprotected_buf, nb_unprotected_buf);
-    SrsAutoFree(SrsBuffer, buffer);
-
-    SrsRtcpCompound rtcp_compound;
-    if(srs_success != (err = rtcp_compound.decode(buffer))) {
-        return srs_error_wrap(err, "decode rtcp plaintext=%u, bytes=[%s], at=%s", nb_unprotected_buf,
-            srs_string_dumps_hex(unprotected_buf, nb_unprotected_buf, 8).c_str(),
-            srs_string_dumps_hex(buffer->head(), buffer->left(), 8).c_str());
-    }
-
-    SrsRtcpCommon* rtcp = NULL;
-    while(NULL != (rtcp = rtcp_compound.get_next_rtcp())) {
-        err = dispatch_rtcp(rtcp);
-        SrsAutoFree(SrsRtcpCommon, rtcp);
+    // Parse the blocks in place and dispatch one by one, never allocate for each block.
+    SrsBuffer buffer(unprotected_buf, nb_unprotected_buf);
+    while (!buffer.empty()) {
+        SrsRtcpBlock rtcp;
+        if(srs_success != (err = rtcp.decode(&buffer))) {
+            return srs_error_wrap(err, "decode rtcp plaintext=%u, bytes=[%s], at=%s", nb_unprotected_buf,
+                srs_string_dumps_hex(unprotected_buf, nb_unprotected_buf, 8).c_str(),
+                srs_string_dumps_hex(buffer.head(), buffer.left(), 8).c_str());
+        }
 
-        if(srs_success != err) {
+        if(srs_success != (err = dispatch_rtcp(&rtcp))) {
             return srs_error_wrap(err, "plaintext=%u, bytes=[%s], rtcp=(%u,%u,%u,%u)", nb_unprotected_buf,
-                srs_string_dumps_hex(rtcp->data(), rtcp->size(), rtcp->size()).c_str(),
-                rtcp->get_rc(), rtcp->type(), rtcp->get_ssrc(), rtcp->size());
+                srs_string_dumps_hex(rtcp.data, rtcp.nb_data, rtcp.nb_data).c_str(),
+                rtcp.rc, rtcp.type, rtcp.ssrc, rtcp.nb_data);
         }
     }
 
     return err;
 }
 
-srs_error_t SrsRtcConnection::dispatch_rtcp(SrsRtcpCommon* rtcp)
+srs_error_t SrsRtcConnection::dispatch_rtcp(SrsRtcpBlock* rtcp)
 {
     srs_error_t err = srs_success;
 
     // For TWCC packet.
-    if (SrsRtcpType_rtpfb == rtcp->type() && 15 == rtcp->get_rc()) {
-        return on_rtcp_feedback_twcc(rtcp->data(), rtcp->size());
+    if (SrsRtcpType_rtpfb == rtcp->type && 15 == rtcp->rc) {
+        return on_rtcp_feedback_twcc(rtcp->data, rtcp->nb_data);
     }
 
     // For REMB packet.
-    if (SrsRtcpType_psfb == rtcp->type()) {
-        SrsRtcpFbCommon* psfb = dynamic_cast<SrsRtcpFbCommon*>(rtcp);
-        if (15 == psfb->get_rc()) {
-            return on_rtcp_feedback_remb(psfb);
-        }
+    if (SrsRtcpType_psfb == rtcp->type && 15 == rtcp->rc) {
+        return on_rtcp_feedback_remb(rtcp);
     }
 
     // Ignore special packet.
-    if (SrsRtcpType_rr == rtcp->type()) {
-        SrsRtcpRR* rr = dynamic_cast<SrsRtcpRR*>(rtcp);
-        if (rr->get_rb_ssrc() == 0) { //for native client
+    if (SrsRtcpType_rr == rtcp->type) {
+        if (rtcp->get_rb_ssrc() == 0) { //for native client
             return err;
         }
     }
@@ -2086,26 +2195,23 @@ srs_error_t SrsRtcConnection::dispatch_rtcp(SrsRtcpCommon* rtcp)
     // The feedback packet for specified SSRC.
     // For example, if got SR packet, we required a publisher to handle it.
     uint32_t required_publisher_ssrc = 0, required_player_ssrc = 0;
-    if (SrsRtcpType_sr == rtcp->type()) {
-        required_publisher_ssrc = rtcp->get_ssrc();
-    } else if (SrsRtcpType_rr == rtcp->type()) {
-        SrsRtcpRR* rr = dynamic_cast<SrsRtcpRR*>(rtcp);
-        required_player_ssrc = rr->get_rb_ssrc();
-    } else if (SrsRtcpType_rtpfb == rtcp->type()) {
-        if(1 == rtcp->get_rc()) {
-            SrsRtcpNack* nack = dynamic_cast<SrsRtcpNack*>(rtcp);
-            required_player_ssrc = nack->get_media_ssrc();
+    if (SrsRtcpType_sr == rtcp->type) {
+        required_publisher_ssrc = rtcp->ssrc;
+    } else if (SrsRtcpType_rr == rtcp->type) {
+        required_player_ssrc = rtcp->get_rb_ssrc();
+    } else if (SrsRtcpType_rtpfb == rtcp->type) {
+        if(1 == rtcp->rc) {
+            required_player_ssrc = rtcp->get_media_ssrc();
         }
-    } else if(SrsRtcpType_psfb == rtcp->type()) {
-        SrsRtcpFbCommon* psfb = dynamic_cast<SrsRtcpFbCommon*>(rtcp);
-        required_player_ssrc = psfb->get_media_ssrc();
+    } else if(SrsRtcpType_psfb == rtcp->type) {
+        required_player_ssrc = rtcp->get_media_ssrc();
     }
 
     // Find the publisher or player by SSRC, always try to got one.
     SrsRtcPlayStream* player = NULL;
     SrsRtcPublishStream* publisher = NULL;
     if (true) {
-        uint32_t ssrc = required_publisher_ssrc? required_publisher_ssrc : rtcp->get_ssrc();
+        uint32_t ssrc = required_publisher_ssrc? required_publisher_ssrc : rtcp->ssrc;
         map<uint32_t, SrsRtcPublishStream*>::iterator it = publishers_ssrc_map_.find(ssrc);
         if (it != publishers_ssrc_map_.end()) {
             publisher = it->second;
@@ -2113,7 +2219,7 @@ srs_error_t SrsRtcConnection::dispatch_rtcp(SrsRtcpCommon* rtcp)
     }
 
     if (true) {
-        uint32_t ssrc = required_player_ssrc? required_player_ssrc : rtcp->get_ssrc();
+        uint32_t ssrc = required_player_ssrc? required_player_ssrc : rtcp->ssrc;
         map<uint32_t, SrsRtcPlayStream*>::iterator it = players_ssrc_map_.find(ssrc);
         if (it != players_ssrc_map_.end()) {
             player = it->second;
@@ -2122,11 +2228,11 @@ srs_error_t SrsRtcConnection::dispatch_rtcp(SrsRtcpCommon* rtcp)
 
     // Ignore if packet is required by publisher or player.
     if (required_publisher_ssrc && !publisher) {
-        srs_warn("no ssrc %u in publishers. rtcp type:%u", required_publisher_ssrc, rtcp->type());
+        srs_warn("no ssrc %u in publishers. rtcp type:%u", required_publisher_ssrc, rtcp->type);
         return err;
     }
     if (required_player_ssrc && !player) {
-        srs_warn("no ssrc %u in players. rtcp type:%u", required_player_ssrc, rtcp->type());
+        srs_warn("no ssrc %u in players. rtcp type:%u", required_player_ssrc, rtcp->type);
         return err;
     }
 
@@ -2146,7 +2252,7 @@ srs_error_t SrsRtcConnection::on_rtcp_feedback_twcc(char* data, int nb_data)
     return srs_success;
 }
 
-srs_error_t SrsRtcConnection::on_rtcp_feedback_remb(SrsRtcpFbCommon *rtcp)
+srs_error_t SrsRtcConnection::on_rtcp_feedback_remb(SrsRtcpBlock* rtcp)
 {
     //ignore REMB
     return srs_success;
@@ -2456,47 +2562,142 @@ srs_error_t SrsRtcConnection::do_send_packet(SrsRtpPacket* pkt)
 {
     srs_error_t err = srs_success;
 
-    // For this message, select the first iovec.
-    iovec* iov = cache_iov_;
-    iov->iov_len = kRtpPacketSize;
-    cache_buffer_->skip(-1 * cache_buffer_->pos());
-
-    // Marshal packet to bytes in iovec.
-    if (true) {
-        if ((err = pkt->encode(cache_buffer_)) != srs_success) {
-            return srs_error_wrap(err, "encode packet");
-        }
-        iov->iov_len = cache_buffer_->pos();
-    }
-
-    // Cipher RTP to SRTP packet.
-    if (true) {
-        int nn_encrypt = (int)iov->iov_len;
-        if ((err = networks_->available()->protect_rtp(iov->iov_base, &nn_encrypt)) != srs_success) {
-            return srs_error_wrap(err, "srtp protect");
-        }
-        iov->iov_len = (size_t)nn_encrypt;
-    }
-
     // For NACK simulator, drop packet.
     if (nn_simulate_player_nack_drop) {
-        simulate_player_drop_packet(&pkt->header, (int)iov->iov_len);
-        iov->iov_len = 0;
+        simulate_player_drop_packet(&pkt->header, pkt->nb_bytes());
         return err;
     }
 
-    ++_srs_pps_srtps->sugar;
+    // Allocate the iovecs when first used, or taken by flushing in another coroutine.
+    if (!play_iovs_) {
+        play_iovs_ = srs_rtc_alloc_iovs();
+    }
 
-    if ((err = networks_->available()->write(iov->iov_base, iov->iov_len, NULL)) != srs_success) {
-        srs_warn("RTC: Write %d bytes err %s", iov->iov_len, srs_error_desc(err).c_str());
-        srs_freep(err);
-        return err;
+    // Marshal packet to bytes in iovec, because the packet might be freed before sent.
+    iovec* iov = play_iovs_ + nn_play_iovs_;
+    SrsBuffer buf((char*)iov->iov_base, kRtpPacketSize);
+    if ((err = pkt->encode(&buf)) != srs_success) {
+        return srs_error_wrap(err, "encode packet");
     }
+    iov->iov_len = buf.pos();
+    nn_play_iovs_++;
 
     // Detail log, should disable it in release version.
     srs_info("RTC: SEND PT=%u, SSRC=%#x, SEQ=%u, Time=%u, %u/%u bytes", pkt->header.get_payload_type(), pkt->header.get_ssrc(),
         pkt->header.get_sequence(), pkt->header.get_timestamp(), pkt->nb_bytes(), iov->iov_len);
 
+    if (nn_play_iovs_ >= SRS_RTC_SEND_BATCH) {
+        return flush_packets();
+    }
+
+    return err;
+}
+
+srs_error_t SrsRtcConnection::flush_packets()
+{
+    srs_error_t err = srs_success;
+
+    if (!nn_play_iovs_) {
+        return err;
+    }
+
+    // Take the iovecs, because the write might switch to another player of this connection.
+    iovec* iovs = play_iovs_;
+    int nn_iovs = nn_play_iovs_;
+    play_iovs_ = NULL;
+    nn_play_iovs_ = 0;
+
+    err = do_send_iovs(iovs, nn_iovs);
+
+    // Reuse the iovecs, if not allocated by others.
+    if (!play_iovs_) {
+        play_iovs_ = iovs;
+    } else {
+        srs_rtc_free_iovs(iovs);
+    }
+
+    return err;
+}
+
+srs_error_t SrsRtcConnection::do_send_packets(const std::vector<SrsRtpPacket*>& pkts)
+{
+    srs_error_t err = srs_success;
+
+    // Take the iovecs, or allocate when first used or taken by sending in another coroutine, because the write might
+    // switch to another coroutine which sends packets of this connection.
+    iovec* iovs = cache_iovs_;
+    cache_iovs_ = NULL;
+    if (!iovs) {
+        iovs = srs_rtc_alloc_iovs();
+    }
+
+    err = do_send_packets(pkts, iovs);
+
+    // Reuse the iovecs, if not allocated by others.
+    if (!cache_iovs_) {
+        cache_iovs_ = iovs;
+    } else {
+        srs_rtc_free_iovs(iovs);
+    }
+
+    return err;
+}
+
+srs_error_t SrsRtcConnection::do_send_packets(const std::vector<SrsRtpPacket*>& pkts, iovec* iovs)
+{
+    srs_error_t err = srs_success;
+
+    for (int i = 0; i < (int)pkts.size(); i += SRS_RTC_SEND_BATCH) {
+        int nn = 0;
+
+        // Marshal packets to bytes in iovecs.
+        for (int j = i; j < (int)pkts.size() && j < i + SRS_RTC_SEND_BATCH; j++) {
+            SrsRtpPacket* pkt = pkts.at(j);
+
+            // For NACK simulator, drop packet.
+            if (nn_simulate_player_nack_drop) {
+                simulate_player_drop_packet(&pkt->header, pkt->nb_bytes());
+                continue;
+            }
+
+            iovec* iov = iovs + nn;
+            SrsBuffer buf((char*)iov->iov_base, kRtpPacketSize);
+            if ((err = pkt->encode(&buf)) != srs_success) {
+                return srs_error_wrap(err, "encode packet");
+            }
+            iov->iov_len = buf.pos();
+            nn++;
+        }
+
+        if (nn && (err = do_send_iovs(iovs, nn)) != srs_success) {
+            return srs_error_wrap(err, "send");
+        }
+    }
+
+    return err;
+}
+
+srs_error_t SrsRtcConnection::do_send_iovs(iovec* iovs, int nn_iovs)
+{
+    srs_error_t err = srs_success;
+
+    // Cipher all RTP to SRTP packets before writing, because the write might yield and the iovecs are only owned by
+    // this call.
+    if ((err = networks_->available()->protect_rtps(iovs, nn_iovs)) != srs_success) {
+        return srs_error_wrap(err, "srtp protect");
+    }
+
+    for (int i = 0; i < nn_iovs; i++) {
+        iovec* iov = iovs + i;
+
+        ++_srs_pps_srtps->sugar;
+
+        if ((err = networks_->available()->write(iov->iov_base, iov->iov_len, NULL)) != srs_success) {
+            srs_warn("RTC: Write %d bytes err %s", iov->iov_len, srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+    }
+
     return err;
 }
 
@@ -24,6 +24,7 @@
 #include <srs_protocol_conn.hpp>
 #include <srs_app_conn.hpp>
 #include <srs_app_async_call.hpp>
+#include <srs_app_statistic.hpp>
 
 #include <string>
 #include <map>
@@ -52,6 +53,7 @@ class SrsRtcUserConfig;
 class SrsRtcSendTrack;
 class SrsRtcPublishStream;
 class SrsEphemeralDelta;
+class SrsHistogram;
 class SrsRtcNetworks;
 class SrsRtcUdpNetwork;
 class ISrsRtcNetwork;
@@ -68,6 +70,9 @@ const uint8_t kRtpFb = 205;
 const uint8_t kPsFb  = 206;
 const uint8_t kXR    = 207;
 
+// The max number of packets to encrypt and send in a batch.
+#define SRS_RTC_SEND_BATCH 16
+
 // The transport for RTC connection.
 class ISrsRtcTransport : public ISrsDtlsCallback
 {
@@ -83,6 +88,8 @@ public:
     // Encrypt the packet(paintext) to cipher, which is aso the packet ptr.
     // The nb_cipher should be initialized to the size of cipher, with some paddings.
     virtual srs_error_t protect_rtp(void* packet, int* nb_cipher) = 0;
+    // Encrypt a batch of RTP packets, the iov_len is updated to the size of cipher.
+    virtual srs_error_t protect_rtps(iovec* iovs, int nn_iovs) = 0;
     virtual srs_error_t protect_rtcp(void* packet, int* nb_cipher) = 0;
     // Decrypt the packet(cipher) to plaintext, which is also the packet ptr.
     // The nb_plaintext should be initialized to the size of cipher.
@@ -111,6 +118,7 @@ public:
     // Encrypt the packet(paintext) to cipher, which is aso the packet ptr.
     // The nb_cipher should be initialized to the size of cipher, with some paddings.
     srs_error_t protect_rtp(void* packet, int* nb_cipher);
+    srs_error_t protect_rtps(iovec* iovs, int nn_iovs);
     srs_error_t protect_rtcp(void* packet, int* nb_cipher);
     // Decrypt the packet(cipher) to plaintext, which is also the packet ptr.
     // The nb_plaintext should be initialized to the size of cipher.
@@ -133,6 +141,7 @@ public:
     virtual ~SrsSemiSecurityTransport();
 public:
     srs_error_t protect_rtp(void* packet, int* nb_cipher);
+    srs_error_t protect_rtps(iovec* iovs, int nn_iovs);
     srs_error_t protect_rtcp(void* packet, int* nb_cipher);
     srs_error_t unprotect_rtp(void* packet, int* nb_plaintext);
     srs_error_t unprotect_rtcp(void* packet, int* nb_plaintext);
@@ -156,6 +165,7 @@ public:
     virtual srs_error_t write_dtls_data(void* data, int size);
 public:
     srs_error_t protect_rtp(void* packet, int* nb_cipher);
+    srs_error_t protect_rtps(iovec* iovs, int nn_iovs);
     srs_error_t protect_rtcp(void* packet, int* nb_cipher);
     srs_error_t unprotect_rtp(void* packet, int* nb_plaintext);
     srs_error_t unprotect_rtcp(void* packet, int* nb_plaintext);
@@ -223,6 +233,8 @@ private:
     std::map<uint32_t, SrsRtcVideoSendTrack*> video_tracks_;
     // The pithy print for special stage.
     SrsErrorPithyPrint* nack_epp;
+    // The residence time of packets sent to player, merged to statistic periodically.
+    SrsHistogram* residence_;
 private:
     // Fast cache for tracks.
     uint32_t cache_ssrc0_;
@@ -265,12 +277,12 @@ public:
     // Directly set the status of track, generally for init to set the default value.
     void set_all_tracks_status(bool status);
 public:
-    srs_error_t on_rtcp(SrsRtcpCommon* rtcp);
+    srs_error_t on_rtcp(SrsRtcpBlock* rtcp);
 private:
-    srs_error_t on_rtcp_xr(SrsRtcpXr* rtcp);
-    srs_error_t on_rtcp_nack(SrsRtcpNack* rtcp);
-    srs_error_t on_rtcp_ps_feedback(SrsRtcpFbCommon* rtcp);
-    srs_error_t on_rtcp_rr(SrsRtcpRR* rtcp);
+    srs_error_t on_rtcp_xr(SrsRtcpBlock* rtcp);
+    srs_error_t on_rtcp_nack(SrsRtcpBlock* rtcp);
+    srs_error_t on_rtcp_ps_feedback(SrsRtcpBlock* rtcp);
+    srs_error_t on_rtcp_rr(SrsRtcpBlock* rtcp);
     uint32_t get_video_publish_ssrc(uint32_t play_ssrc);
 // Interface ISrsRtcPLIWorkerHandler
 public:
@@ -341,6 +353,10 @@ private:
 private:
     bool request_keyframe_;
     SrsErrorPithyPrint* pli_epp;
+    // The min interval of PLI for each track, the PLI of players in interval is merged.
+    srs_utime_t pli_interval_;
+    std::map<uint32_t, srs_utime_t> pli_last_;
+    uint32_t nn_pli_merged_;
 private:
     SrsRequest* req_;
     SrsRtcSource* source;
@@ -381,10 +397,10 @@ public:
 private:
     srs_error_t send_periodic_twcc();
 public:
-    srs_error_t on_rtcp(SrsRtcpCommon* rtcp);
+    srs_error_t on_rtcp(SrsRtcpBlock* rtcp);
 private:
     srs_error_t on_rtcp_sr(SrsRtcpSR* rtcp);
-    srs_error_t on_rtcp_xr(SrsRtcpXr* rtcp);
+    srs_error_t on_rtcp_xr(SrsRtcpBlock* rtcp);
 public:
     void request_keyframe(uint32_t ssrc, SrsContextId cid);
     virtual srs_error_t do_request_keyframe(uint32_t ssrc, SrsContextId cid);
@@ -430,8 +446,12 @@ public:
 private:
     SrsRtcServer* server_;
 private:
-    iovec* cache_iov_;
-    SrsBuffer* cache_buffer_;
+    // The iovecs of the burst of packets to play, protected by SRTP in a batch when full or flushed.
+    iovec* play_iovs_;
+    int nn_play_iovs_;
+    // The iovecs to send a batch of packets, for example, to retransmit for NACK. It's taken by the sender, because
+    // the write might switch to another coroutine which sends packets of this connection.
+    iovec* cache_iovs_;
 private:
     // key: stream id
     std::map<std::string, SrsRtcPlayStream*> players_;
@@ -448,6 +468,8 @@ private:
     std::string token_;
     // A group of networks, each has its own DTLS and SRTP context.
     SrsRtcNetworks* networks_;
+    // The handle of client in statistic.
+    SrsStatisticHandle stat_handle_;
 private:
     // TODO: FIXME: Rename it.
     // The timeout of session, keep alive by STUN ping pong.
@@ -490,6 +512,7 @@ public:
     std::string token();
 public:
     virtual ISrsKbpsDelta* delta();
+    virtual SrsStatisticHandle& stat_handle();
 // Interface ISrsResource.
 public:
     virtual const SrsContextId& get_id();
@@ -514,10 +537,10 @@ private:
 public:
     srs_error_t on_rtcp(char* data, int nb_data);
 private:
-    srs_error_t dispatch_rtcp(SrsRtcpCommon* rtcp);
+    srs_error_t dispatch_rtcp(SrsRtcpBlock* rtcp);
 public:
     srs_error_t on_rtcp_feedback_twcc(char* buf, int nb_buf);
-    srs_error_t on_rtcp_feedback_remb(SrsRtcpFbCommon *rtcp);
+    srs_error_t on_rtcp_feedback_remb(SrsRtcpBlock* rtcp);
 public:
     srs_error_t on_dtls_handshake_done();
     srs_error_t on_dtls_alert(std::string type, std::string desc);
@@ -537,7 +560,16 @@ public:
     // Simulate the NACK to drop nn packets.
     void simulate_nack_drop(int nn);
     void simulate_player_drop_packet(SrsRtpHeader* h, int nn_bytes);
+    // Marshal the packet to the burst of player, which is sent when full, or by flush_packets at the end of burst.
     srs_error_t do_send_packet(SrsRtpPacket* pkt);
+    // Send the burst of packets of player, which are protected by SRTP before any write.
+    srs_error_t flush_packets();
+    // Send a batch of packets, which are protected by SRTP before any write.
+    srs_error_t do_send_packets(const std::vector<SrsRtpPacket*>& pkts);
+private:
+    srs_error_t do_send_packets(const std::vector<SrsRtpPacket*>& pkts, iovec* iovs);
+    srs_error_t do_send_iovs(iovec* iovs, int nn_iovs);
+public:
     // Directly set the status of play track, generally for init to set the default value.
     void set_all_tracks_status(std::string stream_uri, bool is_publish, bool status);
 public:
@@ -25,6 +25,11 @@ using namespace std;
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 
+// Whether support AEAD AES-GCM for SRTP, which requires libsrtp with openssl, and openssl 1.1.0+.
+#if defined(SRS_SRTP_GCM) && defined(SRTP_AEAD_AES_128_GCM)
+#define SRS_DTLS_SRTP_GCM
+#endif
+
 // to avoid dtls negotiate failed, set max fragment size 1200.
 // @see https://github.com/ossrs/srs/issues/2415
 const int DTLS_FRAGMENT_MAX_SIZE = 1200;
@@ -175,11 +180,15 @@ SSL_CTX* srs_build_dtls_ctx(SrsDtlsVersion version, std::string role)
         // @see https://www.openssl.org/docs/man1.0.2/man3/SSL_CTX_set_read_ahead.html
         SSL_CTX_set_read_ahead(dtls_ctx, 1);
 
-        // TODO: Maybe we can use SRTP-GCM in future.
+        // Prefer the AEAD AES-GCM profiles, and fallback to SRTP_AES128_CM_SHA1_80 if peer doesn't offer them.
+        // @remark As DTLS server, openssl selects the first profile in our list which is offered by client.
         // @see https://bugs.chromium.org/p/chromium/issues/detail?id=713701
         // @see https://groups.google.com/forum/#!topic/discuss-webrtc/PvCbWSetVAQ
-        // @remark Only support SRTP_AES128_CM_SHA1_80, please read ssl/d1_srtp.c
+#ifdef SRS_DTLS_SRTP_GCM
+        srs_assert(SSL_CTX_set_tlsext_use_srtp(dtls_ctx, "SRTP_AEAD_AES_128_GCM:SRTP_AEAD_AES_256_GCM:SRTP_AES128_CM_SHA1_80") == 0);
+#else
         srs_assert(SSL_CTX_set_tlsext_use_srtp(dtls_ctx, "SRTP_AES128_CM_SHA1_80") == 0);
+#endif
     }
 
     return dtls_ctx;
@@ -640,27 +649,42 @@ void SrsDtlsImpl::state_trace(uint8_t* data, int length, bool incoming, int r0)
         nn_arq_packets, r0, length, content_type, size, handshake_type);
 }
 
-const int SRTP_MASTER_KEY_KEY_LEN = 16;
-const int SRTP_MASTER_KEY_SALT_LEN = 14;
+// Get the length of master key and salt of SRTP profile, see RFC5764 and RFC7714.
+void srs_srtp_profile_key_len(SrsSrtpProfile profile, int& key_len, int& salt_len)
+{
+    if (profile == SrsSrtpProfileAeadAes128Gcm) {
+        key_len = 16; salt_len = 12;
+    } else if (profile == SrsSrtpProfileAeadAes256Gcm) {
+        key_len = 32; salt_len = 12;
+    } else {
+        key_len = 16; salt_len = 14;
+    }
+}
+
 srs_error_t SrsDtlsImpl::get_srtp_key(std::string& recv_key, std::string& send_key)
 {
     srs_error_t err = srs_success;
 
-    unsigned char material[SRTP_MASTER_KEY_LEN * 2] = {0};  // client(SRTP_MASTER_KEY_KEY_LEN + SRTP_MASTER_KEY_SALT_LEN) + server
+    int key_len = 0, salt_len = 0;
+    srs_srtp_profile_key_len(get_srtp_profile(), key_len, salt_len);
+
+    // client(key_len + salt_len) + server(key_len + salt_len)
+    unsigned char material[(32 + 14) * 2] = {0};
+    int nb_material = (key_len + salt_len) * 2;
     static const string dtls_srtp_lable = "EXTRACTOR-dtls_srtp";
-    if (!SSL_export_keying_material(dtls, material, sizeof(material), dtls_srtp_lable.c_str(), dtls_srtp_lable.size(), NULL, 0, 0)) {
+    if (!SSL_export_keying_material(dtls, material, nb_material, dtls_srtp_lable.c_str(), dtls_srtp_lable.size(), NULL, 0, 0)) {
         return srs_error_new(ERROR_RTC_SRTP_INIT, "SSL export key r0=%lu", ERR_get_error());
     }
 
     size_t offset = 0;
 
-    std::string client_master_key(reinterpret_cast<char*>(material), SRTP_MASTER_KEY_KEY_LEN);
-    offset += SRTP_MASTER_KEY_KEY_LEN;
-    std::string server_master_key(reinterpret_cast<char*>(material + offset), SRTP_MASTER_KEY_KEY_LEN);
-    offset += SRTP_MASTER_KEY_KEY_LEN;
-    std::string client_master_salt(reinterpret_cast<char*>(material + offset), SRTP_MASTER_KEY_SALT_LEN);
-    offset += SRTP_MASTER_KEY_SALT_LEN;
-    std::string server_master_salt(reinterpret_cast<char*>(material + offset), SRTP_MASTER_KEY_SALT_LEN);
+    std::string client_master_key(reinterpret_cast<char*>(material), key_len);
+    offset += key_len;
+    std::string server_master_key(reinterpret_cast<char*>(material + offset), key_len);
+    offset += key_len;
+    std::string client_master_salt(reinterpret_cast<char*>(material + offset), salt_len);
+    offset += salt_len;
+    std::string server_master_salt(reinterpret_cast<char*>(material + offset), salt_len);
 
     if (is_dtls_client()) {
         recv_key = server_master_key + server_master_salt;
@@ -673,6 +697,24 @@ srs_error_t SrsDtlsImpl::get_srtp_key(std::string& recv_key, std::string& send_k
     return err;
 }
 
+SrsSrtpProfile SrsDtlsImpl::get_srtp_profile()
+{
+    SRTP_PROTECTION_PROFILE* profile = dtls ? SSL_get_selected_srtp_profile(dtls) : NULL;
+    if (!profile) {
+        return SrsSrtpProfileAes128CmSha1_80;
+    }
+
+#ifdef SRS_DTLS_SRTP_GCM
+    if (profile->id == SRTP_AEAD_AES_128_GCM) {
+        return SrsSrtpProfileAeadAes128Gcm;
+    } else if (profile->id == SRTP_AEAD_AES_256_GCM) {
+        return SrsSrtpProfileAeadAes256Gcm;
+    }
+#endif
+
+    return SrsSrtpProfileAes128CmSha1_80;
+}
+
 void SrsDtlsImpl::callback_by_ssl(std::string type, std::string desc)
 {
     srs_error_t err = srs_success;
@@ -944,6 +986,11 @@ srs_error_t SrsDtls::get_srtp_key(std::string& recv_key, std::string& send_key)
     return impl->get_srtp_key(recv_key, send_key);
 }
 
+SrsSrtpProfile SrsDtls::get_srtp_profile()
+{
+    return impl->get_srtp_profile();
+}
+
 SrsSRTP::SrsSRTP()
 {
     recv_ctx_ = NULL;
@@ -961,18 +1008,37 @@ SrsSRTP::~SrsSRTP()
     }
 }
 
-srs_error_t SrsSRTP::initialize(string recv_key, std::string send_key)
+srs_error_t SrsSRTP::initialize(string recv_key, std::string send_key, SrsSrtpProfile profile)
 {
     srs_error_t err = srs_success;
 
     srtp_policy_t policy;
     bzero(&policy, sizeof(policy));
 
-    // TODO: Maybe we can use SRTP-GCM in future.
-    // @see https://bugs.chromium.org/p/chromium/issues/detail?id=713701
-    // @see https://groups.google.com/forum/#!topic/discuss-webrtc/PvCbWSetVAQ
-    srtp_crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy.rtp);
-    srtp_crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy.rtcp);
+    // For AEAD AES-GCM, use the 16 bytes authentication tag, see RFC7714.
+    if (profile == SrsSrtpProfileAeadAes128Gcm) {
+#ifdef SRS_DTLS_SRTP_GCM
+        srtp_crypto_policy_set_aes_gcm_128_16_auth(&policy.rtp);
+        srtp_crypto_policy_set_aes_gcm_128_16_auth(&policy.rtcp);
+#endif
+    } else if (profile == SrsSrtpProfileAeadAes256Gcm) {
+#ifdef SRS_DTLS_SRTP_GCM
+        srtp_crypto_policy_set_aes_gcm_256_16_auth(&policy.rtp);
+        srtp_crypto_policy_set_aes_gcm_256_16_auth(&policy.rtcp);
+#endif
+    } else {
+        srtp_crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy.rtp);
+        srtp_crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy.rtcp);
+    }
+
+    // Never create the context, if the key doesn't match the profile.
+    int key_len = 0, salt_len = 0;
+    srs_srtp_profile_key_len(profile, key_len, salt_len);
+    if (policy.rtp.cipher_key_len != key_len + salt_len || (int)recv_key.size() != key_len + salt_len
+        || (int)send_key.size() != key_len + salt_len) {
+        return srs_error_new(ERROR_RTC_SRTP_INIT, "srtp profile=%d, key=%d, recv=%d, send=%d", profile,
+            policy.rtp.cipher_key_len, (int)recv_key.size(), (int)send_key.size());
+    }
 
     policy.ssrc.value = 0;
     // TODO: adjust window_size
@@ -1022,6 +1088,29 @@ srs_error_t SrsSRTP::protect_rtp(void* packet, int* nb_cipher)
     return err;
 }
 
+srs_error_t SrsSRTP::protect_rtps(iovec* iovs, int nn_iovs)
+{
+    srs_error_t err = srs_success;
+
+    // If DTLS/SRTP is not ready, fail.
+    if (!send_ctx_) {
+        return srs_error_new(ERROR_RTC_SRTP_PROTECT, "not ready");
+    }
+
+    for (int i = 0; i < nn_iovs; i++) {
+        iovec* iov = iovs + i;
+
+        int nb_cipher = (int)iov->iov_len;
+        srtp_err_status_t r0 = srtp_err_status_ok;
+        if ((r0 = srtp_protect(send_ctx_, iov->iov_base, &nb_cipher)) != srtp_err_status_ok) {
+            return srs_error_new(ERROR_RTC_SRTP_PROTECT, "rtp protect #%d r0=%u", i, r0);
+        }
+        iov->iov_len = (size_t)nb_cipher;
+    }
+
+    return err;
+}
+
 srs_error_t SrsSRTP::protect_rtcp(void* packet, int* nb_cipher)
 {
     srs_error_t err = srs_success;
@@ -64,6 +64,15 @@ enum SrsDtlsVersion {
     SrsDtlsVersion1_2
 };
 
+// The SRTP protection profile negotiated by DTLS, see RFC5764 and RFC7714.
+// @remark The AEAD AES-GCM encrypts and authenticates in a single pass, which is much faster than
+// AES-CM with HMAC-SHA1, by AES-NI and PCLMUL of openssl.
+enum SrsSrtpProfile {
+    SrsSrtpProfileAes128CmSha1_80,
+    SrsSrtpProfileAeadAes128Gcm,
+    SrsSrtpProfileAeadAes256Gcm
+};
+
 class ISrsDtlsCallback
 {
 public:
@@ -119,6 +128,7 @@ protected:
     void state_trace(uint8_t* data, int length, bool incoming, int r0);
 public:
     srs_error_t get_srtp_key(std::string& recv_key, std::string& send_key);
+    SrsSrtpProfile get_srtp_profile();
     void callback_by_ssl(std::string type, std::string desc);
 protected:
     virtual srs_error_t on_handshake_done() = 0;
@@ -199,6 +209,7 @@ public:
     srs_error_t on_dtls(char* data, int nb_data);
 public:
     srs_error_t get_srtp_key(std::string& recv_key, std::string& send_key);
+    SrsSrtpProfile get_srtp_profile();
 };
 
 class SrsSRTP
@@ -210,10 +221,15 @@ public:
     SrsSRTP();
     virtual ~SrsSRTP();
 public:
-    // Intialize srtp context with recv_key and send_key.
-    srs_error_t initialize(std::string recv_key, std::string send_key);
+    // Intialize srtp context with recv_key and send_key, which are master key and salt of profile.
+    srs_error_t initialize(std::string recv_key, std::string send_key, SrsSrtpProfile profile);
 public:
     srs_error_t protect_rtp(void* packet, int* nb_cipher);
+    // Protect a batch of RTP packets, the iov_len is updated to the size of cipher.
+    // @remark The iov_base should have enough space for the SRTP trailer.
+    // @remark The libsrtp has no batch API, so it's the same cost as protect_rtp for each packet, only the check of
+    //      context is done once for the batch.
+    srs_error_t protect_rtps(iovec* iovs, int nn_iovs);
     srs_error_t protect_rtcp(void* packet, int* nb_cipher);
     srs_error_t unprotect_rtp(void* packet, int* nb_plaintext);
     srs_error_t unprotect_rtcp(void* packet, int* nb_plaintext);
@@ -137,6 +137,11 @@ srs_error_t SrsRtcDummyNetwork::protect_rtp(void* packet, int* nb_cipher)
     return srs_success;
 }
 
+srs_error_t SrsRtcDummyNetwork::protect_rtps(iovec* iovs, int nn_iovs)
+{
+    return srs_success;
+}
+
 srs_error_t SrsRtcDummyNetwork::protect_rtcp(void* packet, int* nb_cipher)
 {
     return srs_success;
@@ -228,6 +233,11 @@ srs_error_t SrsRtcUdpNetwork::protect_rtp(void* packet, int* nb_cipher)
     return transport_->protect_rtp(packet, nb_cipher);
 }
 
+srs_error_t SrsRtcUdpNetwork::protect_rtps(iovec* iovs, int nn_iovs)
+{
+    return transport_->protect_rtps(iovs, nn_iovs);
+}
+
 srs_error_t SrsRtcUdpNetwork::protect_rtcp(void* packet, int* nb_cipher)
 {
     return transport_->protect_rtcp(packet, nb_cipher);
@@ -484,6 +494,11 @@ srs_error_t SrsRtcTcpNetwork::protect_rtp(void* packet, int* nb_cipher)
     return transport_->protect_rtp(packet, nb_cipher);
 }
 
+srs_error_t SrsRtcTcpNetwork::protect_rtps(iovec* iovs, int nn_iovs)
+{
+    return transport_->protect_rtps(iovs, nn_iovs);
+}
+
 srs_error_t SrsRtcTcpNetwork::protect_rtcp(void* packet, int* nb_cipher)
 {
     return transport_->protect_rtcp(packet, nb_cipher);
@@ -724,6 +739,11 @@ ISrsKbpsDelta* SrsRtcTcpConn::delta()
     return delta_;
 }
 
+SrsStatisticHandle& SrsRtcTcpConn::stat_handle()
+{
+    return stat_handle_;
+}
+
 std::string SrsRtcTcpConn::desc()
 {
     return "Tcp";
@@ -749,8 +769,8 @@ srs_error_t SrsRtcTcpConn::cycle()
     srs_error_t err = do_cycle();
 
     // Only stat the HTTP streaming clients, ignore all API clients.
+    SrsStatistic::instance()->kbps_add_delta(stat_handle_, get_id(), delta_);
     SrsStatistic::instance()->on_disconnect(get_id().c_str(), err);
-    SrsStatistic::instance()->kbps_add_delta(get_id().c_str(), delta_);
 
     // TODO: FIXME: Should manage RTC TCP connection by _srs_rtc_manager.
     // Because we use manager to manage this object, not the http connection object, so we must remove it here.
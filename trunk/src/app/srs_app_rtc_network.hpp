@@ -15,6 +15,7 @@
 #include <srs_protocol_conn.hpp>
 #include <srs_app_st.hpp>
 #include <srs_app_rtc_conn.hpp>
+#include <srs_app_statistic.hpp>
 #include <srs_kernel_io.hpp>
 
 class ISrsResourceManager;
@@ -92,6 +93,8 @@ public:
 public:
     // Protect RTP packet by SRTP context.
     virtual srs_error_t protect_rtp(void* packet, int* nb_cipher) = 0;
+    // Protect a batch of RTP packets by SRTP context.
+    virtual srs_error_t protect_rtps(iovec* iovs, int nn_iovs) = 0;
     // Protect RTCP packet by SRTP context.
     virtual srs_error_t protect_rtcp(void* packet, int* nb_cipher) = 0;
 public:
@@ -111,6 +114,7 @@ public:
     virtual srs_error_t on_dtls_alert(std::string type, std::string desc);
 public:
     virtual srs_error_t protect_rtp(void* packet, int* nb_cipher);
+    virtual srs_error_t protect_rtps(iovec* iovs, int nn_iovs);
     virtual srs_error_t protect_rtcp(void* packet, int* nb_cipher);
     virtual bool is_establelished();
 // Interface ISrsStreamWriter.
@@ -153,6 +157,7 @@ public:
     virtual srs_error_t on_dtls_alert(std::string type, std::string desc);
     srs_error_t on_dtls_handshake_done();
     srs_error_t protect_rtp(void* packet, int* nb_cipher);
+    srs_error_t protect_rtps(iovec* iovs, int nn_iovs);
     srs_error_t protect_rtcp(void* packet, int* nb_cipher);
 // When got data from socket.
 public:
@@ -200,6 +205,7 @@ public:
     virtual srs_error_t on_dtls_alert(std::string type, std::string desc);
     // Protect RTP packet by SRTP context.
     virtual srs_error_t protect_rtp(void* packet, int* nb_cipher);
+    virtual srs_error_t protect_rtps(iovec* iovs, int nn_iovs);
     // Protect RTCP packet by SRTP context.
     virtual srs_error_t protect_rtcp(void* packet, int* nb_cipher);
 
@@ -244,6 +250,8 @@ private:
     int port_;
     // The delta for statistic.
     SrsNetworkDelta* delta_;
+    // The handle of client in statistic.
+    SrsStatisticHandle stat_handle_;
     // WebRTC session object.
     SrsRtcConnection* session_;
     ISrsProtocolReadWriter* skt_;
@@ -254,6 +262,7 @@ public:
     virtual ~SrsRtcTcpConn();
 public:
     ISrsKbpsDelta* delta();
+    SrsStatisticHandle& stat_handle();
 // Interface ISrsResource.
 public:
     virtual std::string desc();
@@ -312,3 +312,264 @@ void SrsRtpNackForReceiver::update_rtt(int rtt)
     opts_.nack_interval = srs_min(opts_.nack_interval, opts_.max_nack_interval);
 }
 
+
+// Whether the packet is the start of frame, by the FU-A header.
+bool srs_rtp_is_frame_start(SrsRtpPacket* pkt)
+{
+    SrsRtpFUAPayload2* fua2 = dynamic_cast<SrsRtpFUAPayload2*>(pkt->payload());
+    if (fua2) {
+        return fua2->start;
+    }
+
+    SrsRtpFUAPayload* fua = dynamic_cast<SrsRtpFUAPayload*>(pkt->payload());
+    if (fua) {
+        return fua->start;
+    }
+
+    return true;
+}
+
+SrsRtpJitterBuffer::SrsRtpJitterBuffer(int capacity)
+{
+    // The packet is indexed by seq%capacity, which is continuous when seq wraps, only if capacity divides 65536,
+    // so we round it up to power of 2.
+    int v = 1;
+    while (v < capacity && v < 32768) {
+        v <<= 1;
+    }
+    capacity_ = (uint16_t)v;
+    initialized_ = false;
+    begin_ = end_ = 0;
+
+    pkts_ = new SrsRtpPacket*[capacity_];
+    memset(pkts_, 0, sizeof(SrsRtpPacket*) * capacity_);
+    lost_at_ = new srs_utime_t[capacity_];
+    memset(lost_at_, 0, sizeof(srs_utime_t) * capacity_);
+
+    // Wait at least for the first NACK and the retransmitted packet.
+    SrsNackOption opts;
+    min_delay_ = opts.first_nack_interval + opts.nack_interval;
+    max_delay_ = nack_alive_ = opts.max_alive_time;
+    delay_ = min_delay_;
+    recover_time_ = 0;
+
+    need_keyframe_ = false;
+    nn_recovered_ = nn_dropped_frames_ = nn_skipped_frames_ = 0;
+}
+
+SrsRtpJitterBuffer::~SrsRtpJitterBuffer()
+{
+    clear();
+    srs_freepa(pkts_);
+    srs_freepa(lost_at_);
+}
+
+void SrsRtpJitterBuffer::set_max_delay(srs_utime_t v)
+{
+    max_delay_ = srs_min(srs_max(v, 0), nack_alive_);
+    min_delay_ = srs_min(min_delay_, max_delay_);
+    delay_ = srs_max(min_delay_, srs_min(delay_, max_delay_));
+}
+
+void SrsRtpJitterBuffer::insert(SrsRtpPacket* pkt, srs_utime_t now)
+{
+    uint16_t seq = pkt->header.get_sequence();
+
+    // Reset the buffer if sequence jumps back too far, for example, the publisher restarts.
+    if (initialized_ && srs_rtp_seq_distance(begin_, seq) <= -capacity_) {
+        srs_warn("RTC: Jitter reset, begin=%u, end=%u, seq=%u", begin_, end_, seq);
+        clear();
+        need_keyframe_ = true;
+    }
+
+    if (!initialized_) {
+        initialized_ = true;
+        begin_ = end_ = seq;
+    }
+
+    // The packet is too late, because its frame is consumed or dropped. We still stat the time to recover
+    // it, to wait longer for the next lost packet.
+    int16_t distance = srs_rtp_seq_distance(begin_, seq);
+    if (distance < 0) {
+        srs_utime_t& lost_at = lost_at_[seq % capacity_];
+        if (lost_at && -distance < capacity_ / 2) {
+            on_recovered(now - lost_at);
+            lost_at = 0;
+        }
+        srs_freep(pkt);
+        return;
+    }
+
+    // Drop the frames to make room for the packet, or reset if all packets are consumed.
+    while (distance >= capacity_ && begin_ != end_) {
+        drop_frame();
+        distance = srs_rtp_seq_distance(begin_, seq);
+    }
+    if (distance >= capacity_) {
+        begin_ = end_ = seq;
+    }
+
+    // Mark the packets lost, between the highest received and this packet.
+    if (srs_rtp_seq_distance(end_, seq) >= 0) {
+        for (uint16_t s = end_; s != seq; s++) {
+            lost_at_[s % capacity_] = now;
+        }
+        lost_at_[seq % capacity_] = 0;
+        end_ = seq + 1;
+    }
+
+    int index = seq % capacity_;
+    if (pkts_[index]) {
+        srs_freep(pkt);
+        return;
+    }
+
+    if (lost_at_[index]) {
+        on_recovered(now - lost_at_[index]);
+        lost_at_[index] = 0;
+    }
+
+    pkts_[index] = pkt;
+}
+
+bool SrsRtpJitterBuffer::pop_frame(vector<SrsRtpPacket*>& frame, srs_utime_t now)
+{
+    while (begin_ != end_) {
+        // The first packet of frame is lost, wait for it, or drop the frame if timeout.
+        SrsRtpPacket* first = pkts_[begin_ % capacity_];
+        if (!first) {
+            if (now - lost_at_[begin_ % capacity_] < delay_) {
+                return false;
+            }
+            drop_frame();
+            continue;
+        }
+
+        // Find the end of frame, by the marker, or the timestamp of next frame.
+        uint32_t ts = first->header.get_timestamp();
+        bool completed = false;
+        uint16_t seq = begin_;
+        for (; seq != end_; seq++) {
+            SrsRtpPacket* pkt = pkts_[seq % capacity_];
+            if (!pkt) {
+                break;
+            }
+            if (pkt->header.get_timestamp() != ts) {
+                completed = true;
+                break;
+            }
+            if (pkt->header.get_marker()) {
+                completed = true;
+                seq++;
+                break;
+            }
+        }
+
+        if (!completed) {
+            // Wait for the following packets of frame.
+            if (seq == end_) {
+                return false;
+            }
+
+            // The packet of frame is lost, wait for it, or drop the frame if timeout.
+            if (now - lost_at_[seq % capacity_] < delay_) {
+                return false;
+            }
+            drop_frame();
+            continue;
+        }
+
+        bool is_keyframe = false;
+        for (uint16_t s = begin_; s != seq && !is_keyframe; s++) {
+            is_keyframe = pkts_[s % capacity_]->is_keyframe();
+        }
+
+        // Drop the frames util keyframe, because they depend on the dropped frame, and decoder outputs smeared
+        // pictures for them.
+        if (need_keyframe_ && !is_keyframe) {
+            for (uint16_t s = begin_; s != seq; s++) {
+                srs_freep(pkts_[s % capacity_]);
+            }
+            begin_ = seq;
+            nn_skipped_frames_++;
+            continue;
+        }
+
+        for (uint16_t s = begin_; s != seq; s++) {
+            int index = s % capacity_;
+            frame.push_back(pkts_[index]);
+            pkts_[index] = NULL;
+        }
+        begin_ = seq;
+        need_keyframe_ = false;
+
+        return true;
+    }
+
+    return false;
+}
+
+void SrsRtpJitterBuffer::clear()
+{
+    for (int i = 0; i < capacity_; i++) {
+        srs_freep(pkts_[i]);
+    }
+    memset(lost_at_, 0, sizeof(srs_utime_t) * capacity_);
+
+    initialized_ = false;
+    begin_ = end_ = 0;
+}
+
+void SrsRtpJitterBuffer::drop_frame()
+{
+    // Find the start of next frame, which is a received packet, and its previous packet is the end of frame,
+    // or its timestamp is not the same to the dropped frame.
+    bool has_ts = false;
+    uint32_t ts = 0;
+    SrsRtpPacket* prev = NULL;
+
+    uint16_t seq = begin_;
+    for (; seq != end_; seq++) {
+        SrsRtpPacket* pkt = pkts_[seq % capacity_];
+
+        if (pkt && seq != begin_) {
+            if (prev && (prev->header.get_marker() || prev->header.get_timestamp() != pkt->header.get_timestamp())) {
+                break;
+            }
+            if (!prev && (has_ts? pkt->header.get_timestamp() != ts : srs_rtp_is_frame_start(pkt))) {
+                break;
+            }
+        }
+
+        if (pkt && !has_ts) {
+            has_ts = true;
+            ts = pkt->header.get_timestamp();
+        }
+        prev = pkt;
+    }
+
+    for (uint16_t s = begin_; s != seq; s++) {
+        srs_freep(pkts_[s % capacity_]);
+    }
+
+    srs_warn("RTC: Jitter drop frame ts=%u, seq=[%u, %u), delay=%dms, recover=%dms, dropped=%u, recovered=%u",
+        ts, begin_, seq, srsu2msi(delay_), srsu2msi(recover_time_), nn_dropped_frames_ + 1, nn_recovered_);
+
+    begin_ = seq;
+    need_keyframe_ = true;
+    nn_dropped_frames_++;
+}
+
+void SrsRtpJitterBuffer::on_recovered(srs_utime_t cost)
+{
+    // Ignore the packet after NACK gives up, which is not recovered by NACK.
+    if (cost < 0 || cost > nack_alive_) {
+        return;
+    }
+
+    nn_recovered_++;
+    recover_time_ = recover_time_? (recover_time_ * 7 + cost) / 8 : cost;
+
+    // Wait about twice of the smoothed time to recover, for the variance of RTT.
+    delay_ = srs_max(min_delay_, srs_min(recover_time_ * 2, max_delay_));
+}
@@ -128,4 +128,65 @@ public:
     void update_rtt(int rtt);
 };
 
+// The jitter buffer to assemble video frames from RTP packets, for RTC to RTMP. The lost packet is
+// waited for NACK to recover it, in an adaptive delay by the time to recover packets, which trades
+// latency for completeness. If timeout, the incomplete frame is dropped, and a keyframe is required.
+//      [seq1(begin)|seq2|seq3 ... seq10|seq11(lost)|seq12|seq13] seq14(end)
+//        \___frame1(ts=1)____________/  \___frame2(ts=2), wait for seq11 until timeout.
+class SrsRtpJitterBuffer
+{
+private:
+    // The packets in ring, indexed by sequence.
+    SrsRtpPacket** pkts_;
+    // The time when the packet is found lost, 0 if not lost or recovered.
+    srs_utime_t* lost_at_;
+    uint16_t capacity_;
+    bool initialized_;
+    // The first sequence to consume, which is the start of the next frame.
+    uint16_t begin_;
+    // The sequence after the highest received.
+    uint16_t end_;
+private:
+    // The delay to wait for the lost packet, which is adaptive in [min_delay_, max_delay_].
+    srs_utime_t delay_;
+    srs_utime_t min_delay_;
+    srs_utime_t max_delay_;
+    // The lifetime of NACK, the lost packet is never recovered after it.
+    srs_utime_t nack_alive_;
+    // The smoothed time to recover the lost packet, by NACK or reorder.
+    srs_utime_t recover_time_;
+    // Whether frame is dropped, so the decoder requires a keyframe.
+    bool need_keyframe_;
+    // The statistic of packets and frames.
+    uint32_t nn_recovered_;
+    uint32_t nn_dropped_frames_;
+    // The complete frames dropped while waiting for keyframe.
+    uint32_t nn_skipped_frames_;
+public:
+    // @param capacity The max packets in buffer, rounded up to power of 2, at most 32768.
+    SrsRtpJitterBuffer(int capacity);
+    virtual ~SrsRtpJitterBuffer();
+public:
+    // Set the max delay to wait for the lost packet, which is limited by the lifetime of NACK.
+    void set_max_delay(srs_utime_t v);
+    srs_utime_t delay() { return delay_; }
+    bool need_keyframe() { return need_keyframe_; }
+    uint32_t nn_recovered() { return nn_recovered_; }
+    uint32_t nn_dropped_frames() { return nn_dropped_frames_; }
+    uint32_t nn_skipped_frames() { return nn_skipped_frames_; }
+    // Insert the packet to buffer, which takes the ownership of packet.
+    void insert(SrsRtpPacket* pkt, srs_utime_t now);
+    // Pop the next frame, which is complete, in order of sequence. The incomplete frame is dropped if the
+    // lost packet is timeout, then the frames are dropped util keyframe. Return false if no frame is ready,
+    // user should free the packets of frame.
+    bool pop_frame(std::vector<SrsRtpPacket*>& frame, srs_utime_t now);
+    // Free all packets, and reset the buffer.
+    void clear();
+private:
+    // Drop the incomplete frame at begin, to the start of next frame.
+    void drop_frame();
+    // Update the delay by the time to recover the lost packet.
+    void on_recovered(srs_utime_t cost);
+};
+
 #endif
@@ -646,7 +646,7 @@ srs_error_t SrsRtcServer::on_timer(srs_utime_t interval)
         // Update stat if session is alive.
         if (session->is_alive()) {
             nn_rtc_conns++;
-            SrsStatistic::instance()->kbps_add_delta(session->get_id().c_str(), session->delta());
+            SrsStatistic::instance()->kbps_add_delta(session->stat_handle(), session->get_id(), session->delta());
             continue;
         }
 
@@ -8,6 +8,7 @@
 
 #include <math.h>
 #include <unistd.h>
+#include <sys/uio.h>
 
 #include <srs_app_conn.hpp>
 #include <srs_protocol_rtmp_stack.hpp>
@@ -331,6 +332,117 @@ ISrsRtcSourceBridge::~ISrsRtcSourceBridge()
 {
 }
 
+SrsRtcKeyframeCache::SrsRtcKeyframeCache()
+{
+    enabled_ = false;
+}
+
+SrsRtcKeyframeCache::~SrsRtcKeyframeCache()
+{
+    clear();
+}
+
+void SrsRtcKeyframeCache::set_enabled(bool v)
+{
+    enabled_ = v;
+
+    if (!v) {
+        clear();
+    }
+}
+
+bool SrsRtcKeyframeCache::enabled()
+{
+    return enabled_;
+}
+
+void SrsRtcKeyframeCache::on_rtp(SrsRtpPacket* pkt)
+{
+    if (pkt->frame_type != SrsFrameTypeVideo) {
+        return;
+    }
+
+    uint32_t ssrc = pkt->header.get_ssrc();
+    uint32_t ts = pkt->header.get_timestamp();
+    std::map<uint32_t, uint32_t>::iterator it = keyframe_ts_.find(ssrc);
+
+    // Start a new cache for the new keyframe, while the packets of the same keyframe has the same timestamp.
+    if (pkt->is_keyframe() && (it == keyframe_ts_.end() || it->second != ts)) {
+        clear_track(ssrc);
+        keyframe_ts_[ssrc] = ts;
+    } else if (it == keyframe_ts_.end()) {
+        // Wait for keyframe.
+        return;
+    }
+
+    // The cached packet is delivered later to new players, which is not the residence time of stream.
+    SrsRtpPacket* cached = pkt->copy();
+    cached->set_recv_time(0);
+
+    std::vector<SrsRtpPacket*>& pkts = tracks_[ssrc];
+    pkts.push_back(cached);
+
+    // Clear the track if exceed the max packets, and wait for the next keyframe.
+    if ((int)pkts.size() > SRS_RTC_KEYFRAME_CACHE_MAX_PACKETS) {
+        srs_warn("RTC: Keyframe cache exceed max packets=%d, ssrc=%u", SRS_RTC_KEYFRAME_CACHE_MAX_PACKETS, ssrc);
+        clear_track(ssrc);
+    }
+}
+
+srs_error_t SrsRtcKeyframeCache::dump(SrsRtcConsumer* consumer)
+{
+    srs_error_t err = srs_success;
+
+    std::map<uint32_t, std::vector<SrsRtpPacket*> >::iterator it;
+    for (it = tracks_.begin(); it != tracks_.end(); ++it) {
+        std::vector<SrsRtpPacket*>& pkts = it->second;
+        for (int i = 0; i < (int)pkts.size(); i++) {
+            if ((err = consumer->enqueue(pkts.at(i)->copy())) != srs_success) {
+                return srs_error_wrap(err, "enqueue ssrc=%u", it->first);
+            }
+        }
+    }
+
+    return err;
+}
+
+int SrsRtcKeyframeCache::size()
+{
+    int nn = 0;
+
+    std::map<uint32_t, std::vector<SrsRtpPacket*> >::iterator it;
+    for (it = tracks_.begin(); it != tracks_.end(); ++it) {
+        nn += (int)it->second.size();
+    }
+
+    return nn;
+}
+
+void SrsRtcKeyframeCache::clear()
+{
+    while (!tracks_.empty()) {
+        clear_track(tracks_.begin()->first);
+    }
+    keyframe_ts_.clear();
+}
+
+void SrsRtcKeyframeCache::clear_track(uint32_t ssrc)
+{
+    keyframe_ts_.erase(ssrc);
+
+    std::map<uint32_t, std::vector<SrsRtpPacket*> >::iterator it = tracks_.find(ssrc);
+    if (it == tracks_.end()) {
+        return;
+    }
+
+    std::vector<SrsRtpPacket*>& pkts = it->second;
+    for (int i = 0; i < (int)pkts.size(); i++) {
+        SrsRtpPacket* pkt = pkts.at(i);
+        srs_freep(pkt);
+    }
+    tracks_.erase(it);
+}
+
 SrsRtcSource::SrsRtcSource()
 {
     is_created_ = false;
@@ -341,8 +453,9 @@ SrsRtcSource::SrsRtcSource()
 
     req = NULL;
     bridge_ = NULL;
+    keyframe_cache_ = new SrsRtcKeyframeCache();
 
-    pli_for_rtmp_ = pli_elapsed_ = 0;
+    pli_for_rtmp_ = pli_elapsed_ = pli_backoff_ = 0;
 }
 
 SrsRtcSource::~SrsRtcSource()
@@ -354,6 +467,7 @@ SrsRtcSource::~SrsRtcSource()
     srs_freep(bridge_);
     srs_freep(req);
     srs_freep(stream_desc_);
+    srs_freep(keyframe_cache_);
 }
 
 srs_error_t SrsRtcSource::initialize(SrsRequest* r)
@@ -362,6 +476,8 @@ srs_error_t SrsRtcSource::initialize(SrsRequest* r)
 
     req = r->copy();
 
+    keyframe_cache_->set_enabled(_srs_config->get_rtc_keyframe_cache(req->vhost));
+
 	// Create default relations to allow play before publishing.
 	// @see https://github.com/ossrs/srs/issues/2362
 	init_for_play_before_publishing();
@@ -486,8 +602,18 @@ srs_error_t SrsRtcSource::consumer_dumps(SrsRtcConsumer* consumer, bool ds, bool
 {
     srs_error_t err = srs_success;
 
+    if (!dg || !keyframe_cache_->enabled()) {
+        srs_trace("create consumer, no gop cache");
+        return err;
+    }
+
+    // Dumps the cached keyframe, for player to start fast.
+    if ((err = keyframe_cache_->dump(consumer)) != srs_success) {
+        return srs_error_wrap(err, "dump keyframe cache");
+    }
+
     // print status.
-    srs_trace("create consumer, no gop cache");
+    srs_trace("create consumer, keyframe cache packets=%d", keyframe_cache_->size());
 
     return err;
 }
@@ -534,6 +660,9 @@ srs_error_t SrsRtcSource::on_publish()
     is_created_ = true;
     is_delivering_packets_ = true;
 
+    // The cached keyframe is invalid for new stream.
+    keyframe_cache_->clear();
+
     // Notify the consumers about stream change event.
     if ((err = on_source_changed()) != srs_success) {
         return srs_error_wrap(err, "source id change");
@@ -570,6 +699,8 @@ void SrsRtcSource::on_unpublish()
     is_created_ = false;
     is_delivering_packets_ = false;
 
+    keyframe_cache_->clear();
+
     if (!_source_id.empty()) {
         _pre_source_id = _source_id;
     }
@@ -636,6 +767,10 @@ srs_error_t SrsRtcSource::on_rtp(SrsRtpPacket* pkt)
         }
     }
 
+    if (keyframe_cache_->enabled()) {
+        keyframe_cache_->on_rtp(pkt);
+    }
+
     if (bridge_ && (err = bridge_->on_rtp(pkt)) != srs_success) {
         return srs_error_wrap(err, "bridge consume message");
     }
@@ -695,10 +830,21 @@ srs_error_t SrsRtcSource::on_timer(srs_utime_t interval)
         return err;
     }
 
-    // Request PLI and reset the timer.
+    // Request PLI and reset the timer, or immediately if bridge requires keyframe for frame dropped. Because
+    // the keyframe takes some time to arrive, the PLI for frame dropped is backoff, never request it per tick.
     if (true) {
         pli_elapsed_ += interval;
-        if (pli_elapsed_ < pli_for_rtmp_) {
+
+        bool need_keyframe = bridge_ && bridge_->need_keyframe();
+        if (!need_keyframe) {
+            pli_backoff_ = 0;
+        }
+
+        if (need_keyframe && !pli_backoff_) {
+            pli_backoff_ = SRS_RTC_PLI_BACKOFF_MIN;
+        } else if (need_keyframe && pli_elapsed_ >= pli_backoff_) {
+            pli_backoff_ = srs_min(pli_backoff_ * 2, srs_max(pli_for_rtmp_, SRS_RTC_PLI_BACKOFF_MIN));
+        } else if (pli_elapsed_ < pli_for_rtmp_) {
             return err;
         }
         pli_elapsed_ = 0;
@@ -706,7 +852,8 @@ srs_error_t SrsRtcSource::on_timer(srs_utime_t interval)
 
     for (int i = 0; i < (int)stream_desc_->video_track_descs_.size(); i++) {
         SrsRtcTrackDescription* desc = stream_desc_->video_track_descs_.at(i);
-        srs_trace("RTC: to rtmp bridge request key frame, ssrc=%u, publisher cid=%s", desc->ssrc_, publish_stream_->context_id().c_str());
+        srs_info("RTC: to rtmp bridge request key frame, ssrc=%u, backoff=%dms, publisher cid=%s", desc->ssrc_,
+            srsu2msi(pli_backoff_), publish_stream_->context_id().c_str());
         publish_stream_->request_keyframe(desc->ssrc_, publish_stream_->context_id());
     }
 
@@ -720,7 +867,8 @@ SrsRtcFromRtmpBridge::SrsRtcFromRtmpBridge(SrsRtcSource* source)
     req = NULL;
     source_ = source;
     format = new SrsRtmpFormat();
-    codec_ = new SrsAudioTranscoder();
+    codec_ = NULL;
+    nn_timer_ticks_ = 0;
     latest_codec_ = SrsAudioCodecIdForbidden;
     rtmp_to_rtc = false;
     keep_bframe = false;
@@ -753,8 +901,12 @@ SrsRtcFromRtmpBridge::SrsRtcFromRtmpBridge(SrsRtcSource* source)
 
 SrsRtcFromRtmpBridge::~SrsRtcFromRtmpBridge()
 {
+    if (codec_) {
+        _srs_hybrid->timer20ms()->unsubscribe(this);
+        _srs_audio_transcoders->release(codec_);
+    }
+
     srs_freep(format);
-    srs_freep(codec_);
     srs_freep(meta);
 }
 
@@ -892,16 +1044,23 @@ srs_error_t SrsRtcFromRtmpBridge::init_codec(SrsAudioCodecId codec)
     // Ignore if not changed.
     if (latest_codec_ == codec) return err;
 
-    // Create a new codec.
-    srs_freep(codec_);
-    codec_ = new SrsAudioTranscoder();
+    // Release the previous codec, and consume the opus frames transcoded by worker.
+    if (codec_) {
+        _srs_hybrid->timer20ms()->unsubscribe(this);
+        _srs_audio_transcoders->release(codec_);
+        codec_ = NULL;
+    }
 
-    // Initialize the codec according to the codec in stream.
+    // Fetch the codec of stream, reuse the decoder and encoder of stream if not changed.
     int bitrate = _srs_config->get_rtc_opus_bitrate(req->vhost);// The output bitrate in bps.
-    if ((err = codec_->initialize(codec, SrsAudioCodecIdOpus, kAudioChannel, kAudioSamplerate, bitrate)) != srs_success) {
+    string key = srs_fmt("%s/%d>%d/%d", req->get_stream_url().c_str(), codec, SrsAudioCodecIdOpus, bitrate);
+    if ((err = _srs_audio_transcoders->acquire(key, codec, SrsAudioCodecIdOpus, kAudioChannel, kAudioSamplerate, bitrate, &codec_)) != srs_success) {
         return srs_error_wrap(err, "init codec=%d", codec);
     }
 
+    // Consume the opus frames transcoded by worker, see SrsRtcFromRtmpBridge::on_timer
+    _srs_hybrid->timer20ms()->subscribe(this);
+
     // Update the latest codec in stream.
     if (latest_codec_ == SrsAudioCodecIdForbidden) {
         srs_trace("RTMP2RTC: Init audio codec to %d(%s)", codec, srs_audio_codec_id2str(codec).c_str());
@@ -918,34 +1077,74 @@ srs_error_t SrsRtcFromRtmpBridge::transcode(SrsAudioFrame* audio)
 {
     srs_error_t err = srs_success;
 
-    std::vector<SrsAudioFrame *> out_audios;
-    if ((err = codec_->transcode(audio, out_audios)) != srs_success) {
-        return srs_error_wrap(err, "recode error");
+    if ((err = codec_->submit(audio)) != srs_success) {
+        return srs_error_wrap(err, "submit audio");
     }
 
-    // Save OPUS packets in shared message.
-    if (out_audios.empty()) {
-        return err;
-    }
+    return consume_audios();
+}
 
-    for (std::vector<SrsAudioFrame*>::iterator it = out_audios.begin(); it != out_audios.end(); ++it) {
-        SrsAudioFrame* out_audio = *it;
+srs_error_t SrsRtcFromRtmpBridge::consume_audios()
+{
+    srs_error_t err = srs_success;
 
-        SrsRtpPacket* pkt = new SrsRtpPacket();
-        SrsAutoFree(SrsRtpPacket, pkt);
+    std::vector<SrsAudioTranscodeTask*> tasks;
+    codec_->consume(tasks);
 
-        if ((err = package_opus(out_audio, pkt)) != srs_success) {
-            err = srs_error_wrap(err, "package opus");
-            break;
+    for (int i = 0; i < (int)tasks.size(); i++) {
+        SrsAudioTranscodeTask* task = tasks.at(i);
+
+        if (err == srs_success && task->err != srs_success) {
+            err = srs_error_wrap(task->err, "recode error");
+            task->err = srs_success;
         }
 
-        if ((err = source_->on_rtp(pkt)) != srs_success) {
-            err = srs_error_wrap(err, "consume opus");
-            break;
+        // Save OPUS packets in shared message.
+        for (int j = 0; err == srs_success && j < (int)task->outs.size(); j++) {
+            SrsAudioFrame* out_audio = task->outs.at(j);
+
+            SrsRtpPacket* pkt = new SrsRtpPacket();
+            SrsAutoFree(SrsRtpPacket, pkt);
+
+            if ((err = package_opus(out_audio, pkt)) != srs_success) {
+                err = srs_error_wrap(err, "package opus");
+                break;
+            }
+
+            if ((err = source_->on_rtp(pkt)) != srs_success) {
+                err = srs_error_wrap(err, "consume opus");
+                break;
+            }
         }
+
+        srs_freep(task);
+    }
+
+    return err;
+}
+
+srs_error_t SrsRtcFromRtmpBridge::on_timer(srs_utime_t interval)
+{
+    srs_error_t err = srs_success;
+
+    if (!codec_) {
+        return err;
+    }
+
+    // The transcoded frames might not be consumed when submitted, because transcoding in worker thread.
+    if ((err = consume_audios()) != srs_success) {
+        srs_warn("RTMP2RTC: Ignore consume audio err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
     }
 
-    codec_->free_frames(out_audios);
+    // Update the statistic of audio transcoding, about every 1s.
+    if (((++nn_timer_ticks_) % 50) == 0) {
+        srs_utime_t avg = 0, max = 0;
+        codec_->reset_latency(avg, max);
+
+        SrsStatistic* stat = SrsStatistic::instance();
+        stat->on_audio_transcode(req, codec_->nn_frames(), codec_->nn_dropped(), avg, max);
+    }
 
     return err;
 }
@@ -1002,12 +1201,15 @@ srs_error_t SrsRtcFromRtmpBridge::on_video(SrsSharedPtrMessage* msg)
     }
     int nn_samples = (int)samples.size();
 
+    // All packets of frame are allocated in the arena, which is freed when the last copy of packets is freed.
+    SrsRtpFrameArena* arena = new SrsRtpFrameArena(msg);
+    SrsAutoFreeH(SrsRtpFrameArena, arena, srs_rtp_frame_arena_release);
+
     // Well, for each IDR, we append a SPS/PPS before it, which is packaged in STAP-A.
     if (has_idr) {
-        SrsRtpPacket* pkt = new SrsRtpPacket();
-        SrsAutoFree(SrsRtpPacket, pkt);
+        SrsRtpPacket* pkt = arena->create_packet();
 
-        if ((err = package_stap_a(source_, msg, pkt)) != srs_success) {
+        if ((err = package_stap_a(source_, msg, arena, pkt)) != srs_success) {
             return srs_error_wrap(err, "package stap-a");
         }
 
@@ -1019,7 +1221,7 @@ srs_error_t SrsRtcFromRtmpBridge::on_video(SrsSharedPtrMessage* msg)
     // If merge Nalus, we pcakges all NALUs(samples) as one NALU, in a RTP or FUA packet.
     vector<SrsRtpPacket*> pkts;
     if (merge_nalus && nn_samples > 1) {
-        if ((err = package_nalus(msg, samples, pkts)) != srs_success) {
+        if ((err = package_nalus(msg, arena, samples, pkts)) != srs_success) {
             return srs_error_wrap(err, "package nalus as one");
         }
     } else {
@@ -1028,11 +1230,11 @@ srs_error_t SrsRtcFromRtmpBridge::on_video(SrsSharedPtrMessage* msg)
             SrsSample* sample = samples[i];
 
             if (sample->size <= kRtpMaxPayloadSize) {
-                if ((err = package_single_nalu(msg, sample, pkts)) != srs_success) {
+                if ((err = package_single_nalu(msg, arena, sample, pkts)) != srs_success) {
                     return srs_error_wrap(err, "package single nalu");
                 }
             } else {
-                if ((err = package_fu_a(msg, sample, kRtpMaxPayloadSize, pkts)) != srs_success) {
+                if ((err = package_fu_a(msg, arena, sample, kRtpMaxPayloadSize, pkts)) != srs_success) {
                     return srs_error_wrap(err, "package fu-a");
                 }
             }
@@ -1089,7 +1291,7 @@ srs_error_t SrsRtcFromRtmpBridge::filter(SrsSharedPtrMessage* msg, SrsFormat* fo
     return err;
 }
 
-srs_error_t SrsRtcFromRtmpBridge::package_stap_a(SrsRtcSource* source, SrsSharedPtrMessage* msg, SrsRtpPacket* pkt)
+srs_error_t SrsRtcFromRtmpBridge::package_stap_a(SrsRtcSource* source, SrsSharedPtrMessage* msg, SrsRtpFrameArena* arena, SrsRtpPacket* pkt)
 {
     srs_error_t err = srs_success;
 
@@ -1113,15 +1315,15 @@ srs_error_t SrsRtcFromRtmpBridge::package_stap_a(SrsRtcSource* source, SrsShared
     pkt->header.set_sequence(video_sequence++);
     pkt->header.set_timestamp(msg->timestamp * 90);
 
-    SrsRtpSTAPPayload* stap = new SrsRtpSTAPPayload();
+    SrsRtpSTAPPayload* stap = arena->create<SrsRtpSTAPPayload>();
     pkt->set_payload(stap, SrsRtspPacketPayloadTypeSTAP);
 
     uint8_t header = sps[0];
     stap->nri = (SrsAvcNaluType)header;
 
-    // Copy the SPS/PPS bytes, because it may change.
+    // Copy the SPS/PPS bytes to arena, because it may change.
     int size = (int)(sps.size() + pps.size());
-    char* payload = pkt->wrap(size);
+    char* payload = arena->alloc(size);
 
     if (true) {
         SrsSample* sample = new SrsSample();
@@ -1148,11 +1350,11 @@ srs_error_t SrsRtcFromRtmpBridge::package_stap_a(SrsRtcSource* source, SrsShared
     return err;
 }
 
-srs_error_t SrsRtcFromRtmpBridge::package_nalus(SrsSharedPtrMessage* msg, const vector<SrsSample*>& samples, vector<SrsRtpPacket*>& pkts)
+srs_error_t SrsRtcFromRtmpBridge::package_nalus(SrsSharedPtrMessage* msg, SrsRtpFrameArena* arena, const vector<SrsSample*>& samples, vector<SrsRtpPacket*>& pkts)
 {
     srs_error_t err = srs_success;
 
-    SrsRtpRawNALUs* raw = new SrsRtpRawNALUs();
+    SrsRtpRawNALUs* raw = arena->create<SrsRtpRawNALUs>();
     SrsAvcNaluType first_nalu_type = SrsAvcNaluTypeReserved;
 
     for (int i = 0; i < (int)samples.size(); i++) {
@@ -1172,13 +1374,12 @@ srs_error_t SrsRtcFromRtmpBridge::package_nalus(SrsSharedPtrMessage* msg, const
     // Ignore empty.
     int nn_bytes = raw->nb_bytes();
     if (nn_bytes <= 0) {
-        srs_freep(raw);
         return err;
     }
 
     if (nn_bytes < kRtpMaxPayloadSize) {
         // Package NALUs in a single RTP packet.
-        SrsRtpPacket* pkt = new SrsRtpPacket();
+        SrsRtpPacket* pkt = arena->create_packet();
         pkts.push_back(pkt);
 
         pkt->header.set_payload_type(video_payload_type_);
@@ -1188,12 +1389,7 @@ srs_error_t SrsRtcFromRtmpBridge::package_nalus(SrsSharedPtrMessage* msg, const
         pkt->header.set_sequence(video_sequence++);
         pkt->header.set_timestamp(msg->timestamp * 90);
         pkt->set_payload(raw, SrsRtspPacketPayloadTypeNALU);
-        pkt->wrap(msg);
     } else {
-        // We must free it, should never use RTP packets to free it,
-        // because more than one RTP packet will refer to it.
-        SrsAutoFree(SrsRtpRawNALUs, raw);
-
         // Package NALUs in FU-A RTP packets.
         int fu_payload_size = kRtpMaxPayloadSize;
 
@@ -1206,13 +1402,12 @@ srs_error_t SrsRtcFromRtmpBridge::package_nalus(SrsSharedPtrMessage* msg, const
         for (int i = 0; i < num_of_packet; ++i) {
             int packet_size = srs_min(nb_left, fu_payload_size);
 
-            SrsRtpFUAPayload* fua = new SrsRtpFUAPayload();
+            SrsRtpFUAPayload* fua = arena->create<SrsRtpFUAPayload>();
             if ((err = raw->read_samples(fua->nalus, packet_size)) != srs_success) {
-                srs_freep(fua);
                 return srs_error_wrap(err, "read samples %d bytes, left %d, total %d", packet_size, nb_left, nn_bytes);
             }
 
-            SrsRtpPacket* pkt = new SrsRtpPacket();
+            SrsRtpPacket* pkt = arena->create_packet();
             pkts.push_back(pkt);
 
             pkt->header.set_payload_type(video_payload_type_);
@@ -1228,7 +1423,6 @@ srs_error_t SrsRtcFromRtmpBridge::package_nalus(SrsSharedPtrMessage* msg, const
             fua->end = bool(i == num_of_packet - 1);
 
             pkt->set_payload(fua, SrsRtspPacketPayloadTypeFUA);
-            pkt->wrap(msg);
 
             nb_left -= packet_size;
         }
@@ -1238,11 +1432,11 @@ srs_error_t SrsRtcFromRtmpBridge::package_nalus(SrsSharedPtrMessage* msg, const
 }
 
 // Single NAL Unit Packet @see https://tools.ietf.org/html/rfc6184#section-5.6
-srs_error_t SrsRtcFromRtmpBridge::package_single_nalu(SrsSharedPtrMessage* msg, SrsSample* sample, vector<SrsRtpPacket*>& pkts)
+srs_error_t SrsRtcFromRtmpBridge::package_single_nalu(SrsSharedPtrMessage* msg, SrsRtpFrameArena* arena, SrsSample* sample, vector<SrsRtpPacket*>& pkts)
 {
     srs_error_t err = srs_success;
 
-    SrsRtpPacket* pkt = new SrsRtpPacket();
+    SrsRtpPacket* pkt = arena->create_packet();
     pkts.push_back(pkt);
 
     pkt->header.set_payload_type(video_payload_type_);
@@ -1251,18 +1445,16 @@ srs_error_t SrsRtcFromRtmpBridge::package_single_nalu(SrsSharedPtrMessage* msg,
     pkt->header.set_sequence(video_sequence++);
     pkt->header.set_timestamp(msg->timestamp * 90);
 
-    SrsRtpRawPayload* raw = new SrsRtpRawPayload();
+    SrsRtpRawPayload* raw = arena->create<SrsRtpRawPayload>();
     pkt->set_payload(raw, SrsRtspPacketPayloadTypeRaw);
 
     raw->payload = sample->bytes;
     raw->nn_payload = sample->size;
 
-    pkt->wrap(msg);
-
     return err;
 }
 
-srs_error_t SrsRtcFromRtmpBridge::package_fu_a(SrsSharedPtrMessage* msg, SrsSample* sample, int fu_payload_size, vector<SrsRtpPacket*>& pkts)
+srs_error_t SrsRtcFromRtmpBridge::package_fu_a(SrsSharedPtrMessage* msg, SrsRtpFrameArena* arena, SrsSample* sample, int fu_payload_size, vector<SrsRtpPacket*>& pkts)
 {
     srs_error_t err = srs_success;
 
@@ -1275,7 +1467,7 @@ srs_error_t SrsRtcFromRtmpBridge::package_fu_a(SrsSharedPtrMessage* msg, SrsSamp
     for (int i = 0; i < num_of_packet; ++i) {
         int packet_size = srs_min(nb_left, fu_payload_size);
 
-        SrsRtpPacket* pkt = new SrsRtpPacket();
+        SrsRtpPacket* pkt = arena->create_packet();
         pkts.push_back(pkt);
 
         pkt->header.set_payload_type(video_payload_type_);
@@ -1284,7 +1476,7 @@ srs_error_t SrsRtcFromRtmpBridge::package_fu_a(SrsSharedPtrMessage* msg, SrsSamp
         pkt->header.set_sequence(video_sequence++);
         pkt->header.set_timestamp(msg->timestamp * 90);
 
-        SrsRtpFUAPayload2* fua = new SrsRtpFUAPayload2();
+        SrsRtpFUAPayload2* fua = arena->create<SrsRtpFUAPayload2>();
         pkt->set_payload(fua, SrsRtspPacketPayloadTypeFUA2);
 
         fua->nri = (SrsAvcNaluType)header;
@@ -1295,8 +1487,6 @@ srs_error_t SrsRtcFromRtmpBridge::package_fu_a(SrsSharedPtrMessage* msg, SrsSamp
         fua->payload = p;
         fua->size = packet_size;
 
-        pkt->wrap(msg);
-
         p += packet_size;
         nb_left -= packet_size;
     }
@@ -1309,42 +1499,40 @@ srs_error_t SrsRtcFromRtmpBridge::consume_packets(vector<SrsRtpPacket*>& pkts)
     srs_error_t err = srs_success;
 
     // TODO: FIXME: Consume a range of packets.
+    // Note that the packets are freed by arena of frame, so we never free them.
     for (int i = 0; i < (int)pkts.size(); i++) {
         SrsRtpPacket* pkt = pkts[i];
         if ((err = source_->on_rtp(pkt)) != srs_success) {
-            err = srs_error_wrap(err, "consume sps/pps");
-            break;
+            return srs_error_wrap(err, "consume sps/pps");
         }
     }
 
-    for (int i = 0; i < (int)pkts.size(); i++) {
-        SrsRtpPacket* pkt = pkts[i];
-        srs_freep(pkt);
-    }
-
     return err;
 }
 
 SrsRtmpFromRtcBridge::SrsRtmpFromRtcBridge(SrsLiveSource *src)
 {
+    req_ = NULL;
     source_ = src;
     codec_ = NULL;
+    nn_timer_ticks_ = 0;
     is_first_audio = true;
     is_first_video = true;
     format = NULL;
-    rtp_key_frame_ts_ = -1;
-    header_sn_ = 0;
-    memset(cache_video_pkts_, 0, sizeof(cache_video_pkts_));
-    rtp_key_frame_ts_ = -1;
+    jitter_ = new SrsRtpJitterBuffer(2048);
     sync_state_ = -1;
     obs_whip_sps_ = obs_whip_pps_ = NULL;
 }
 
 SrsRtmpFromRtcBridge::~SrsRtmpFromRtcBridge()
 {
-    srs_freep(codec_);
+    if (codec_) {
+        _srs_hybrid->timer20ms()->unsubscribe(this);
+        _srs_audio_transcoders->release(codec_);
+    }
+    srs_freep(req_);
     srs_freep(format);
-    clear_cached_video();
+    srs_freep(jitter_);
     srs_freep(obs_whip_sps_);
     srs_freep(obs_whip_pps_);
 }
@@ -1353,7 +1541,7 @@ srs_error_t SrsRtmpFromRtcBridge::initialize(SrsRequest* r)
 {
     srs_error_t err = srs_success;
 
-    codec_ = new SrsAudioTranscoder();
+    req_ = r->copy();
     format = new SrsRtmpFormat();
 
     SrsAudioCodecId from = SrsAudioCodecIdOpus; // TODO: From SDP?
@@ -1361,10 +1549,14 @@ srs_error_t SrsRtmpFromRtcBridge::initialize(SrsRequest* r)
     int channels = 2; // The output audio channels.
     int sample_rate = 48000; // The output audio sample rate in HZ.
     int bitrate = _srs_config->get_rtc_aac_bitrate(r->vhost); // The output audio bitrate in bps.
-    if ((err = codec_->initialize(from, to, channels, sample_rate, bitrate)) != srs_success) {
+    string key = srs_fmt("%s/%d>%d/%d", r->get_stream_url().c_str(), from, to, bitrate);
+    if ((err = _srs_audio_transcoders->acquire(key, from, to, channels, sample_rate, bitrate, &codec_)) != srs_success) {
         return srs_error_wrap(err, "bridge initialize");
     }
 
+    // Consume the aac frames transcoded by worker, see SrsRtmpFromRtcBridge::on_timer
+    _srs_hybrid->timer20ms()->subscribe(this);
+
     if ((err = format->initialize()) != srs_success) {
         return srs_error_wrap(err, "format initialize");
     }
@@ -1372,6 +1564,8 @@ srs_error_t SrsRtmpFromRtcBridge::initialize(SrsRequest* r)
     // Setup the SPS/PPS parsing strategy.
     format->try_annexb_first = _srs_config->try_annexb_first(r->vhost);
 
+    jitter_->set_max_delay(_srs_config->get_rtc_jitter_max_delay(r->vhost));
+
     return err;
 }
 
@@ -1429,6 +1623,11 @@ void SrsRtmpFromRtcBridge::on_unpublish()
     source_->on_unpublish();
 }
 
+bool SrsRtmpFromRtcBridge::need_keyframe()
+{
+    return jitter_->need_keyframe();
+}
+
 srs_error_t SrsRtmpFromRtcBridge::transcode_audio(SrsRtpPacket *pkt)
 {
     srs_error_t err = srs_success;
@@ -1450,7 +1649,6 @@ srs_error_t SrsRtmpFromRtcBridge::transcode_audio(SrsRtpPacket *pkt)
         is_first_audio = false;
     }
 
-    std::vector<SrsAudioFrame *> out_pkts;
     SrsRtpRawPayload *payload = dynamic_cast<SrsRtpRawPayload *>(pkt->payload());
 
     SrsAudioFrame frame;
@@ -1458,22 +1656,73 @@ srs_error_t SrsRtmpFromRtcBridge::transcode_audio(SrsRtpPacket *pkt)
     frame.dts = ts;
     frame.cts = 0;
 
-    err = codec_->transcode(&frame, out_pkts);
-    if (err != srs_success) {
-        return err;
+    if ((err = codec_->submit(&frame)) != srs_success) {
+        return srs_error_wrap(err, "submit audio");
     }
 
-    for (std::vector<SrsAudioFrame *>::iterator it = out_pkts.begin(); it != out_pkts.end(); ++it) {
-        SrsCommonMessage out_rtmp;
-        out_rtmp.header.timestamp = (*it)->dts;
-        packet_aac(&out_rtmp, (*it)->samples[0].bytes, (*it)->samples[0].size, ts, is_first_audio);
+    return consume_audios();
+}
 
-        if ((err = source_->on_audio(&out_rtmp)) != srs_success) {
-            err = srs_error_wrap(err, "source on audio");
-            break;
+srs_error_t SrsRtmpFromRtcBridge::consume_audios()
+{
+    srs_error_t err = srs_success;
+
+    std::vector<SrsAudioTranscodeTask*> tasks;
+    codec_->consume(tasks);
+
+    for (int i = 0; i < (int)tasks.size(); i++) {
+        SrsAudioTranscodeTask* task = tasks.at(i);
+
+        if (err == srs_success && task->err != srs_success) {
+            err = task->err;
+            task->err = srs_success;
         }
+
+        // Use the timestamp of input frame, which is the avsync time of RTP packet.
+        uint32_t ts = (uint32_t)task->frame->dts;
+        for (int j = 0; err == srs_success && j < (int)task->outs.size(); j++) {
+            SrsAudioFrame* out = task->outs.at(j);
+
+            SrsCommonMessage out_rtmp;
+            out_rtmp.header.timestamp = out->dts;
+            packet_aac(&out_rtmp, out->samples[0].bytes, out->samples[0].size, ts, is_first_audio);
+
+            if ((err = source_->on_audio(&out_rtmp)) != srs_success) {
+                err = srs_error_wrap(err, "source on audio");
+                break;
+            }
+        }
+
+        srs_freep(task);
+    }
+
+    return err;
+}
+
+srs_error_t SrsRtmpFromRtcBridge::on_timer(srs_utime_t interval)
+{
+    srs_error_t err = srs_success;
+
+    // The transcoded frames might not be consumed when submitted, because transcoding in worker thread.
+    if ((err = consume_audios()) != srs_success) {
+        srs_warn("RTC2RTMP: Ignore consume audio err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+
+    // The video frames might be ready when the lost packet is timeout, without new packets.
+    if ((err = consume_videos()) != srs_success) {
+        srs_warn("RTC2RTMP: Ignore consume video err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+
+    // Update the statistic of audio transcoding, about every 1s.
+    if (((++nn_timer_ticks_) % 50) == 0) {
+        srs_utime_t avg = 0, max = 0;
+        codec_->reset_latency(avg, max);
+
+        SrsStatistic* stat = SrsStatistic::instance();
+        stat->on_audio_transcode(req_, codec_->nn_frames(), codec_->nn_dropped(), avg, max);
     }
-    codec_->free_frames(out_pkts);
 
     return err;
 }
@@ -1502,40 +1751,19 @@ srs_error_t SrsRtmpFromRtcBridge::packet_video(SrsRtpPacket* src)
     // TODO: Only copy when need
     SrsRtpPacket* pkt = src->copy();
 
-    if (pkt->is_keyframe()) {
-        return packet_video_key_frame(pkt);
-    }
-
-    // store in cache
-    int index = cache_index(pkt->header.get_sequence());
-    cache_video_pkts_[index].in_use = true;
-    srs_freep(cache_video_pkts_[index].pkt);
-    cache_video_pkts_[index].pkt = pkt;
-    cache_video_pkts_[index].sn = pkt->header.get_sequence();
-    cache_video_pkts_[index].ts = pkt->get_avsync_time();
-    cache_video_pkts_[index].rtp_ts = pkt->header.get_timestamp();
-
-    // check whether to recovery lost packet and can construct a video frame
-    if (lost_sn_ == pkt->header.get_sequence()) {
-        uint16_t tail_sn = 0;
-        int sn = find_next_lost_sn(lost_sn_, tail_sn);
-        if (-1 == sn ) {
-            if (check_frame_complete(header_sn_, tail_sn)) {
-                if ((err = packet_video_rtmp(header_sn_, tail_sn)) != srs_success) {
-                    err = srs_error_wrap(err, "fail to pack video frame");
-                }
-            }
-        } else if (-2 == sn) {
-            return srs_error_new(ERROR_RTC_RTP_MUXER, "video cache is overflow");
-        } else {
-            lost_sn_ = (uint16_t)sn;
-        }
+    // Mux the sequence header once got the SPS/PPS, before the frame is ready.
+    if (pkt->is_keyframe() && (err = packet_sequence_header(pkt)) != srs_success) {
+        srs_freep(pkt);
+        return srs_error_wrap(err, "sequence header");
     }
 
-    return err;
+    // The jitter buffer takes the ownership of packet.
+    jitter_->insert(pkt, srs_get_system_time());
+
+    return consume_videos();
 }
 
-srs_error_t SrsRtmpFromRtcBridge::packet_video_key_frame(SrsRtpPacket* pkt)
+srs_error_t SrsRtmpFromRtcBridge::packet_sequence_header(SrsRtpPacket* pkt)
 {
     srs_error_t err = srs_success;
 
@@ -1606,82 +1834,103 @@ srs_error_t SrsRtmpFromRtcBridge::packet_video_key_frame(SrsRtpPacket* pkt)
         }
     }
 
-    if (-1 == rtp_key_frame_ts_) {
-        rtp_key_frame_ts_ = pkt->header.get_timestamp();
-        header_sn_ = pkt->header.get_sequence();
-        lost_sn_ = header_sn_ + 1;
-        // Received key frame and clean cache of old p frame pkts
-        clear_cached_video();
-        srs_trace("set ts=%u, header=%hu, lost=%hu", (uint32_t)rtp_key_frame_ts_, header_sn_, lost_sn_);
-    } else if (rtp_key_frame_ts_ != pkt->header.get_timestamp()) {
-        //new key frame, clean cache
-        int64_t old_ts = rtp_key_frame_ts_;
-        uint16_t old_header_sn = header_sn_;
-        uint16_t old_lost_sn = lost_sn_;
-        rtp_key_frame_ts_ = pkt->header.get_timestamp();
-        header_sn_ = pkt->header.get_sequence();
-        lost_sn_ = header_sn_ + 1;
-        clear_cached_video();
-        srs_warn("drop old ts=%u, header=%hu, lost=%hu, set new ts=%u, header=%hu, lost=%hu",
-            (uint32_t)old_ts, old_header_sn, old_lost_sn, (uint32_t)rtp_key_frame_ts_, header_sn_, lost_sn_);
-    }
-
-    uint16_t index = cache_index(pkt->header.get_sequence());
-    cache_video_pkts_[index].in_use = true;
-    srs_freep(cache_video_pkts_[index].pkt);
-    cache_video_pkts_[index].pkt = pkt;
-    cache_video_pkts_[index].sn = pkt->header.get_sequence();
-    cache_video_pkts_[index].ts = pkt->get_avsync_time();
-    cache_video_pkts_[index].rtp_ts = pkt->header.get_timestamp();
-
-    int32_t sn = lost_sn_;
-    uint16_t tail_sn = 0;
-    if (srs_rtp_seq_distance(header_sn_, pkt->header.get_sequence()) < 0){
-        // When receive previous pkt in the same frame, update header sn;
-        header_sn_ = pkt->header.get_sequence();
-        sn = find_next_lost_sn(header_sn_, tail_sn);
-    } else if (lost_sn_ == pkt->header.get_sequence()) {
-        sn = find_next_lost_sn(lost_sn_, tail_sn);
-    }
-
-    if (-1 == sn) {
-        if (check_frame_complete(header_sn_, tail_sn)) {
-            if ((err = packet_video_rtmp(header_sn_, tail_sn)) != srs_success) {
-                err = srs_error_wrap(err, "fail to packet frame");
-            }
+    return err;
+}
+
+srs_error_t SrsRtmpFromRtcBridge::consume_videos()
+{
+    srs_error_t err = srs_success;
+
+    srs_utime_t now = srs_get_system_time();
+
+    vector<SrsRtpPacket*> frame;
+    while (jitter_->pop_frame(frame, now)) {
+        err = packet_video_rtmp(frame);
+
+        for (int i = 0; i < (int)frame.size(); i++) {
+            SrsRtpPacket* pkt = frame.at(i);
+            srs_freep(pkt);
+        }
+        frame.clear();
+
+        if (err != srs_success) {
+            return srs_error_wrap(err, "packet video");
         }
-    } else if (-2 == sn) {
-        return srs_error_new(ERROR_RTC_RTP_MUXER, "video cache is overflow");
-    } else {
-        lost_sn_ = (uint16_t)sn;
     }
 
     return err;
 }
 
-srs_error_t SrsRtmpFromRtcBridge::packet_video_rtmp(const uint16_t start, const uint16_t end)
+// Append the header of NALU, which is referred by iovec with NULL base, see SrsRtmpFromRtcBridge::packet_video_rtmp
+void srs_rtc_append_nalu_header(string& headers, vector<iovec>& iovs, const char* data, int size)
+{
+    headers.append(data, size);
+
+    iovec iov;
+    iov.iov_base = NULL;
+    iov.iov_len = size;
+    iovs.push_back(iov);
+}
+
+void srs_rtc_append_nalu_size(string& headers, vector<iovec>& iovs, uint32_t size)
+{
+    char buf[4];
+    SrsBuffer b(buf, sizeof(buf));
+    b.write_4bytes(size);
+
+    srs_rtc_append_nalu_header(headers, iovs, buf, sizeof(buf));
+}
+
+void srs_rtc_append_nalu_bytes(vector<iovec>& iovs, char* data, int size)
+{
+    iovec iov;
+    iov.iov_base = data;
+    iov.iov_len = size;
+    iovs.push_back(iov);
+}
+
+srs_error_t SrsRtmpFromRtcBridge::packet_video_rtmp(vector<SrsRtpPacket*>& frame)
 {
     srs_error_t err = srs_success;
 
+    // Collect the NALUs of frame in AVCC format, which refer to the payload of RTP packets without copy. The
+    // iovec with NULL base refers to the next bytes in headers, which is the size or header of NALU.
+    vector<iovec> iovs;
+    string headers;
     int nb_payload = 0;
-    int16_t cnt = srs_rtp_seq_distance(start, end) + 1;
-    srs_assert(cnt >= 1);
+    bool is_keyframe = false;
 
-    for (uint16_t i = 0; i < (uint16_t)cnt; ++i) {
-        uint16_t sn = start + i;
-        uint16_t index = cache_index(sn);
-        SrsRtpPacket* pkt = cache_video_pkts_[index].pkt;
+    // The position of the size of FU-A NALU in headers, which is written when got the end of FU-A.
+    int fua_at = -1;
+    uint32_t fua_size = 0;
 
-        // fix crash when pkt->payload() if pkt is nullptr;
-        if (!pkt) continue;
+    for (int i = 0; i < (int)frame.size(); i++) {
+        SrsRtpPacket* pkt = frame.at(i);
+        if (pkt->is_keyframe()) {
+            is_keyframe = true;
+        }
 
-        // calculate nalu len
         SrsRtpFUAPayload2* fua_payload = dynamic_cast<SrsRtpFUAPayload2*>(pkt->payload());
-        if (fua_payload && fua_payload->size > 0) {
+        if (fua_payload) {
             if (fua_payload->start) {
-                nb_payload += 1 + 4;
+                uint8_t nalu_header = fua_payload->nri | fua_payload->nalu_type;
+                fua_at = (int)headers.size();
+                fua_size = 1;
+                srs_rtc_append_nalu_size(headers, iovs, 0);
+                srs_rtc_append_nalu_header(headers, iovs, (char*)&nalu_header, 1);
+                nb_payload += 4 + 1;
+            }
+            // Ignore the FU-A without start, which should never happen for the frame is complete.
+            if (fua_at >= 0 && fua_payload->size > 0) {
+                srs_rtc_append_nalu_bytes(iovs, fua_payload->payload, fua_payload->size);
+                fua_size += fua_payload->size;
+                nb_payload += fua_payload->size;
+            }
+            if (fua_at >= 0 && fua_payload->end) {
+                SrsBuffer b(&headers[fua_at], 4);
+                b.write_4bytes(fua_size);
+                fua_at = -1;
             }
-            nb_payload += fua_payload->size;
             continue;
         }
 
@@ -1689,7 +1938,9 @@ srs_error_t SrsRtmpFromRtcBridge::packet_video_rtmp(const uint16_t start, const
         if (stap_payload) {
             for (int j = 0; j < (int)stap_payload->nalus.size(); ++j) {
                 SrsSample* sample = stap_payload->nalus.at(j);
-                if (sample->size > 0) {    
+                if (sample->size > 0) {
+                    srs_rtc_append_nalu_size(headers, iovs, sample->size);
+                    srs_rtc_append_nalu_bytes(iovs, sample->bytes, sample->size);
                     nb_payload += 4 + sample->size;
                 }
             }
@@ -1698,184 +1949,58 @@ srs_error_t SrsRtmpFromRtcBridge::packet_video_rtmp(const uint16_t start, const
 
         SrsRtpRawPayload* raw_payload = dynamic_cast<SrsRtpRawPayload*>(pkt->payload());
         if (raw_payload && raw_payload->nn_payload > 0) {
+            srs_rtc_append_nalu_size(headers, iovs, raw_payload->nn_payload);
+            srs_rtc_append_nalu_bytes(iovs, raw_payload->payload, raw_payload->nn_payload);
             nb_payload += 4 + raw_payload->nn_payload;
             continue;
         }
     }
 
+    // The FU-A without end, for example, the marker is not set by publisher.
+    if (fua_at >= 0) {
+        SrsBuffer b(&headers[fua_at], 4);
+        b.write_4bytes(fua_size);
+    }
+
     if (0 == nb_payload) {
         srs_warn("empty nalu");
         return err;
     }
-	
+
     //type_codec1 + avc_type + composition time + nalu size + nalu
     nb_payload += 1 + 1 + 3;
 
     SrsCommonMessage rtmp;
-    SrsRtpPacket* pkt = cache_video_pkts_[cache_index(start)].pkt;
-    rtmp.header.initialize_video(nb_payload, pkt->get_avsync_time(), 1);
+    rtmp.header.initialize_video(nb_payload, frame.front()->get_avsync_time(), 1);
     rtmp.create_payload(nb_payload);
     rtmp.size = nb_payload;
-    SrsBuffer payload(rtmp.payload, rtmp.size);
-    if (pkt->is_keyframe()) {
-        payload.write_1bytes(0x17); // type(4 bits): key frame; code(4bits): avc
-        rtp_key_frame_ts_ = -1;
-    } else {
-        payload.write_1bytes(0x27); // type(4 bits): inter frame; code(4bits): avc
-    }
-    payload.write_1bytes(0x01); // avc_type: nalu
-    payload.write_1bytes(0x0);  // composition time
-    payload.write_1bytes(0x0);
-    payload.write_1bytes(0x0);
-
-    int nalu_len = 0;
-    for (uint16_t i = 0; i < (uint16_t)cnt; ++i) {
-        uint16_t index = cache_index((start + i));
-        SrsRtpPacket* pkt = cache_video_pkts_[index].pkt;
-
-        // fix crash when pkt->payload() if pkt is nullptr;
-        if (!pkt) continue;
 
-        cache_video_pkts_[index].in_use = false;
-        cache_video_pkts_[index].pkt = NULL;
-        cache_video_pkts_[index].ts = 0;
-        cache_video_pkts_[index].rtp_ts = 0;
-        cache_video_pkts_[index].sn = 0;
-
-        SrsRtpFUAPayload2* fua_payload = dynamic_cast<SrsRtpFUAPayload2*>(pkt->payload());
-        if (fua_payload && fua_payload->size > 0) {
-            if (fua_payload->start) {
-                nalu_len = fua_payload->size + 1;
-                //skip 4 bytes to write nalu_len future
-                payload.skip(4);
-                payload.write_1bytes(fua_payload->nri | fua_payload->nalu_type);
-                payload.write_bytes(fua_payload->payload, fua_payload->size);
-            } else {
-                nalu_len += fua_payload->size;
-                payload.write_bytes(fua_payload->payload, fua_payload->size);
-                if (fua_payload->end) {
-                    //write nalu_len back
-                    payload.skip(-(4 + nalu_len));
-                    payload.write_4bytes(nalu_len);
-                    payload.skip(nalu_len);
-                }
-            }
-            srs_freep(pkt);
-            continue;
-        }
-
-        SrsRtpSTAPPayload* stap_payload = dynamic_cast<SrsRtpSTAPPayload*>(pkt->payload());
-        if (stap_payload) {
-            for (int j = 0; j < (int)stap_payload->nalus.size(); ++j) {
-                SrsSample* sample = stap_payload->nalus.at(j);
-                if (sample->size > 0) {  
-                    payload.write_4bytes(sample->size);
-                    payload.write_bytes(sample->bytes, sample->size);
-                }
-            }
-            srs_freep(pkt);
-            continue;
-        }
-
-        SrsRtpRawPayload* raw_payload = dynamic_cast<SrsRtpRawPayload*>(pkt->payload());
-        if (raw_payload && raw_payload->nn_payload > 0) {
-            payload.write_4bytes(raw_payload->nn_payload);
-            payload.write_bytes(raw_payload->payload, raw_payload->nn_payload);
-            srs_freep(pkt);
-            continue;
+    char* p = rtmp.payload;
+    *p++ = is_keyframe? 0x17 : 0x27; // type(4 bits): key or inter frame; code(4bits): avc
+    *p++ = 0x01; // avc_type: nalu
+    *p++ = 0x0; // composition time
+    *p++ = 0x0;
+    *p++ = 0x0;
+
+    // Gather the NALUs to the payload of RTMP message, which is the only copy of frame.
+    const char* header = headers.data();
+    for (int i = 0; i < (int)iovs.size(); i++) {
+        const iovec& iov = iovs.at(i);
+        if (iov.iov_base) {
+            memcpy(p, iov.iov_base, iov.iov_len);
+        } else {
+            memcpy(p, header, iov.iov_len);
+            header += iov.iov_len;
         }
-
-        srs_freep(pkt);
+        p += iov.iov_len;
     }
 
     if ((err = source_->on_video(&rtmp)) != srs_success) {
-        srs_warn("fail to pack video frame");
-    }
-
-    header_sn_ = end + 1;
-    uint16_t tail_sn = 0;
-    int sn = find_next_lost_sn(header_sn_, tail_sn);
-    if (-1 == sn) {
-        if (check_frame_complete(header_sn_, tail_sn)) {
-            err = packet_video_rtmp(header_sn_, tail_sn);
-        }
-    } else if (-2 == sn) {
-        return srs_error_new(ERROR_RTC_RTP_MUXER, "video cache is overflow");
-    } else {
-        lost_sn_ = sn;
+        return srs_error_wrap(err, "source on video");
     }
 
     return err;
 }
-
-int32_t SrsRtmpFromRtcBridge::find_next_lost_sn(uint16_t current_sn, uint16_t& end_sn)
-{
-    uint32_t last_rtp_ts = cache_video_pkts_[cache_index(header_sn_)].rtp_ts;
-    for (int i = 0; i < s_cache_size; ++i) {
-        uint16_t lost_sn = current_sn + i;
-        int index = cache_index(lost_sn);
-
-        if (!cache_video_pkts_[index].in_use) {
-            return lost_sn;
-        }
-        //check time first, avoid two small frame mixed case decode fail
-        if (last_rtp_ts != cache_video_pkts_[index].rtp_ts) {
-            end_sn = lost_sn - 1;
-            return -1;
-        }
-
-        if (cache_video_pkts_[index].pkt->header.get_marker()) {
-            end_sn = lost_sn;
-            return -1;
-        }
-    }
-
-    srs_error("cache overflow. the packet count of video frame is more than %u", s_cache_size);
-    return -2;
-}
-
-void SrsRtmpFromRtcBridge::clear_cached_video()
-{
-    for (size_t i = 0; i < s_cache_size; i++)
-    {
-        if (cache_video_pkts_[i].in_use) {
-            srs_freep(cache_video_pkts_[i].pkt);
-            cache_video_pkts_[i].sn = 0;
-            cache_video_pkts_[i].ts = 0;
-            cache_video_pkts_[i].rtp_ts = 0;
-            cache_video_pkts_[i].in_use = false;
-        }
-    }
-}
-
-bool SrsRtmpFromRtcBridge::check_frame_complete(const uint16_t start, const uint16_t end)
-{
-    int16_t cnt = srs_rtp_seq_distance(start, end) + 1;
-    srs_assert(cnt >= 1);
-
-    uint16_t fu_s_c = 0;
-    uint16_t fu_e_c = 0;
-    for (uint16_t i = 0; i < (uint16_t)cnt; ++i) {
-        int index = cache_index((start + i));
-        SrsRtpPacket* pkt = cache_video_pkts_[index].pkt;
-
-        // fix crash when pkt->payload() if pkt is nullptr;
-        if (!pkt) continue;
-
-        SrsRtpFUAPayload2* fua_payload = dynamic_cast<SrsRtpFUAPayload2*>(pkt->payload());
-        if (!fua_payload) continue;
-
-        if (fua_payload->start) {
-            ++fu_s_c;
-        }
-
-        if (fua_payload->end) {
-            ++fu_e_c;
-        }
-    }
-
-    return fu_s_c == fu_e_c;
-}
 #endif
 
 SrsCodecPayload::SrsCodecPayload()
@@ -2793,14 +2918,16 @@ srs_error_t SrsRtcSendTrack::on_nack(SrsRtpPacket** ppkt)
     return err;
 }
 
-srs_error_t SrsRtcSendTrack::on_recv_nack(const vector<uint16_t>& lost_seqs)
+srs_error_t SrsRtcSendTrack::on_recv_nack(SrsRtcpNackIterator& lost_seqs)
 {
     srs_error_t err = srs_success;
 
     ++_srs_pps_rnack2->sugar;
 
-    for(int i = 0; i < (int)lost_seqs.size(); ++i) {
-        uint16_t seq = lost_seqs.at(i);
+    // Collect the packets to retransmit, then send them in a batch.
+    vector<SrsRtpPacket*>& pkts = nack_pkts_;
+    pkts.clear();
+    for (uint16_t seq = 0; lost_seqs.next(seq);) {
         SrsRtpPacket* pkt = fetch_rtp_packet(seq);
         if (pkt == NULL) {
             continue;
@@ -2812,10 +2939,11 @@ srs_error_t SrsRtcSendTrack::on_recv_nack(const vector<uint16_t>& lost_seqs)
                 pkt->header.get_ssrc(), pkt->header.get_timestamp(), nn, nack_epp->nn_count, pkt->nb_bytes());
         }
 
-        // By default, we send packets by sendmmsg.
-        if ((err = session_->do_send_packet(pkt)) != srs_success) {
-            return srs_error_wrap(err, "raw send");
-        }
+        pkts.push_back(pkt);
+    }
+
+    if (!pkts.empty() && (err = session_->do_send_packets(pkts)) != srs_success) {
+        return srs_error_wrap(err, "raw send");
     }
 
     return err;
@@ -28,16 +28,19 @@ class SrsCommonMessage;
 class SrsMessageArray;
 class SrsRtcSource;
 class SrsRtcFromRtmpBridge;
-class SrsAudioTranscoder;
+class SrsAsyncAudioTranscoder;
 class SrsRtpPacket;
+class SrsRtpFrameArena;
 class SrsSample;
 class SrsRtcSourceDescription;
 class SrsRtcTrackDescription;
 class SrsRtcConnection;
 class SrsRtpRingBuffer;
 class SrsRtpNackForReceiver;
+class SrsRtpJitterBuffer;
 class SrsJsonObject;
 class SrsErrorPithyPrint;
+class SrsRtcpNackIterator;
 
 class SrsNtp
 {
@@ -145,6 +148,40 @@ public:
     virtual void on_consumers_finished() = 0;
 };
 
+// The max packets of a track in keyframe cache, to avoid OOM if no keyframe.
+#define SRS_RTC_KEYFRAME_CACHE_MAX_PACKETS 4096
+
+// The min backoff of PLI when bridge requires keyframe, which is doubled until keyframe is got.
+#define SRS_RTC_PLI_BACKOFF_MIN (500 * SRS_UTIME_MILLISECONDS)
+
+// Cache the RTP packets of the last keyframe and the following frames, for each video track, so that the new
+// player starts from the keyframe immediately, without waiting for the next keyframe or PLI.
+// @remark The sequence number and timestamp is rewritten by the send track of each player.
+class SrsRtcKeyframeCache
+{
+private:
+    bool enabled_;
+    // The cached packets of each track, by ssrc.
+    std::map<uint32_t, std::vector<SrsRtpPacket*> > tracks_;
+    // The timestamp of the cached keyframe, by ssrc, to identify the packets of the same keyframe.
+    std::map<uint32_t, uint32_t> keyframe_ts_;
+public:
+    SrsRtcKeyframeCache();
+    virtual ~SrsRtcKeyframeCache();
+public:
+    virtual void set_enabled(bool v);
+    virtual bool enabled();
+    // Cache the video packet, which is copied if need to save it.
+    virtual void on_rtp(SrsRtpPacket* pkt);
+    // Dumps the cached packets to consumer.
+    virtual srs_error_t dump(SrsRtcConsumer* consumer);
+    // Get the number of cached packets of all tracks.
+    virtual int size();
+    virtual void clear();
+private:
+    void clear_track(uint32_t ssrc);
+};
+
 // SrsRtcSource bridge to SrsLiveSource
 class ISrsRtcSourceBridge
 {
@@ -155,6 +192,8 @@ public:
     virtual srs_error_t on_publish() = 0;
     virtual srs_error_t on_rtp(SrsRtpPacket *pkt) = 0;
     virtual void on_unpublish() = 0;
+    // Whether bridge requires a keyframe, for example, the frame is dropped for packets lost.
+    virtual bool need_keyframe() = 0;
 };
 
 // A Source is a stream, to publish and to play with, binding to SrsRtcPublishStream and SrsRtcPlayStream.
@@ -183,10 +222,14 @@ private:
     bool is_delivering_packets_;
     // Notify stream event to event handler
     std::vector<ISrsRtcSourceEventHandler*> event_handlers_;
+    // The keyframe cache for player to start fast.
+    SrsRtcKeyframeCache* keyframe_cache_;
 private:
     // The PLI for RTC2RTMP.
     srs_utime_t pli_for_rtmp_;
     srs_utime_t pli_elapsed_;
+    // The backoff of PLI when bridge requires keyframe, zero if not requested yet.
+    srs_utime_t pli_backoff_;
 public:
     SrsRtcSource();
     virtual ~SrsRtcSource();
@@ -245,7 +288,7 @@ private:
 };
 
 #ifdef SRS_FFMPEG_FIT
-class SrsRtcFromRtmpBridge : public ISrsLiveSourceBridge
+class SrsRtcFromRtmpBridge : public ISrsLiveSourceBridge, public ISrsFastTimer
 {
 private:
     SrsRequest* req;
@@ -257,7 +300,9 @@ private:
 private:
     bool rtmp_to_rtc;
     SrsAudioCodecId latest_codec_;
-    SrsAudioTranscoder* codec_;
+    SrsAsyncAudioTranscoder* codec_;
+    // The ticks of timer, to update the statistic of audio transcoding.
+    int nn_timer_ticks_;
     bool keep_bframe;
     bool keep_avc_nalu_sei;
     bool merge_nalus;
@@ -278,42 +323,38 @@ public:
 private:
     srs_error_t init_codec(SrsAudioCodecId codec);
     srs_error_t transcode(SrsAudioFrame* audio);
+    // Consume the opus frames transcoded by worker.
+    srs_error_t consume_audios();
     srs_error_t package_opus(SrsAudioFrame* audio, SrsRtpPacket* pkt);
+// Interface ISrsFastTimer
+private:
+    srs_error_t on_timer(srs_utime_t interval);
 public:
     virtual srs_error_t on_video(SrsSharedPtrMessage* msg);
 private:
     srs_error_t filter(SrsSharedPtrMessage* msg, SrsFormat* format, bool& has_idr, std::vector<SrsSample*>& samples);
-    srs_error_t package_stap_a(SrsRtcSource* source, SrsSharedPtrMessage* msg, SrsRtpPacket* pkt);
-    srs_error_t package_nalus(SrsSharedPtrMessage* msg, const std::vector<SrsSample*>& samples, std::vector<SrsRtpPacket*>& pkts);
-    srs_error_t package_single_nalu(SrsSharedPtrMessage* msg, SrsSample* sample, std::vector<SrsRtpPacket*>& pkts);
-    srs_error_t package_fu_a(SrsSharedPtrMessage* msg, SrsSample* sample, int fu_payload_size, std::vector<SrsRtpPacket*>& pkts);
+    // The packets and payloads are allocated in arena of frame, which is freed when all packets are freed.
+    srs_error_t package_stap_a(SrsRtcSource* source, SrsSharedPtrMessage* msg, SrsRtpFrameArena* arena, SrsRtpPacket* pkt);
+    srs_error_t package_nalus(SrsSharedPtrMessage* msg, SrsRtpFrameArena* arena, const std::vector<SrsSample*>& samples, std::vector<SrsRtpPacket*>& pkts);
+    srs_error_t package_single_nalu(SrsSharedPtrMessage* msg, SrsRtpFrameArena* arena, SrsSample* sample, std::vector<SrsRtpPacket*>& pkts);
+    srs_error_t package_fu_a(SrsSharedPtrMessage* msg, SrsRtpFrameArena* arena, SrsSample* sample, int fu_payload_size, std::vector<SrsRtpPacket*>& pkts);
     srs_error_t consume_packets(std::vector<SrsRtpPacket*>& pkts);
 };
 
-class SrsRtmpFromRtcBridge : public ISrsRtcSourceBridge
+class SrsRtmpFromRtcBridge : public ISrsRtcSourceBridge, public ISrsFastTimer
 {
 private:
+    SrsRequest* req_;
     SrsLiveSource *source_;
-    SrsAudioTranscoder *codec_;
+    SrsAsyncAudioTranscoder *codec_;
+    // The ticks of timer, to update the statistic of audio transcoding.
+    int nn_timer_ticks_;
     bool is_first_audio;
     bool is_first_video;
     // The format, codec information.
     SrsRtmpFormat* format;
-
-    //TODO:use SrsRtpRingBuffer
-    //TODO:jitter buffer class
-    struct RtcPacketCache {
-        bool in_use;
-        uint16_t sn;
-        uint32_t ts;
-        uint32_t rtp_ts;
-        SrsRtpPacket* pkt;
-    };
-    const static uint16_t s_cache_size = 512;
-    RtcPacketCache cache_video_pkts_[s_cache_size];
-    uint16_t header_sn_;
-    uint16_t lost_sn_;
-    int64_t rtp_key_frame_ts_;
+    // The jitter buffer to assemble video frames.
+    SrsRtpJitterBuffer* jitter_;
 private:
     // The state for timestamp sync state. -1 for init. 0 not sync. 1 sync.
     int sync_state_;
@@ -330,18 +371,20 @@ public:
     virtual srs_error_t on_publish();
     virtual srs_error_t on_rtp(SrsRtpPacket *pkt);
     virtual void on_unpublish();
+    virtual bool need_keyframe();
 private:
     srs_error_t transcode_audio(SrsRtpPacket *pkt);
+    // Consume the aac frames transcoded by worker.
+    srs_error_t consume_audios();
     void packet_aac(SrsCommonMessage* audio, char* data, int len, uint32_t pts, bool is_header);
     srs_error_t packet_video(SrsRtpPacket* pkt);
-    srs_error_t packet_video_key_frame(SrsRtpPacket* pkt);
-    srs_error_t packet_video_rtmp(const uint16_t start, const uint16_t end);
-    int32_t find_next_lost_sn(uint16_t current_sn, uint16_t& end_sn);
-    void clear_cached_video();
-    inline uint16_t cache_index(uint16_t current_sn) {
-        return current_sn % s_cache_size;
-    }
-    bool check_frame_complete(const uint16_t start, const uint16_t end);
+    srs_error_t packet_sequence_header(SrsRtpPacket* pkt);
+    // Consume the frames which are ready in jitter buffer.
+    srs_error_t consume_videos();
+    srs_error_t packet_video_rtmp(std::vector<SrsRtpPacket*>& frame);
+// Interface ISrsFastTimer
+private:
+    srs_error_t on_timer(srs_utime_t interval);
 };
 #endif
 
@@ -689,6 +732,8 @@ private:
     bool nack_no_copy_;
     // The pithy print for special stage.
     SrsErrorPithyPrint* nack_epp;
+    // The packets to retransmit for NACK, reused to avoid allocation.
+    std::vector<SrsRtpPacket*> nack_pkts_;
 public:
     SrsRtcSendTrack(SrsRtcConnection* session, SrsRtcTrackDescription* track_desc, bool is_audio);
     virtual ~SrsRtcSendTrack();
@@ -709,7 +754,7 @@ public:
 public:
     virtual srs_error_t on_rtp(SrsRtpPacket* pkt) = 0;
     virtual srs_error_t on_rtcp(SrsRtpPacket* pkt) = 0;
-    virtual srs_error_t on_recv_nack(const std::vector<uint16_t>& lost_seqs);
+    virtual srs_error_t on_recv_nack(SrsRtcpNackIterator& lost_seqs);
 };
 
 class SrsRtcAudioSendTrack : public SrsRtcSendTrack
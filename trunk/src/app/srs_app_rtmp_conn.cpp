@@ -33,12 +33,17 @@ using namespace std;
 #include <srs_app_recv_thread.hpp>
 #include <srs_core_performance.hpp>
 #include <srs_kernel_utility.hpp>
+#include <srs_kernel_kbps.hpp>
 #include <srs_app_security.hpp>
 #include <srs_app_statistic.hpp>
+#include <srs_app_coworkers.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_protocol_json.hpp>
 #include <srs_app_rtc_source.hpp>
 #include <srs_app_tencentcloud.hpp>
+#ifdef SRS_SRT
+#include <srs_app_srt_source.hpp>
+#endif
 
 // the timeout in srs_utime_t to wait encoder to republish
 // if timeout, close the connection.
@@ -112,6 +117,7 @@ SrsRtmpConn::SrsRtmpConn(SrsServer* svr, srs_netfd_t c, string cip, int cport)
     kbps->set_io(skt, skt);
     delta_ = new SrsNetworkDelta();
     delta_->set_io(skt, skt);
+    residence_ = new SrsHistogram();
     
     rtmp = new SrsRtmpServer(skt);
     refer = new SrsRefer();
@@ -149,6 +155,7 @@ SrsRtmpConn::~SrsRtmpConn()
     
     srs_freep(info);
     srs_freep(rtmp);
+    srs_freep(residence_);
     srs_freep(refer);
     srs_freep(security);
 #ifdef SRS_APM
@@ -392,6 +399,11 @@ ISrsKbpsDelta* SrsRtmpConn::delta()
     return delta_;
 }
 
+SrsStatisticHandle& SrsRtmpConn::stat_handle()
+{
+    return stat_handle_;
+}
+
 srs_error_t SrsRtmpConn::service_cycle()
 {
     srs_error_t err = srs_success;
@@ -713,41 +725,33 @@ srs_error_t SrsRtmpConn::playing(SrsLiveSource* source)
     // When origin cluster enabled, try to redirect to the origin which is active.
     // A active origin is a server which is delivering stream.
     if (!info->edge && _srs_config->get_vhost_origin_cluster(req->vhost) && source->inactive()) {
-        vector<string> coworkers = _srs_config->get_vhost_coworkers(req->vhost);
-        for (int i = 0; i < (int)coworkers.size(); i++) {
-            // TODO: FIXME: User may config the server itself as coworker, we must identify and ignore it.
-            string host; int port = 0; string coworker = coworkers.at(i);
-
-            string url = "http://" + coworker + "/api/v1/clusters?"
-                + "vhost=" + req->vhost + "&ip=" + req->host + "&app=" + req->app + "&stream=" + req->stream
-                + "&coworker=" + coworker;
-            if ((err = SrsHttpHooks::discover_co_workers(url, host, port)) != srs_success) {
-                // If failed to discovery stream in this coworker, we should request the next one util the last.
-                // @see https://github.com/ossrs/srs/issues/1223
-                if (i < (int)coworkers.size() - 1) {
-                    continue;
+        // Lookup the stream directory pushed by coworkers, or query all coworkers in parallel if miss.
+        set<string> excludes;
+        for (;;) {
+            string host; int port = 0;
+            if ((err = SrsCoWorkers::instance()->discover(req, excludes, host, port)) != srs_success) {
+                if (!excludes.empty()) {
+                    srs_freep(err);
+                    return srs_error_new(ERROR_OCLUSTER_REDIRECT, "no origin, tried %d", (int)excludes.size());
                 }
-                return srs_error_wrap(err, "discover coworkers, url=%s", url.c_str());
+                return srs_error_wrap(err, "discover coworkers");
             }
 
             string rurl = srs_generate_rtmp_url(host, port, req->host, req->vhost, req->app, req->stream, req->param);
-            srs_trace("rtmp: redirect in cluster, from=%s:%d, target=%s:%d, url=%s, rurl=%s",
-                req->host.c_str(), req->port, host.c_str(), port, url.c_str(), rurl.c_str());
+            srs_trace("rtmp: redirect in cluster, from=%s:%d, target=%s:%d, rurl=%s",
+                req->host.c_str(), req->port, host.c_str(), port, rurl.c_str());
 
-            // Ignore if host or port is invalid.
-            if (host.empty() || port == 0) {
-                continue;
-            }
-            
             bool accepted = false;
-            if ((err = rtmp->redirect(req, rurl, accepted)) != srs_success) {
-                srs_error_reset(err);
-            } else {
+            if ((err = rtmp->redirect(req, rurl, accepted)) == srs_success) {
                 return srs_error_new(ERROR_CONTROL_REDIRECT, "redirected");
             }
+
+            // If failed to redirect to this origin, we should try the next one util the last.
+            // @see https://github.com/ossrs/srs/issues/1223
+            srs_warn("rtmp: ignore redirect to %s, %s", rurl.c_str(), srs_error_desc(err).c_str());
+            srs_freep(err);
+            excludes.insert(host + ":" + srs_int2str(port));
         }
-        
-        return srs_error_new(ERROR_OCLUSTER_REDIRECT, "no origin");
     }
     
     // Set the socket options for transport.
@@ -770,10 +774,16 @@ srs_error_t SrsRtmpConn::playing(SrsLiveSource* source)
         return srs_error_wrap(err, "rtmp: start receive thread");
     }
     
-    // Deliver packets to peer.
+    // Deliver packets to peer, and stat the residence time of messages.
     wakable = consumer;
+    rtmp->set_residence(residence_);
     err = do_playing(source, consumer, &trd);
+    rtmp->set_residence(NULL);
     wakable = NULL;
+
+    // Merge the residence time left to stream.
+    SrsStatistic::instance()->on_rtmp_residence(req, residence_);
+    residence_->clear();
     
     trd.stop();
     
@@ -858,6 +868,9 @@ srs_error_t SrsRtmpConn::do_playing(SrsLiveSource* source, SrsLiveConsumer* cons
 
         // reportable
         if (pprint->can_print()) {
+            SrsStatistic::instance()->on_rtmp_residence(req, residence_);
+            residence_->clear();
+
             kbps->sample();
             srs_trace("-> " SRS_CONSTS_LOG_PLAY " time=%d, msgs=%d, okbps=%d,%d,%d, ikbps=%d,%d,%d, mw=%d/%d",
                 (int)pprint->age(), count, kbps->get_send_kbps(), kbps->get_send_kbps_30s(), kbps->get_send_kbps_5m(),
@@ -1084,34 +1097,18 @@ srs_error_t SrsRtmpConn::acquire_publish(SrsLiveSource* source)
         return srs_error_new(ERROR_SYSTEM_STREAM_BUSY, "rtmp: stream %s is busy", req->get_stream_url().c_str());
     }
 
-    // Check whether RTC stream is busy.
-#ifdef SRS_RTC
-    SrsRtcSource *rtc = NULL;
-    bool rtc_server_enabled = _srs_config->get_rtc_server_enabled();
-    bool rtc_enabled = _srs_config->get_rtc_enabled(req->vhost);
-    if (rtc_server_enabled && rtc_enabled && !info->edge) {
-        if ((err = _srs_rtc_sources->fetch_or_create(req, &rtc)) != srs_success) {
-            return srs_error_wrap(err, "create source");
-        }
+    // Check whether RTC and SRT streams are busy, and bridge to them.
+    SrsCompositeBridge* bridges = new SrsCompositeBridge();
+    SrsAutoFree(SrsCompositeBridge, bridges);
 
-        if (!rtc->can_publish()) {
-            return srs_error_new(ERROR_SYSTEM_STREAM_BUSY, "rtc stream %s busy", req->get_stream_url().c_str());
-        }
+    if ((err = bridges->initialize(req, !info->edge, !info->edge)) != srs_success) {
+        return srs_error_wrap(err, "bridge init");
     }
-#endif
 
-    // Bridge to RTC streaming.
-#if defined(SRS_RTC) && defined(SRS_FFMPEG_FIT)
-    if (rtc) {
-        SrsRtcFromRtmpBridge *bridge = new SrsRtcFromRtmpBridge(rtc);
-        if ((err = bridge->initialize(req)) != srs_success) {
-            srs_freep(bridge);
-            return srs_error_wrap(err, "bridge init");
-        }
-
-        source->set_bridge(bridge);
+    if (!bridges->empty()) {
+        source->set_bridge(bridges);
+        bridges = NULL;
     }
-#endif
 
     // Start publisher now.
     if (info->edge) {
@@ -1178,6 +1175,9 @@ srs_error_t SrsRtmpConn::handle_publish_message(SrsLiveSource* source, SrsCommon
 srs_error_t SrsRtmpConn::process_publish_message(SrsLiveSource* source, SrsCommonMessage* msg)
 {
     srs_error_t err = srs_success;
+
+    // Stamp the message to stat the residence time in server.
+    msg->header.recv_time = srs_update_system_time();
     
     // for edge, directly proxy message to origin.
     if (info->edge) {
@@ -1602,7 +1602,7 @@ srs_error_t SrsRtmpConn::cycle()
 
     // Update statistic when done.
     SrsStatistic* stat = SrsStatistic::instance();
-    stat->kbps_add_delta(get_id().c_str(), delta_);
+    stat->kbps_add_delta(stat_handle_, get_id(), delta_);
     stat->on_disconnect(get_id().c_str(), err);
 
     // Notify manager to remove it.
@@ -16,6 +16,7 @@
 #include <srs_app_reload.hpp>
 #include <srs_protocol_rtmp_stack.hpp>
 #include <srs_protocol_rtmp_conn.hpp>
+#include <srs_app_statistic.hpp>
 
 class SrsServer;
 class SrsRtmpServer;
@@ -39,6 +40,7 @@ class SrsCommonMessage;
 class SrsPacket;
 class SrsNetworkDelta;
 class ISrsApmSpan;
+class SrsHistogram;
 
 // The simple rtmp client for SRS.
 class SrsSimpleRtmpClient : public SrsBasicRtmpClient
@@ -115,6 +117,10 @@ private:
     // The delta for statistic.
     SrsNetworkDelta* delta_;
     SrsNetworkKbps* kbps;
+    // The residence time of messages sent to player, merged to statistic periodically.
+    SrsHistogram* residence_;
+    // The handle of client in statistic.
+    SrsStatisticHandle stat_handle_;
     // The create time in milliseconds.
     // for current connection to log self create time and calculate the living time.
     int64_t create_time;
@@ -139,6 +145,7 @@ public:
     virtual srs_error_t on_reload_vhost_publish(std::string vhost);
 public:
     virtual ISrsKbpsDelta* delta();
+    virtual SrsStatisticHandle& stat_handle();
 private:
     // When valid and connected to vhost/app, service the client.
     virtual srs_error_t service_cycle();
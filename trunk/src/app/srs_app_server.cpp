@@ -34,6 +34,7 @@ using namespace std;
 #include <srs_app_caster_flv.hpp>
 #include <srs_kernel_consts.hpp>
 #include <srs_app_coworkers.hpp>
+#include <srs_app_workers.hpp>
 #include <srs_protocol_log.hpp>
 #include <srs_app_latest_version.hpp>
 #include <srs_app_conn.hpp>
@@ -577,11 +578,11 @@ srs_error_t SrsServer::listen()
         return srs_error_wrap(err, "rtmp listen");
     }
 
-    // Create HTTP API listener.
+    // Create HTTP API listener, only by master worker if not reuse the HTTP server.
     if (_srs_config->get_http_api_enabled()) {
         if (reuse_api_over_server_) {
             srs_trace("HTTP-API: Reuse listen to http server %s", _srs_config->get_http_stream_listen().c_str());
-        } else {
+        } else if (_srs_stream_workers->is_master()) {
             api_listener_->set_endpoint(_srs_config->get_http_api_listen())->set_label("HTTP-API");
             if ((err = api_listener_->listen()) != srs_success) {
                 return srs_error_wrap(err, "http api listen");
@@ -593,7 +594,7 @@ srs_error_t SrsServer::listen()
     if (_srs_config->get_https_api_enabled()) {
         if (reuse_api_over_server_) {
             srs_trace("HTTPS-API: Reuse listen to http server %s", _srs_config->get_http_stream_listen().c_str());
-        } else {
+        } else if (_srs_stream_workers->is_master()) {
             apis_listener_->set_endpoint(_srs_config->get_https_api_listen())->set_label("HTTPS-API");
             if ((err = apis_listener_->listen()) != srs_success) {
                 return srs_error_wrap(err, "https api listen");
@@ -619,7 +620,7 @@ srs_error_t SrsServer::listen()
 
     // Start WebRTC over TCP listener.
 #ifdef SRS_RTC
-    if (!reuse_rtc_over_server_ && _srs_config->get_rtc_server_tcp_enabled()) {
+    if (!reuse_rtc_over_server_ && _srs_config->get_rtc_server_tcp_enabled() && _srs_stream_workers->is_master()) {
         webrtc_listener_->set_endpoint(srs_int2str(_srs_config->get_rtc_server_tcp_listen()))->set_label("WebRTC");
         if ((err = webrtc_listener_->listen()) != srs_success) {
             return srs_error_wrap(err, "webrtc tcp listen");
@@ -627,11 +628,11 @@ srs_error_t SrsServer::listen()
     }
 #endif
 
-    // Start all listeners for stream caster.
+    // Start all listeners for stream caster, only by master worker.
     std::vector<SrsConfDirective*> confs = _srs_config->get_stream_casters();
     for (vector<SrsConfDirective*>::iterator it = confs.begin(); it != confs.end(); ++it) {
         SrsConfDirective* conf = *it;
-        if (!_srs_config->get_stream_caster_enabled(conf)) {
+        if (!_srs_config->get_stream_caster_enabled(conf) || !_srs_stream_workers->is_master()) {
             continue;
         }
 
@@ -666,8 +667,8 @@ srs_error_t SrsServer::listen()
         }
     }
 
-    // Create exporter server listener.
-    if (_srs_config->get_exporter_enabled()) {
+    // Create exporter server listener, only by master worker.
+    if (_srs_config->get_exporter_enabled() && _srs_stream_workers->is_master()) {
         exporter_listener_->set_endpoint(_srs_config->get_exporter_listen())->set_label("Exporter-Server");
         if ((err = exporter_listener_->listen()) != srs_success) {
             return srs_error_wrap(err, "exporter server listen");
@@ -792,6 +793,11 @@ srs_error_t SrsServer::http_handle()
 srs_error_t SrsServer::ingest()
 {
     srs_error_t err = srs_success;
+
+    // The ingesters are started by master worker, or the streams are conflicted.
+    if (!_srs_stream_workers->is_master()) {
+        return err;
+    }
     
     if ((err = ingester->start()) != srs_success) {
         return srs_error_wrap(err, "ingest start");
@@ -808,6 +814,10 @@ srs_error_t SrsServer::start(SrsWaitGroup* wg)
         return srs_error_wrap(err, "sources");
     }
 
+    if ((err = _srs_stream_workers->start(this)) != srs_success) {
+        return srs_error_wrap(err, "workers");
+    }
+
     if ((err = trd_->start()) != srs_success) {
         return srs_error_wrap(err, "start");
     }
@@ -1059,7 +1069,7 @@ srs_error_t SrsServer::setup_ticks()
         }
     }
 
-    if (_srs_config->get_heartbeat_enabled()) {
+    if (_srs_config->get_heartbeat_enabled() && _srs_stream_workers->is_master()) {
         if ((err = timer_->tick(9, _srs_config->get_heartbeat_interval())) != srs_success) {
             return srs_error_wrap(err, "tick");
         }
@@ -1100,20 +1110,20 @@ void SrsServer::resample_kbps()
 
         SrsRtmpConn* rtmp = dynamic_cast<SrsRtmpConn*>(c);
         if (rtmp) {
-            stat->kbps_add_delta(c->get_id().c_str(), rtmp->delta());
+            stat->kbps_add_delta(rtmp->stat_handle(), c->get_id(), rtmp->delta());
             continue;
         }
 
         SrsHttpxConn* httpx = dynamic_cast<SrsHttpxConn*>(c);
         if (httpx) {
-            stat->kbps_add_delta(c->get_id().c_str(), httpx->delta());
+            stat->kbps_add_delta(httpx->stat_handle(), c->get_id(), httpx->delta());
             continue;
         }
 
 #ifdef SRS_RTC
         SrsRtcTcpConn* tcp = dynamic_cast<SrsRtcTcpConn*>(c);
         if (tcp) {
-            stat->kbps_add_delta(c->get_id().c_str(), tcp->delta());
+            stat->kbps_add_delta(tcp->stat_handle(), c->get_id(), tcp->delta());
             continue;
         }
 #endif
@@ -1293,6 +1303,11 @@ srs_error_t SrsServer::on_publish(SrsLiveSource* s, SrsRequest* r)
     if ((err = http_server->http_mount(s, r)) != srs_success) {
         return srs_error_wrap(err, "http mount");
     }
+
+    // The mirror stream is served by the worker of publisher.
+    if (s->mirror()) {
+        return err;
+    }
     
     SrsCoWorkers* coworkers = SrsCoWorkers::instance();
     if ((err = coworkers->on_publish(s, r)) != srs_success) {
@@ -1305,6 +1320,10 @@ srs_error_t SrsServer::on_publish(SrsLiveSource* s, SrsRequest* r)
 void SrsServer::on_unpublish(SrsLiveSource* s, SrsRequest* r)
 {
     http_server->http_unmount(s, r);
+
+    if (s->mirror()) {
+        return;
+    }
     
     SrsCoWorkers* coworkers = SrsCoWorkers::instance();
     coworkers->on_unpublish(s, r);
@@ -28,12 +28,16 @@ using namespace std;
 #include <srs_protocol_rtmp_msg_array.hpp>
 #include <srs_app_hds.hpp>
 #include <srs_app_statistic.hpp>
+#include <srs_app_workers.hpp>
 #include <srs_core_autofree.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_app_ng_exec.hpp>
 #include <srs_app_dash.hpp>
 #include <srs_protocol_format.hpp>
 #include <srs_app_rtc_source.hpp>
+#ifdef SRS_SRT
+#include <srs_app_srt_source.hpp>
+#endif
 #include <srs_app_http_hooks.hpp>
 
 #define CONST_MAX_JITTER_MS         250
@@ -198,22 +202,30 @@ void SrsFastVector::push_back(SrsSharedPtrMessage* msg)
 {
     // increase vector.
     if (count >= nb_msgs) {
-        int size = srs_max(SRS_PERF_MW_MSGS * 8, nb_msgs * 2);
-        SrsSharedPtrMessage** buf = new SrsSharedPtrMessage*[size];
-        for (int i = 0; i < nb_msgs; i++) {
-            buf[i] = msgs[i];
-        }
-        srs_info("fast vector incrase %d=>%d", nb_msgs, size);
-        
-        // use new array.
-        srs_freepa(msgs);
-        msgs = buf;
-        nb_msgs = size;
+        reserve(srs_max(SRS_PERF_MW_MSGS * 8, nb_msgs * 2));
     }
     
     msgs[count++] = msg;
 }
 
+void SrsFastVector::reserve(int size)
+{
+    if (size <= nb_msgs) {
+        return;
+    }
+
+    SrsSharedPtrMessage** buf = new SrsSharedPtrMessage*[size];
+    for (int i = 0; i < count; i++) {
+        buf[i] = msgs[i];
+    }
+    srs_info("fast vector incrase %d=>%d", nb_msgs, size);
+
+    // use new array.
+    srs_freepa(msgs);
+    msgs = buf;
+    nb_msgs = size;
+}
+
 void SrsFastVector::free()
 {
     for (int i = 0; i < count; i++) {
@@ -284,6 +296,42 @@ srs_error_t SrsMessageQueue::enqueue(SrsSharedPtrMessage* msg, bool* is_overflow
     return err;
 }
 
+srs_error_t SrsMessageQueue::enqueue(SrsSharedPtrMessage** pmsgs, int count, bool* is_overflow)
+{
+    srs_error_t err = srs_success;
+
+    msgs.reserve(msgs.size() + count);
+
+    for (int i = 0; i < count; i++) {
+        SrsSharedPtrMessage* msg = pmsgs[i];
+        msgs.push_back(msg);
+
+        // Ignore the zero timestamps, see SrsMessageQueue::enqueue for detail.
+        if (msg->is_av() && msg->timestamp != 0) {
+            if (av_start_time == -1) {
+                av_start_time = srs_utime_t(msg->timestamp * SRS_UTIME_MILLISECONDS);
+            }
+
+            av_end_time = srs_utime_t(msg->timestamp * SRS_UTIME_MILLISECONDS);
+        }
+    }
+
+    if (max_queue_size <= 0) {
+        return err;
+    }
+
+    // Check the overflow only once for the batch.
+    while (av_end_time - av_start_time > max_queue_size) {
+        if (is_overflow) {
+            *is_overflow = true;
+        }
+
+        shrink();
+    }
+
+    return err;
+}
+
 srs_error_t SrsMessageQueue::dump_packets(int max_count, SrsSharedPtrMessage** pmsgs, int& count)
 {
     srs_error_t err = srs_success;
@@ -464,33 +512,79 @@ srs_error_t SrsLiveConsumer::enqueue(SrsSharedPtrMessage* shared_msg, bool atc,
     }
     
 #ifdef SRS_PERF_QUEUE_COND_WAIT
-    // fire the mw when msgs is enough.
-    if (mw_waiting) {
-        // For RTMP, we wait for messages and duration.
-        srs_utime_t duration = queue->duration();
-        bool match_min_msgs = queue->size() > mw_min_msgs;
-        
-        // For ATC, maybe the SH timestamp bigger than A/V packet,
-        // when encoder republish or overflow.
-        // @see https://github.com/ossrs/srs/pull/749
-        if (atc && duration < 0) {
-            srs_cond_signal(mw_wait);
-            mw_waiting = false;
-            return err;
-        }
-        
-        // when duration ok, signal to flush.
-        if (match_min_msgs && duration > mw_duration) {
-            srs_cond_signal(mw_wait);
-            mw_waiting = false;
-            return err;
+    notify_waiting(atc);
+#endif
+    
+    return err;
+}
+
+srs_error_t SrsLiveConsumer::enqueue(SrsSharedPtrMessage** msgs, int count, bool atc, SrsRtmpJitterAlgorithm ag)
+{
+    srs_error_t err = srs_success;
+
+    if (count <= 0) {
+        return err;
+    }
+
+    // Copy all messages before enqueue, which only increase the reference of payload. We never reference the gop cache
+    // from the queue by cursor, because the queue of consumer shrinks and frees messages independently, and the
+    // timestamp of each message is corrected by the jitter of consumer.
+    std::vector<SrsSharedPtrMessage*> copies(count);
+    for (int i = 0; i < count; i++) {
+        copies[i] = msgs[i]->copy();
+    }
+
+    if (!atc) {
+        for (int i = 0; i < count; i++) {
+            if ((err = jitter->correct(copies[i], ag)) != srs_success) {
+                for (int j = 0; j < count; j++) {
+                    srs_freep(copies[j]);
+                }
+                return srs_error_wrap(err, "consume message");
+            }
         }
     }
+
+    if ((err = queue->enqueue(&copies[0], count, NULL)) != srs_success) {
+        return srs_error_wrap(err, "enqueue messages");
+    }
+
+#ifdef SRS_PERF_QUEUE_COND_WAIT
+    notify_waiting(atc);
 #endif
-    
+
     return err;
 }
 
+#ifdef SRS_PERF_QUEUE_COND_WAIT
+void SrsLiveConsumer::notify_waiting(bool atc)
+{
+    // fire the mw when msgs is enough.
+    if (!mw_waiting) {
+        return;
+    }
+
+    // For RTMP, we wait for messages and duration.
+    srs_utime_t duration = queue->duration();
+    bool match_min_msgs = queue->size() > mw_min_msgs;
+
+    // For ATC, maybe the SH timestamp bigger than A/V packet,
+    // when encoder republish or overflow.
+    // @see https://github.com/ossrs/srs/pull/749
+    if (atc && duration < 0) {
+        srs_cond_signal(mw_wait);
+        mw_waiting = false;
+        return;
+    }
+
+    // when duration ok, signal to flush.
+    if (match_min_msgs && duration > mw_duration) {
+        srs_cond_signal(mw_wait);
+        mw_waiting = false;
+    }
+}
+#endif
+
 srs_error_t SrsLiveConsumer::dump_packets(SrsMessageArray* msgs, int& count)
 {
     srs_error_t err = srs_success;
@@ -576,6 +670,10 @@ SrsGopCache::SrsGopCache()
     enable_gop_cache = true;
     audio_after_last_video_count = 0;
     gop_cache_max_frames_ = 0;
+    gop_cache_max_bytes_ = 0;
+    gop_cache_fast_start_ = 0;
+    cached_bytes = 0;
+    keyframe_index = -1;
 }
 
 SrsGopCache::~SrsGopCache()
@@ -603,6 +701,16 @@ void SrsGopCache::set_gop_cache_max_frames(int v)
     gop_cache_max_frames_ = v;
 }
 
+void SrsGopCache::set_gop_cache_max_bytes(int v)
+{
+    gop_cache_max_bytes_ = v;
+}
+
+void SrsGopCache::set_gop_cache_fast_start(srs_utime_t v)
+{
+    gop_cache_fast_start_ = v;
+}
+
 bool SrsGopCache::enabled()
 {
     return enable_gop_cache;
@@ -648,15 +756,20 @@ srs_error_t SrsGopCache::cache(SrsSharedPtrMessage* shared_msg)
     }
     
     // clear gop cache when got key frame
-    if (msg->is_video() && SrsFlvVideo::keyframe(msg->payload, msg->size)) {
+    bool is_keyframe = msg->is_video() && SrsFlvVideo::keyframe(msg->payload, msg->size);
+    if (is_keyframe) {
         clear();
         
         // curent msg is video frame, so we set to 1.
         cached_video_count = 1;
+        keyframe_index = (int)gop_cache.size();
     }
 
-    // cache the frame.
-    gop_cache.push_back(msg->copy());
+    // cache the frame, which is delivered later to new players, so it's not the residence time of stream.
+    SrsSharedPtrMessage* cached = msg->copy();
+    cached->recv_time = 0;
+    gop_cache.push_back(cached);
+    cached_bytes += msg->size;
 
     // Clear gop cache if exceed the max frames.
     if (gop_cache_max_frames_ > 0 && gop_cache.size() > (size_t)gop_cache_max_frames_) {
@@ -665,6 +778,13 @@ srs_error_t SrsGopCache::cache(SrsSharedPtrMessage* shared_msg)
         clear();
     }
 
+    // Clear gop cache if exceed the max bytes, for stream with long gop and high bitrate.
+    if (gop_cache_max_bytes_ > 0 && cached_bytes > gop_cache_max_bytes_) {
+        srs_warn("Gop cache exceed max bytes=%d, total=%d, frames=%d, videos=%d",
+            gop_cache_max_bytes_, cached_bytes, (int)gop_cache.size(), cached_video_count);
+        clear();
+    }
+
     return err;
 }
 
@@ -679,20 +799,37 @@ void SrsGopCache::clear()
     
     cached_video_count = 0;
     audio_after_last_video_count = 0;
+    cached_bytes = 0;
+    keyframe_index = -1;
 }
 
 srs_error_t SrsGopCache::dump(SrsLiveConsumer* consumer, bool atc, SrsRtmpJitterAlgorithm jitter_algorithm)
 {
     srs_error_t err = srs_success;
-    
-    std::vector<SrsSharedPtrMessage*>::iterator it;
-    for (it = gop_cache.begin(); it != gop_cache.end(); ++it) {
-        SrsSharedPtrMessage* msg = *it;
-        if ((err = consumer->enqueue(msg, atc, jitter_algorithm)) != srs_success) {
-            return srs_error_wrap(err, "enqueue message");
+
+    if (gop_cache.empty()) {
+        return err;
+    }
+
+    // For fast start, start from the newest cached keyframe if it's within N ms, or the player starts from the next
+    // keyframe, because the frames before the keyframe is useless for decoder.
+    int start = 0;
+    if (gop_cache_fast_start_ > 0) {
+        srs_utime_t age = keyframe_age();
+        if (age < 0 || age > gop_cache_fast_start_) {
+            srs_trace("ignore cached gop for fast start. count=%d, keyframe=%d, age=%dms, max=%dms", (int)gop_cache.size(),
+                keyframe_index, srsu2msi(age), srsu2msi(gop_cache_fast_start_));
+            return err;
         }
+        start = keyframe_index;
+    }
+
+    // Attach the gop from the start to consumer as a batch.
+    int count = (int)gop_cache.size() - start;
+    if ((err = consumer->enqueue(&gop_cache[start], count, atc, jitter_algorithm)) != srs_success) {
+        return srs_error_wrap(err, "enqueue messages");
     }
-    srs_trace("dispatch cached gop success. count=%d, duration=%d", (int)gop_cache.size(), consumer->get_time());
+    srs_trace("dispatch cached gop success. count=%d, bytes=%d, duration=%d", count, cached_bytes, consumer->get_time());
     
     return err;
 }
@@ -714,6 +851,41 @@ srs_utime_t SrsGopCache::start_time()
     return srs_utime_t(msg->timestamp * SRS_UTIME_MILLISECONDS);
 }
 
+srs_utime_t SrsGopCache::duration()
+{
+    if (empty()) {
+        return 0;
+    }
+
+    SrsSharedPtrMessage* first = gop_cache.front();
+    SrsSharedPtrMessage* last = gop_cache.back();
+    if (last->timestamp <= first->timestamp) {
+        return 0;
+    }
+
+    return srs_utime_t((last->timestamp - first->timestamp) * SRS_UTIME_MILLISECONDS);
+}
+
+srs_utime_t SrsGopCache::keyframe_age()
+{
+    if (keyframe_index < 0 || keyframe_index >= (int)gop_cache.size()) {
+        return -1;
+    }
+
+    SrsSharedPtrMessage* keyframe = gop_cache[keyframe_index];
+    SrsSharedPtrMessage* last = gop_cache.back();
+    if (last->timestamp <= keyframe->timestamp) {
+        return 0;
+    }
+
+    return srs_utime_t((last->timestamp - keyframe->timestamp) * SRS_UTIME_MILLISECONDS);
+}
+
+int SrsGopCache::bytes()
+{
+    return cached_bytes;
+}
+
 bool SrsGopCache::pure_audio()
 {
     return cached_video_count == 0;
@@ -1712,6 +1884,9 @@ srs_error_t SrsMetaCache::update_data(SrsMessageHeader* header, SrsOnMetaDataPac
     if ((err = meta->create(header, payload, size)) != srs_success) {
         return srs_error_wrap(err, "create metadata");
     }
+
+    // The metadata is cached and delivered to new players, so ignore its residence time.
+    meta->recv_time = 0;
     
     return err;
 }
@@ -1720,6 +1895,7 @@ srs_error_t SrsMetaCache::update_ash(SrsSharedPtrMessage* msg)
 {
     srs_freep(audio);
     audio = msg->copy();
+    audio->recv_time = 0;
     update_previous_ash();
     return aformat->on_audio(msg);
 }
@@ -1728,6 +1904,7 @@ srs_error_t SrsMetaCache::update_vsh(SrsSharedPtrMessage* msg)
 {
     srs_freep(video);
     video = msg->copy();
+    video->recv_time = 0;
     update_previous_vsh();
     return vformat->on_video(msg);
 }
@@ -1891,6 +2068,147 @@ ISrsLiveSourceBridge::~ISrsLiveSourceBridge()
 {
 }
 
+SrsCompositeBridge::SrsCompositeBridge()
+{
+}
+
+SrsCompositeBridge::~SrsCompositeBridge()
+{
+    for (int i = 0; i < (int)bridges_.size(); i++) {
+        ISrsLiveSourceBridge* bridge = bridges_.at(i);
+        srs_freep(bridge);
+    }
+    bridges_.clear();
+}
+
+srs_error_t SrsCompositeBridge::initialize(SrsRequest* r, bool rtc, bool srt)
+{
+    srs_error_t err = srs_success;
+
+    // The RTC and SRT servers are only served by master worker, so the streams published to other workers are
+    // bridged by master, from the mirrored stream.
+    if (!_srs_stream_workers->is_master()) {
+        return err;
+    }
+
+    // Check whether RTC stream is busy.
+#ifdef SRS_RTC
+    SrsRtcSource* rtc_source = NULL;
+    if (rtc && _srs_config->get_rtc_server_enabled() && _srs_config->get_rtc_enabled(r->vhost)) {
+        if ((err = _srs_rtc_sources->fetch_or_create(r, &rtc_source)) != srs_success) {
+            return srs_error_wrap(err, "create rtc source");
+        }
+
+        if (!rtc_source->can_publish()) {
+            return srs_error_new(ERROR_SYSTEM_STREAM_BUSY, "rtc stream %s busy", r->get_stream_url().c_str());
+        }
+    }
+#endif
+
+    // Check whether SRT stream is busy.
+#ifdef SRS_SRT
+    SrsSrtSource* srt_source = NULL;
+    if (srt && _srs_config->get_srt_enabled() && _srs_config->get_srt_enabled(r->vhost)
+        && _srs_config->get_srt_from_rtmp(r->vhost)) {
+        if ((err = _srs_srt_sources->fetch_or_create(r, &srt_source)) != srs_success) {
+            return srs_error_wrap(err, "create srt source");
+        }
+
+        if (!srt_source->can_publish()) {
+            return srs_error_new(ERROR_SYSTEM_STREAM_BUSY, "srt stream %s busy", r->get_stream_url().c_str());
+        }
+    }
+#endif
+
+    // Bridge to RTC streaming.
+#if defined(SRS_RTC) && defined(SRS_FFMPEG_FIT)
+    if (rtc_source) {
+        SrsRtcFromRtmpBridge* bridge = new SrsRtcFromRtmpBridge(rtc_source);
+        if ((err = bridge->initialize(r)) != srs_success) {
+            srs_freep(bridge);
+            return srs_error_wrap(err, "rtc bridge init");
+        }
+
+        append(bridge);
+    }
+#endif
+
+    // Bridge to SRT streaming, mux to TS once and shared by all SRT players.
+#ifdef SRS_SRT
+    if (srt_source) {
+        SrsSrtFromRtmpBridge* bridge = new SrsSrtFromRtmpBridge(srt_source);
+        if ((err = bridge->initialize(r)) != srs_success) {
+            srs_freep(bridge);
+            return srs_error_wrap(err, "srt bridge init");
+        }
+
+        append(bridge);
+    }
+#endif
+
+    return err;
+}
+
+bool SrsCompositeBridge::empty()
+{
+    return bridges_.empty();
+}
+
+void SrsCompositeBridge::append(ISrsLiveSourceBridge* bridge)
+{
+    bridges_.push_back(bridge);
+}
+
+srs_error_t SrsCompositeBridge::on_publish()
+{
+    srs_error_t err = srs_success;
+
+    for (int i = 0; i < (int)bridges_.size(); i++) {
+        ISrsLiveSourceBridge* bridge = bridges_.at(i);
+        if ((err = bridge->on_publish()) != srs_success) {
+            return srs_error_wrap(err, "bridge publish");
+        }
+    }
+
+    return err;
+}
+
+srs_error_t SrsCompositeBridge::on_audio(SrsSharedPtrMessage* audio)
+{
+    srs_error_t err = srs_success;
+
+    for (int i = 0; i < (int)bridges_.size(); i++) {
+        ISrsLiveSourceBridge* bridge = bridges_.at(i);
+        if ((err = bridge->on_audio(audio)) != srs_success) {
+            return srs_error_wrap(err, "bridge audio");
+        }
+    }
+
+    return err;
+}
+
+srs_error_t SrsCompositeBridge::on_video(SrsSharedPtrMessage* video)
+{
+    srs_error_t err = srs_success;
+
+    for (int i = 0; i < (int)bridges_.size(); i++) {
+        ISrsLiveSourceBridge* bridge = bridges_.at(i);
+        if ((err = bridge->on_video(video)) != srs_success) {
+            return srs_error_wrap(err, "bridge video");
+        }
+    }
+
+    return err;
+}
+
+void SrsCompositeBridge::on_unpublish()
+{
+    for (int i = 0; i < (int)bridges_.size(); i++) {
+        ISrsLiveSourceBridge* bridge = bridges_.at(i);
+        bridge->on_unpublish();
+    }
+}
+
 SrsLiveSource::SrsLiveSource()
 {
     req = NULL;
@@ -1899,6 +2217,7 @@ SrsLiveSource::SrsLiveSource()
     mix_queue = new SrsMixQueue();
     
     _can_publish = true;
+    mirror_ = false;
     stream_die_at_ = 0;
     publisher_idle_at_ = 0;
 
@@ -2006,6 +2325,9 @@ srs_error_t SrsLiveSource::initialize(SrsRequest* r, ISrsLiveSourceHandler* h)
     req = r->copy();
     atc = _srs_config->get_atc(req->vhost);
 
+    gop_cache->set_gop_cache_max_bytes(_srs_config->get_gop_cache_max_bytes(req->vhost));
+    gop_cache->set_gop_cache_fast_start(_srs_config->get_gop_cache_fast_start(req->vhost));
+
     if ((err = format_->initialize()) != srs_success) {
         return srs_error_wrap(err, "format initialize");
     }
@@ -2039,6 +2361,16 @@ void SrsLiveSource::set_bridge(ISrsLiveSourceBridge* v)
     bridge_ = v;
 }
 
+void SrsLiveSource::set_mirror(bool v)
+{
+    mirror_ = v;
+}
+
+bool SrsLiveSource::mirror()
+{
+    return mirror_;
+}
+
 srs_error_t SrsLiveSource::on_reload_vhost_play(string vhost)
 {
     srs_error_t err = srs_success;
@@ -2082,6 +2414,9 @@ srs_error_t SrsLiveSource::on_reload_vhost_play(string vhost)
             gop_cache->set(v);
             gop_cache->set_gop_cache_max_frames(_srs_config->get_gop_cache_max_frames(vhost));
         }
+
+        gop_cache->set_gop_cache_max_bytes(_srs_config->get_gop_cache_max_bytes(vhost));
+        gop_cache->set_gop_cache_fast_start(_srs_config->get_gop_cache_fast_start(vhost));
     }
     
     // queue length
@@ -2223,7 +2558,15 @@ srs_error_t SrsLiveSource::on_meta_data(SrsCommonMessage* msg, SrsOnMetaDataPack
         }
     }
     
+    // Mirror to other workers.
+    if (!mirror_) {
+        _srs_stream_workers->on_message(this, meta->data());
+    }
+
     // Copy to hub to all utilities.
+    if (mirror_) {
+        return err;
+    }
     return hub->on_meta_data(meta->data(), metadata);
 }
 
@@ -2301,7 +2644,7 @@ srs_error_t SrsLiveSource::on_audio_imp(SrsSharedPtrMessage* msg)
     }
     
     // Copy to hub to all utilities.
-    if ((err = hub->on_audio(msg)) != srs_success) {
+    if (!mirror_ && (err = hub->on_audio(msg)) != srs_success) {
         return srs_error_wrap(err, "consume audio");
     }
 
@@ -2310,6 +2653,11 @@ srs_error_t SrsLiveSource::on_audio_imp(SrsSharedPtrMessage* msg)
         return srs_error_wrap(err, "bridge consume audio");
     }
 
+    // Mirror to other workers.
+    if (!mirror_) {
+        _srs_stream_workers->on_message(this, msg);
+    }
+
     // copy to all consumer
     if (!drop_for_reduce) {
         for (int i = 0; i < (int)consumers.size(); i++) {
@@ -2446,7 +2794,7 @@ srs_error_t SrsLiveSource::on_video_imp(SrsSharedPtrMessage* msg)
     }
     
     // Copy to hub to all utilities.
-    if ((err = hub->on_video(msg, is_sequence_header)) != srs_success) {
+    if (!mirror_ && (err = hub->on_video(msg, is_sequence_header)) != srs_success) {
         return srs_error_wrap(err, "hub consume video");
     }
 
@@ -2455,6 +2803,11 @@ srs_error_t SrsLiveSource::on_video_imp(SrsSharedPtrMessage* msg)
         return srs_error_wrap(err, "bridge consume video");
     }
 
+    // Mirror to other workers.
+    if (!mirror_) {
+        _srs_stream_workers->on_message(this, msg);
+    }
+
     // copy to all consumer
     if (!drop_for_reduce) {
         for (int i = 0; i < (int)consumers.size(); i++) {
@@ -2553,8 +2906,8 @@ srs_error_t SrsLiveSource::on_aggregate(SrsCommonMessage* msg)
         o.header.perfer_cid = msg->header.perfer_cid;
         
         if (data_size > 0) {
+            o.create_payload(data_size);
             o.size = data_size;
-            o.payload = new char[o.size];
             stream->read_bytes(o.payload, o.size);
         }
         
@@ -2605,7 +2958,7 @@ srs_error_t SrsLiveSource::on_publish()
     last_packet_time = 0;
     
     // Notify the hub about the publish event.
-    if ((err = hub->on_publish()) != srs_success) {
+    if (!mirror_ && (err = hub->on_publish()) != srs_success) {
         return srs_error_wrap(err, "hub publish");
     }
     
@@ -2619,6 +2972,11 @@ srs_error_t SrsLiveSource::on_publish()
         return srs_error_wrap(err, "bridge publish");
     }
 
+    // Mirror to other workers.
+    if (!mirror_) {
+        _srs_stream_workers->on_publish(this, req);
+    }
+
     SrsStatistic* stat = SrsStatistic::instance();
     stat->on_stream_publish(req, _source_id.c_str());
 
@@ -2638,7 +2996,10 @@ void SrsLiveSource::on_unpublish()
     }
     
     // Notify the hub about the unpublish event.
-    hub->on_unpublish();
+    if (!mirror_) {
+        hub->on_unpublish();
+        _srs_stream_workers->on_unpublish(this);
+    }
     
     // only clear the gop cache,
     // donot clear the sequence header, for it maybe not changed,
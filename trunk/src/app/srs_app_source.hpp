@@ -95,6 +95,8 @@ public:
     virtual void clear();
     virtual void erase(int _begin, int _end);
     virtual void push_back(SrsSharedPtrMessage* msg);
+    // Ensure the space for size messages, to avoid increasing when push back a batch.
+    virtual void reserve(int size);
     virtual void free();
 };
 #endif
@@ -133,6 +135,9 @@ public:
     // @param msg, the msg to enqueue, user never free it whatever the return code.
     // @param is_overflow, whether overflow and shrinked. NULL to ignore.
     virtual srs_error_t enqueue(SrsSharedPtrMessage* msg, bool* is_overflow = NULL);
+    // Enqueue a batch of messages, for example, the gop cache, which only check overflow once.
+    // @param msgs, the msgs to enqueue, user never free them whatever the return code.
+    virtual srs_error_t enqueue(SrsSharedPtrMessage** msgs, int count, bool* is_overflow = NULL);
     // Get packets in consumer queue.
     // @pmsgs SrsSharedPtrMessage*[], used to store the msgs, user must alloc it.
     // @count the count in array, output param.
@@ -197,6 +202,15 @@ public:
     // @param whether atc, donot use jitter correct if true.
     // @param ag the algorithm of time jitter.
     virtual srs_error_t enqueue(SrsSharedPtrMessage* shared_msg, bool atc, SrsRtmpJitterAlgorithm ag);
+    // Attach a batch of shared ptr messages, for example, the gop cache.
+    // @param msgs, directly ptr, copy them to consume.
+    virtual srs_error_t enqueue(SrsSharedPtrMessage** msgs, int count, bool atc, SrsRtmpJitterAlgorithm ag);
+private:
+#ifdef SRS_PERF_QUEUE_COND_WAIT
+    // Wakeup the waiting consumer when msgs is enough.
+    virtual void notify_waiting(bool atc);
+#endif
+public:
     // Get packets in consumer queue.
     // @param msgs the msgs array to dump packets to send.
     // @param count the count in array, intput and output param.
@@ -232,6 +246,12 @@ private:
     // without this limit, if ingest stream always has no IDR frame
     // it will cause srs run out of memory
     int gop_cache_max_frames_;
+    // To limit the max bytes of payload in gop cache, 0 to disable.
+    int gop_cache_max_bytes_;
+    // Only dump the gop cache when its duration is within this, 0 to disable.
+    srs_utime_t gop_cache_fast_start_;
+    // The bytes of payload in gop cache.
+    int cached_bytes;
     // The video frame count, avoid cache for pure audio stream.
     int cached_video_count;
     // when user disabled video when publishing, and gop cache enalbed,
@@ -245,8 +265,12 @@ private:
     //       gop cache is disabled for pure audio stream.
     // @see: https://github.com/ossrs/srs/issues/124
     int audio_after_last_video_count;
-    // cached gop.
+    // cached gop. The payload is shared with messages, and the vector keeps its capacity when clear, so it's an arena
+    // of the current gop, to attach to consumer as a batch.
     std::vector<SrsSharedPtrMessage*> gop_cache;
+    // The position of the newest keyframe in gop cache, indexed when cache it, -1 if no keyframe. Note that the
+    // gop cache may start with frames which is not keyframe, for example, when publish starts or the cache overflows.
+    int keyframe_index;
 public:
     SrsGopCache();
     virtual ~SrsGopCache();
@@ -256,6 +280,8 @@ public:
     // To enable or disable the gop cache.
     virtual void set(bool v);
     virtual void set_gop_cache_max_frames(int v);
+    virtual void set_gop_cache_max_bytes(int v);
+    virtual void set_gop_cache_fast_start(srs_utime_t v);
     virtual bool enabled();
     // only for h264 codec
     // 1. cache the gop when got h264 video packet.
@@ -272,6 +298,12 @@ public:
     // Get the start time of gop cache, in srs_utime_t.
     // @return 0 if no packets.
     virtual srs_utime_t start_time();
+    // Get the duration of gop cache, from the first to the last message.
+    virtual srs_utime_t duration();
+    // Get the age of the newest keyframe, from it to the last message, -1 if no keyframe.
+    virtual srs_utime_t keyframe_age();
+    // Get the bytes of payload in gop cache.
+    virtual int bytes();
     // whether current stream is pure audio,
     // when no video in gop cache, the stream is pure audio right now.
     virtual bool pure_audio();
@@ -486,6 +518,28 @@ public:
     virtual void on_unpublish() = 0;
 };
 
+// The composite bridge, to bridge the live source to multiple sources, such as RTC and SRT.
+class SrsCompositeBridge : public ISrsLiveSourceBridge
+{
+private:
+    std::vector<ISrsLiveSourceBridge*> bridges_;
+public:
+    SrsCompositeBridge();
+    virtual ~SrsCompositeBridge();
+public:
+    // Create the bridges to RTC and SRT by config of vhost, and check whether the streams are busy. Set rtc
+    // or srt to false to never bridge back to the publisher, for example, the stream published by WebRTC.
+    srs_error_t initialize(SrsRequest* r, bool rtc, bool srt);
+    bool empty();
+    // Append the bridge, which is freed by composite bridge.
+    void append(ISrsLiveSourceBridge* bridge);
+public:
+    virtual srs_error_t on_publish();
+    virtual srs_error_t on_audio(SrsSharedPtrMessage* audio);
+    virtual srs_error_t on_video(SrsSharedPtrMessage* video);
+    virtual void on_unpublish();
+};
+
 // The live streaming source.
 class SrsLiveSource : public ISrsReloadHandler
 {
@@ -535,6 +589,8 @@ private:
 private:
     // Whether source is avaiable for publishing.
     bool _can_publish;
+    // Whether source is mirrored from another worker, which is delivered to players only.
+    bool mirror_;
     // The last die time, while die means neither publishers nor players.
     srs_utime_t stream_die_at_;
     // The last idle time, while idle means no players.
@@ -554,6 +610,10 @@ public:
     virtual srs_error_t initialize(SrsRequest* r, ISrsLiveSourceHandler* h);
     // Bridge to other source, forward packets to it.
     void set_bridge(ISrsLiveSourceBridge* v);
+    // Mark the source as mirror of stream published on another worker, so the hub such as HLS, DVR and
+    // forward is bypassed, which is done by the worker of publisher.
+    void set_mirror(bool v);
+    bool mirror();
 // Interface ISrsReloadHandler
 public:
     virtual srs_error_t on_reload_vhost_play(std::string vhost);
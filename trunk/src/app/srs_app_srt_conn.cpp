@@ -199,6 +199,11 @@ ISrsKbpsDelta* SrsMpegtsSrtConn::delta()
     return delta_;
 }
 
+SrsStatisticHandle& SrsMpegtsSrtConn::stat_handle()
+{
+    return stat_handle_;
+}
+
 void SrsMpegtsSrtConn::expire()
 {
     trd_->interrupt();
@@ -231,7 +236,7 @@ srs_error_t SrsMpegtsSrtConn::cycle()
 
     // Update statistic when done.
     SrsStatistic* stat = SrsStatistic::instance();
-    stat->kbps_add_delta(get_id().c_str(), delta_);
+    stat->kbps_add_delta(stat_handle_, get_id(), delta_);
     stat->on_disconnect(get_id().c_str(), err);
 
     // Notify manager to remove it.
@@ -386,38 +391,19 @@ srs_error_t SrsMpegtsSrtConn::acquire_publish()
         live_source->set_cache(enabled_cache);
         live_source->set_gop_cache_max_frames(gcmf);
 
-        // srt->rtmp->rtc
-        // TODO: FIXME: the code below is repeat in srs_app_rtmp_conn.cpp, refactor it later, use function instead.
-
-        // Check whether RTC stream is busy.
-#ifdef SRS_RTC
-        SrsRtcSource *rtc = NULL;
-        bool rtc_server_enabled = _srs_config->get_rtc_server_enabled();
-        bool rtc_enabled = _srs_config->get_rtc_enabled(req_->vhost);
+        // srt->rtmp->rtc, never bridge back to SRT which is the publisher.
         bool edge = _srs_config->get_vhost_is_edge(req_->vhost);
-        if (rtc_server_enabled && rtc_enabled && ! edge) {
-            if ((err = _srs_rtc_sources->fetch_or_create(req_, &rtc)) != srs_success) {
-                return srs_error_wrap(err, "create source");
-            }
-
-            if (!rtc->can_publish()) {
-                return srs_error_new(ERROR_SYSTEM_STREAM_BUSY, "rtc stream %s busy", req_->get_stream_url().c_str());
-            }
+        SrsCompositeBridge* bridges = new SrsCompositeBridge();
+        if ((err = bridges->initialize(req_, !edge, false)) != srs_success) {
+            srs_freep(bridges);
+            return srs_error_wrap(err, "bridge init");
         }
-#endif
-
-        // Bridge to RTC streaming.
-#if defined(SRS_RTC) && defined(SRS_FFMPEG_FIT)
-        if (rtc) {
-            SrsRtcFromRtmpBridge *bridge = new SrsRtcFromRtmpBridge(rtc);
-            if ((err = bridge->initialize(req_)) != srs_success) {
-                srs_freep(bridge);
-                return srs_error_wrap(err, "bridge init");
-            }
 
-            live_source->set_bridge(bridge);
+        if (!bridges->empty()) {
+            live_source->set_bridge(bridges);
+        } else {
+            srs_freep(bridges);
         }
-#endif
 
         SrsRtmpFromSrtBridge *bridger = new SrsRtmpFromSrtBridge(live_source);
         if ((err = bridger->initialize(req_)) != srs_success) {
@@ -514,6 +500,11 @@ srs_error_t SrsMpegtsSrtConn::do_playing()
 
     int nb_packets = 0;
 
+    // Pace the packets by timestamp, to avoid burst of large frame which makes the SRT sender drops packets.
+    bool pacing = _srs_config->get_srt_pacing(req_->vhost);
+    int64_t base_timestamp = -1;
+    srs_utime_t base_time = 0;
+
     while (true) {
         if ((err = trd_->pull()) != srs_success) {
             return srs_error_wrap(err, "srt play thread");
@@ -525,8 +516,10 @@ srs_error_t SrsMpegtsSrtConn::do_playing()
 
         // Wait for amount of packets.
         SrsSrtPacket* pkt = NULL;
-        SrsAutoFree(SrsSrtPacket, pkt);
-        consumer->dump_packet(&pkt);
+        SrsAutoFreeH(SrsSrtPacket, pkt, srs_srt_packet_release);
+        if ((err = consumer->dump_packet(&pkt)) != srs_success) {
+            return srs_error_wrap(err, "dump packet");
+        }
         if (!pkt) {
             // TODO: FIXME: We should check the quit event.
             consumer->wait(1, 1000 * SRS_UTIME_MILLISECONDS);
@@ -553,6 +546,22 @@ srs_error_t SrsMpegtsSrtConn::do_playing()
             nb_packets = 0;
         }
 
+        // Only the packets from RTMP have timestamp, the packets from SRT publisher are sent directly.
+        if (pacing && pkt->timestamp() >= 0) {
+            srs_utime_t now = srs_update_system_time();
+            srs_utime_t due = base_time + (pkt->timestamp() - base_timestamp) * SRS_UTIME_MILLISECONDS;
+
+            // Reset the base when start, or timestamp jitter, or we're too slow to catch up.
+            if (base_timestamp < 0 || pkt->timestamp() < base_timestamp || due > now + SRS_UTIME_SECONDS || due < now - SRS_UTIME_SECONDS) {
+                base_timestamp = pkt->timestamp();
+                base_time = due = now;
+            }
+
+            if (due > now) {
+                srs_usleep(due - now);
+            }
+        }
+
         ssize_t nb_write = 0;
         if ((err = srt_conn_->write(pkt->data(), pkt->size(), &nb_write)) != srs_success) {
             return srs_error_wrap(err, "srt send, size=%d", pkt->size());
@@ -586,7 +595,7 @@ srs_error_t SrsMpegtsSrtConn::on_srt_packet(char* buf, int nb_buf)
     }
 
     SrsSrtPacket* packet = new SrsSrtPacket();
-    SrsAutoFree(SrsSrtPacket, packet);
+    SrsAutoFreeH(SrsSrtPacket, packet, srs_srt_packet_release);
     packet->wrap(buf, nb_buf);
 
     if ((err = srt_source_->on_packet(packet)) != srs_success) {
@@ -17,6 +17,7 @@
 #include <srs_app_conn.hpp>
 #include <srs_app_srt_utility.hpp>
 #include <srs_app_security.hpp>
+#include <srs_app_statistic.hpp>
 
 class SrsBuffer;
 class SrsLiveSource;
@@ -82,6 +83,7 @@ public:
     virtual std::string desc();
 public:
     ISrsKbpsDelta* delta();
+    SrsStatisticHandle& stat_handle();
 // Interface ISrsExpire
 public:
     virtual void expire();
@@ -118,6 +120,8 @@ private:
     SrsSrtConnection* srt_conn_;
     SrsNetworkDelta* delta_;
     SrsNetworkKbps* kbps_;
+    // The handle of client in statistic.
+    SrsStatisticHandle stat_handle_;
     std::string ip_;
     int port_;
     SrsCoroutine* trd_;
@@ -6,6 +6,9 @@
 
 #include <srs_app_srt_server.hpp>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 using namespace std;
 
 #include <srs_kernel_log.hpp>
@@ -14,6 +17,7 @@ using namespace std;
 #include <srs_app_config.hpp>
 #include <srs_app_srt_conn.hpp>
 #include <srs_app_statistic.hpp>
+#include <srs_app_threads.hpp>
 
 #ifdef SRS_SRT
 SrsSrtEventLoop* _srt_eventloop = NULL;
@@ -313,7 +317,7 @@ void SrsSrtServer::resample_kbps()
 
         // add delta of connection to server kbps.,
         // for next sample() of server kbps can get the stat.
-        SrsStatistic::instance()->kbps_add_delta(c->get_id().c_str(), conn->delta());
+        SrsStatistic::instance()->kbps_add_delta(conn->stat_handle(), c->get_id(), conn->delta());
     }
 }
 
@@ -377,12 +381,21 @@ SrsSrtEventLoop::SrsSrtEventLoop()
 {
     srt_poller_ = NULL;
     trd_ = NULL;
+
+    notify_fds_[0] = notify_fds_[1] = -1;
+    ack_fds_[0] = ack_fds_[1] = -1;
+    notify_ = NULL;
 }
 
 SrsSrtEventLoop::~SrsSrtEventLoop()
 {
     srs_freep(trd_);
-    srs_freep(srt_poller_);
+    srs_close_stfd(notify_);
+
+    // Note that the SRT thread never quit, so we never free the poller and pipes it uses.
+    if (notify_fds_[1] < 0) {
+        srs_freep(srt_poller_);
+    }
 }
 
 srs_error_t SrsSrtEventLoop::initialize()
@@ -402,6 +415,23 @@ srs_error_t SrsSrtEventLoop::start()
 {
     srs_error_t err = srs_success;
 
+    if (pipe(notify_fds_) < 0 || pipe(ack_fds_) < 0) {
+        return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "create pipe");
+    }
+
+    // The read end is used by coroutine, never block the ST thread.
+    if ((notify_ = srs_netfd_open(notify_fds_[0])) == NULL) {
+        return srs_error_new(ERROR_ST_OPEN_SOCKET, "open notify fd=%d", notify_fds_[0]);
+    }
+    // The write end of ack is used by coroutine, never block the ST thread.
+    if (fcntl(ack_fds_[1], F_SETFL, fcntl(ack_fds_[1], F_GETFL) | O_NONBLOCK) < 0) {
+        return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "nonblock ack fd=%d", ack_fds_[1]);
+    }
+
+    if ((err = _srs_thread_pool->execute("srt", SrsSrtEventLoop::start_poll, this)) != srs_success) {
+        return srs_error_wrap(err, "start srt thread");
+    }
+
     trd_ = new SrsSTCoroutine("srt_listener", this);
     if ((err = trd_->start()) != srs_success) {
         return srs_error_wrap(err, "start coroutine");
@@ -418,22 +448,70 @@ srs_error_t SrsSrtEventLoop::cycle()
         if ((err = trd_->pull()) != srs_success) {
             return srs_error_wrap(err, "srt listener");
         }
-       
+
+        // Wait for the SRT thread to notify that events are fired, the coroutine switches if no events.
+        char buf[64];
+        ssize_t nn = srs_read(notify_, buf, sizeof(buf), SRS_UTIME_NO_TIMEOUT);
+        if (nn <= 0) {
+            return srs_error_new(ERROR_SOCKET_READ, "read notify, nn=%d", (int)nn);
+        }
+
         // Check and notify fired SRT events by epoll.
         //
-        // Note that the SRT poller use a dedicated and isolated epoll, which is not the same as the one of SRS, in
-        // short, the wait won't switch to other coroutines when no fd is active, so we must use timeout(0) to make sure
-        // to return directly, then use srs_usleep to do the coroutine switch.
+        // Note that the SRT poller use a dedicated and isolated epoll, which is not the same as the one of SRS, so
+        // we use timeout(0) to make sure to return directly, because the events are already fired.
         int n_fds = 0;
         if ((err = srt_poller_->wait(0, &n_fds)) != srs_success) {
             srs_warn("srt poll wait failed, n_fds=%d, err=%s", n_fds, srs_error_desc(err).c_str());
             srs_error_reset(err);
         }
 
-        // We use sleep to switch to other coroutines, because the SRT poller is not possible to do this.
-        srs_usleep((n_fds ? 1 : 10) * SRS_UTIME_MILLISECONDS);
+        // Yield to run the woken coroutines, which read or write the sockets, then ack the SRT thread to poll again.
+        srs_usleep(0);
+        if (::write(ack_fds_[1], buf, nn) != nn) {
+            srs_warn("srt ack failed, nn=%d", (int)nn);
+        }
     }
     
     return err;
 }
 
+srs_error_t SrsSrtEventLoop::start_poll(void* arg)
+{
+    SrsSrtEventLoop* loop = (SrsSrtEventLoop*)arg;
+    return loop->poll_cycle();
+}
+
+srs_error_t SrsSrtEventLoop::poll_cycle()
+{
+    srs_error_t err = srs_success;
+
+    // Run in the SRT thread, which never quit.
+    while (true) {
+        // Block to wait for the SRT events, with a timeout to pick up the sockets added by coroutines.
+        int n_fds = 0;
+        if ((err = srt_poller_->poll(100, &n_fds)) != srs_success) {
+            srs_warn("srt poll failed, n_fds=%d, err=%s", n_fds, srs_error_desc(err).c_str());
+            srs_error_reset(err);
+            ::usleep(10 * 1000);
+            continue;
+        }
+
+        if (n_fds <= 0) {
+            continue;
+        }
+
+        // Notify the coroutine, and wait for the events to be dispatched, because the events are level-triggered
+        // and fired until the socket is read or written.
+        char c = 0;
+        if (::write(notify_fds_[1], &c, 1) != 1) {
+            return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "notify fd=%d", notify_fds_[1]);
+        }
+        if (::read(ack_fds_[0], &c, 1) != 1) {
+            return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "ack fd=%d", ack_fds_[0]);
+        }
+    }
+
+    return err;
+}
+
@@ -93,6 +93,8 @@ public:
 };
 
 // Start a coroutine to drive the SRT events with state-threads.
+// The SRT event loop, a dedicated SRT thread blocks to wait for the SRT events, and notify the coroutine by a pipe,
+// which is an ST fd, so the coroutine wakes up the SRT sockets immediately, without polling.
 class SrsSrtEventLoop : public ISrsCoroutineHandler
 {
 public:
@@ -106,9 +108,18 @@ public:
 // Interface ISrsCoroutineHandler.
 public:
     virtual srs_error_t cycle();
+private:
+    // The entry and cycle of SRT thread.
+    static srs_error_t start_poll(void* arg);
+    srs_error_t poll_cycle();
 private:
     ISrsSrtPoller* srt_poller_;
     SrsCoroutine* trd_;
+    // The pipe for SRT thread to notify the coroutine that events are fired.
+    int notify_fds_[2];
+    srs_netfd_t notify_;
+    // The pipe for coroutine to ack the SRT thread that events are dispatched.
+    int ack_fds_[2];
 };
 
 // SrsSrtEventLoop is global singleton instance.
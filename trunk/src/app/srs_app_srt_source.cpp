@@ -14,16 +14,21 @@ using namespace std;
 #include <srs_kernel_buffer.hpp>
 #include <srs_kernel_stream.hpp>
 #include <srs_core_autofree.hpp>
+#include <srs_kernel_codec.hpp>
 #include <srs_protocol_raw_avc.hpp>
+#include <srs_protocol_format.hpp>
 #include <srs_protocol_rtmp_stack.hpp>
 #include <srs_app_source.hpp>
 #include <srs_app_statistic.hpp>
 #include <srs_app_pithy_print.hpp>
+#include <srs_app_config.hpp>
 
 SrsSrtPacket::SrsSrtPacket()
 {
     shared_buffer_ = NULL;
     actual_buffer_size_ = 0;
+    timestamp_ = -1;
+    shared_count_ = 0;
 }
 
 SrsSrtPacket::~SrsSrtPacket()
@@ -45,8 +50,7 @@ char* SrsSrtPacket::wrap(int size)
     srs_freep(shared_buffer_);
     shared_buffer_ = new SrsSharedPtrMessage();
 
-    char* buf = new char[size];
-    shared_buffer_->wrap(buf, size);
+    shared_buffer_->wrap(size);
 
     return shared_buffer_->payload;
 }
@@ -78,6 +82,7 @@ SrsSrtPacket* SrsSrtPacket::copy()
 
     cp->shared_buffer_ = shared_buffer_? shared_buffer_->copy2() : NULL;
     cp->actual_buffer_size_ = actual_buffer_size_;
+    cp->timestamp_ = timestamp_;
 
     return cp;
 }
@@ -92,6 +97,82 @@ int SrsSrtPacket::size()
     return shared_buffer_->size; 
 }
 
+SrsSrtPacket* SrsSrtPacket::ref()
+{
+    shared_count_++;
+    return this;
+}
+
+int64_t SrsSrtPacket::timestamp()
+{
+    return timestamp_;
+}
+
+void SrsSrtPacket::set_timestamp(int64_t v)
+{
+    timestamp_ = v;
+}
+
+void srs_srt_packet_release(SrsSrtPacket* pkt)
+{
+    if (!pkt) {
+        return;
+    }
+
+    if (pkt->shared_count_ > 0) {
+        pkt->shared_count_--;
+        return;
+    }
+
+    srs_freep(pkt);
+}
+
+SrsSrtRing::SrsSrtRing(int capacity)
+{
+    capacity_ = srs_max(1, capacity);
+    packets_ = new SrsSrtPacket*[capacity_];
+    memset(packets_, 0, sizeof(SrsSrtPacket*) * capacity_);
+    head_ = 0;
+}
+
+SrsSrtRing::~SrsSrtRing()
+{
+    for (int i = 0; i < capacity_; i++) {
+        srs_srt_packet_release(packets_[i]);
+    }
+    srs_freepa(packets_);
+}
+
+void SrsSrtRing::push(SrsSrtPacket* pkt)
+{
+    SrsSrtPacket*& slot = packets_[head_ % capacity_];
+    srs_srt_packet_release(slot);
+
+    slot = pkt->ref();
+    head_++;
+}
+
+uint64_t SrsSrtRing::head()
+{
+    return head_;
+}
+
+uint64_t SrsSrtRing::tail()
+{
+    return head_ > (uint64_t)capacity_ ? head_ - capacity_ : 0;
+}
+
+SrsSrtPacket* SrsSrtRing::at(uint64_t seq)
+{
+    srs_assert(seq >= tail() && seq < head_);
+    return packets_[seq % capacity_];
+}
+
+int SrsSrtRing::capacity()
+{
+    return capacity_;
+}
+
 SrsSrtSourceManager::SrsSrtSourceManager()
 {
     lock = srs_mutex_new();
@@ -159,6 +240,7 @@ SrsSrtSourceManager* _srs_srt_sources = NULL;
 SrsSrtConsumer::SrsSrtConsumer(SrsSrtSource* s)
 {
     source = s;
+    cursor_ = s->ring_->head();
     should_update_source_id = false;
 
     mw_wait = srs_cond_new();
@@ -170,12 +252,6 @@ SrsSrtConsumer::~SrsSrtConsumer()
 {
     source->on_consumer_destroy(this);
 
-    vector<SrsSrtPacket*>::iterator it;
-    for (it = queue.begin(); it != queue.end(); ++it) {
-        SrsSrtPacket* pkt = *it;
-        srs_freep(pkt);
-    }
-
     srs_cond_destroy(mw_wait);
 }
 
@@ -184,21 +260,17 @@ void SrsSrtConsumer::update_source_id()
     should_update_source_id = true;
 }
 
-srs_error_t SrsSrtConsumer::enqueue(SrsSrtPacket* packet)
+void SrsSrtConsumer::on_packet()
 {
-    srs_error_t err = srs_success;
-
-    queue.push_back(packet);
-
-    if (mw_waiting) {
-        if ((int)queue.size() > mw_min_msgs) {
-            srs_cond_signal(mw_wait);
-            mw_waiting = false;
-            return err;
-        }
+    if (mw_waiting && available() > mw_min_msgs) {
+        srs_cond_signal(mw_wait);
+        mw_waiting = false;
     }
+}
 
-    return err;
+int SrsSrtConsumer::available()
+{
+    return (int)(source->ring_->head() - cursor_);
 }
 
 srs_error_t SrsSrtConsumer::dump_packet(SrsSrtPacket** ppkt)
@@ -210,10 +282,20 @@ srs_error_t SrsSrtConsumer::dump_packet(SrsSrtPacket** ppkt)
         should_update_source_id = false;
     }
 
-    // TODO: FIXME: Refine performance by ring buffer.
-    if (!queue.empty()) {
-        *ppkt = queue.front();
-        queue.erase(queue.begin());
+    // The packets we lag behind are overwritten in the ring.
+    SrsSrtRing* ring = source->ring_;
+    if (cursor_ < ring->tail()) {
+        uint64_t nn = ring->tail() - cursor_;
+        if (source->disconnect_slow_) {
+            return srs_error_new(ERROR_SRT_SLOW_READER, "lag %" PRId64 " packets, queue=%d", (int64_t)nn, ring->capacity());
+        }
+
+        srs_warn("SRT: Drop %" PRId64 " packets for slow reader, queue=%d", (int64_t)nn, ring->capacity());
+        cursor_ = ring->tail();
+    }
+
+    if (cursor_ < ring->head()) {
+        *ppkt = ring->at(cursor_++)->ref();
     }
 
     return err;
@@ -224,7 +306,7 @@ void SrsSrtConsumer::wait(int nb_msgs, srs_utime_t timeout)
     mw_min_msgs = nb_msgs;
 
     // when duration ok, signal to flush.
-    if ((int)queue.size() > mw_min_msgs) {
+    if (available() > mw_min_msgs) {
         return;
     }
 
@@ -655,11 +737,231 @@ srs_error_t SrsRtmpFromSrtBridge::on_aac_frame(SrsTsMessage* msg, uint32_t pts,
     return err;
 }
 
+SrsSrtFromRtmpBridge::SrsSrtFromRtmpBridge(SrsSrtSource* source)
+{
+    req_ = NULL;
+    source_ = source;
+
+    format_ = new SrsRtmpFormat();
+    tsmc_ = new SrsTsMessageCache();
+    context_ = new SrsTsContext();
+    // The audio codec follows the stream, see on_audio, and only AVC for video.
+    tscw_ = new SrsTsContextWriter(this, context_, SrsAudioCodecIdForbidden, SrsVideoCodecIdAVC);
+
+    nn_payload_ = 0;
+    last_video_dts_ = -1;
+    video_interval_ = 0;
+}
+
+SrsSrtFromRtmpBridge::~SrsSrtFromRtmpBridge()
+{
+    clear();
+
+    srs_freep(tscw_);
+    srs_freep(context_);
+    srs_freep(tsmc_);
+    srs_freep(format_);
+    srs_freep(req_);
+}
+
+srs_error_t SrsSrtFromRtmpBridge::initialize(SrsRequest* r)
+{
+    srs_error_t err = srs_success;
+
+    req_ = r->copy();
+
+    if ((err = format_->initialize()) != srs_success) {
+        return srs_error_wrap(err, "format initialize");
+    }
+
+    return err;
+}
+
+srs_error_t SrsSrtFromRtmpBridge::on_publish()
+{
+    srs_error_t err = srs_success;
+
+    // Reset the context, to write PAT/PMT for the new stream.
+    context_->reset();
+    last_video_dts_ = -1;
+    video_interval_ = 0;
+
+    if ((err = source_->on_publish()) != srs_success) {
+        return srs_error_wrap(err, "source publish");
+    }
+
+    return err;
+}
+
+void SrsSrtFromRtmpBridge::on_unpublish()
+{
+    clear();
+    source_->on_unpublish();
+}
+
+srs_error_t SrsSrtFromRtmpBridge::on_audio(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+
+    if ((err = format_->on_audio(msg)) != srs_success) {
+        return srs_error_wrap(err, "format consume audio");
+    }
+
+    // Ignore if no format->acodec, it means the codec is not parsed, or unknown codec.
+    // @issue https://github.com/ossrs/srs/issues/1506#issuecomment-562079474
+    if (!format_->acodec || !format_->audio) {
+        return err;
+    }
+
+    // TS only support audio codec AAC and MP3, ignore the AAC sequence header.
+    SrsAudioCodecId acodec = format_->acodec->id;
+    if (acodec != SrsAudioCodecIdAAC && acodec != SrsAudioCodecIdMP3) {
+        return err;
+    }
+    if (acodec == SrsAudioCodecIdAAC && format_->audio->aac_packet_type == SrsAudioAacFrameTraitSequenceHeader) {
+        return err;
+    }
+
+    if (tscw_->acodec() != acodec) {
+        tscw_->set_acodec(acodec);
+    }
+
+    if ((err = tsmc_->cache_audio(format_->audio, msg->timestamp * 90)) != srs_success) {
+        return srs_error_wrap(err, "cache audio");
+    }
+
+    err = tscw_->write_audio(tsmc_->audio);
+    srs_freep(tsmc_->audio);
+    if (err != srs_success) {
+        return srs_error_wrap(err, "write audio");
+    }
+
+    return flush_frame(msg->timestamp, 0);
+}
+
+srs_error_t SrsSrtFromRtmpBridge::on_video(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+
+    if ((err = format_->on_video(msg)) != srs_success) {
+        return srs_error_wrap(err, "format consume video");
+    }
+
+    // Ignore if no format->vcodec, it means the codec is not parsed, or unsupport/unknown codec
+    // such as H.263 codec
+    if (!format_->vcodec || !format_->video) {
+        return err;
+    }
+
+    // Ignore the info frame and sequence header, the SPS/PPS is in each IDR. Only AVC, because the TS muxer
+    // writes HEVC as a reserved stream.
+    SrsVideoFrame* video = format_->video;
+    if (format_->vcodec->id != SrsVideoCodecIdAVC || video->frame_type == SrsVideoAvcFrameTypeVideoInfoFrame) {
+        return err;
+    }
+    if (video->frame_type == SrsVideoAvcFrameTypeKeyFrame && video->avc_packet_type == SrsVideoAvcFrameTraitSequenceHeader) {
+        return err;
+    }
+
+    // Write PAT/PMT before each keyframe, so the player could start to decode from any IDR.
+    if (video->frame_type == SrsVideoAvcFrameTypeKeyFrame) {
+        context_->reset();
+    }
+
+    if ((err = tsmc_->cache_video(video, msg->timestamp * 90)) != srs_success) {
+        return srs_error_wrap(err, "cache video");
+    }
+
+    err = tscw_->write_video(tsmc_->video);
+    srs_freep(tsmc_->video);
+    if (err != srs_success) {
+        return srs_error_wrap(err, "write video");
+    }
+
+    // Spread the packets of frame in the interval of frames, to avoid burst for large IDR.
+    if (last_video_dts_ >= 0 && msg->timestamp > last_video_dts_) {
+        video_interval_ = srs_min(100, msg->timestamp - last_video_dts_);
+    }
+    last_video_dts_ = msg->timestamp;
+
+    return flush_frame(msg->timestamp, video_interval_);
+}
+
+srs_error_t SrsSrtFromRtmpBridge::write(void* buf, size_t size, ssize_t* nwrite)
+{
+    char* p = (char*)buf;
+    int left = (int)size;
+
+    while (left > 0) {
+        int nn = srs_min(left, SRS_SRT_MAX_PAYLOAD_SIZE - nn_payload_);
+        memcpy(payload_ + nn_payload_, p, nn);
+        nn_payload_ += nn;
+        p += nn;
+        left -= nn;
+
+        if (nn_payload_ == SRS_SRT_MAX_PAYLOAD_SIZE) {
+            SrsSrtPacket* pkt = new SrsSrtPacket();
+            pkt->wrap(payload_, nn_payload_);
+            packets_.push_back(pkt);
+            nn_payload_ = 0;
+        }
+    }
+
+    if (nwrite) {
+        *nwrite = size;
+    }
+
+    return srs_success;
+}
+
+srs_error_t SrsSrtFromRtmpBridge::flush_frame(int64_t dts, int64_t interval)
+{
+    srs_error_t err = srs_success;
+
+    // Each frame ends with a short packet, so the frame is delivered without waiting for the next one.
+    if (nn_payload_ > 0) {
+        SrsSrtPacket* pkt = new SrsSrtPacket();
+        pkt->wrap(payload_, nn_payload_);
+        packets_.push_back(pkt);
+        nn_payload_ = 0;
+    }
+
+    int nn = (int)packets_.size();
+    for (int i = 0; i < nn; i++) {
+        SrsSrtPacket* pkt = packets_.at(i);
+        pkt->set_timestamp(dts + interval * i / nn);
+
+        if ((err = source_->on_packet(pkt)) != srs_success) {
+            break;
+        }
+    }
+
+    clear();
+
+    if (err != srs_success) {
+        return srs_error_wrap(err, "srt packet");
+    }
+
+    return err;
+}
+
+void SrsSrtFromRtmpBridge::clear()
+{
+    for (int i = 0; i < (int)packets_.size(); i++) {
+        SrsSrtPacket* pkt = packets_.at(i);
+        srs_srt_packet_release(pkt);
+    }
+    packets_.clear();
+    nn_payload_ = 0;
+}
+
 SrsSrtSource::SrsSrtSource()
 {
     req = NULL;
     can_publish_ = true;
     bridge_ = NULL;
+    ring_ = new SrsSrtRing(4096);
+    disconnect_slow_ = false;
 }
 
 SrsSrtSource::~SrsSrtSource()
@@ -670,6 +972,7 @@ SrsSrtSource::~SrsSrtSource()
 
     srs_freep(bridge_);
     srs_freep(req);
+    srs_freep(ring_);
 }
 
 srs_error_t SrsSrtSource::initialize(SrsRequest* r)
@@ -678,6 +981,10 @@ srs_error_t SrsSrtSource::initialize(SrsRequest* r)
 
     req = r->copy();
 
+    srs_freep(ring_);
+    ring_ = new SrsSrtRing(_srs_config->get_srt_queue_size(req->vhost));
+    disconnect_slow_ = _srs_config->get_srt_slow_reader_disconnect(req->vhost);
+
 	return err;
 }
 
@@ -798,11 +1105,14 @@ srs_error_t SrsSrtSource::on_packet(SrsSrtPacket* packet)
 {
     srs_error_t err = srs_success;
 
+    // Share the packet with all consumers by the ring, without copy.
+    if (!consumers.empty()) {
+        ring_->push(packet);
+    }
+
     for (int i = 0; i < (int)consumers.size(); i++) {
         SrsSrtConsumer* consumer = consumers.at(i);
-        if ((err = consumer->enqueue(packet->copy())) != srs_success) {
-            return srs_error_wrap(err, "consume ts packet");
-        }
+        consumer->on_packet();
     }
 
     if (bridge_ && (err = bridge_->on_packet(packet)) != srs_success) {
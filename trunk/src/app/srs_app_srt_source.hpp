@@ -21,8 +21,13 @@ class SrsRequest;
 class SrsLiveSource;
 class SrsSrtSource;
 class SrsAlonePithyPrint;
+class SrsRtmpFormat;
 
-// The SRT packet with shared message.
+// The SRT payload size, which is 7 TS packets.
+#define SRS_SRT_MAX_PAYLOAD_SIZE (7 * SRS_TS_PACKET_SIZE)
+
+// The SRT packet with shared message. It's immutable after delivered to source, and shared by the queue of
+// source and all consumers by reference, see srs_srt_packet_release.
 class SrsSrtPacket
 {
 public:
@@ -36,13 +41,48 @@ public:
     char* wrap(SrsSharedPtrMessage* msg);
     // Copy the SRT packet.
     virtual SrsSrtPacket* copy();
+    // Get a reference of the SRT packet without copy, which should be released by srs_srt_packet_release.
+    SrsSrtPacket* ref();
 public:
     char* data();
     int size();
+    // The timestamp in ms to deliver the packet, -1 if unknown, for pacing.
+    int64_t timestamp();
+    void set_timestamp(int64_t v);
 private:
     SrsSharedPtrMessage* shared_buffer_;
     // The size of SRT packet or SRT payload.
     int actual_buffer_size_;
+    int64_t timestamp_;
+    // The number of references except the creator.
+    int shared_count_;
+    friend void srs_srt_packet_release(SrsSrtPacket* pkt);
+};
+
+// Release a reference of SRT packet, free it when there is no reference.
+extern void srs_srt_packet_release(SrsSrtPacket* pkt);
+
+// The queue of recent SRT packets of source, which is a ring referenced by all consumers without copy.
+class SrsSrtRing
+{
+private:
+    SrsSrtPacket** packets_;
+    int capacity_;
+    // The sequence of next packet to push, which increases monotonically.
+    uint64_t head_;
+public:
+    SrsSrtRing(int capacity);
+    virtual ~SrsSrtRing();
+public:
+    // Push a reference of packet to the ring, and release the oldest one if full.
+    void push(SrsSrtPacket* pkt);
+    // The sequence of next packet to push.
+    uint64_t head();
+    // The sequence of the oldest packet in ring.
+    uint64_t tail();
+    // Get the packet by sequence, which must be in [tail, head).
+    SrsSrtPacket* at(uint64_t seq);
+    int capacity();
 };
 
 class SrsSrtSourceManager
@@ -73,7 +113,8 @@ public:
     virtual ~SrsSrtConsumer();
 private:
     SrsSrtSource* source;
-    std::vector<SrsSrtPacket*> queue;
+    // The sequence of next packet to read from the ring of source.
+    uint64_t cursor_;
     // when source id changed, notice all consumers
     bool should_update_source_id;
     // The cond wait for mw.
@@ -83,9 +124,12 @@ private:
 public:
     // When source id changed, notice client to print.
     void update_source_id();
-    // Put SRT packet into queue.
-    srs_error_t enqueue(SrsSrtPacket* packet);
+    // Notify the consumer that there is a new packet in the ring of source.
+    void on_packet();
+    // The number of packets to consume in the ring of source.
+    int available();
     // For SRT, we only got one packet, because there is not many packets in queue.
+    // @remark The packet is a reference, user should release it by srs_srt_packet_release.
     virtual srs_error_t dump_packet(SrsSrtPacket** ppkt);
     // Wait for at-least some messages incoming in queue.
     virtual void wait(int nb_msgs, srs_utime_t timeout);
@@ -146,8 +190,49 @@ private:
     SrsAlonePithyPrint* pp_audio_duration_;
 };
 
+// Mux the RTMP stream to TS once for each stream, and deliver the TS packets to SRT source, shared by all consumers.
+class SrsSrtFromRtmpBridge : public ISrsLiveSourceBridge, public ISrsStreamWriter
+{
+private:
+    SrsRequest* req_;
+    SrsSrtSource* source_;
+private:
+    SrsRtmpFormat* format_;
+    SrsTsMessageCache* tsmc_;
+    SrsTsContext* context_;
+    SrsTsContextWriter* tscw_;
+private:
+    // The SRT payload to gather the TS packets.
+    char payload_[SRS_SRT_MAX_PAYLOAD_SIZE];
+    int nn_payload_;
+    // The SRT packets of current frame.
+    std::vector<SrsSrtPacket*> packets_;
+    // The interval of video frames, to spread the packets of a video frame.
+    int64_t last_video_dts_;
+    int64_t video_interval_;
+public:
+    SrsSrtFromRtmpBridge(SrsSrtSource* source);
+    virtual ~SrsSrtFromRtmpBridge();
+public:
+    virtual srs_error_t initialize(SrsRequest* r);
+// Interface ISrsLiveSourceBridge
+public:
+    virtual srs_error_t on_publish();
+    virtual srs_error_t on_audio(SrsSharedPtrMessage* audio);
+    virtual srs_error_t on_video(SrsSharedPtrMessage* video);
+    virtual void on_unpublish();
+// Interface ISrsStreamWriter
+public:
+    virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
+private:
+    // Deliver the packets of frame to source, with the timestamp for pacing.
+    srs_error_t flush_frame(int64_t dts, int64_t interval);
+    void clear();
+};
+
 class SrsSrtSource
 {
+    friend class SrsSrtConsumer;
 public:
     SrsSrtSource();
     virtual ~SrsSrtSource();
@@ -186,6 +271,10 @@ private:
     SrsRequest* req;
     // To delivery packets to clients.
     std::vector<SrsSrtConsumer*> consumers;
+    // The recent packets, shared by all consumers.
+    SrsSrtRing* ring_;
+    // Whether disconnect the consumer which lags behind the ring, or drop the packets.
+    bool disconnect_slow_;
     bool can_publish_;
     ISrsSrtSourceBridge* bridge_;
 };
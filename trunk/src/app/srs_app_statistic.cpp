@@ -6,8 +6,11 @@
 
 #include <srs_app_statistic.hpp>
 
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sstream>
+#include <algorithm>
 using namespace std;
 
 #include <srs_protocol_rtmp_stack.hpp>
@@ -91,6 +94,9 @@ SrsStatisticStream::SrsStatisticStream()
     asample_rate = SrsAudioSampleRateReserved;
     asound_type = SrsAudioChannelsReserved;
     aac_object = SrsAacObjectTypeReserved;
+    has_audio_transcode = false;
+    nn_audio_transcoded = nn_audio_dropped = 0;
+    audio_transcode_avg = audio_transcode_max = 0;
     width = 0;
     height = 0;
     
@@ -98,72 +104,129 @@ SrsStatisticStream::SrsStatisticStream()
 
     nb_clients = 0;
     frames = new SrsPps();
+
+    rtmp_residence = new SrsHistogram();
+    rtc_residence = new SrsHistogram();
+    rtmp_residence_last = new SrsHistogram();
+    rtc_residence_last = new SrsHistogram();
+    residence_window_start = 0;
 }
 
 SrsStatisticStream::~SrsStatisticStream()
 {
     srs_freep(kbps);
     srs_freep(frames);
+    srs_freep(rtmp_residence);
+    srs_freep(rtc_residence);
+    srs_freep(rtmp_residence_last);
+    srs_freep(rtc_residence_last);
 }
 
-srs_error_t SrsStatisticStream::dumps(SrsJsonObject* obj)
+// Dumps the percentiles of residence time in us, ignore if empty.
+void srs_stat_dumps_residence(SrsJsonWriter* w, const char* name, SrsHistogram* h)
+{
+    if (!h->count()) {
+        return;
+    }
+
+    w->key(name)->object_start();
+    w->key("count")->integer(h->count());
+    w->key("p50_us")->integer(h->percentile(50));
+    w->key("p99_us")->integer(h->percentile(99));
+    w->key("p999_us")->integer(h->percentile(99.9));
+    w->key("max_us")->integer(h->max());
+    w->object_end();
+}
+
+srs_error_t SrsStatisticStream::dumps(SrsJsonWriter* w)
 {
     srs_error_t err = srs_success;
     
-    obj->set("id", SrsJsonAny::str(id.c_str()));
-    obj->set("name", SrsJsonAny::str(stream.c_str()));
-    obj->set("vhost", SrsJsonAny::str(vhost->id.c_str()));
-    obj->set("app", SrsJsonAny::str(app.c_str()));
-    obj->set("tcUrl", SrsJsonAny::str(tcUrl.c_str()));
-    obj->set("url", SrsJsonAny::str(url.c_str()));
-    obj->set("live_ms", SrsJsonAny::integer(srsu2ms(srs_get_system_time())));
-    obj->set("clients", SrsJsonAny::integer(nb_clients));
-    obj->set("frames", SrsJsonAny::integer(frames->sugar));
-    obj->set("send_bytes", SrsJsonAny::integer(kbps->get_send_bytes()));
-    obj->set("recv_bytes", SrsJsonAny::integer(kbps->get_recv_bytes()));
-    
-    SrsJsonObject* okbps = SrsJsonAny::object();
-    obj->set("kbps", okbps);
-    
-    okbps->set("recv_30s", SrsJsonAny::integer(kbps->get_recv_kbps_30s()));
-    okbps->set("send_30s", SrsJsonAny::integer(kbps->get_send_kbps_30s()));
+    w->object_start();
+    w->key("id")->str(id);
+    w->key("name")->str(stream);
+    w->key("vhost")->str(vhost->id);
+    w->key("app")->str(app);
+    w->key("tcUrl")->str(tcUrl);
+    w->key("url")->str(url);
+    w->key("live_ms")->integer(srsu2ms(srs_get_system_time()));
+    w->key("clients")->integer(nb_clients);
+    w->key("frames")->integer(frames->sugar);
+    w->key("send_bytes")->integer(kbps->get_send_bytes());
+    w->key("recv_bytes")->integer(kbps->get_recv_bytes());
     
-    SrsJsonObject* publish = SrsJsonAny::object();
-    obj->set("publish", publish);
+    w->key("kbps")->object_start();
+    w->key("recv_30s")->integer(kbps->get_recv_kbps_30s());
+    w->key("send_30s")->integer(kbps->get_send_kbps_30s());
+    w->object_end();
     
-    publish->set("active", SrsJsonAny::boolean(active));
+    w->key("publish")->object_start();
+    w->key("active")->boolean(active);
     if (!publisher_id.empty()) {
-        publish->set("cid", SrsJsonAny::str(publisher_id.c_str()));
+        w->key("cid")->str(publisher_id);
     }
+    w->object_end();
     
     if (!has_video) {
-        obj->set("video", SrsJsonAny::null());
+        w->key("video")->null();
     } else {
-        SrsJsonObject* video = SrsJsonAny::object();
-        obj->set("video", video);
-        
-        video->set("codec", SrsJsonAny::str(srs_video_codec_id2str(vcodec).c_str()));
-        video->set("profile", SrsJsonAny::str(srs_avc_profile2str(avc_profile).c_str()));
-        video->set("level", SrsJsonAny::str(srs_avc_level2str(avc_level).c_str()));
-        video->set("width", SrsJsonAny::integer(width));
-        video->set("height", SrsJsonAny::integer(height));
+        w->key("video")->object_start();
+        w->key("codec")->str(srs_video_codec_id2str(vcodec));
+        w->key("profile")->str(srs_avc_profile2str(avc_profile));
+        w->key("level")->str(srs_avc_level2str(avc_level));
+        w->key("width")->integer(width);
+        w->key("height")->integer(height);
+        w->object_end();
     }
     
     if (!has_audio) {
-        obj->set("audio", SrsJsonAny::null());
+        w->key("audio")->null();
     } else {
-        SrsJsonObject* audio = SrsJsonAny::object();
-        obj->set("audio", audio);
-        
-        audio->set("codec", SrsJsonAny::str(srs_audio_codec_id2str(acodec).c_str()));
-        audio->set("sample_rate", SrsJsonAny::integer(srs_flv_srates[asample_rate]));
-        audio->set("channel", SrsJsonAny::integer(asound_type + 1));
-        audio->set("profile", SrsJsonAny::str(srs_aac_object2str(aac_object).c_str()));
+        w->key("audio")->object_start();
+        w->key("codec")->str(srs_audio_codec_id2str(acodec));
+        w->key("sample_rate")->integer(srs_flv_srates[asample_rate]);
+        w->key("channel")->integer(asound_type + 1);
+        w->key("profile")->str(srs_aac_object2str(aac_object));
+        w->object_end();
+    }
+
+    if (has_audio_transcode) {
+        w->key("audio_transcode")->object_start();
+        w->key("frames")->integer(nn_audio_transcoded);
+        w->key("dropped")->integer(nn_audio_dropped);
+        w->key("avg_us")->integer(audio_transcode_avg);
+        w->key("max_us")->integer(audio_transcode_max);
+        w->object_end();
+    }
+
+    if (rtmp_residence_last->count() || rtc_residence_last->count()) {
+        w->key("residence")->object_start();
+        srs_stat_dumps_residence(w, "rtmp", rtmp_residence_last);
+        srs_stat_dumps_residence(w, "rtc", rtc_residence_last);
+        w->object_end();
     }
+    w->object_end();
     
     return err;
 }
 
+void SrsStatisticStream::rotate_residence(srs_utime_t now)
+{
+    if (!residence_window_start) {
+        residence_window_start = now;
+    }
+    if (now - residence_window_start < SRS_STAT_RESIDENCE_WINDOW) {
+        return;
+    }
+    residence_window_start = now;
+
+    // The current window becomes the last one to export, and reuse the histograms of last window.
+    std::swap(rtmp_residence, rtmp_residence_last);
+    std::swap(rtc_residence, rtc_residence_last);
+    rtmp_residence->clear();
+    rtc_residence->clear();
+}
+
 void SrsStatisticStream::publish(std::string id)
 {
     // To prevent duplicated publish event by bridger.
@@ -186,13 +249,82 @@ void SrsStatisticStream::close()
 
     has_video = false;
     has_audio = false;
+    has_audio_transcode = false;
     active = false;
     
     vhost->nb_streams--;
 }
 
+SrsStatisticHandle::SrsStatisticHandle()
+{
+    slot = 0;
+    generation = 0;
+    version = 0;
+}
+
+SrsStatisticShard::SrsStatisticShard()
+{
+    memset(pages_, 0, sizeof(pages_));
+}
+
+SrsStatisticShard::~SrsStatisticShard()
+{
+    for (int i = 0; i < SRS_STAT_MAX_PAGES; i++) {
+        free(pages_[i]);
+    }
+}
+
+SrsStatisticPage* SrsStatisticShard::ensure(uint32_t slot)
+{
+    uint32_t index = slot / SRS_STAT_PAGE_SLOTS;
+    srs_assert(index < SRS_STAT_MAX_PAGES);
+
+    SrsStatisticPage* page = __atomic_load_n(&pages_[index], __ATOMIC_ACQUIRE);
+    if (page) {
+        return page;
+    }
+
+    // Allocate the page aligned to cache line, and publish it to other threads.
+    void* p = NULL;
+    if (posix_memalign(&p, 64, sizeof(SrsStatisticPage)) != 0) {
+        srs_assert(false);
+    }
+    memset(p, 0, sizeof(SrsStatisticPage));
+
+    SrsStatisticPage* expected = NULL;
+    if (!__atomic_compare_exchange_n(&pages_[index], &expected, (SrsStatisticPage*)p, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+        free(p);
+        return expected;
+    }
+    return (SrsStatisticPage*)p;
+}
+
+void SrsStatisticShard::add(uint32_t slot, int64_t in, int64_t out)
+{
+    SrsStatisticPage* page = ensure(slot);
+    uint32_t offset = slot % SRS_STAT_PAGE_SLOTS;
+
+    __atomic_fetch_add(&page->in[offset], in, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&page->out[offset], out, __ATOMIC_RELAXED);
+}
+
+void SrsStatisticShard::fetch(uint32_t slot, int64_t& in, int64_t& out)
+{
+    in = out = 0;
+
+    SrsStatisticPage* page = __atomic_load_n(&pages_[slot / SRS_STAT_PAGE_SLOTS], __ATOMIC_ACQUIRE);
+    if (!page) {
+        return;
+    }
+
+    uint32_t offset = slot % SRS_STAT_PAGE_SLOTS;
+    in = __atomic_exchange_n(&page->in[offset], 0, __ATOMIC_RELAXED);
+    out = __atomic_exchange_n(&page->out[offset], 0, __ATOMIC_RELAXED);
+}
+
 SrsStatisticClient::SrsStatisticClient()
 {
+    slot = 0;
     stream = NULL;
     conn = NULL;
     req = NULL;
@@ -208,30 +340,31 @@ SrsStatisticClient::~SrsStatisticClient()
 	srs_freep(req);
 }
 
-srs_error_t SrsStatisticClient::dumps(SrsJsonObject* obj)
+srs_error_t SrsStatisticClient::dumps(SrsJsonWriter* w)
 {
     srs_error_t err = srs_success;
     
-    obj->set("id", SrsJsonAny::str(id.c_str()));
-    obj->set("vhost", SrsJsonAny::str(stream->vhost->id.c_str()));
-    obj->set("stream", SrsJsonAny::str(stream->id.c_str()));
-    obj->set("ip", SrsJsonAny::str(req->ip.c_str()));
-    obj->set("pageUrl", SrsJsonAny::str(req->pageUrl.c_str()));
-    obj->set("swfUrl", SrsJsonAny::str(req->swfUrl.c_str()));
-    obj->set("tcUrl", SrsJsonAny::str(req->tcUrl.c_str()));
-    obj->set("url", SrsJsonAny::str(req->get_stream_url().c_str()));
-    obj->set("name", SrsJsonAny::str(req->stream.c_str()));
-    obj->set("type", SrsJsonAny::str(srs_client_type_string(type).c_str()));
-    obj->set("publish", SrsJsonAny::boolean(srs_client_type_is_publish(type)));
-    obj->set("alive", SrsJsonAny::number(srsu2ms(srs_get_system_time() - create) / 1000.0));
-    obj->set("send_bytes", SrsJsonAny::integer(kbps->get_send_bytes()));
-    obj->set("recv_bytes", SrsJsonAny::integer(kbps->get_recv_bytes()));
-
-    SrsJsonObject* okbps = SrsJsonAny::object();
-    obj->set("kbps", okbps);
-
-    okbps->set("recv_30s", SrsJsonAny::integer(kbps->get_recv_kbps_30s()));
-    okbps->set("send_30s", SrsJsonAny::integer(kbps->get_send_kbps_30s()));
+    w->object_start();
+    w->key("id")->str(id);
+    w->key("vhost")->str(stream->vhost->id);
+    w->key("stream")->str(stream->id);
+    w->key("ip")->str(req->ip);
+    w->key("pageUrl")->str(req->pageUrl);
+    w->key("swfUrl")->str(req->swfUrl);
+    w->key("tcUrl")->str(req->tcUrl);
+    w->key("url")->str(req->get_stream_url());
+    w->key("name")->str(req->stream);
+    w->key("type")->str(srs_client_type_string(type));
+    w->key("publish")->boolean(srs_client_type_is_publish(type));
+    w->key("alive")->number(srsu2ms(srs_get_system_time() - create) / 1000.0);
+    w->key("send_bytes")->integer(kbps->get_send_bytes());
+    w->key("recv_bytes")->integer(kbps->get_recv_bytes());
+
+    w->key("kbps")->object_start();
+    w->key("recv_30s")->integer(kbps->get_recv_kbps_30s());
+    w->key("send_30s")->integer(kbps->get_send_kbps_30s());
+    w->object_end();
+    w->object_end();
     
     return err;
 }
@@ -244,6 +377,12 @@ SrsStatistic::SrsStatistic()
 
     nb_clients_ = 0;
     nb_errs_ = 0;
+
+    version_ = 0;
+
+    memset(shards_, 0, sizeof(shards_));
+    nn_shards_ = 1;
+    shards_[0] = new SrsStatisticShard();
 }
 
 SrsStatistic::~SrsStatistic()
@@ -276,6 +415,10 @@ SrsStatistic::~SrsStatistic()
     rvhosts.clear();
     streams.clear();
     rstreams.clear();
+
+    for (int i = 0; i < SRS_STAT_MAX_SHARDS; i++) {
+        srs_freep(shards_[i]);
+    }
 }
 
 SrsStatistic* SrsStatistic::instance()
@@ -369,6 +512,34 @@ srs_error_t SrsStatistic::on_audio_info(SrsRequest* req, SrsAudioCodecId acodec,
     return err;
 }
 
+void SrsStatistic::on_audio_transcode(SrsRequest* req, int64_t nn_frames, int64_t nn_dropped, srs_utime_t avg, srs_utime_t max)
+{
+    SrsStatisticVhost* vhost = create_vhost(req);
+    SrsStatisticStream* stream = create_stream(vhost, req);
+
+    stream->has_audio_transcode = true;
+    stream->nn_audio_transcoded = nn_frames;
+    stream->nn_audio_dropped = nn_dropped;
+    stream->audio_transcode_avg = avg;
+    stream->audio_transcode_max = max;
+}
+
+void SrsStatistic::on_rtmp_residence(SrsRequest* req, SrsHistogram* h)
+{
+    SrsStatisticVhost* vhost = create_vhost(req);
+    SrsStatisticStream* stream = create_stream(vhost, req);
+
+    stream->rtmp_residence->merge(h);
+}
+
+void SrsStatistic::on_rtc_residence(SrsRequest* req, SrsHistogram* h)
+{
+    SrsStatisticVhost* vhost = create_vhost(req);
+    SrsStatisticStream* stream = create_stream(vhost, req);
+
+    stream->rtc_residence->merge(h);
+}
+
 srs_error_t SrsStatistic::on_video_frames(SrsRequest* req, int nb_frames)
 {
     srs_error_t err = srs_success;
@@ -410,6 +581,7 @@ srs_error_t SrsStatistic::on_client(std::string id, SrsRequest* req, ISrsExpire*
         client->id = id;
         client->stream = stream;
         clients[id] = client;
+        alloc_slot(client);
     } else {
         client = clients[id];
     }
@@ -438,6 +610,10 @@ void SrsStatistic::on_disconnect(std::string id, srs_error_t err)
     SrsStatisticClient* client = it->second;
     SrsStatisticStream* stream = client->stream;
     SrsStatisticVhost* vhost = stream->vhost;
+
+    // Collect the bytes not sampled yet, before the slot is reused.
+    aggregate(client);
+    free_slot(client);
     
     srs_freep(client);
     clients.erase(it);
@@ -484,29 +660,122 @@ void SrsStatistic::cleanup_stream(SrsStatisticStream* stream)
     srs_freep(stream);
 }
 
-void SrsStatistic::kbps_add_delta(std::string id, ISrsKbpsDelta* delta)
+void SrsStatistic::kbps_add_delta(SrsStatisticHandle& handle, const SrsContextId& cid, ISrsKbpsDelta* delta)
 {
     if (!delta) return;
 
-    map<string, SrsStatisticClient*>::iterator it = clients.find(id);
-    if (it == clients.end()) return;
+    // Never lookup the client by id, unless the handle is stale.
+    if (!resolve(handle, cid)) return;
 
-    SrsStatisticClient* client = it->second;
-    
     // resample the kbps to collect the delta.
     int64_t in, out;
     delta->remark(&in, &out);
-    
-    // add delta of connection to kbps.
-    // for next sample() of server kbps can get the stat.
+
+    // add delta of connection to the slot, for next sample() to collect it.
+    shards_[0]->add(handle.slot, in, out);
+}
+
+bool SrsStatistic::resolve(SrsStatisticHandle& handle, const SrsContextId& cid)
+{
+    // The handle is valid, if the generation of slot not changed.
+    if (handle.generation && handle.slot < generations_.size() && generations_.at(handle.slot) == handle.generation) {
+        return true;
+    }
+
+    // Failed to resolve, and there is no new client.
+    if (!handle.generation && handle.version == version_ && version_) {
+        return false;
+    }
+
+    handle.generation = 0;
+    handle.version = version_;
+
+    map<string, SrsStatisticClient*>::iterator it = clients.find(cid.c_str());
+    if (it == clients.end()) return false;
+
+    SrsStatisticClient* client = it->second;
+    handle.slot = client->slot;
+    handle.generation = generations_.at(client->slot);
+    return true;
+}
+
+void SrsStatistic::alloc_slot(SrsStatisticClient* client)
+{
+    if (free_slots_.empty()) {
+        client->slot = (uint32_t)slots_.size();
+        slots_.push_back(client);
+        generations_.push_back(1);
+    } else {
+        client->slot = free_slots_.back();
+        free_slots_.pop_back();
+        slots_[client->slot] = client;
+    }
+
+    version_++;
+}
+
+void SrsStatistic::free_slot(SrsStatisticClient* client)
+{
+    uint32_t slot = client->slot;
+    slots_[slot] = NULL;
+    free_slots_.push_back(slot);
+
+    // Make the handles of slot stale, never be zero which means unresolved.
+    if (++generations_[slot] == 0) {
+        generations_[slot] = 1;
+    }
+}
+
+void SrsStatistic::aggregate(SrsStatisticClient* client)
+{
+    int64_t in = 0, out = 0;
+
+    int nn_shards = srs_min(__atomic_load_n(&nn_shards_, __ATOMIC_ACQUIRE), SRS_STAT_MAX_SHARDS);
+    for (int i = 0; i < nn_shards; i++) {
+        // The shard is reserved but not ready, ignore it.
+        SrsStatisticShard* shard = __atomic_load_n(&shards_[i], __ATOMIC_ACQUIRE);
+        if (!shard) {
+            continue;
+        }
+
+        int64_t v0 = 0, v1 = 0;
+        shard->fetch(client->slot, v0, v1);
+        in += v0;
+        out += v1;
+    }
+
+    if (!in && !out) {
+        return;
+    }
+
     kbps->add_delta(in, out);
     client->kbps->add_delta(in, out);
     client->stream->kbps->add_delta(in, out);
     client->stream->vhost->kbps->add_delta(in, out);
 }
 
+SrsStatisticShard* SrsStatistic::create_shard()
+{
+    int index = __atomic_fetch_add(&nn_shards_, 1, __ATOMIC_ACQ_REL);
+    if (index >= SRS_STAT_MAX_SHARDS) {
+        return NULL;
+    }
+
+    SrsStatisticShard* shard = new SrsStatisticShard();
+    __atomic_store_n(&shards_[index], shard, __ATOMIC_RELEASE);
+    return shard;
+}
+
 void SrsStatistic::kbps_sample()
 {
+    // Collect the counters of all clients, without lookup by id.
+    for (int i = 0; i < (int)slots_.size(); i++) {
+        SrsStatisticClient* client = slots_.at(i);
+        if (client) {
+            aggregate(client);
+        }
+    }
+
     kbps->sample();
     if (true) {
         std::map<std::string, SrsStatisticVhost*>::iterator it;
@@ -521,13 +790,15 @@ void SrsStatistic::kbps_sample()
             SrsStatisticStream* stream = it->second;
             stream->kbps->sample();
             stream->frames->update();
+            stream->rotate_residence(srs_get_system_time());
         }
     }
     if (true) {
-        std::map<std::string, SrsStatisticClient*>::iterator it;
-        for (it = clients.begin(); it != clients.end(); it++) {
-            SrsStatisticClient* client = it->second;
-            client->kbps->sample();
+        for (int i = 0; i < (int)slots_.size(); i++) {
+            SrsStatisticClient* client = slots_.at(i);
+            if (client) {
+                client->kbps->sample();
+            }
         }
     }
 
@@ -580,48 +851,66 @@ srs_error_t SrsStatistic::dumps_vhosts(SrsJsonArray* arr)
     return err;
 }
 
-srs_error_t SrsStatistic::dumps_streams(SrsJsonArray* arr, int start, int count)
+srs_error_t SrsStatistic::dumps_streams(SrsJsonWriter* w, std::string cursor, int start, int count, std::string& next)
 {
     srs_error_t err = srs_success;
 
+    // Seek to the stream after cursor in O(log n), or skip the start streams.
     std::map<std::string, SrsStatisticStream*>::iterator it = streams.begin();
-    for (int i = 0; i < start + count && it != streams.end(); it++, i++) {
-        if (i < start) {
-            continue;
+    if (!cursor.empty()) {
+        it = streams.upper_bound(cursor);
+    } else {
+        for (int i = 0; i < start && it != streams.end(); i++) {
+            it++;
         }
+    }
 
+    next = "";
+    for (int i = 0; i < count && it != streams.end(); it++, i++) {
         SrsStatisticStream* stream = it->second;
+        next = it->first;
         
-        SrsJsonObject* obj = SrsJsonAny::object();
-        arr->append(obj);
-        
-        if ((err = stream->dumps(obj)) != srs_success) {
+        if ((err = stream->dumps(w)) != srs_success) {
             return srs_error_wrap(err, "dump stream");
         }
     }
+
+    // No more streams.
+    if (it == streams.end()) {
+        next = "";
+    }
     
     return err;
 }
 
-srs_error_t SrsStatistic::dumps_clients(SrsJsonArray* arr, int start, int count)
+srs_error_t SrsStatistic::dumps_clients(SrsJsonWriter* w, std::string cursor, int start, int count, std::string& next)
 {
     srs_error_t err = srs_success;
     
+    // Seek to the client after cursor in O(log n), or skip the start clients.
     std::map<std::string, SrsStatisticClient*>::iterator it = clients.begin();
-    for (int i = 0; i < start + count && it != clients.end(); it++, i++) {
-        if (i < start) {
-            continue;
+    if (!cursor.empty()) {
+        it = clients.upper_bound(cursor);
+    } else {
+        for (int i = 0; i < start && it != clients.end(); i++) {
+            it++;
         }
-        
+    }
+
+    next = "";
+    for (int i = 0; i < count && it != clients.end(); it++, i++) {
         SrsStatisticClient* client = it->second;
+        next = it->first;
         
-        SrsJsonObject* obj = SrsJsonAny::object();
-        arr->append(obj);
-        
-        if ((err = client->dumps(obj)) != srs_success) {
+        if ((err = client->dumps(w)) != srs_success) {
             return srs_error_wrap(err, "dump client");
         }
     }
+
+    // No more clients.
+    if (it == clients.end()) {
+        next = "";
+    }
     
     return err;
 }
@@ -766,3 +1055,34 @@ srs_error_t SrsStatistic::dumps_metrics(int64_t& send_bytes, int64_t& recv_bytes
     return err;
 }
 
+// Dumps the residence time of stream as summary, with quantiles in us.
+void srs_stat_dumps_residence_metrics(std::stringstream& ss, SrsStatisticStream* stream, const char* proto, SrsHistogram* h)
+{
+    if (!h->count()) {
+        return;
+    }
+
+    std::stringstream labels;
+    labels << "vhost=\"" << stream->vhost->vhost << "\",app=\"" << stream->app << "\",stream=\"" << stream->stream
+        << "\",proto=\"" << proto << "\"";
+
+    ss << "srs_stream_residence_us{" << labels.str() << ",quantile=\"0.5\"} " << h->percentile(50) << "\n"
+       << "srs_stream_residence_us{" << labels.str() << ",quantile=\"0.99\"} " << h->percentile(99) << "\n"
+       << "srs_stream_residence_us{" << labels.str() << ",quantile=\"0.999\"} " << h->percentile(99.9) << "\n"
+       << "srs_stream_residence_us_sum{" << labels.str() << "} " << h->sum() << "\n"
+       << "srs_stream_residence_us_count{" << labels.str() << "} " << h->count() << "\n";
+}
+
+void SrsStatistic::dumps_residence_metrics(std::stringstream& ss)
+{
+    ss << "# HELP srs_stream_residence_us The residence time of messages in SRS, from received to sent.\n"
+       << "# TYPE srs_stream_residence_us summary\n";
+
+    std::map<std::string, SrsStatisticStream*>::iterator it;
+    for (it = streams.begin(); it != streams.end(); it++) {
+        SrsStatisticStream* stream = it->second;
+        srs_stat_dumps_residence_metrics(ss, stream, "rtmp", stream->rtmp_residence_last);
+        srs_stat_dumps_residence_metrics(ss, stream, "rtc", stream->rtc_residence_last);
+    }
+}
+
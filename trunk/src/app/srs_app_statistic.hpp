@@ -23,10 +23,12 @@ class SrsRequest;
 class ISrsExpire;
 class SrsJsonObject;
 class SrsJsonArray;
+class SrsJsonWriter;
 class ISrsKbpsDelta;
 class SrsClsSugar;
 class SrsClsSugars;
 class SrsPps;
+class SrsHistogram;
 
 struct SrsStatisticVhost
 {
@@ -83,11 +85,29 @@ public:
     // 1.5.1.1 Audio object type definition, page 23,
     //           in ISO_IEC_14496-3-AAC-2001.pdf.
     SrsAacObjectType aac_object;
+public:
+    // The audio transcoding for RTMP to/from WebRTC bridge.
+    bool has_audio_transcode;
+    int64_t nn_audio_transcoded;
+    int64_t nn_audio_dropped;
+    // The average and max latency of audio transcoding, in last interval.
+    srs_utime_t audio_transcode_avg;
+    srs_utime_t audio_transcode_max;
+public:
+    // The residence time of messages in server, from received from publisher to sent to players. The players
+    // merge to the current window, while the last window is exported, see SRS_STAT_RESIDENCE_WINDOW.
+    SrsHistogram* rtmp_residence;
+    SrsHistogram* rtc_residence;
+    SrsHistogram* rtmp_residence_last;
+    SrsHistogram* rtc_residence_last;
+    srs_utime_t residence_window_start;
 public:
     SrsStatisticStream();
     virtual ~SrsStatisticStream();
 public:
-    virtual srs_error_t dumps(SrsJsonObject* obj);
+    virtual srs_error_t dumps(SrsJsonWriter* w);
+    // Switch to the next window of residence time, when the current window is elapsed.
+    virtual void rotate_residence(srs_utime_t now);
 public:
     // Publish the stream, id is the publisher.
     virtual void publish(std::string id);
@@ -95,6 +115,54 @@ public:
     virtual void close();
 };
 
+// The handle of client in statistic, held by connection to update the kbps without lookup the client by id.
+struct SrsStatisticHandle
+{
+    // The slot and generation of client, generation 0 means not resolved.
+    uint32_t slot;
+    uint32_t generation;
+    // The version of clients when failed to resolve, to never lookup again until new client.
+    uint64_t version;
+    SrsStatisticHandle();
+};
+
+// The window to stat the residence time of messages, the percentiles are of the last window.
+#define SRS_STAT_RESIDENCE_WINDOW (30 * SRS_UTIME_SECONDS)
+
+// The number of slots in a page, and the max pages, so the max clients is about 1M.
+#define SRS_STAT_PAGE_SLOTS 1024
+#define SRS_STAT_MAX_PAGES 1024
+
+// A page of counters of clients in struct-of-arrays, aligned to cache line.
+struct SrsStatisticPage
+{
+    int64_t in[SRS_STAT_PAGE_SLOTS];
+    int64_t out[SRS_STAT_PAGE_SLOTS];
+};
+
+// The max number of shards, that is, the threads to add delta bytes, including the hybrid thread.
+#define SRS_STAT_MAX_SHARDS 64
+
+// The counters of clients for a thread, indexed by the slot of client handle. Each thread should
+// use its own shard, and the hybrid thread aggregates all shards when sample the kbps.
+class SrsStatisticShard
+{
+private:
+    // The pages never move once allocated, so it's safe to access by other threads.
+    SrsStatisticPage* pages_[SRS_STAT_MAX_PAGES];
+public:
+    SrsStatisticShard();
+    virtual ~SrsStatisticShard();
+private:
+    // Get the page of slot, allocate it if not exists.
+    SrsStatisticPage* ensure(uint32_t slot);
+public:
+    // Add the delta bytes of slot. Only for the thread which owns the shard.
+    void add(uint32_t slot, int64_t in, int64_t out);
+    // Fetch and reset the delta bytes of slot. Only for hybrid thread.
+    void fetch(uint32_t slot, int64_t& in, int64_t& out);
+};
+
 struct SrsStatisticClient
 {
 public:
@@ -106,6 +174,8 @@ public:
     SrsRtmpConnType type;
     std::string id;
     srs_utime_t create;
+    // The slot of counters, see SrsStatisticHandle.
+    uint32_t slot;
 public:
     // The stream total kbps.
     SrsKbps* kbps;
@@ -113,7 +183,7 @@ public:
     SrsStatisticClient();
     virtual ~SrsStatisticClient();
 public:
-    virtual srs_error_t dumps(SrsJsonObject* obj);
+    virtual srs_error_t dumps(SrsJsonWriter* w);
 };
 
 class SrsStatistic
@@ -143,6 +213,18 @@ private:
     std::map<std::string, SrsStatisticClient*> clients;
     // The server total kbps.
     SrsKbps* kbps;
+private:
+    // The clients indexed by slot, NULL if free.
+    std::vector<SrsStatisticClient*> slots_;
+    // The generation of slots, increased when slot is freed, to detect stale handle.
+    std::vector<uint32_t> generations_;
+    std::vector<uint32_t> free_slots_;
+    // The version of clients, increased when client is created, to resolve handles again.
+    uint64_t version_;
+    // The counters of clients by threads, the first one is for hybrid thread. The shards never move once
+    // created, so a thread adds to its own shard without locking.
+    SrsStatisticShard* shards_[SRS_STAT_MAX_SHARDS];
+    int nn_shards_;
 private:
     // The total of clients connections.
     int64_t nb_clients_;
@@ -166,6 +248,12 @@ public:
     // When got audio info for stream.
     virtual srs_error_t on_audio_info(SrsRequest* req, SrsAudioCodecId acodec, SrsAudioSampleRate asample_rate,
         SrsAudioChannels asound_type, SrsAacObjectType aac_object);
+    // When audio transcoded by bridge, update the number of frames and latency.
+    virtual void on_audio_transcode(SrsRequest* req, int64_t nn_frames, int64_t nn_dropped, srs_utime_t avg,
+        srs_utime_t max);
+    // When players sent messages, merge the residence time of messages to stream.
+    virtual void on_rtmp_residence(SrsRequest* req, SrsHistogram* h);
+    virtual void on_rtc_residence(SrsRequest* req, SrsHistogram* h);
     // When got videos, update the frames.
     // We only stat the total number of video frames.
     virtual srs_error_t on_video_frames(SrsRequest* req, int nb_frames);
@@ -191,11 +279,22 @@ private:
     // Cleanup the stream if stream is not active and for the last client.
     void cleanup_stream(SrsStatisticStream* stream);
 public:
-    // Sample the kbps, add delta bytes of conn.
-    // Use kbps_sample() to get all result of kbps stat.
-    virtual void kbps_add_delta(std::string id, ISrsKbpsDelta* delta);
+    // Sample the kbps, add delta bytes of conn by handle, which is resolved by cid once and held by the
+    // connection, so it never lookup the client by id. Use kbps_sample() to get all result of kbps stat.
+    virtual void kbps_add_delta(SrsStatisticHandle& handle, const SrsContextId& cid, ISrsKbpsDelta* delta);
     // Calc the result for all kbps.
     virtual void kbps_sample();
+    // Create a shard of counters, for a thread other than hybrid to add delta bytes by the slot of handle,
+    // which is resolved by hybrid thread. Return NULL if too many shards.
+    // @remark It's thread-safe, and the shard is owned by statistic.
+    virtual SrsStatisticShard* create_shard();
+private:
+    // Resolve the handle of client, return false if client not exists.
+    bool resolve(SrsStatisticHandle& handle, const SrsContextId& cid);
+    void alloc_slot(SrsStatisticClient* client);
+    void free_slot(SrsStatisticClient* client);
+    // Aggregate the counters of client to client, stream, vhost and server kbps.
+    void aggregate(SrsStatisticClient* client);
 public:
     // Get the server id, used to identify the server.
     // For example, when restart, the server id must changed.
@@ -206,14 +305,18 @@ public:
     virtual std::string service_pid();
     // Dumps the vhosts to amf0 array.
     virtual srs_error_t dumps_vhosts(SrsJsonArray* arr);
-    // Dumps the streams to amf0 array.
+    // Dumps the streams to JSON writer, as elements of array.
+    // @param cursor the id of last stream dumped, ignore start if not empty.
     // @param start the start index, from 0.
     // @param count the max count of streams to dump.
-    virtual srs_error_t dumps_streams(SrsJsonArray* arr, int start, int count);
-    // Dumps the clients to amf0 array
+    // @param next the id of last stream dumped, empty if no more streams.
+    virtual srs_error_t dumps_streams(SrsJsonWriter* w, std::string cursor, int start, int count, std::string& next);
+    // Dumps the clients to JSON writer, as elements of array.
+    // @param cursor the id of last client dumped, ignore start if not empty.
     // @param start the start index, from 0.
     // @param count the max count of clients to dump.
-    virtual srs_error_t dumps_clients(SrsJsonArray* arr, int start, int count);
+    // @param next the id of last client dumped, empty if no more clients.
+    virtual srs_error_t dumps_clients(SrsJsonWriter* w, std::string cursor, int start, int count, std::string& next);
     // Dumps the hints about SRS server.
     void dumps_hints_kv(std::stringstream & ss);
 #ifdef SRS_APM
@@ -228,6 +331,8 @@ private:
 public:
     // Dumps exporter metrics.
     virtual srs_error_t dumps_metrics(int64_t& send_bytes, int64_t& recv_bytes, int64_t& nstreams, int64_t& nclients, int64_t& total_nclients, int64_t& nerrs);
+    // Dumps the residence time of streams as exporter metrics.
+    virtual void dumps_residence_metrics(std::stringstream& ss);
 };
 
 // Generate a random string id, with constant prefix.
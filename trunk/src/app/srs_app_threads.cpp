@@ -12,6 +12,7 @@
 #include <srs_kernel_utility.hpp>
 #include <srs_app_rtc_source.hpp>
 #include <srs_app_source.hpp>
+#include <srs_app_workers.hpp>
 #include <srs_app_pithy_print.hpp>
 #include <srs_app_rtc_server.hpp>
 #include <srs_app_log.hpp>
@@ -28,13 +29,25 @@
 #ifdef SRS_GB28181
 #include <srs_app_gb28181.hpp>
 #endif
+#ifdef SRS_FFMPEG_FIT
+#include <srs_app_rtc_codec.hpp>
+#endif
 
 #include <stdlib.h>
+#include <string.h>
 #include <string>
+#include <algorithm>
 using namespace std;
 
 #include <unistd.h>
 #include <fcntl.h>
+#include <dirent.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#ifndef SRS_OSX
+#include <sys/eventfd.h>
+#endif
+#include <time.h>
 
 #if defined(SRS_OSX) || defined(SRS_CYGWIN64)
     pid_t gettid() {
@@ -54,6 +67,11 @@ using namespace std;
     }
 #endif
 
+// The memory policy to allocate from the local node of thread, see https://man7.org/linux/man-pages/man2/set_mempolicy.2.html
+#ifndef MPOL_LOCAL
+    #define MPOL_LOCAL 4
+#endif
+
 extern ISrsLog* _srs_log;
 extern ISrsContext* _srs_context;
 extern SrsConfig* _srs_config;
@@ -318,6 +336,7 @@ srs_error_t srs_global_initialize()
     // The global objects which depends on ST.
     _srs_hybrid = new SrsHybridServer();
     _srs_sources = new SrsLiveSourceManager();
+    _srs_stream_workers = new SrsStreamWorkers();
     _srs_stages = new SrsStageManager();
     _srs_circuit_breaker = new SrsCircuitBreaker();
 
@@ -332,6 +351,9 @@ srs_error_t srs_global_initialize()
     _srs_rtc_manager = new SrsResourceManager("RTC", true);
     _srs_rtc_dtls_certificate = new SrsDtlsCertificate();
 #endif
+#ifdef SRS_FFMPEG_FIT
+    _srs_audio_transcoders = new SrsAudioTranscodeManager();
+#endif
 #ifdef SRS_GB28181
     _srs_gb_manager = new SrsResourceManager("GB", true);
 #endif
@@ -497,6 +519,329 @@ void SrsThreadMutex::unlock()
     srs_assert(!r0);
 }
 
+SrsThreadRef::SrsThreadRef()
+{
+    refs_ = 1;
+}
+
+SrsThreadRef::~SrsThreadRef()
+{
+}
+
+void SrsThreadRef::ref()
+{
+    __atomic_add_fetch(&refs_, 1, __ATOMIC_RELAXED);
+}
+
+void SrsThreadRef::unref()
+{
+    // The release makes the writes of this thread visible to the thread which frees the object.
+    if (__atomic_sub_fetch(&refs_, 1, __ATOMIC_ACQ_REL) == 0) {
+        delete this;
+    }
+}
+
+int SrsThreadRef::refs()
+{
+    return __atomic_load_n(&refs_, __ATOMIC_ACQUIRE);
+}
+
+SrsThreadNotifier::SrsThreadNotifier()
+{
+    rfd_ = wfd_ = -1;
+    stfd_ = NULL;
+    parking_ = 0;
+    parked_ = &parking_;
+    nn_notifies_ = 0;
+}
+
+SrsThreadNotifier::~SrsThreadNotifier()
+{
+    // The ST fd closes the read fd.
+    if (stfd_) {
+        srs_close_stfd(stfd_);
+    } else if (rfd_ >= 0) {
+        ::close(rfd_);
+    }
+
+    if (wfd_ >= 0 && wfd_ != rfd_) {
+        ::close(wfd_);
+    }
+}
+
+srs_error_t SrsThreadNotifier::initialize(int* parked)
+{
+    srs_error_t err = srs_success;
+
+    if (parked) {
+        parked_ = parked;
+    }
+
+#ifdef SRS_OSX
+    int fds[2];
+    if (pipe(fds) < 0) {
+        return srs_error_new(ERROR_THREAD_CHANNEL, "create pipe");
+    }
+    rfd_ = fds[0];
+    wfd_ = fds[1];
+#else
+    // See https://man7.org/linux/man-pages/man2/eventfd.2.html
+    if ((rfd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        return srs_error_new(ERROR_THREAD_CHANNEL, "create eventfd");
+    }
+    wfd_ = rfd_;
+#endif
+
+    // The producers never block on the write fd.
+    if (fcntl(wfd_, F_SETFL, fcntl(wfd_, F_GETFL) | O_NONBLOCK) < 0) {
+        return srs_error_new(ERROR_THREAD_CHANNEL, "nonblock fd=%d", wfd_);
+    }
+
+    return err;
+}
+
+srs_error_t SrsThreadNotifier::open()
+{
+    srs_error_t err = srs_success;
+
+    if ((stfd_ = srs_netfd_open(rfd_)) == NULL) {
+        return srs_error_new(ERROR_ST_OPEN_SOCKET, "open fd=%d", rfd_);
+    }
+
+    return err;
+}
+
+void SrsThreadNotifier::park()
+{
+    __atomic_store_n(parked_, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void SrsThreadNotifier::unpark()
+{
+    __atomic_store_n(parked_, 0, __ATOMIC_RELAXED);
+}
+
+srs_error_t SrsThreadNotifier::wait(srs_utime_t timeout)
+{
+    srs_error_t err = srs_success;
+
+    // Read all notifies, the coroutine switches if no notify.
+    char buf[64];
+    ssize_t nn = srs_read(stfd_, buf, sizeof(buf), timeout);
+    unpark();
+
+    if (nn < 0 && errno != ETIME && errno != EAGAIN) {
+        return srs_error_new(ERROR_THREAD_CHANNEL, "read fd=%d, nn=%d, errno=%d", rfd_, (int)nn, errno);
+    }
+
+    return err;
+}
+
+void SrsThreadNotifier::notify()
+{
+    // Never notify when the consumer is running, which will pop all objects.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_exchange_n(parked_, 0, __ATOMIC_SEQ_CST)) {
+        return;
+    }
+
+    __atomic_add_fetch(&nn_notifies_, 1, __ATOMIC_RELAXED);
+
+#ifdef SRS_OSX
+    char v = 1;
+#else
+    uint64_t v = 1;
+#endif
+    // Ignore the failure, for the fd is full of notifies, which wakes up the consumer anyway.
+    ssize_t nn = ::write(wfd_, &v, sizeof(v));
+    (void)nn;
+}
+
+int64_t SrsThreadNotifier::nn_notifies()
+{
+    return __atomic_load_n(&nn_notifies_, __ATOMIC_RELAXED);
+}
+
+srs_utime_t srs_thread_now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * SRS_UTIME_SECONDS + ts.tv_nsec / 1000;
+}
+
+srs_error_t srs_parse_cpu_list(string list, vector<int>& cpus)
+{
+    cpus.clear();
+
+    vector<string> ranges = srs_string_split(list, ",");
+    for (int i = 0; i < (int)ranges.size(); i++) {
+        string range = srs_string_trim_start(srs_string_trim_end(ranges.at(i), " "), " ");
+        if (range.empty()) {
+            continue;
+        }
+
+        size_t pos = range.find("-");
+        string first = range.substr(0, pos);
+        string last = (pos == string::npos) ? first : range.substr(pos + 1);
+        if (first.empty() || last.empty() || first.find_first_not_of("0123456789") != string::npos
+            || last.find_first_not_of("0123456789") != string::npos) {
+            return srs_error_new(ERROR_THREAD_AFFINITY, "invalid cpu range %s", range.c_str());
+        }
+
+        int from = ::atoi(first.c_str()), to = ::atoi(last.c_str());
+        if (from > to || to >= CPU_SETSIZE) {
+            return srs_error_new(ERROR_THREAD_AFFINITY, "invalid cpu range %s, max=%d", range.c_str(), CPU_SETSIZE - 1);
+        }
+
+        for (int cpu = from; cpu <= to; cpu++) {
+            if (std::find(cpus.begin(), cpus.end(), cpu) == cpus.end()) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+
+    std::sort(cpus.begin(), cpus.end());
+
+    return srs_success;
+}
+
+// Get the NUMA node of cpu, by the node link in sysfs, return -1 if unknown.
+int srs_thread_cpu_node(int cpu)
+{
+    int node = -1;
+
+    DIR* dir = opendir(srs_fmt("/sys/devices/system/cpu/cpu%d", cpu).c_str());
+    if (!dir) {
+        return node;
+    }
+
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        string name = ent->d_name;
+        if (srs_string_starts_with(name, "node") && name.length() > 4 && ::isdigit(name.at(4))) {
+            node = ::atoi(name.c_str() + 4);
+            break;
+        }
+    }
+    closedir(dir);
+
+    return node;
+}
+
+// Read the field from proc file like sched or status, in the format of "key: value", return false if not found.
+bool srs_thread_read_proc_field(string path, string key, int64_t& v)
+{
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) {
+        return false;
+    }
+
+    bool found = false;
+    char buf[256];
+    while (fgets(buf, sizeof(buf), f)) {
+        if (strncmp(buf, key.c_str(), key.length()) != 0) {
+            continue;
+        }
+
+        char* p = strchr(buf + key.length(), ':');
+        if (p) {
+            v = ::atoll(p + 1);
+            found = true;
+        }
+        break;
+    }
+    fclose(f);
+
+    return found;
+}
+
+// Warn if the IRQs of NICs are served by the CPUs of hybrid thread, because the softirq of NIC steals the
+// CPU from hybrid thread, which introduces the latency spikes. Recommend the CPUs not used by hybrid.
+void srs_thread_check_irqs(vector<int>& hybrid, vector<int>& cpus)
+{
+    if (hybrid.empty()) {
+        return;
+    }
+
+    // The NICs, except the loopback, see https://www.kernel.org/doc/Documentation/ABI/testing/sysfs-class-net
+    vector<string> nics;
+    DIR* dir = opendir("/sys/class/net");
+    if (!dir) {
+        return;
+    }
+
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        string name = ent->d_name;
+        if (name != "." && name != ".." && name != "lo") {
+            nics.push_back(name);
+        }
+    }
+    closedir(dir);
+
+    vector<int> spare;
+    for (int i = 0; i < (int)cpus.size(); i++) {
+        if (std::find(hybrid.begin(), hybrid.end(), cpus.at(i)) == hybrid.end()) {
+            spare.push_back(cpus.at(i));
+        }
+    }
+
+    // Each line is an IRQ, for example, " 45:  10  20  PCI-MSI 524288-edge  eth0-TxRx-0", the last is the name.
+    FILE* f = fopen("/proc/interrupts", "r");
+    if (!f) {
+        return;
+    }
+
+    char buf[4096];
+    while (fgets(buf, sizeof(buf), f)) {
+        vector<string> fields = srs_string_split(srs_string_trim_end(buf, "\n"), " ");
+        fields.erase(std::remove(fields.begin(), fields.end(), string()), fields.end());
+        if (fields.size() < 2 || fields.at(0).empty() || !::isdigit(fields.at(0).at(0))) {
+            continue;
+        }
+
+        string name = fields.back();
+        bool is_nic = false;
+        for (int i = 0; i < (int)nics.size() && !is_nic; i++) {
+            is_nic = srs_string_starts_with(name, nics.at(i));
+        }
+        if (!is_nic) {
+            continue;
+        }
+
+        int irq = ::atoi(fields.at(0).c_str());
+        FILE* fa = fopen(srs_fmt("/proc/irq/%d/smp_affinity_list", irq).c_str(), "r");
+        if (!fa) {
+            continue;
+        }
+
+        char line[512] = {0};
+        fgets(line, sizeof(line), fa);
+        fclose(fa);
+        string affinity = srs_string_trim_end(line, "\n");
+
+        vector<int> irq_cpus;
+        srs_error_t err = srs_parse_cpu_list(affinity, irq_cpus);
+        if (err != srs_success) {
+            srs_freep(err);
+            continue;
+        }
+
+        for (int i = 0; i < (int)irq_cpus.size(); i++) {
+            if (std::find(hybrid.begin(), hybrid.end(), irq_cpus.at(i)) == hybrid.end()) {
+                continue;
+            }
+
+            srs_warn("IRQ %d(%s) on cpus %s overlaps hybrid cpus %s, recommend: echo %s > /proc/irq/%d/smp_affinity_list",
+                irq, name.c_str(), affinity.c_str(), srs_join_vector_string(hybrid, ",").c_str(),
+                spare.empty() ? "<cpus>" : srs_join_vector_string(spare, ",").c_str(), irq);
+            break;
+        }
+    }
+    fclose(f);
+}
+
 SrsThreadEntry::SrsThreadEntry()
 {
     pool = NULL;
@@ -504,6 +849,12 @@ SrsThreadEntry::SrsThreadEntry()
     arg = NULL;
     num = 0;
     tid = 0;
+    numa_local = false;
+
+    stat = new SrsProcSelfStat();
+    node = -1;
+    migrations = 0;
+    nivcsw = 0;
 
     err = srs_success;
 }
@@ -511,6 +862,7 @@ SrsThreadEntry::SrsThreadEntry()
 SrsThreadEntry::~SrsThreadEntry()
 {
     srs_freep(err);
+    srs_freep(stat);
 
     // TODO: FIXME: Should dispose trd.
 }
@@ -578,7 +930,35 @@ srs_error_t SrsThreadPool::initialize()
 
     interval_ = _srs_config->get_threads_interval();
 
-    srs_trace("Thread #%d(%s): init name=%s, interval=%dms", entry->num, entry->label.c_str(), entry->name.c_str(), srsu2msi(interval_));
+#if !defined(SRS_OSX) && !defined(SRS_CYGWIN64)
+    // Save the CPUs of process, before pinning the primordial thread.
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int i = 0; i < CPU_SETSIZE; i++) {
+            if (CPU_ISSET(i, &set)) origin_cpus_.push_back(i);
+        }
+    }
+#endif
+
+    if ((err = setup_placement(entry)) != srs_success) {
+        return srs_error_wrap(err, "setup placement");
+    }
+
+    if ((err = apply_placement(entry)) != srs_success) {
+        return srs_error_wrap(err, "apply placement");
+    }
+
+    srs_trace("Thread #%d(%s): init name=%s, interval=%dms, cpus=%s, numa_local=%d", entry->num, entry->label.c_str(),
+        entry->name.c_str(), srsu2msi(interval_), srs_join_vector_string(entry->cpus, ",").c_str(),
+        entry->numa_local);
+
+    // Check the NIC IRQs against the CPUs of hybrid thread, which is sensitive to the softirq load.
+    vector<int> hybrid_cpus;
+    if ((err = srs_parse_cpu_list(_srs_config->get_threads_cpu_affinity("hybrid"), hybrid_cpus)) != srs_success) {
+        return srs_error_wrap(err, "hybrid cpus");
+    }
+    srs_thread_check_irqs(hybrid_cpus, origin_cpus_);
 
     return err;
 }
@@ -641,7 +1021,85 @@ srs_error_t SrsThreadPool::acquire_pid_file()
     return srs_success;
 }
 
-srs_error_t SrsThreadPool::execute(string label, srs_error_t (*start)(void* arg), void* arg)
+srs_error_t SrsThreadPool::setup_placement(SrsThreadEntry* entry)
+{
+    srs_error_t err = srs_success;
+
+    string affinity = _srs_config->get_threads_cpu_affinity(entry->label);
+    if ((err = srs_parse_cpu_list(affinity, entry->cpus)) != srs_success) {
+        return srs_error_wrap(err, "parse cpu_affinity %s of %s", affinity.c_str(), entry->label.c_str());
+    }
+
+    // Divide the CPUs of hybrid thread by stream workers, so each worker runs on its own CPU.
+    if (entry->label == "hybrid" && _srs_stream_workers->enabled() && entry->cpus.size() > 1) {
+        int cpu = entry->cpus.at(_srs_stream_workers->index() % entry->cpus.size());
+        entry->cpus = vector<int>(1, cpu);
+    }
+
+    // The thread inherits the affinity of creator, so we reset it to the CPUs of process if primordial is pinned.
+    if (entry->cpus.empty() && entry != entry_ && !entry_->cpus.empty()) {
+        entry->cpus = origin_cpus_;
+    }
+
+    entry->numa_local = _srs_config->get_threads_numa_local();
+
+    return err;
+}
+
+srs_error_t SrsThreadPool::apply_placement(SrsThreadEntry* entry)
+{
+    srs_error_t err = srs_success;
+
+#if !defined(SRS_OSX) && !defined(SRS_CYGWIN64)
+    if (!entry->cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int i = 0; i < (int)entry->cpus.size(); i++) {
+            CPU_SET(entry->cpus.at(i), &set);
+        }
+
+        // See https://man7.org/linux/man-pages/man2/sched_setaffinity.2.html
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            return srs_error_new(ERROR_THREAD_AFFINITY, "set affinity of %s, errno=%d", entry->label.c_str(), errno);
+        }
+    }
+
+    // The default policy is local, so it only takes effect when inherited another policy from launcher. Ignore
+    // the failure, because the syscall might be disabled by the container.
+    if (entry->numa_local && syscall(SYS_set_mempolicy, MPOL_LOCAL, NULL, 0) != 0) {
+        entry->numa_local = false;
+    }
+#endif
+
+    return err;
+}
+
+void SrsThreadPool::update_placement(vector<SrsThreadEntry*>& threads)
+{
+    for (int i = 0; i < (int)threads.size(); i++) {
+        SrsThreadEntry* entry = threads.at(i);
+        if (entry->tid <= 0) {
+            continue;
+        }
+
+        int cpu = entry->stat->ok ? entry->stat->processor : -1;
+        if (!srs_update_process_stat(entry->tid, *entry->stat)) {
+            continue;
+        }
+        entry->node = srs_thread_cpu_node(entry->stat->processor);
+
+        // Count the migrations by scheduler, or by the sampled CPU changes if not available.
+        string sched = srs_fmt("/proc/self/task/%d/sched", (int)entry->tid);
+        if (!srs_thread_read_proc_field(sched, "se.nr_migrations", entry->migrations) && cpu >= 0 && cpu != entry->stat->processor) {
+            entry->migrations++;
+        }
+
+        string status = srs_fmt("/proc/self/task/%d/status", (int)entry->tid);
+        srs_thread_read_proc_field(status, "nonvoluntary_ctxt_switches", entry->nivcsw);
+    }
+}
+
+srs_error_t SrsThreadPool::execute(string label, srs_error_t (*start)(void* arg), void* arg, pthread_t* ptrd)
 {
     srs_error_t err = srs_success;
 
@@ -674,6 +1132,12 @@ srs_error_t SrsThreadPool::execute(string label, srs_error_t (*start)(void* arg)
     snprintf(buf, sizeof(buf), "srs-%s-%d", entry->label.c_str(), entry->num);
     entry->name = buf;
 
+    // Load the placement in the creator thread, because config is not thread-safe.
+    if ((err = setup_placement(entry)) != srs_success) {
+        entry->err = srs_error_wrap(err, "setup placement of %s", label.c_str());
+        return srs_error_copy(entry->err);
+    }
+
     // https://man7.org/linux/man-pages/man3/pthread_create.3.html
     pthread_t trd;
     int r0 = pthread_create(&trd, NULL, SrsThreadPool::start, entry);
@@ -683,6 +1147,9 @@ srs_error_t SrsThreadPool::execute(string label, srs_error_t (*start)(void* arg)
     }
 
     entry->trd = trd;
+    if (ptrd) {
+        *ptrd = trd;
+    }
 
     return err;
 }
@@ -721,6 +1188,9 @@ srs_error_t SrsThreadPool::run()
             srs_usleep(1 * SRS_UTIME_SECONDS);
         }
 
+        // Sample the placement of threads, for API and to find the migrations.
+        update_placement(threads);
+
         // Show statistics for RTC server.
         SrsProcSelfStat* u = srs_get_self_proc_stat();
         // Resident Set Size: number of pages the process has in real memory.
@@ -766,12 +1236,24 @@ vector<SrsThreadEntry*> SrsThreadPool::hybrids()
     return hybrids_;
 }
 
+vector<SrsThreadEntry*> SrsThreadPool::threads()
+{
+    SrsThreadLocker(lock_);
+    return threads_;
+}
+
 void* SrsThreadPool::start(void* arg)
 {
     srs_error_t err = srs_success;
 
     SrsThreadEntry* entry = (SrsThreadEntry*)arg;
 
+    // Pin the thread before any thread-local pool is created, so the pages are touched on the local NUMA node.
+    if ((err = SrsThreadPool::apply_placement(entry)) != srs_success) {
+        entry->err = err;
+        return NULL;
+    }
+
     // Initialize thread-local variables.
     if ((err = SrsThreadPool::setup_thread_locals()) != srs_success) {
         entry->err = err;
@@ -788,7 +1270,9 @@ void* SrsThreadPool::start(void* arg)
     pthread_setname_np(entry->name.c_str());
 #endif
 
-    srs_trace("Thread #%d: run with tid=%d, entry=%p, label=%s, name=%s", entry->num, (int)entry->tid, entry, entry->label.c_str(), entry->name.c_str());
+    srs_trace("Thread #%d: run with tid=%d, entry=%p, label=%s, name=%s, cpus=%s, numa_local=%d", entry->num, (int)entry->tid,
+        entry, entry->label.c_str(), entry->name.c_str(), srs_join_vector_string(entry->cpus, ",").c_str(),
+        entry->numa_local);
 
     if ((err = entry->start(entry->arg)) != srs_success) {
         entry->err = err;
@@ -13,6 +13,9 @@
 
 #include <pthread.h>
 
+#include <string>
+#include <vector>
+
 class SrsThreadPool;
 class SrsProcSelfStat;
 
@@ -87,6 +90,319 @@ public:
     }
 };
 
+// The lock-free and bounded queue of pointers, to pass objects between threads. It's only safe when there is
+// exactly one producer thread to push and one consumer thread to pop, for example, the hybrid thread to push
+// tasks to a worker, and the worker to pop them.
+// @remark The queue never frees the items, user should free them after popped.
+template<typename T>
+class SrsSpscQueue
+{
+private:
+    T** items_;
+    uint32_t capacity_;
+    uint32_t mask_;
+private:
+    // The head is updated by consumer, and the tail by producer, in different cache lines.
+    char pad0_[64];
+    uint32_t head_;
+    char pad1_[64];
+    uint32_t tail_;
+    char pad2_[64];
+public:
+    // The capacity is aligned to power of 2.
+    SrsSpscQueue(uint32_t capacity) {
+        capacity_ = 1;
+        while (capacity_ < capacity) {
+            capacity_ <<= 1;
+        }
+        mask_ = capacity_ - 1;
+        items_ = new T*[capacity_];
+        head_ = tail_ = 0;
+    }
+    virtual ~SrsSpscQueue() {
+        srs_freepa(items_);
+    }
+public:
+    // Push item to the tail, return false if full. Only for the producer thread.
+    bool push(T* v) {
+        uint32_t tail = __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+        uint32_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+        if (tail - head >= capacity_) {
+            return false;
+        }
+
+        items_[tail & mask_] = v;
+        __atomic_store_n(&tail_, tail + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+    // Pop item from the head, return NULL if empty. Only for the consumer thread.
+    T* pop() {
+        uint32_t head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+        uint32_t tail = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            return NULL;
+        }
+
+        T* v = items_[head & mask_];
+        __atomic_store_n(&head_, head + 1, __ATOMIC_RELEASE);
+        return v;
+    }
+    // The number of items in queue, which is approximate for any thread.
+    uint32_t size() {
+        uint32_t tail = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+        uint32_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+        return tail - head;
+    }
+    uint32_t capacity() {
+        return capacity_;
+    }
+};
+
+// The object shared by threads, which is freed by the thread releasing the last reference. For example, a
+// message is referenced by each channel it's pushed to, and freed by the last consumer.
+class SrsThreadRef
+{
+private:
+    int refs_;
+public:
+    // The creator holds the first reference.
+    SrsThreadRef();
+    virtual ~SrsThreadRef();
+public:
+    // Add a reference, for example, before pushing the object to another channel.
+    void ref();
+    // Release a reference, and free the object if it's the last one.
+    void unref();
+    int refs();
+};
+
+// The notifier to wakeup the coroutine of consumer thread from other threads, by eventfd on linux, or pipe
+// on other systems. It's only notified when consumer is parked, to avoid the syscall when it's running.
+// @remark For processes, the notifier is initialized before fork, and the parked flag is in shared memory.
+class SrsThreadNotifier
+{
+private:
+    int rfd_;
+    int wfd_;
+    srs_netfd_t stfd_;
+    // Whether the consumer is parked, and wait for notifying, which points to parking_ if not in shared memory.
+    int* parked_;
+    int parking_;
+    // The number of notifies, which is a syscall to wakeup the consumer.
+    int64_t nn_notifies_;
+public:
+    SrsThreadNotifier();
+    virtual ~SrsThreadNotifier();
+public:
+    // Create the fds, by any thread. The parked flag is owned by notifier if NULL.
+    srs_error_t initialize(int* parked = NULL);
+    // Open the fd for ST, MUST be called by the consumer thread, because ST is thread-local.
+    srs_error_t open();
+public:
+    // Mark the consumer to be parked, user MUST check the condition again after parked.
+    void park();
+    void unpark();
+    // Wait for notifying util timeout, then unpark. Only for the consumer thread.
+    srs_error_t wait(srs_utime_t timeout);
+    // Wakeup the consumer if parked, by any thread.
+    void notify();
+    int64_t nn_notifies();
+};
+
+// The monotonic time in us, which is safe for any thread.
+extern srs_utime_t srs_thread_now();
+
+// The lock-free and bounded channel of refcounted pointers, to pass objects from one or more producer threads
+// to a consumer thread, which parks the consumer coroutine when empty and is notified by producers. The
+// producers reserve slots by CAS, so the objects of a producer are in order.
+// @remark The channel owns a reference of the objects, which is transferred from producer to consumer.
+template<typename T>
+class SrsThreadChannel
+{
+private:
+    // The slot is ready when seq is position + 1, which is set by producer after the object written.
+    struct Slot {
+        uint32_t seq;
+        T* item;
+        srs_utime_t pushed_at;
+    };
+    Slot* slots_;
+    uint32_t capacity_;
+    uint32_t mask_;
+    SrsThreadNotifier* notifier_;
+private:
+    // The head is updated by consumer, and the tail by producers, in different cache lines.
+    char pad0_[64];
+    uint32_t head_;
+    char pad1_[64];
+    uint32_t tail_;
+    char pad2_[64];
+private:
+    // The counters updated by producers.
+    int64_t nn_pushed_;
+    int64_t nn_dropped_;
+    char pad3_[64];
+    // The counters updated by consumer, the latency is from pushed to popped.
+    int64_t nn_popped_;
+    srs_utime_t latency_total_;
+    srs_utime_t latency_max_;
+public:
+    // The capacity is aligned to power of 2, at least 2.
+    SrsThreadChannel(uint32_t capacity) {
+        capacity_ = 2;
+        while (capacity_ < capacity) {
+            capacity_ <<= 1;
+        }
+        mask_ = capacity_ - 1;
+
+        // The initial seq never equals to position + 1, so the slot is not ready.
+        slots_ = new Slot[capacity_];
+        for (uint32_t i = 0; i < capacity_; i++) {
+            slots_[i].seq = i;
+            slots_[i].item = NULL;
+            slots_[i].pushed_at = 0;
+        }
+
+        head_ = tail_ = 0;
+        notifier_ = new SrsThreadNotifier();
+        nn_pushed_ = nn_dropped_ = nn_popped_ = 0;
+        latency_total_ = latency_max_ = 0;
+    }
+    virtual ~SrsThreadChannel() {
+        T* v = NULL;
+        while (pop(&v, 1) == 1) {
+            v->unref();
+        }
+
+        srs_freepa(slots_);
+        srs_freep(notifier_);
+    }
+public:
+    // Create the notifier, by any thread.
+    srs_error_t initialize() {
+        return notifier_->initialize();
+    }
+    // Open the channel for consumer, MUST be called by the consumer thread.
+    srs_error_t open() {
+        return notifier_->open();
+    }
+public:
+    // Push objects to the tail, return the number of pushed objects, the left objects are not pushed for
+    // channel is full and still owned by user. For any producer thread.
+    int push(T** items, int nn_items) {
+        uint32_t tail = __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+        uint32_t nn = 0;
+        do {
+            uint32_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+            nn = capacity_ - (tail - head);
+            nn = (nn < (uint32_t)nn_items) ? nn : (uint32_t)nn_items;
+            if (nn == 0) {
+                __atomic_add_fetch(&nn_dropped_, nn_items, __ATOMIC_RELAXED);
+                return 0;
+            }
+        } while (!__atomic_compare_exchange_n(&tail_, &tail, tail + nn, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+        srs_utime_t now = srs_thread_now();
+        for (uint32_t i = 0; i < nn; i++) {
+            Slot* slot = &slots_[(tail + i) & mask_];
+            slot->item = items[i];
+            slot->pushed_at = now;
+            __atomic_store_n(&slot->seq, tail + i + 1, __ATOMIC_RELEASE);
+        }
+
+        __atomic_add_fetch(&nn_pushed_, nn, __ATOMIC_RELAXED);
+        if (nn < (uint32_t)nn_items) {
+            __atomic_add_fetch(&nn_dropped_, nn_items - nn, __ATOMIC_RELAXED);
+        }
+
+        notifier_->notify();
+        return (int)nn;
+    }
+    bool push(T* v) {
+        return push(&v, 1) == 1;
+    }
+    // Pop objects from the head, return the number of popped objects, 0 if empty. Only for the consumer thread.
+    int pop(T** items, int max_items) {
+        uint32_t head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+
+        int nn = 0;
+        srs_utime_t now = 0;
+        for (; nn < max_items; nn++, head++) {
+            Slot* slot = &slots_[head & mask_];
+            if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != head + 1) {
+                break;
+            }
+
+            items[nn] = slot->item;
+
+            if (!now) now = srs_thread_now();
+            srs_utime_t latency = (now > slot->pushed_at) ? now - slot->pushed_at : 0;
+            __atomic_store_n(&latency_total_, latency_total_ + latency, __ATOMIC_RELAXED);
+            if (latency > latency_max_) {
+                __atomic_store_n(&latency_max_, latency, __ATOMIC_RELAXED);
+            }
+        }
+
+        if (nn) {
+            __atomic_store_n(&head_, head, __ATOMIC_RELEASE);
+            __atomic_store_n(&nn_popped_, nn_popped_ + nn, __ATOMIC_RELAXED);
+        }
+        return nn;
+    }
+    // Pop objects, park the coroutine util any object pushed or timeout. Only for the consumer thread.
+    srs_error_t pop(T** items, int max_items, int* pnn, srs_utime_t timeout) {
+        srs_error_t err = srs_success;
+
+        if ((*pnn = pop(items, max_items)) > 0) {
+            return err;
+        }
+
+        // Check again after parked, or lost the notify when pushed before parked.
+        notifier_->park();
+        if ((*pnn = pop(items, max_items)) > 0) {
+            notifier_->unpark();
+            return err;
+        }
+
+        if ((err = notifier_->wait(timeout)) != srs_success) {
+            return srs_error_wrap(err, "wait");
+        }
+
+        *pnn = pop(items, max_items);
+        return err;
+    }
+public:
+    // The number of objects in channel, which is approximate for any thread.
+    uint32_t size() {
+        uint32_t tail = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+        uint32_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+        return tail - head;
+    }
+    uint32_t capacity() {
+        return capacity_;
+    }
+    // The counters, which are approximate for any thread.
+    int64_t nn_pushed() {
+        return __atomic_load_n(&nn_pushed_, __ATOMIC_RELAXED);
+    }
+    int64_t nn_dropped() {
+        return __atomic_load_n(&nn_dropped_, __ATOMIC_RELAXED);
+    }
+    int64_t nn_popped() {
+        return __atomic_load_n(&nn_popped_, __ATOMIC_RELAXED);
+    }
+    int64_t nn_notifies() {
+        return notifier_->nn_notifies();
+    }
+    srs_utime_t latency_avg() {
+        int64_t nn = nn_popped();
+        return nn ? __atomic_load_n(&latency_total_, __ATOMIC_RELAXED) / nn : 0;
+    }
+    srs_utime_t latency_max() {
+        return __atomic_load_n(&latency_max_, __ATOMIC_RELAXED);
+    }
+};
+
 // The information for a thread.
 class SrsThreadEntry
 {
@@ -99,6 +415,18 @@ public:
     int num;
     // @see https://man7.org/linux/man-pages/man2/gettid.2.html
     pid_t tid;
+    // The CPUs to pin the thread, empty to inherit from the creator thread.
+    std::vector<int> cpus;
+    // Whether allocate memory from the local NUMA node of thread.
+    bool numa_local;
+public:
+    // The placement of thread, sampled by primordial thread every interval.
+    SrsProcSelfStat* stat;
+    // The NUMA node of the CPU the thread last ran on, -1 if unknown.
+    int node;
+    // The number of migrations between CPUs, and the involuntary context switches.
+    int64_t migrations;
+    int64_t nivcsw;
 public:
     // The thread object.
     pthread_t trd;
@@ -123,6 +451,9 @@ private:
     // The hybrid server entry, the cpu percent used for circuit breaker.
     SrsThreadEntry* hybrid_;
     std::vector<SrsThreadEntry*> hybrids_;
+private:
+    // The CPUs of process before pinning the primordial thread, for threads to reset the inherited affinity.
+    std::vector<int> origin_cpus_;
 private:
     // The pid file fd, lock the file write when server is running.
     // @remark the init.d script should cleanup the pid file, when stop service,
@@ -140,9 +471,15 @@ public:
 private:
     // Require the PID file for the whole process.
     virtual srs_error_t acquire_pid_file();
+    // Load the CPU affinity and NUMA policy of thread from config.
+    srs_error_t setup_placement(SrsThreadEntry* entry);
+    // Apply the placement for current thread, MUST call before creating the thread-local pools.
+    static srs_error_t apply_placement(SrsThreadEntry* entry);
+    // Sample the CPU and migrations of threads.
+    void update_placement(std::vector<SrsThreadEntry*>& threads);
 public:
-    // Execute start function with label in thread.
-    srs_error_t execute(std::string label, srs_error_t (*start)(void* arg), void* arg);
+    // Execute start function with label in thread, and get the thread by ptrd to join it if not NULL.
+    srs_error_t execute(std::string label, srs_error_t (*start)(void* arg), void* arg, pthread_t* ptrd = NULL);
     // Run in the primordial thread, util stop or quit.
     srs_error_t run();
     // Stop the thread pool and quit the primordial thread.
@@ -151,10 +488,14 @@ public:
     SrsThreadEntry* self();
     SrsThreadEntry* hybrid();
     std::vector<SrsThreadEntry*> hybrids();
+    std::vector<SrsThreadEntry*> threads();
 private:
     static void* start(void* arg);
 };
 
+// Parse the CPU list like "0-3,8,10-11" to CPUs, in the format of taskset and smp_affinity_list.
+extern srs_error_t srs_parse_cpu_list(std::string list, std::vector<int>& cpus);
+
 // It MUST be thread-safe, global and shared object.
 extern SrsThreadPool* _srs_thread_pool;
 
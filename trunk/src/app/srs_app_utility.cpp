@@ -30,7 +30,10 @@ using namespace std;
 #include <srs_protocol_kbps.hpp>
 #include <srs_protocol_json.hpp>
 #include <srs_kernel_buffer.hpp>
+#include <srs_kernel_flv.hpp>
 #include <srs_protocol_amf0.hpp>
+#include <srs_app_threads.hpp>
+#include <srs_app_workers.hpp>
 #include <srs_kernel_utility.hpp>
 
 // the longest time to wait for a process to quit.
@@ -367,12 +370,12 @@ bool get_proc_system_stat(SrsProcSystemStat& r)
     return true;
 }
 
-bool get_proc_self_stat(SrsProcSelfStat& r)
+bool get_proc_stat(const char* path, SrsProcSelfStat& r)
 {
 #if !defined(SRS_OSX)
-    FILE* f = fopen("/proc/self/stat", "r");
+    FILE* f = fopen(path, "r");
     if (f == NULL) {
-        srs_warn("open self cpu stat failed, ignore");
+        srs_warn("open cpu stat %s failed, ignore", path);
         return false;
     }
 
@@ -404,6 +407,35 @@ bool get_proc_self_stat(SrsProcSelfStat& r)
     return true;
 }
 
+bool get_proc_self_stat(SrsProcSelfStat& r)
+{
+    return get_proc_stat("/proc/self/stat", r);
+}
+
+bool srs_update_process_stat(int pid, SrsProcSelfStat& o)
+{
+    static int user_hz = (int)sysconf(_SC_CLK_TCK);
+    
+    SrsProcSelfStat r;
+    std::string path = srs_fmt("/proc/%d/stat", pid);
+    if (pid <= 0 || user_hz <= 0 || !get_proc_stat(path.c_str(), r)) {
+        return false;
+    }
+    
+    r.sample_time = srsu2ms(srs_update_system_time());
+    
+    // Calc usage in percent, only when the process is the same one.
+    int64_t total = r.sample_time - o.sample_time;
+    int64_t usage = (r.utime + r.stime) - (o.utime + o.stime);
+    if (o.ok && o.pid == r.pid && total > 0) {
+        r.percent = (float)(usage * 1000 / (double)total / user_hz);
+    }
+    
+    o = r;
+    
+    return true;
+}
+
 void srs_update_proc_stat()
 {
     // @see: http://stackoverflow.com/questions/7298646/calculating-user-nice-sys-idle-iowait-irq-and-sirq-from-proc-stat/7298711
@@ -1340,6 +1372,36 @@ void srs_api_dump_summaries(SrsJsonObject* obj)
     self->set("mem_percent", SrsJsonAny::number(self_mem_percent));
     self->set("cpu_percent", SrsJsonAny::number(u->percent));
     self->set("srs_uptime", SrsJsonAny::integer(srs_uptime));
+
+    // The placement of threads, sampled by the thread pool.
+    SrsJsonArray* threads = SrsJsonAny::array();
+    self->set("threads", threads);
+
+    vector<SrsThreadEntry*> entries = _srs_thread_pool->threads();
+    for (int i = 0; i < (int)entries.size(); i++) {
+        SrsThreadEntry* entry = entries.at(i);
+
+        SrsJsonObject* trd = SrsJsonAny::object();
+        threads->append(trd);
+
+        trd->set("num", SrsJsonAny::integer(entry->num));
+        trd->set("label", SrsJsonAny::str(entry->label.c_str()));
+        trd->set("tid", SrsJsonAny::integer(entry->tid));
+        trd->set("affinity", SrsJsonAny::str(srs_join_vector_string(entry->cpus, ",").c_str()));
+        trd->set("numa_local", SrsJsonAny::boolean(entry->numa_local));
+        trd->set("cpu", SrsJsonAny::integer(entry->stat->ok ? entry->stat->processor : -1));
+        trd->set("node", SrsJsonAny::integer(entry->node));
+        trd->set("cpu_percent", SrsJsonAny::number(entry->stat->percent));
+        trd->set("migrations", SrsJsonAny::integer(entry->migrations));
+        trd->set("nivcsw", SrsJsonAny::integer(entry->nivcsw));
+    }
+
+    // The stream workers, aggregated from the shared memory.
+    if (_srs_stream_workers->enabled()) {
+        SrsJsonObject* workers = SrsJsonAny::object();
+        data->set("workers", workers);
+        _srs_stream_workers->dumps(workers);
+    }
     
     // system
     SrsJsonObject* sys = SrsJsonAny::object();
@@ -1377,6 +1439,21 @@ void srs_api_dump_summaries(SrsJsonObject* obj)
     sys->set("conn_sys_tw", SrsJsonAny::integer(nrs->nb_conn_sys_tw));
     sys->set("conn_sys_udp", SrsJsonAny::integer(nrs->nb_conn_sys_udp));
     sys->set("conn_srs", SrsJsonAny::integer(nrs->nb_conn_srs));
+
+    // The memory pool of media payloads and wrappers.
+    uint64_t hits = 0, misses = 0, recycled = 0, dropped = 0;
+    int64_t cached_bytes = 0;
+    SrsMemoryPool::summary(hits, misses, recycled, dropped, cached_bytes);
+
+    SrsJsonObject* pool = SrsJsonAny::object();
+    data->set("pool", pool);
+
+    pool->set("hits", SrsJsonAny::integer(hits));
+    pool->set("misses", SrsJsonAny::integer(misses));
+    pool->set("hit_percent", SrsJsonAny::number(hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0));
+    pool->set("recycled", SrsJsonAny::integer(recycled));
+    pool->set("dropped", SrsJsonAny::integer(dropped));
+    pool->set("cached_kbyte", SrsJsonAny::integer(cached_bytes / 1024));
 }
 
 string srs_getenv(const string& key)
@@ -326,6 +326,9 @@ extern SrsProcSelfStat* srs_get_self_proc_stat();
 extern SrsProcSystemStat* srs_get_system_proc_stat();
 // The daemon st-thread will update it.
 extern void srs_update_proc_stat();
+// Sample the cpu stat of process by pid, for example, the FFmpeg process,
+// and calc the percent of usage since last sample o, then update the o.
+extern bool srs_update_process_stat(int pid, SrsProcSelfStat& o);
 
 // Stat disk iops
 // @see: http://stackoverflow.com/questions/4458183/how-the-util-of-iostat-is-computed
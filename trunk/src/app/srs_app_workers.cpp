@@ -0,0 +1,905 @@
+//
+// Copyright (c) 2013-2024 The SRS Authors
+//
+// SPDX-License-Identifier: MIT or MulanPSL-2.0
+//
+
+#include <srs_app_workers.hpp>
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#ifndef SRS_OSX
+#include <sys/prctl.h>
+#endif
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_protocol_rtmp_stack.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_app_hybrid.hpp>
+#include <srs_app_threads.hpp>
+
+// The timeout to wait for records, when the worker is parked, because the rings from other workers are empty.
+#define SRS_WORKERS_WAIT_TIMEOUT (1 * SRS_UTIME_SECONDS)
+// The size of record is never this value, which marks the left space at the end of ring is skipped.
+#define SRS_WORKER_RING_WRAP 0xffffffff
+// The header of record in ring, the size of record and reserved.
+#define SRS_WORKER_RING_HEADER 8
+
+// The kind of record in ring.
+#define SRS_WORKER_RECORD_PUBLISH 0x01
+#define SRS_WORKER_RECORD_UNPUBLISH 0x02
+#define SRS_WORKER_RECORD_MESSAGE 0x03
+
+// The record is aligned to 8 bytes, so the header is always in contiguous memory.
+uint32_t srs_worker_ring_align(uint32_t v)
+{
+    return (v + 7) & ~7;
+}
+
+SrsWorkerRing::SrsWorkerRing(char* mem, uint32_t capacity)
+{
+    header_ = (SrsWorkerRingHeader*)mem;
+    data_ = mem + sizeof(SrsWorkerRingHeader);
+    capacity_ = capacity;
+}
+
+SrsWorkerRing::~SrsWorkerRing()
+{
+}
+
+bool SrsWorkerRing::push(const iovec* iovs, int nn_iovs)
+{
+    uint32_t size = 0;
+    for (int i = 0; i < nn_iovs; i++) {
+        size += (uint32_t)iovs[i].iov_len;
+    }
+
+    uint32_t required = SRS_WORKER_RING_HEADER + srs_worker_ring_align(size);
+    if (required > capacity_) {
+        return false;
+    }
+
+    uint64_t tail = __atomic_load_n(&header_->tail, __ATOMIC_RELAXED);
+    uint64_t head = __atomic_load_n(&header_->head, __ATOMIC_ACQUIRE);
+
+    // The record never wraps, so skip the left space at the end if not enough.
+    uint32_t offset = (uint32_t)(tail & (capacity_ - 1));
+    uint32_t skip = (capacity_ - offset < required) ? capacity_ - offset : 0;
+    if (tail + skip + required - head > capacity_) {
+        return false;
+    }
+
+    if (skip) {
+        *(uint32_t*)(data_ + offset) = SRS_WORKER_RING_WRAP;
+        tail += skip;
+        offset = 0;
+    }
+
+    *(uint32_t*)(data_ + offset) = size;
+    char* p = data_ + offset + SRS_WORKER_RING_HEADER;
+    for (int i = 0; i < nn_iovs; i++) {
+        memcpy(p, iovs[i].iov_base, iovs[i].iov_len);
+        p += iovs[i].iov_len;
+    }
+
+    __atomic_store_n(&header_->tail, tail + required, __ATOMIC_RELEASE);
+    return true;
+}
+
+char* SrsWorkerRing::front(int* psize)
+{
+    uint64_t head = __atomic_load_n(&header_->head, __ATOMIC_RELAXED);
+    uint64_t tail = __atomic_load_n(&header_->tail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        uint32_t offset = (uint32_t)(head & (capacity_ - 1));
+        uint32_t size = *(uint32_t*)(data_ + offset);
+
+        // Skip to the start of ring, where is the next record.
+        if (size == SRS_WORKER_RING_WRAP) {
+            head += capacity_ - offset;
+            __atomic_store_n(&header_->head, head, __ATOMIC_RELEASE);
+            continue;
+        }
+
+        *psize = (int)size;
+        return data_ + offset + SRS_WORKER_RING_HEADER;
+    }
+
+    return NULL;
+}
+
+void SrsWorkerRing::pop()
+{
+    uint64_t head = __atomic_load_n(&header_->head, __ATOMIC_RELAXED);
+    uint32_t offset = (uint32_t)(head & (capacity_ - 1));
+    uint32_t size = *(uint32_t*)(data_ + offset);
+
+    head += SRS_WORKER_RING_HEADER + srs_worker_ring_align(size);
+    __atomic_store_n(&header_->head, head, __ATOMIC_RELEASE);
+}
+
+uint64_t SrsWorkerRing::size()
+{
+    uint64_t tail = __atomic_load_n(&header_->tail, __ATOMIC_ACQUIRE);
+    uint64_t head = __atomic_load_n(&header_->head, __ATOMIC_ACQUIRE);
+    return tail - head;
+}
+
+uint32_t SrsWorkerRing::capacity()
+{
+    return capacity_;
+}
+
+uint32_t SrsWorkerRing::memory_size(uint32_t capacity)
+{
+    return sizeof(SrsWorkerRingHeader) + capacity;
+}
+
+SrsWorkerMirror::SrsWorkerMirror()
+{
+    req = NULL;
+    source = NULL;
+}
+
+SrsWorkerMirror::~SrsWorkerMirror()
+{
+    srs_freep(req);
+}
+
+// Write string with 2 bytes length to buffer.
+void srs_worker_write_string(SrsBuffer* b, string v)
+{
+    b->write_2bytes((int16_t)v.length());
+    b->write_string(v);
+}
+
+srs_error_t srs_worker_read_string(SrsBuffer* b, string& v)
+{
+    if (!b->require(2)) {
+        return srs_error_new(ERROR_WORKERS_RECORD, "requires 2 only %d bytes", b->left());
+    }
+
+    int len = (uint16_t)b->read_2bytes();
+    if (!b->require(len)) {
+        return srs_error_new(ERROR_WORKERS_RECORD, "requires %d only %d bytes", len, b->left());
+    }
+
+    v = b->read_string(len);
+    return srs_success;
+}
+
+SrsStreamWorkers* _srs_stream_workers = NULL;
+
+SrsStreamWorkers::SrsStreamWorkers()
+{
+    nn_workers_ = 1;
+    index_ = 0;
+
+    shm_ = NULL;
+    nn_shm_ = 0;
+    slots_ = NULL;
+
+    trd_ = NULL;
+    handler_ = NULL;
+    timer_subscribed_ = false;
+
+    next_id_ = 1;
+    nn_dropped_ = 0;
+}
+
+SrsStreamWorkers::~SrsStreamWorkers()
+{
+    if (timer_subscribed_) {
+        _srs_hybrid->timer1s()->unsubscribe(this);
+    }
+    srs_freep(trd_);
+
+    std::map<uint64_t, SrsWorkerMirror*>::iterator it;
+    for (it = mirrors_.begin(); it != mirrors_.end(); ++it) {
+        SrsWorkerMirror* mirror = it->second;
+        srs_freep(mirror);
+    }
+
+    for (int i = 0; i < (int)rings_.size(); i++) {
+        SrsWorkerRing* ring = rings_.at(i);
+        srs_freep(ring);
+    }
+
+    for (int i = 0; i < (int)notifiers_.size(); i++) {
+        SrsThreadNotifier* notifier = notifiers_.at(i);
+        srs_freep(notifier);
+    }
+
+    if (shm_) {
+        munmap(shm_, nn_shm_);
+    }
+}
+
+srs_error_t SrsStreamWorkers::initialize()
+{
+    srs_error_t err = srs_success;
+
+    if (!_srs_config->get_workers_enabled()) {
+        return err;
+    }
+
+    int nn_workers = _srs_config->get_workers_count();
+    if (nn_workers <= 1) {
+        return err;
+    }
+
+    // Compute in 64 bits, to avoid overflow, and the ring size is limited by config, so it fits in 32 bits.
+    uint64_t ring_size = (uint64_t)_srs_config->get_workers_ring_size() * 1024 * 1024;
+    uint64_t capacity = 1;
+    while (capacity < ring_size) {
+        capacity <<= 1;
+    }
+    if (capacity > 0x80000000ULL) {
+        return srs_error_new(ERROR_WORKERS_MMAP, "ring size %" PRId64 " overflow", ring_size);
+    }
+
+    if ((err = setup(nn_workers, 0, (uint32_t)capacity)) != srs_success) {
+        return srs_error_wrap(err, "setup workers=%d", nn_workers);
+    }
+
+    // Fork workers by master, the forked worker has the index and never forks.
+    int master = getpid();
+    slots_[0].pid = master;
+    for (int i = 1; i < nn_workers; i++) {
+        int pid = fork();
+        if (pid < 0) {
+            return srs_error_new(ERROR_WORKERS_FORK, "fork worker #%d", i);
+        }
+
+        if (pid == 0) {
+            index_ = i;
+            pids_.clear();
+#ifndef SRS_OSX
+            // Quit gracefully when master quit, see https://man7.org/linux/man-pages/man2/prctl.2.html
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+            // The master quit before we set the death signal.
+            if (getppid() != master) {
+                return srs_error_new(ERROR_WORKERS_FORK, "master %d quit", master);
+            }
+            break;
+        }
+
+        pids_.push_back(pid);
+        slots_[i].pid = pid;
+    }
+
+    slots_[index_].pid = getpid();
+    srs_trace("Workers: worker #%d of %d, pid=%d, ring=%dKB, shm=%dKB", index_, nn_workers_, getpid(), (int)(capacity / 1024),
+        (int)(nn_shm_ / 1024));
+
+    return err;
+}
+
+srs_error_t SrsStreamWorkers::setup(int nn_workers, int index, uint32_t ring_capacity)
+{
+    srs_error_t err = srs_success;
+
+    nn_workers_ = nn_workers;
+    index_ = index;
+
+    // The layout is slots of all workers, then the rings.
+    size_t nn_slots = sizeof(SrsWorkerSlot) * nn_workers;
+    size_t nn_ring = SrsWorkerRing::memory_size(ring_capacity);
+    nn_shm_ = nn_slots + nn_ring * nn_workers * (nn_workers - 1);
+
+    // The anonymous shared memory is inherited by the forked workers, and only allocated when touched.
+    char* shm = (char*)mmap(NULL, nn_shm_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shm == MAP_FAILED) {
+        return srs_error_new(ERROR_WORKERS_MMAP, "mmap %d bytes", (int)nn_shm_);
+    }
+    shm_ = shm;
+
+    slots_ = (SrsWorkerSlot*)shm_;
+    char* p = shm_ + nn_slots;
+    for (int i = 0; i < nn_workers; i++) {
+        for (int j = 0; j < nn_workers; j++) {
+            if (i == j) {
+                rings_.push_back(NULL);
+                continue;
+            }
+
+            rings_.push_back(new SrsWorkerRing(p, ring_capacity));
+            p += nn_ring;
+        }
+    }
+
+    // The fds are inherited by the forked workers, and the parked flags are in shared memory.
+    for (int i = 0; i < nn_workers; i++) {
+        SrsThreadNotifier* notifier = new SrsThreadNotifier();
+        notifiers_.push_back(notifier);
+
+        if ((err = notifier->initialize(&slots_[i].parked)) != srs_success) {
+            return srs_error_wrap(err, "notifier of worker #%d", i);
+        }
+    }
+
+    pendings_.resize(nn_workers);
+    resyncs_.resize(nn_workers, false);
+    last_pids_.resize(nn_workers, 0);
+
+    return err;
+}
+
+srs_error_t SrsStreamWorkers::start(ISrsLiveSourceHandler* h)
+{
+    srs_error_t err = srs_success;
+
+    handler_ = h;
+
+    if (!enabled()) {
+        return err;
+    }
+
+    // The ST fd is process-local, so open it after forked.
+    if ((err = notifiers_.at(index_)->open()) != srs_success) {
+        return srs_error_wrap(err, "open notifier");
+    }
+
+    srs_freep(trd_);
+    trd_ = new SrsSTCoroutine("workers", this);
+    if ((err = trd_->start()) != srs_success) {
+        return srs_error_wrap(err, "start workers");
+    }
+
+    if (!timer_subscribed_) {
+        _srs_hybrid->timer1s()->subscribe(this);
+        timer_subscribed_ = true;
+    }
+
+    return err;
+}
+
+bool SrsStreamWorkers::enabled()
+{
+    return nn_workers_ > 1;
+}
+
+bool SrsStreamWorkers::is_master()
+{
+    return index_ == 0;
+}
+
+int SrsStreamWorkers::index()
+{
+    return index_;
+}
+
+int SrsStreamWorkers::count()
+{
+    return nn_workers_;
+}
+
+void SrsStreamWorkers::on_publish(SrsLiveSource* s, SrsRequest* r)
+{
+    if (!enabled() || publishers_.find(s) != publishers_.end()) {
+        return;
+    }
+
+    // The edge pulls stream from origin by itself.
+    if (_srs_config->get_vhost_is_edge(r->vhost)) {
+        return;
+    }
+
+    uint32_t id = next_id_++;
+    publishers_[s] = id;
+
+    int size = 1 + 4 + 4;
+    string fields[] = {r->tcUrl, r->schema, r->host, r->vhost, r->app, r->stream, r->param};
+    for (int i = 0; i < (int)(sizeof(fields) / sizeof(string)); i++) {
+        size += 2 + (int)fields[i].length();
+    }
+
+    char* buf = new char[size];
+    SrsAutoFreeA(char, buf);
+
+    SrsBuffer b(buf, size);
+    b.write_1bytes(SRS_WORKER_RECORD_PUBLISH);
+    b.write_4bytes(id);
+    b.write_4bytes(r->port);
+    for (int i = 0; i < (int)(sizeof(fields) / sizeof(string)); i++) {
+        srs_worker_write_string(&b, fields[i]);
+    }
+
+    iovec iov = {buf, (size_t)size};
+    deliver(&iov, 1, true, false, false);
+
+    srs_trace("Workers: mirror stream %s to workers, id=%u", r->get_stream_url().c_str(), id);
+}
+
+void SrsStreamWorkers::on_unpublish(SrsLiveSource* s)
+{
+    std::map<SrsLiveSource*, uint32_t>::iterator it = publishers_.find(s);
+    if (it == publishers_.end()) {
+        return;
+    }
+
+    uint32_t id = it->second;
+    publishers_.erase(it);
+
+    char buf[5];
+    SrsBuffer b(buf, sizeof(buf));
+    b.write_1bytes(SRS_WORKER_RECORD_UNPUBLISH);
+    b.write_4bytes(id);
+
+    iovec iov = {buf, sizeof(buf)};
+    deliver(&iov, 1, true, false, false);
+}
+
+void SrsStreamWorkers::on_message(SrsLiveSource* s, SrsSharedPtrMessage* msg)
+{
+    std::map<SrsLiveSource*, uint32_t>::iterator it = publishers_.find(s);
+    if (it == publishers_.end()) {
+        return;
+    }
+
+    // The sequence header and metadata are never dropped, or the stream is undecodable.
+    bool is_video = msg->is_video(), control = false, is_keyframe = false;
+    int8_t type = RTMP_MSG_AMF0DataMessage;
+    if (is_video) {
+        type = RTMP_MSG_VideoMessage;
+        control = SrsFlvVideo::sh(msg->payload, msg->size);
+        is_keyframe = SrsFlvVideo::keyframe(msg->payload, msg->size);
+    } else if (msg->is_audio()) {
+        type = RTMP_MSG_AudioMessage;
+        control = SrsFlvAudio::sh(msg->payload, msg->size);
+    } else {
+        control = true;
+    }
+
+    char buf[18];
+    SrsBuffer b(buf, sizeof(buf));
+    b.write_1bytes(SRS_WORKER_RECORD_MESSAGE);
+    b.write_4bytes(it->second);
+    b.write_1bytes(type);
+    b.write_8bytes(msg->timestamp);
+    b.write_4bytes(msg->stream_id);
+
+    iovec iovs[2];
+    iovs[0].iov_base = buf;
+    iovs[0].iov_len = sizeof(buf);
+    iovs[1].iov_base = msg->payload;
+    iovs[1].iov_len = msg->size;
+    deliver(iovs, 2, control, is_video, is_keyframe);
+}
+
+void SrsStreamWorkers::dumps(SrsJsonObject* obj)
+{
+    obj->set("count", SrsJsonAny::integer(nn_workers_));
+    obj->set("index", SrsJsonAny::integer(index_));
+
+    int64_t nn_clients = 0, nn_publishers = 0, send_bytes = 0, recv_bytes = 0, nn_dropped = 0;
+
+    SrsJsonArray* arr = SrsJsonAny::array();
+    obj->set("workers", arr);
+
+    for (int i = 0; i < nn_workers_; i++) {
+        SrsWorkerSlot* slot = &slots_[i];
+
+        SrsJsonObject* worker = SrsJsonAny::object();
+        arr->append(worker);
+
+        worker->set("index", SrsJsonAny::integer(i));
+        worker->set("pid", SrsJsonAny::integer(slot->pid));
+        worker->set("clients", SrsJsonAny::integer(slot->nn_clients));
+        worker->set("streams", SrsJsonAny::integer(slot->nn_streams));
+        worker->set("publishers", SrsJsonAny::integer(slot->nn_publishers));
+        worker->set("mirrors", SrsJsonAny::integer(slot->nn_mirrors));
+        worker->set("send_bytes", SrsJsonAny::integer(slot->send_bytes));
+        worker->set("recv_bytes", SrsJsonAny::integer(slot->recv_bytes));
+        worker->set("dropped", SrsJsonAny::integer(slot->nn_dropped));
+        worker->set("updated_at", SrsJsonAny::integer(slot->updated_at));
+
+        nn_clients += slot->nn_clients;
+        nn_publishers += slot->nn_publishers;
+        send_bytes += slot->send_bytes;
+        recv_bytes += slot->recv_bytes;
+        nn_dropped += slot->nn_dropped;
+    }
+
+    // The streams are mirrored to all workers, so the number of streams is the publishers.
+    obj->set("clients", SrsJsonAny::integer(nn_clients));
+    obj->set("streams", SrsJsonAny::integer(nn_publishers));
+    obj->set("send_bytes", SrsJsonAny::integer(send_bytes));
+    obj->set("recv_bytes", SrsJsonAny::integer(recv_bytes));
+    obj->set("dropped", SrsJsonAny::integer(nn_dropped));
+}
+
+srs_error_t SrsStreamWorkers::cycle()
+{
+    srs_error_t err = srs_success;
+
+    SrsThreadNotifier* notifier = notifiers_.at(index_);
+
+    while (true) {
+        if ((err = trd_->pull()) != srs_success) {
+            return srs_error_wrap(err, "workers");
+        }
+
+        int nn = 0;
+        for (int from = 0; from < nn_workers_; from++) {
+            if (from != index_) {
+                nn += consume(from);
+            }
+        }
+
+        // Let other coroutines run, then consume the records again.
+        if (nn) {
+            srs_thread_yield();
+            continue;
+        }
+
+        // Check again after parked, or lost the notify when pushed before parked.
+        notifier->park();
+
+        if (has_records()) {
+            notifier->unpark();
+            continue;
+        }
+
+        if ((err = notifier->wait(SRS_WORKERS_WAIT_TIMEOUT)) != srs_success) {
+            return srs_error_wrap(err, "wait");
+        }
+    }
+
+    return err;
+}
+
+int SrsStreamWorkers::consume(int from)
+{
+    SrsWorkerRing* ring = rings_.at(from * nn_workers_ + index_);
+
+    int nn = 0;
+    char* data = NULL;
+    int size = 0;
+    while ((data = ring->front(&size)) != NULL) {
+        srs_error_t err = on_record(from, data, size);
+        if (err != srs_success) {
+            srs_warn("Workers: ignore record from worker #%d, err %s", from, srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+
+        ring->pop();
+        nn++;
+    }
+
+    return nn;
+}
+
+bool SrsStreamWorkers::has_records()
+{
+    for (int from = 0; from < nn_workers_; from++) {
+        if (from != index_ && rings_.at(from * nn_workers_ + index_)->size() > 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+srs_error_t SrsStreamWorkers::on_record(int from, char* data, int size)
+{
+    srs_error_t err = srs_success;
+
+    SrsBuffer b(data, size);
+    if (!b.require(5)) {
+        return srs_error_new(ERROR_WORKERS_RECORD, "requires 5 only %d bytes", size);
+    }
+
+    int8_t kind = b.read_1bytes();
+    uint32_t id = (uint32_t)b.read_4bytes();
+
+    if (kind == SRS_WORKER_RECORD_MESSAGE) {
+        return on_mirror_message(from, id, data + b.pos(), b.left());
+    }
+
+    if (kind == SRS_WORKER_RECORD_UNPUBLISH) {
+        on_mirror_unpublish(from, id);
+        return err;
+    }
+
+    if (kind != SRS_WORKER_RECORD_PUBLISH) {
+        return srs_error_new(ERROR_WORKERS_RECORD, "invalid kind %d", kind);
+    }
+
+    if (!b.require(4)) {
+        return srs_error_new(ERROR_WORKERS_RECORD, "requires 4 only %d bytes", b.left());
+    }
+
+    SrsRequest* r = new SrsRequest();
+    SrsAutoFree(SrsRequest, r);
+
+    r->port = b.read_4bytes();
+    string* fields[] = {&r->tcUrl, &r->schema, &r->host, &r->vhost, &r->app, &r->stream, &r->param};
+    for (int i = 0; i < (int)(sizeof(fields) / sizeof(string*)); i++) {
+        if ((err = srs_worker_read_string(&b, *fields[i])) != srs_success) {
+            return srs_error_wrap(err, "read field %d", i);
+        }
+    }
+
+    if ((err = on_mirror_publish(from, id, r)) != srs_success) {
+        return srs_error_wrap(err, "mirror %s", r->get_stream_url().c_str());
+    }
+
+    return err;
+}
+
+srs_error_t SrsStreamWorkers::on_mirror_publish(int from, uint32_t id, SrsRequest* r)
+{
+    srs_error_t err = srs_success;
+
+    // Unpublish the stale mirror, for the unpublish record might be lost when worker restarted.
+    on_mirror_unpublish(from, id);
+
+    if (_srs_config->get_vhost_is_edge(r->vhost)) {
+        return err;
+    }
+
+    SrsLiveSource* source = NULL;
+    if ((err = _srs_sources->fetch_or_create(r, handler_, &source)) != srs_success) {
+        return srs_error_wrap(err, "create source");
+    }
+
+    // The stream is published on both workers, the local publisher wins.
+    if (!source->can_publish(false)) {
+        srs_warn("Workers: ignore stream %s from worker #%d, for it's busy", r->get_stream_url().c_str(), from);
+        return err;
+    }
+
+    // Bridge the mirrored stream to RTC and SRT, which are only served by master worker.
+    SrsCompositeBridge* bridges = new SrsCompositeBridge();
+    SrsAutoFree(SrsCompositeBridge, bridges);
+
+    if ((err = bridges->initialize(r, true, true)) != srs_success) {
+        return srs_error_wrap(err, "bridge init");
+    }
+
+    if (!bridges->empty()) {
+        source->set_bridge(bridges);
+        bridges = NULL;
+    }
+
+    source->set_mirror(true);
+    if ((err = source->on_publish()) != srs_success) {
+        source->set_mirror(false);
+        return srs_error_wrap(err, "publish");
+    }
+
+    SrsWorkerMirror* mirror = new SrsWorkerMirror();
+    mirror->req = r->copy();
+    mirror->source = source;
+    mirrors_[((uint64_t)from << 32) | id] = mirror;
+
+    srs_trace("Workers: mirror stream %s from worker #%d, id=%u", r->get_stream_url().c_str(), from, id);
+
+    return err;
+}
+
+void SrsStreamWorkers::on_mirror_unpublish(int from, uint32_t id)
+{
+    std::map<uint64_t, SrsWorkerMirror*>::iterator it = mirrors_.find(((uint64_t)from << 32) | id);
+    if (it == mirrors_.end()) {
+        return;
+    }
+
+    SrsWorkerMirror* mirror = it->second;
+    mirrors_.erase(it);
+    SrsAutoFree(SrsWorkerMirror, mirror);
+
+    mirror->source->on_unpublish();
+    mirror->source->set_mirror(false);
+
+    srs_trace("Workers: unmirror stream %s from worker #%d, id=%u", mirror->req->get_stream_url().c_str(), from, id);
+}
+
+srs_error_t SrsStreamWorkers::on_mirror_message(int from, uint32_t id, char* data, int size)
+{
+    srs_error_t err = srs_success;
+
+    std::map<uint64_t, SrsWorkerMirror*>::iterator it = mirrors_.find(((uint64_t)from << 32) | id);
+    if (it == mirrors_.end()) {
+        return err;
+    }
+
+    SrsLiveSource* source = it->second->source;
+
+    SrsBuffer b(data, size);
+    if (!b.require(13)) {
+        return srs_error_new(ERROR_WORKERS_RECORD, "requires 13 only %d bytes", size);
+    }
+
+    SrsCommonMessage msg;
+    msg.header.message_type = b.read_1bytes();
+    msg.header.timestamp = b.read_8bytes();
+    msg.header.stream_id = b.read_4bytes();
+    msg.header.payload_length = b.left();
+
+    msg.create_payload(b.left());
+    msg.size = b.left();
+    memcpy(msg.payload, data + b.pos(), b.left());
+
+    if (msg.header.is_audio()) {
+        return source->on_audio(&msg);
+    }
+
+    if (msg.header.is_video()) {
+        return source->on_video(&msg);
+    }
+
+    SrsOnMetaDataPacket* metadata = new SrsOnMetaDataPacket();
+    SrsAutoFree(SrsOnMetaDataPacket, metadata);
+
+    SrsBuffer stream(msg.payload, msg.size);
+    if ((err = metadata->decode(&stream)) != srs_success) {
+        return srs_error_wrap(err, "decode metadata");
+    }
+
+    return source->on_meta_data(&msg, metadata);
+}
+
+void SrsStreamWorkers::deliver(const iovec* iovs, int nn_iovs, bool control, bool is_video, bool is_keyframe)
+{
+    for (int to = 0; to < nn_workers_; to++) {
+        if (to == index_ || slots_[to].pid == 0) {
+            continue;
+        }
+
+        // Keep the records in order, so drop the message if the control records are not flushed.
+        SrsWorkerRing* ring = rings_.at(index_ * nn_workers_ + to);
+        bool flushed = flush(to);
+
+        if (control) {
+            if (!flushed || !ring->push(iovs, nn_iovs)) {
+                string record;
+                for (int i = 0; i < nn_iovs; i++) {
+                    record.append((char*)iovs[i].iov_base, iovs[i].iov_len);
+                }
+                pendings_[to].push_back(record);
+            } else {
+                notifiers_.at(to)->notify();
+            }
+            continue;
+        }
+
+        // After dropped, the video is undecodable until the next keyframe.
+        if (is_video && resyncs_[to] && !is_keyframe) {
+            nn_dropped_++;
+            continue;
+        }
+
+        if (!flushed || !ring->push(iovs, nn_iovs)) {
+            nn_dropped_++;
+            resyncs_[to] = resyncs_[to] || is_video;
+            continue;
+        }
+        notifiers_.at(to)->notify();
+
+        if (is_video) {
+            resyncs_[to] = false;
+        }
+    }
+}
+
+bool SrsStreamWorkers::flush(int to)
+{
+    SrsWorkerRing* ring = rings_.at(index_ * nn_workers_ + to);
+
+    vector<string>& pendings = pendings_[to];
+    while (!pendings.empty()) {
+        string& record = pendings.front();
+
+        iovec iov = {(void*)record.data(), record.length()};
+        if (!ring->push(&iov, 1)) {
+            return false;
+        }
+        notifiers_.at(to)->notify();
+
+        pendings.erase(pendings.begin());
+    }
+
+    return true;
+}
+
+void SrsStreamWorkers::cleanup(int from)
+{
+    vector<uint32_t> ids;
+
+    std::map<uint64_t, SrsWorkerMirror*>::iterator it;
+    for (it = mirrors_.begin(); it != mirrors_.end(); ++it) {
+        if ((int)(it->first >> 32) == from) {
+            ids.push_back((uint32_t)it->first);
+        }
+    }
+
+    for (int i = 0; i < (int)ids.size(); i++) {
+        on_mirror_unpublish(from, ids.at(i));
+    }
+
+    pendings_[from].clear();
+    resyncs_[from] = false;
+}
+
+srs_error_t SrsStreamWorkers::on_timer(srs_utime_t interval)
+{
+    srs_error_t err = srs_success;
+
+    // Update the statistic of this worker, for master to aggregate.
+    int64_t send_bytes = 0, recv_bytes = 0, nn_streams = 0, nn_clients = 0, nn_total_clients = 0, nn_errs = 0;
+    SrsStatistic::instance()->dumps_metrics(send_bytes, recv_bytes, nn_streams, nn_clients, nn_total_clients, nn_errs);
+
+    SrsWorkerSlot* slot = &slots_[index_];
+    slot->nn_clients = (int32_t)nn_clients;
+    slot->nn_streams = (int32_t)nn_streams;
+    slot->nn_publishers = (int32_t)publishers_.size();
+    slot->nn_mirrors = (int32_t)mirrors_.size();
+    slot->send_bytes = send_bytes;
+    slot->recv_bytes = recv_bytes;
+    slot->nn_dropped = nn_dropped_;
+    slot->updated_at = srsu2ms(srs_get_system_time());
+
+    // Reap the quit workers by master, see https://man7.org/linux/man-pages/man2/waitpid.2.html
+    for (int i = 0; i < (int)pids_.size(); i++) {
+        int status = 0;
+        if (pids_.at(i) > 0 && waitpid(pids_.at(i), &status, WNOHANG) == pids_.at(i)) {
+            srs_error("Workers: worker pid=%d quit, status=%d", pids_.at(i), status);
+            pids_[i] = 0;
+        }
+    }
+
+    // Cleanup the mirrors of the quit workers, which never unpublish them. The pid in slot is reset by the worker
+    // which detects it first, so each worker compares to the pid it last saw.
+    for (int i = 0; i < nn_workers_; i++) {
+        int pid = slots_[i].pid;
+        if (i == index_) {
+            continue;
+        }
+
+        if (pid > 0 && kill(pid, 0) != 0 && errno == ESRCH) {
+            slots_[i].pid = pid = 0;
+        }
+
+        int last = last_pids_[i];
+        if (pid == last) {
+            continue;
+        }
+        last_pids_[i] = pid;
+
+        // The worker is started, never seen before.
+        if (last <= 0) {
+            continue;
+        }
+
+        srs_warn("Workers: cleanup mirrors of worker #%d, pid=%d", i, last);
+        cleanup(i);
+    }
+
+    // Retry the control records, which are pending for ring is full.
+    for (int to = 0; to < nn_workers_; to++) {
+        if (to != index_ && slots_[to].pid) {
+            flush(to);
+        }
+    }
+
+    return err;
+}
+
@@ -0,0 +1,182 @@
+//
+// Copyright (c) 2013-2024 The SRS Authors
+//
+// SPDX-License-Identifier: MIT or MulanPSL-2.0
+//
+
+#ifndef SRS_APP_WORKERS_HPP
+#define SRS_APP_WORKERS_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <sys/uio.h>
+
+#include <srs_app_st.hpp>
+#include <srs_app_hourglass.hpp>
+
+class SrsLiveSource;
+class SrsRequest;
+class SrsSharedPtrMessage;
+class SrsJsonObject;
+class ISrsLiveSourceHandler;
+class SrsThreadNotifier;
+
+// The position of ring, the head is updated by consumer, and the tail by producer, in different cache lines.
+struct SrsWorkerRingHeader
+{
+    uint64_t head;
+    char pad0[56];
+    uint64_t tail;
+    char pad1[56];
+};
+
+// The lock-free ring of records in shared memory, to pass messages from a worker process to another. It's only
+// safe when there is exactly one producer worker to push and one consumer worker to pop.
+// @remark The memory is owned by user, which should be mapped as shared before forking workers.
+class SrsWorkerRing
+{
+private:
+    SrsWorkerRingHeader* header_;
+    char* data_;
+    uint32_t capacity_;
+public:
+    // The capacity MUST be power of 2, and the memory MUST be at least memory_size(capacity) bytes.
+    SrsWorkerRing(char* mem, uint32_t capacity);
+    virtual ~SrsWorkerRing();
+public:
+    // Push a record which is gathered from iovs, return false if no space. Only for the producer worker.
+    bool push(const iovec* iovs, int nn_iovs);
+    // Get the record at head, return NULL if empty. Only for the consumer worker.
+    char* front(int* psize);
+    // Remove the record at head, after front. Only for the consumer worker.
+    void pop();
+    // The bytes in ring, which is approximate for any worker.
+    uint64_t size();
+    uint32_t capacity();
+public:
+    // The bytes of memory required by ring of capacity.
+    static uint32_t memory_size(uint32_t capacity);
+};
+
+// The statistic of worker in shared memory, updated by the worker itself, and aggregated by master.
+struct SrsWorkerSlot
+{
+    int32_t pid;
+    int32_t nn_clients;
+    int32_t nn_streams;
+    int32_t nn_publishers;
+    int32_t nn_mirrors;
+    // Whether the worker is parked, to wait for records from other workers.
+    int32_t parked;
+    int64_t send_bytes;
+    int64_t recv_bytes;
+    int64_t nn_dropped;
+    // The last time in ms the slot is updated.
+    int64_t updated_at;
+    char pad[8];
+};
+
+// The stream mirrored from another worker.
+class SrsWorkerMirror
+{
+public:
+    SrsRequest* req;
+    SrsLiveSource* source;
+public:
+    SrsWorkerMirror();
+    virtual ~SrsWorkerMirror();
+};
+
+// The workers to serve RTMP and HTTP-FLV by multiple processes, each worker listens on the same ports by
+// SO_REUSEPORT, and has its own ST scheduler and live sources. The stream published to a worker is mirrored
+// to other workers by rings in shared memory, so that players on any worker can play it.
+class SrsStreamWorkers : public ISrsCoroutineHandler, public ISrsFastTimer
+{
+private:
+    // The number of workers, and the index of current worker, 0 is the master worker.
+    int nn_workers_;
+    int index_;
+    // The pids of workers, forked by master.
+    std::vector<int> pids_;
+private:
+    // The shared memory for slots and rings.
+    char* shm_;
+    size_t nn_shm_;
+    SrsWorkerSlot* slots_;
+    // The rings from a worker to another, the ring of worker i to j is at i * nn_workers_ + j.
+    std::vector<SrsWorkerRing*> rings_;
+    // The notifiers to wakeup the parked workers, created before fork, the notifier of worker i is at i.
+    std::vector<SrsThreadNotifier*> notifiers_;
+private:
+    SrsCoroutine* trd_;
+    ISrsLiveSourceHandler* handler_;
+    bool timer_subscribed_;
+private:
+    // The streams published on this worker, the value is the id of stream in rings.
+    std::map<SrsLiveSource*, uint32_t> publishers_;
+    uint32_t next_id_;
+    // The control records failed to push for ring is full, by the target worker, to retry in order.
+    std::vector< std::vector<std::string> > pendings_;
+    // Whether drop the messages until the next keyframe, by the target worker, for ring was full.
+    std::vector<bool> resyncs_;
+    int64_t nn_dropped_;
+    // The pids of workers last seen by this worker, to detect the quit worker, even if the pid in slot is reset by
+    // another worker which detected it first.
+    std::vector<int> last_pids_;
+private:
+    // The streams mirrored from other workers, the key is the worker index and id of stream.
+    std::map<uint64_t, SrsWorkerMirror*> mirrors_;
+public:
+    SrsStreamWorkers();
+    virtual ~SrsStreamWorkers();
+public:
+    // Fork the workers if enabled, the current process becomes the master worker.
+    // @remark MUST call before starting any thread, because fork only clones the calling thread.
+    srs_error_t initialize();
+    // Map the shared memory of slots and rings for workers.
+    srs_error_t setup(int nn_workers, int index, uint32_t ring_capacity);
+    // Start to mirror the streams from other workers.
+    srs_error_t start(ISrsLiveSourceHandler* h);
+public:
+    bool enabled();
+    bool is_master();
+    int index();
+    int count();
+public:
+    // For the streams published on this worker, to mirror to other workers.
+    void on_publish(SrsLiveSource* s, SrsRequest* r);
+    void on_unpublish(SrsLiveSource* s);
+    void on_message(SrsLiveSource* s, SrsSharedPtrMessage* msg);
+public:
+    // Dumps the statistic of all workers, only the summaries in slots, the streams and clients are per worker.
+    void dumps(SrsJsonObject* obj);
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+private:
+    // Consume the records from worker, return the number of records.
+    int consume(int from);
+    // Whether there are records from any other worker.
+    bool has_records();
+    srs_error_t on_record(int from, char* data, int size);
+    srs_error_t on_mirror_publish(int from, uint32_t id, SrsRequest* r);
+    void on_mirror_unpublish(int from, uint32_t id);
+    srs_error_t on_mirror_message(int from, uint32_t id, char* data, int size);
+    // Push the record to all other workers, the control record such as sequence header is never dropped.
+    void deliver(const iovec* iovs, int nn_iovs, bool control, bool is_video, bool is_keyframe);
+    bool flush(int to);
+    // Unpublish the mirrors of the dead worker.
+    void cleanup(int from);
+// Interface ISrsFastTimer
+private:
+    srs_error_t on_timer(srs_utime_t interval);
+};
+
+extern SrsStreamWorkers* _srs_stream_workers;
+
+#endif
+
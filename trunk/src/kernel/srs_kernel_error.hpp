@@ -107,6 +107,11 @@
     XX(ERROR_BACKTRACE_ADDR2LINE           , 1094, "BacktraceAddr2Line", "Backtrace addr2line failed") \
     XX(ERROR_SYSTEM_FILE_NOT_OPEN          , 1095, "FileNotOpen", "File is not opened") \
     XX(ERROR_SYSTEM_FILE_SETVBUF           , 1096, "FileSetVBuf", "Failed to set file vbuf") \
+    XX(ERROR_THREAD_AFFINITY               , 1097, "ThreadAffinity", "Invalid or failed to set CPU affinity of thread") \
+    XX(ERROR_WORKERS_MMAP                  , 1098, "WorkersMmap", "Failed to map shared memory for workers") \
+    XX(ERROR_WORKERS_FORK                  , 1099, "WorkersFork", "Failed to fork worker process") \
+    XX(ERROR_WORKERS_RECORD                , 1100, "WorkersRecord", "Invalid record in ring of workers") \
+    XX(ERROR_THREAD_CHANNEL                , 1101, "ThreadChannel", "Failed to create or wait on thread channel") \
 
 /**************************************************/
 /* RTMP protocol error. */
@@ -381,7 +386,8 @@
     XX(ERROR_SRT_SOURCE_BUSY               , 6007, "SrtStreamBusy", "SRT stream already exists or busy") \
     XX(ERROR_RTMP_TO_SRT                   , 6008, "SrtFromRtmp", "Covert RTMP to SRT failed") \
     XX(ERROR_SRT_STATS                     , 6009, "SrtStats", "SRT get statistic data failed") \
-    XX(ERROR_SRT_TO_RTMP_EMPTY_SPS_PPS     , 6010, "SrtToRtmpEmptySpsPps", "SRT to rtmp have empty sps or pps")
+    XX(ERROR_SRT_TO_RTMP_EMPTY_SPS_PPS     , 6010, "SrtToRtmpEmptySpsPps", "SRT to rtmp have empty sps or pps") \
+    XX(ERROR_SRT_SLOW_READER               , 6011, "SrtSlowReader", "SRT player is too slow to consume packets")
 
 /**************************************************/
 /* For user-define error. */
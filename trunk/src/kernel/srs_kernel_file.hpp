@@ -99,6 +99,8 @@ public:
 public:
     // TODO: FIXME: extract interface.
     virtual bool is_open();
+    // Get the fd of file, for example, to sendfile, -1 if not opened or not a real file.
+    virtual int get_fd();
     virtual int64_t tellg();
     virtual void skip(int64_t size);
     virtual int64_t seek2(int64_t offset);
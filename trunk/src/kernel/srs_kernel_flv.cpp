@@ -8,6 +8,7 @@
 
 // for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
+#include <stdlib.h>
 #include <unistd.h>
 #endif
 
@@ -28,6 +29,145 @@ using namespace std;
 
 SrsPps* _srs_pps_objs_msgs = NULL;
 
+// The header of block, to find the size class when free it.
+#define SRS_POOL_HEADER 16
+#define SRS_POOL_MAGIC 0x5352534d
+// The min size of block, and the max bytes of free list for each size class.
+#define SRS_POOL_MIN_SHIFT 6
+#define SRS_POOL_CACHE_BYTES (2 * 1024 * 1024)
+
+// The pools of threads, for stat only.
+static SrsMemoryPool* _srs_pools[SRS_POOL_MAX_THREADS];
+static int _srs_nn_pools = 0;
+
+SrsMemoryPool::SrsMemoryPool()
+{
+    for (int i = 0; i < SRS_POOL_CLASSES; i++) {
+        free_lists_[i] = NULL;
+        nn_frees_[i] = 0;
+        max_frees_[i] = SRS_POOL_CACHE_BYTES >> (SRS_POOL_MIN_SHIFT + i);
+    }
+
+    hits = misses = 0;
+    recycled = dropped = 0;
+    cached_bytes = 0;
+}
+
+SrsMemoryPool::~SrsMemoryPool()
+{
+    for (int i = 0; i < SRS_POOL_CLASSES; i++) {
+        while (free_lists_[i]) {
+            char* block = free_lists_[i];
+            free_lists_[i] = *(char**)(block + SRS_POOL_HEADER);
+            ::free(block);
+        }
+    }
+}
+
+SrsMemoryPool* SrsMemoryPool::instance()
+{
+    static __thread SrsMemoryPool* pool = NULL;
+    if (pool) {
+        return pool;
+    }
+
+    pool = new SrsMemoryPool();
+
+    // Register the pool for stat, ignore if too many threads.
+    int index = __atomic_fetch_add(&_srs_nn_pools, 1, __ATOMIC_RELAXED);
+    if (index < SRS_POOL_MAX_THREADS) {
+        __atomic_store_n(&_srs_pools[index], pool, __ATOMIC_RELEASE);
+    }
+
+    return pool;
+}
+
+void SrsMemoryPool::summary(uint64_t& hits, uint64_t& misses, uint64_t& recycled, uint64_t& dropped, int64_t& cached_bytes)
+{
+    hits = misses = recycled = dropped = 0;
+    cached_bytes = 0;
+
+    int nn = srs_min(__atomic_load_n(&_srs_nn_pools, __ATOMIC_RELAXED), SRS_POOL_MAX_THREADS);
+    for (int i = 0; i < nn; i++) {
+        SrsMemoryPool* pool = __atomic_load_n(&_srs_pools[i], __ATOMIC_ACQUIRE);
+        if (!pool) continue;
+
+        hits += pool->hits;
+        misses += pool->misses;
+        recycled += pool->recycled;
+        dropped += pool->dropped;
+        cached_bytes += pool->cached_bytes;
+    }
+}
+
+char* SrsMemoryPool::alloc(int size)
+{
+    // Find the size class of block.
+    int klass = 0;
+    while (klass < SRS_POOL_CLASSES && (1 << (SRS_POOL_MIN_SHIFT + klass)) < size) {
+        klass++;
+    }
+
+    char* block = NULL;
+    if (klass < SRS_POOL_CLASSES && free_lists_[klass]) {
+        block = free_lists_[klass];
+        free_lists_[klass] = *(char**)(block + SRS_POOL_HEADER);
+        nn_frees_[klass]--;
+        cached_bytes -= 1 << (SRS_POOL_MIN_SHIFT + klass);
+        hits++;
+    } else {
+        // For large block, never cache it.
+        int nb_block = size;
+        if (klass < SRS_POOL_CLASSES) {
+            nb_block = 1 << (SRS_POOL_MIN_SHIFT + klass);
+        } else {
+            klass = -1;
+        }
+
+        block = (char*)::malloc(SRS_POOL_HEADER + nb_block);
+        srs_assert(block);
+        misses++;
+    }
+
+    int32_t* header = (int32_t*)block;
+    header[0] = klass;
+    header[1] = SRS_POOL_MAGIC;
+
+    return block + SRS_POOL_HEADER;
+}
+
+void SrsMemoryPool::dealloc(void* p)
+{
+    if (!p) return;
+
+    char* block = (char*)p - SRS_POOL_HEADER;
+    int32_t* header = (int32_t*)block;
+    srs_assert(header[1] == SRS_POOL_MAGIC);
+
+    int klass = header[0];
+    if (klass < 0 || nn_frees_[klass] >= max_frees_[klass]) {
+        if (klass >= 0) dropped++;
+        ::free(block);
+        return;
+    }
+
+    *(char**)(block + SRS_POOL_HEADER) = free_lists_[klass];
+    free_lists_[klass] = block;
+    nn_frees_[klass]++;
+    cached_bytes += 1 << (SRS_POOL_MIN_SHIFT + klass);
+    recycled++;
+}
+
+char* srs_pool_alloc(int size)
+{
+    return SrsMemoryPool::instance()->alloc(size);
+}
+
+void srs_pool_free(void* p)
+{
+    SrsMemoryPool::instance()->dealloc(p);
+}
+
 SrsMessageHeader::SrsMessageHeader()
 {
     message_type = 0;
@@ -36,6 +176,7 @@ SrsMessageHeader::SrsMessageHeader()
     stream_id = 0;
     
     timestamp = 0;
+    recv_time = 0;
     // we always use the connection chunk-id
     perfer_cid = RTMP_CID_OverConnection;
 }
@@ -144,25 +285,40 @@ SrsCommonMessage::SrsCommonMessage()
 {
     payload = NULL;
     size = 0;
+    pooled_ = false;
 }
 
 SrsCommonMessage::~SrsCommonMessage()
 {
-    srs_freepa(payload);
+    if (pooled_) {
+        srs_pool_free(payload);
+    } else {
+        srs_freepa(payload);
+    }
 }
 
 void SrsCommonMessage::create_payload(int size)
 {
-    srs_freepa(payload);
+    if (pooled_) {
+        srs_pool_free(payload);
+    } else {
+        srs_freepa(payload);
+    }
     
-    payload = new char[size];
+    payload = srs_pool_alloc(size);
+    pooled_ = true;
     srs_verbose("create payload for RTMP message. size=%d", size);
 }
 
 srs_error_t SrsCommonMessage::create(SrsMessageHeader* pheader, char* body, int size)
 {
     // drop previous payload.
-    srs_freepa(payload);
+    if (pooled_) {
+        srs_pool_free(payload);
+    } else {
+        srs_freepa(payload);
+    }
+    pooled_ = false;
     
     this->header = *pheader;
     this->payload = body;
@@ -187,20 +343,35 @@ SrsSharedPtrMessage::SrsSharedPtrPayload::SrsSharedPtrPayload()
     payload = NULL;
     size = 0;
     shared_count = 0;
+    pooled = false;
 }
 
 SrsSharedPtrMessage::SrsSharedPtrPayload::~SrsSharedPtrPayload()
 {
-    srs_freepa(payload);
+    if (pooled) {
+        srs_pool_free(payload);
+    } else {
+        srs_freepa(payload);
+    }
 }
 
-SrsSharedPtrMessage::SrsSharedPtrMessage() : timestamp(0), stream_id(0), size(0), payload(NULL)
+SrsSharedPtrMessage::SrsSharedPtrMessage() : timestamp(0), stream_id(0), recv_time(0), size(0), payload(NULL)
 {
     ptr = NULL;
 
     ++ _srs_pps_objs_msgs->sugar;
 }
 
+void* SrsSharedPtrMessage::operator new(size_t size)
+{
+    return srs_pool_alloc((int)size);
+}
+
+void SrsSharedPtrMessage::operator delete(void* p)
+{
+    srs_pool_free(p);
+}
+
 SrsSharedPtrMessage::~SrsSharedPtrMessage()
 {
     if (ptr) {
@@ -219,12 +390,14 @@ srs_error_t SrsSharedPtrMessage::create(SrsCommonMessage* msg)
     if ((err = create(&msg->header, msg->payload, msg->size)) != srs_success) {
         return srs_error_wrap(err, "create message");
     }
+    ptr->pooled = msg->pooled_;
     
     // to prevent double free of payload:
     // initialize already attach the payload of msg,
     // detach the payload to transfer the owner to shared ptr.
     msg->payload = NULL;
     msg->size = 0;
+    msg->pooled_ = false;
     
     return err;
 }
@@ -247,6 +420,7 @@ srs_error_t SrsSharedPtrMessage::create(SrsMessageHeader* pheader, char* payload
         ptr->header.perfer_cid = pheader->perfer_cid;
         this->timestamp = pheader->timestamp;
         this->stream_id = pheader->stream_id;
+        this->recv_time = pheader->recv_time;
     }
     ptr->payload = payload;
     ptr->size = size;
@@ -270,6 +444,12 @@ void SrsSharedPtrMessage::wrap(char* payload, int size)
     this->size = ptr->size;
 }
 
+void SrsSharedPtrMessage::wrap(int size)
+{
+    wrap(srs_pool_alloc(size), size);
+    ptr->pooled = true;
+}
+
 int SrsSharedPtrMessage::count()
 {
     return ptr? ptr->shared_count : 0;
@@ -333,6 +513,7 @@ SrsSharedPtrMessage* SrsSharedPtrMessage::copy()
     
     copy->timestamp = timestamp;
     copy->stream_id = stream_id;
+    copy->recv_time = recv_time;
 
     return copy;
 }
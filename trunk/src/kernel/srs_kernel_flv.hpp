@@ -152,6 +152,8 @@ public:
     // @remark, used as calc timestamp when decode and encode time.
     // @remark, we use 64bits for large time for jitter detect and hls.
     int64_t timestamp;
+    // The time when server received the message, 0 if unknown, to stat the residence time in server.
+    srs_utime_t recv_time;
 public:
     // Get the perfered cid(chunk stream id) which sendout over.
     // set at decoding, and canbe used for directly send message,
@@ -182,6 +184,50 @@ public:
     void initialize_video(int size, uint32_t time, int stream);
 };
 
+// The number of size classes of memory pool, from 64B to 64KB, and larger block is allocated by malloc.
+#define SRS_POOL_CLASSES 11
+// The max number of threads to stat the memory pools.
+#define SRS_POOL_MAX_THREADS 256
+
+// The per-thread slab allocator by size classes, which caches the freed blocks in free lists, for
+// the small and short-lived media payloads and wrappers, such as RTMP messages and RTP packets.
+// @remark The block is freed to the pool of current thread, which might not be the allocator.
+class SrsMemoryPool
+{
+private:
+    // The free list and number of cached blocks of each size class.
+    char* free_lists_[SRS_POOL_CLASSES];
+    int nn_frees_[SRS_POOL_CLASSES];
+    // The max number of cached blocks, others are freed to system.
+    int max_frees_[SRS_POOL_CLASSES];
+public:
+    // The number of blocks allocated from free list, or from system.
+    uint64_t hits;
+    uint64_t misses;
+    // The number of blocks freed to free list, or dropped because free list is full.
+    uint64_t recycled;
+    uint64_t dropped;
+    // The bytes of blocks in free lists.
+    int64_t cached_bytes;
+private:
+    SrsMemoryPool();
+    virtual ~SrsMemoryPool();
+public:
+    // Get the pool of current thread, create it if not exists.
+    static SrsMemoryPool* instance();
+    // Summarize the stat of pools of all threads, which is approximate.
+    static void summary(uint64_t& hits, uint64_t& misses, uint64_t& recycled, uint64_t& dropped, int64_t& cached_bytes);
+public:
+    // Allocate a block which is larger or equals to size.
+    char* alloc(int size);
+    // Free the block, which must be allocated by pool.
+    void dealloc(void* p);
+};
+
+// Allocate or free the block by the pool of current thread.
+extern char* srs_pool_alloc(int size);
+extern void srs_pool_free(void* p);
+
 // The message is raw data RTMP message, bytes oriented,
 // protcol always recv RTMP message, and can send RTMP message or RTMP packet.
 // The common message is read from underlay protocol sdk.
@@ -202,6 +248,10 @@ public:
     // @remark, not all message payload can be decoded to packet. for example,
     //       video/audio packet use raw bytes, no video/audio packet.
     char* payload;
+private:
+    // Whether the payload is allocated from pool, by create_payload.
+    bool pooled_;
+    friend class SrsSharedPtrMessage;
 public:
     SrsCommonMessage();
     virtual ~SrsCommonMessage();
@@ -260,6 +310,8 @@ public:
     // Four-byte field that identifies the stream of the message. These
     // bytes are set in big-endian format.
     int32_t stream_id;
+    // The time when server received the message, 0 if unknown or cached, to stat the residence time in server.
+    srs_utime_t recv_time;
     // 4.2. Message Payload
 public:
     // The current message parsed size,
@@ -284,6 +336,8 @@ private:
         int size;
         // The reference count
         int shared_count;
+        // Whether the payload is allocated from pool.
+        bool pooled;
     public:
         SrsSharedPtrPayload();
         virtual ~SrsSharedPtrPayload();
@@ -292,6 +346,10 @@ private:
 public:
     SrsSharedPtrMessage();
     virtual ~SrsSharedPtrMessage();
+public:
+    // The message is allocated by pool, for it's created for each consumer.
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
 public:
     // Create shared ptr message,
     // copy header, manage the payload of msg,
@@ -307,6 +365,9 @@ public:
     // Create shared ptr message from RAW payload.
     // @remark Note that the header is set to zero.
     virtual void wrap(char* payload, int size);
+    // Create shared ptr message with RAW payload of size, allocated from pool.
+    // @remark Note that the header is set to zero.
+    virtual void wrap(int size);
     // Get current reference count.
     // when this object created, count set to 0.
     // if copy() this object, count increase 1.
@@ -6,6 +6,8 @@
 
 #include <srs_kernel_kbps.hpp>
 
+#include <string.h>
+
 #include <srs_kernel_utility.hpp>
 #include <srs_kernel_error.hpp>
 
@@ -97,6 +99,114 @@ int SrsPps::r30s()
     return sample_30s_.rate;
 }
 
+// Get the bucket index of value v, which is linear for small values, then 8 sub-buckets for
+// each power of two.
+int srs_histogram_index(int64_t v)
+{
+    if (v < (1 << SRS_HISTOGRAM_SUB_BITS)) {
+        return (int)v;
+    }
+
+    int msb = 63 - __builtin_clzll((uint64_t)v);
+    int shift = msb - SRS_HISTOGRAM_SUB_BITS;
+    int sub = (int)(v >> shift) & ((1 << SRS_HISTOGRAM_SUB_BITS) - 1);
+    return ((shift + 1) << SRS_HISTOGRAM_SUB_BITS) + sub;
+}
+
+// Get the max value of bucket at index.
+int64_t srs_histogram_upper(int index)
+{
+    if (index < (1 << SRS_HISTOGRAM_SUB_BITS)) {
+        return index;
+    }
+
+    int shift = (index >> SRS_HISTOGRAM_SUB_BITS) - 1;
+    int64_t sub = (1 << SRS_HISTOGRAM_SUB_BITS) + (index & ((1 << SRS_HISTOGRAM_SUB_BITS) - 1));
+    return ((sub + 1) << shift) - 1;
+}
+
+SrsHistogram::SrsHistogram()
+{
+    clear();
+}
+
+SrsHistogram::~SrsHistogram()
+{
+}
+
+void SrsHistogram::record(int64_t v)
+{
+    v = srs_min(srs_max(v, 0), (1LL << SRS_HISTOGRAM_MAX_BITS) - 1);
+
+    counts_[srs_histogram_index(v)]++;
+    min_ = count_ ? srs_min(min_, v) : v;
+    max_ = srs_max(max_, v);
+    sum_ += v;
+    count_++;
+}
+
+void SrsHistogram::merge(SrsHistogram* h)
+{
+    if (!h->count_) {
+        return;
+    }
+
+    for (int i = 0; i < SRS_HISTOGRAM_BUCKETS; i++) {
+        counts_[i] += h->counts_[i];
+    }
+    min_ = count_ ? srs_min(min_, h->min_) : h->min_;
+    max_ = srs_max(max_, h->max_);
+    sum_ += h->sum_;
+    count_ += h->count_;
+}
+
+void SrsHistogram::clear()
+{
+    memset(counts_, 0, sizeof(counts_));
+    count_ = sum_ = min_ = max_ = 0;
+}
+
+int64_t SrsHistogram::count()
+{
+    return count_;
+}
+
+int64_t SrsHistogram::sum()
+{
+    return sum_;
+}
+
+int64_t SrsHistogram::min()
+{
+    return min_;
+}
+
+int64_t SrsHistogram::max()
+{
+    return max_;
+}
+
+int64_t SrsHistogram::percentile(double p)
+{
+    if (!count_) {
+        return 0;
+    }
+
+    // The rank of value, in [1, count].
+    int64_t rank = (int64_t)(p / 100.0 * count_ + 0.5);
+    rank = srs_min(srs_max(rank, 1), count_);
+
+    int64_t nn = 0;
+    for (int i = 0; i < SRS_HISTOGRAM_BUCKETS; i++) {
+        nn += counts_[i];
+        if (nn >= rank) {
+            return srs_min(srs_histogram_upper(i), max_);
+        }
+    }
+
+    return max_;
+}
+
 SrsWallClock::SrsWallClock()
 {
 }
@@ -57,6 +57,42 @@ public:
     int r30s();
 };
 
+// The sub-buckets of each power of two is 2^3=8, so the relative error of histogram is 1/8=12.5%.
+#define SRS_HISTOGRAM_SUB_BITS 3
+// The max value of histogram is 2^40-1, about 12 days in us, larger values are recorded as max.
+#define SRS_HISTOGRAM_MAX_BITS 40
+#define SRS_HISTOGRAM_BUCKETS ((SRS_HISTOGRAM_MAX_BITS - SRS_HISTOGRAM_SUB_BITS + 1) << SRS_HISTOGRAM_SUB_BITS)
+
+// A HDR-style histogram, log-linear buckets with fixed relative error, to get percentiles of values
+// such as latency. Recording is O(1) without allocation, so it's ok for hot path.
+class SrsHistogram
+{
+private:
+    uint64_t counts_[SRS_HISTOGRAM_BUCKETS];
+    int64_t count_;
+    int64_t sum_;
+    int64_t min_;
+    int64_t max_;
+public:
+    SrsHistogram();
+    virtual ~SrsHistogram();
+public:
+    // Record a value, negative value is recorded as 0.
+    void record(int64_t v);
+    // Merge the values of other histogram to this one.
+    void merge(SrsHistogram* h);
+    // Reset all values.
+    void clear();
+public:
+    int64_t count();
+    int64_t sum();
+    int64_t min();
+    int64_t max();
+    // Get the value at percentile p, for example, 99.9 for p999. Return 0 if empty.
+    // @remark The value is the upper bound of bucket, but never larger than max.
+    int64_t percentile(double p);
+};
+
 /**
  * A time source to provide wall clock.
  */
@@ -29,6 +29,23 @@ using namespace std;
 
 #define SRS_MP4_BUF_SIZE 4096
 
+// Write all bytes of data, or fail for short write, which corrupts the boxes after it.
+srs_error_t srs_mp4_write_fully(ISrsWriter* writer, void* data, size_t size)
+{
+    srs_error_t err = srs_success;
+
+    ssize_t nwrite = 0;
+    if ((err = writer->write(data, size, &nwrite)) != srs_success) {
+        return srs_error_wrap(err, "write");
+    }
+
+    if (nwrite != (ssize_t)size) {
+        return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "short write %d of %d bytes", (int)nwrite, (int)size);
+    }
+
+    return err;
+}
+
 srs_error_t srs_mp4_write_box(ISrsWriter* writer, ISrsCodec* box)
 {
     srs_error_t err = srs_success;
@@ -43,7 +60,7 @@ srs_error_t srs_mp4_write_box(ISrsWriter* writer, ISrsCodec* box)
         return srs_error_wrap(err, "encode box");
     }
 
-    if ((err = writer->write(&data[0], nb_data, NULL)) != srs_success) {
+    if ((err = srs_mp4_write_fully(writer, &data[0], nb_data)) != srs_success) {
         return srs_error_wrap(err, "write box");
     }
 
@@ -5730,8 +5747,7 @@ srs_error_t SrsMp4Encoder::initialize(ISrsWriteSeeker* ws)
             return srs_error_wrap(err, "encode mdat");
         }
         
-        // TODO: FIXME: Ensure all bytes are writen.
-        if ((err = wsio->write(data, nb_data, NULL)) != srs_success) {
+        if ((err = srs_mp4_write_fully(wsio, data, nb_data)) != srs_success) {
             return srs_error_wrap(err, "write mdat");
         }
         
@@ -5980,8 +5996,7 @@ srs_error_t SrsMp4Encoder::flush()
             return srs_error_wrap(err, "encode moov");
         }
         
-        // TODO: FIXME: Ensure all bytes are writen.
-        if ((err = wsio->write(data, nb_data, NULL)) != srs_success) {
+        if ((err = srs_mp4_write_fully(wsio, data, nb_data)) != srs_success) {
             return srs_error_wrap(err, "write moov");
         }
     }
@@ -6024,8 +6039,7 @@ srs_error_t SrsMp4Encoder::flush()
             return srs_error_wrap(err, "seek to mdat");
         }
         
-        // TODO: FIXME: Ensure all bytes are writen.
-        if ((err = wsio->write(data, nb_data, NULL)) != srs_success) {
+        if ((err = srs_mp4_write_fully(wsio, data, nb_data)) != srs_success) {
             return srs_error_wrap(err, "write mdat");
         }
     }
@@ -6081,8 +6095,7 @@ srs_error_t SrsMp4Encoder::do_write_sample(SrsMp4Sample* ps, uint8_t* sample, ui
         return srs_error_wrap(err, "seek to offset in mdat");
     }
     
-    // TODO: FIXME: Ensure all bytes are writen.
-    if ((err = wsio->write(sample, nb_sample, NULL)) != srs_success) {
+    if ((err = srs_mp4_write_fully(wsio, sample, nb_sample)) != srs_success) {
         return srs_error_wrap(err, "write sample");
     }
     
@@ -6119,6 +6132,11 @@ srs_error_t SrsMp4M2tsInitEncoder::initialize(ISrsWriter* w)
 }
 
 srs_error_t SrsMp4M2tsInitEncoder::write(SrsFormat* format, bool video, int tid)
+{
+    return write(format, video ? tid : 0, video ? 0 : tid, NULL);
+}
+
+srs_error_t SrsMp4M2tsInitEncoder::write(SrsFormat* format, int v_tid, int a_tid, SrsMp4MovieBox** pmoov)
 {
     srs_error_t err = srs_success;
     
@@ -6146,16 +6164,18 @@ srs_error_t SrsMp4M2tsInitEncoder::write(SrsFormat* format, bool video, int tid)
         
         mvhd->timescale = 1000; // Use tbn ms.
         mvhd->duration_in_tbn = 0;
-        mvhd->next_track_ID = tid;
+        mvhd->next_track_ID = srs_max(v_tid, a_tid) + 1;
+
+        SrsMp4MovieExtendsBox* mvex = new SrsMp4MovieExtendsBox();
         
-        if (video) {
+        if (v_tid) {
             SrsMp4TrackBox* trak = new SrsMp4TrackBox();
             moov->add_trak(trak);
             
             SrsMp4TrackHeaderBox* tkhd = new SrsMp4TrackHeaderBox();
             trak->set_tkhd(tkhd);
             
-            tkhd->track_ID = mvhd->next_track_ID++;
+            tkhd->track_ID = v_tid;
             tkhd->duration = 0;
             tkhd->width = (format->vcodec->width << 16);
             tkhd->height = (format->vcodec->height << 16);
@@ -6224,15 +6244,14 @@ srs_error_t SrsMp4M2tsInitEncoder::write(SrsFormat* format, bool video, int tid)
             SrsMp4ChunkOffsetBox* stco = new SrsMp4ChunkOffsetBox();
             stbl->set_stco(stco);
             
-            SrsMp4MovieExtendsBox* mvex = new SrsMp4MovieExtendsBox();
-            moov->set_mvex(mvex);
-            
             SrsMp4TrackExtendsBox* trex = new SrsMp4TrackExtendsBox();
-            mvex->set_trex(trex);
+            mvex->append(trex);
             
-            trex->track_ID = tid;
+            trex->track_ID = v_tid;
             trex->default_sample_description_index = 1;
-        } else {
+        }
+
+        if (a_tid) {
             SrsMp4TrackBox* trak = new SrsMp4TrackBox();
             moov->add_trak(trak);
             
@@ -6240,7 +6259,7 @@ srs_error_t SrsMp4M2tsInitEncoder::write(SrsFormat* format, bool video, int tid)
             tkhd->volume = 0x0100;
             trak->set_tkhd(tkhd);
             
-            tkhd->track_ID = mvhd->next_track_ID++;
+            tkhd->track_ID = a_tid;
             tkhd->duration = 0;
             
             SrsMp4MediaBox* mdia = new SrsMp4MediaBox();
@@ -6325,19 +6344,24 @@ srs_error_t SrsMp4M2tsInitEncoder::write(SrsFormat* format, bool video, int tid)
             SrsMp4ChunkOffsetBox* stco = new SrsMp4ChunkOffsetBox();
             stbl->set_stco(stco);
             
-            SrsMp4MovieExtendsBox* mvex = new SrsMp4MovieExtendsBox();
-            moov->set_mvex(mvex);
-            
             SrsMp4TrackExtendsBox* trex = new SrsMp4TrackExtendsBox();
-            mvex->set_trex(trex);
+            mvex->append(trex);
             
-            trex->track_ID = tid;
+            trex->track_ID = a_tid;
             trex->default_sample_description_index = 1;
         }
 
+        moov->set_mvex(mvex);
+
         if ((err = srs_mp4_write_box(writer, moov)) != srs_success) {
             return srs_error_wrap(err, "write moov");
         }
+
+        // Output the moov, which is used to rewrite the duration, see SrsMp4FragmentEncoder.
+        if (pmoov) {
+            *pmoov = moov;
+            moov = NULL;
+        }
     }
     
     return err;
@@ -6524,8 +6548,7 @@ srs_error_t SrsMp4M2tsSegmentEncoder::flush(uint64_t& dts)
             return srs_error_wrap(err, "encode mdat");
         }
         
-        // TODO: FIXME: Ensure all bytes are writen.
-        if ((err = writer->write(data, nb_data, NULL)) != srs_success) {
+        if ((err = srs_mp4_write_fully(writer, data, nb_data)) != srs_success) {
             return srs_error_wrap(err, "write mdat");
         }
         
@@ -6533,8 +6556,266 @@ srs_error_t SrsMp4M2tsSegmentEncoder::flush(uint64_t& dts)
         for (it = samples->samples.begin(); it != samples->samples.end(); ++it) {
             SrsMp4Sample* sample = *it;
             
-            // TODO: FIXME: Ensure all bytes are writen.
-            if ((err = writer->write(sample->data, sample->nb_data, NULL)) != srs_success) {
+            if ((err = srs_mp4_write_fully(writer, sample->data, sample->nb_data)) != srs_success) {
+                return srs_error_wrap(err, "write sample");
+            }
+        }
+    }
+
+    return err;
+}
+
+SrsMp4FragmentEncoder::SrsMp4FragmentEncoder()
+{
+    wsio = NULL;
+    moov = NULL;
+    moov_offset = 0;
+    fragment = 0;
+    sequence_number = 1;
+    vtid = atid = 0;
+    vsamples = new SrsMp4SampleManager();
+    asamples = new SrsMp4SampleManager();
+    fragment_dts = -1;
+    start_dts = -1;
+    last_dts = 0;
+    vduration = aduration = 0;
+}
+
+SrsMp4FragmentEncoder::~SrsMp4FragmentEncoder()
+{
+    srs_freep(moov);
+    srs_freep(vsamples);
+    srs_freep(asamples);
+}
+
+srs_error_t SrsMp4FragmentEncoder::initialize(ISrsWriteSeeker* ws, uint64_t f)
+{
+    wsio = ws;
+    fragment = f;
+    return srs_success;
+}
+
+srs_error_t SrsMp4FragmentEncoder::write_header(SrsFormat* format, bool video, bool audio)
+{
+    srs_error_t err = srs_success;
+
+    if (!video && !audio) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOF, "Missing audio and video track");
+    }
+
+    vtid = video ? 1 : 0;
+    atid = audio ? (vtid + 1) : 0;
+
+    SrsMp4M2tsInitEncoder init;
+    if ((err = init.initialize(wsio)) != srs_success) {
+        return srs_error_wrap(err, "init encoder");
+    }
+
+    srs_freep(moov);
+    if ((err = init.write(format, vtid, atid, &moov)) != srs_success) {
+        return srs_error_wrap(err, "write moov");
+    }
+
+    // The moov is the last box writen, remember its offset to rewrite it.
+    off_t offset = 0;
+    if ((err = wsio->lseek(0, SEEK_CUR, &offset)) != srs_success) {
+        return srs_error_wrap(err, "seek to moov");
+    }
+    moov_offset = offset - (off_t)moov->nb_bytes();
+
+    return err;
+}
+
+srs_error_t SrsMp4FragmentEncoder::write_sample(SrsMp4HandlerType ht,
+    uint16_t ft, uint32_t dts, uint32_t pts, uint8_t* sample, uint32_t nb_sample
+) {
+    srs_error_t err = srs_success;
+
+    // Ignore the sample of track not in moov.
+    if ((ht == SrsMp4HandlerTypeVIDE && !vtid) || (ht == SrsMp4HandlerTypeSOUN && !atid)) {
+        return err;
+    }
+
+    // Reap the fragment when it's full, and start the new fragment with a keyframe if there is video track.
+    bool is_key = ht == SrsMp4HandlerTypeSOUN || ft == SrsVideoAvcFrameTypeKeyFrame;
+    bool can_reap = vtid ? (ht == SrsMp4HandlerTypeVIDE && is_key) : true;
+    if (fragment_dts >= 0 && can_reap && dts >= fragment_dts + fragment) {
+        if ((err = flush_fragment(ht, dts)) != srs_success) {
+            return srs_error_wrap(err, "flush fragment");
+        }
+    }
+
+    // Note that the samples are reset when flush fragment, so we should pick it after that.
+    SrsMp4SampleManager* samples = (ht == SrsMp4HandlerTypeVIDE) ? vsamples : asamples;
+
+    SrsMp4Sample* ps = new SrsMp4Sample();
+    ps->type = (ht == SrsMp4HandlerTypeVIDE) ? SrsFrameTypeVideo : SrsFrameTypeAudio;
+    ps->frame_type = is_key ? SrsVideoAvcFrameTypeKeyFrame : (SrsVideoAvcFrameType)ft;
+    ps->index = (uint32_t)samples->samples.size();
+    ps->tbn = 1000;
+    ps->dts = dts;
+    ps->pts = pts;
+
+    // We should copy the sample data, which is shared ptr from video/audio message.
+    ps->data = new uint8_t[nb_sample];
+    memcpy(ps->data, sample, nb_sample);
+    ps->nb_data = nb_sample;
+
+    samples->append(ps);
+
+    if (fragment_dts < 0) {
+        fragment_dts = dts;
+    }
+    if (start_dts < 0) {
+        start_dts = dts;
+    }
+    last_dts = srs_max(last_dts, (uint64_t)dts);
+
+    return err;
+}
+
+srs_error_t SrsMp4FragmentEncoder::flush(bool finalize)
+{
+    srs_error_t err = srs_success;
+
+    if ((err = flush_fragment(SrsMp4HandlerTypeForbidden, last_dts)) != srs_success) {
+        return srs_error_wrap(err, "flush fragment");
+    }
+
+    if (finalize && moov && (err = rewrite_moov()) != srs_success) {
+        return srs_error_wrap(err, "rewrite moov");
+    }
+
+    return err;
+}
+
+srs_error_t SrsMp4FragmentEncoder::flush_fragment(SrsMp4HandlerType ht, uint64_t dts)
+{
+    srs_error_t err = srs_success;
+
+    int64_t vnext = (ht == SrsMp4HandlerTypeVIDE) ? (int64_t)dts : -1;
+    if ((err = flush_track(vsamples, vtid, vnext, &vduration)) != srs_success) {
+        return srs_error_wrap(err, "flush video");
+    }
+
+    int64_t anext = (ht == SrsMp4HandlerTypeSOUN) ? (int64_t)dts : -1;
+    if ((err = flush_track(asamples, atid, anext, &aduration)) != srs_success) {
+        return srs_error_wrap(err, "flush audio");
+    }
+
+    // Free the samples of fragment, so the memory is bounded.
+    srs_freep(vsamples);
+    vsamples = new SrsMp4SampleManager();
+    srs_freep(asamples);
+    asamples = new SrsMp4SampleManager();
+    fragment_dts = -1;
+
+    return err;
+}
+
+srs_error_t SrsMp4FragmentEncoder::flush_track(SrsMp4SampleManager* samples, uint32_t tid, int64_t next, uint32_t* pduration)
+{
+    srs_error_t err = srs_success;
+
+    vector<SrsMp4Sample*>& ss = samples->samples;
+    if (ss.empty()) {
+        return err;
+    }
+
+    SrsMp4MediaDataBox* mdat = new SrsMp4MediaDataBox();
+    SrsAutoFree(SrsMp4MediaDataBox, mdat);
+
+    // Write moof.
+    if (true) {
+        SrsMp4MovieFragmentBox* moof = new SrsMp4MovieFragmentBox();
+        SrsAutoFree(SrsMp4MovieFragmentBox, moof);
+
+        SrsMp4MovieFragmentHeaderBox* mfhd = new SrsMp4MovieFragmentHeaderBox();
+        moof->set_mfhd(mfhd);
+
+        mfhd->sequence_number = sequence_number++;
+
+        SrsMp4TrackFragmentBox* traf = new SrsMp4TrackFragmentBox();
+        moof->set_traf(traf);
+
+        SrsMp4TrackFragmentHeaderBox* tfhd = new SrsMp4TrackFragmentHeaderBox();
+        traf->set_tfhd(tfhd);
+
+        tfhd->track_id = tid;
+        tfhd->flags = SrsMp4TfhdFlagsDefaultBaseIsMoof;
+
+        SrsMp4TrackFragmentDecodeTimeBox* tfdt = new SrsMp4TrackFragmentDecodeTimeBox();
+        traf->set_tfdt(tfdt);
+
+        tfdt->version = 1;
+        tfdt->base_media_decode_time = ss[0]->dts;
+
+        SrsMp4TrackFragmentRunBox* trun = new SrsMp4TrackFragmentRunBox();
+        traf->set_trun(trun);
+
+        trun->flags = SrsMp4TrunFlagsDataOffset | SrsMp4TrunFlagsSampleDuration
+            | SrsMp4TrunFlagsSampleSize | SrsMp4TrunFlagsSampleFlag | SrsMp4TrunFlagsSampleCtsOffset;
+
+        for (int i = 0; i < (int)ss.size(); i++) {
+            SrsMp4Sample* sample = ss[i];
+            SrsMp4TrunEntry* entry = new SrsMp4TrunEntry(trun);
+
+            // The sync sample does not depend on others, while the non-sync sample depends on others.
+            if (sample->frame_type == SrsVideoAvcFrameTypeKeyFrame) {
+                entry->sample_flags = 0x02000000;
+            } else {
+                entry->sample_flags = 0x01010000;
+            }
+
+            // The duration of last sample is the gap to next sample of track if known, or carried from the
+            // previous sample, because the player stalls on a sample with zero duration.
+            if (i < (int)ss.size() - 1) {
+                *pduration = (uint32_t)(ss[i + 1]->dts - sample->dts);
+            } else if (next > (int64_t)sample->dts) {
+                *pduration = (uint32_t)(next - sample->dts);
+            }
+            entry->sample_duration = *pduration;
+
+            entry->sample_size = sample->nb_data;
+            entry->sample_composition_time_offset = (int64_t)(sample->pts - sample->dts);
+            if (entry->sample_composition_time_offset < 0) {
+                trun->version = 1;
+            }
+
+            trun->entries.push_back(entry);
+            mdat->nb_data += sample->nb_data;
+        }
+
+        // @remark Remember the data_offset of turn is size(moof)+header(mdat).
+        mdat->update_size();
+        trun->data_offset = (int32_t)(moof->nb_bytes() + mdat->sz_header());
+
+        if ((err = srs_mp4_write_box(wsio, moof)) != srs_success) {
+            return srs_error_wrap(err, "write moof");
+        }
+    }
+
+    // Write mdat.
+    if (true) {
+        int nb_data = mdat->sz_header();
+        uint8_t* data = new uint8_t[nb_data];
+        SrsAutoFreeA(uint8_t, data);
+
+        SrsBuffer* buffer = new SrsBuffer((char*)data, nb_data);
+        SrsAutoFree(SrsBuffer, buffer);
+
+        if ((err = mdat->encode(buffer)) != srs_success) {
+            return srs_error_wrap(err, "encode mdat");
+        }
+
+        if ((err = srs_mp4_write_fully(wsio, data, nb_data)) != srs_success) {
+            return srs_error_wrap(err, "write mdat");
+        }
+
+        for (int i = 0; i < (int)ss.size(); i++) {
+            SrsMp4Sample* sample = ss[i];
+
+            if ((err = srs_mp4_write_fully(wsio, sample->data, sample->nb_data)) != srs_success) {
                 return srs_error_wrap(err, "write sample");
             }
         }
@@ -6543,3 +6824,42 @@ srs_error_t SrsMp4M2tsSegmentEncoder::flush(uint64_t& dts)
     return err;
 }
 
+srs_error_t SrsMp4FragmentEncoder::rewrite_moov()
+{
+    srs_error_t err = srs_success;
+
+    // The size of moov never changes, because the version of boxes is not changed.
+    uint64_t duration = (start_dts >= 0) ? last_dts - start_dts : 0;
+    moov->mvhd()->duration_in_tbn = duration;
+
+    SrsMp4TrackBox* tracks[] = {moov->video(), moov->audio()};
+    for (int i = 0; i < 2; i++) {
+        SrsMp4TrackBox* trak = tracks[i];
+        if (!trak) {
+            continue;
+        }
+
+        trak->tkhd()->duration = duration;
+        trak->mdhd()->duration = duration;
+    }
+
+    off_t offset = 0;
+    if ((err = wsio->lseek(0, SEEK_CUR, &offset)) != srs_success) {
+        return srs_error_wrap(err, "seek to end");
+    }
+
+    if ((err = wsio->lseek(moov_offset, SEEK_SET, NULL)) != srs_success) {
+        return srs_error_wrap(err, "seek to moov");
+    }
+
+    if ((err = srs_mp4_write_box(wsio, moov)) != srs_success) {
+        return srs_error_wrap(err, "write moov");
+    }
+
+    if ((err = wsio->lseek(offset, SEEK_SET, NULL)) != srs_success) {
+        return srs_error_wrap(err, "seek to end");
+    }
+
+    return err;
+}
+
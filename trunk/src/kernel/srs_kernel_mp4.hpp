@@ -2096,6 +2096,9 @@ public:
     virtual srs_error_t initialize(ISrsWriter* w);
     // Write the sequence header.
     virtual srs_error_t write(SrsFormat* format, bool video, int tid);
+    // Write the sequence header of video and audio track, the track id is 0 if no such track.
+    // @param pmoov Output the moov box if not NULL, user must free it.
+    virtual srs_error_t write(SrsFormat* format, int v_tid, int a_tid, SrsMp4MovieBox** pmoov);
 };
 
 // A fMP4 encoder, to cache segments then flush to disk, because the fMP4 should write
@@ -2133,6 +2136,64 @@ public:
     virtual srs_error_t flush(uint64_t& dts);
 };
 
+// A fMP4 encoder to write a fragmented MP4 file, such as DVR, which starts with the ftyp and moov of both video and
+// audio tracks, then a moof and mdat of each track for every fragment. Only the samples of current fragment are
+// cached, so the memory is bounded and the file is playable even if it's not finished.
+class SrsMp4FragmentEncoder
+{
+private:
+    ISrsWriteSeeker* wsio;
+    // The moov and its offset in file, to rewrite the duration when flush.
+    SrsMp4MovieBox* moov;
+    off_t moov_offset;
+    // The duration of fragment in ms.
+    uint64_t fragment;
+    // The sequence number of moof, start from 1.
+    uint32_t sequence_number;
+    // The track id of video and audio, 0 if no such track.
+    uint32_t vtid;
+    uint32_t atid;
+private:
+    // The samples of current fragment, for video and audio track.
+    SrsMp4SampleManager* vsamples;
+    SrsMp4SampleManager* asamples;
+    // The dts of the first sample of current fragment, -1 if empty.
+    int64_t fragment_dts;
+    // The dts of the first and last sample of file, to calculate the duration.
+    int64_t start_dts;
+    uint64_t last_dts;
+    // The duration of last sample of video and audio track, carried to the last sample of fragment.
+    uint32_t vduration;
+    uint32_t aduration;
+public:
+    SrsMp4FragmentEncoder();
+    virtual ~SrsMp4FragmentEncoder();
+public:
+    // Initialize the encoder with a writer and seeker ws.
+    // @param fragment The duration of fragment in ms.
+    virtual srs_error_t initialize(ISrsWriteSeeker* ws, uint64_t fragment);
+    // Write the ftyp and moov with sequence header. Should never write sample of track not in moov.
+    virtual srs_error_t write_header(SrsFormat* format, bool video, bool audio);
+    // Write a sample, which is cached util the fragment is full and got a video keyframe.
+    // @param ht, The sample handler type, audio/soun or video/vide.
+    // @param ft, The frame type. For video, it's SrsVideoAvcFrameType.
+    // @param dts The output dts in milliseconds.
+    // @param pts The output pts in milliseconds.
+    // @remark All samples are RAW AAC/AVC data, because sequence header is writen to moov.
+    virtual srs_error_t write_sample(SrsMp4HandlerType ht, uint16_t ft,
+        uint32_t dts, uint32_t pts, uint8_t* sample, uint32_t nb_sample);
+    // Flush the last fragment, and rewrite the moov with duration if finalize.
+    virtual srs_error_t flush(bool finalize);
+private:
+    // Flush the fragment before the sample of track ht at dts, which is the next dts of track ht, while the
+    // duration of last sample of other track is carried from previous sample. Use SrsMp4HandlerTypeForbidden for
+    // the last fragment, which has no next sample.
+    virtual srs_error_t flush_fragment(SrsMp4HandlerType ht, uint64_t dts);
+    // @param next The dts of next sample of track, -1 if unknown to use the carried duration.
+    virtual srs_error_t flush_track(SrsMp4SampleManager* samples, uint32_t tid, int64_t next, uint32_t* pduration);
+    virtual srs_error_t rewrite_moov();
+};
+
 // LCOV_EXCL_START
 /////////////////////////////////////////////////////////////////////////////////
 // MP4 dumps functions.
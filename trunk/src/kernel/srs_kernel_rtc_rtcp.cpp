@@ -8,8 +8,10 @@
 
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
 
 #include <arpa/inet.h>
+#include <string.h>
 using namespace std;
 
 SrsRtcpCommon::SrsRtcpCommon(): ssrc_(0), data_(NULL), nb_data_(0)
@@ -392,6 +394,10 @@ block  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
         return srs_error_wrap(err, "decode header");
     }
 
+    if (!buffer->require(20 + header_.rc * 24)) {
+        return srs_error_new(ERROR_RTC_RTCP, "require %d bytes, rc=%d", 20 + header_.rc * 24, header_.rc);
+    }
+
     ntp_ = buffer->read_8bytes();
     rtp_ts_ = buffer->read_4bytes();
     send_rtp_packets_ = buffer->read_4bytes();
@@ -685,12 +691,7 @@ block  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
     return err;
 }
 
-SrsRtcpTWCC::SrsRtcpTWCCChunk::SrsRtcpTWCCChunk()
-        : size(0), all_same(true), has_large_delta(false)
-{
-}
-
-SrsRtcpTWCC::SrsRtcpTWCC(uint32_t sender_ssrc) : pkt_len(0)
+SrsRtcpTWCC::SrsRtcpTWCC(uint32_t sender_ssrc)
 {
     header_.padding = 0;
     header_.type = SrsRtcpType_rtpfb;
@@ -699,22 +700,38 @@ SrsRtcpTWCC::SrsRtcpTWCC(uint32_t sender_ssrc) : pkt_len(0)
     ssrc_ = sender_ssrc;
     media_ssrc_ = 0;
     base_sn_ = 0;
+    packet_count_ = 0;
     reference_time_ = 0;
     fb_pkt_count_ = 0;
-    next_base_sn_ = 0;
+
+    // Allocate the ring when receiving packet, because the decoded TWCC never use it.
+    recv_deltas_ = NULL;
+    begin_sn_ = end_sn_ = 0;
+    nn_recv_ = 0;
+    base_ts_ = 0;
+    symbols_ = NULL;
+    deltas_ = NULL;
 }
 
 SrsRtcpTWCC::~SrsRtcpTWCC()
 {
+    srs_freepa(recv_deltas_);
+    srs_freepa(symbols_);
+    srs_freepa(deltas_);
 }
 
 void SrsRtcpTWCC::clear()
 {
     encoded_chucks_.clear();
     pkt_deltas_.clear();
-    recv_packets_.clear();
-    recv_sns_.clear();
-    next_base_sn_ = 0;
+
+    if (recv_deltas_) {
+        for (uint16_t sn = begin_sn_; sn != end_sn_; ++sn) {
+            recv_deltas_[sn & (kTwccRingSize - 1)] = kTwccRingEmpty;
+        }
+    }
+    begin_sn_ = end_sn_;
+    nn_recv_ = 0;
 }
 
 uint16_t SrsRtcpTWCC::get_base_sn() const
@@ -722,6 +739,11 @@ uint16_t SrsRtcpTWCC::get_base_sn() const
     return base_sn_;
 }
 
+uint16_t SrsRtcpTWCC::get_packet_status_count() const
+{
+    return packet_count_;
+}
+
 uint32_t SrsRtcpTWCC::get_reference_time() const
 {
     return reference_time_;
@@ -769,20 +791,62 @@ void SrsRtcpTWCC::add_recv_delta(uint16_t delta)
 
 srs_error_t SrsRtcpTWCC::recv_packet(uint16_t sn, srs_utime_t ts)
 {
-    map<uint16_t, srs_utime_t>::iterator it = recv_packets_.find(sn);
-    if(it != recv_packets_.end()) {
+    if (!recv_deltas_) {
+        recv_deltas_ = new uint32_t[kTwccRingSize];
+        memset(recv_deltas_, 0xff, sizeof(uint32_t) * kTwccRingSize);
+        symbols_ = new uint8_t[kTwccRingSize];
+        deltas_ = new int16_t[kTwccRingSize];
+    }
+
+    // Restart the ring if empty, or the arrival time overflows, for example, no feedback for a long time.
+    if (nn_recv_ && (ts < base_ts_ || ts - base_ts_ >= kTwccRingEmpty)) {
+        clear();
+    }
+    if (!nn_recv_) {
+        begin_sn_ = sn;
+        end_sn_ = sn + 1;
+        base_ts_ = ts;
+    }
+
+    if (srs_rtp_seq_distance(end_sn_, sn) >= 0) {
+        // Newer packet, drop the oldest packets if ring is full.
+        if ((uint16_t)(sn - begin_sn_) >= kTwccRingSize) {
+            shrink_to(sn - kTwccRingSize + 1);
+        }
+        end_sn_ = sn + 1;
+    } else if (srs_rtp_seq_distance(begin_sn_, sn) < 0) {
+        // Late packet before the ring, ignore it if ring is full.
+        if ((uint16_t)(end_sn_ - sn) > kTwccRingSize) {
+            return srs_error_new(ERROR_RTC_RTCP, "TWCC stale seq: %d, ring=[%d,%d)", sn, begin_sn_, end_sn_);
+        }
+        begin_sn_ = sn;
+    }
+
+    uint32_t& slot = recv_deltas_[sn & (kTwccRingSize - 1)];
+    if (slot != kTwccRingEmpty) {
         return srs_error_new(ERROR_RTC_RTCP, "TWCC dup seq: %d", sn);
     }
 
-    recv_packets_[sn] = ts;
-    recv_sns_.insert(sn);
+    slot = (uint32_t)(ts - base_ts_);
+    nn_recv_++;
 
     return srs_success;
 }
 
+void SrsRtcpTWCC::shrink_to(uint16_t sn)
+{
+    for (; begin_sn_ != sn; ++begin_sn_) {
+        uint32_t& slot = recv_deltas_[begin_sn_ & (kTwccRingSize - 1)];
+        if (slot != kTwccRingEmpty) {
+            slot = kTwccRingEmpty;
+            nn_recv_--;
+        }
+    }
+}
+
 bool SrsRtcpTWCC::need_feedback()
 {
-    return recv_packets_.size() > 0;
+    return nn_recv_ > 0;
 }
 
 srs_error_t SrsRtcpTWCC::decode(SrsBuffer *buffer)
@@ -826,195 +890,143 @@ srs_error_t SrsRtcpTWCC::decode(SrsBuffer *buffer)
     payload_len_ = (header_.length + 1) * 4 - sizeof(SrsRtcpHeader) - 4;
     buffer->read_bytes((char *)payload_, payload_len_);
 
-    return err;
-}
-
-uint64_t SrsRtcpTWCC::nb_bytes()
-{
-    return kMaxUDPDataSize;
-}
-
-srs_utime_t SrsRtcpTWCC::calculate_delta_us(srs_utime_t ts, srs_utime_t last)
-{
-    int64_t divisor = kTwccFbReferenceTimeDivisor;
-    int64_t delta_us = (ts - last) % divisor;
-
-    if (delta_us > (divisor >> 1))
-        delta_us -= divisor;
-
-    delta_us += (delta_us < 0) ? (-kTwccFbDeltaUnit / 2) : (kTwccFbDeltaUnit / 2);
-    delta_us /= kTwccFbDeltaUnit;
-
-    return delta_us;
-}
-
-bool SrsRtcpTWCC::can_add_to_chunk(SrsRtcpTWCC::SrsRtcpTWCCChunk& chunk, int delta_size)
-{
-	srs_verbose("can_add %d chunk->size %u delta_sizes %d %d %d %d %d %d %d %d %d %d %d %d %d %d all_same %d has_large_delta %d",
-	    delta_size, chunk.size, chunk.delta_sizes[0], chunk.delta_sizes[1], chunk.delta_sizes[2], chunk.delta_sizes[3],
-	    chunk.delta_sizes[4], chunk.delta_sizes[5], chunk.delta_sizes[6], chunk.delta_sizes[7], chunk.delta_sizes[8],
-	    chunk.delta_sizes[9], chunk.delta_sizes[10], chunk.delta_sizes[11], chunk.delta_sizes[12], chunk.delta_sizes[13],
-	    (int)chunk.all_same, (int)chunk.has_large_delta);
-
-    if (chunk.size < kTwccFbTwoBitElements) {
-        return true;
-    }
-
-    if (chunk.size < kTwccFbOneBitElements && !chunk.has_large_delta && delta_size != kTwccFbLargeRecvDeltaBytes) {
-        return true;
-    }
-
-    if (chunk.size < kTwccFbMaxRunLength && chunk.all_same && chunk.delta_sizes[0] == delta_size) {
-        srs_verbose("< %d && all_same && delta_size[0] %d == %d", kTwccFbMaxRunLength, chunk.delta_sizes[0], delta_size);
-        return true;
+    SrsBuffer payload((char*)payload_, payload_len_);
+    if ((err = do_decode(&payload)) != srs_success) {
+        return srs_error_wrap(err, "decode twcc");
     }
 
-    return false;
+    return err;
 }
 
-void SrsRtcpTWCC::add_to_chunk(SrsRtcpTWCC::SrsRtcpTWCCChunk& chunk, int delta_size)
+srs_error_t SrsRtcpTWCC::do_decode(SrsBuffer *buffer)
 {
-    if (chunk.size < kTwccFbMaxBitElements) {
-        chunk.delta_sizes[chunk.size] = delta_size;
-    }
-
-    chunk.size += 1;
-    chunk.all_same = chunk.all_same && delta_size == chunk.delta_sizes[0];
-    chunk.has_large_delta = chunk.has_large_delta || delta_size >= kTwccFbLargeRecvDeltaBytes;
-}
+    srs_error_t err = srs_success;
 
-srs_error_t SrsRtcpTWCC::encode_chunk_run_length(SrsRtcpTWCC::SrsRtcpTWCCChunk& chunk)
-{
-    if (!chunk.all_same || chunk.size > kTwccFbMaxRunLength) {
-        return srs_error_new(ERROR_RTC_RTCP, "invalid run all_same:%d, size:%d", chunk.all_same, chunk.size);
+    if (!buffer->require(12)) {
+        return srs_error_new(ERROR_RTC_RTCP, "requires 12 only %d bytes", buffer->left());
     }
 
-    uint16_t encoded_chunk = (chunk.delta_sizes[0] << 13) | chunk.size;
+    media_ssrc_ = buffer->read_4bytes();
+    base_sn_ = buffer->read_2bytes();
+    packet_count_ = buffer->read_2bytes();
+    reference_time_ = buffer->read_3bytes();
+    fb_pkt_count_ = buffer->read_1bytes();
 
-    encoded_chucks_.push_back(encoded_chunk);
-    pkt_len += sizeof(encoded_chunk);
+    encoded_chucks_.clear();
+    pkt_deltas_.clear();
 
-    return srs_success;
-}
+    // Parse the packet status symbols from chunks.
+    vector<uint8_t> symbols;
+    while (symbols.size() < packet_count_) {
+        if (!buffer->require(kTwccFbChunkBytes)) {
+            return srs_error_new(ERROR_RTC_RTCP, "chunk requires %d only %d bytes", kTwccFbChunkBytes, buffer->left());
+        }
 
-srs_error_t SrsRtcpTWCC::encode_chunk_one_bit(SrsRtcpTWCC::SrsRtcpTWCCChunk& chunk)
-{
-    int i = 0;
-    if (chunk.has_large_delta) {
-        return srs_error_new(ERROR_RTC_RTCP, "invalid large delta");
-    }
+        uint16_t chunk = buffer->read_2bytes();
+        encoded_chucks_.push_back(chunk);
 
-    uint16_t encoded_chunk = 0x8000;
-    for (i = 0; i < chunk.size; ++i) {
-        encoded_chunk |= (chunk.delta_sizes[i] << (kTwccFbOneBitElements - 1 - i));
+        if ((chunk & 0x8000) == 0) {
+            // 0 symbol(2bits) run_length(13bits)
+            symbols.insert(symbols.end(), chunk & kTwccFbMaxRunLength, (chunk >> 13) & 0x03);
+        } else if ((chunk & 0x4000) == 0) {
+            // 1 0 symbol_list(14bits)
+            for (int i = 0; i < kTwccFbOneBitElements; ++i) {
+                symbols.push_back((chunk >> (kTwccFbOneBitElements - 1 - i)) & 0x01);
+            }
+        } else {
+            // 1 1 symbol_list(14bits)
+            for (int i = 0; i < kTwccFbTwoBitElements; ++i) {
+                symbols.push_back((chunk >> (2 * (kTwccFbTwoBitElements - 1 - i))) & 0x03);
+            }
+        }
     }
 
-    encoded_chucks_.push_back(encoded_chunk);
-    pkt_len += sizeof(encoded_chunk);
+    // Parse the recv deltas, ignore the symbols padding in the last chunk.
+    for (int i = 0; i < packet_count_; ++i) {
+        uint8_t symbol = symbols[i];
+        if (symbol == 0) {
+            continue;
+        }
+        if (symbol > kTwccFbLargeRecvDeltaBytes) {
+            return srs_error_new(ERROR_RTC_RTCP, "invalid symbol %d", symbol);
+        }
+        if (!buffer->require(symbol)) {
+            return srs_error_new(ERROR_RTC_RTCP, "delta requires %d only %d bytes", symbol, buffer->left());
+        }
 
-    // 1 0 symbol_list
-    return srs_success;
-}
-    
-srs_error_t SrsRtcpTWCC::encode_chunk_two_bit(SrsRtcpTWCC::SrsRtcpTWCCChunk& chunk, size_t size, bool shift)
-{
-    unsigned int i = 0;
-    uint8_t delta_size = 0;
-    
-    uint16_t encoded_chunk = 0xc000;
-    // 1 1 symbol_list
-    for (i = 0; i < size; ++i) {
-        encoded_chunk |= (chunk.delta_sizes[i] << (2 * (kTwccFbTwoBitElements - 1 - i)));
-    }
-    encoded_chucks_.push_back(encoded_chunk);
-    pkt_len += sizeof(encoded_chunk);
-
-    if (shift) {
-        chunk.size -= size;
-        chunk.all_same = true;
-        chunk.has_large_delta = false;
-        for (i = 0; i < chunk.size; ++i) {
-            delta_size = chunk.delta_sizes[i + size];
-            chunk.delta_sizes[i] = delta_size;
-            chunk.all_same = (chunk.all_same && delta_size == chunk.delta_sizes[0]);
-            chunk.has_large_delta = chunk.has_large_delta || delta_size == kTwccFbLargeRecvDeltaBytes;
+        // The small delta is unsigned 8 bits, while the large delta is signed 16 bits.
+        if (symbol == 1) {
+            pkt_deltas_.push_back((uint8_t)buffer->read_1bytes());
+        } else {
+            pkt_deltas_.push_back(buffer->read_2bytes());
         }
     }
 
-    return srs_success;
+    return err;
 }
 
-void SrsRtcpTWCC::reset_chunk(SrsRtcpTWCC::SrsRtcpTWCCChunk& chunk)
+uint64_t SrsRtcpTWCC::nb_bytes()
 {
-    chunk.size = 0;
-
-    chunk.all_same = true;
-    chunk.has_large_delta = false;
+    return kMaxUDPDataSize;
 }
 
-srs_error_t SrsRtcpTWCC::encode_chunk(SrsRtcpTWCC::SrsRtcpTWCCChunk& chunk)
+srs_utime_t SrsRtcpTWCC::calculate_delta_us(srs_utime_t ts, srs_utime_t last)
 {
-    srs_error_t err = srs_success;
-
-    if (can_add_to_chunk(chunk, 0) && can_add_to_chunk(chunk, 1) && can_add_to_chunk(chunk, 2)) {
-        return srs_error_new(ERROR_RTC_RTCP, "TWCC chunk");
-    }
-
-    if (chunk.all_same) {
-        if ((err = encode_chunk_run_length(chunk)) != srs_success) {
-            return srs_error_wrap(err, "encode run");
-        }
-        reset_chunk(chunk);
-        return err;
-    }
+    int64_t divisor = kTwccFbReferenceTimeDivisor;
+    int64_t delta_us = (ts - last) % divisor;
 
-    if (chunk.size == kTwccFbOneBitElements) {
-        if ((err = encode_chunk_one_bit(chunk)) != srs_success) {
-            return srs_error_wrap(err, "encode chunk");
-        }
-        reset_chunk(chunk);
-        return err;
-    }
+    if (delta_us > (divisor >> 1))
+        delta_us -= divisor;
 
-    if ((err = encode_chunk_two_bit(chunk, kTwccFbTwoBitElements, true)) != srs_success) {
-        return srs_error_wrap(err, "encode chunk");
-    }
+    delta_us += (delta_us < 0) ? (-kTwccFbDeltaUnit / 2) : (kTwccFbDeltaUnit / 2);
+    delta_us /= kTwccFbDeltaUnit;
 
-    return err;
+    return delta_us;
 }
 
-srs_error_t SrsRtcpTWCC::encode_remaining_chunk(SrsRtcpTWCC::SrsRtcpTWCCChunk& chunk)
+void SrsRtcpTWCC::encode_chunks(int nn_symbols)
 {
-    if (chunk.all_same) {
-        return encode_chunk_run_length(chunk);
-    } else if (chunk.size <= kTwccFbTwoBitElements) {
-        // FIXME, TRUE or FALSE
-        return encode_chunk_two_bit(chunk, chunk.size, false);
-    }
-    return encode_chunk_one_bit(chunk);
-}
+    for (int i = 0; i < nn_symbols;) {
+        uint8_t symbol = symbols_[i];
 
-srs_error_t SrsRtcpTWCC::process_pkt_chunk(SrsRtcpTWCC::SrsRtcpTWCCChunk& chunk, int delta_size)
-{
-    srs_error_t err = srs_success;
+        // Use run length chunk for the same symbols, or the remaining symbols.
+        int run = 1;
+        while (i + run < nn_symbols && run < kTwccFbMaxRunLength && symbols_[i + run] == symbol) {
+            run++;
+        }
+        if (run >= kTwccFbOneBitElements || i + run == nn_symbols) {
+            // 0 symbol(2bits) run_length(13bits)
+            encoded_chucks_.push_back((symbol << 13) | run);
+            i += run;
+            continue;
+        }
 
-    size_t needed_chunk_size = chunk.size == 0 ? kTwccFbChunkBytes : 0;
+        // Use one bit vector chunk if no large delta, or two bits vector chunk.
+        int size = srs_min(kTwccFbOneBitElements, nn_symbols - i);
+        bool has_large_delta = false;
+        for (int j = 0; j < size && !has_large_delta; ++j) {
+            has_large_delta = symbols_[i + j] == kTwccFbLargeRecvDeltaBytes;
+        }
 
-    size_t might_occupied = pkt_len + needed_chunk_size + delta_size;
-    if (might_occupied > (size_t)kRtcpPacketSize) {
-        return srs_error_new(ERROR_RTC_RTCP, "might_occupied %zu", might_occupied);
-    }
+        uint16_t chunk = 0;
+        if (!has_large_delta) {
+            // 1 0 symbol_list(14bits)
+            chunk = 0x8000;
+            for (int j = 0; j < size; ++j) {
+                chunk |= symbols_[i + j] << (kTwccFbOneBitElements - 1 - j);
+            }
+        } else {
+            // 1 1 symbol_list(14bits)
+            chunk = 0xc000;
+            size = srs_min(kTwccFbTwoBitElements, nn_symbols - i);
+            for (int j = 0; j < size; ++j) {
+                chunk |= symbols_[i + j] << (2 * (kTwccFbTwoBitElements - 1 - j));
+            }
+        }
 
-    if (can_add_to_chunk(chunk, delta_size)) {
-        //pkt_len += needed_chunk_size;
-        add_to_chunk(chunk, delta_size);
-        return err;
-    }
-    if ((err = encode_chunk(chunk)) != srs_success) {
-        return srs_error_wrap(err, "encode chunk, delta_size %u", delta_size);
+        encoded_chucks_.push_back(chunk);
+        i += size;
     }
-    add_to_chunk(chunk, delta_size);
-    return err;
 }
 
 srs_error_t SrsRtcpTWCC::encode(SrsBuffer *buffer)
@@ -1023,7 +1035,7 @@ srs_error_t SrsRtcpTWCC::encode(SrsBuffer *buffer)
 
     err = do_encode(buffer);
 
-    if (err != srs_success || next_base_sn_ == 0) {
+    if (err != srs_success) {
         clear();
     }
 
@@ -1066,79 +1078,78 @@ srs_error_t SrsRtcpTWCC::do_encode(SrsBuffer *buffer)
         return srs_error_new(ERROR_RTC_RTCP, "requires %d bytes", nb_bytes());
     }
 
-    pkt_len = kTwccFbPktHeaderSize;
+    if (!nn_recv_) {
+        return srs_error_new(ERROR_RTC_RTCP, "no packet");
+    }
 
-    set<uint16_t, SrsSeqCompareLess>::iterator it_sn = recv_sns_.begin();
-    if (!next_base_sn_) {
-        base_sn_ = *it_sn;
-    } else {
-        base_sn_ = next_base_sn_;
-        it_sn = recv_sns_.find(base_sn_);
+    // The base must be a received packet, which is used as the reference time.
+    while (recv_deltas_[begin_sn_ & (kTwccRingSize - 1)] == kTwccRingEmpty) {
+        begin_sn_++;
     }
 
-    map<uint16_t, srs_utime_t>::iterator it_ts = recv_packets_.find(base_sn_);
-    srs_utime_t ts = it_ts->second;
+    base_sn_ = begin_sn_;
+    srs_utime_t ts = base_ts_ + recv_deltas_[base_sn_ & (kTwccRingSize - 1)];
 
     reference_time_ = (ts % kTwccFbReferenceTimeDivisor) / kTwccFbTimeMultiplier;
     srs_utime_t last_ts = (srs_utime_t)(reference_time_) * kTwccFbTimeMultiplier;
 
-    uint16_t last_sn = base_sn_;
-    uint16_t packet_count = 0;
-
-    // encode chunk
-    SrsRtcpTWCC::SrsRtcpTWCCChunk chunk;
-    for(; it_sn != recv_sns_.end(); ++it_sn) {
-        // check whether exceed buffer len
-        // max recv_delta_size = 2
-        if (pkt_len + 2 >= buffer->left()) {
-            break;
-        }
-
-        uint16_t current_sn = *it_sn;
-        // calculate delta
-        it_ts = recv_packets_.find(current_sn);
-        if (it_ts == recv_packets_.end()) {
-            continue;
-        }
+    // Build the status symbols and recv deltas from ring, until the packet is full. For the packet size, each chunk
+    // contains at least 7 symbols except the last one, and 3 bytes for padding.
+    int max_size = srs_min((int)nb_bytes(), buffer->left());
+    int nn_symbols = 0, nn_deltas = 0, deltas_size = 0;
+    int nn_reported = 0, nn_reported_deltas = 0;
+    for (uint16_t sn = base_sn_; sn != end_sn_; ++sn) {
+        uint32_t slot = recv_deltas_[sn & (kTwccRingSize - 1)];
+
+        int recv_delta_size = 0;
+        int16_t delta = 0;
+        if (slot != kTwccRingEmpty) {
+            srs_utime_t delta_us = calculate_delta_us(base_ts_ + slot, last_ts);
+            delta = delta_us;
+            // The delta exceeds the 16bits, report it in next feedback with new reference time.
+            if (delta != delta_us) {
+                break;
+            }
 
-        packet_count++;
-        srs_utime_t delta_us = calculate_delta_us(it_ts->second, last_ts);
-        int16_t delta = delta_us;
-        if(delta != delta_us) {
-            return srs_error_new(ERROR_RTC_RTCP, "twcc: delta:%" PRId64 ", exceeds the 16bits", delta_us);
+            // FIXME 24-bit base receive delta not supported
+            recv_delta_size = (delta >= 0 && delta <= 0xff) ? 1 : 2;
         }
 
-        if(current_sn > (last_sn + 1)) {
-            // lost packet
-            for(uint16_t lost_sn = last_sn + 1; lost_sn < current_sn; ++lost_sn) {
-                process_pkt_chunk(chunk, 0);
-                packet_count++;
-            }
+        int might_occupied = kTwccFbPktHeaderSize + ((nn_symbols + 1) / kTwccFbTwoBitElements + 2) * kTwccFbChunkBytes
+            + deltas_size + recv_delta_size + 3;
+        if (might_occupied > max_size) {
+            break;
         }
 
-        // FIXME 24-bit base receive delta not supported
-        int recv_delta_size = (delta >= 0 && delta <= 0xff) ? 1 : 2;
-        if ((err = process_pkt_chunk(chunk, recv_delta_size)) != srs_success) {
-            return srs_error_wrap(err, "delta_size %d, failed to append_recv_delta", recv_delta_size);
+        symbols_[nn_symbols++] = recv_delta_size;
+        if (!recv_delta_size) {
+            continue;
         }
 
-        pkt_deltas_.push_back(delta);
+        deltas_[nn_deltas++] = delta;
+        deltas_size += recv_delta_size;
         last_ts += delta * kTwccFbDeltaUnit;
-        pkt_len += recv_delta_size;
-        last_sn = current_sn;
 
-        recv_packets_.erase(it_ts);
+        // Never report the lost packets at the end, which might be received later.
+        nn_reported = nn_symbols;
+        nn_reported_deltas = nn_deltas;
     }
 
-    next_base_sn_ = 0;
-    if (it_sn != recv_sns_.end()) {
-        next_base_sn_ = *it_sn;
+    // Remove the reported packets from ring.
+    for (int i = 0; i < nn_reported; ++i) {
+        uint32_t& slot = recv_deltas_[begin_sn_++ & (kTwccRingSize - 1)];
+        if (slot != kTwccRingEmpty) {
+            slot = kTwccRingEmpty;
+            nn_recv_--;
+        }
     }
+    packet_count_ = nn_reported;
 
-    if(0 < chunk.size) {
-        if((err = encode_remaining_chunk(chunk)) != srs_success) {
-            return srs_error_wrap(err, "encode chunk");
-        }
+    encode_chunks(nn_reported);
+
+    int pkt_len = kTwccFbPktHeaderSize + encoded_chucks_.size() * kTwccFbChunkBytes;
+    for (int i = 0; i < nn_reported; ++i) {
+        pkt_len += symbols_[i];
     }
 
     // encode rtcp twcc packet
@@ -1155,32 +1166,22 @@ srs_error_t SrsRtcpTWCC::do_encode(SrsBuffer *buffer)
 
     buffer->write_4bytes(media_ssrc_);
     buffer->write_2bytes(base_sn_);
-    buffer->write_2bytes(packet_count);
+    buffer->write_2bytes(packet_count_);
     buffer->write_3bytes(reference_time_);
     buffer->write_1bytes(fb_pkt_count_);
 
-    int required_size = encoded_chucks_.size() * 2;
-    if(!buffer->require(required_size)) {
-        return srs_error_new(ERROR_RTC_RTCP, "encoded_chucks_[%d] requires %d bytes", (int)encoded_chucks_.size(), required_size);
-    }
-
     for(vector<uint16_t>::iterator it = encoded_chucks_.begin(); it != encoded_chucks_.end(); ++it) {
         buffer->write_2bytes(*it);
     }
 
-    required_size = pkt_deltas_.size() * 2;
-    if(!buffer->require(required_size)) {
-        return srs_error_new(ERROR_RTC_RTCP, "pkt_deltas_[%d] requires %d bytes", (int)pkt_deltas_.size(), required_size);
-    }
-
-    for(vector<uint16_t>::iterator it = pkt_deltas_.begin(); it != pkt_deltas_.end(); ++it) {
-        if(0 <= *it && 0xFF >= *it) {
+    for (int i = 0; i < nn_reported_deltas; ++i) {
+        int16_t delta = deltas_[i];
+        if(0 <= delta && 0xFF >= delta) {
             // small delta
-            uint8_t delta = *it;
             buffer->write_1bytes(delta);
         } else {
             // large or negative delta
-            buffer->write_2bytes(*it);
+            buffer->write_2bytes(delta);
         }
     }
 
@@ -1190,7 +1191,6 @@ srs_error_t SrsRtcpTWCC::do_encode(SrsBuffer *buffer)
     }
 
     encoded_chucks_.clear();
-    pkt_deltas_.clear();
 
     return err;
 }
@@ -1324,9 +1324,11 @@ srs_error_t SrsRtcpNack::encode(SrsBuffer *buffer)
                 pid = sn;
                 continue;
             }
-            if((sn - pid) < 1) {
+            // Note that the sequence might wrap around, for example, from 65535 to 0.
+            uint16_t distance = sn - pid;
+            if(distance < 1) {
                 srs_info("skip seq %d", sn);
-            } else if( (sn - pid) > 16) {
+            } else if(distance > 16) {
                 // append full chunk
                 chunks.push_back(chunk);
 
@@ -1336,7 +1338,7 @@ srs_error_t SrsRtcpNack::encode(SrsBuffer *buffer)
                 chunk.in_use = true;
                 pid = sn;
             } else {
-                chunk.blp |= 1 << (sn-pid-1);
+                chunk.blp |= 1 << (distance - 1);
             }
         }
         if(chunk.in_use) {
@@ -1835,3 +1837,117 @@ int SrsRtcpCompound::size()
     return nb_data_;
 }
 
+
+SrsRtcpBlock::SrsRtcpBlock()
+{
+    data = NULL;
+    nb_data = 0;
+    type = 0;
+    rc = 0;
+    ssrc = 0;
+}
+
+SrsRtcpBlock::~SrsRtcpBlock()
+{
+}
+
+srs_error_t SrsRtcpBlock::decode(SrsBuffer* buffer)
+{
+    if (!buffer->require(sizeof(SrsRtcpHeader))) {
+        return srs_error_new(ERROR_RTC_RTCP, "require %d", sizeof(SrsRtcpHeader));
+    }
+
+    SrsRtcpHeader* header = (SrsRtcpHeader*)buffer->head();
+    int length = (ntohs(header->length) + 1) * 4;
+    if (!buffer->require(length)) {
+        return srs_error_new(ERROR_RTC_RTCP, "require block len=%d, buffer left=%d", length, buffer->left());
+    }
+
+    data = buffer->head();
+    nb_data = length;
+    type = header->type;
+    rc = header->rc;
+
+    // For example, BYE with no SSRC.
+    ssrc = 0;
+    if (length >= 8) {
+        SrsBuffer b(data + 4, 4);
+        ssrc = b.read_4bytes();
+    }
+
+    buffer->skip(length);
+
+    return srs_success;
+}
+
+uint32_t SrsRtcpBlock::get_media_ssrc()
+{
+    if (nb_data < 12) {
+        return 0;
+    }
+
+    SrsBuffer b(data + 8, 4);
+    return b.read_4bytes();
+}
+
+uint32_t SrsRtcpBlock::get_rb_ssrc()
+{
+    // @doc https://tools.ietf.org/html/rfc3550#section-6.4.2
+    // An empty RR packet (RC = 0) MUST be put at the head of a compound
+    // RTCP packet when there is no data transmission or reception to
+    // report. e.g. {80 c9 00 01 00 00 00 01}
+    if (rc == 0 || nb_data < 12) {
+        return 0;
+    }
+
+    SrsBuffer b(data + 8, 4);
+    return b.read_4bytes();
+}
+
+SrsRtcpNackIterator::SrsRtcpNackIterator(SrsRtcpBlock* nack)
+    : fci_(nack->data + 12, srs_max(0, nack->nb_data - 12))
+{
+    pid_ = 0;
+    blp_ = 0;
+    bit_ = -1;
+}
+
+SrsRtcpNackIterator::~SrsRtcpNackIterator()
+{
+}
+
+bool SrsRtcpNackIterator::next(uint16_t& seq)
+{
+    /*
+    @doc: https://tools.ietf.org/html/rfc4585#section-6.2.1
+    0                   1                   2                   3
+    0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   |            PID                |             BLP               |
+   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    */
+    while (true) {
+        if (bit_ < 0) {
+            if (!fci_.require(4)) {
+                return false;
+            }
+
+            pid_ = fci_.read_2bytes();
+            blp_ = fci_.read_2bytes();
+            bit_ = 0;
+
+            seq = pid_;
+            return true;
+        }
+
+        while (bit_ < 16) {
+            int j = bit_++;
+            if (blp_ & (1 << j)) {
+                seq = pid_ + j + 1;
+                return true;
+            }
+        }
+
+        bit_ = -1;
+    }
+}
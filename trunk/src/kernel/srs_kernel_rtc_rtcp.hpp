@@ -269,45 +269,48 @@ public:
 #define kTwccFbLargeRecvDeltaBytes	2
 #define kTwccFbMaxBitElements 		kTwccFbOneBitElements
 
+// The size of TWCC ring, must be power of 2. The publisher sends feedback about every 50ms, so 4096 packets is
+// enough for 80Mbps video stream, and the older packets are dropped when ring is full.
+#define kTwccRingSize               4096
+// The slot of ring is empty, which means the packet is not received.
+#define kTwccRingEmpty              0xffffffff
+
 class SrsRtcpTWCC : public SrsRtcpFbCommon
 {
 private:
     uint16_t base_sn_;
+    uint16_t packet_count_;
     int32_t reference_time_;
     uint8_t fb_pkt_count_;
     std::vector<uint16_t> encoded_chucks_;
     std::vector<uint16_t> pkt_deltas_;
-
-    std::map<uint16_t, srs_utime_t> recv_packets_;
-    std::set<uint16_t, SrsSeqCompareLess> recv_sns_;
-
-    struct SrsRtcpTWCCChunk {
-        uint8_t delta_sizes[kTwccFbMaxBitElements];
-        uint16_t size;
-        bool all_same;
-        bool has_large_delta;
-        SrsRtcpTWCCChunk();
-    };
-
-    int pkt_len;
-    uint16_t next_base_sn_;
+private:
+    // The received packets in [begin_sn_, end_sn_), indexed by sn in ring, which holds the arrival time in us
+    // relative to base_ts_, or kTwccRingEmpty if not received.
+    uint32_t* recv_deltas_;
+    uint16_t begin_sn_;
+    uint16_t end_sn_;
+    // The number of received packets in ring.
+    int nn_recv_;
+    // The arrival time of ring, set by the first packet when ring is empty.
+    srs_utime_t base_ts_;
+private:
+    // The packet status symbols and recv deltas for encoding, to avoid allocation.
+    uint8_t* symbols_;
+    int16_t* deltas_;
 private:
     void clear();
     srs_utime_t calculate_delta_us(srs_utime_t ts, srs_utime_t last);
-    srs_error_t process_pkt_chunk(SrsRtcpTWCCChunk& chunk, int delta_size);
-    bool can_add_to_chunk(SrsRtcpTWCCChunk& chunk, int delta_size);
-    void add_to_chunk(SrsRtcpTWCCChunk& chunk, int delta_size);
-    srs_error_t encode_chunk(SrsRtcpTWCCChunk& chunk);
-    srs_error_t encode_chunk_run_length(SrsRtcpTWCCChunk& chunk);
-    srs_error_t encode_chunk_one_bit(SrsRtcpTWCCChunk& chunk);
-    srs_error_t encode_chunk_two_bit(SrsRtcpTWCCChunk& chunk, size_t size, bool shift);
-    void reset_chunk(SrsRtcpTWCCChunk& chunk);
-    srs_error_t encode_remaining_chunk(SrsRtcpTWCCChunk& chunk);
+    // Drop the first packets of ring, to make room for new packet.
+    void shrink_to(uint16_t sn);
+    // Encode the status symbols to chunks.
+    void encode_chunks(int nn_symbols);
 public:
     SrsRtcpTWCC(uint32_t sender_ssrc = 0);
     virtual ~SrsRtcpTWCC();
 
     uint16_t get_base_sn() const;
+    uint16_t get_packet_status_count() const;
     uint32_t get_reference_time() const;
     uint8_t get_feedback_count() const;
     std::vector<uint16_t> get_packet_chucks() const;
@@ -328,6 +331,7 @@ public:
     virtual uint64_t nb_bytes();
     virtual srs_error_t encode(SrsBuffer *buffer);   
 private:
+    srs_error_t do_decode(SrsBuffer *buffer);
     srs_error_t do_encode(SrsBuffer *buffer);
 };
 
@@ -444,5 +448,46 @@ public:
     virtual srs_error_t encode(SrsBuffer *buffer);
 };
 
+// The RTCP block in compound packet, parsed in place as a lightweight view of buffer, which never copies the
+// payload or allocates memory, to dispatch the RTCP feedback of players fast.
+class SrsRtcpBlock
+{
+public:
+    // The whole block in buffer, including the header.
+    char* data;
+    int nb_data;
+    uint8_t type;
+    uint8_t rc;
+    // The SSRC of packet sender, 0 if not present.
+    uint32_t ssrc;
+public:
+    SrsRtcpBlock();
+    virtual ~SrsRtcpBlock();
+public:
+    // Parse the block at the head of buffer, and skip it.
+    srs_error_t decode(SrsBuffer* buffer);
+    // For feedback RTPFB and PSFB, the SSRC of media source.
+    uint32_t get_media_ssrc();
+    // For RR, the SSRC of first report block, 0 if empty RR.
+    uint32_t get_rb_ssrc();
+};
+
+// Iterate the lost sequences of NACK block, from the PID and BLP pairs in place, without building a list.
+class SrsRtcpNackIterator
+{
+private:
+    SrsBuffer fci_;
+    uint16_t pid_;
+    uint16_t blp_;
+    // The next bit of BLP to check, or -1 for next PID.
+    int bit_;
+public:
+    SrsRtcpNackIterator(SrsRtcpBlock* nack);
+    virtual ~SrsRtcpNackIterator();
+public:
+    // Get the next lost sequence, return false if no more.
+    bool next(uint16_t& seq);
+};
+
 #endif
 
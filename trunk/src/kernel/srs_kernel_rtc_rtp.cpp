@@ -763,13 +763,32 @@ SrsRtpPacket::SrsRtpPacket()
     cached_payload_size = 0;
     decode_handler = NULL;
     avsync_time_ = -1;
+    recv_time_ = 0;
+    arena_ = NULL;
+    arena_ref_ = false;
 
     ++_srs_pps_objs_rtps->sugar;
 }
 
+void* SrsRtpPacket::operator new(size_t size)
+{
+    return srs_pool_alloc((int)size);
+}
+
+void SrsRtpPacket::operator delete(void* p)
+{
+    srs_pool_free(p);
+}
+
 SrsRtpPacket::~SrsRtpPacket()
 {
-    srs_freep(payload_);
+    // The payload is owned by arena, if packet is packaged in arena.
+    if (!arena_) {
+        srs_freep(payload_);
+    }
+    if (arena_ref_) {
+        srs_rtp_frame_arena_release(arena_);
+    }
     srs_freep(shared_buffer_);
 }
 
@@ -790,8 +809,7 @@ char* SrsRtpPacket::wrap(int size)
     // Create under-layer buffer for new message
     // For RTC, we use larger under-layer buffer for each packet.
     int nb_buffer = srs_max(size, kRtpPacketSize);
-    char* buf = new char[nb_buffer];
-    shared_buffer_->wrap(buf, nb_buffer);
+    shared_buffer_->wrap(nb_buffer);
 
     ++_srs_pps_objs_rbuf->sugar;
 
@@ -815,6 +833,7 @@ char* SrsRtpPacket::wrap(SrsSharedPtrMessage* msg)
     shared_buffer_ = msg->copy();
     // If we wrap a message, the size of packet equals to the message size.
     actual_buffer_size_ = shared_buffer_->size;
+    recv_time_ = msg->recv_time;
 
     return msg->payload;
 }
@@ -824,9 +843,17 @@ SrsRtpPacket* SrsRtpPacket::copy()
     SrsRtpPacket* cp = new SrsRtpPacket();
 
     cp->header = header;
-    cp->payload_ = payload_? payload_->copy():NULL;
     cp->payload_type_ = payload_type_;
 
+    // For packet in arena, share the payload and reference the arena, to avoid cloning the payload.
+    if (arena_) {
+        cp->payload_ = payload_;
+        cp->arena_ = arena_->ref();
+        cp->arena_ref_ = true;
+    } else {
+        cp->payload_ = payload_? payload_->copy():NULL;
+    }
+
     cp->nalu_type = nalu_type;
     cp->shared_buffer_ = shared_buffer_? shared_buffer_->copy2() : NULL;
     cp->actual_buffer_size_ = actual_buffer_size_;
@@ -837,10 +864,99 @@ SrsRtpPacket* SrsRtpPacket::copy()
     cp->decode_handler = decode_handler;
 
     cp->avsync_time_ = avsync_time_;
+    cp->recv_time_ = recv_time_;
 
     return cp;
 }
 
+// The size of block for arena, which is large enough for packets of a normal frame.
+#define SRS_RTP_ARENA_BLOCK 4096
+
+SrsRtpFrameArena::SrsRtpFrameArena(SrsSharedPtrMessage* msg)
+{
+    shared_count_ = 0;
+    msg_ = msg->copy();
+    pos_ = NULL;
+    left_ = 0;
+    objects_ = NULL;
+}
+
+SrsRtpFrameArena::~SrsRtpFrameArena()
+{
+    for (SrsRtpArenaObject* obj = objects_; obj;) {
+        SrsRtpArenaObject* next = obj->next;
+        obj->destroy((char*)obj + sizeof(SrsRtpArenaObject));
+        obj = next;
+    }
+
+    for (int i = 0; i < (int)blocks_.size(); i++) {
+        srs_pool_free(blocks_[i]);
+    }
+
+    srs_freep(msg_);
+}
+
+void* SrsRtpFrameArena::operator new(size_t size)
+{
+    return srs_pool_alloc((int)size);
+}
+
+void SrsRtpFrameArena::operator delete(void* p)
+{
+    srs_pool_free(p);
+}
+
+SrsRtpFrameArena* SrsRtpFrameArena::ref()
+{
+    shared_count_++;
+    return this;
+}
+
+char* SrsRtpFrameArena::alloc(int size)
+{
+    // Align to 16 bytes, because the block from pool is 16 bytes aligned.
+    size = (size + 15) & ~15;
+
+    if (left_ < size) {
+        int nb_block = srs_max(size, SRS_RTP_ARENA_BLOCK);
+        pos_ = srs_pool_alloc(nb_block);
+        left_ = nb_block;
+        blocks_.push_back(pos_);
+    }
+
+    char* p = pos_;
+    pos_ += size;
+    left_ -= size;
+
+    return p;
+}
+
+SrsRtpPacket* SrsRtpFrameArena::create_packet()
+{
+    SrsRtpPacket* pkt = create<SrsRtpPacket>();
+
+    // The packet is allocated in arena, so it never holds a reference of arena.
+    pkt->arena_ = this;
+    pkt->actual_buffer_size_ = msg_->size;
+    pkt->recv_time_ = msg_->recv_time;
+
+    return pkt;
+}
+
+void srs_rtp_frame_arena_release(SrsRtpFrameArena* arena)
+{
+    if (!arena) {
+        return;
+    }
+
+    if (arena->shared_count_ > 0) {
+        arena->shared_count_--;
+        return;
+    }
+
+    srs_freep(arena);
+}
+
 void SrsRtpPacket::set_padding(int size)
 {
     header.set_padding(size);
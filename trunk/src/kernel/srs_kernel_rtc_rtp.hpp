@@ -15,8 +15,10 @@
 #include <string>
 #include <list>
 #include <vector>
+#include <new>
 
 class SrsRtpPacket;
+class SrsRtpFrameArena;
 
 // The RTP packet max size, should never exceed this size.
 const int kRtpPacketSize        = 1500;
@@ -300,9 +302,21 @@ private:
     ISrsRtspPacketDecodeHandler* decode_handler;
 private:
     int64_t avsync_time_;
+    // The time when server received the packet, 0 if unknown, to stat the residence time in server.
+    srs_utime_t recv_time_;
+private:
+    // The arena of frame which owns the payload, NULL if packet owns the payload.
+    SrsRtpFrameArena* arena_;
+    // Whether packet holds a reference of arena, false if packet is allocated in arena.
+    bool arena_ref_;
+    friend class SrsRtpFrameArena;
 public:
     SrsRtpPacket();
     virtual ~SrsRtpPacket();
+public:
+    // The packet is allocated by pool, for it's created for each RTP packet.
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
 public:
     // Wrap buffer to shared_message, which is managed by us.
     char* wrap(int size);
@@ -337,8 +351,75 @@ public:
     bool is_keyframe();
     void set_avsync_time(int64_t avsync_time) { avsync_time_ = avsync_time; }
     int64_t get_avsync_time() const { return avsync_time_; }
+    void set_recv_time(srs_utime_t v) { recv_time_ = v; }
+    srs_utime_t recv_time() const { return recv_time_; }
+};
+
+// The header of object in arena, to destroy the object when arena is released.
+struct SrsRtpArenaObject
+{
+    void (*destroy)(void* p);
+    SrsRtpArenaObject* next;
+};
+
+// Destroy the object in arena, without freeing the memory.
+template<typename T>
+void srs_rtp_arena_destroy(void* p)
+{
+    ((T*)p)->~T();
+}
+
+// The arena of a frame for RTMP to RTC, which owns all the RTP packets and payloads packaged from the
+// frame. The objects are allocated in blocks of arena, and freed together when the last copy of packets
+// is freed, so the copies of packets for consumers share the payloads without cloning them.
+class SrsRtpFrameArena
+{
+private:
+    // The number of references except the creator.
+    int shared_count_;
+    // The shared message of frame, the payload of packets points to it.
+    SrsSharedPtrMessage* msg_;
+    // The blocks allocated from pool.
+    std::vector<char*> blocks_;
+    char* pos_;
+    int left_;
+    // The objects in arena, in reverse order of creation.
+    SrsRtpArenaObject* objects_;
+public:
+    // The arena copies the message, and should be released by srs_rtp_frame_arena_release.
+    SrsRtpFrameArena(SrsSharedPtrMessage* msg);
+    virtual ~SrsRtpFrameArena();
+public:
+    // The arena is allocated by pool, for it's created for each frame.
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
+public:
+    // Get a reference of arena, which should be released by srs_rtp_frame_arena_release.
+    SrsRtpFrameArena* ref();
+    // Allocate the bytes in arena, which is freed when arena is released.
+    char* alloc(int size);
+    // Create an object in arena, which is destroyed when arena is released.
+    template<typename T>
+    T* create()
+    {
+        char* p = alloc(sizeof(SrsRtpArenaObject) + sizeof(T));
+
+        SrsRtpArenaObject* obj = (SrsRtpArenaObject*)p;
+        obj->destroy = srs_rtp_arena_destroy<T>;
+        obj->next = objects_;
+        objects_ = obj;
+
+        // Note that we must use the global placement new, because the class may overload the operator new.
+        return ::new (p + sizeof(SrsRtpArenaObject)) T();
+    }
+    // Create a RTP packet in arena, which refers to the message of frame.
+    SrsRtpPacket* create_packet();
+    friend void srs_rtp_frame_arena_release(SrsRtpFrameArena* arena);
 };
 
+// Release the reference of arena, free it if no more references.
+extern void srs_rtp_frame_arena_release(SrsRtpFrameArena* arena);
+
 // Single payload data.
 class SrsRtpRawPayload : public ISrsRtpPayloader
 {
@@ -0,0 +1,794 @@
+//
+// Copyright (c) 2013-2024 The SRS Authors
+//
+// SPDX-License-Identifier: MIT or MulanPSL-2.0
+//
+
+#include <srs_core.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <srs_core_autofree.hpp>
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_stream.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_protocol_rtmp_stack.hpp>
+#include <srs_protocol_rtmp_conn.hpp>
+#include <srs_protocol_http_client.hpp>
+#include <srs_protocol_http_stack.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_protocol_log.hpp>
+#include <srs_protocol_st.hpp>
+#include <srs_app_st.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_threads.hpp>
+
+// @global log and context, created by srs_global_initialize.
+ISrsLog* _srs_log = NULL;
+ISrsContext* _srs_context = NULL;
+
+// @global config object for app module.
+SrsConfig* _srs_config = NULL;
+
+// @global Other variables.
+bool _srs_in_docker = false;
+bool _srs_config_by_env = false;
+
+// The binary name of SRS.
+const char* _srs_binary = NULL;
+
+// The frame rate and GOP of the synthetic stream, 25fps and 2s GOP.
+#define SRS_BENCH_FPS 25
+#define SRS_BENCH_GOP 50
+// The size of buffer to read HTTP-FLV or HLS body.
+#define SRS_BENCH_READ_BUFFER 16384
+
+// The AVC sequence header, high profile, level 3.2, 1920x1080.
+static uint8_t srs_bench_avc_sh[] = {
+    0x17, 0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20,
+    0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x32,
+    0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+};
+
+// Whether the RTMP message or FLV tag is an audio or video frame, not the metadata or sequence header.
+static bool srs_bench_is_frame(uint8_t type, char* data, int size)
+{
+    if (type == SrsFrameTypeVideo) {
+        return !SrsFlvVideo::sh(data, size);
+    }
+    if (type == SrsFrameTypeAudio) {
+        return !SrsFlvAudio::sh(data, size);
+    }
+    return false;
+}
+
+// The statistic of a kind of bench clients, updated by the coroutines.
+class SrsBenchStat
+{
+public:
+    std::string name;
+    int clients;
+    int connected;
+    int errors;
+    int64_t bytes;
+    // The number of audio and video frames, without sequence headers, or the files for HLS.
+    int64_t msgs;
+    // The first-frame latency, from starting to connect to the first audio or video frame.
+    int nn_ffl;
+    srs_utime_t ffl_min;
+    srs_utime_t ffl_max;
+    srs_utime_t ffl_total;
+public:
+    SrsBenchStat(std::string n) {
+        name = n;
+        clients = connected = errors = 0;
+        bytes = msgs = 0;
+        nn_ffl = 0;
+        ffl_min = ffl_max = ffl_total = 0;
+    }
+    void on_first_frame(srs_utime_t starttime) {
+        srs_utime_t ffl = srs_update_system_time() - starttime;
+        ffl_min = nn_ffl ? srs_min(ffl_min, ffl) : ffl;
+        ffl_max = srs_max(ffl_max, ffl);
+        ffl_total += ffl;
+        nn_ffl++;
+    }
+    SrsJsonObject* dumps(srs_utime_t elapsed) {
+        SrsJsonObject* obj = SrsJsonAny::object();
+        obj->set("clients", SrsJsonAny::integer(clients));
+        obj->set("connected", SrsJsonAny::integer(connected));
+        obj->set("errors", SrsJsonAny::integer(errors));
+        obj->set("bytes", SrsJsonAny::integer(bytes));
+        obj->set("msgs", SrsJsonAny::integer(msgs));
+
+        double seconds = srs_max(1, srsu2ms(elapsed)) / 1000.0;
+        obj->set("kbps", SrsJsonAny::integer((int64_t)(bytes * 8 / 1000 / seconds)));
+
+        // The publishers have no first frame.
+        if (!nn_ffl) {
+            return obj;
+        }
+
+        SrsJsonObject* ffl = SrsJsonAny::object();
+        obj->set("first_frame_ms", ffl);
+        ffl->set("count", SrsJsonAny::integer(nn_ffl));
+        ffl->set("min", SrsJsonAny::integer(srsu2msi(ffl_min)));
+        ffl->set("avg", SrsJsonAny::integer(srsu2msi(ffl_total / nn_ffl)));
+        ffl->set("max", SrsJsonAny::integer(srsu2msi(ffl_max)));
+        return obj;
+    }
+};
+
+// The base of bench clients, each client is a coroutine.
+class SrsBenchClient : public ISrsCoroutineHandler
+{
+protected:
+    std::string url;
+    SrsBenchStat* stat;
+    srs_utime_t delay;
+    srs_utime_t starttime;
+private:
+    SrsCoroutine* trd;
+public:
+    SrsBenchClient(std::string u, SrsBenchStat* s, srs_utime_t d) {
+        url = u;
+        stat = s;
+        delay = d;
+        starttime = 0;
+        trd = new SrsSTCoroutine("bench", this);
+    }
+    virtual ~SrsBenchClient() {
+        srs_freep(trd);
+    }
+public:
+    srs_error_t start() {
+        stat->clients++;
+        return trd->start();
+    }
+    void stop() {
+        trd->stop();
+    }
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle() {
+        srs_error_t err = srs_success;
+
+        // Ramp up, to avoid connecting to the server at the same time.
+        if (delay > 0) {
+            srs_usleep(delay);
+        }
+        if ((err = trd->pull()) != srs_success) {
+            srs_freep(err);
+            return srs_success;
+        }
+
+        starttime = srs_update_system_time();
+        if ((err = do_cycle()) != srs_success) {
+            // Ignore the error when quit by stop().
+            if (trd->pull() == srs_success) {
+                stat->errors++;
+                srs_warn("bench: %s %s failed, %s", stat->name.c_str(), url.c_str(), srs_error_desc(err).c_str());
+            }
+            srs_freep(err);
+        }
+
+        return srs_success;
+    }
+protected:
+    virtual srs_error_t do_cycle() = 0;
+    srs_error_t pull() {
+        return trd->pull();
+    }
+};
+
+// Publish a synthetic H.264 stream by RTMP.
+class SrsBenchRtmpPublisher : public SrsBenchClient
+{
+private:
+    int frame_size;
+public:
+    SrsBenchRtmpPublisher(std::string u, SrsBenchStat* s, srs_utime_t d, int size) : SrsBenchClient(u, s, d) {
+        frame_size = srs_max(16, size);
+    }
+    virtual ~SrsBenchRtmpPublisher() {
+    }
+protected:
+    virtual srs_error_t do_cycle() {
+        srs_error_t err = srs_success;
+
+        SrsBasicRtmpClient sdk(url, SRS_CONSTS_RTMP_TIMEOUT, SRS_CONSTS_RTMP_TIMEOUT);
+        if ((err = sdk.connect()) != srs_success) {
+            return srs_error_wrap(err, "connect");
+        }
+        if ((err = sdk.publish(SRS_CONSTS_RTMP_SRS_CHUNK_SIZE)) != srs_success) {
+            return srs_error_wrap(err, "publish");
+        }
+        stat->connected++;
+
+        if ((err = send_video(&sdk, 0, (char*)srs_bench_avc_sh, sizeof(srs_bench_avc_sh))) != srs_success) {
+            return srs_error_wrap(err, "send sequence header");
+        }
+
+        // The frame is FLV video tag header(5B), NALU size(4B), then the NALU.
+        char* frame = new char[frame_size];
+        SrsAutoFreeA(char, frame);
+        memset(frame, 0, frame_size);
+        SrsBuffer b(frame, frame_size);
+        b.skip(5);
+        b.write_4bytes(frame_size - 9);
+
+        for (int64_t nn_frames = 0; (err = pull()) == srs_success; nn_frames++) {
+            bool keyframe = (nn_frames % SRS_BENCH_GOP) == 0;
+            frame[0] = keyframe ? 0x17 : 0x27;
+            frame[1] = 0x01;
+            frame[9] = keyframe ? 0x65 : 0x41;
+
+            // Pace the frames by wall clock, and the timestamp is the elapsed time.
+            srs_utime_t pts = nn_frames * SRS_UTIME_SECONDS / SRS_BENCH_FPS;
+            srs_utime_t elapsed = srs_update_system_time() - starttime;
+            if (pts > elapsed) {
+                srs_usleep(pts - elapsed);
+            }
+
+            if ((err = send_video(&sdk, (uint32_t)srsu2ms(pts), frame, frame_size)) != srs_success) {
+                return srs_error_wrap(err, "send frame");
+            }
+            stat->msgs++;
+        }
+
+        return err;
+    }
+private:
+    srs_error_t send_video(SrsBasicRtmpClient* sdk, uint32_t timestamp, char* data, int size) {
+        srs_error_t err = srs_success;
+
+        // The message takes the ownership of payload.
+        char* payload = new char[size];
+        memcpy(payload, data, size);
+
+        SrsSharedPtrMessage* msg = NULL;
+        if ((err = srs_rtmp_create_msg(SrsFrameTypeVideo, timestamp, payload, size, sdk->sid(), &msg)) != srs_success) {
+            return srs_error_wrap(err, "create message");
+        }
+
+        if ((err = sdk->send_and_free_message(msg)) != srs_success) {
+            return srs_error_wrap(err, "send message");
+        }
+
+        stat->bytes += size;
+
+        return err;
+    }
+};
+
+// Play the stream by RTMP.
+class SrsBenchRtmpPlayer : public SrsBenchClient
+{
+public:
+    SrsBenchRtmpPlayer(std::string u, SrsBenchStat* s, srs_utime_t d) : SrsBenchClient(u, s, d) {
+    }
+    virtual ~SrsBenchRtmpPlayer() {
+    }
+protected:
+    virtual srs_error_t do_cycle() {
+        srs_error_t err = srs_success;
+
+        SrsBasicRtmpClient sdk(url, SRS_CONSTS_RTMP_TIMEOUT, SRS_CONSTS_RTMP_TIMEOUT);
+        if ((err = sdk.connect()) != srs_success) {
+            return srs_error_wrap(err, "connect");
+        }
+        if ((err = sdk.play(SRS_CONSTS_RTMP_SRS_CHUNK_SIZE)) != srs_success) {
+            return srs_error_wrap(err, "play");
+        }
+        stat->connected++;
+
+        bool got_frame = false;
+        while ((err = pull()) == srs_success) {
+            SrsCommonMessage* msg = NULL;
+            if ((err = sdk.recv_message(&msg)) != srs_success) {
+                return srs_error_wrap(err, "recv message");
+            }
+            SrsAutoFree(SrsCommonMessage, msg);
+
+            stat->bytes += msg->size;
+
+            // Only the audio or video frame counts, ignore the metadata and sequence headers.
+            if (!srs_bench_is_frame(msg->header.message_type, msg->payload, msg->size)) {
+                continue;
+            }
+
+            if (!got_frame) {
+                got_frame = true;
+                stat->on_first_frame(starttime);
+            }
+            stat->msgs++;
+        }
+
+        return err;
+    }
+};
+
+// Play the stream by HTTP-FLV.
+class SrsBenchFlvPlayer : public SrsBenchClient
+{
+public:
+    SrsBenchFlvPlayer(std::string u, SrsBenchStat* s, srs_utime_t d) : SrsBenchClient(u, s, d) {
+    }
+    virtual ~SrsBenchFlvPlayer() {
+    }
+protected:
+    virtual srs_error_t do_cycle() {
+        srs_error_t err = srs_success;
+
+        SrsHttpUri uri;
+        if ((err = uri.initialize(url)) != srs_success) {
+            return srs_error_wrap(err, "parse %s", url.c_str());
+        }
+
+        SrsHttpClient hc;
+        if ((err = hc.initialize(uri.get_schema(), uri.get_host(), uri.get_port())) != srs_success) {
+            return srs_error_wrap(err, "http client");
+        }
+
+        std::string path = uri.get_path();
+        if (!uri.get_query().empty()) {
+            path += "?" + uri.get_query();
+        }
+
+        ISrsHttpMessage* res = NULL;
+        if ((err = hc.get(path, "", &res)) != srs_success) {
+            return srs_error_wrap(err, "get %s", url.c_str());
+        }
+        SrsAutoFree(ISrsHttpMessage, res);
+
+        if (res->status_code() != SRS_CONSTS_HTTP_OK) {
+            return srs_error_new(ERROR_HTTP_STATUS_INVALID, "status=%d", res->status_code());
+        }
+        stat->connected++;
+
+        // The FLV header is 9B header and 4B previous tag size, the first tag follows it.
+        const int flv_header_size = 13;
+
+        // The FLV tag is 11B header, the data, then 4B previous tag size.
+        const int flv_tag_header_size = 11;
+
+        char* buf = new char[SRS_BENCH_READ_BUFFER];
+        SrsAutoFreeA(char, buf);
+
+        SrsSimpleStream stream;
+        bool got_header = false, got_frame = false;
+        ISrsHttpResponseReader* br = res->body_reader();
+        while ((err = pull()) == srs_success && !br->eof()) {
+            ssize_t nread = 0;
+            if ((err = br->read(buf, SRS_BENCH_READ_BUFFER, &nread)) != srs_success) {
+                return srs_error_wrap(err, "read body");
+            }
+            stream.append(buf, (int)nread);
+            stat->bytes += nread;
+
+            if (!got_header) {
+                if (stream.length() < flv_header_size) {
+                    continue;
+                }
+                stream.erase(flv_header_size);
+                got_header = true;
+            }
+
+            // Parse the complete tags, and left the partial tag to next read.
+            while (stream.length() >= flv_tag_header_size) {
+                SrsBuffer b(stream.bytes(), stream.length());
+                uint8_t type = b.read_1bytes() & 0x1f;
+                int size = b.read_3bytes();
+
+                int nb_tag = flv_tag_header_size + size + 4;
+                if (stream.length() < nb_tag) {
+                    break;
+                }
+
+                // Only the audio or video frame counts, ignore the metadata and sequence headers.
+                if (srs_bench_is_frame(type, stream.bytes() + flv_tag_header_size, size)) {
+                    if (!got_frame) {
+                        got_frame = true;
+                        stat->on_first_frame(starttime);
+                    }
+                    stat->msgs++;
+                }
+
+                stream.erase(nb_tag);
+            }
+        }
+
+        return err;
+    }
+};
+
+// Play the stream by HLS, refresh the m3u8 and download the new ts files.
+class SrsBenchHlsPlayer : public SrsBenchClient
+{
+private:
+    SrsHttpUri uri;
+    std::string m3u8_path;
+    std::string last_ts;
+    bool got_frame;
+public:
+    SrsBenchHlsPlayer(std::string u, SrsBenchStat* s, srs_utime_t d) : SrsBenchClient(u, s, d) {
+        got_frame = false;
+    }
+    virtual ~SrsBenchHlsPlayer() {
+    }
+protected:
+    virtual srs_error_t do_cycle() {
+        srs_error_t err = srs_success;
+
+        if ((err = uri.initialize(url)) != srs_success) {
+            return srs_error_wrap(err, "parse %s", url.c_str());
+        }
+        m3u8_path = uri.get_path() + (uri.get_query().empty() ? "" : "?" + uri.get_query());
+
+        bool connected = false;
+        while ((err = pull()) == srs_success) {
+            // Retry util the m3u8 is generated, because HLS is not ready when publish starts.
+            std::string m3u8;
+            if ((err = fetch(m3u8_path, &m3u8)) != srs_success) {
+                if (connected) {
+                    return srs_error_wrap(err, "fetch m3u8");
+                }
+                srs_freep(err);
+                srs_usleep(1 * SRS_UTIME_SECONDS);
+                continue;
+            }
+
+            if (!connected) {
+                connected = true;
+                stat->connected++;
+            }
+
+            // Download the ts files after the last one.
+            std::vector<std::string> pieces;
+            std::vector<std::string> lines = srs_string_split(m3u8, "\n");
+            for (int i = 0; i < (int)lines.size(); i++) {
+                std::string line = srs_string_trim_end(lines.at(i), "\r");
+                if (line.empty() || line.at(0) == '#') {
+                    continue;
+                }
+                pieces.push_back(line);
+            }
+
+            // Follow the variant m3u8, for example, SRS redirects to the m3u8 with hls_ctx.
+            if (!pieces.empty() && srs_string_ends_with(srs_string_split(pieces.at(0), "?").at(0), ".m3u8")) {
+                m3u8_path = resolve(pieces.at(0));
+                last_ts = "";
+                continue;
+            }
+
+            bool found = last_ts.empty();
+            for (int i = 0; i < (int)pieces.size(); i++) {
+                std::string ts = pieces.at(i);
+                if (!found) {
+                    found = (ts == last_ts);
+                    continue;
+                }
+
+                // Start from the last ts when play, like a player.
+                if (last_ts.empty() && i < (int)pieces.size() - 1) {
+                    continue;
+                }
+
+                if ((err = fetch(resolve(ts), NULL)) != srs_success) {
+                    return srs_error_wrap(err, "fetch %s", ts.c_str());
+                }
+                last_ts = ts;
+            }
+
+            // The last ts is out of the m3u8, start over.
+            if (!found) {
+                last_ts = "";
+            }
+
+            srs_usleep(1 * SRS_UTIME_SECONDS);
+        }
+
+        return err;
+    }
+private:
+    std::string resolve(std::string ts) {
+        if (srs_string_starts_with(ts, "http://", "https://")) {
+            SrsHttpUri tu;
+            if (tu.initialize(ts) == srs_success) {
+                return tu.get_path() + (tu.get_query().empty() ? "" : "?" + tu.get_query());
+            }
+        }
+        if (srs_string_starts_with(ts, "/")) {
+            return ts;
+        }
+        return srs_path_dirname(uri.get_path()) + "/" + ts;
+    }
+    srs_error_t fetch(std::string path, std::string* pbody) {
+        srs_error_t err = srs_success;
+
+        SrsHttpClient hc;
+        if ((err = hc.initialize(uri.get_schema(), uri.get_host(), uri.get_port())) != srs_success) {
+            return srs_error_wrap(err, "http client");
+        }
+
+        ISrsHttpMessage* res = NULL;
+        if ((err = hc.get(path, "", &res)) != srs_success) {
+            return srs_error_wrap(err, "get %s", path.c_str());
+        }
+        SrsAutoFree(ISrsHttpMessage, res);
+
+        if (res->status_code() != SRS_CONSTS_HTTP_OK) {
+            return srs_error_new(ERROR_HTTP_STATUS_INVALID, "get %s status=%d", path.c_str(), res->status_code());
+        }
+
+        std::string body;
+        if ((err = res->body_read_all(body)) != srs_success) {
+            return srs_error_wrap(err, "read %s", path.c_str());
+        }
+
+        stat->bytes += body.length();
+        stat->msgs++;
+
+        // The first ts is the first frame of HLS.
+        if (!pbody && !got_frame) {
+            got_frame = true;
+            stat->on_first_frame(starttime);
+        }
+
+        if (pbody) {
+            *pbody = body;
+        }
+
+        return err;
+    }
+};
+
+srs_error_t do_bench(std::string rtmp, std::string flv, std::string hls, std::string api, int nn_publishers,
+    int nn_players, int nn_flvs, int nn_hlss, srs_utime_t duration, srs_utime_t interval, int frame_size);
+
+/**
+ * main entrance.
+ */
+int main(int argc, char** argv)
+{
+    srs_assert(srs_is_little_endian());
+
+    _srs_binary = argv[0];
+
+    // directly failed when compile limited.
+#if defined(SRS_GPERF_MC) || defined(SRS_GPERF_MP) || defined(SRS_GPERF_CP) || defined(SRS_GPROF)
+    fprintf(stderr, "donot support gmc/gmp/gcp/gprof\n");
+    exit(-1);
+#endif
+
+    // parse user options.
+    std::string rtmp, flv, hls, api;
+    int nn_publishers = 0, nn_players = 0, nn_flvs = 0, nn_hlss = 0;
+    int duration = 30, interval = 1, frame_size = 10240;
+    for (int opt = 0; opt < argc - 1; opt++) {
+        // only accept -x
+        char* p = argv[opt];
+        if (p[0] != '-' || p[1] == 0 || p[2] != 0) {
+            continue;
+        }
+
+        // parse according the option name.
+        switch (p[1]) {
+            case 'r': rtmp = argv[opt + 1]; break;
+            case 'f': flv = argv[opt + 1]; break;
+            case 's': hls = argv[opt + 1]; break;
+            case 'i': api = argv[opt + 1]; break;
+            case 'p': nn_publishers = ::atoi(argv[opt + 1]); break;
+            case 'c': nn_players = ::atoi(argv[opt + 1]); break;
+            case 'l': nn_flvs = ::atoi(argv[opt + 1]); break;
+            case 'n': nn_hlss = ::atoi(argv[opt + 1]); break;
+            case 'd': duration = ::atoi(argv[opt + 1]); break;
+            case 'a': interval = ::atoi(argv[opt + 1]); break;
+            case 'b': frame_size = ::atoi(argv[opt + 1]); break;
+            default: break;
+        }
+    }
+
+    bool invalid = (nn_publishers + nn_players + nn_flvs + nn_hlss) <= 0 || duration <= 0;
+    invalid = invalid || ((nn_publishers || nn_players) && rtmp.empty()) || (nn_flvs && flv.empty()) || (nn_hlss && hls.empty());
+    if (invalid) {
+        printf("bench SRS by RTMP publish/play, HTTP-FLV and HLS clients, report JSON to stdout\n"
+               "Usage: %s [-r rtmp_url] [-f flv_url] [-s hls_url] [-p publishers] [-c players]\n"
+               "          [-l flv_players] [-n hls_players] [-d duration] [-a interval] [-b frame_size] [-i api_url]\n"
+               "   rtmp_url        the RTMP url to publish and play, %%d is replaced by the stream index.\n"
+               "   flv_url         the HTTP-FLV url to play, %%d is replaced by the stream index.\n"
+               "   hls_url         the HLS m3u8 url to play, %%d is replaced by the stream index.\n"
+               "   publishers      the number of RTMP publishers, each sends a synthetic H.264 stream.\n"
+               "   players         the number of RTMP players.\n"
+               "   flv_players     the number of HTTP-FLV players.\n"
+               "   hls_players     the number of HLS players.\n"
+               "   duration        the duration in seconds to bench, default 30.\n"
+               "   interval        the interval in ms between starting clients, default 1.\n"
+               "   frame_size      the bytes of each video frame to publish, default 10240.\n"
+               "   api_url         the HTTP API summaries of server, to report the CPU of server.\n"
+               "For example:\n"
+               "   %s -r rtmp://127.0.0.1/live/livestream -p 1 -c 1000\n"
+               "   %s -r rtmp://127.0.0.1/live/bench%%d -p 10 -f http://127.0.0.1:8080/live/bench%%d.flv -l 1000\n"
+               "   %s -s http://127.0.0.1:8080/live/livestream.m3u8 -n 1000 -d 60\n"
+               "   %s -r rtmp://127.0.0.1/live/livestream -p 1 -c 1000 -i http://127.0.0.1:1985/api/v1/summaries\n",
+               argv[0], argv[0], argv[0], argv[0], argv[0]);
+        exit(-1);
+    }
+
+    srs_error_t err = do_bench(rtmp, flv, hls, api, nn_publishers, nn_players, nn_flvs, nn_hlss,
+        duration * SRS_UTIME_SECONDS, interval * SRS_UTIME_MILLISECONDS, frame_size);
+    if (err != srs_success) {
+        fprintf(stderr, "bench failed, %s\n", srs_error_desc(err).c_str());
+    }
+
+    int ret = srs_error_code(err);
+    srs_freep(err);
+    return ret;
+}
+
+// Get the url for client, replace the %d by the stream index.
+static std::string srs_bench_url(std::string url, int index, int nn_streams)
+{
+    int stream = nn_streams > 0 ? index % nn_streams : index;
+    return srs_string_replace(url, "%d", srs_int2str(stream));
+}
+
+static srs_utime_t srs_bench_cpu_time()
+{
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) {
+        return 0;
+    }
+    return ru.ru_utime.tv_sec * SRS_UTIME_SECONDS + ru.ru_utime.tv_usec
+        + ru.ru_stime.tv_sec * SRS_UTIME_SECONDS + ru.ru_stime.tv_usec;
+}
+
+// Get the CPU percent of server from the HTTP API summaries, which is sampled by server periodically.
+static srs_error_t srs_bench_server_cpu(std::string api, double* ppercent)
+{
+    srs_error_t err = srs_success;
+
+    SrsHttpUri uri;
+    if ((err = uri.initialize(api)) != srs_success) {
+        return srs_error_wrap(err, "parse %s", api.c_str());
+    }
+
+    SrsHttpClient hc;
+    if ((err = hc.initialize(uri.get_schema(), uri.get_host(), uri.get_port())) != srs_success) {
+        return srs_error_wrap(err, "http client");
+    }
+
+    ISrsHttpMessage* res = NULL;
+    if ((err = hc.get(uri.get_path(), "", &res)) != srs_success) {
+        return srs_error_wrap(err, "get %s", api.c_str());
+    }
+    SrsAutoFree(ISrsHttpMessage, res);
+
+    std::string body;
+    if ((err = res->body_read_all(body)) != srs_success) {
+        return srs_error_wrap(err, "read body");
+    }
+
+    SrsJsonAny* info = SrsJsonAny::loads(body);
+    if (!info || !info->is_object()) {
+        srs_freep(info);
+        return srs_error_new(ERROR_HTTP_DATA_INVALID, "invalid summaries %s", body.c_str());
+    }
+    SrsAutoFree(SrsJsonAny, info);
+
+    // The summaries is {data:{self:{cpu_percent}}}, and the cpu_percent is a ratio.
+    SrsJsonAny* data = info->to_object()->ensure_property_object("data");
+    SrsJsonAny* self = data ? data->to_object()->ensure_property_object("self") : NULL;
+    SrsJsonAny* percent = self ? self->to_object()->ensure_property_number("cpu_percent") : NULL;
+    if (!percent) {
+        return srs_error_new(ERROR_HTTP_DATA_INVALID, "no cpu_percent in %s", body.c_str());
+    }
+
+    *ppercent = 100.0 * percent->to_number();
+    return err;
+}
+
+srs_error_t do_bench(std::string rtmp, std::string flv, std::string hls, std::string api, int nn_publishers,
+    int nn_players, int nn_flvs, int nn_hlss, srs_utime_t duration, srs_utime_t interval, int frame_size)
+{
+    srs_error_t err = srs_success;
+
+    // Initialize global objects and ST, which the SRS protocol stack depends on.
+    if ((err = srs_global_initialize()) != srs_success) {
+        return srs_error_wrap(err, "init global");
+    }
+
+    // Only warnings and errors to stderr, so the stdout is the JSON report.
+    srs_freep(_srs_log);
+    _srs_log = new SrsConsoleLog(SrsLogLevelWarn, false);
+
+    if ((err = srs_st_init()) != srs_success) {
+        return srs_error_wrap(err, "initialize st");
+    }
+
+    SrsBenchStat publish("rtmp_publish"), play("rtmp_play"), http_flv("http_flv"), http_hls("hls");
+    std::vector<SrsBenchClient*> clients;
+
+    // The players use the same streams as publishers.
+    srs_utime_t delay = 0;
+    for (int i = 0; i < nn_publishers; i++, delay += interval) {
+        clients.push_back(new SrsBenchRtmpPublisher(srs_bench_url(rtmp, i, 0), &publish, delay, frame_size));
+    }
+    for (int i = 0; i < nn_players; i++, delay += interval) {
+        clients.push_back(new SrsBenchRtmpPlayer(srs_bench_url(rtmp, i, nn_publishers), &play, delay));
+    }
+    for (int i = 0; i < nn_flvs; i++, delay += interval) {
+        clients.push_back(new SrsBenchFlvPlayer(srs_bench_url(flv, i, nn_publishers), &http_flv, delay));
+    }
+    for (int i = 0; i < nn_hlss; i++, delay += interval) {
+        clients.push_back(new SrsBenchHlsPlayer(srs_bench_url(hls, i, nn_publishers), &http_hls, delay));
+    }
+
+    srs_utime_t starttime = srs_update_system_time();
+    srs_utime_t start_cpu = srs_bench_cpu_time();
+
+    for (int i = 0; i < (int)clients.size(); i++) {
+        if ((err = clients.at(i)->start()) != srs_success) {
+            break;
+        }
+    }
+
+    if (err == srs_success) {
+        srs_usleep(duration);
+    }
+
+    // Sample the CPU of server before clients stop, when the server is still under load.
+    double server_cpu = -1;
+    if (err == srs_success && !api.empty()) {
+        if ((err = srs_bench_server_cpu(api, &server_cpu)) != srs_success) {
+            srs_warn("ignore server cpu, %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+    }
+
+    for (int i = 0; i < (int)clients.size(); i++) {
+        SrsBenchClient* client = clients.at(i);
+        client->stop();
+        srs_freep(client);
+    }
+
+    if (err != srs_success) {
+        return srs_error_wrap(err, "start client");
+    }
+
+    srs_utime_t elapsed = srs_update_system_time() - starttime;
+    srs_utime_t cpu = srs_bench_cpu_time() - start_cpu;
+
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+
+    obj->set("duration_ms", SrsJsonAny::integer(srsu2msi(elapsed)));
+    // The CPU of bench itself, which is not the CPU of server.
+    obj->set("client_cpu_percent", SrsJsonAny::number(elapsed > 0 ? 100.0 * cpu / elapsed : 0));
+    if (server_cpu >= 0) {
+        obj->set("server_cpu_percent", SrsJsonAny::number(server_cpu));
+    }
+
+    SrsBenchStat* stats[] = {&publish, &play, &http_flv, &http_hls};
+    for (int i = 0; i < (int)(sizeof(stats) / sizeof(SrsBenchStat*)); i++) {
+        SrsBenchStat* stat = stats[i];
+        if (stat->clients) {
+            obj->set(stat->name, stat->dumps(elapsed));
+        }
+    }
+
+    printf("%s\n", obj->dumps().c_str());
+
+    return err;
+}
@@ -42,6 +42,7 @@ using namespace std;
 #include <srs_kernel_file.hpp>
 #include <srs_app_hybrid.hpp>
 #include <srs_app_threads.hpp>
+#include <srs_app_workers.hpp>
 #include <srs_kernel_error.hpp>
 
 #ifdef SRS_RTC
@@ -471,6 +472,12 @@ srs_error_t run_in_thread_pool()
         return srs_error_wrap(err, "init thread pool");
     }
 
+    // Fork the stream workers, before starting any thread, and each worker has its own threads. Note that the ST
+    // of primordial thread is shared by workers, which only sleeps and never waits on any fd.
+    if ((err = _srs_stream_workers->initialize()) != srs_success) {
+        return srs_error_wrap(err, "init workers");
+    }
+
     // Start the hybrid service worker thread, for RTMP and RTC server, etc.
     if ((err = _srs_thread_pool->execute("hybrid", run_hybrid_server, (void*)NULL)) != srs_success) {
         return srs_error_wrap(err, "start hybrid server thread");
@@ -490,12 +497,17 @@ srs_error_t run_hybrid_server(void* /*arg*/)
     // Create servers and register them.
     _srs_hybrid->register_server(new SrsServerAdapter());
 
+    // The UDP servers are not sharded by workers, so only served by master worker.
 #ifdef SRS_SRT
-    _srs_hybrid->register_server(new SrsSrtServerAdapter());
+    if (_srs_stream_workers->is_master()) {
+        _srs_hybrid->register_server(new SrsSrtServerAdapter());
+    }
 #endif
 
 #ifdef SRS_RTC
-    _srs_hybrid->register_server(new RtcServerAdapter());
+    if (_srs_stream_workers->is_master()) {
+        _srs_hybrid->register_server(new RtcServerAdapter());
+    }
 #endif
 
     // Do some system initialize.
@@ -7,6 +7,8 @@
 #include <srs_protocol_http_conn.hpp>
 
 #include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
 #include <sstream>
 using namespace std;
 
@@ -776,6 +778,68 @@ srs_error_t SrsHttpMessageWriter::write(char* data, int size)
     return err;
 }
 
+srs_error_t SrsHttpMessageWriter::sendfile(int fd, int64_t offset, int64_t size, int64_t* pnwrite)
+{
+    srs_error_t err = srs_success;
+
+    // write the header data in memory.
+    if (!header_wrote_) {
+        if (hdr->content_type().empty()) {
+            hdr->set_content_type("text/plain; charset=utf-8");
+        }
+        if (hdr->content_length() == -1) {
+            hdr->set_content_length(size);
+        }
+        flw_->write_default_header();
+    }
+
+    // whatever header is wrote, we should try to send header.
+    if ((err = send_header(NULL, 0)) != srs_success) {
+        return srs_error_wrap(err, "send header");
+    }
+
+    // Send by kernel without copying, only for content length, because chunked encoding requires the chunk
+    // header for each write.
+    ISrsSendfileWriter* sw = dynamic_cast<ISrsSendfileWriter*>(skt);
+    if (sw && content_length != -1) {
+        written += size;
+        if (written > content_length) {
+            return srs_error_new(ERROR_HTTP_CONTENT_LENGTH, "overflow writen=%" PRId64 ", max=%" PRId64, written, content_length);
+        }
+
+        if ((err = sw->sendfile(fd, offset, size, pnwrite)) != srs_success) {
+            return srs_error_wrap(err, "sendfile");
+        }
+        return err;
+    }
+
+    // Fallback to read the file and write to socket, for example, over TLS.
+    char* buf = new char[SRS_HTTP_SENDFILE_BUFFER_SIZE];
+    SrsAutoFreeA(char, buf);
+
+    int64_t left = size;
+    while (left > 0) {
+        ssize_t nn = ::pread(fd, buf, (size_t)srs_min(left, (int64_t)SRS_HTTP_SENDFILE_BUFFER_SIZE), offset + size - left);
+        if (nn < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nn <= 0) {
+            return srs_error_new(ERROR_SYSTEM_FILE_READ, "pread fd=%d, offset=%" PRId64 ", left=%" PRId64, fd, offset, left);
+        }
+
+        if ((err = write(buf, (int)nn)) != srs_success) {
+            return srs_error_wrap(err, "write");
+        }
+        left -= nn;
+    }
+
+    if (pnwrite) {
+        *pnwrite = size;
+    }
+
+    return err;
+}
+
 srs_error_t SrsHttpMessageWriter::writev(const iovec* iov, int iovcnt, ssize_t* pnwrite)
 {
     srs_error_t err = srs_success;
@@ -960,6 +1024,11 @@ srs_error_t SrsHttpResponseWriter::writev(const iovec* iov, int iovcnt, ssize_t*
     return writer_->writev(iov, iovcnt, pnwrite);
 }
 
+srs_error_t SrsHttpResponseWriter::sendfile(int fd, int64_t offset, int64_t size, int64_t* nwrite)
+{
+    return writer_->sendfile(fd, offset, size, nwrite);
+}
+
 void SrsHttpResponseWriter::write_header(int code)
 {
     if (writer_->header_wrote()) {
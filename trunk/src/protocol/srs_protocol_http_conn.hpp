@@ -13,6 +13,7 @@
 #include <sstream>
 
 #include <srs_protocol_http_stack.hpp>
+#include <srs_protocol_io.hpp>
 
 class ISrsConnection;
 class SrsFastStream;
@@ -186,6 +187,9 @@ public:
 // for writev, there always one chunk to send it.
 #define SRS_HTTP_HEADER_CACHE_SIZE 64
 
+// The buffer to read file when the socket is not able to sendfile, for example, over TLS.
+#define SRS_HTTP_SENDFILE_BUFFER_SIZE 65536
+
 class ISrsHttpHeaderFilter
 {
 public:
@@ -247,6 +251,8 @@ public:
     virtual SrsHttpHeader* header();
     virtual srs_error_t write(char* data, int size);
     virtual srs_error_t writev(const iovec* iov, int iovcnt, ssize_t* pnwrite);
+    // Send the file by sendfile if socket supports, or read and write it as normal.
+    virtual srs_error_t sendfile(int fd, int64_t offset, int64_t size, int64_t* pnwrite);
     virtual void write_header();
     virtual srs_error_t send_header(char* data, int size);
 public:
@@ -255,7 +261,7 @@ public:
 };
 
 // Response writer use st socket
-class SrsHttpResponseWriter : public ISrsHttpResponseWriter, public ISrsHttpFirstLineWriter
+class SrsHttpResponseWriter : public ISrsHttpResponseWriter, public ISrsHttpFirstLineWriter, public ISrsSendfileWriter
 {
 protected:
     SrsHttpMessageWriter* writer_;
@@ -273,6 +279,9 @@ public:
     virtual srs_error_t write(char* data, int size);
     virtual srs_error_t writev(const iovec* iov, int iovcnt, ssize_t* pnwrite);
     virtual void write_header(int code);
+// Interface ISrsSendfileWriter
+public:
+    virtual srs_error_t sendfile(int fd, int64_t offset, int64_t size, int64_t* nwrite);
 // Interface ISrsHttpFirstLineWriter
 public:
     virtual srs_error_t build_first_line(std::stringstream& ss, char* data, int size);
@@ -7,6 +7,9 @@
 #include <srs_protocol_http_stack.hpp>
 
 #include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <sstream>
 #include <algorithm>
 using namespace std;
@@ -18,6 +21,7 @@ using namespace std;
 #include <srs_protocol_json.hpp>
 #include <srs_core_autofree.hpp>
 #include <srs_protocol_utility.hpp>
+#include <srs_protocol_io.hpp>
 
 #define SRS_HTTP_DEFAULT_PAGE "index.html"
 
@@ -358,16 +362,182 @@ string srs_http_fs_fullpath(string dir, string pattern, string upath)
     return fullpath;
 }
 
+SrsHttpFileEntry::SrsHttpFileEntry()
+{
+    fd = -1;
+    size = 0;
+    ino = 0;
+    mtime = 0;
+    checked_at = 0;
+    refs = 0;
+    evicted = false;
+}
+
+SrsHttpFileEntry::~SrsHttpFileEntry()
+{
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+void srs_http_file_entry_release(SrsHttpFileEntry* entry)
+{
+    if (!entry) {
+        return;
+    }
+
+    entry->refs--;
+    if (entry->evicted && entry->refs <= 0) {
+        srs_freep(entry);
+    }
+}
+
+SrsHttpFileCache::SrsHttpFileCache(int capacity)
+{
+    capacity_ = capacity;
+    nn_hits_ = 0;
+    nn_misses_ = 0;
+}
+
+SrsHttpFileCache::~SrsHttpFileCache()
+{
+    while (!lru_.empty()) {
+        evict(lru_.back());
+    }
+}
+
+SrsHttpFileEntry* SrsHttpFileCache::fetch(string path)
+{
+    SrsHttpFileEntry* entry = NULL;
+
+    std::map<std::string, std::list<SrsHttpFileEntry*>::iterator>::iterator it = entries_.find(path);
+    if (it != entries_.end()) {
+        entry = *it->second;
+
+        // Stat the file again after a while, because the file might be changed or replaced.
+        srs_utime_t now = srs_get_system_time();
+        if (now - entry->checked_at >= SRS_HTTP_FILE_CACHE_TTL) {
+            if (is_stale(entry)) {
+                evict(entry);
+                entry = NULL;
+            } else {
+                entry->checked_at = now;
+            }
+        }
+    }
+
+    if (entry) {
+        // Move to the front, as the most recently used.
+        lru_.splice(lru_.begin(), lru_, it->second);
+        nn_hits_++;
+    } else {
+        if ((entry = open(path)) == NULL) {
+            return NULL;
+        }
+        nn_misses_++;
+
+        lru_.push_front(entry);
+        entries_[path] = lru_.begin();
+
+        // Remove the least recently used, which is freed when no request uses it.
+        while ((int)lru_.size() > capacity_) {
+            evict(lru_.back());
+        }
+    }
+
+    entry->refs++;
+    return entry;
+}
+
+bool SrsHttpFileCache::is_hot(string path)
+{
+    return srs_string_ends_with(path, ".ts") || srs_string_ends_with(path, ".m4s");
+}
+
+int SrsHttpFileCache::size()
+{
+    return (int)lru_.size();
+}
+
+void SrsHttpFileCache::sweep()
+{
+    srs_utime_t now = srs_get_system_time();
+
+    std::vector<SrsHttpFileEntry*> stales;
+    for (std::list<SrsHttpFileEntry*>::iterator it = lru_.begin(); it != lru_.end(); ++it) {
+        SrsHttpFileEntry* entry = *it;
+        if (is_stale(entry)) {
+            stales.push_back(entry);
+        } else {
+            entry->checked_at = now;
+        }
+    }
+
+    for (int i = 0; i < (int)stales.size(); i++) {
+        evict(stales.at(i));
+    }
+}
+
+SrsHttpFileEntry* SrsHttpFileCache::open(string path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return NULL;
+    }
+
+    SrsHttpFileEntry* entry = new SrsHttpFileEntry();
+    entry->path = path;
+    entry->fd = fd;
+    entry->size = (int64_t)st.st_size;
+    entry->ino = (int64_t)st.st_ino;
+    entry->mtime = (int64_t)st.st_mtime;
+    entry->checked_at = srs_get_system_time();
+    return entry;
+}
+
+bool SrsHttpFileCache::is_stale(SrsHttpFileEntry* entry)
+{
+    struct stat st;
+    if (::stat(entry->path.c_str(), &st) != 0) {
+        return true;
+    }
+
+    return (int64_t)st.st_ino != entry->ino || (int64_t)st.st_mtime != entry->mtime
+        || (int64_t)st.st_size != entry->size;
+}
+
+void SrsHttpFileCache::evict(SrsHttpFileEntry* entry)
+{
+    std::map<std::string, std::list<SrsHttpFileEntry*>::iterator>::iterator it = entries_.find(entry->path);
+    if (it != entries_.end()) {
+        lru_.erase(it->second);
+        entries_.erase(it);
+    }
+
+    entry->evicted = true;
+    if (entry->refs <= 0) {
+        srs_freep(entry);
+    }
+}
+
 SrsHttpFileServer::SrsHttpFileServer(string root_dir)
 {
     dir = root_dir;
     fs_factory = new ISrsFileReaderFactory();
     _srs_path_exists = srs_path_exists;
+    cache_ = new SrsHttpFileCache(SRS_HTTP_FILE_CACHE_SIZE);
 }
 
 SrsHttpFileServer::~SrsHttpFileServer()
 {
     srs_freep(fs_factory);
+    srs_freep(cache_);
 }
 
 void SrsHttpFileServer::set_fs_factory(ISrsFileReaderFactory* f)
@@ -417,22 +587,86 @@ srs_error_t SrsHttpFileServer::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMes
     return serve_file(w, r, fullpath);
 }
 
+bool srs_http_parse_range(string range, int64_t filesize, int64_t* pstart, int64_t* pend)
+{
+    if (range.find("bytes=") != 0 || range.find(",") != string::npos) {
+        return false;
+    }
+    range = range.substr(6);
+
+    size_t pos = range.find("-");
+    if (pos == string::npos) {
+        return false;
+    }
+
+    string first = srs_string_trim_start(range.substr(0, pos), " ");
+    string last = srs_string_trim_end(range.substr(pos + 1), " ");
+    if (first.empty() && last.empty()) {
+        return false;
+    }
+
+    int64_t start = 0, end = filesize - 1;
+    if (first.empty()) {
+        // The suffix range, the last bytes of file.
+        int64_t n = ::atoll(last.c_str());
+        if (n <= 0) {
+            return false;
+        }
+        start = srs_max(0, filesize - n);
+    } else {
+        start = ::atoll(first.c_str());
+        if (!last.empty()) {
+            end = srs_min(::atoll(last.c_str()), filesize - 1);
+        }
+    }
+
+    if (start < 0 || start >= filesize || start > end) {
+        return false;
+    }
+
+    *pstart = start;
+    *pend = end;
+    return true;
+}
+
 srs_error_t SrsHttpFileServer::serve_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath)
 {
     srs_error_t err = srs_success;
 
-    SrsFileReader* fs = fs_factory->create_file_reader();
+    // Serve the hot files by cached fd, only when the writer is able to sendfile.
+    ISrsSendfileWriter* sw = dynamic_cast<ISrsSendfileWriter*>(w);
+    SrsHttpFileEntry* entry = NULL;
+    if (sw && cache_->is_hot(fullpath)) {
+        entry = cache_->fetch(fullpath);
+    }
+    SrsAutoFreeH(SrsHttpFileEntry, entry, srs_http_file_entry_release);
+
+    SrsFileReader* fs = NULL;
     SrsAutoFree(SrsFileReader, fs);
 
-    if ((err = fs->open(fullpath)) != srs_success) {
-        return srs_error_wrap(err, "open file %s", fullpath.c_str());
+    // The size of file we could response to.
+    int64_t filesize = 0;
+    if (entry) {
+        filesize = entry->size;
+    } else {
+        fs = fs_factory->create_file_reader();
+        if ((err = fs->open(fullpath)) != srs_success) {
+            return srs_error_wrap(err, "open file %s", fullpath.c_str());
+        }
+        filesize = fs->filesize() - fs->tellg();
     }
 
-    // The length of bytes we could response to.
-    int64_t length = fs->filesize() - fs->tellg();
-    
+    // Serve the range of file if specified in header, or the whole file.
+    int64_t start = 0, end = filesize - 1;
+    SrsHttpHeader* h = r->header();
+    bool partial = h && srs_http_parse_range(h->get("Range"), filesize, &start, &end);
+    int64_t length = partial ? end - start + 1 : filesize;
+
     // unset the content length to encode in chunked encoding.
     w->header()->set_content_length(length);
+    if (partial) {
+        w->header()->set("Content-Range", "bytes " + srs_int2str(start) + "-" + srs_int2str(end) + "/" + srs_int2str(filesize));
+    }
     
     static std::map<std::string, std::string> _mime;
     if (_mime.empty()) {
@@ -480,12 +714,20 @@ srs_error_t SrsHttpFileServer::serve_file(ISrsHttpResponseWriter* w, ISrsHttpMes
     }
 
     // Enter chunked mode, because we didn't set the content-length.
-    w->write_header(SRS_CONSTS_HTTP_OK);
+    w->write_header(partial ? SRS_CONSTS_HTTP_PartialContent : SRS_CONSTS_HTTP_OK);
     
     // write body.
-    int64_t left = length;
-    if ((err = copy(w, fs, r, left)) != srs_success) {
-        return srs_error_wrap(err, "copy file=%s size=%" PRId64, fullpath.c_str(), left);
+    if (entry) {
+        if ((err = sw->sendfile(entry->fd, start, length, NULL)) != srs_success) {
+            return srs_error_wrap(err, "sendfile file=%s, start=%" PRId64 ", size=%" PRId64, fullpath.c_str(), start, length);
+        }
+    } else {
+        if (start > 0) {
+            fs->seek2(fs->tellg() + start);
+        }
+        if ((err = copy(w, fs, r, length)) != srs_success) {
+            return srs_error_wrap(err, "copy file=%s size=%" PRId64, fullpath.c_str(), length);
+        }
     }
     
     if ((err = w->final_request()) != srs_success) {
@@ -593,6 +835,17 @@ srs_error_t SrsHttpFileServer::serve_ts_ctx(ISrsHttpResponseWriter * w, ISrsHttp
 srs_error_t SrsHttpFileServer::copy(ISrsHttpResponseWriter* w, SrsFileReader* fs, ISrsHttpMessage* r, int64_t size)
 {
     srs_error_t err = srs_success;
+
+    // Send by kernel without copying to user space, when the writer supports it and the fs is a real file.
+    ISrsSendfileWriter* sw = dynamic_cast<ISrsSendfileWriter*>(w);
+    if (sw && fs->get_fd() >= 0) {
+        int64_t offset = fs->tellg();
+        if ((err = sw->sendfile(fs->get_fd(), offset, size, NULL)) != srs_success) {
+            return srs_error_wrap(err, "sendfile offset=%" PRId64 ", size=%" PRId64, offset, size);
+        }
+        fs->seek2(offset + size);
+        return err;
+    }
     
     int64_t left = size;
     char* buf = new char[SRS_HTTP_TS_SEND_BUFFER_SIZE];
@@ -626,6 +879,111 @@ SrsHttpMuxEntry::~SrsHttpMuxEntry()
     srs_freep(handler);
 }
 
+SrsHttpMuxNode::SrsHttpMuxNode()
+{
+    entry = NULL;
+}
+
+SrsHttpMuxNode::~SrsHttpMuxNode()
+{
+    std::map<char, SrsHttpMuxNode*>::iterator it;
+    for (it = children.begin(); it != children.end(); ++it) {
+        SrsHttpMuxNode* child = it->second;
+        srs_freep(child);
+    }
+    children.clear();
+}
+
+SrsHttpMuxTree::SrsHttpMuxTree()
+{
+    root_ = new SrsHttpMuxNode();
+}
+
+SrsHttpMuxTree::~SrsHttpMuxTree()
+{
+    srs_freep(root_);
+}
+
+void SrsHttpMuxTree::insert(const std::string& pattern, SrsHttpMuxEntry* entry)
+{
+    SrsHttpMuxNode* node = root_;
+    size_t pos = 0;
+
+    while (pos < pattern.length()) {
+        std::map<char, SrsHttpMuxNode*>::iterator it = node->children.find(pattern.at(pos));
+
+        // No child shares prefix with pattern, create a leaf for the left part.
+        if (it == node->children.end()) {
+            SrsHttpMuxNode* leaf = new SrsHttpMuxNode();
+            leaf->prefix = pattern.substr(pos);
+            node->children[pattern.at(pos)] = leaf;
+
+            node = leaf;
+            break;
+        }
+
+        SrsHttpMuxNode* child = it->second;
+        size_t n = 0;
+        while (n < child->prefix.length() && pos + n < pattern.length() && child->prefix.at(n) == pattern.at(pos + n)) {
+            n++;
+        }
+
+        // Split the child if pattern only shares part of its prefix, for example, insert /live/ to /live/livestream.flv
+        if (n < child->prefix.length()) {
+            SrsHttpMuxNode* parent = new SrsHttpMuxNode();
+            parent->prefix = child->prefix.substr(0, n);
+            child->prefix = child->prefix.substr(n);
+            parent->children[child->prefix.at(0)] = child;
+            it->second = parent;
+
+            child = parent;
+        }
+
+        node = child;
+        pos += n;
+    }
+
+    node->entry = entry;
+}
+
+SrsHttpMuxEntry* SrsHttpMuxTree::match(const std::string& path)
+{
+    SrsHttpMuxEntry* matched = NULL;
+
+    SrsHttpMuxNode* node = root_;
+    size_t pos = 0;
+
+    // The deeper node has longer pattern, so the last matched entry wins.
+    while (true) {
+        SrsHttpMuxEntry* entry = node->entry;
+        if (entry && entry->enabled && !node->prefix.empty()) {
+            bool is_prefix = node->prefix.at(node->prefix.length() - 1) == '/';
+            if (is_prefix || pos == path.length()) {
+                matched = entry;
+            }
+        }
+
+        if (pos >= path.length()) {
+            break;
+        }
+
+        std::map<char, SrsHttpMuxNode*>::iterator it = node->children.find(path.at(pos));
+        if (it == node->children.end()) {
+            break;
+        }
+
+        SrsHttpMuxNode* child = it->second;
+        if (path.compare(pos, child->prefix.length(), child->prefix) != 0) {
+            break;
+        }
+
+        node = child;
+        pos += child->prefix.length();
+    }
+
+    return matched;
+}
+
 ISrsHttpMatchHijacker::ISrsHttpMatchHijacker()
 {
 }
@@ -644,10 +1002,13 @@ ISrsHttpServeMux::~ISrsHttpServeMux()
 
 SrsHttpServeMux::SrsHttpServeMux()
 {
+    tree_ = new SrsHttpMuxTree();
 }
 
 SrsHttpServeMux::~SrsHttpServeMux()
 {
+    srs_freep(tree_);
+
     std::map<std::string, SrsHttpMuxEntry*>::iterator it;
     for (it = entries.begin(); it != entries.end(); ++it) {
         SrsHttpMuxEntry* entry = it->second;
@@ -723,6 +1084,7 @@ srs_error_t SrsHttpServeMux::handle(std::string pattern, ISrsHttpHandler* handle
             srs_freep(exists);
         }
         entries[pattern] = entry;
+        tree_->insert(pattern, entry);
     }
     
     // Helpful behavior:
@@ -748,6 +1110,7 @@ srs_error_t SrsHttpServeMux::handle(std::string pattern, ISrsHttpHandler* handle
             entry->handler->entry = entry;
             
             entries[rpattern] = entry;
+            tree_->insert(rpattern, entry);
         }
     }
     
@@ -813,57 +1176,12 @@ srs_error_t SrsHttpServeMux::match(ISrsHttpMessage* r, ISrsHttpHandler** ph)
         path = r->host() + path;
     }
     
-    int nb_matched = 0;
-    ISrsHttpHandler* h = NULL;
-    
-    std::map<std::string, SrsHttpMuxEntry*>::iterator it;
-    for (it = entries.begin(); it != entries.end(); ++it) {
-        std::string pattern = it->first;
-        SrsHttpMuxEntry* entry = it->second;
-        
-        if (!entry->enabled) {
-            continue;
-        }
-        
-        if (!path_match(pattern, path)) {
-            continue;
-        }
-        
-        if (!h || (int)pattern.length() > nb_matched) {
-            nb_matched = (int)pattern.length();
-            h = entry->handler;
-        }
-    }
-    
-    *ph = h;
+    SrsHttpMuxEntry* entry = tree_->match(path);
+    *ph = entry ? entry->handler : NULL;
     
     return srs_success;
 }
 
-bool SrsHttpServeMux::path_match(string pattern, string path)
-{
-    if (pattern.empty()) {
-        return false;
-    }
-    
-    int n = (int)pattern.length();
-    
-    // not endswith '/', exactly match.
-    if (pattern.at(n - 1) != '/') {
-        return pattern == path;
-    }
-    
-    // endswith '/', match any,
-    // for example, '/api/' match '/api/[N]'
-    if ((int)path.length() >= n) {
-        if (memcmp(pattern.data(), path.data(), n) == 0) {
-            return true;
-        }
-    }
-    
-    return false;
-}
-
 SrsHttpCorsMux::SrsHttpCorsMux(ISrsHttpHandler* h)
 {
     enabled = false;
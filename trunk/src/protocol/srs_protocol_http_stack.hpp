@@ -12,6 +12,7 @@
 #include <srs_kernel_io.hpp>
 
 #include <map>
+#include <list>
 #include <string>
 #include <vector>
 
@@ -320,9 +321,75 @@ public:
 // For utest to mock it.
 typedef bool (*_pfn_srs_path_exists)(std::string path);
 
+// The max number of files cached by file server.
+#define SRS_HTTP_FILE_CACHE_SIZE 64
+// The interval to stat the cached file, to detect the file is changed or replaced.
+#define SRS_HTTP_FILE_CACHE_TTL (1 * SRS_UTIME_SECONDS)
+
+// The opened file and its stat, shared by concurrent requests.
+class SrsHttpFileEntry
+{
+public:
+    std::string path;
+    int fd;
+    int64_t size;
+    // The inode and modify time, to detect the file is replaced, for example, HLS renames the tmp file to ts.
+    int64_t ino;
+    int64_t mtime;
+    // The last time to stat the file.
+    srs_utime_t checked_at;
+    // The number of requests which are using the fd.
+    int refs;
+    // Whether removed from cache, the fd is closed when no request uses it.
+    bool evicted;
+public:
+    SrsHttpFileEntry();
+    virtual ~SrsHttpFileEntry();
+};
+
+// Release the entry fetched from cache, free it if evicted and no request uses it.
+extern void srs_http_file_entry_release(SrsHttpFileEntry* entry);
+
+// The LRU cache of opened files, for hot files such as HLS ts and DASH m4s segments, which are requested by lots
+// of players in a short time, to avoid opening and stating the file for each request.
+class SrsHttpFileCache
+{
+private:
+    int capacity_;
+    // The entries in LRU order, the front is the most recently used.
+    std::list<SrsHttpFileEntry*> lru_;
+    std::map<std::string, std::list<SrsHttpFileEntry*>::iterator> entries_;
+private:
+    int64_t nn_hits_;
+    int64_t nn_misses_;
+public:
+    SrsHttpFileCache(int capacity);
+    virtual ~SrsHttpFileCache();
+public:
+    // Fetch the entry of file, open it when not cached or changed, return NULL if failed.
+    // @remark User MUST release the entry by srs_http_file_entry_release after used.
+    virtual SrsHttpFileEntry* fetch(std::string path);
+    // Whether the file is hot to cache.
+    virtual bool is_hot(std::string path);
+    virtual int size();
+    // Stat all cached files, and evict the removed or changed files, to close the fds of them, because the HLS
+    // segments are removed when expired, but never requested again. User should call it periodically.
+    virtual void sweep();
+private:
+    SrsHttpFileEntry* open(std::string path);
+    // Whether the file is removed or changed, after the entry is opened.
+    bool is_stale(SrsHttpFileEntry* entry);
+    // Remove the entry from cache, and free it if no request uses it.
+    void evict(SrsHttpFileEntry* entry);
+};
+
 // Build the file path from request r.
 extern std::string srs_http_fs_fullpath(std::string dir, std::string pattern, std::string upath);
 
+// Parse the single range in bytes, for example, bytes=0-1023, bytes=1024- or bytes=-1024, and limit to the file.
+// @return Whether the range is valid.
+extern bool srs_http_parse_range(std::string range, int64_t filesize, int64_t* pstart, int64_t* pend);
+
 // FileServer returns a handler that serves HTTP requests
 // with the contents of the file system rooted at root.
 //
@@ -338,6 +405,7 @@ protected:
 protected:
     ISrsFileReaderFactory* fs_factory;
     _pfn_srs_path_exists _srs_path_exists;
+    SrsHttpFileCache* cache_;
 public:
     SrsHttpFileServer(std::string root_dir);
     virtual ~SrsHttpFileServer();
@@ -375,7 +443,7 @@ protected:
     virtual srs_error_t serve_m3u8_ctx(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
     virtual srs_error_t serve_ts_ctx(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
 protected:
-    // Copy the fs to response writer in size bytes.
+    // Copy the fs to response writer in size bytes, by sendfile if possible.
     virtual srs_error_t copy(ISrsHttpResponseWriter* w, SrsFileReader* fs, ISrsHttpMessage* r, int64_t size);
 };
 
@@ -393,6 +461,40 @@ public:
     virtual ~SrsHttpMuxEntry();
 };
 
+// The node of radix tree for mux, the key of node is the concat of the prefix of all nodes from root,
+// for example, the pattern /live/ and /live/livestream.flv share the node of /live/.
+class SrsHttpMuxNode
+{
+public:
+    // The label of the edge from parent to this node.
+    std::string prefix;
+    // The entry whose pattern ends at this node, NULL if none. Not owned by the node.
+    SrsHttpMuxEntry* entry;
+    // The children nodes, indexed by the first char of prefix.
+    std::map<char, SrsHttpMuxNode*> children;
+public:
+    SrsHttpMuxNode();
+    virtual ~SrsHttpMuxNode();
+};
+
+// The compressed radix tree of mux patterns, to match the path in O(length of path), rather than
+// O(number of patterns), because there might be thousands of streams mounted by SrsHttpStreamServer.
+class SrsHttpMuxTree
+{
+private:
+    SrsHttpMuxNode* root_;
+public:
+    SrsHttpMuxTree();
+    virtual ~SrsHttpMuxTree();
+public:
+    // Set the entry of pattern, overwrite the exists one. The entry is not owned by tree.
+    void insert(const std::string& pattern, SrsHttpMuxEntry* entry);
+    // Get the enabled entry of the longest pattern matched the path, NULL if not matched.
+    // The pattern ends with / matches any path starts with it, for example, /api/ matches /api/v1/versions,
+    // while other pattern must match the path exactly.
+    SrsHttpMuxEntry* match(const std::string& path);
+};
+
 // The hijacker for http pattern match.
 class ISrsHttpMatchHijacker
 {
@@ -449,6 +551,8 @@ class SrsHttpServeMux : public ISrsHttpServeMux
 private:
     // The pattern handler, to handle the http request.
     std::map<std::string, SrsHttpMuxEntry*> entries;
+    // The radix tree of entries, to match the request.
+    SrsHttpMuxTree* tree_;
     // The vhost handler.
     // When find the handler to process the request,
     // append the matched vhost when pattern not starts with /,
@@ -479,7 +583,6 @@ public:
     virtual srs_error_t find_handler(ISrsHttpMessage* r, ISrsHttpHandler** ph);
 private:
     virtual srs_error_t match(ISrsHttpMessage* r, ISrsHttpHandler** ph);
-    virtual bool path_match(std::string pattern, std::string path);
 };
 
 // The filter http mux, directly serve the http CORS requests
@@ -30,6 +30,14 @@ ISrsProtocolWriter::~ISrsProtocolWriter()
 {
 }
 
+ISrsSendfileWriter::ISrsSendfileWriter()
+{
+}
+
+ISrsSendfileWriter::~ISrsSendfileWriter()
+{
+}
+
 ISrsProtocolReadWriter::ISrsProtocolReadWriter()
 {
 }
@@ -94,6 +94,20 @@ public:
     virtual srs_utime_t get_send_timeout() = 0;
 };
 
+/**
+ * The writer to send file to channel by kernel, without copying the file to user space.
+ */
+class ISrsSendfileWriter
+{
+public:
+    ISrsSendfileWriter();
+    virtual ~ISrsSendfileWriter();
+public:
+    // Send size bytes of file fd from offset, the offset of fd is not changed.
+    // @param nwrite, the actually sent size, NULL to ignore.
+    virtual srs_error_t sendfile(int fd, int64_t offset, int64_t size, int64_t* nwrite) = 0;
+};
+
 /**
  * The reader and writer.
  */
@@ -2020,4 +2020,136 @@ SrsAmf0Any* SrsJsonArray::to_amf0()
 ////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////
 
+SrsJsonWriter::SrsJsonWriter()
+{
+    after_key_ = false;
+}
+
+SrsJsonWriter::~SrsJsonWriter()
+{
+}
+
+SrsJsonWriter* SrsJsonWriter::object_start()
+{
+    prefix();
+    buf_.push_back('{');
+    empties_.push_back(true);
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::object_end()
+{
+    srs_assert(!empties_.empty());
+    empties_.pop_back();
+    buf_.push_back('}');
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::array_start()
+{
+    prefix();
+    buf_.push_back('[');
+    empties_.push_back(true);
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::array_end()
+{
+    srs_assert(!empties_.empty());
+    empties_.pop_back();
+    buf_.push_back(']');
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::key(const string& name)
+{
+    prefix();
+    buf_.append(json_serialize_string(name));
+    buf_.push_back(':');
+    after_key_ = true;
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::str(const string& value)
+{
+    prefix();
+    buf_.append(json_serialize_string(value));
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::integer(int64_t value)
+{
+    prefix();
+
+    char tmp[22];
+    snprintf(tmp, sizeof(tmp), "%" PRId64, value);
+    buf_.append(tmp);
 
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::number(double value)
+{
+    prefix();
+
+    // Keep the same format as SrsJsonAny::dumps.
+    char tmp[21 + 1];
+    snprintf(tmp, sizeof(tmp), "%.2f", value);
+    buf_.append(tmp);
+
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::boolean(bool value)
+{
+    prefix();
+    buf_.append(value ? "true" : "false");
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::null()
+{
+    prefix();
+    buf_.append("null");
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::any(SrsJsonAny* value)
+{
+    prefix();
+    buf_.append(value ? value->dumps() : "null");
+    return this;
+}
+
+string& SrsJsonWriter::buffer()
+{
+    return buf_;
+}
+
+int SrsJsonWriter::size()
+{
+    return (int)buf_.size();
+}
+
+void SrsJsonWriter::clear()
+{
+    buf_.clear();
+}
+
+void SrsJsonWriter::prefix()
+{
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+
+    if (empties_.empty()) {
+        return;
+    }
+
+    if (!empties_.back()) {
+        buf_.push_back(',');
+    } else {
+        empties_.back() = false;
+    }
+}
@@ -152,4 +152,41 @@ public:
 ////////////////////////////////////////////////////////////////////////
 // JSON encode, please use JSON.dumps() to encode json object.
 
+// The JSON writer to serialize values to buffer directly, without building the JSON tree, for example,
+// to dump a huge number of clients by HTTP API. User should flush the buffer when it's large.
+class SrsJsonWriter
+{
+private:
+    std::string buf_;
+    // For each object or array, whether it's empty, to write the comma before the next element.
+    std::vector<bool> empties_;
+    // Whether the field name is written, so the value never requires comma.
+    bool after_key_;
+public:
+    SrsJsonWriter();
+    virtual ~SrsJsonWriter();
+public:
+    SrsJsonWriter* object_start();
+    SrsJsonWriter* object_end();
+    SrsJsonWriter* array_start();
+    SrsJsonWriter* array_end();
+    // Write the field name of object, should follow by a value.
+    SrsJsonWriter* key(const std::string& name);
+    SrsJsonWriter* str(const std::string& value);
+    SrsJsonWriter* integer(int64_t value);
+    SrsJsonWriter* number(double value);
+    SrsJsonWriter* boolean(bool value);
+    SrsJsonWriter* null();
+    // Write the dumps of JSON object as a value.
+    SrsJsonWriter* any(SrsJsonAny* value);
+public:
+    // The serialized data in buffer.
+    std::string& buffer();
+    int size();
+    // Clear the buffer after flushed, while the state of objects is kept.
+    void clear();
+private:
+    void prefix();
+};
+
 #endif
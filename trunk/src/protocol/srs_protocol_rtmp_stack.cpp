@@ -11,6 +11,7 @@
 #include <srs_kernel_buffer.hpp>
 #include <srs_core_autofree.hpp>
 #include <srs_kernel_utility.hpp>
+#include <srs_kernel_kbps.hpp>
 #include <srs_protocol_stream.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_protocol_rtmp_handshake.hpp>
@@ -190,6 +191,7 @@ SrsProtocol::SrsProtocol(ISrsProtocolReadWriter* io)
     srs_assert(nb_out_iovs >= 2);
     
     warned_c0c3_cache_dry = false;
+    residence_ = NULL;
     auto_response_when_recv = true;
     show_debug_info = true;
     in_buffer_length = 0;
@@ -255,6 +257,11 @@ void SrsProtocol::set_auto_response(bool v)
     auto_response_when_recv = v;
 }
 
+void SrsProtocol::set_residence(SrsHistogram* h)
+{
+    residence_ = h;
+}
+
 srs_error_t SrsProtocol::manual_response_flush()
 {
     srs_error_t err = srs_success;
@@ -750,9 +757,15 @@ srs_error_t SrsProtocol::send_and_free_messages(SrsSharedPtrMessage** msgs, int
     // donot use the auto free to free the msg,
     // for performance issue.
     srs_error_t err = do_send_messages(msgs, nb_msgs);
+
+    // Stat the residence time of messages from publisher, only when sent, and get the time once for all messages.
+    srs_utime_t now = (residence_ && err == srs_success) ? srs_update_system_time() : 0;
     
     for (int i = 0; i < nb_msgs; i++) {
         SrsSharedPtrMessage* msg = msgs[i];
+        if (now && msg && msg->recv_time > 0) {
+            residence_->record(now - msg->recv_time);
+        }
         srs_freep(msg);
     }
     
@@ -2147,6 +2160,11 @@ void SrsRtmpServer::set_auto_response(bool v)
     protocol->set_auto_response(v);
 }
 
+void SrsRtmpServer::set_residence(SrsHistogram* h)
+{
+    protocol->set_residence(h);
+}
+
 #ifdef SRS_PERF_MERGED_READ
 void SrsRtmpServer::set_merge_read(bool v, IMergeReadHandler* handler)
 {
@@ -43,6 +43,7 @@ class SrsPacket;
 class SrsAmf0Object;
 class IMergeReadHandler;
 class SrsCallPacket;
+class SrsHistogram;
 
 // The amf0 command message, command name macros
 #define RTMP_AMF0_COMMAND_CONNECT               "connect"
@@ -199,6 +200,8 @@ private:
     bool warned_c0c3_cache_dry;
     // The output chunk size, default to 128, set by config.
     int32_t out_chunk_size;
+    // The histogram of residence time of messages sent, not owned, NULL to disable.
+    SrsHistogram* residence_;
 public:
     SrsProtocol(ISrsProtocolReadWriter* io);
     virtual ~SrsProtocol();
@@ -211,6 +214,9 @@ public:
     // need to call this api(the protocol sdk will auto send message).
     // @see the auto_response_when_recv and manual_response_queue.
     virtual srs_error_t manual_response_flush();
+    // Set the histogram to record the residence time of messages, from received by server to sent.
+    // @remark The histogram is not owned by protocol, set to NULL before free it.
+    virtual void set_residence(SrsHistogram* h);
 public:
 #ifdef SRS_PERF_MERGED_READ
     // To improve read performance, merge some packets then read,
@@ -627,6 +633,8 @@ public:
     // Set the auto response message when recv for protocol stack.
     // @param v, whether auto response message when recv message.
     virtual void set_auto_response(bool v);
+    // Set the histogram to record the residence time of messages sent.
+    virtual void set_residence(SrsHistogram* h);
 #ifdef SRS_PERF_MERGED_READ
     // To improve read performance, merge some packets then read,
     // When it on and read small bytes, we sleep to wait more data.,
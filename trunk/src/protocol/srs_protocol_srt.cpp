@@ -532,6 +532,7 @@ public:
     srs_error_t mod_socket(SrsSrtSocket* srt_skt);
     srs_error_t del_socket(SrsSrtSocket* srt_skt);
     srs_error_t wait(int timeout_ms, int* pn_fds);
+    srs_error_t poll(int timeout_ms, int* pn_fds);
 public:
     virtual int size();
 private:
@@ -539,6 +540,8 @@ private:
     std::map<srs_srt_t, SrsSrtSocket*> fd_sockets_;
     int srt_epoller_fd_;
     std::vector<SRT_EPOLL_EVENT> events_;
+    // The events for poll, which is used by other thread.
+    std::vector<SRT_EPOLL_EVENT> poll_events_;
 };
 
 SrsSrtPoller::SrsSrtPoller()
@@ -559,6 +562,7 @@ srs_error_t SrsSrtPoller::initialize()
 
     srt_epoller_fd_ = srt_epoll_create();
     events_.resize(1024);
+    poll_events_.resize(1024);
 
     // Enable srt empty poller, avoid warning.
     srt_epoll_set(srt_epoller_fd_, SRT_EPOLL_ENABLE_EMPTY);
@@ -641,6 +645,21 @@ srs_error_t SrsSrtPoller::wait(int timeout_ms, int* pn_fds)
     return err;
 }
 
+srs_error_t SrsSrtPoller::poll(int timeout_ms, int* pn_fds)
+{
+    srs_error_t err = srs_success;
+
+    // Only check the fired events, the sockets are notified by wait() in ST thread.
+    int ret = srt_epoll_uwait(srt_epoller_fd_, poll_events_.data(), poll_events_.size(), timeout_ms);
+    *pn_fds = ret;
+
+    if (ret < 0) {
+        return srs_error_new(ERROR_SRT_EPOLL, "srt_epoll_uwait, ret=%d, err=%s", ret, srt_getlasterror_str());
+    }
+
+    return err;
+}
+
 int SrsSrtPoller::size()
 {
     return (int)fd_sockets_.size();
@@ -923,6 +942,10 @@ void SrsSrtSocket::notify_error()
 {
     // mark error, and check when read/write
     has_error_ = true;
+
+    // The error is sticky and level-triggered, so unsubscribe it, or it's fired again and again by poller.
+    srs_error_t err = disable_event(SRT_EPOLL_ERR);
+    srs_freep(err);
     srs_cond_signal(read_cond_);
     srs_cond_signal(write_cond_);
 }
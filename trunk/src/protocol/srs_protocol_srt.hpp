@@ -105,6 +105,9 @@ public:
     // Wait for the fds in its epoll to be fired in specified timeout_ms, where the pn_fds is the number of active fds.
     // Note that for ST, please always use timeout_ms(0) and switch coroutine by yourself.
     virtual srs_error_t wait(int timeout_ms, int* pn_fds) = 0;
+    // Block to wait for the fds to be fired in specified timeout_ms, but never notify the sockets, so it's safe to
+    // call in other thread, which should then notify the ST thread to call wait(0) to dispatch the events.
+    virtual srs_error_t poll(int timeout_ms, int* pn_fds) = 0;
 public:
     virtual int size() = 0;
 };
@@ -10,6 +10,13 @@
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <poll.h>
+#if !defined(SRS_OSX) && !defined(SRS_CYGWIN64)
+#include <sys/sendfile.h>
+#endif
+#ifdef SRS_OSX
+#include <sys/uio.h>
+#endif
 using namespace std;
 
 #include <srs_core_autofree.hpp>
@@ -672,6 +679,86 @@ srs_error_t SrsStSocket::writev(const iovec *iov, int iov_size, ssize_t* nwrite)
     return err;
 }
 
+// Send the file by kernel once, return the sent bytes and update the pos, or -1 with errno.
+ssize_t srs_sendfile_once(int osfd, int fd, off_t* pos, size_t count)
+{
+#if defined(SRS_OSX)
+    // See https://developer.apple.com/library/archive/documentation/System/Conceptual/ManPages_iPhoneOS/man2/sendfile.2.html
+    off_t len = (off_t)count;
+    int r0 = ::sendfile(fd, osfd, *pos, &len, NULL, 0);
+    if (len > 0) {
+        *pos += len;
+        return (ssize_t)len;
+    }
+    return r0;
+#elif defined(SRS_CYGWIN64)
+    // There is no sendfile, so copy the file by user space buffer.
+    char buf[4096];
+    ssize_t nn = ::pread(fd, buf, srs_min(count, sizeof(buf)), *pos);
+    if (nn <= 0) {
+        return nn;
+    }
+    if ((nn = ::write(osfd, buf, nn)) > 0) {
+        *pos += nn;
+    }
+    return nn;
+#else
+    // See https://man7.org/linux/man-pages/man2/sendfile.2.html
+    return ::sendfile(osfd, fd, pos, count);
+#endif
+}
+
+srs_error_t SrsStSocket::sendfile(int fd, int64_t offset, int64_t size, int64_t* nwrite)
+{
+    srs_error_t err = srs_success;
+
+    srs_assert(stfd_);
+
+    int osfd = srs_netfd_fileno(stfd_);
+    off_t pos = (off_t)offset;
+    int64_t left = size;
+
+    while (left > 0) {
+        ssize_t nn = srs_sendfile_once(osfd, fd, &pos, (size_t)left);
+        if (nn > 0) {
+            left -= nn;
+            sbytes += nn;
+            continue;
+        }
+
+        if (nn == 0) {
+            err = srs_error_new(ERROR_SOCKET_WRITE, "sendfile eof, offset=%" PRId64 ", left=%" PRId64, (int64_t)pos, left);
+            break;
+        }
+
+        if (errno == EINTR) {
+            continue;
+        }
+
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            err = srs_error_new(ERROR_SOCKET_WRITE, "sendfile offset=%" PRId64 ", left=%" PRId64, (int64_t)pos, left);
+            break;
+        }
+
+        // The socket is full, yield to other coroutines until it's writable.
+        st_utime_t timeout = (stm == SRS_UTIME_NO_TIMEOUT) ? ST_UTIME_NO_TIMEOUT : stm;
+        if (st_netfd_poll((st_netfd_t)stfd_, POLLOUT, timeout) < 0) {
+            if (errno == ETIME) {
+                err = srs_error_new(ERROR_SOCKET_TIMEOUT, "sendfile timeout %d ms", srsu2msi(stm));
+            } else {
+                err = srs_error_new(ERROR_SOCKET_WRITE, "sendfile poll");
+            }
+            break;
+        }
+    }
+
+    if (nwrite) {
+        *nwrite = size - left;
+    }
+
+    return err;
+}
+
 SrsTcpClient::SrsTcpClient(string h, int p, srs_utime_t tm)
 {
     stfd_ = NULL;
@@ -15,6 +15,25 @@ using namespace std;
 #include <srs_app_st.hpp>
 #include <srs_protocol_conn.hpp>
 #include <srs_app_conn.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_protocol_kbps.hpp>
+#include <srs_app_source.hpp>
+#include <srs_protocol_rtmp_stack.hpp>
+#include <srs_protocol_rtmp_msg_array.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_app_coworkers.hpp>
+#include <srs_app_threads.hpp>
+#include <srs_app_workers.hpp>
+#include <srs_app_utility.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_utest_config.hpp>
+
+#include <sched.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
 
 class MockIDResource : public ISrsResource
 {
@@ -783,3 +802,1074 @@ VOID TEST(AppSecurity, CheckSecurity)
     //       4. deny if matches deny strategy.
 }
 
+
+class MockStatisticDelta : public ISrsKbpsDelta
+{
+public:
+    int64_t in;
+    int64_t out;
+    MockStatisticDelta() {
+        in = out = 0;
+    }
+    virtual ~MockStatisticDelta() {
+    }
+    virtual void remark(int64_t* pin, int64_t* pout) {
+        *pin = in; *pout = out;
+        in = out = 0;
+    }
+};
+
+VOID TEST(AppStatisticTest, ShardCounters)
+{
+    SrsStatisticShard shard;
+
+    // Not allocated slot is zero.
+    int64_t in = -1, out = -1;
+    shard.fetch(2048, in, out);
+    EXPECT_EQ(0, in); EXPECT_EQ(0, out);
+
+    shard.add(2048, 10, 20);
+    shard.add(2048, 1, 2);
+    shard.add(3, 100, 200);
+
+    shard.fetch(2048, in, out);
+    EXPECT_EQ(11, in); EXPECT_EQ(22, out);
+
+    // Reset after fetch.
+    shard.fetch(2048, in, out);
+    EXPECT_EQ(0, in); EXPECT_EQ(0, out);
+
+    shard.fetch(3, in, out);
+    EXPECT_EQ(100, in); EXPECT_EQ(200, out);
+}
+
+VOID TEST(AppStatisticTest, ClientHandle)
+{
+    srs_error_t err;
+
+    SrsStatistic* stat = SrsStatistic::instance();
+
+    SrsContextId cid;
+    cid.set_value("utest-stat-handle");
+
+    SrsRequest req;
+    req.vhost = "utest.vhost"; req.app = "live"; req.stream = "handle";
+    HELPER_ASSERT_SUCCESS(stat->on_client(cid.c_str(), &req, NULL, SrsRtmpConnPlay));
+
+    // Resolve the handle and add delta to client.
+    SrsStatisticHandle handle;
+    MockStatisticDelta delta;
+    delta.in = 100; delta.out = 200;
+    stat->kbps_add_delta(handle, cid, &delta);
+    EXPECT_NE(0, (int)handle.generation);
+
+    delta.in = 1; delta.out = 2;
+    stat->kbps_add_delta(handle, cid, &delta);
+    stat->kbps_sample();
+
+    SrsStatisticClient* client = stat->find_client(cid.c_str());
+    ASSERT_TRUE(client != NULL);
+    EXPECT_EQ(101, client->kbps->get_recv_bytes());
+    EXPECT_EQ(202, client->kbps->get_send_bytes());
+
+    // The handle is stale after client disconnected.
+    stat->on_disconnect(cid.c_str(), srs_success);
+
+    delta.in = 1; delta.out = 2;
+    stat->kbps_add_delta(handle, cid, &delta);
+    EXPECT_EQ(0, (int)handle.generation);
+    EXPECT_TRUE(stat->find_client(cid.c_str()) == NULL);
+
+    // Never resolve again, util new client.
+    uint64_t version = handle.version;
+    stat->kbps_add_delta(handle, cid, &delta);
+    EXPECT_EQ(version, handle.version);
+}
+
+VOID TEST(AppStatisticTest, ThreadShard)
+{
+    srs_error_t err;
+
+    SrsStatistic* stat = SrsStatistic::instance();
+
+    SrsContextId cid;
+    cid.set_value("utest-stat-shard");
+
+    SrsRequest req;
+    req.vhost = "utest.vhost"; req.app = "live"; req.stream = "shard";
+    HELPER_ASSERT_SUCCESS(stat->on_client(cid.c_str(), &req, NULL, SrsRtmpConnPlay));
+
+    // Resolve the handle by hybrid thread.
+    SrsStatisticHandle handle;
+    MockStatisticDelta delta;
+    delta.in = 100; delta.out = 200;
+    stat->kbps_add_delta(handle, cid, &delta);
+    ASSERT_NE(0, (int)handle.generation);
+
+    // The other thread adds to its own shard, which is aggregated with the shard of hybrid thread.
+    SrsStatisticShard* shard = stat->create_shard();
+    ASSERT_TRUE(shard != NULL);
+    EXPECT_TRUE(shard != stat->shards_[0]);
+    shard->add(handle.slot, 10, 20);
+    stat->kbps_sample();
+
+    SrsStatisticClient* client = stat->find_client(cid.c_str());
+    ASSERT_TRUE(client != NULL);
+    EXPECT_EQ(110, client->kbps->get_recv_bytes());
+    EXPECT_EQ(220, client->kbps->get_send_bytes());
+
+    // The bytes not sampled yet of all shards, are collected when disconnect.
+    shard->add(handle.slot, 1, 2);
+    stat->on_disconnect(cid.c_str(), srs_success);
+
+    int64_t in = -1, out = -1;
+    shard->fetch(handle.slot, in, out);
+    EXPECT_EQ(0, in); EXPECT_EQ(0, out);
+}
+
+VOID TEST(AppStatisticTest, ResidenceWindow)
+{
+    SrsStatisticStream stream;
+
+    // The residence time of current window is not exported.
+    stream.rtmp_residence->record(100);
+    stream.rotate_residence(SRS_UTIME_SECONDS);
+    EXPECT_EQ(1, (int)stream.rtmp_residence->count());
+    EXPECT_EQ(0, (int)stream.rtmp_residence_last->count());
+
+    // Export the window when elapsed, and start a new window.
+    stream.rotate_residence(SRS_UTIME_SECONDS + SRS_STAT_RESIDENCE_WINDOW);
+    EXPECT_EQ(0, (int)stream.rtmp_residence->count());
+    EXPECT_EQ(1, (int)stream.rtmp_residence_last->count());
+    EXPECT_EQ(100, (int)stream.rtmp_residence_last->max());
+
+    // The last window is reset by next window.
+    stream.rtc_residence->record(200);
+    stream.rotate_residence(SRS_UTIME_SECONDS + 2 * SRS_STAT_RESIDENCE_WINDOW);
+    EXPECT_EQ(0, (int)stream.rtmp_residence_last->count());
+    EXPECT_EQ(1, (int)stream.rtc_residence_last->count());
+    EXPECT_EQ(0, (int)stream.rtc_residence->count());
+}
+
+// Create a RTMP video message of H.264, the payload is specified size.
+SrsSharedPtrMessage* mock_gop_video(uint32_t timestamp, bool keyframe, int size)
+{
+    char* payload = new char[size];
+    memset(payload, 0, size);
+    payload[0] = keyframe? 0x17 : 0x27;
+    payload[1] = 0x01;
+
+    SrsMessageHeader h;
+    h.initialize_video(size, timestamp, 1);
+
+    SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+    srs_error_t err = msg->create(&h, payload, size);
+    srs_assert(err == srs_success);
+    return msg;
+}
+
+VOID TEST(AppGopCacheTest, MaxBytes)
+{
+    srs_error_t err;
+
+    SrsGopCache cache;
+    cache.set_gop_cache_max_bytes(10000);
+
+    SrsSharedPtrMessage* msg = mock_gop_video(0, true, 4000);
+    HELPER_EXPECT_SUCCESS(cache.cache(msg));
+    srs_freep(msg);
+
+    msg = mock_gop_video(40, false, 4000);
+    HELPER_EXPECT_SUCCESS(cache.cache(msg));
+    srs_freep(msg);
+    EXPECT_EQ(8000, cache.bytes());
+    EXPECT_EQ(40 * SRS_UTIME_MILLISECONDS, cache.duration());
+
+    // Clear the gop cache when exceed the max bytes.
+    msg = mock_gop_video(80, false, 4000);
+    HELPER_EXPECT_SUCCESS(cache.cache(msg));
+    srs_freep(msg);
+    EXPECT_TRUE(cache.empty());
+    EXPECT_EQ(0, cache.bytes());
+
+    // Restart from the next keyframe.
+    msg = mock_gop_video(120, true, 4000);
+    HELPER_EXPECT_SUCCESS(cache.cache(msg));
+    srs_freep(msg);
+    EXPECT_EQ(4000, cache.bytes());
+}
+
+VOID TEST(AppGopCacheTest, MessageQueueBatch)
+{
+    srs_error_t err;
+
+    SrsMessageQueue queue(true);
+    queue.set_queue_size(10 * SRS_UTIME_SECONDS);
+
+    SrsSharedPtrMessage* msgs[3];
+    for (int i = 0; i < 3; i++) {
+        msgs[i] = mock_gop_video(1000 + i * 40, i == 0, 100);
+    }
+    HELPER_EXPECT_SUCCESS(queue.enqueue(msgs, 3));
+    EXPECT_EQ(3, queue.size());
+    EXPECT_EQ(80 * SRS_UTIME_MILLISECONDS, queue.duration());
+
+    // Shrink only once for the batch if overflow.
+    queue.set_queue_size(50 * SRS_UTIME_MILLISECONDS);
+    for (int i = 0; i < 3; i++) {
+        msgs[i] = mock_gop_video(1200 + i * 40, i == 0, 100);
+    }
+    bool overflow = false;
+    HELPER_EXPECT_SUCCESS(queue.enqueue(msgs, 3, &overflow));
+    EXPECT_TRUE(overflow);
+    EXPECT_EQ(0, queue.size());
+}
+
+class MockLiveSourceHandler : public ISrsLiveSourceHandler
+{
+public:
+    MockLiveSourceHandler() {
+    }
+    virtual ~MockLiveSourceHandler() {
+    }
+public:
+    virtual srs_error_t on_publish(SrsLiveSource* /*s*/, SrsRequest* /*r*/) {
+        return srs_success;
+    }
+    virtual void on_unpublish(SrsLiveSource* /*s*/, SrsRequest* /*r*/) {
+    }
+};
+
+VOID TEST(AppGopCacheTest, AttachConsumer)
+{
+    srs_error_t err;
+
+    SrsRequest req;
+    req.vhost = "__defaultVhost__"; req.app = "live"; req.stream = "livestream";
+
+    MockLiveSourceHandler handler;
+    SrsLiveSource source;
+    HELPER_ASSERT_SUCCESS(source.initialize(&req, &handler));
+
+    SrsGopCache cache;
+    for (int i = 0; i < 50; i++) {
+        SrsSharedPtrMessage* msg = mock_gop_video(1000 + i * 40, i == 0, 100);
+        HELPER_EXPECT_SUCCESS(cache.cache(msg));
+        srs_freep(msg);
+    }
+
+    // Attach the whole gop to consumer, which shares the payload.
+    if (true) {
+        SrsLiveConsumer consumer(&source);
+        HELPER_EXPECT_SUCCESS(cache.dump(&consumer, false, SrsRtmpJitterAlgorithmZERO));
+
+        SrsMessageArray msgs(128);
+        int count = 0;
+        HELPER_EXPECT_SUCCESS(consumer.dump_packets(&msgs, count));
+        ASSERT_EQ(50, count);
+        EXPECT_EQ(0, (int)msgs.msgs[0]->timestamp);
+        EXPECT_EQ(49 * 40, (int)msgs.msgs[49]->timestamp);
+        // The payload is shared by cache and consumer, never copied.
+        EXPECT_EQ(1, msgs.msgs[0]->count());
+        msgs.free(count);
+    }
+
+    // For fast start, ignore the gop cache which is too long.
+    if (true) {
+        cache.set_gop_cache_fast_start(1000 * SRS_UTIME_MILLISECONDS);
+
+        SrsLiveConsumer consumer(&source);
+        HELPER_EXPECT_SUCCESS(cache.dump(&consumer, false, SrsRtmpJitterAlgorithmFULL));
+
+        SrsMessageArray msgs(128);
+        int count = 0;
+        HELPER_EXPECT_SUCCESS(consumer.dump_packets(&msgs, count));
+        EXPECT_EQ(0, count);
+    }
+
+    // For fast start, never start from the frames without keyframe, for example, when publish starts.
+    if (true) {
+        SrsGopCache cache;
+        cache.set_gop_cache_fast_start(1000 * SRS_UTIME_MILLISECONDS);
+        for (int i = 0; i < 5; i++) {
+            SrsSharedPtrMessage* msg = mock_gop_video(1000 + i * 40, false, 100);
+            HELPER_EXPECT_SUCCESS(cache.cache(msg));
+            srs_freep(msg);
+        }
+        EXPECT_EQ(-1, cache.keyframe_age());
+
+        if (true) {
+            SrsLiveConsumer consumer(&source);
+            HELPER_EXPECT_SUCCESS(cache.dump(&consumer, false, SrsRtmpJitterAlgorithmFULL));
+
+            SrsMessageArray msgs(128);
+            int count = 0;
+            HELPER_EXPECT_SUCCESS(consumer.dump_packets(&msgs, count));
+            EXPECT_EQ(0, count);
+        }
+
+        // Start from the keyframe, which is within N ms.
+        for (int i = 0; i < 6; i++) {
+            SrsSharedPtrMessage* msg = mock_gop_video(1200 + i * 40, i == 0, 100);
+            HELPER_EXPECT_SUCCESS(cache.cache(msg));
+            srs_freep(msg);
+        }
+        EXPECT_EQ(200 * SRS_UTIME_MILLISECONDS, cache.keyframe_age());
+
+        if (true) {
+            SrsLiveConsumer consumer(&source);
+            HELPER_EXPECT_SUCCESS(cache.dump(&consumer, false, SrsRtmpJitterAlgorithmZERO));
+
+            SrsMessageArray msgs(128);
+            int count = 0;
+            HELPER_EXPECT_SUCCESS(consumer.dump_packets(&msgs, count));
+            ASSERT_EQ(6, count);
+            EXPECT_TRUE(SrsFlvVideo::keyframe(msgs.msgs[0]->payload, msgs.msgs[0]->size));
+            msgs.free(count);
+        }
+    }
+}
+
+SrsJsonObject* mock_coworker_update(string server_id, string action, int64_t epoch, int64_t version, string ip)
+{
+    SrsJsonObject* update = SrsJsonAny::object();
+    update->set("action", SrsJsonAny::str(action.c_str()));
+    update->set("vhost", SrsJsonAny::str("__defaultVhost__"));
+    update->set("app", SrsJsonAny::str("live"));
+    update->set("stream", SrsJsonAny::str("livestream"));
+    update->set("epoch", SrsJsonAny::integer(epoch));
+    update->set("version", SrsJsonAny::integer(version));
+    update->set("ttl", SrsJsonAny::integer(30000));
+    update->set("ip", SrsJsonAny::str(ip.c_str()));
+    update->set("port", SrsJsonAny::integer(19350));
+    update->set("api", SrsJsonAny::str("1985"));
+
+    SrsJsonObject* body = SrsJsonAny::object();
+    body->set("server_id", SrsJsonAny::str(server_id.c_str()));
+    body->set("updates", SrsJsonAny::array()->append(update));
+    return body;
+}
+
+VOID TEST(AppCoWorkersTest, StreamDirectory)
+{
+    srs_error_t err;
+
+    MockSrsConfig conf;
+    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost __defaultVhost__{cluster{origin_cluster on;}}"));
+
+    SrsConfig* saved = _srs_config;
+    _srs_config = &conf;
+
+    SrsCoWorkers* coworkers = SrsCoWorkers::instance();
+    string host; int port = 0;
+    EXPECT_FALSE(coworkers->find_origin("__defaultVhost__", "live", "livestream", host, port));
+
+    // Use the address of coworker, if origin has no ip.
+    if (true) {
+        SrsJsonObject* body = mock_coworker_update("origin-a", "publish", 1000, 100, "");
+        SrsAutoFree(SrsJsonObject, body);
+        HELPER_EXPECT_SUCCESS(coworkers->on_update(body, "10.0.0.1"));
+        EXPECT_TRUE(coworkers->find_origin("__defaultVhost__", "live", "livestream", host, port));
+        EXPECT_STREQ("10.0.0.1", host.c_str());
+        EXPECT_EQ(19350, port);
+    }
+
+    // Republished on another origin, whose version is not comparable to the previous origin.
+    if (true) {
+        SrsJsonObject* body = mock_coworker_update("origin-b", "publish", 10, 1, "10.0.0.2");
+        SrsAutoFree(SrsJsonObject, body);
+        HELPER_EXPECT_SUCCESS(coworkers->on_update(body, "10.0.0.9"));
+        EXPECT_TRUE(coworkers->find_origin("__defaultVhost__", "live", "livestream", host, port));
+        EXPECT_STREQ("10.0.0.2", host.c_str());
+    }
+
+    // The stale publish and unpublish of previous origin are ignored.
+    if (true) {
+        SrsJsonObject* body = mock_coworker_update("origin-a", "publish", 1000, 100, "10.0.0.1");
+        SrsAutoFree(SrsJsonObject, body);
+        HELPER_EXPECT_SUCCESS(coworkers->on_update(body, "10.0.0.1"));
+
+        SrsJsonObject* body2 = mock_coworker_update("origin-a", "unpublish", 1000, 100, "10.0.0.1");
+        SrsAutoFree(SrsJsonObject, body2);
+        HELPER_EXPECT_SUCCESS(coworkers->on_update(body2, "10.0.0.1"));
+
+        EXPECT_TRUE(coworkers->find_origin("__defaultVhost__", "live", "livestream", host, port));
+        EXPECT_STREQ("10.0.0.2", host.c_str());
+    }
+
+    // The updates from ourself are ignored.
+    if (true) {
+        string self = SrsStatistic::instance()->server_id();
+        SrsJsonObject* body = mock_coworker_update(self, "unpublish", 1000, 300, "");
+        SrsAutoFree(SrsJsonObject, body);
+        HELPER_EXPECT_SUCCESS(coworkers->on_update(body, "127.0.0.1"));
+        EXPECT_TRUE(coworkers->find_origin("__defaultVhost__", "live", "livestream", host, port));
+    }
+
+    // The stale unpublish of the same origin is ignored.
+    if (true) {
+        SrsJsonObject* body = mock_coworker_update("origin-b", "unpublish", 9, 2, "10.0.0.2");
+        SrsAutoFree(SrsJsonObject, body);
+        HELPER_EXPECT_SUCCESS(coworkers->on_update(body, "10.0.0.2"));
+        EXPECT_TRUE(coworkers->find_origin("__defaultVhost__", "live", "livestream", host, port));
+    }
+
+    // Republished on the previous origin, with newer version.
+    if (true) {
+        SrsJsonObject* body = mock_coworker_update("origin-a", "publish", 1000, 101, "10.0.0.1");
+        SrsAutoFree(SrsJsonObject, body);
+        HELPER_EXPECT_SUCCESS(coworkers->on_update(body, "10.0.0.1"));
+        EXPECT_TRUE(coworkers->find_origin("__defaultVhost__", "live", "livestream", host, port));
+        EXPECT_STREQ("10.0.0.1", host.c_str());
+    }
+
+    // Republished after the origin restarted, with newer epoch.
+    if (true) {
+        SrsJsonObject* body = mock_coworker_update("origin-a", "publish", 2000, 1, "10.0.0.3");
+        SrsAutoFree(SrsJsonObject, body);
+        HELPER_EXPECT_SUCCESS(coworkers->on_update(body, "10.0.0.3"));
+        EXPECT_TRUE(coworkers->find_origin("__defaultVhost__", "live", "livestream", host, port));
+        EXPECT_STREQ("10.0.0.3", host.c_str());
+    }
+
+    // Unpublished by the origin.
+    if (true) {
+        SrsJsonObject* body = mock_coworker_update("origin-a", "unpublish", 2000, 1, "10.0.0.3");
+        SrsAutoFree(SrsJsonObject, body);
+        HELPER_EXPECT_SUCCESS(coworkers->on_update(body, "10.0.0.3"));
+        EXPECT_FALSE(coworkers->find_origin("__defaultVhost__", "live", "livestream", host, port));
+    }
+
+    // The origin discovered by query, with the server id and version of responder, is removed by its unpublish.
+    if (true) {
+        SrsCoWorkerOrigin* origin = new SrsCoWorkerOrigin();
+        origin->server_id = "origin-c";
+        origin->ip = "10.0.0.4";
+        origin->port = 19350;
+        origin->epoch = 3000;
+        origin->version = 1;
+        origin->expired_at = srs_get_system_time() + 30 * SRS_UTIME_SECONDS;
+        coworkers->origins_["/live/livestream"] = origin;
+        EXPECT_TRUE(coworkers->find_origin("__defaultVhost__", "live", "livestream", host, port));
+
+        SrsJsonObject* body = mock_coworker_update("origin-c", "unpublish", 3000, 1, "10.0.0.4");
+        SrsAutoFree(SrsJsonObject, body);
+        HELPER_EXPECT_SUCCESS(coworkers->on_update(body, "10.0.0.4"));
+        EXPECT_FALSE(coworkers->find_origin("__defaultVhost__", "live", "livestream", host, port));
+    }
+
+    // The origin discovered by query without server id, is removed by any unpublish.
+    if (true) {
+        SrsCoWorkerOrigin* origin = new SrsCoWorkerOrigin();
+        origin->ip = "10.0.0.4";
+        origin->port = 19350;
+        origin->expired_at = srs_get_system_time() + 30 * SRS_UTIME_SECONDS;
+        coworkers->origins_["/live/livestream"] = origin;
+        EXPECT_TRUE(coworkers->find_origin("__defaultVhost__", "live", "livestream", host, port));
+
+        SrsJsonObject* body = mock_coworker_update("origin-d", "unpublish", 4000, 1, "10.0.0.5");
+        SrsAutoFree(SrsJsonObject, body);
+        HELPER_EXPECT_SUCCESS(coworkers->on_update(body, "10.0.0.5"));
+        EXPECT_FALSE(coworkers->find_origin("__defaultVhost__", "live", "livestream", host, port));
+    }
+
+    // Invalid body.
+    if (true) {
+        SrsJsonObject* body = SrsJsonAny::object();
+        SrsAutoFree(SrsJsonObject, body);
+        HELPER_EXPECT_FAILED(coworkers->on_update(body, "10.0.0.1"));
+    }
+
+    _srs_config = saved;
+}
+
+VOID TEST(AppThreadPoolTest, ParseCpuList)
+{
+    srs_error_t err;
+
+    if (true) {
+        vector<int> cpus;
+        HELPER_EXPECT_SUCCESS(srs_parse_cpu_list("", cpus));
+        EXPECT_TRUE(cpus.empty());
+    }
+
+    if (true) {
+        vector<int> cpus;
+        HELPER_EXPECT_SUCCESS(srs_parse_cpu_list("3", cpus));
+        ASSERT_EQ(1, (int)cpus.size());
+        EXPECT_EQ(3, cpus.at(0));
+    }
+
+    // Ranges are sorted and the duplicated CPUs are merged.
+    if (true) {
+        vector<int> cpus;
+        HELPER_EXPECT_SUCCESS(srs_parse_cpu_list("8, 0-2,1,10-11", cpus));
+        ASSERT_EQ(6, (int)cpus.size());
+        EXPECT_EQ(0, cpus.at(0));
+        EXPECT_EQ(1, cpus.at(1));
+        EXPECT_EQ(2, cpus.at(2));
+        EXPECT_EQ(8, cpus.at(3));
+        EXPECT_EQ(10, cpus.at(4));
+        EXPECT_EQ(11, cpus.at(5));
+    }
+
+    if (true) {
+        vector<int> cpus;
+        HELPER_EXPECT_FAILED(srs_parse_cpu_list("a", cpus));
+        HELPER_EXPECT_FAILED(srs_parse_cpu_list("3-1", cpus));
+        HELPER_EXPECT_FAILED(srs_parse_cpu_list("-1", cpus));
+        HELPER_EXPECT_FAILED(srs_parse_cpu_list("1-", cpus));
+        HELPER_EXPECT_FAILED(srs_parse_cpu_list("100000", cpus));
+    }
+}
+
+#if !defined(SRS_OSX) && !defined(SRS_CYGWIN64)
+void* mock_thread_apply_placement(void* arg)
+{
+    SrsThreadEntry* entry = (SrsThreadEntry*)arg;
+    entry->err = SrsThreadPool::apply_placement(entry);
+    entry->tid = (pid_t)syscall(SYS_gettid);
+    entry->num = sched_getcpu();
+    return NULL;
+}
+
+VOID TEST(AppThreadPoolTest, ApplyPlacement)
+{
+    srs_error_t err;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(set), &set));
+
+    int cpu = 0;
+    while (cpu < CPU_SETSIZE && !CPU_ISSET(cpu, &set)) {
+        cpu++;
+    }
+    ASSERT_LT(cpu, CPU_SETSIZE);
+
+    // Pin a new thread to the first CPU, which never changes the affinity of current thread.
+    SrsThreadEntry entry;
+    entry.cpus.push_back(cpu);
+
+    pthread_t trd;
+    ASSERT_EQ(0, pthread_create(&trd, NULL, mock_thread_apply_placement, &entry));
+    pthread_join(trd, NULL);
+
+    HELPER_EXPECT_SUCCESS(srs_error_copy(entry.err));
+    EXPECT_EQ(cpu, entry.num);
+
+    // Sample the placement of current thread.
+    SrsThreadEntry self;
+    self.tid = (pid_t)syscall(SYS_gettid);
+
+    vector<SrsThreadEntry*> threads;
+    threads.push_back(&self);
+    _srs_thread_pool->update_placement(threads);
+    EXPECT_TRUE(self.stat->ok);
+    EXPECT_GE(self.stat->processor, 0);
+    EXPECT_GE(self.migrations, 0);
+
+    // Invalid CPU fails to pin.
+    if (true) {
+        SrsThreadEntry entry;
+        entry.cpus.push_back(CPU_SETSIZE - 1);
+        HELPER_EXPECT_FAILED(SrsThreadPool::apply_placement(&entry));
+    }
+}
+#endif
+
+VOID TEST(AppStreamWorkersTest, RingPushPop)
+{
+    char mem[256];
+    memset(mem, 0, sizeof(mem));
+    ASSERT_LE(SrsWorkerRing::memory_size(64), sizeof(mem));
+
+    SrsWorkerRing ring(mem, 64);
+    EXPECT_EQ(64, (int)ring.capacity());
+    EXPECT_EQ(0, (int)ring.size());
+
+    int size = 0;
+    EXPECT_TRUE(ring.front(&size) == NULL);
+
+    // Gather the record from iovs.
+    char a[] = "hello", b[] = "world";
+    iovec iovs[2] = {{a, 5}, {b, 5}};
+    EXPECT_TRUE(ring.push(iovs, 2));
+    EXPECT_EQ(24, (int)ring.size());
+
+    char* p = ring.front(&size);
+    ASSERT_TRUE(p != NULL);
+    EXPECT_EQ(10, size);
+    EXPECT_EQ(0, memcmp(p, "helloworld", 10));
+    ring.pop();
+    EXPECT_EQ(0, (int)ring.size());
+
+    // The record larger than ring is never pushed.
+    char large[64];
+    iovec iov = {large, sizeof(large)};
+    EXPECT_FALSE(ring.push(&iov, 1));
+
+    // The record never wraps, so the left space at the end is skipped, then the ring is full.
+    char c[16];
+    iov.iov_base = c; iov.iov_len = sizeof(c);
+    EXPECT_TRUE(ring.push(&iov, 1));
+    EXPECT_TRUE(ring.push(&iov, 1));
+    EXPECT_EQ(64, (int)ring.size());
+    EXPECT_FALSE(ring.push(&iov, 1));
+
+    for (int i = 0; i < 2; i++) {
+        p = ring.front(&size);
+        ASSERT_TRUE(p != NULL);
+        EXPECT_EQ(16, size);
+        ring.pop();
+    }
+    EXPECT_TRUE(ring.front(&size) == NULL);
+    EXPECT_EQ(0, (int)ring.size());
+}
+
+SrsSharedPtrMessage* mock_workers_audio_sh()
+{
+    // The AAC sequence header, LC, 44.1kHz, stereo.
+    char* payload = new char[4];
+    payload[0] = (char)0xaf; payload[1] = 0x00; payload[2] = 0x12; payload[3] = 0x10;
+
+    SrsMessageHeader h;
+    h.initialize_audio(4, 0, 1);
+
+    SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+    srs_error_t err = msg->create(&h, payload, 4);
+    srs_assert(err == srs_success);
+    return msg;
+}
+
+VOID TEST(AppStreamWorkersTest, MirrorStream)
+{
+    srs_error_t err;
+
+    SrsStreamWorkers workers;
+    HELPER_ASSERT_SUCCESS(workers.setup(2, 0, 4096));
+    EXPECT_TRUE(workers.enabled());
+    EXPECT_TRUE(workers.is_master());
+
+    MockLiveSourceHandler handler;
+    workers.handler_ = &handler;
+    workers.slots_[0].pid = workers.slots_[1].pid = getpid();
+
+    SrsRequest req;
+    req.vhost = "__defaultVhost__"; req.app = "live"; req.stream = "workers";
+
+    // Publish stream on worker #0, which is mirrored to worker #1.
+    SrsLiveSource publisher;
+    workers.on_publish(&publisher, &req);
+    EXPECT_EQ(1, (int)workers.publishers_.size());
+
+    SrsSharedPtrMessage* msg = mock_workers_audio_sh();
+    workers.on_message(&publisher, msg);
+    srs_freep(msg);
+
+    // Consume the records as worker #1.
+    workers.index_ = 1;
+    EXPECT_EQ(2, workers.consume(0));
+    EXPECT_EQ(1, (int)workers.mirrors_.size());
+
+    SrsLiveSource* source = _srs_sources->fetch(&req);
+    ASSERT_TRUE(source != NULL);
+    EXPECT_TRUE(source->mirror());
+    EXPECT_FALSE(source->can_publish(false));
+    EXPECT_TRUE(source->meta->ash() != NULL);
+
+    // Unpublish stream on worker #0.
+    workers.index_ = 0;
+    workers.on_unpublish(&publisher);
+    EXPECT_EQ(0, (int)workers.publishers_.size());
+
+    workers.index_ = 1;
+    EXPECT_EQ(1, workers.consume(0));
+    EXPECT_EQ(0, (int)workers.mirrors_.size());
+    EXPECT_FALSE(source->mirror());
+    EXPECT_TRUE(source->can_publish(false));
+}
+
+#ifdef SRS_SRT
+VOID TEST(AppStreamWorkersTest, MirrorStreamBridge)
+{
+    srs_error_t err;
+
+    MockSrsConfig conf;
+    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "srt_server{enabled on;} vhost __defaultVhost__{srt{enabled on;rtmp_to_srt on;}}"));
+
+    SrsConfig* saved = _srs_config;
+    _srs_config = &conf;
+
+    SrsStreamWorkers workers;
+    HELPER_EXPECT_SUCCESS(workers.setup(2, 0, 4096));
+
+    MockLiveSourceHandler handler;
+    workers.handler_ = &handler;
+    workers.slots_[0].pid = workers.slots_[1].pid = getpid();
+
+    // The stream published on worker #1 is bridged to SRT by master.
+    if (true) {
+        SrsRequest req;
+        req.vhost = "__defaultVhost__"; req.app = "live"; req.stream = "workers-bridge-master";
+
+        SrsLiveSource publisher;
+        workers.index_ = 1;
+        workers.on_publish(&publisher, &req);
+
+        workers.index_ = 0;
+        EXPECT_EQ(1, workers.consume(1));
+
+        SrsLiveSource* source = _srs_sources->fetch(&req);
+        EXPECT_TRUE(source && source->mirror());
+        EXPECT_TRUE(source && source->bridge_);
+
+        workers.index_ = 1;
+        workers.on_unpublish(&publisher);
+
+        workers.index_ = 0;
+        EXPECT_EQ(1, workers.consume(1));
+        EXPECT_TRUE(source && !source->bridge_);
+    }
+
+    // The stream mirrored by other workers is never bridged, because there is no RTC or SRT server.
+    if (true) {
+        SrsRequest req;
+        req.vhost = "__defaultVhost__"; req.app = "live"; req.stream = "workers-bridge-worker";
+
+        SrsLiveSource publisher;
+        workers.index_ = 0;
+        workers.on_publish(&publisher, &req);
+
+        workers.index_ = _srs_stream_workers->index_ = 1;
+        EXPECT_EQ(1, workers.consume(0));
+
+        SrsLiveSource* source = _srs_sources->fetch(&req);
+        EXPECT_TRUE(source && source->mirror());
+        EXPECT_TRUE(source && !source->bridge_);
+
+        workers.index_ = _srs_stream_workers->index_ = 0;
+        workers.on_unpublish(&publisher);
+
+        workers.index_ = 1;
+        EXPECT_EQ(1, workers.consume(0));
+        workers.index_ = 0;
+    }
+
+    _srs_config = saved;
+}
+#endif
+
+VOID TEST(AppStreamWorkersTest, NotifyParkedWorker)
+{
+    srs_error_t err;
+
+    SrsStreamWorkers workers;
+    HELPER_ASSERT_SUCCESS(workers.setup(2, 0, 4096));
+
+    MockLiveSourceHandler handler;
+    workers.handler_ = &handler;
+    workers.slots_[0].pid = workers.slots_[1].pid = getpid();
+
+    SrsRequest req;
+    req.vhost = "__defaultVhost__"; req.app = "live"; req.stream = "workers-notify";
+
+    // Never notify the worker which is running.
+    SrsLiveSource publisher;
+    workers.on_publish(&publisher, &req);
+    EXPECT_EQ(0, workers.notifiers_[1]->nn_notifies());
+
+    // The parked flag is in shared memory, which is reset by the producer when notified.
+    workers.notifiers_[1]->park();
+    EXPECT_EQ(1, workers.slots_[1].parked);
+
+    SrsSharedPtrMessage* msg = mock_workers_audio_sh();
+    workers.on_message(&publisher, msg);
+    srs_freep(msg);
+    EXPECT_EQ(0, workers.slots_[1].parked);
+    EXPECT_EQ(1, workers.notifiers_[1]->nn_notifies());
+
+    // Consume the records as worker #1, which are notified once.
+    workers.index_ = 1;
+    EXPECT_TRUE(workers.has_records());
+    EXPECT_EQ(2, workers.consume(0));
+    EXPECT_FALSE(workers.has_records());
+
+    workers.index_ = 0;
+    workers.on_unpublish(&publisher);
+    EXPECT_EQ(1, workers.notifiers_[1]->nn_notifies());
+
+    workers.index_ = 1;
+    EXPECT_EQ(1, workers.consume(0));
+}
+
+VOID TEST(AppStreamWorkersTest, DropUntilKeyframe)
+{
+    srs_error_t err;
+
+    SrsStreamWorkers workers;
+    HELPER_ASSERT_SUCCESS(workers.setup(2, 0, 256));
+    workers.slots_[0].pid = workers.slots_[1].pid = getpid();
+
+    SrsRequest req;
+    req.vhost = "__defaultVhost__"; req.app = "live"; req.stream = "workers";
+
+    SrsLiveSource publisher;
+    workers.on_publish(&publisher, &req);
+
+    // The ring is full, so the video is dropped until the next keyframe.
+    SrsSharedPtrMessage* msg = mock_gop_video(0, true, 200);
+    workers.on_message(&publisher, msg);
+    srs_freep(msg);
+    EXPECT_EQ(1, workers.nn_dropped_);
+    EXPECT_TRUE(workers.resyncs_[1]);
+
+    // Drain the ring from worker #0 to #1.
+    SrsWorkerRing* ring = workers.rings_.at(1);
+    int size = 0;
+    while (ring->front(&size)) {
+        ring->pop();
+    }
+
+    msg = mock_gop_video(40, false, 100);
+    workers.on_message(&publisher, msg);
+    srs_freep(msg);
+    EXPECT_EQ(2, workers.nn_dropped_);
+    EXPECT_EQ(0, (int)ring->size());
+
+    msg = mock_gop_video(80, true, 100);
+    workers.on_message(&publisher, msg);
+    srs_freep(msg);
+    EXPECT_EQ(2, workers.nn_dropped_);
+    EXPECT_FALSE(workers.resyncs_[1]);
+    EXPECT_LT(0, (int)ring->size());
+}
+
+VOID TEST(AppStreamWorkersTest, CleanupQuitWorker)
+{
+    srs_error_t err;
+
+    // The worker #0 and #1 share the slots, while each has its own rings and mirrors.
+    SrsStreamWorkers master, worker;
+    HELPER_ASSERT_SUCCESS(master.setup(3, 0, 4096));
+    HELPER_ASSERT_SUCCESS(worker.setup(3, 1, 4096));
+    SrsWorkerSlot* slots = worker.slots_;
+    worker.slots_ = master.slots_;
+
+    MockLiveSourceHandler handler;
+    master.handler_ = worker.handler_ = &handler;
+    master.slots_[0].pid = master.slots_[1].pid = master.slots_[2].pid = getpid();
+
+    // The stream published on worker #2 is mirrored to worker #0 and #1.
+    SrsRequest r0, r1;
+    r0.vhost = r1.vhost = "__defaultVhost__"; r0.app = r1.app = "live";
+    r0.stream = "workers-quit-0"; r1.stream = "workers-quit-1";
+
+    SrsLiveSource p0, p1;
+    master.index_ = 2;
+    master.on_publish(&p0, &r0);
+    master.index_ = 0;
+    EXPECT_EQ(1, master.consume(2));
+    EXPECT_EQ(1, (int)master.mirrors_.size());
+
+    worker.index_ = 2;
+    worker.on_publish(&p1, &r1);
+    worker.index_ = 1;
+    EXPECT_EQ(1, worker.consume(2));
+    EXPECT_EQ(1, (int)worker.mirrors_.size());
+
+    HELPER_EXPECT_SUCCESS(master.on_timer(1 * SRS_UTIME_SECONDS));
+    HELPER_EXPECT_SUCCESS(worker.on_timer(1 * SRS_UTIME_SECONDS));
+    EXPECT_EQ(1, (int)master.mirrors_.size());
+    EXPECT_EQ(1, (int)worker.mirrors_.size());
+
+    // The worker #2 quit, and reaped, so its pid does not exist.
+    int pid = fork();
+    if (pid == 0) {
+        _exit(0);
+    }
+    ASSERT_LT(0, pid);
+    waitpid(pid, NULL, 0);
+    master.slots_[2].pid = pid;
+
+    // The master detects it first, and resets the pid in slot.
+    HELPER_EXPECT_SUCCESS(master.on_timer(1 * SRS_UTIME_SECONDS));
+    EXPECT_EQ(0, master.slots_[2].pid);
+    EXPECT_EQ(0, (int)master.mirrors_.size());
+
+    // The worker #1 never sees the pid, but also cleanup the mirrors by the pid it last saw.
+    HELPER_EXPECT_SUCCESS(worker.on_timer(1 * SRS_UTIME_SECONDS));
+    EXPECT_EQ(0, (int)worker.mirrors_.size());
+
+    SrsLiveSource* source = _srs_sources->fetch(&r1);
+    EXPECT_TRUE(source && !source->mirror());
+    EXPECT_TRUE(source && source->can_publish(false));
+
+    worker.slots_ = slots;
+}
+
+class MockThreadMessage : public SrsThreadRef
+{
+public:
+    int producer;
+    int seq;
+    int* nn_freed;
+public:
+    MockThreadMessage(int p, int s, int* freed) : producer(p), seq(s), nn_freed(freed) {
+    }
+    virtual ~MockThreadMessage() {
+        __atomic_add_fetch(nn_freed, 1, __ATOMIC_RELAXED);
+    }
+};
+
+VOID TEST(AppThreadChannelTest, PushPop)
+{
+    srs_error_t err;
+
+    int nn_freed = 0;
+    if (true) {
+        SrsThreadChannel<MockThreadMessage> channel(3);
+        HELPER_ASSERT_SUCCESS(channel.initialize());
+        HELPER_ASSERT_SUCCESS(channel.open());
+        EXPECT_EQ(4, (int)channel.capacity());
+
+        // Push in batch, the left is not pushed for channel is full.
+        MockThreadMessage* msgs[6];
+        for (int i = 0; i < 6; i++) {
+            msgs[i] = new MockThreadMessage(0, i, &nn_freed);
+        }
+        EXPECT_EQ(4, channel.push(msgs, 6));
+        EXPECT_EQ(4, (int)channel.size());
+        EXPECT_EQ(4, channel.nn_pushed());
+        EXPECT_EQ(2, channel.nn_dropped());
+        EXPECT_FALSE(channel.push(msgs[4]));
+
+        // Pop in batch, in order.
+        MockThreadMessage* outs[6];
+        EXPECT_EQ(3, channel.pop(outs, 3));
+        for (int i = 0; i < 3; i++) {
+            EXPECT_EQ(i, outs[i]->seq);
+            outs[i]->unref();
+        }
+
+        // Push after popped, which wraps the slots.
+        EXPECT_EQ(2, channel.push(msgs + 4, 2));
+
+        int nn = 0;
+        HELPER_EXPECT_SUCCESS(channel.pop(outs, 6, &nn, 1 * SRS_UTIME_MILLISECONDS));
+        EXPECT_EQ(3, nn);
+        for (int i = 0; i < nn; i++) {
+            EXPECT_EQ(i + 3, outs[i]->seq);
+            outs[i]->unref();
+        }
+        EXPECT_EQ(6, channel.nn_popped());
+        EXPECT_EQ(6, nn_freed);
+
+        // Timeout when empty, the consumer is parked without notify.
+        HELPER_EXPECT_SUCCESS(channel.pop(outs, 6, &nn, 1 * SRS_UTIME_MILLISECONDS));
+        EXPECT_EQ(0, nn);
+        EXPECT_EQ(0, channel.nn_notifies());
+
+        // The object is shared by channels, and freed by the last reference.
+        SrsThreadChannel<MockThreadMessage> other(4);
+        MockThreadMessage* msg = new MockThreadMessage(0, 0, &nn_freed);
+        msg->ref();
+        EXPECT_TRUE(channel.push(msg));
+        EXPECT_TRUE(other.push(msg));
+        EXPECT_EQ(2, msg->refs());
+
+        EXPECT_EQ(1, other.pop(outs, 1));
+        outs[0]->unref();
+        EXPECT_EQ(6, nn_freed);
+    }
+
+    // The channel releases the left objects.
+    EXPECT_EQ(7, nn_freed);
+}
+
+struct MockThreadProducer
+{
+    SrsThreadChannel<MockThreadMessage>* channel;
+    int producer;
+    int nn_messages;
+    int* nn_freed;
+};
+
+void* mock_thread_channel_produce(void* arg)
+{
+    MockThreadProducer* p = (MockThreadProducer*)arg;
+
+    MockThreadMessage* msgs[16];
+    for (int seq = 0; seq < p->nn_messages;) {
+        // Push in batch of variant size, retry the left when channel is full.
+        int nn = 1 + seq % 16;
+        nn = (seq + nn > p->nn_messages) ? p->nn_messages - seq : nn;
+        for (int i = 0; i < nn; i++) {
+            msgs[i] = new MockThreadMessage(p->producer, seq + i, p->nn_freed);
+        }
+
+        for (int pushed = 0; pushed < nn;) {
+            int r0 = p->channel->push(msgs + pushed, nn - pushed);
+            if (!r0) sched_yield();
+            pushed += r0;
+        }
+        seq += nn;
+    }
+
+    return NULL;
+}
+
+VOID TEST(AppThreadChannelTest, StressMultipleProducers)
+{
+    srs_error_t err;
+
+    const int nn_producers = 4;
+    const int nn_messages = 50000;
+
+    int nn_freed = 0;
+    SrsThreadChannel<MockThreadMessage> channel(256);
+    HELPER_ASSERT_SUCCESS(channel.initialize());
+    HELPER_ASSERT_SUCCESS(channel.open());
+
+    MockThreadProducer producers[nn_producers];
+    pthread_t trds[nn_producers];
+    for (int i = 0; i < nn_producers; i++) {
+        MockThreadProducer* p = &producers[i];
+        p->channel = &channel;
+        p->producer = i;
+        p->nn_messages = nn_messages;
+        p->nn_freed = &nn_freed;
+        ASSERT_EQ(0, pthread_create(&trds[i], NULL, mock_thread_channel_produce, p));
+    }
+
+    // Consume by the coroutine of current thread, which is parked when empty.
+    int nexts[nn_producers] = {0};
+    int nn_received = 0, nn_disorders = 0;
+    MockThreadMessage* msgs[32];
+    for (int nn_timeouts = 0; nn_received < nn_producers * nn_messages && nn_timeouts < 100;) {
+        int nn = 0;
+        HELPER_ASSERT_SUCCESS(channel.pop(msgs, 32, &nn, 100 * SRS_UTIME_MILLISECONDS));
+        if (!nn) nn_timeouts++;
+
+        for (int i = 0; i < nn; i++) {
+            MockThreadMessage* msg = msgs[i];
+            if (msg->seq != nexts[msg->producer]) nn_disorders++;
+            nexts[msg->producer] = msg->seq + 1;
+            msg->unref();
+        }
+        nn_received += nn;
+    }
+
+    for (int i = 0; i < nn_producers; i++) {
+        pthread_join(trds[i], NULL);
+    }
+
+    // The messages of each producer are in order, and all freed.
+    EXPECT_EQ(nn_producers * nn_messages, nn_received);
+    EXPECT_EQ(0, nn_disorders);
+    EXPECT_EQ(nn_received, __atomic_load_n(&nn_freed, __ATOMIC_RELAXED));
+    EXPECT_EQ(nn_received, channel.nn_pushed());
+    EXPECT_EQ(nn_received, channel.nn_popped());
+    EXPECT_EQ(0, (int)channel.size());
+    EXPECT_GE(channel.latency_max(), channel.latency_avg());
+}
@@ -3200,6 +3200,13 @@ VOID TEST(ConfigMainTest, CheckVhostConfig3)
         EXPECT_EQ(1, (int)conf.get_vhost_coworkers("ossrs.net").size());
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{coworkers_ttl 10;}}"));
+        EXPECT_EQ(10 * SRS_UTIME_SECONDS, conf.get_vhost_coworkers_ttl("ossrs.net"));
+        EXPECT_EQ(30 * SRS_UTIME_SECONDS, conf.get_vhost_coworkers_ttl("other.net"));
+    }
+
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{origin_cluster on;}}"));
@@ -3307,6 +3314,7 @@ VOID TEST(ConfigMainTest, CheckVhostConfig4)
         EXPECT_TRUE(conf.get_transcode("ossrs.net", "") == NULL);
         EXPECT_FALSE(conf.get_transcode_enabled(conf.get_transcode("ossrs.net", "")));
         EXPECT_TRUE(conf.get_transcode_ffmpeg(conf.get_transcode("ossrs.net", "")).empty());
+        EXPECT_FALSE(conf.get_transcode_abr(conf.get_transcode("ossrs.net", "")));
         EXPECT_EQ(0, (int)conf.get_transcode_engines(conf.get_transcode("ossrs.net", "")).size());
     }
 
@@ -3497,6 +3505,12 @@ VOID TEST(ConfigMainTest, CheckVhostConfig4)
         EXPECT_TRUE(conf.get_transcode_enabled(conf.get_transcode("ossrs.net", "xxx")));
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{transcode xxx{abr on;}}"));
+        EXPECT_TRUE(conf.get_transcode_abr(conf.get_transcode("ossrs.net", "xxx")));
+    }
+
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{transcode xxx;}"));
@@ -4084,12 +4098,95 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesGlobal)
 
 VOID TEST(ConfigEnvTest, CheckEnvValuesthreads)
 {
+    srs_error_t err;
+
     if (true) {
         MockSrsConfig conf;
 
         SrsSetEnvConfig(threads_interval, "SRS_THREADS_INTERVAL", "10");
         EXPECT_EQ(10 * SRS_UTIME_SECONDS, conf.get_threads_interval());
     }
+
+    if (true) {
+        MockSrsConfig conf;
+        EXPECT_EQ(0, conf.get_threads_audio_workers());
+
+        SrsSetEnvConfig(threads_audio_workers, "SRS_THREADS_AUDIO_WORKERS", "2");
+        EXPECT_EQ(2, conf.get_threads_audio_workers());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "threads{audio_workers 4;}"));
+        EXPECT_EQ(4, conf.get_threads_audio_workers());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        EXPECT_STREQ("", conf.get_threads_cpu_affinity("hybrid").c_str());
+        EXPECT_FALSE(conf.get_threads_numa_local());
+
+        SrsSetEnvConfig(threads_cpu_affinity_hybrid, "SRS_THREADS_CPU_AFFINITY_HYBRID", "1-3");
+        EXPECT_STREQ("1-3", conf.get_threads_cpu_affinity("hybrid").c_str());
+        EXPECT_STREQ("", conf.get_threads_cpu_affinity("audio").c_str());
+
+        SrsSetEnvConfig(threads_numa_local, "SRS_THREADS_NUMA_LOCAL", "on");
+        EXPECT_TRUE(conf.get_threads_numa_local());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "threads{cpu_affinity{primordial 0; hybrid 1,3;} numa_local on;}"));
+        EXPECT_STREQ("0", conf.get_threads_cpu_affinity("primordial").c_str());
+        EXPECT_STREQ("1,3", conf.get_threads_cpu_affinity("hybrid").c_str());
+        EXPECT_STREQ("", conf.get_threads_cpu_affinity("audio").c_str());
+        EXPECT_TRUE(conf.get_threads_numa_local());
+    }
+}
+
+VOID TEST(ConfigEnvTest, CheckEnvValuesWorkers)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        EXPECT_FALSE(conf.get_workers_enabled());
+        EXPECT_EQ(2, conf.get_workers_count());
+        EXPECT_EQ(8, conf.get_workers_ring_size());
+
+        SrsSetEnvConfig(workers_enabled, "SRS_WORKERS_ENABLED", "on");
+        EXPECT_TRUE(conf.get_workers_enabled());
+
+        SrsSetEnvConfig(workers_count, "SRS_WORKERS_COUNT", "4");
+        EXPECT_EQ(4, conf.get_workers_count());
+
+        SrsSetEnvConfig(workers_ring_size, "SRS_WORKERS_RING_SIZE", "16");
+        EXPECT_EQ(16, conf.get_workers_ring_size());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "workers{enabled on; count 3; ring_size 4;}"));
+        EXPECT_TRUE(conf.get_workers_enabled());
+        EXPECT_EQ(3, conf.get_workers_count());
+        EXPECT_EQ(4, conf.get_workers_ring_size());
+    }
+
+    // The ring size is limited, to fit the 32 bits capacity.
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "workers{ring_size 4096;}"));
+        EXPECT_EQ(1024, conf.get_workers_ring_size());
+
+        SrsSetEnvConfig(workers_ring_size, "SRS_WORKERS_RING_SIZE", "1025");
+        EXPECT_EQ(1024, conf.get_workers_ring_size());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "workers{ring_size -1;}"));
+        EXPECT_EQ(8, conf.get_workers_ring_size());
+    }
 }
 
 VOID TEST(ConfigEnvTest, CheckEnvValuesRtmp)
@@ -4276,6 +4373,18 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesVhostSrt)
 
         SrsSetEnvConfig(srt_to_rtmp, "SRS_VHOST_SRT_SRT_TO_RTMP", "off");
         EXPECT_FALSE(conf.get_srt_to_rtmp("__defaultVhost__"));
+
+        SrsSetEnvConfig(rtmp_to_srt, "SRS_VHOST_SRT_RTMP_TO_SRT", "on");
+        EXPECT_TRUE(conf.get_srt_from_rtmp("__defaultVhost__"));
+
+        SrsSetEnvConfig(srt_pacing, "SRS_VHOST_SRT_PACING", "off");
+        EXPECT_FALSE(conf.get_srt_pacing("__defaultVhost__"));
+
+        SrsSetEnvConfig(srt_queue_size, "SRS_VHOST_SRT_QUEUE_SIZE", "1024");
+        EXPECT_EQ(1024, conf.get_srt_queue_size("__defaultVhost__"));
+
+        SrsSetEnvConfig(srt_slow_reader, "SRS_VHOST_SRT_SLOW_READER", "disconnect");
+        EXPECT_TRUE(conf.get_srt_slow_reader_disconnect("__defaultVhost__"));
     }
 }
 
@@ -4440,6 +4549,22 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesVhostRtc)
         SrsSetEnvConfig(rtc_pli_for_rtmp, "SRS_VHOST_RTC_PLI_FOR_RTMP", "60");
         EXPECT_EQ(6 * SRS_UTIME_SECONDS, conf.get_rtc_pli_for_rtmp("__defaultVhost__"));
     }
+
+    if (true) {
+        MockSrsConfig conf;
+
+        EXPECT_FALSE(conf.get_rtc_keyframe_cache("__defaultVhost__"));
+        SrsSetEnvConfig(rtc_keyframe_cache, "SRS_VHOST_RTC_KEYFRAME_CACHE", "on");
+        EXPECT_TRUE(conf.get_rtc_keyframe_cache("__defaultVhost__"));
+
+        EXPECT_EQ(500 * SRS_UTIME_MILLISECONDS, conf.get_rtc_pli_interval("__defaultVhost__"));
+        SrsSetEnvConfig(rtc_pli_interval, "SRS_VHOST_RTC_PLI_INTERVAL", "1.5");
+        EXPECT_EQ(1500 * SRS_UTIME_MILLISECONDS, conf.get_rtc_pli_interval("__defaultVhost__"));
+
+        EXPECT_EQ(300 * SRS_UTIME_MILLISECONDS, conf.get_rtc_jitter_max_delay("__defaultVhost__"));
+        SrsSetEnvConfig(rtc_jitter_max_delay, "SRS_VHOST_RTC_JITTER_MAX_DELAY", "100");
+        EXPECT_EQ(100 * SRS_UTIME_MILLISECONDS, conf.get_rtc_jitter_max_delay("__defaultVhost__"));
+    }
 }
 
 VOID TEST(ConfigEnvTest, CheckEnvValuesVhostPlay)
@@ -4491,6 +4616,12 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesVhostPlay)
         SrsSetEnvConfig(gop_cache_max_frames, "SRS_VHOST_PLAY_GOP_CACHE_MAX_FRAMES", "2000");
         EXPECT_EQ(2000, conf.get_gop_cache_max_frames("__defaultVhost__"));
 
+        SrsSetEnvConfig(gop_cache_max_bytes, "SRS_VHOST_PLAY_GOP_CACHE_MAX_BYTES", "1048576");
+        EXPECT_EQ(1048576, conf.get_gop_cache_max_bytes("__defaultVhost__"));
+
+        SrsSetEnvConfig(gop_cache_fast_start, "SRS_VHOST_PLAY_GOP_CACHE_FAST_START", "3000");
+        EXPECT_EQ(3 * SRS_UTIME_SECONDS, conf.get_gop_cache_fast_start("__defaultVhost__"));
+
         SrsSetEnvConfig(queue_length, "SRS_VHOST_PLAY_QUEUE_LENGTH", "20");
         EXPECT_EQ(20 * SRS_UTIME_SECONDS, conf.get_queue_length("__defaultVhost__"));
 
@@ -4862,6 +4993,15 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesDvr)
 
         SrsSetEnvConfig(dvr_time_jitter_zero, "SRS_VHOST_DVR_TIME_JITTER", "zero");
         EXPECT_EQ(0x2, conf.get_dvr_time_jitter("__defaultVhost__"));
+
+        SrsSetEnvConfig(dvr_format, "SRS_VHOST_DVR_DVR_FORMAT", "fmp4");
+        EXPECT_STREQ("fmp4", conf.get_dvr_format("__defaultVhost__").c_str());
+
+        SrsSetEnvConfig(dvr_fragment, "SRS_VHOST_DVR_DVR_FRAGMENT", "1.5");
+        EXPECT_EQ(1500 * SRS_UTIME_MILLISECONDS, conf.get_dvr_fragment("__defaultVhost__"));
+
+        SrsSetEnvConfig(dvr_finalize, "SRS_VHOST_DVR_DVR_FINALIZE", "off");
+        EXPECT_FALSE(conf.get_dvr_finalize("__defaultVhost__"));
     }
 }
 
@@ -6,6 +6,7 @@
 #include <srs_utest_http.hpp>
 
 #include <sstream>
+#include <unistd.h>
 using namespace std;
 
 #include <srs_protocol_http_stack.hpp>
@@ -663,6 +664,60 @@ VOID TEST(ProtocolHTTPTest, HTTPHeaderOrder)
     }
 }
 
+VOID TEST(ProtocolHTTPTest, JsonWriter)
+{
+    if (true) {
+        SrsJsonWriter w;
+        w.object_start()->object_end();
+        EXPECT_STREQ("{}", w.buffer().c_str());
+    }
+
+    if (true) {
+        SrsJsonWriter w;
+        w.object_start();
+        w.key("code")->integer(0);
+        w.key("name")->str("live\"stream");
+        w.key("alive")->number(1.5);
+        w.key("publish")->boolean(true);
+        w.key("video")->null();
+        w.key("kbps")->object_start();
+        w.key("recv_30s")->integer(10);
+        w.key("send_30s")->integer(-1);
+        w.object_end();
+        w.key("clients")->array_start()->integer(1)->str("2")->array_start()->array_end()->array_end();
+        w.object_end();
+        EXPECT_STREQ("{\"code\":0,\"name\":\"live\\\"stream\",\"alive\":1.50,\"publish\":true,\"video\":null,"
+            "\"kbps\":{\"recv_30s\":10,\"send_30s\":-1},\"clients\":[1,\"2\",[]]}", w.buffer().c_str());
+    }
+
+    // Flush the buffer in the middle of array, the state should be kept.
+    if (true) {
+        SrsJsonWriter w;
+        w.array_start()->integer(1);
+        EXPECT_EQ(2, w.size());
+
+        w.clear();
+        w.integer(2)->array_end();
+        EXPECT_STREQ(",2]", w.buffer().c_str());
+    }
+
+    // Same as dumps of JSON object.
+    if (true) {
+        SrsJsonObject* o = SrsJsonAny::object();
+        SrsAutoFree(SrsJsonObject, o);
+        o->set("id", SrsJsonAny::str("vid-1"));
+        o->set("alive", SrsJsonAny::number(1.5));
+
+        SrsJsonWriter w;
+        w.object_start()->key("id")->str("vid-1")->key("alive")->number(1.5)->object_end();
+        EXPECT_STREQ(o->dumps().c_str(), w.buffer().c_str());
+
+        SrsJsonWriter w2;
+        w2.array_start()->any(o)->any(NULL)->array_end();
+        EXPECT_STREQ(("[" + o->dumps() + ",null]").c_str(), w2.buffer().c_str());
+    }
+}
+
 VOID TEST(ProtocolHTTPTest, HTTPServerMuxerVhost)
 {
     srs_error_t err;
@@ -716,6 +771,140 @@ VOID TEST(ProtocolHTTPTest, HTTPServerMuxerVhost)
     }
 }
 
+VOID TEST(ProtocolHTTPTest, HTTPServerMuxerTree)
+{
+    // Split the node when insert pattern sharing prefix.
+    if (true) {
+        SrsHttpMuxEntry e0, e1, e2;
+        e0.pattern = "/"; e1.pattern = "/live/"; e2.pattern = "/live/livestream.flv";
+
+        SrsHttpMuxTree t;
+        t.insert(e2.pattern, &e2);
+        t.insert(e1.pattern, &e1);
+        t.insert(e0.pattern, &e0);
+
+        EXPECT_TRUE(&e2 == t.match("/live/livestream.flv"));
+        EXPECT_TRUE(&e1 == t.match("/live/livestream.m3u8"));
+        EXPECT_TRUE(&e1 == t.match("/live/livestream.flv.bak"));
+        EXPECT_TRUE(&e1 == t.match("/live/"));
+        EXPECT_TRUE(&e0 == t.match("/live"));
+        EXPECT_TRUE(&e1 == t.match("/live/livestream"));
+        EXPECT_TRUE(&e0 == t.match("/lives/livestream.flv"));
+        EXPECT_TRUE(NULL == t.match(""));
+        EXPECT_TRUE(NULL == t.match("ossrs.net/live/"));
+    }
+
+    // Exactly match for pattern not ends with /.
+    if (true) {
+        SrsHttpMuxEntry e0, e1;
+        e0.pattern = "/api"; e1.pattern = "/api/v1/versions";
+
+        SrsHttpMuxTree t;
+        t.insert(e0.pattern, &e0);
+        t.insert(e1.pattern, &e1);
+
+        EXPECT_TRUE(&e0 == t.match("/api"));
+        EXPECT_TRUE(&e1 == t.match("/api/v1/versions"));
+        EXPECT_TRUE(NULL == t.match("/api/"));
+        EXPECT_TRUE(NULL == t.match("/api/v1/versions/"));
+        EXPECT_TRUE(NULL == t.match("/api/v1/version"));
+    }
+
+    // Ignore the disabled entry, fallback to the shorter pattern.
+    if (true) {
+        SrsHttpMuxEntry e0, e1;
+        e0.pattern = "/live/"; e1.pattern = "/live/livestream.flv";
+
+        SrsHttpMuxTree t;
+        t.insert(e0.pattern, &e0);
+        t.insert(e1.pattern, &e1);
+        EXPECT_TRUE(&e1 == t.match("/live/livestream.flv"));
+
+        e1.enabled = false;
+        EXPECT_TRUE(&e0 == t.match("/live/livestream.flv"));
+
+        e0.enabled = false;
+        EXPECT_TRUE(NULL == t.match("/live/livestream.flv"));
+    }
+
+    // Overwrite the entry of exists pattern.
+    if (true) {
+        SrsHttpMuxEntry e0, e1;
+        e0.pattern = e1.pattern = "/live/livestream.flv";
+
+        SrsHttpMuxTree t;
+        t.insert(e0.pattern, &e0);
+        t.insert(e1.pattern, &e1);
+        EXPECT_TRUE(&e1 == t.match("/live/livestream.flv"));
+    }
+}
+
+VOID TEST(ProtocolHTTPTest, HTTPServerMuxerManyStreams)
+{
+    srs_error_t err;
+
+    SrsHttpServeMux s;
+    HELPER_ASSERT_SUCCESS(s.initialize());
+
+    HELPER_ASSERT_SUCCESS(s.handle("/", new MockHttpHandler("Root")));
+    HELPER_ASSERT_SUCCESS(s.handle("/api/", new MockHttpHandler("Api")));
+
+    // Mount many streams, like SrsHttpStreamServer for HTTP-FLV.
+    vector<MockHttpHandler*> streams;
+    for (int i = 0; i < 20000; i++) {
+        MockHttpHandler* h = new MockHttpHandler(srs_fmt("Stream%d", i));
+        HELPER_ASSERT_SUCCESS(s.handle(srs_fmt("/live/livestream%d.flv", i), h));
+        streams.push_back(h);
+    }
+
+    for (int i = 0; i < 20000; i += 997) {
+        ISrsHttpHandler* h = NULL;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url(srs_fmt("/live/livestream%d.flv", i), false));
+        HELPER_ASSERT_SUCCESS(s.find_handler(&r, &h));
+        EXPECT_TRUE(h == streams.at(i));
+    }
+
+    // Unmount stream by disabling the entry, should match the root.
+    if (true) {
+        streams.at(100)->entry->enabled = false;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/live/livestream100.flv", false));
+        HELPER_ASSERT_SUCCESS(s.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(200, "Root", w);
+    }
+
+    // Mount again by enabling the entry.
+    if (true) {
+        streams.at(100)->entry->enabled = true;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/live/livestream100.flv", false));
+        HELPER_ASSERT_SUCCESS(s.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(200, "Stream100", w);
+    }
+
+    // The prefix of stream is not matched.
+    if (true) {
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/live/livestream1", false));
+        HELPER_ASSERT_SUCCESS(s.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(200, "Root", w);
+    }
+
+    if (true) {
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/api/v1/streams/", false));
+        HELPER_ASSERT_SUCCESS(s.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(200, "Api", w);
+    }
+}
+
 VOID TEST(ProtocolHTTPTest, HTTPServerMuxerImplicitHandler)
 {
     srs_error_t err;
@@ -1743,6 +1932,225 @@ VOID TEST(ProtocolHTTPTest, BasicHandlers)
     }
 }
 
+VOID TEST(ProtocolHTTPTest, ServeFileRange)
+{
+    srs_error_t err;
+
+    if (true) {
+        int64_t start = 0, end = 0;
+        EXPECT_TRUE(srs_http_parse_range("bytes=2-4", 13, &start, &end));
+        EXPECT_EQ(2, start); EXPECT_EQ(4, end);
+        EXPECT_TRUE(srs_http_parse_range("bytes=7-", 13, &start, &end));
+        EXPECT_EQ(7, start); EXPECT_EQ(12, end);
+        EXPECT_TRUE(srs_http_parse_range("bytes=-6", 13, &start, &end));
+        EXPECT_EQ(7, start); EXPECT_EQ(12, end);
+        EXPECT_TRUE(srs_http_parse_range("bytes=-100", 13, &start, &end));
+        EXPECT_EQ(0, start); EXPECT_EQ(12, end);
+        EXPECT_TRUE(srs_http_parse_range("bytes=10-100", 13, &start, &end));
+        EXPECT_EQ(10, start); EXPECT_EQ(12, end);
+
+        EXPECT_FALSE(srs_http_parse_range("", 13, &start, &end));
+        EXPECT_FALSE(srs_http_parse_range("bytes=-", 13, &start, &end));
+        EXPECT_FALSE(srs_http_parse_range("bytes=13-", 13, &start, &end));
+        EXPECT_FALSE(srs_http_parse_range("bytes=5-2", 13, &start, &end));
+        EXPECT_FALSE(srs_http_parse_range("bytes=0-1,3-4", 13, &start, &end));
+        EXPECT_FALSE(srs_http_parse_range("items=0-1", 13, &start, &end));
+    }
+
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsHttpFileServer h("/tmp");
+        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        h.set_path_check(_mock_srs_path_always_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+
+        SrsHttpHeader hdr;
+        hdr.set("Range", "bytes=2-4");
+        r.set_header(&hdr, false);
+        HELPER_ASSERT_SUCCESS(r.set_url("/index.html", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(206, "llo", w);
+    }
+
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsHttpFileServer h("/tmp");
+        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        h.set_path_check(_mock_srs_path_always_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+
+        SrsHttpHeader hdr;
+        hdr.set("Range", "bytes=-6");
+        r.set_header(&hdr, false);
+        HELPER_ASSERT_SUCCESS(r.set_url("/index.html", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(206, "world!", w);
+    }
+
+    // Serve the whole file for invalid range.
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsHttpFileServer h("/tmp");
+        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        h.set_path_check(_mock_srs_path_always_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+
+        SrsHttpHeader hdr;
+        hdr.set("Range", "bytes=100-");
+        r.set_header(&hdr, false);
+        HELPER_ASSERT_SUCCESS(r.set_url("/index.html", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
+    }
+}
+
+VOID TEST(ProtocolHTTPTest, ResponseSendfile)
+{
+    srs_error_t err;
+
+    char path[] = "/tmp/srs-utest-http-sendfile-XXXXXX";
+    int fd = ::mkstemp(path);
+    ASSERT_TRUE(fd > 0);
+    ASSERT_EQ(13, ::write(fd, "Hello, world!", 13));
+    ::unlink(path);
+
+    // Fallback to read and write, for the io which is not able to sendfile, such as TLS.
+    if (true) {
+        MockBufferIO io;
+        SrsHttpResponseWriter w(&io);
+
+        int64_t nwrite = 0;
+        HELPER_EXPECT_SUCCESS(w.sendfile(fd, 7, 5, &nwrite));
+        EXPECT_EQ(5, nwrite);
+
+        string res = HELPER_BUFFER2STR(&io.out_buffer);
+        EXPECT_TRUE(res.find("Content-Length: 5\r\n") != string::npos);
+        EXPECT_TRUE(srs_string_ends_with(res, "\r\n\r\nworld"));
+    }
+
+    // Overflow the content length.
+    if (true) {
+        MockBufferIO io;
+        SrsHttpResponseWriter w(&io);
+        w.header()->set_content_length(3);
+
+        HELPER_EXPECT_FAILED(w.sendfile(fd, 0, 13, NULL));
+    }
+
+    // Failed to read the file.
+    if (true) {
+        MockBufferIO io;
+        SrsHttpResponseWriter w(&io);
+
+        HELPER_EXPECT_FAILED(w.sendfile(fd, 100, 5, NULL));
+    }
+
+    ::close(fd);
+}
+
+VOID TEST(ProtocolHTTPTest, HTTPFileCache)
+{
+    char dir[] = "/tmp/srs-utest-cache-XXXXXX";
+    ASSERT_TRUE(::mkdtemp(dir) != NULL);
+    string p0 = string(dir) + "/0.ts", p1 = string(dir) + "/1.ts", p2 = string(dir) + "/2.ts";
+
+    if (true) {
+        SrsFileWriter fw;
+        for (int i = 0; i < 3; i++) {
+            string p = string(dir) + "/" + srs_int2str(i) + ".ts";
+            ASSERT_TRUE(fw.open(p) == srs_success);
+            ASSERT_TRUE(fw.write((void*)"Hello", 5, NULL) == srs_success);
+            fw.close();
+        }
+    }
+
+    if (true) {
+        SrsHttpFileCache cache(2);
+        EXPECT_TRUE(cache.is_hot(p0));
+        EXPECT_TRUE(cache.is_hot("/live/livestream-0.m4s"));
+        EXPECT_FALSE(cache.is_hot("/live/livestream.m3u8"));
+
+        // Miss the not exists file.
+        EXPECT_TRUE(cache.fetch(string(dir) + "/none.ts") == NULL);
+        EXPECT_TRUE(cache.fetch(dir) == NULL);
+
+        // Hit the cached entry.
+        SrsHttpFileEntry* e0 = cache.fetch(p0);
+        ASSERT_TRUE(e0 != NULL);
+        EXPECT_TRUE(e0->fd > 0);
+        EXPECT_EQ(5, e0->size);
+        EXPECT_EQ(1, e0->refs);
+        EXPECT_TRUE(e0 == cache.fetch(p0));
+        EXPECT_EQ(2, e0->refs);
+        EXPECT_EQ(1, cache.nn_hits_);
+        EXPECT_EQ(1, cache.nn_misses_);
+        srs_http_file_entry_release(e0);
+        EXPECT_EQ(1, e0->refs);
+
+        // Evict the least recently used, which is still alive while in use.
+        SrsHttpFileEntry* e1 = cache.fetch(p1);
+        srs_http_file_entry_release(e1);
+        SrsHttpFileEntry* e2 = cache.fetch(p2);
+        srs_http_file_entry_release(e2);
+        EXPECT_EQ(2, cache.size());
+        EXPECT_TRUE(e0->evicted);
+        EXPECT_FALSE(e1->evicted);
+
+        char buf[5];
+        EXPECT_EQ(5, ::pread(e0->fd, buf, 5, 0));
+        srs_http_file_entry_release(e0);
+
+        // Detect the replaced file, after the TTL.
+        if (true) {
+            SrsFileWriter fw;
+            ASSERT_TRUE(fw.open(p0) == srs_success);
+            ASSERT_TRUE(fw.write((void*)"Hello, world!", 13, NULL) == srs_success);
+            fw.close();
+            ASSERT_EQ(0, ::rename(p0.c_str(), p1.c_str()));
+        }
+
+        e1 = cache.fetch(p1);
+        EXPECT_EQ(5, e1->size);
+        e1->checked_at = 0;
+        srs_http_file_entry_release(e1);
+
+        SrsHttpFileEntry* e3 = cache.fetch(p1);
+        ASSERT_TRUE(e3 != NULL);
+        EXPECT_EQ(13, e3->size);
+        srs_http_file_entry_release(e3);
+
+        // Evict the removed file by sweep, which is never requested again.
+        EXPECT_EQ(2, cache.size());
+        ASSERT_EQ(0, ::unlink(p2.c_str()));
+        cache.sweep();
+        EXPECT_EQ(1, cache.size());
+        EXPECT_TRUE(cache.entries_.find(p2) == cache.entries_.end());
+        EXPECT_TRUE(cache.entries_.find(p1) != cache.entries_.end());
+    }
+
+    ::unlink(p1.c_str());
+    ::unlink(p2.c_str());
+    ::rmdir(dir);
+}
+
 VOID TEST(ProtocolHTTPTest, MSegmentsReader)
 {
     srs_error_t err;
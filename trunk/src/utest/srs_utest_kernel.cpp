@@ -1155,6 +1155,60 @@ VOID TEST(KernelFLVTest, CoverVodStreamErrorCase2)
 	}
 }
 
+VOID TEST(KernelFLVTest, MemoryPool)
+{
+    SrsMemoryPool* pool = SrsMemoryPool::instance();
+    EXPECT_TRUE(pool == SrsMemoryPool::instance());
+
+    // The freed block is reused by the same size class.
+    if (true) {
+        char* p = pool->alloc(1000);
+        memset(p, 0xf, 1000);
+        pool->dealloc(p);
+
+        uint64_t hits = pool->hits;
+        char* q = pool->alloc(1024);
+        EXPECT_EQ(p, q);
+        EXPECT_EQ(hits + 1, pool->hits);
+        pool->dealloc(q);
+    }
+
+    // The large block is never cached.
+    if (true) {
+        int64_t cached = pool->cached_bytes;
+        char* p = pool->alloc(1024 * 1024);
+        memset(p, 0xf, 1024 * 1024);
+        pool->dealloc(p);
+        EXPECT_EQ(cached, pool->cached_bytes);
+    }
+
+    // The payload of common message is transfered to shared message.
+    if (true) {
+        SrsCommonMessage* msg = new SrsCommonMessage();
+        msg->header.initialize_video(100, 10, 1);
+        msg->create_payload(100);
+        msg->size = 100;
+        memset(msg->payload, 0xf, 100);
+
+        SrsSharedPtrMessage* shared = new SrsSharedPtrMessage();
+        srs_error_t err = shared->create(msg);
+        EXPECT_TRUE(err == srs_success);
+        srs_freep(msg);
+
+        SrsSharedPtrMessage* copy = shared->copy();
+        EXPECT_EQ(shared->payload, copy->payload);
+        srs_freep(shared);
+        EXPECT_EQ(0xf, copy->payload[99]);
+        srs_freep(copy);
+    }
+
+    uint64_t hits = 0, misses = 0, recycled = 0, dropped = 0;
+    int64_t cached_bytes = 0;
+    SrsMemoryPool::summary(hits, misses, recycled, dropped, cached_bytes);
+    EXPECT_TRUE(hits > 0);
+    EXPECT_TRUE(recycled > 0);
+}
+
 VOID TEST(KernelFLVTest, CoverFLVVodSHCase)
 {
 	srs_error_t err;
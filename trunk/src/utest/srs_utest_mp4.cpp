@@ -1820,3 +1820,234 @@ VOID TEST(KernelMp4Test, SrsMp4M2tsInitEncoder)
     }
 }
 
+VOID TEST(KernelMp4Test, SrsMp4FragmentEncoder)
+{
+    srs_error_t err;
+
+    MockSrsFileWriter fw;
+    HELPER_ASSERT_SUCCESS(fw.open("test.mp4"));
+
+    if (true) {
+        SrsMp4FragmentEncoder enc;
+        HELPER_ASSERT_SUCCESS(enc.initialize(&fw, 1000));
+
+        SrsFormat fmt;
+        HELPER_ASSERT_SUCCESS(fmt.initialize());
+
+        uint8_t vsh[] = {
+            0x17,
+            0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20,
+            0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00,
+            0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+        };
+        HELPER_ASSERT_SUCCESS(fmt.on_video(0, (char*)vsh, sizeof(vsh)));
+
+        uint8_t ash[] = {
+            0xaf, 0x00, 0x12, 0x10
+        };
+        HELPER_ASSERT_SUCCESS(fmt.on_audio(0, (char*)ash, sizeof(ash)));
+
+        HELPER_ASSERT_SUCCESS(enc.write_header(&fmt, true, true));
+
+        // The first fragment with video and audio, then the second fragment starts at keyframe of 2000ms.
+        uint8_t sample[] = {0x00, 0x00, 0x00, 0x01, 0x65};
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeKeyFrame, 0, 0, sample, sizeof(sample)));
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeSOUN, 0x00, 20, 20, sample, sizeof(sample)));
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeInterFrame, 1500, 1540, sample, sizeof(sample)));
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeKeyFrame, 2000, 2000, sample, sizeof(sample)));
+        HELPER_ASSERT_SUCCESS(enc.flush(true));
+    }
+
+    // The file is ftyp, moov, then moof and mdat for each track of fragment.
+    if (true) {
+        SrsMp4BoxReader br; MockSrsFileReader fr((const char*)fw.data(), fw.filesize());
+        HELPER_ASSERT_SUCCESS(br.initialize(&fr));
+
+        SrsSimpleStream stream;
+        vector<SrsMp4BoxType> types;
+        uint64_t duration = 0;
+
+        for (;;) {
+            SrsMp4Box* box = NULL;
+            if ((err = br.read(&stream, &box)) != srs_success) {
+                srs_freep(err);
+                break;
+            }
+            SrsAutoFree(SrsMp4Box, box);
+            types.push_back(box->type);
+
+            if (box->type == SrsMp4BoxTypeMOOV) {
+                SrsBuffer b(stream.bytes(), stream.length());
+                HELPER_ASSERT_SUCCESS(box->decode(&b));
+                duration = dynamic_cast<SrsMp4MovieBox*>(box)->mvhd()->duration_in_tbn;
+            }
+
+            HELPER_ASSERT_SUCCESS(br.skip(box, &stream));
+        }
+
+        ASSERT_EQ(8, (int)types.size());
+        EXPECT_EQ(SrsMp4BoxTypeFTYP, types[0]);
+        EXPECT_EQ(SrsMp4BoxTypeMOOV, types[1]);
+        EXPECT_EQ(SrsMp4BoxTypeMOOF, types[2]);
+        EXPECT_EQ(SrsMp4BoxTypeMDAT, types[3]);
+        EXPECT_EQ(SrsMp4BoxTypeMOOF, types[4]);
+        EXPECT_EQ(SrsMp4BoxTypeMDAT, types[5]);
+        EXPECT_EQ(SrsMp4BoxTypeMOOF, types[6]);
+        EXPECT_EQ(SrsMp4BoxTypeMDAT, types[7]);
+
+        // The finalize rewrites the duration of moov in place.
+        EXPECT_EQ(2000, (int)duration);
+    }
+}
+
+
+VOID TEST(KernelMp4Test, SrsMp4FragmentEncoderLastDuration)
+{
+    srs_error_t err;
+
+    MockSrsFileWriter fw;
+    HELPER_ASSERT_SUCCESS(fw.open("test.mp4"));
+
+    if (true) {
+        SrsMp4FragmentEncoder enc;
+        HELPER_ASSERT_SUCCESS(enc.initialize(&fw, 1000));
+
+        SrsFormat fmt;
+        HELPER_ASSERT_SUCCESS(fmt.initialize());
+
+        uint8_t vsh[] = {
+            0x17,
+            0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20,
+            0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00,
+            0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+        };
+        HELPER_ASSERT_SUCCESS(fmt.on_video(0, (char*)vsh, sizeof(vsh)));
+
+        uint8_t ash[] = {
+            0xaf, 0x00, 0x12, 0x10
+        };
+        HELPER_ASSERT_SUCCESS(fmt.on_audio(0, (char*)ash, sizeof(ash)));
+
+        HELPER_ASSERT_SUCCESS(enc.write_header(&fmt, true, true));
+
+        // The video fragment ends at the next keyframe, while the audio ends before it.
+        uint8_t sample[] = {0x00, 0x00, 0x00, 0x01, 0x65};
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeKeyFrame, 0, 0, sample, sizeof(sample)));
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeSOUN, 0x00, 0, 0, sample, sizeof(sample)));
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeSOUN, 0x00, 23, 23, sample, sizeof(sample)));
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeInterFrame, 40, 40, sample, sizeof(sample)));
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeSOUN, 0x00, 46, 46, sample, sizeof(sample)));
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeKeyFrame, 1000, 1000, sample, sizeof(sample)));
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeSOUN, 0x00, 1010, 1010, sample, sizeof(sample)));
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeInterFrame, 1040, 1040, sample, sizeof(sample)));
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeSOUN, 0x00, 1033, 1033, sample, sizeof(sample)));
+        HELPER_ASSERT_SUCCESS(enc.flush(false));
+    }
+
+    // Collect the durations of samples for each moof, the video is track 1 and audio is track 2.
+    vector<uint32_t> tids;
+    vector< vector<uint32_t> > durations;
+    if (true) {
+        SrsMp4BoxReader br; MockSrsFileReader fr((const char*)fw.data(), fw.filesize());
+        HELPER_ASSERT_SUCCESS(br.initialize(&fr));
+
+        SrsSimpleStream stream;
+        for (;;) {
+            SrsMp4Box* box = NULL;
+            if ((err = br.read(&stream, &box)) != srs_success) {
+                srs_freep(err);
+                break;
+            }
+            SrsAutoFree(SrsMp4Box, box);
+
+            if (box->type == SrsMp4BoxTypeMOOF) {
+                SrsBuffer b(stream.bytes(), stream.length());
+                HELPER_ASSERT_SUCCESS(box->decode(&b));
+
+                SrsMp4TrackFragmentBox* traf = dynamic_cast<SrsMp4MovieFragmentBox*>(box)->traf();
+                tids.push_back(traf->tfhd()->track_id);
+
+                vector<uint32_t> ds;
+                vector<SrsMp4TrunEntry*>& entries = traf->trun()->entries;
+                for (int i = 0; i < (int)entries.size(); i++) {
+                    ds.push_back(entries[i]->sample_duration);
+                }
+                durations.push_back(ds);
+            }
+
+            HELPER_ASSERT_SUCCESS(br.skip(box, &stream));
+        }
+    }
+
+    ASSERT_EQ(4, (int)durations.size());
+
+    // The last video sample lasts to the next keyframe.
+    EXPECT_EQ(1, (int)tids[0]);
+    ASSERT_EQ(2, (int)durations[0].size());
+    EXPECT_EQ(40, (int)durations[0][0]);
+    EXPECT_EQ(960, (int)durations[0][1]);
+
+    // The last audio sample carries the duration of previous sample, not the gap to the video keyframe.
+    EXPECT_EQ(2, (int)tids[1]);
+    ASSERT_EQ(3, (int)durations[1].size());
+    EXPECT_EQ(23, (int)durations[1][0]);
+    EXPECT_EQ(23, (int)durations[1][1]);
+    EXPECT_EQ(23, (int)durations[1][2]);
+
+    // The last fragment has no next sample, so the duration is never zero.
+    EXPECT_EQ(1, (int)tids[2]);
+    ASSERT_EQ(2, (int)durations[2].size());
+    EXPECT_EQ(40, (int)durations[2][0]);
+    EXPECT_EQ(40, (int)durations[2][1]);
+
+    EXPECT_EQ(2, (int)tids[3]);
+    ASSERT_EQ(2, (int)durations[3].size());
+    EXPECT_EQ(23, (int)durations[3][0]);
+    EXPECT_EQ(23, (int)durations[3][1]);
+}
+
+// The writer only writes part of data when exceed the limit, without error.
+class MockSrsShortFileWriter : public MockSrsFileWriter
+{
+public:
+    int limit;
+public:
+    MockSrsShortFileWriter() {
+        limit = -1;
+    }
+    virtual ~MockSrsShortFileWriter() {
+    }
+public:
+    virtual srs_error_t write(void* buf, size_t count, ssize_t* pnwrite) {
+        if (limit >= 0 && tellg() + (int64_t)count > limit) {
+            count = (size_t)srs_max(0, limit - (int)tellg());
+        }
+        return MockSrsFileWriter::write(buf, count, pnwrite);
+    }
+};
+
+VOID TEST(KernelMp4Test, SrsMp4FragmentEncoderShortWrite)
+{
+    srs_error_t err;
+
+    MockSrsShortFileWriter fw;
+    HELPER_ASSERT_SUCCESS(fw.open("test.mp4"));
+
+    SrsMp4FragmentEncoder enc;
+    HELPER_ASSERT_SUCCESS(enc.initialize(&fw, 1000));
+
+    SrsFormat fmt;
+    HELPER_ASSERT_SUCCESS(fmt.initialize());
+
+    uint8_t ash[] = {
+        0xaf, 0x00, 0x12, 0x10
+    };
+    HELPER_ASSERT_SUCCESS(fmt.on_audio(0, (char*)ash, sizeof(ash)));
+    HELPER_ASSERT_SUCCESS(enc.write_header(&fmt, false, true));
+
+    // The moof is writen, but the mdat is truncated.
+    uint8_t sample[] = {0x00, 0x00, 0x00, 0x01, 0x65};
+    HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeSOUN, 0x00, 0, 0, sample, sizeof(sample)));
+    fw.limit = (int)fw.tellg() + 100;
+    HELPER_EXPECT_FAILED(enc.flush(false));
+}
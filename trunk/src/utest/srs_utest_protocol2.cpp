@@ -19,6 +19,7 @@ using namespace std;
 #include <srs_protocol_http_conn.hpp>
 #include <srs_protocol_protobuf.hpp>
 #include <srs_kernel_buffer.hpp>
+#include <srs_kernel_kbps.hpp>
 
 /**
 * recv video, audio, video and video, interlaced in chunks.
@@ -3736,3 +3737,81 @@ VOID TEST(ProtocolKbpsTest, ParseUrlFailed)
     }
 }
 
+
+VOID TEST(ProtocolKbpsTest, HistogramPercentile)
+{
+    if (true) {
+        SrsHistogram h;
+        EXPECT_EQ(0, h.count());
+        EXPECT_EQ(0, h.percentile(50));
+        EXPECT_EQ(0, h.percentile(99.9));
+    }
+
+    // Small values are exact.
+    if (true) {
+        SrsHistogram h;
+        for (int i = 0; i < 8; i++) {
+            h.record(i);
+        }
+        EXPECT_EQ(8, h.count());
+        EXPECT_EQ(28, h.sum());
+        EXPECT_EQ(0, h.min());
+        EXPECT_EQ(7, h.max());
+        EXPECT_EQ(3, h.percentile(50));
+        EXPECT_EQ(7, h.percentile(99));
+    }
+
+    // Large values are the upper bound of bucket, no more than max.
+    if (true) {
+        SrsHistogram h;
+        for (int i = 1; i <= 1000; i++) {
+            h.record(i);
+        }
+        EXPECT_EQ(1000, h.count());
+        EXPECT_EQ(500500, h.sum());
+        EXPECT_EQ(1, h.min());
+        EXPECT_EQ(1000, h.max());
+        EXPECT_EQ(511, h.percentile(50));
+        EXPECT_EQ(1000, h.percentile(99));
+        EXPECT_EQ(1000, h.percentile(99.9));
+    }
+
+    // Negative and huge values are clamped.
+    if (true) {
+        SrsHistogram h;
+        h.record(-100);
+        h.record(1LL << 50);
+        EXPECT_EQ(0, h.min());
+        EXPECT_EQ((1LL << 40) - 1, h.max());
+        EXPECT_EQ(0, h.percentile(50));
+        EXPECT_EQ((1LL << 40) - 1, h.percentile(99));
+    }
+}
+
+VOID TEST(ProtocolKbpsTest, HistogramMerge)
+{
+    SrsHistogram a, b;
+    for (int i = 0; i < 99; i++) {
+        a.record(10);
+    }
+    b.record(100000);
+
+    a.merge(&b);
+    EXPECT_EQ(100, a.count());
+    EXPECT_EQ(10, a.min());
+    EXPECT_EQ(100000, a.max());
+    EXPECT_EQ(10, a.percentile(50));
+    EXPECT_EQ(10, a.percentile(99));
+    EXPECT_EQ(100000, a.percentile(99.9));
+
+    // Merge empty histogram should not change the min.
+    SrsHistogram c;
+    a.merge(&c);
+    EXPECT_EQ(10, a.min());
+
+    a.clear();
+    EXPECT_EQ(0, a.count());
+    EXPECT_EQ(0, a.max());
+    c.merge(&b);
+    EXPECT_EQ(100000, c.min());
+}
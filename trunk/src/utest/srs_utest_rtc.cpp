@@ -14,10 +14,20 @@
 #include <srs_app_rtc_conn.hpp>
 #include <srs_kernel_codec.hpp>
 #include <srs_app_conn.hpp>
+#include <srs_app_rtc_dtls.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_protocol_format.hpp>
+#include <srs_app_source.hpp>
+#include <srs_protocol_rtmp_msg_array.hpp>
 
 #include <srs_utest_service.hpp>
+#ifdef SRS_FFMPEG_FIT
+#include <srs_app_rtc_codec.hpp>
+#include <srs_app_threads.hpp>
+#endif
 
 #include <vector>
+#include <map>
 using namespace std;
 
 VOID TEST(KernelRTCTest, RtpSTAPPayloadException)
@@ -1200,6 +1210,261 @@ VOID TEST(KernelRTCTest, SrsRtcpNack)
     EXPECT_EQ(actual_lost_sn.size(), req_lost_sns.size());
 }
 
+VOID TEST(KernelRTCTest, RtcpBlockInPlace)
+{
+    srs_error_t err;
+
+    // The NACK requires kRtcpPacketSize to encode.
+    char buf[kRtcpPacketSize * 2];
+    SrsBuffer stream(buf, sizeof(buf));
+
+    // Empty RR, SR, RR, NACK with gaps, and PLI in a compound packet.
+    if (true) {
+        SrsRtcpRR rr(0x01);
+        HELPER_ASSERT_SUCCESS(rr.encode(&stream));
+    }
+    if (true) {
+        SrsRtcpSR sr;
+        sr.set_ssrc(0x02);
+        sr.set_ntp(0x0102030405060708ULL);
+        sr.set_rtp_ts(9000);
+        HELPER_ASSERT_SUCCESS(sr.encode(&stream));
+    }
+    if (true) {
+        SrsRtcpRR rr(0x01);
+        rr.set_rb_ssrc(0x03);
+        rr.header_.rc = 1;
+        HELPER_ASSERT_SUCCESS(rr.encode(&stream));
+    }
+    SrsRtcpNack nack(0x01);
+    nack.set_media_ssrc(0x04);
+    uint16_t lost[] = {65530, 65531, 65535, 0, 3, 20, 21, 22, 100};
+    for (int i = 0; i < (int)(sizeof(lost) / sizeof(uint16_t)); i++) {
+        nack.add_lost_sn(lost[i]);
+    }
+    HELPER_ASSERT_SUCCESS(nack.encode(&stream));
+    if (true) {
+        SrsRtcpPli pli(0x01);
+        pli.set_media_ssrc(0x05);
+        HELPER_ASSERT_SUCCESS(pli.encode(&stream));
+    }
+
+    SrsBuffer b(buf, stream.pos());
+
+    SrsRtcpBlock rtcp;
+    HELPER_ASSERT_SUCCESS(rtcp.decode(&b));
+    EXPECT_EQ(SrsRtcpType_rr, rtcp.type);
+    EXPECT_EQ(0x01, (int)rtcp.ssrc);
+    EXPECT_EQ(0, (int)rtcp.get_rb_ssrc());
+
+    HELPER_ASSERT_SUCCESS(rtcp.decode(&b));
+    EXPECT_EQ(SrsRtcpType_sr, rtcp.type);
+    EXPECT_EQ(0x02, (int)rtcp.ssrc);
+    if (true) {
+        SrsRtcpSR sr;
+        SrsBuffer sb(rtcp.data, rtcp.nb_data);
+        HELPER_ASSERT_SUCCESS(sr.decode(&sb));
+        EXPECT_EQ(0x0102030405060708ULL, sr.get_ntp());
+        EXPECT_EQ(9000, (int)sr.get_rtp_ts());
+    }
+
+    HELPER_ASSERT_SUCCESS(rtcp.decode(&b));
+    EXPECT_EQ(SrsRtcpType_rr, rtcp.type);
+    EXPECT_EQ(0x03, (int)rtcp.get_rb_ssrc());
+
+    HELPER_ASSERT_SUCCESS(rtcp.decode(&b));
+    EXPECT_EQ(SrsRtcpType_rtpfb, rtcp.type);
+    EXPECT_EQ(1, rtcp.rc);
+    EXPECT_EQ(0x04, (int)rtcp.get_media_ssrc());
+    if (true) {
+        vector<uint16_t> expect = nack.get_lost_sns();
+        vector<uint16_t> actual;
+        SrsRtcpNackIterator it(&rtcp);
+        for (uint16_t seq = 0; it.next(seq);) {
+            actual.push_back(seq);
+        }
+        EXPECT_EQ(expect.size(), actual.size());
+        for (int i = 0; i < (int)expect.size() && i < (int)actual.size(); i++) {
+            EXPECT_EQ(expect[i], actual[i]);
+        }
+    }
+
+    HELPER_ASSERT_SUCCESS(rtcp.decode(&b));
+    EXPECT_EQ(SrsRtcpType_psfb, rtcp.type);
+    EXPECT_EQ(kPLI, rtcp.rc);
+    EXPECT_EQ(0x05, (int)rtcp.get_media_ssrc());
+    EXPECT_TRUE(b.empty());
+
+    // The block is truncated.
+    if (true) {
+        SrsBuffer b(buf, 12);
+        HELPER_EXPECT_FAILED(rtcp.decode(&b));
+    }
+    if (true) {
+        SrsBuffer b(buf, 2);
+        HELPER_EXPECT_FAILED(rtcp.decode(&b));
+    }
+}
+
+// Verify the feedback of TWCC, the received packets in ts, which is arrival time or -1 if lost.
+void mock_twcc_verify(SrsRtcpTWCC& twcc, map<uint16_t, srs_utime_t>& ts, int& nn_verified)
+{
+    vector<uint16_t> chunks = twcc.get_packet_chucks();
+    vector<uint16_t> deltas = twcc.get_recv_deltas();
+
+    // Expand chunks to symbols.
+    vector<uint8_t> symbols;
+    for (int i = 0; i < (int)chunks.size(); i++) {
+        uint16_t chunk = chunks[i];
+        if ((chunk & 0x8000) == 0) {
+            symbols.insert(symbols.end(), chunk & 0x1fff, (chunk >> 13) & 0x03);
+        } else if ((chunk & 0x4000) == 0) {
+            for (int j = 0; j < 14; j++) symbols.push_back((chunk >> (13 - j)) & 0x01);
+        } else {
+            for (int j = 0; j < 7; j++) symbols.push_back((chunk >> (2 * (6 - j))) & 0x03);
+        }
+    }
+    ASSERT_GE((int)symbols.size(), (int)twcc.get_packet_status_count());
+
+    srs_utime_t last = (srs_utime_t)twcc.get_reference_time() * kTwccFbTimeMultiplier;
+    int k = 0;
+    for (int i = 0; i < twcc.get_packet_status_count(); i++) {
+        uint16_t sn = twcc.get_base_sn() + i;
+        ASSERT_TRUE(ts.find(sn) != ts.end());
+        if (!symbols[i]) {
+            EXPECT_EQ(-1, ts[sn]);
+            continue;
+        }
+
+        ASSERT_LT(k, (int)deltas.size());
+        last += (int16_t)deltas[k++] * kTwccFbDeltaUnit;
+        EXPECT_NEAR(ts[sn] % kTwccFbReferenceTimeDivisor, last, kTwccFbDeltaUnit / 2);
+        ts.erase(sn);
+        nn_verified++;
+    }
+    EXPECT_EQ(k, (int)deltas.size());
+}
+
+VOID TEST(KernelRTCTest, TWCCRecvEncodeDecode)
+{
+    srs_error_t err;
+
+    // Normal packets, with some lost, out of order and large delta.
+    if (true) {
+        SrsRtcpTWCC twcc(0x0A);
+        twcc.set_media_ssrc(0x0B);
+
+        map<uint16_t, srs_utime_t> ts;
+        srs_utime_t now = 1000 * SRS_UTIME_SECONDS;
+        uint16_t base = 65000; // Wrap around.
+        for (int i = 0; i < 1000; i++) {
+            uint16_t sn = base + i;
+            now += (i % 100 == 99) ? 100 * SRS_UTIME_MILLISECONDS : (i % 7) * 300;
+            if (i % 13 == 5) {
+                ts[sn] = -1; // Lost.
+            } else if (i % 17 == 3) {
+                ts[sn] = now; // Out of order, received later.
+            } else {
+                ts[sn] = now;
+                HELPER_EXPECT_SUCCESS(twcc.recv_packet(sn, now));
+            }
+            if (i % 17 == 4 && ts[sn - 1] != -1) {
+                HELPER_EXPECT_SUCCESS(twcc.recv_packet(sn - 1, ts[sn - 1]));
+            }
+        }
+
+        // Dup packet.
+        HELPER_EXPECT_FAILED(twcc.recv_packet(base, ts[base]));
+
+        int nn_verified = 0;
+        for (int i = 0; i < 100 && twcc.need_feedback(); i++) {
+            twcc.set_feedback_count(i);
+
+            char buf[kRtcpPacketSize];
+            SrsBuffer stream(buf, sizeof(buf));
+            HELPER_ASSERT_SUCCESS(twcc.encode(&stream));
+            EXPECT_EQ(0, stream.pos() % 4);
+            EXPECT_LE(stream.pos(), kMaxUDPDataSize);
+
+            SrsRtcpTWCC decoder;
+            SrsBuffer b(buf, stream.pos());
+            HELPER_ASSERT_SUCCESS(decoder.decode(&b));
+            EXPECT_EQ(0x0A, (int)decoder.get_ssrc());
+            EXPECT_EQ(0x0B, (int)decoder.get_media_ssrc());
+            EXPECT_EQ(i, decoder.get_feedback_count());
+
+            mock_twcc_verify(decoder, ts, nn_verified);
+        }
+        EXPECT_FALSE(twcc.need_feedback());
+        EXPECT_EQ(1000 - 77, nn_verified);
+    }
+
+    // Drop the oldest packets when ring is full.
+    if (true) {
+        SrsRtcpTWCC twcc;
+
+        srs_utime_t now = 1000 * SRS_UTIME_SECONDS;
+        for (int i = 0; i < kTwccRingSize + 100; i++) {
+            HELPER_EXPECT_SUCCESS(twcc.recv_packet(i, now + i * 100));
+        }
+
+        // Stale packet, which is before the ring.
+        HELPER_EXPECT_FAILED(twcc.recv_packet(0, now));
+
+        char buf[kRtcpPacketSize];
+        SrsBuffer stream(buf, sizeof(buf));
+        HELPER_ASSERT_SUCCESS(twcc.encode(&stream));
+
+        SrsRtcpTWCC decoder;
+        SrsBuffer b(buf, stream.pos());
+        HELPER_ASSERT_SUCCESS(decoder.decode(&b));
+        EXPECT_EQ(100, decoder.get_base_sn());
+        EXPECT_GT(decoder.get_packet_status_count(), 0);
+    }
+}
+
+VOID TEST(KernelRTCTest, TWCCEncodeDecodeWithLoss)
+{
+    srs_error_t err;
+
+    const int nn_packets = 20000;
+
+    SrsRtcpTWCC twcc;
+    srs_utime_t now = 1000 * SRS_UTIME_SECONDS;
+
+    map<uint16_t, srs_utime_t> ts;
+    int nn_received = 0, nn_verified = 0;
+    for (int i = 0; i < nn_packets; i += 50) {
+        // Receive 50 packets about 1% lost, then feedback, as publisher of 1000pps.
+        for (int j = 0; j < 50; j++) {
+            uint16_t sn = (uint16_t)(i + j);
+            if ((i + j) % 97 == 0) {
+                ts[sn] = -1;
+                continue;
+            }
+
+            ts[sn] = now + (i + j) * 1000 + (j % 5) * 150;
+            HELPER_ASSERT_SUCCESS(twcc.recv_packet(sn, ts[sn]));
+            nn_received++;
+        }
+
+        while (twcc.need_feedback()) {
+            char buf[kRtcpPacketSize];
+            SrsBuffer stream(buf, sizeof(buf));
+            HELPER_ASSERT_SUCCESS(twcc.encode(&stream));
+
+            SrsRtcpTWCC decoder;
+            SrsBuffer b(buf, stream.pos());
+            HELPER_ASSERT_SUCCESS(decoder.decode(&b));
+
+            mock_twcc_verify(decoder, ts, nn_verified);
+        }
+    }
+
+    // Each received packet is reported once, with its receive time.
+    EXPECT_EQ(nn_received, nn_verified);
+}
+
 VOID TEST(KernelRTCTest, SyncTimestampBySenderReportDuplicated)
 {
     SrsRtcConnection s(NULL, SrsContextId()); 
@@ -1369,3 +1634,1015 @@ VOID TEST(KernelRTCTest, JitterSequence)
     EXPECT_EQ((uint32_t)11, jitter.correct(11));
 }
 
+
+// Create a RTP video packet, the nalu type is IDR for keyframe.
+SrsRtpPacket* mock_rtc_video(uint32_t ssrc, uint16_t seq, uint32_t ts, bool keyframe)
+{
+    SrsRtpPacket* pkt = new SrsRtpPacket();
+    pkt->frame_type = SrsFrameTypeVideo;
+    pkt->nalu_type = keyframe ? SrsAvcNaluTypeIDR : SrsAvcNaluTypeNonIDR;
+    pkt->header.set_ssrc(ssrc);
+    pkt->header.set_sequence(seq);
+    pkt->header.set_timestamp(ts);
+    return pkt;
+}
+
+VOID TEST(KernelRTCTest, KeyframeCache)
+{
+    srs_error_t err;
+
+    SrsRtcKeyframeCache cache;
+    cache.set_enabled(true);
+
+    // Ignore the packets before keyframe.
+    SrsRtpPacket* pkt = mock_rtc_video(100, 1, 1000, false);
+    cache.on_rtp(pkt); srs_freep(pkt);
+    EXPECT_EQ(0, cache.size());
+
+    // Cache the packets of the same keyframe, and following frames.
+    pkt = mock_rtc_video(100, 2, 2000, true);
+    cache.on_rtp(pkt); srs_freep(pkt);
+    pkt = mock_rtc_video(100, 3, 2000, true);
+    cache.on_rtp(pkt); srs_freep(pkt);
+    pkt = mock_rtc_video(100, 4, 5000, false);
+    cache.on_rtp(pkt); srs_freep(pkt);
+    EXPECT_EQ(3, cache.size());
+
+    // Each video track has its own cache, and ignore audio.
+    pkt = mock_rtc_video(200, 100, 2000, true);
+    cache.on_rtp(pkt); srs_freep(pkt);
+    pkt = mock_rtc_video(300, 100, 2000, true);
+    pkt->frame_type = SrsFrameTypeAudio;
+    cache.on_rtp(pkt); srs_freep(pkt);
+    EXPECT_EQ(4, cache.size());
+
+    // Restart the cache by new keyframe.
+    pkt = mock_rtc_video(100, 5, 8000, true);
+    cache.on_rtp(pkt); srs_freep(pkt);
+    EXPECT_EQ(2, cache.size());
+
+    // Dumps the cached packets to consumer, in order of each track.
+    SrsRtcSource source;
+    SrsRtcConsumer* consumer = NULL;
+    HELPER_ASSERT_SUCCESS(source.create_consumer(consumer));
+    SrsAutoFree(SrsRtcConsumer, consumer);
+
+    HELPER_EXPECT_SUCCESS(cache.dump(consumer));
+
+    uint16_t seqs[] = {5, 100};
+    for (int i = 0; i < 2; i++) {
+        pkt = NULL;
+        HELPER_EXPECT_SUCCESS(consumer->dump_packet(&pkt));
+        ASSERT_TRUE(pkt != NULL);
+        EXPECT_EQ(seqs[i], pkt->header.get_sequence());
+        EXPECT_TRUE(pkt->is_keyframe());
+        srs_freep(pkt);
+    }
+
+    pkt = NULL;
+    HELPER_EXPECT_SUCCESS(consumer->dump_packet(&pkt));
+    EXPECT_TRUE(pkt == NULL);
+
+    // Free all packets when disabled.
+    cache.set_enabled(false);
+    EXPECT_EQ(0, cache.size());
+}
+
+// Build a RTP packet with seq and payload of nn_payload bytes, return the size of packet.
+int mock_rtp_packet(char* buf, uint16_t seq, int nn_payload)
+{
+    SrsBuffer b(buf, kRtpPacketSize);
+    b.write_1bytes(0x80);
+    b.write_1bytes(96);
+    b.write_2bytes(seq);
+    b.write_4bytes(seq * 3000);
+    b.write_4bytes(0x12345678);
+    for (int i = 0; i < nn_payload; i++) {
+        b.write_1bytes((uint8_t)(seq + i));
+    }
+    return b.pos();
+}
+
+VOID TEST(KernelRTCTest, SrtpProtectBatch)
+{
+    srs_error_t err;
+
+    SrsSrtpProfile profiles[] = {SrsSrtpProfileAes128CmSha1_80, SrsSrtpProfileAeadAes128Gcm, SrsSrtpProfileAeadAes256Gcm};
+    int key_lens[] = {30, 28, 44};
+    for (int k = 0; k < 3; k++) {
+        string k0(key_lens[k], 'a'), k1(key_lens[k], 'b');
+
+        // The sender and receiver, the send key of sender is the recv key of receiver.
+        SrsSRTP sender, receiver;
+        HELPER_ASSERT_SUCCESS(sender.initialize(k1, k0, profiles[k]));
+        HELPER_ASSERT_SUCCESS(receiver.initialize(k0, k1, profiles[k]));
+
+        iovec iovs[4];
+        char bufs[4][kRtpPacketSize];
+        for (int i = 0; i < 4; i++) {
+            iovs[i].iov_base = bufs[i];
+            iovs[i].iov_len = mock_rtp_packet(bufs[i], 100 + i, 1000);
+        }
+        HELPER_ASSERT_SUCCESS(sender.protect_rtps(iovs, 4));
+
+        for (int i = 0; i < 4; i++) {
+            // The authentication tag is 10 bytes for HMAC-SHA1-80, 16 bytes for AES-GCM.
+            EXPECT_EQ(12 + 1000 + (k ? 16 : 10), (int)iovs[i].iov_len);
+
+            char plaintext[kRtpPacketSize];
+            int nn_plaintext = mock_rtp_packet(plaintext, 100 + i, 1000);
+            EXPECT_NE(0, memcmp(plaintext, bufs[i], nn_plaintext));
+
+            int nn = (int)iovs[i].iov_len;
+            HELPER_ASSERT_SUCCESS(receiver.unprotect_rtp(bufs[i], &nn));
+            EXPECT_EQ(nn_plaintext, nn);
+            EXPECT_EQ(0, memcmp(plaintext, bufs[i], nn_plaintext));
+        }
+    }
+
+    // The key should match the profile.
+    if (true) {
+        SrsSRTP srtp;
+        HELPER_EXPECT_FAILED(srtp.initialize(string(30, 'a'), string(30, 'b'), SrsSrtpProfileAeadAes128Gcm));
+    }
+}
+
+extern void srs_rtc_free_iovs(iovec* iovs);
+
+VOID TEST(KernelRTCTest, PlayBurstSendBatch)
+{
+    srs_error_t err;
+
+    SrsRtcConnection s(NULL, SrsContextId());
+
+    // The packets are marshaled to the burst, and sent by flush.
+    for (int i = 0; i < 3; i++) {
+        SrsRtpPacket pkt;
+        pkt.header.set_sequence(100 + i);
+        HELPER_EXPECT_SUCCESS(s.do_send_packet(&pkt));
+    }
+    EXPECT_EQ(3, s.nn_play_iovs_);
+
+    HELPER_EXPECT_SUCCESS(s.flush_packets());
+    EXPECT_EQ(0, s.nn_play_iovs_);
+    EXPECT_TRUE(s.play_iovs_ != NULL);
+
+    // The burst is sent when full, without flush.
+    for (int i = 0; i < SRS_RTC_SEND_BATCH + 1; i++) {
+        SrsRtpPacket pkt;
+        pkt.header.set_sequence(200 + i);
+        HELPER_EXPECT_SUCCESS(s.do_send_packet(&pkt));
+    }
+    EXPECT_EQ(1, s.nn_play_iovs_);
+
+    // The packet is dropped by NACK simulator.
+    s.simulate_nack_drop(1);
+    if (true) {
+        SrsRtpPacket pkt;
+        HELPER_EXPECT_SUCCESS(s.do_send_packet(&pkt));
+    }
+    EXPECT_EQ(1, s.nn_play_iovs_);
+    s.simulate_nack_drop(0);
+
+    // The iovecs of batch are taken when sending, and returned for reuse.
+    if (true) {
+        vector<SrsRtpPacket*> pkts;
+        for (int i = 0; i < SRS_RTC_SEND_BATCH + 3; i++) {
+            SrsRtpPacket* pkt = new SrsRtpPacket();
+            pkt->header.set_sequence(300 + i);
+            pkts.push_back(pkt);
+        }
+
+        HELPER_EXPECT_SUCCESS(s.do_send_packets(pkts));
+        EXPECT_TRUE(s.cache_iovs_ != NULL);
+
+        // Another sender allocates its own iovecs, when the iovecs are taken.
+        iovec* taken = s.cache_iovs_;
+        s.cache_iovs_ = NULL;
+        HELPER_EXPECT_SUCCESS(s.do_send_packets(pkts));
+        EXPECT_TRUE(s.cache_iovs_ != NULL && s.cache_iovs_ != taken);
+        srs_rtc_free_iovs(taken);
+
+        for (int i = 0; i < (int)pkts.size(); i++) {
+            srs_freep(pkts[i]);
+        }
+    }
+}
+
+// The DTLS peer in memory, the packets are queued to deliver to the other peer.
+class MockDtlsPeer : public ISrsDtlsCallback
+{
+public:
+    SrsDtls* dtls;
+    vector<string> packets;
+    bool done;
+public:
+    MockDtlsPeer() {
+        dtls = new SrsDtls(this);
+        done = false;
+    }
+    virtual ~MockDtlsPeer() {
+        srs_freep(dtls);
+    }
+public:
+    virtual srs_error_t on_dtls_handshake_done() {
+        done = true;
+        return srs_success;
+    }
+    virtual srs_error_t on_dtls_application_data(const char* data, const int len) {
+        return srs_success;
+    }
+    virtual srs_error_t write_dtls_data(void* data, int size) {
+        packets.push_back(string((char*)data, size));
+        return srs_success;
+    }
+    virtual srs_error_t on_dtls_alert(std::string type, std::string desc) {
+        return srs_success;
+    }
+    // Deliver the queued packets to peer.
+    srs_error_t deliver(MockDtlsPeer* peer) {
+        srs_error_t err = srs_success;
+
+        vector<string> pkts;
+        pkts.swap(packets);
+        for (int i = 0; i < (int)pkts.size(); i++) {
+            string& pkt = pkts.at(i);
+            if ((err = peer->dtls->on_dtls((char*)pkt.data(), (int)pkt.size())) != srs_success) {
+                return srs_error_wrap(err, "on dtls");
+            }
+        }
+
+        return err;
+    }
+};
+
+VOID TEST(KernelRTCTest, DtlsNegotiateSrtpGcm)
+{
+    srs_error_t err;
+
+    HELPER_ASSERT_SUCCESS(_srs_rtc_dtls_certificate->initialize());
+
+    MockDtlsPeer client, server;
+    HELPER_ASSERT_SUCCESS(client.dtls->initialize("active", "auto"));
+    HELPER_ASSERT_SUCCESS(server.dtls->initialize("passive", "auto"));
+    HELPER_ASSERT_SUCCESS(server.dtls->start_active_handshake());
+    HELPER_ASSERT_SUCCESS(client.dtls->start_active_handshake());
+
+    for (int i = 0; i < 10 && (!client.done || !server.done); i++) {
+        HELPER_ASSERT_SUCCESS(client.deliver(&server));
+        HELPER_ASSERT_SUCCESS(server.deliver(&client));
+    }
+    EXPECT_TRUE(client.done);
+    EXPECT_TRUE(server.done);
+
+    // Both peers prefer AES-GCM.
+#ifdef SRS_SRTP_GCM
+    EXPECT_EQ(SrsSrtpProfileAeadAes128Gcm, client.dtls->get_srtp_profile());
+    EXPECT_EQ(SrsSrtpProfileAeadAes128Gcm, server.dtls->get_srtp_profile());
+#else
+    EXPECT_EQ(SrsSrtpProfileAes128CmSha1_80, server.dtls->get_srtp_profile());
+#endif
+
+    // The send key of client is the recv key of server.
+    string crecv, csend, srecv, ssend;
+    HELPER_ASSERT_SUCCESS(client.dtls->get_srtp_key(crecv, csend));
+    HELPER_ASSERT_SUCCESS(server.dtls->get_srtp_key(srecv, ssend));
+    EXPECT_TRUE(csend == srecv);
+    EXPECT_TRUE(crecv == ssend);
+
+    SrsSRTP csrtp, ssrtp;
+    HELPER_ASSERT_SUCCESS(csrtp.initialize(crecv, csend, client.dtls->get_srtp_profile()));
+    HELPER_ASSERT_SUCCESS(ssrtp.initialize(srecv, ssend, server.dtls->get_srtp_profile()));
+
+    char buf[kRtpPacketSize], plaintext[kRtpPacketSize];
+    int nn_plaintext = mock_rtp_packet(plaintext, 100, 1000);
+    memcpy(buf, plaintext, nn_plaintext);
+
+    int nn = nn_plaintext;
+    HELPER_ASSERT_SUCCESS(ssrtp.protect_rtp(buf, &nn));
+    HELPER_ASSERT_SUCCESS(csrtp.unprotect_rtp(buf, &nn));
+    EXPECT_EQ(nn_plaintext, nn);
+    EXPECT_EQ(0, memcmp(plaintext, buf, nn_plaintext));
+}
+
+// Create a RTMP video message, the payload are AVC NALUs of specified sizes.
+SrsSharedPtrMessage* mock_rtc_rtmp_video(uint32_t timestamp, bool keyframe, const vector<int>& nalus)
+{
+    int size = 5;
+    for (int i = 0; i < (int)nalus.size(); i++) {
+        size += 4 + nalus[i];
+    }
+
+    char* payload = new char[size];
+    memset(payload, 0, size);
+
+    SrsBuffer b(payload, size);
+    b.write_1bytes(keyframe? 0x17 : 0x27);
+    b.write_1bytes(0x01);
+    b.write_3bytes(0);
+    for (int i = 0; i < (int)nalus.size(); i++) {
+        b.write_4bytes(nalus[i]);
+        b.write_1bytes(keyframe? 0x65 : 0x41);
+        for (int j = 1; j < nalus[i]; j++) {
+            b.write_1bytes((uint8_t)(i + j));
+        }
+    }
+
+    SrsMessageHeader h;
+    h.initialize_video(size, timestamp, 1);
+
+    SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+    srs_error_t err = msg->create(&h, payload, size);
+    srs_assert(err == srs_success);
+    return msg;
+}
+
+// Feed the AVC sequence header to bridge.
+srs_error_t mock_rtc_bridge_sh(SrsRtcFromRtmpBridge* bridge)
+{
+    uint8_t raw[] = {
+        0x17, 0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20, 0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+    };
+    char* payload = new char[sizeof(raw)];
+    memcpy(payload, raw, sizeof(raw));
+
+    SrsMessageHeader h;
+    h.initialize_video(sizeof(raw), 0, 1);
+    SrsSharedPtrMessage msg;
+    srs_error_t err = msg.create(&h, payload, sizeof(raw));
+    srs_assert(err == srs_success);
+
+    return bridge->on_video(&msg);
+}
+
+// Dump all packets of consumer, and encode them to bytes.
+srs_error_t mock_rtc_dump_packets(SrsRtcConsumer* consumer, vector<string>& pkts)
+{
+    srs_error_t err = srs_success;
+
+    while (true) {
+        SrsRtpPacket* pkt = NULL;
+        if ((err = consumer->dump_packet(&pkt)) != srs_success) {
+            return err;
+        }
+        if (!pkt) {
+            break;
+        }
+        SrsAutoFree(SrsRtpPacket, pkt);
+
+        char buf[kRtpPacketSize];
+        SrsBuffer b(buf, sizeof(buf));
+        if ((err = pkt->encode(&b)) != srs_success) {
+            return err;
+        }
+        pkts.push_back(string(buf, b.pos()));
+    }
+
+    return err;
+}
+
+VOID TEST(KernelRTCTest, RtmpToRtcFrameArena)
+{
+    srs_error_t err;
+
+    for (int merge = 0; merge < 2; merge++) {
+        SrsRequest req;
+        SrsRtcSource source;
+        HELPER_ASSERT_SUCCESS(source.initialize(&req));
+
+        SrsRtcConsumer* c0 = NULL;
+        HELPER_ASSERT_SUCCESS(source.create_consumer(c0));
+        SrsAutoFree(SrsRtcConsumer, c0);
+
+        SrsRtcConsumer* c1 = NULL;
+        HELPER_ASSERT_SUCCESS(source.create_consumer(c1));
+        SrsAutoFree(SrsRtcConsumer, c1);
+
+        SrsRtcFromRtmpBridge bridge(&source);
+        HELPER_ASSERT_SUCCESS(bridge.initialize(&req));
+        HELPER_ASSERT_SUCCESS(bridge.format->initialize());
+        bridge.rtmp_to_rtc = true;
+        bridge.merge_nalus = (merge == 1);
+        HELPER_ASSERT_SUCCESS(mock_rtc_bridge_sh(&bridge));
+
+        // A keyframe of small NALU and large NALU, packaged as STAP-A, single NALU and FU-A, or merged.
+        vector<int> nalus;
+        nalus.push_back(100);
+        nalus.push_back(3000);
+        SrsSharedPtrMessage* msg = mock_rtc_rtmp_video(40, true, nalus);
+        HELPER_ASSERT_SUCCESS(bridge.on_video(msg));
+        // The packets refer to the frame, even the message is freed.
+        srs_freep(msg);
+
+        vector<string> pkts0, pkts1;
+        HELPER_ASSERT_SUCCESS(mock_rtc_dump_packets(c0, pkts0));
+        HELPER_ASSERT_SUCCESS(mock_rtc_dump_packets(c1, pkts1));
+        ASSERT_EQ(merge? 4 : 5, (int)pkts0.size());
+        ASSERT_EQ(pkts0.size(), pkts1.size());
+        for (int i = 0; i < (int)pkts0.size(); i++) {
+            EXPECT_TRUE(pkts0[i] == pkts1[i]);
+        }
+
+        // The first packet is STAP-A of SPS and PPS.
+        EXPECT_EQ(kStapA, (uint8_t)pkts0[0].at(12) & kNalTypeMask);
+        EXPECT_EQ(12 + 1 + 2 + 25 + 2 + 5, (int)pkts0[0].size());
+
+        // The last packet of frame is marked, and is the end of FU-A.
+        SrsRtpHeader h;
+        SrsBuffer b((char*)pkts0.back().data(), (int)pkts0.back().size());
+        HELPER_ASSERT_SUCCESS(h.decode(&b));
+        EXPECT_TRUE(h.get_marker());
+        EXPECT_EQ(40 * 90, (int)h.get_timestamp());
+        EXPECT_EQ(kFuA, (uint8_t)pkts0.back().at(12) & kNalTypeMask);
+        EXPECT_EQ(0x40, (uint8_t)pkts0.back().at(13) & 0xc0);
+    }
+
+    // The copies share the payload of packet in arena, and hold the arena.
+    if (true) {
+        vector<int> nalus;
+        nalus.push_back(100);
+        SrsSharedPtrMessage* msg = mock_rtc_rtmp_video(0, false, nalus);
+        SrsAutoFree(SrsSharedPtrMessage, msg);
+
+        SrsRtpFrameArena* arena = new SrsRtpFrameArena(msg);
+        SrsRtpPacket* pkt = arena->create_packet();
+        SrsRtpRawPayload* raw = arena->create<SrsRtpRawPayload>();
+        pkt->set_payload(raw, SrsRtspPacketPayloadTypeRaw);
+        raw->payload = msg->payload + 9;
+        raw->nn_payload = 100;
+
+        char* p = arena->alloc(5000);
+        EXPECT_TRUE(p != NULL);
+        EXPECT_EQ(0, (int)((uint64_t)p & 15));
+
+        SrsRtpPacket* cp = pkt->copy();
+        SrsRtpPacket* cp2 = cp->copy();
+        EXPECT_TRUE(cp->payload() == raw);
+        EXPECT_TRUE(cp2->payload() == raw);
+        EXPECT_EQ(2, arena->shared_count_);
+
+        srs_rtp_frame_arena_release(arena);
+        EXPECT_EQ(1, arena->shared_count_);
+        srs_freep(cp);
+        EXPECT_EQ(0, arena->shared_count_);
+        EXPECT_EQ(100, (int)cp2->payload()->nb_bytes());
+        srs_freep(cp2);
+    }
+}
+
+VOID TEST(KernelRTCTest, RtmpToRtcPackageFanout)
+{
+    srs_error_t err;
+
+    SrsRequest req;
+    SrsRtcSource source;
+    HELPER_ASSERT_SUCCESS(source.initialize(&req));
+
+    vector<SrsRtcConsumer*> consumers;
+    for (int i = 0; i < 3; i++) {
+        SrsRtcConsumer* consumer = NULL;
+        HELPER_ASSERT_SUCCESS(source.create_consumer(consumer));
+        consumers.push_back(consumer);
+    }
+
+    SrsRtcFromRtmpBridge bridge(&source);
+    HELPER_ASSERT_SUCCESS(bridge.initialize(&req));
+    HELPER_ASSERT_SUCCESS(bridge.format->initialize());
+    bridge.rtmp_to_rtc = true;
+    HELPER_ASSERT_SUCCESS(mock_rtc_bridge_sh(&bridge));
+
+    // A GOP of 1 keyframe of 80KB and 29 P-frames of 6KB, at 30fps.
+    const int nn_frames = 300;
+    vector<SrsSharedPtrMessage*> msgs;
+    for (int i = 0; i < 30; i++) {
+        vector<int> nalus;
+        nalus.push_back(i == 0? 80 * 1024 : 6 * 1024);
+        msgs.push_back(mock_rtc_rtmp_video(i * 33, i == 0, nalus));
+    }
+
+    vector<int> nn_packets(consumers.size());
+    vector<int> last_seqs(consumers.size(), -1);
+    for (int i = 0; i < nn_frames; i++) {
+        SrsSharedPtrMessage* msg = msgs[i % msgs.size()];
+        HELPER_ASSERT_SUCCESS(bridge.on_video(msg));
+
+        // Consume all packets, as players to send them.
+        for (int j = 0; j < (int)consumers.size(); j++) {
+            SrsRtcConsumer* consumer = consumers[j];
+            while (true) {
+                SrsRtpPacket* pkt = NULL;
+                HELPER_ASSERT_SUCCESS(consumer->dump_packet(&pkt));
+                if (!pkt) break;
+
+                // Each consumer gets all packets in order.
+                uint16_t seq = pkt->header.get_sequence();
+                if (last_seqs[j] >= 0) {
+                    EXPECT_EQ((uint16_t)(last_seqs[j] + 1), seq);
+                }
+                last_seqs[j] = seq;
+                nn_packets[j]++;
+                srs_freep(pkt);
+            }
+        }
+    }
+
+    // All consumers get the same packets, more than frames because the frames are larger than MTU.
+    EXPECT_GT(nn_packets[0], nn_frames);
+    for (int i = 1; i < (int)consumers.size(); i++) {
+        EXPECT_EQ(nn_packets[0], nn_packets[i]);
+    }
+
+    for (int i = 0; i < (int)msgs.size(); i++) {
+        srs_freep(msgs[i]);
+    }
+    for (int i = 0; i < (int)consumers.size(); i++) {
+        srs_freep(consumers[i]);
+    }
+}
+
+// Create a video packet of frame, mark it if end of frame.
+SrsRtpPacket* mock_jitter_video(uint16_t seq, uint32_t ts, bool keyframe, bool marker)
+{
+    SrsRtpPacket* pkt = mock_rtc_video(100, seq, ts, keyframe);
+    pkt->header.set_marker(marker);
+    return pkt;
+}
+
+// Pop a frame from jitter buffer, return the sequences of packets, or empty if no frame.
+vector<uint16_t> mock_jitter_pop(SrsRtpJitterBuffer& jitter, srs_utime_t now)
+{
+    vector<uint16_t> seqs;
+
+    vector<SrsRtpPacket*> frame;
+    if (jitter.pop_frame(frame, now)) {
+        for (int i = 0; i < (int)frame.size(); i++) {
+            seqs.push_back(frame[i]->header.get_sequence());
+            srs_freep(frame[i]);
+        }
+    }
+
+    return seqs;
+}
+
+VOID TEST(KernelRTCTest, JitterBufferFrames)
+{
+    srs_utime_t now = 100 * SRS_UTIME_SECONDS;
+
+    // The frame is ready when got the marker, or the packet of next frame.
+    if (true) {
+        SrsRtpJitterBuffer jitter(64);
+        jitter.insert(mock_jitter_video(65534, 3000, true, false), now);
+        jitter.insert(mock_jitter_video(65535, 3000, true, true), now);
+        jitter.insert(mock_jitter_video(0, 6000, false, false), now);
+        jitter.insert(mock_jitter_video(1, 9000, false, false), now);
+
+        vector<uint16_t> seqs = mock_jitter_pop(jitter, now);
+        ASSERT_EQ(2, (int)seqs.size());
+        EXPECT_EQ(65534, seqs[0]);
+        EXPECT_EQ(65535, seqs[1]);
+
+        seqs = mock_jitter_pop(jitter, now);
+        ASSERT_EQ(1, (int)seqs.size());
+        EXPECT_EQ(0, seqs[0]);
+
+        // Wait for the end of frame.
+        EXPECT_TRUE(mock_jitter_pop(jitter, now).empty());
+        EXPECT_FALSE(jitter.need_keyframe());
+    }
+
+    // The reordered packet is recovered, before timeout.
+    if (true) {
+        SrsRtpJitterBuffer jitter(64);
+        jitter.insert(mock_jitter_video(10, 3000, false, false), now);
+        jitter.insert(mock_jitter_video(12, 3000, false, true), now);
+        EXPECT_TRUE(mock_jitter_pop(jitter, now).empty());
+
+        jitter.insert(mock_jitter_video(11, 3000, false, false), now + 10 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(3, (int)mock_jitter_pop(jitter, now).size());
+        EXPECT_EQ(1, (int)jitter.nn_recovered());
+        EXPECT_EQ(0, (int)jitter.nn_dropped_frames());
+
+        // The duplicated packet is ignored.
+        jitter.insert(mock_jitter_video(11, 3000, false, false), now);
+        EXPECT_TRUE(mock_jitter_pop(jitter, now).empty());
+    }
+
+    // The frame is dropped if lost packet timeout, and the following frames continue.
+    if (true) {
+        SrsRtpJitterBuffer jitter(64);
+        jitter.set_max_delay(300 * SRS_UTIME_MILLISECONDS);
+        srs_utime_t delay = jitter.delay();
+        EXPECT_EQ(60 * SRS_UTIME_MILLISECONDS, delay);
+
+        jitter.insert(mock_jitter_video(1, 3000, true, true), now);
+        jitter.insert(mock_jitter_video(2, 6000, false, false), now);
+        jitter.insert(mock_jitter_video(4, 6000, false, true), now);
+        jitter.insert(mock_jitter_video(5, 9000, false, true), now);
+
+        EXPECT_EQ(1, (int)mock_jitter_pop(jitter, now).size());
+        EXPECT_TRUE(mock_jitter_pop(jitter, now + delay - 1).empty());
+
+        // The P-frame after the dropped frame is dropped, util keyframe.
+        EXPECT_TRUE(mock_jitter_pop(jitter, now + delay).empty());
+        EXPECT_EQ(1, (int)jitter.nn_dropped_frames());
+        EXPECT_EQ(1, (int)jitter.nn_skipped_frames());
+        EXPECT_TRUE(jitter.need_keyframe());
+
+        // The late packet is dropped, but the delay increases to wait longer.
+        jitter.insert(mock_jitter_video(3, 6000, false, false), now + 100 * SRS_UTIME_MILLISECONDS);
+        EXPECT_TRUE(mock_jitter_pop(jitter, now).empty());
+        EXPECT_EQ(200 * SRS_UTIME_MILLISECONDS, jitter.delay());
+
+        // The keyframe recovers the stream.
+        jitter.insert(mock_jitter_video(6, 12000, true, true), now);
+        EXPECT_EQ(1, (int)mock_jitter_pop(jitter, now).size());
+        EXPECT_FALSE(jitter.need_keyframe());
+    }
+
+    // The first packets of frame are lost, drop to the next frame.
+    if (true) {
+        SrsRtpJitterBuffer jitter(64);
+        jitter.set_max_delay(0);
+        jitter.insert(mock_jitter_video(1, 3000, true, true), now);
+        jitter.insert(mock_jitter_video(4, 6000, true, true), now);
+        jitter.insert(mock_jitter_video(5, 9000, false, false), now);
+        jitter.insert(mock_jitter_video(6, 9000, false, true), now);
+
+        EXPECT_EQ(1, (int)mock_jitter_pop(jitter, now).size());
+
+        // The packet after lost packets, is the start of frame, if not a FU-A fragment.
+        vector<uint16_t> seqs = mock_jitter_pop(jitter, now);
+        ASSERT_EQ(1, (int)seqs.size());
+        EXPECT_EQ(4, seqs[0]);
+        EXPECT_EQ(1, (int)jitter.nn_dropped_frames());
+
+        seqs = mock_jitter_pop(jitter, now);
+        ASSERT_EQ(2, (int)seqs.size());
+        EXPECT_EQ(5, seqs[0]);
+    }
+
+    // The FU-A fragments after lost packets, are dropped with the frame.
+    if (true) {
+        SrsRtpJitterBuffer jitter(64);
+        jitter.set_max_delay(0);
+        jitter.insert(mock_jitter_video(1, 3000, true, true), now);
+        for (int i = 3; i <= 4; i++) {
+            SrsRtpPacket* pkt = mock_jitter_video(i, 6000, false, i == 4);
+            SrsRtpFUAPayload2* fua = new SrsRtpFUAPayload2();
+            fua->end = (i == 4);
+            pkt->set_payload(fua, SrsRtspPacketPayloadTypeFUA2);
+            jitter.insert(pkt, now);
+        }
+        jitter.insert(mock_jitter_video(5, 9000, true, true), now);
+
+        EXPECT_EQ(1, (int)mock_jitter_pop(jitter, now).size());
+        vector<uint16_t> seqs = mock_jitter_pop(jitter, now);
+        ASSERT_EQ(1, (int)seqs.size());
+        EXPECT_EQ(5, seqs[0]);
+        EXPECT_EQ(1, (int)jitter.nn_dropped_frames());
+    }
+
+    // Drop the frames if buffer overflows.
+    if (true) {
+        SrsRtpJitterBuffer jitter(64);
+        jitter.insert(mock_jitter_video(1, 3000, true, false), now);
+        jitter.insert(mock_jitter_video(3, 3000, true, true), now);
+        jitter.insert(mock_jitter_video(4, 6000, false, true), now);
+        jitter.insert(mock_jitter_video(65, 9000, true, true), now);
+        EXPECT_EQ(1, (int)jitter.nn_dropped_frames());
+
+        // The P-frame is dropped, then wait for the lost packets before the keyframe.
+        EXPECT_TRUE(mock_jitter_pop(jitter, now).empty());
+        EXPECT_EQ(1, (int)jitter.nn_skipped_frames());
+        EXPECT_EQ(1, (int)mock_jitter_pop(jitter, now + SRS_UTIME_SECONDS).size());
+    }
+
+    // The capacity is rounded up to power of 2, so the index is continuous when sequence wraps.
+    if (true) {
+        SrsRtpJitterBuffer jitter(100);
+        EXPECT_EQ(128, jitter.capacity_);
+
+        jitter.insert(mock_jitter_video(65535, 3000, true, true), now);
+        jitter.insert(mock_jitter_video(0, 6000, false, true), now);
+        EXPECT_EQ(1, (int)mock_jitter_pop(jitter, now).size());
+        EXPECT_EQ(1, (int)mock_jitter_pop(jitter, now).size());
+
+        EXPECT_EQ(32768, SrsRtpJitterBuffer(65536).capacity_);
+    }
+}
+
+VOID TEST(KernelRTCTest, PublishMergePLI)
+{
+    SrsRtcConnection s(NULL, SrsContextId());
+    SrsRtcPublishStream publish(&s, SrsContextId());
+    publish.pli_interval_ = 500 * SRS_UTIME_MILLISECONDS;
+
+    // The PLI worker is not started, so the PLI to send is queued.
+    std::map<uint32_t, SrsContextId>& plis = publish.pli_worker_->plis_;
+
+    // The second PLI in interval is merged.
+    publish.request_keyframe(200, SrsContextId());
+    publish.request_keyframe(200, SrsContextId());
+    EXPECT_EQ(1, (int)plis.size());
+    EXPECT_EQ(1, (int)publish.nn_pli_merged_);
+
+    // The PLI for another SSRC is never merged.
+    publish.request_keyframe(300, SrsContextId());
+    EXPECT_EQ(2, (int)plis.size());
+    EXPECT_EQ(1, (int)publish.nn_pli_merged_);
+
+    // Send PLI again when the interval elapsed.
+    plis.clear();
+    publish.pli_last_[200] -= publish.pli_interval_;
+    publish.request_keyframe(200, SrsContextId());
+    EXPECT_EQ(1, (int)plis.size());
+    EXPECT_EQ(1, (int)publish.nn_pli_merged_);
+
+    // Never merge PLI if disabled.
+    plis.clear();
+    publish.pli_interval_ = 0;
+    publish.request_keyframe(200, SrsContextId());
+    EXPECT_EQ(1, (int)plis.size());
+    EXPECT_EQ(1, (int)publish.nn_pli_merged_);
+}
+
+class MockRtcPliPublishStream : public ISrsRtcPublishStream
+{
+public:
+    int nn_plis;
+    SrsContextId cid;
+public:
+    MockRtcPliPublishStream() {
+        nn_plis = 0;
+    }
+    virtual void request_keyframe(uint32_t /*ssrc*/, SrsContextId /*cid*/) {
+        nn_plis++;
+    }
+    virtual const SrsContextId& context_id() {
+        return cid;
+    }
+};
+
+class MockRtcPliBridge : public ISrsRtcSourceBridge
+{
+public:
+    bool keyframe_required;
+public:
+    MockRtcPliBridge() {
+        keyframe_required = false;
+    }
+    virtual srs_error_t on_publish() {
+        return srs_success;
+    }
+    virtual srs_error_t on_rtp(SrsRtpPacket* /*pkt*/) {
+        return srs_success;
+    }
+    virtual void on_unpublish() {
+    }
+    virtual bool need_keyframe() {
+        return keyframe_required;
+    }
+};
+
+VOID TEST(KernelRTCTest, BridgePLIBackoff)
+{
+    srs_error_t err;
+
+    SrsRtcSource source;
+    source.stream_desc_ = new SrsRtcSourceDescription();
+    source.stream_desc_->video_track_descs_.push_back(new SrsRtcTrackDescription());
+    source.pli_for_rtmp_ = 6 * SRS_UTIME_SECONDS;
+
+    MockRtcPliBridge* bridge = new MockRtcPliBridge();
+    source.bridge_ = bridge;
+
+    MockRtcPliPublishStream publish;
+    source.set_publish_stream(&publish);
+
+    srs_utime_t tick = 100 * SRS_UTIME_MILLISECONDS;
+
+    // No PLI until the interval for RTMP elapsed.
+    for (int i = 0; i < 59; i++) {
+        HELPER_EXPECT_SUCCESS(source.on_timer(tick));
+    }
+    EXPECT_EQ(0, publish.nn_plis);
+    HELPER_EXPECT_SUCCESS(source.on_timer(tick));
+    EXPECT_EQ(1, publish.nn_plis);
+
+    // Request PLI immediately for frame dropped, but only once in backoff.
+    bridge->keyframe_required = true;
+    HELPER_EXPECT_SUCCESS(source.on_timer(tick));
+    EXPECT_EQ(2, publish.nn_plis);
+    for (int i = 0; i < 4; i++) {
+        HELPER_EXPECT_SUCCESS(source.on_timer(tick));
+    }
+    EXPECT_EQ(2, publish.nn_plis);
+
+    // Request PLI again when backoff elapsed, and the backoff is doubled.
+    HELPER_EXPECT_SUCCESS(source.on_timer(tick));
+    EXPECT_EQ(3, publish.nn_plis);
+    EXPECT_EQ(1 * SRS_UTIME_SECONDS, source.pli_backoff_);
+    for (int i = 0; i < 9; i++) {
+        HELPER_EXPECT_SUCCESS(source.on_timer(tick));
+    }
+    EXPECT_EQ(3, publish.nn_plis);
+    HELPER_EXPECT_SUCCESS(source.on_timer(tick));
+    EXPECT_EQ(4, publish.nn_plis);
+
+    // The backoff is limited by the interval for RTMP.
+    source.pli_backoff_ = 5 * SRS_UTIME_SECONDS;
+    source.pli_elapsed_ = 0;
+    for (int i = 0; i < 50; i++) {
+        HELPER_EXPECT_SUCCESS(source.on_timer(tick));
+    }
+    EXPECT_EQ(5, publish.nn_plis);
+    EXPECT_EQ(6 * SRS_UTIME_SECONDS, source.pli_backoff_);
+
+    // Reset the backoff when got keyframe, then request immediately for frame dropped again.
+    bridge->keyframe_required = false;
+    HELPER_EXPECT_SUCCESS(source.on_timer(tick));
+    EXPECT_EQ(0, source.pli_backoff_);
+    bridge->keyframe_required = true;
+    HELPER_EXPECT_SUCCESS(source.on_timer(tick));
+    EXPECT_EQ(6, publish.nn_plis);
+
+    source.set_publish_stream(NULL);
+}
+
+#ifdef SRS_FFMPEG_FIT
+class MockRtcLiveSourceHandler : public ISrsLiveSourceHandler
+{
+public:
+    virtual srs_error_t on_publish(SrsLiveSource* /*s*/, SrsRequest* /*r*/) {
+        return srs_success;
+    }
+    virtual void on_unpublish(SrsLiveSource* /*s*/, SrsRequest* /*r*/) {
+    }
+};
+
+extern void srs_utest_free_message_array(SrsMessageArray* arr);
+
+VOID TEST(KernelRTCTest, RtcToRtmpGatherFrame)
+{
+    srs_error_t err;
+
+    SrsRequest req;
+    req.vhost = "__defaultVhost__"; req.app = "live"; req.stream = "livestream";
+
+    MockRtcLiveSourceHandler handler;
+    SrsLiveSource source;
+    HELPER_ASSERT_SUCCESS(source.initialize(&req, &handler));
+
+    SrsLiveConsumer* consumer = NULL;
+    HELPER_ASSERT_SUCCESS(source.create_consumer(consumer));
+    SrsAutoFree(SrsLiveConsumer, consumer);
+
+    // The AVC sequence header, for format to parse the frame.
+    if (true) {
+        uint8_t raw[] = {
+            0x17, 0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20, 0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+        };
+        char* payload = new char[sizeof(raw)];
+        memcpy(payload, raw, sizeof(raw));
+
+        SrsCommonMessage msg;
+        msg.header.initialize_video(sizeof(raw), 0, 1);
+        HELPER_ASSERT_SUCCESS(msg.create(&msg.header, payload, sizeof(raw)));
+        HELPER_ASSERT_SUCCESS(source.on_video(&msg));
+    }
+
+    // A frame of SEI in single NALU, and IDR in three FU-A packets.
+    char sei[10], idr[250];
+    memset(sei, 0x06, sizeof(sei));
+    for (int i = 0; i < (int)sizeof(idr); i++) {
+        idr[i] = (char)i;
+    }
+
+    vector<SrsRtpPacket*> frame;
+    if (true) {
+        SrsRtpPacket* pkt = mock_rtc_video(100, 1, 9000, false);
+        pkt->nalu_type = SrsAvcNaluTypeSEI;
+        SrsRtpRawPayload* raw = new SrsRtpRawPayload();
+        raw->payload = sei;
+        raw->nn_payload = sizeof(sei);
+        pkt->set_payload(raw, SrsRtspPacketPayloadTypeRaw);
+        pkt->set_avsync_time(100);
+        frame.push_back(pkt);
+    }
+    for (int i = 0; i < 3; i++) {
+        SrsRtpPacket* pkt = mock_rtc_video(100, 2 + i, 9000, false);
+        pkt->nalu_type = (SrsAvcNaluType)kFuA;
+        SrsRtpFUAPayload2* fua = new SrsRtpFUAPayload2();
+        fua->nri = (SrsAvcNaluType)0x60;
+        fua->nalu_type = SrsAvcNaluTypeIDR;
+        fua->start = (i == 0);
+        fua->end = (i == 2);
+        fua->payload = idr + i * 100;
+        fua->size = (i == 2)? 50 : 100;
+        pkt->set_payload(fua, SrsRtspPacketPayloadTypeFUA2);
+        pkt->set_avsync_time(100);
+        frame.push_back(pkt);
+    }
+
+    SrsRtmpFromRtcBridge bridge(&source);
+    HELPER_EXPECT_SUCCESS(bridge.packet_video_rtmp(frame));
+    for (int i = 0; i < (int)frame.size(); i++) {
+        srs_freep(frame[i]);
+    }
+
+    // The frame is gathered in AVCC format.
+    char expect[5 + 4 + sizeof(sei) + 4 + 1 + 250];
+    if (true) {
+        SrsBuffer b(expect, sizeof(expect));
+        b.write_1bytes(0x17);
+        b.write_1bytes(0x01);
+        b.write_3bytes(0);
+        b.write_4bytes(sizeof(sei));
+        b.write_bytes(sei, sizeof(sei));
+        b.write_4bytes(1 + 250);
+        b.write_1bytes(0x65);
+        b.write_bytes(idr, 250);
+    }
+
+    SrsMessageArray msgs(8);
+    SrsMessageArray* pmsgs = &msgs;
+    SrsAutoFreeH(SrsMessageArray, pmsgs, srs_utest_free_message_array);
+
+    int count = 0;
+    HELPER_ASSERT_SUCCESS(consumer->dump_packets(&msgs, count));
+    ASSERT_EQ(2, count);
+
+    SrsSharedPtrMessage* msg = msgs.msgs[1];
+    EXPECT_EQ(100, (int)msg->timestamp);
+    ASSERT_EQ((int)sizeof(expect), msg->size);
+    EXPECT_TRUE(srs_bytes_equals(expect, msg->payload, msg->size));
+}
+
+class MockAudioTranscoder : public SrsAudioTranscoder
+{
+public:
+    int nn_transcoded;
+public:
+    MockAudioTranscoder() : nn_transcoded(0) {
+    }
+    virtual srs_error_t transcode(SrsAudioFrame* /*in*/, std::vector<SrsAudioFrame*>& /*outs*/) {
+        __atomic_add_fetch(&nn_transcoded, 1, __ATOMIC_RELAXED);
+        return srs_success;
+    }
+};
+
+static int mock_audio_consume(SrsAsyncAudioTranscoder* t, int nn_transcoded, MockAudioTranscoder* codec)
+{
+    // Wait for worker to transcode, then consume the tasks.
+    for (int i = 0; i < 1000 && __atomic_load_n(&codec->nn_transcoded, __ATOMIC_RELAXED) < nn_transcoded; i++) {
+        srs_usleep(1 * SRS_UTIME_MILLISECONDS);
+    }
+    srs_usleep(10 * SRS_UTIME_MILLISECONDS);
+
+    std::vector<SrsAudioTranscodeTask*> tasks;
+    t->consume(tasks);
+    for (int i = 0; i < (int)tasks.size(); i++) {
+        srs_freep(tasks[i]);
+    }
+    return (int)tasks.size();
+}
+
+VOID TEST(RtcAudioTranscodeTest, WorkerNotifyAndStop)
+{
+    srs_error_t err;
+
+    SrsAudioTranscodeWorker* worker = new SrsAudioTranscodeWorker();
+    SrsAutoFree(SrsAudioTranscodeWorker, worker);
+    HELPER_ASSERT_SUCCESS(worker->start());
+
+    SrsAsyncAudioTranscoder* t = new SrsAsyncAudioTranscoder("test", worker);
+    SrsAutoFree(SrsAsyncAudioTranscoder, t);
+    MockAudioTranscoder* codec = new MockAudioTranscoder();
+    srs_freep(t->codec_);
+    t->codec_ = codec;
+    worker->attach(t);
+
+    // The worker is parked when idle, and notified by submit.
+    srs_usleep(10 * SRS_UTIME_MILLISECONDS);
+    SrsAudioFrame frame;
+    HELPER_EXPECT_SUCCESS(t->submit(&frame));
+    EXPECT_EQ(1, mock_audio_consume(t, 1, codec));
+    EXPECT_LT(0, worker->notifier_->nn_notifies());
+
+    // The tasks submitted before reused, are dropped even if transcoded by worker after cleared.
+    HELPER_EXPECT_SUCCESS(t->submit(&frame));
+    t->clear();
+    EXPECT_EQ(0, mock_audio_consume(t, 2, codec));
+
+    HELPER_EXPECT_SUCCESS(t->submit(&frame));
+    EXPECT_EQ(1, mock_audio_consume(t, 3, codec));
+
+    // Stop and join the worker, then the stream is transcoded in current thread.
+    worker->stop();
+    EXPECT_TRUE(t->worker_ == NULL);
+
+    HELPER_EXPECT_SUCCESS(t->submit(&frame));
+    EXPECT_EQ(1, mock_audio_consume(t, 4, codec));
+}
+
+#endif
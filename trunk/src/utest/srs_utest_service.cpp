@@ -24,6 +24,7 @@ using namespace std;
 #include <srs_protocol_conn.hpp>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <unistd.h>
 #include <st.h>
 
 MockSrsConnection::MockSrsConnection()
@@ -1573,3 +1574,87 @@ VOID TEST(ThreadCriticalTest, FailIfCloseActiveFD)
     h.fd = NULL;
 }
 
+
+class MockSendfileReader : public ISrsCoroutineHandler
+{
+public:
+    SrsSTCoroutine trd;
+    SrsStSocket* skt;
+    int expect;
+    string received;
+    MockSendfileReader(srs_netfd_t fd, int size) : trd("mock", this) {
+        skt = new SrsStSocket(fd);
+        skt->set_recv_timeout(3 * SRS_UTIME_SECONDS);
+        expect = size;
+    };
+    virtual ~MockSendfileReader() {
+        trd.stop();
+        srs_freep(skt);
+    }
+    virtual srs_error_t cycle() {
+        srs_error_t err = srs_success;
+
+        char buf[4096];
+        while ((int)received.length() < expect) {
+            ssize_t nn = 0;
+            if ((err = skt->read(buf, sizeof(buf), &nn)) != srs_success) {
+                return err;
+            }
+            received.append(buf, nn);
+        }
+
+        return err;
+    }
+};
+
+VOID TEST(TCPServerTest, StSocketSendfile)
+{
+    srs_error_t err;
+
+    // Larger than the buffer of socket, so the writer must wait for the reader.
+    string content;
+    for (int i = 0; i < 1024 * 1024; i++) {
+        content.append(1, (char)('a' + i % 26));
+    }
+
+    char path[] = "/tmp/srs-utest-sendfile-XXXXXX";
+    int fd = ::mkstemp(path);
+    ASSERT_TRUE(fd > 0);
+    ASSERT_EQ((ssize_t)content.length(), ::write(fd, content.data(), content.length()));
+    ::unlink(path);
+
+    int fds[2];
+    ASSERT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    srs_netfd_t wfd = srs_netfd_open_socket(fds[0]);
+    srs_netfd_t rfd = srs_netfd_open_socket(fds[1]);
+
+    if (true) {
+        int offset = 100;
+        int size = (int)content.length() - 200;
+
+        MockSendfileReader reader(rfd, size);
+        HELPER_ASSERT_SUCCESS(reader.trd.start());
+
+        SrsStSocket skt(wfd);
+        skt.set_send_timeout(3 * SRS_UTIME_SECONDS);
+
+        int64_t nwrite = 0;
+        HELPER_EXPECT_SUCCESS(skt.sendfile(fd, offset, size, &nwrite));
+        EXPECT_EQ(size, nwrite);
+        EXPECT_EQ(size, skt.get_send_bytes());
+
+        // The offset of file is not changed, which is at the end after written.
+        EXPECT_EQ((off_t)content.length(), ::lseek(fd, 0, SEEK_CUR));
+
+        // Wait for reader to consume all data.
+        for (int i = 0; i < 100 && (int)reader.received.length() < size; i++) {
+            srs_usleep(10 * SRS_UTIME_MILLISECONDS);
+        }
+        EXPECT_EQ(size, (int)reader.received.length());
+        EXPECT_TRUE(reader.received == content.substr(offset, size));
+    }
+
+    srs_close_stfd(wfd);
+    srs_close_stfd(rfd);
+    ::close(fd);
+}
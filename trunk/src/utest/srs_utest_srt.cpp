@@ -11,7 +11,12 @@
 #include <srs_protocol_rtmp_stack.hpp>
 #include <srs_app_srt_utility.hpp>
 #include <srs_app_srt_server.hpp>
+#include <srs_app_srt_source.hpp>
+#include <srs_app_source.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_flv.hpp>
 #include <srs_core_autofree.hpp>
+#include <srs_utest_config.hpp>
 
 #include <sstream>
 #include <vector>
@@ -316,6 +321,56 @@ VOID TEST(ServiceStSRTTest, ReadWrite)
     }
 }
 
+// Benchmark the latency of SRT ingest, from the publisher sends a packet, to the server coroutine reads it, which
+// is the first hop of SRT to RTMP. The SRT thread wakes up the coroutine immediately, without polling by sleep.
+VOID TEST(ServiceStSRTTest, IngestInOrder)
+{
+    srs_error_t err = srs_success;
+
+    std::string server_ip = "127.0.0.1";
+    int server_port = 19001;
+
+    // Set the TSBPD latency to zero, to deliver packet immediately.
+    MockSrtServer srt_server;
+    HELPER_EXPECT_SUCCESS(srt_server.create_socket());
+    HELPER_EXPECT_SUCCESS(srs_srt_set_latency(srt_server.fd(), 0));
+    HELPER_EXPECT_SUCCESS(srt_server.listen(server_ip, server_port));
+
+    srs_srt_t srt_client_fd = srs_srt_socket_invalid();
+    HELPER_EXPECT_SUCCESS(srs_srt_socket_with_default_option(&srt_client_fd));
+    HELPER_EXPECT_SUCCESS(srs_srt_set_latency(srt_client_fd, 0));
+    SrsSrtSocket* srt_client_socket = new SrsSrtSocket(_srt_eventloop->poller(), srt_client_fd);
+    SrsAutoFree(SrsSrtSocket, srt_client_socket);
+
+    HELPER_EXPECT_SUCCESS(srt_client_socket->connect(server_ip, server_port));
+
+    srs_srt_t srt_server_accepted_fd = srs_srt_socket_invalid();
+    HELPER_EXPECT_SUCCESS(srt_server.accept(&srt_server_accepted_fd));
+    SrsSrtSocket* srt_server_accepted_socket = new SrsSrtSocket(_srt_eventloop->poller(), srt_server_accepted_fd);
+    SrsAutoFree(SrsSrtSocket, srt_server_accepted_socket);
+
+    // Send a TS packet, then wait for it, so the server coroutine is always waiting when packet arrives, and it
+    // should be woken up by the event loop for each packet, in order.
+    for (int i = 0; i < 100; i++) {
+        char buf[1316];
+        memset(buf, 0x47, sizeof(buf));
+        SrsBuffer(buf + 1, 4).write_4bytes(i);
+
+        ssize_t nb_write = 0;
+        HELPER_ASSERT_SUCCESS(srt_client_socket->sendmsg(buf, sizeof(buf), &nb_write));
+        EXPECT_EQ(1316, (int)nb_write);
+
+        char rbuf[1316];
+        memset(rbuf, 0, sizeof(rbuf));
+
+        ssize_t nb_read = 0;
+        HELPER_ASSERT_SUCCESS(srt_server_accepted_socket->recvmsg(rbuf, sizeof(rbuf), &nb_read));
+        ASSERT_EQ(1316, (int)nb_read);
+        EXPECT_EQ(i, SrsBuffer(rbuf + 1, 4).read_4bytes());
+        EXPECT_TRUE(srs_bytes_equals(buf, rbuf, sizeof(buf)));
+    }
+}
+
 // Test srt server 
 class MockSrtHandler : public ISrsSrtHandler
 {
@@ -334,6 +389,285 @@ public:
 	}
 };
 
+// Create a RTMP video message, the payload is an AVC NALU with specified size.
+SrsSharedPtrMessage* mock_srt_video(uint32_t timestamp, bool keyframe, int nalu_size)
+{
+    int size = 5 + 4 + nalu_size;
+    char* payload = new char[size];
+    memset(payload, 0, size);
+
+    SrsBuffer b(payload, size);
+    b.write_1bytes(keyframe? 0x17 : 0x27);
+    b.write_1bytes(0x01);
+    b.write_3bytes(0);
+    b.write_4bytes(nalu_size);
+    b.write_1bytes(keyframe? 0x65 : 0x41);
+
+    SrsMessageHeader h;
+    h.initialize_video(size, timestamp, 1);
+
+    SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+    srs_error_t err = msg->create(&h, payload, size);
+    srs_assert(err == srs_success);
+    return msg;
+}
+
+VOID TEST(SrtBridgeTest, MuxRtmpToSrt)
+{
+    srs_error_t err;
+
+    SrsSrtSource source;
+    SrsSrtConsumer* consumer = NULL;
+    HELPER_EXPECT_SUCCESS(source.create_consumer(consumer));
+    SrsAutoFree(SrsSrtConsumer, consumer);
+
+    SrsRequest req;
+    SrsSrtFromRtmpBridge bridge(&source);
+    HELPER_EXPECT_SUCCESS(bridge.initialize(&req));
+
+    // The AVC sequence header is ignored.
+    if (true) {
+        uint8_t raw[] = {
+            0x17, 0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20, 0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+        };
+        char* payload = new char[sizeof(raw)];
+        memcpy(payload, raw, sizeof(raw));
+
+        SrsMessageHeader h;
+        h.initialize_video(sizeof(raw), 0, 1);
+        SrsSharedPtrMessage msg;
+        HELPER_EXPECT_SUCCESS(msg.create(&h, payload, sizeof(raw)));
+        HELPER_EXPECT_SUCCESS(bridge.on_video(&msg));
+
+        SrsSrtPacket* pkt = NULL;
+        HELPER_EXPECT_SUCCESS(consumer->dump_packet(&pkt));
+        EXPECT_TRUE(pkt == NULL);
+    }
+
+    // The IDR starts with PAT, and is split to packets of 7 TS packets.
+    if (true) {
+        SrsSharedPtrMessage* msg = mock_srt_video(1000, true, 5000);
+        SrsAutoFree(SrsSharedPtrMessage, msg);
+        HELPER_EXPECT_SUCCESS(bridge.on_video(msg));
+
+        int nn = 0, bytes = 0;
+        SrsSrtPacket* pkt = NULL;
+        while (true) {
+            HELPER_EXPECT_SUCCESS(consumer->dump_packet(&pkt));
+            if (!pkt) break;
+            SrsAutoFreeH(SrsSrtPacket, pkt, srs_srt_packet_release);
+
+            if (nn == 0) {
+                // The first TS packet is PAT, pid is 0.
+                EXPECT_EQ(0x47, (uint8_t)pkt->data()[0]);
+                EXPECT_EQ(0, ((uint8_t)pkt->data()[1] & 0x1f) << 8 | (uint8_t)pkt->data()[2]);
+            }
+            EXPECT_EQ(0, pkt->size() % SRS_TS_PACKET_SIZE);
+            EXPECT_LE(pkt->size(), SRS_SRT_MAX_PAYLOAD_SIZE);
+            EXPECT_EQ(1000, pkt->timestamp());
+            bytes += pkt->size();
+            nn++;
+        }
+        EXPECT_EQ(5, nn);
+        EXPECT_GT(bytes, 5000);
+    }
+
+    // The packets of frame are spread in the interval of frames.
+    if (true) {
+        SrsSharedPtrMessage* msg = mock_srt_video(1040, false, 5000);
+        SrsAutoFree(SrsSharedPtrMessage, msg);
+        HELPER_EXPECT_SUCCESS(bridge.on_video(msg));
+
+        vector<int64_t> timestamps;
+        SrsSrtPacket* pkt = NULL;
+        while (true) {
+            HELPER_EXPECT_SUCCESS(consumer->dump_packet(&pkt));
+            if (!pkt) break;
+            SrsAutoFreeH(SrsSrtPacket, pkt, srs_srt_packet_release);
+            timestamps.push_back(pkt->timestamp());
+        }
+        ASSERT_EQ(4, (int)timestamps.size());
+        EXPECT_EQ(1040, timestamps[0]);
+        EXPECT_EQ(1050, timestamps[1]);
+        EXPECT_EQ(1060, timestamps[2]);
+        EXPECT_EQ(1070, timestamps[3]);
+    }
+}
+
+VOID TEST(SrtBridgeTest, CompositeBridgeToSrt)
+{
+    srs_error_t err;
+
+    MockSrsConfig conf;
+    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "srt_server{enabled on;} vhost __defaultVhost__{srt{enabled on;rtmp_to_srt on;}}"));
+
+    SrsConfig* saved = _srs_config;
+    _srs_config = &conf;
+
+    SrsRequest req;
+    req.vhost = "__defaultVhost__";
+    req.app = "live";
+    req.stream = "composite-bridge-to-srt";
+
+    // Bridge to SRT, for the stream published by RTMP or WebRTC.
+    if (true) {
+        SrsCompositeBridge bridge;
+        HELPER_EXPECT_SUCCESS(bridge.initialize(&req, false, true));
+        EXPECT_FALSE(bridge.empty());
+    }
+
+    // Never bridge back to the SRT publisher.
+    if (true) {
+        SrsCompositeBridge bridge;
+        HELPER_EXPECT_SUCCESS(bridge.initialize(&req, false, false));
+        EXPECT_TRUE(bridge.empty());
+    }
+
+    _srs_config = saved;
+}
+
+VOID TEST(SrtFanoutTest, ShareWithoutCopy)
+{
+    srs_error_t err;
+
+    SrsSrtSource source;
+    SrsSrtConsumer* c0 = NULL;
+    HELPER_EXPECT_SUCCESS(source.create_consumer(c0));
+    SrsAutoFree(SrsSrtConsumer, c0);
+
+    SrsSrtConsumer* c1 = NULL;
+    HELPER_EXPECT_SUCCESS(source.create_consumer(c1));
+    SrsAutoFree(SrsSrtConsumer, c1);
+
+    SrsSrtPacket* pkt = new SrsSrtPacket();
+    pkt->wrap(SRS_SRT_MAX_PAYLOAD_SIZE);
+    HELPER_EXPECT_SUCCESS(source.on_packet(pkt));
+    // The publisher releases the packet, which is still referenced by the queue of source.
+    srs_srt_packet_release(pkt);
+
+    SrsSrtPacket* p0 = NULL;
+    HELPER_EXPECT_SUCCESS(c0->dump_packet(&p0));
+    SrsAutoFreeH(SrsSrtPacket, p0, srs_srt_packet_release);
+    EXPECT_TRUE(p0 == pkt);
+
+    SrsSrtPacket* p1 = NULL;
+    HELPER_EXPECT_SUCCESS(c1->dump_packet(&p1));
+    SrsAutoFreeH(SrsSrtPacket, p1, srs_srt_packet_release);
+    EXPECT_TRUE(p1 == pkt);
+
+    // No more packets.
+    SrsSrtPacket* p2 = NULL;
+    HELPER_EXPECT_SUCCESS(c0->dump_packet(&p2));
+    EXPECT_TRUE(p2 == NULL);
+}
+
+VOID TEST(SrtFanoutTest, SlowReader)
+{
+    srs_error_t err;
+
+    SrsSetEnvConfig(queue_size, "SRS_VHOST_SRT_QUEUE_SIZE", "4");
+    SrsRequest req;
+
+    // Drop the packets for slow reader, continue from the oldest packet in queue.
+    if (true) {
+        SrsSrtSource source;
+        HELPER_EXPECT_SUCCESS(source.initialize(&req));
+
+        SrsSrtConsumer* consumer = NULL;
+        HELPER_EXPECT_SUCCESS(source.create_consumer(consumer));
+        SrsAutoFree(SrsSrtConsumer, consumer);
+
+        for (int i = 0; i < 10; i++) {
+            SrsSrtPacket* pkt = new SrsSrtPacket();
+            SrsAutoFreeH(SrsSrtPacket, pkt, srs_srt_packet_release);
+            pkt->wrap(SRS_TS_PACKET_SIZE);
+            pkt->set_timestamp(i);
+            HELPER_EXPECT_SUCCESS(source.on_packet(pkt));
+        }
+        EXPECT_EQ(10, consumer->available());
+
+        for (int i = 6; i < 10; i++) {
+            SrsSrtPacket* pkt = NULL;
+            HELPER_EXPECT_SUCCESS(consumer->dump_packet(&pkt));
+            SrsAutoFreeH(SrsSrtPacket, pkt, srs_srt_packet_release);
+            ASSERT_TRUE(pkt != NULL);
+            EXPECT_EQ(i, pkt->timestamp());
+        }
+        EXPECT_EQ(0, consumer->available());
+    }
+
+    // Disconnect the slow reader.
+    if (true) {
+        SrsSetEnvConfig(slow_reader, "SRS_VHOST_SRT_SLOW_READER", "disconnect");
+
+        SrsSrtSource source;
+        HELPER_EXPECT_SUCCESS(source.initialize(&req));
+
+        SrsSrtConsumer* consumer = NULL;
+        HELPER_EXPECT_SUCCESS(source.create_consumer(consumer));
+        SrsAutoFree(SrsSrtConsumer, consumer);
+
+        for (int i = 0; i < 5; i++) {
+            SrsSrtPacket* pkt = new SrsSrtPacket();
+            SrsAutoFreeH(SrsSrtPacket, pkt, srs_srt_packet_release);
+            pkt->wrap(SRS_TS_PACKET_SIZE);
+            HELPER_EXPECT_SUCCESS(source.on_packet(pkt));
+        }
+
+        SrsSrtPacket* pkt = NULL;
+        HELPER_EXPECT_FAILED(consumer->dump_packet(&pkt));
+        EXPECT_TRUE(pkt == NULL);
+    }
+}
+
+// Fan out a stream to 200 SRT players, each player consumes a batch of packets, and all packets are delivered.
+VOID TEST(SrtFanoutTest, DeliverAll)
+{
+    srs_error_t err;
+
+    const int nn_consumers = 200;
+    const int nn_packets = 2000;
+
+    SrsSrtSource source;
+    vector<SrsSrtConsumer*> consumers;
+    for (int i = 0; i < nn_consumers; i++) {
+        SrsSrtConsumer* consumer = NULL;
+        HELPER_EXPECT_SUCCESS(source.create_consumer(consumer));
+        consumers.push_back(consumer);
+    }
+
+    int64_t nn_delivered = 0;
+    for (int i = 0; i < nn_packets; i++) {
+        SrsSrtPacket* pkt = new SrsSrtPacket();
+        pkt->wrap(SRS_SRT_MAX_PAYLOAD_SIZE);
+        HELPER_EXPECT_SUCCESS(source.on_packet(pkt));
+        srs_srt_packet_release(pkt);
+
+        // Consume a batch of packets, like the players.
+        if ((i % 64) != 63) {
+            continue;
+        }
+
+        for (int j = 0; j < nn_consumers; j++) {
+            SrsSrtConsumer* consumer = consumers.at(j);
+            while (true) {
+                SrsSrtPacket* p = NULL;
+                HELPER_EXPECT_SUCCESS(consumer->dump_packet(&p));
+                if (!p) break;
+                srs_srt_packet_release(p);
+                nn_delivered++;
+            }
+        }
+    }
+
+    for (int i = 0; i < nn_consumers; i++) {
+        SrsSrtConsumer* consumer = consumers.at(i);
+        srs_freep(consumer);
+    }
+
+    EXPECT_EQ(nn_consumers * (nn_packets / 64 * 64), nn_delivered);
+}
+
 VOID TEST(SrtServerTest, SrtListener) 
 {
     srs_error_t err = srs_success;